@@ -0,0 +1,106 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/adaptive_sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "tcmalloc/allocation_sampling.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/parameters.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Weight of the newest rate observation in the EWMA.  The background thread
+// ticks roughly once per second, so this gives a time constant of a few
+// seconds: long enough to ride out a single burst, short enough to track a
+// phase change.
+constexpr double kEwmaWeight = 0.25;
+
+// Interval changes below this factor are not applied, so the per-thread
+// samplers are not perturbed while the rate estimate dithers around the
+// target.
+constexpr double kHysteresisFactor = 1.1;
+
+// Controller state; only the background thread touches it.  seeded is false
+// until a baseline reading exists, and have_rate until a full interval has
+// elapsed and the EWMA holds a real observation.
+bool seeded = false;
+bool have_rate = false;
+absl::Time last_time;
+uint64_t last_count;
+double ewma_rate;
+
+}  // namespace
+
+void UpdateAdaptiveSamplingInterval(absl::Time now) {
+  const double target = Parameters::target_profile_samples_per_sec();
+  if (target <= 0) {
+    // Disabled; forget stale observations so a later enable starts fresh.
+    seeded = false;
+    have_rate = false;
+    return;
+  }
+
+  const uint64_t count = TotalSampledAllocationsRecorded();
+  if (!seeded) {
+    seeded = true;
+    last_time = now;
+    last_count = count;
+    return;
+  }
+
+  const double dt = absl::ToDoubleSeconds(now - last_time);
+  if (dt <= 0) {
+    return;
+  }
+  const double rate = static_cast<double>(count - last_count) / dt;
+  last_time = now;
+  last_count = count;
+  if (!have_rate) {
+    have_rate = true;
+    ewma_rate = rate;
+  } else {
+    ewma_rate = kEwmaWeight * rate + (1 - kEwmaWeight) * ewma_rate;
+  }
+
+  const int64_t current = Parameters::profile_sampling_rate();
+  if (current <= 0) {
+    // Sampling was disabled manually; not ours to re-enable.
+    return;
+  }
+  // The insertion rate is inversely proportional to the bytes-interval, so
+  // scaling the interval by observed/target lands the rate on the target in
+  // one step (modulo EWMA smoothing).  An idle phase (ewma_rate near zero)
+  // drives the interval to its floor, restoring resolution.
+  const double desired =
+      std::clamp(static_cast<double>(current) * (ewma_rate / target),
+                 static_cast<double>(kMinAdaptiveSamplingInterval),
+                 static_cast<double>(kMaxAdaptiveSamplingInterval));
+  if (desired < static_cast<double>(current) * kHysteresisFactor &&
+      desired * kHysteresisFactor > static_cast<double>(current)) {
+    return;
+  }
+  Parameters::set_profile_sampling_rate(std::llround(desired));
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,54 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Adaptive heap-profile sampling: a controller that steers the per-thread
+// bytes-interval (Parameters::profile_sampling_rate()) so that the sampled
+// allocation recorder takes a configured number of samples per second
+// process-wide.  A fixed interval over-samples allocation bursts and
+// under-samples idle phases; holding the samples/second rate constant keeps
+// heap-profile variance roughly uniform across load phases without manual
+// retuning.  The controller runs on the background thread and is enabled by
+// Parameters::set_target_profile_samples_per_sec(); it smooths the observed
+// insertion rate with an EWMA so transient spikes do not whipsaw the
+// interval.
+
+#ifndef TCMALLOC_ADAPTIVE_SAMPLING_H_
+#define TCMALLOC_ADAPTIVE_SAMPLING_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Bounds on the interval the controller will set, so a pathological rate
+// estimate can neither swamp the recorder nor effectively disable sampling.
+inline constexpr int64_t kMinAdaptiveSamplingInterval = 64 * 1024;
+inline constexpr int64_t kMaxAdaptiveSamplingInterval = int64_t{1} << 30;
+
+// Observes the recorder's insertion rate since the previous call and nudges
+// profile_sampling_rate() toward the samples-per-second target.  A no-op
+// when no target is set (which also resets the controller, so re-enabling
+// starts from fresh observations) or when sampling has been disabled
+// manually.  Must only be called from the background thread.
+void UpdateAdaptiveSamplingInterval(absl::Time now);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_ADAPTIVE_SAMPLING_H_
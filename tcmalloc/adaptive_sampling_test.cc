@@ -0,0 +1,100 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/adaptive_sampling.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Restores the sampling interval and disables the controller (which also
+// resets its observation state) when the test exits.
+class ScopedAdaptiveSampling {
+ public:
+  ScopedAdaptiveSampling(double target)
+      : previous_rate_(Parameters::profile_sampling_rate()) {
+    Parameters::set_target_profile_samples_per_sec(target);
+  }
+
+  ~ScopedAdaptiveSampling() {
+    Parameters::set_target_profile_samples_per_sec(0);
+    UpdateAdaptiveSamplingInterval(absl::Now());
+    Parameters::set_profile_sampling_rate(previous_rate_);
+  }
+
+ private:
+  int64_t previous_rate_;
+};
+
+TEST(AdaptiveSamplingTest, WidensIntervalWhenOverTarget) {
+  ScopedAdaptiveSampling adaptive(/*target=*/5.0);
+
+  const absl::Time t0 = absl::Now();
+  // First call only takes a baseline reading.
+  UpdateAdaptiveSamplingInterval(t0);
+
+  // Record samples at a rate far above the target.
+  {
+    ScopedProfileSamplingRate sampling_rate(1);
+    for (int i = 0; i < 10000; ++i) {
+      void* ptr = ::operator new(256);
+      benchmark::DoNotOptimize(ptr);
+      ::operator delete(ptr);
+    }
+  }
+
+  const int64_t before = Parameters::profile_sampling_rate();
+  UpdateAdaptiveSamplingInterval(t0 + absl::Seconds(1));
+  const int64_t after = Parameters::profile_sampling_rate();
+  EXPECT_GT(after, before);
+  EXPECT_LE(after, kMaxAdaptiveSamplingInterval);
+}
+
+TEST(AdaptiveSamplingTest, NarrowsIntervalWhenUnderTarget) {
+  ScopedAdaptiveSampling adaptive(/*target=*/100000.0);
+  constexpr int64_t kWideInterval = 64 << 20;
+  Parameters::set_profile_sampling_rate(kWideInterval);
+
+  // With no allocation burst between the readings, the observed rate is far
+  // below the target and the interval shrinks toward its floor.
+  const absl::Time t0 = absl::Now();
+  UpdateAdaptiveSamplingInterval(t0);
+  UpdateAdaptiveSamplingInterval(t0 + absl::Seconds(1));
+  const int64_t after = Parameters::profile_sampling_rate();
+  EXPECT_LT(after, kWideInterval);
+  EXPECT_GE(after, kMinAdaptiveSamplingInterval);
+}
+
+TEST(AdaptiveSamplingTest, DisabledControllerLeavesIntervalAlone) {
+  const int64_t before = Parameters::profile_sampling_rate();
+  const absl::Time t0 = absl::Now();
+  UpdateAdaptiveSamplingInterval(t0);
+  UpdateAdaptiveSamplingInterval(t0 + absl::Seconds(1));
+  EXPECT_EQ(Parameters::profile_sampling_rate(), before);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
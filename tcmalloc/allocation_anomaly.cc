@@ -0,0 +1,108 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/allocation_anomaly.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+ABSL_CONST_INIT std::atomic<AllocationAnomalyCallback> anomaly_callback{
+    nullptr};
+
+// Per-class baseline state; only the background thread reads or writes it.
+struct ClassBaseline {
+  // Cumulative per-class misses observed at the end of the last interval.
+  size_t last_total = 0;
+  // Exponentially weighted per-interval miss baseline.
+  double ewma = 0;
+  // Intervals observed so far, saturating at kWarmupIntervals.
+  int intervals = 0;
+  // True while the class is above the factor; fires on the rising edge only.
+  bool tripped = false;
+};
+ABSL_CONST_INIT ClassBaseline baselines[kNumClasses];
+
+// The baseline moves 1/8 of the way toward each new interval, so it absorbs
+// diurnal drift but lags a step change long enough to fire on it.
+constexpr double kEwmaAlpha = 0.125;
+
+// Intervals observed before a class's tripwire arms; until the baseline has
+// some history, every interval would look like a departure.
+constexpr int kWarmupIntervals = 8;
+
+// Interval miss counts below this never trip: for a near-idle class the
+// ratio against a tiny baseline is all noise.
+constexpr size_t kMinMissesToTrip = 64;
+
+}  // namespace
+
+AllocationAnomalyCallback SetAllocationAnomalyCallback(
+    AllocationAnomalyCallback callback) {
+  return anomaly_callback.exchange(callback, std::memory_order_acq_rel);
+}
+
+void CheckAllocationAnomalies(Static& state, double factor) {
+  AllocationAnomalyCallback callback =
+      anomaly_callback.load(std::memory_order_acquire);
+  if (callback == nullptr || factor <= 1.0 || !state.CpuCacheActive()) {
+    return;
+  }
+
+  for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
+    ClassBaseline& baseline = baselines[size_class];
+    const size_t total =
+        state.cpu_cache().GetTotalSizeClassMisses(size_class);
+    const size_t delta =
+        total >= baseline.last_total ? total - baseline.last_total : 0;
+    baseline.last_total = total;
+
+    if (baseline.intervals < kWarmupIntervals) {
+      baseline.ewma = baseline.intervals == 0
+                          ? static_cast<double>(delta)
+                          : baseline.ewma + kEwmaAlpha * (delta - baseline.ewma);
+      ++baseline.intervals;
+      continue;
+    }
+
+    const bool anomalous =
+        delta >= kMinMissesToTrip && delta > factor * baseline.ewma;
+    if (anomalous && !baseline.tripped) {
+      baseline.tripped = true;
+      AllocationAnomalyReport report;
+      report.size_class = size_class;
+      report.object_size = state.sizemap().class_to_size(size_class);
+      report.interval_misses = delta;
+      report.baseline_misses = baseline.ewma;
+      report.factor = factor;
+      callback(report);
+    } else if (!anomalous) {
+      baseline.tripped = false;
+    }
+    baseline.ewma += kEwmaAlpha * (delta - baseline.ewma);
+  }
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,71 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tripwire for allocation-size anomalies: a bug that suddenly allocates from
+// a much larger size class (a miscomputed length, a struct that grew 16x)
+// shifts that class's allocation rate far from its trailing baseline long
+// before RSS makes the regression visible.  The background thread compares
+// each size class's per-interval miss count -- the per-class counters the
+// cpu cache fast path already maintains, so detection adds no fast-path
+// instructions -- against an exponentially weighted baseline and fires a
+// registered callback when the rate departs it by a configured factor.
+
+#ifndef TCMALLOC_ALLOCATION_ANOMALY_H_
+#define TCMALLOC_ALLOCATION_ANOMALY_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+class Static;
+
+struct AllocationAnomalyReport {
+  // The size class whose rate departed its baseline, and its object size.
+  size_t size_class = 0;
+  size_t object_size = 0;
+  // Misses recorded for the class during the interval that tripped.
+  size_t interval_misses = 0;
+  // The class's baseline per-interval miss count at the time it tripped.
+  double baseline_misses = 0;
+  // The configured departure factor that was exceeded.
+  double factor = 0;
+};
+
+// Invoked on the background thread when a size class trips.  The callback
+// delays all other background actions until it returns.
+using AllocationAnomalyCallback = void (*)(const AllocationAnomalyReport&);
+
+// Registers <callback> to receive anomaly reports (nullptr disables the
+// tripwire).  Returns the previously registered callback.
+AllocationAnomalyCallback SetAllocationAnomalyCallback(
+    AllocationAnomalyCallback callback);
+
+// Advances every size class's baseline by one interval and fires the
+// registered callback for classes whose interval miss count exceeds <factor>
+// times their baseline.  Edge-triggered per class: once fired, a class only
+// re-fires after an interval back under the factor.  The baseline keeps
+// tracking through an excursion, so a sustained shift becomes the new normal
+// after a few intervals rather than firing forever.  Must only be called
+// from the background thread.
+void CheckAllocationAnomalies(Static& state, double factor);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_ALLOCATION_ANOMALY_H_
@@ -0,0 +1,87 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/allocation_anomaly.h"
+
+#include <stddef.h>
+
+#include <new>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/static_vars.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+AllocationAnomalyReport last_report;
+int fire_count = 0;
+
+void RecordReport(const AllocationAnomalyReport& report) {
+  last_report = report;
+  ++fire_count;
+}
+
+TEST(AllocationAnomalyTest, FiresOnRateDeparture) {
+  if (!tc_globals.CpuCacheActive()) {
+    GTEST_SKIP() << "per-cpu caches inactive";
+  }
+
+  constexpr double kFactor = 4.0;
+
+  AllocationAnomalyCallback previous =
+      SetAllocationAnomalyCallback(RecordReport);
+  EXPECT_EQ(previous, nullptr);
+
+  // Let every class's baseline warm up while the process is quiet; nothing
+  // may fire during warmup.
+  for (int i = 0; i < 16; ++i) {
+    CheckAllocationAnomalies(tc_globals, kFactor);
+  }
+  EXPECT_EQ(fire_count, 0);
+
+  // Drive a burst of allocations through one large size class; each cpu
+  // cache refill records a miss for the class, so the burst shifts its rate
+  // far from the idle baseline.
+  constexpr size_t kItemSize = 8192;
+  std::vector<void*> ptrs;
+  ptrs.reserve(1 << 15);
+  for (int i = 0; i < (1 << 15); ++i) {
+    ptrs.push_back(::operator new(kItemSize));
+  }
+  for (void* ptr : ptrs) {
+    ::operator delete(ptr);
+  }
+
+  CheckAllocationAnomalies(tc_globals, kFactor);
+  ASSERT_GE(fire_count, 1);
+  EXPECT_GT(last_report.size_class, 0);
+  EXPECT_GT(last_report.object_size, 0);
+  EXPECT_GT(last_report.interval_misses,
+            kFactor * last_report.baseline_misses);
+  EXPECT_EQ(last_report.factor, kFactor);
+
+  // Edge-triggered: a quiet interval does not re-fire the tripped classes.
+  const int fired = fire_count;
+  CheckAllocationAnomalies(tc_globals, kFactor);
+  CheckAllocationAnomalies(tc_globals, kFactor);
+  EXPECT_EQ(fire_count, fired);
+
+  SetAllocationAnomalyCallback(previous);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
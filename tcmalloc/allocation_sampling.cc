@@ -14,6 +14,9 @@
 
 #include "tcmalloc/allocation_sampling.h"
 
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <atomic>
 #include <cmath>
@@ -30,11 +33,14 @@
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/experiment.h"
+#include "tcmalloc/experiment_config.h"
 #include "tcmalloc/guarded_allocations.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/exponential_biased.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/sampled_allocation.h"
+#include "tcmalloc/internal/stacktrace_filter.h"
 #include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/pagemap.h"
 #include "tcmalloc/pages.h"
@@ -47,6 +53,17 @@
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc::tcmalloc_internal {
 
+namespace {
+// Monotone count of sampled allocations registered with the recorder; the
+// adaptive sampling controller differentiates it to estimate the sampling
+// rate.  See TotalSampledAllocationsRecorded().
+ABSL_CONST_INIT std::atomic<uint64_t> total_samples_recorded{0};
+}  // namespace
+
+uint64_t TotalSampledAllocationsRecorded() {
+  return total_samples_recorded.load(std::memory_order_relaxed);
+}
+
 std::unique_ptr<const ProfileBase> DumpFragmentationProfile(Static& state) {
   auto profile = std::make_unique<StackTraceTable>(ProfileType::kFragmentation);
   state.sampled_allocation_recorder().Iterate(
@@ -90,6 +107,57 @@ std::unique_ptr<const ProfileBase> DumpHeapProfile(Static& state) {
   return profile;
 }
 
+std::unique_ptr<const ProfileBase> DumpHeapProfileSince(Static& state,
+                                                        AllocHandle since,
+                                                        AllocHandle* now) {
+  // Samples registered or freed while we iterate draw a generation above
+  // `snapshot_gen`; they are excluded here and picked up by the next delta.
+  const AllocHandle snapshot_gen =
+      state.sampled_alloc_handle_generator.load(std::memory_order_relaxed);
+  auto profile = std::make_unique<StackTraceTable>(ProfileType::kHeap);
+  if (since != 0 && state.sampled_recycled_death_generation.load(
+                        std::memory_order_acquire) > since) {
+    *now = 0;
+    return profile;
+  }
+  state.sampled_allocation_recorder().Iterate(
+      [&](const SampledAllocation& sampled_allocation, bool live) {
+        const StackTrace& t = sampled_allocation.sampled_stack;
+        if (live) {
+          if (t.sampled_alloc_handle > since &&
+              t.sampled_alloc_handle <= snapshot_gen) {
+            profile->AddTrace(1.0, t);
+          }
+          return;
+        }
+        const AllocHandle death = sampled_allocation.death_generation.load(
+            std::memory_order_relaxed);
+        // A sample both registered and freed within the window nets out to
+        // nothing and is skipped entirely.
+        if (death > since && death <= snapshot_gen &&
+            t.sampled_alloc_handle <= since) {
+          profile->AddRemovedTrace(1.0, t);
+        } else if (t.sampled_alloc_handle > since &&
+                   t.sampled_alloc_handle <= snapshot_gen &&
+                   death > snapshot_gen) {
+          // Born in this window and still live when snapshot_gen was read,
+          // but freed before Iterate reached it.  The next delta reports the
+          // free, so the allocation must be reported here or the composed
+          // profile goes permanently negative for this trace.
+          profile->AddTrace(1.0, t);
+        }
+      });
+  // A record of a free we needed may have been recycled while we iterated;
+  // the profile built above would silently miss that free, so discard it.
+  if (since != 0 && state.sampled_recycled_death_generation.load(
+                        std::memory_order_acquire) > since) {
+    *now = 0;
+    return std::make_unique<StackTraceTable>(ProfileType::kHeap);
+  }
+  *now = snapshot_gen;
+  return profile;
+}
+
 template <typename State>
 ABSL_ATTRIBUTE_NOINLINE static inline void FreeProxyObject(State& state,
                                                            void* ptr,
@@ -111,6 +179,18 @@ ABSL_ATTRIBUTE_NOINLINE static inline void FreeProxyObject(State& state,
 // For very small object sizes, object is used as 'proxy' and full
 // page with sampled marked is allocated instead.
 //
+// Returns the NUMA node of the CPU we are currently executing on, or -1 if
+// the kernel cannot tell us (e.g. no NUMA support).  We invoke getcpu(2)
+// directly since glibc's wrapper discards the node.  This is only used on the
+// sampling slow path, so the cost of the raw syscall is acceptable.
+static int CurrentNumaNode() {
+  unsigned int node;
+  if (syscall(__NR_getcpu, nullptr, &node, nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<int>(node);
+}
+
 // For medium-sized objects that have single instance per span,
 // they're simply freed and fresh page span is allocated to represent
 // sampling.
@@ -165,7 +245,7 @@ sized_ptr_t SampleifyAllocation(Static& state, size_t requested_size,
 
     Length num_pages = BytesToLengthCeil(stack_trace.allocated_size);
     alloc_with_status = state.guardedpage_allocator().TrySample(
-        requested_size, stack_trace.requested_alignment, num_pages,
+        requested_size, stack_trace.requested_alignment, num_pages, size_class,
         stack_trace);
     if (alloc_with_status.status == Profile::Sample::GuardedStatus::Guarded) {
       ASSERT(!IsNormalMemory(alloc_with_status.alloc));
@@ -222,6 +302,7 @@ sized_ptr_t SampleifyAllocation(Static& state, size_t requested_size,
       1;
   stack_trace.span_start_address = span->start_address();
   stack_trace.allocation_time = absl::Now();
+  stack_trace.allocating_numa_node = CurrentNumaNode();
   stack_trace.guarded_status = static_cast<int>(alloc_with_status.status);
 
   // How many allocations does this sample represent, given the sampling
@@ -229,6 +310,15 @@ sized_ptr_t SampleifyAllocation(Static& state, size_t requested_size,
   const double allocation_estimate =
       static_cast<double>(weight) / (requested_size + 1);
 
+  // Accumulate the extrapolated requested vs. granted traffic per size
+  // class; global_stats joins this with span residency to rank the classes
+  // worth regenerating.
+  if (size_class != 0) {
+    state.class_fragmentation().Record(
+        size_class, allocation_estimate * requested_size,
+        allocation_estimate * stack_trace.allocated_size);
+  }
+
   // Adjust our estimate of internal fragmentation.
   TC_ASSERT_LE(requested_size, stack_trace.allocated_size);
   if (requested_size < stack_trace.allocated_size) {
@@ -236,15 +326,54 @@ sized_ptr_t SampleifyAllocation(Static& state, size_t requested_size,
         allocation_estimate * (stack_trace.allocated_size - requested_size));
   }
 
+  // Credit experiments that replaced the size class tables with this sample's
+  // estimated traffic.  Every size class allocation is served through the
+  // experimental tables, so the extrapolated sample counts are the
+  // experiment's impact.
+  if (size_class != 0) {
+    for (Experiment exp : {Experiment::TEST_ONLY_TCMALLOC_POW2_SIZECLASS,
+                           Experiment::TEST_ONLY_TCMALLOC_LOWFRAG_SIZECLASSES}) {
+      if (IsExperimentActive(exp)) {
+        RecordExperimentImpact(
+            exp, allocation_estimate,
+            allocation_estimate * stack_trace.allocated_size);
+      }
+    }
+  }
+
   state.allocation_samples.ReportMalloc(stack_trace);
 
   state.deallocation_samples.ReportMalloc(stack_trace);
 
+  // Charge the extrapolated live bytes to the site's sketch entry, keyed by
+  // the same hash the recorder shards by.
+  const size_t site_hash = HashOfStackTrace(stack_trace);
+  state.allocation_site_sketch().RecordAlloc(
+      site_hash, allocation_estimate * stack_trace.allocated_size,
+      std::max<size_t>(allocation_estimate + 0.5, 1));
+
   // The SampledAllocation object is visible to readers after this. Readers only
   // care about its various metadata (e.g. stack trace, weight) to generate the
   // heap profile, and won't need any information from Span::Sample() next.
   SampledAllocation* sampled_allocation =
-      state.sampled_allocation_recorder().Register(std::move(stack_trace));
+      state.sampled_allocation_recorder().RegisterOnShard(
+          site_hash, std::move(stack_trace));
+  total_samples_recorded.fetch_add(1, std::memory_order_relaxed);
+  // If this SampledAllocation was revived from the freelist, the record of
+  // the free it used to describe is gone: incremental heap profiles against
+  // generations that predate that free can no longer be completed.
+  const AllocHandle recycled_death =
+      sampled_allocation->death_generation.load(std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(recycled_death != 0)) {
+    AllocHandle expected =
+        state.sampled_recycled_death_generation.load(std::memory_order_relaxed);
+    while (expected < recycled_death &&
+           !state.sampled_recycled_death_generation.compare_exchange_weak(
+               expected, recycled_death, std::memory_order_release,
+               std::memory_order_relaxed)) {
+    }
+    sampled_allocation->death_generation.store(0, std::memory_order_relaxed);
+  }
   // No pageheap_lock required. The span is freshly allocated and no one else
   // can access it. It is visible after we return from this allocation path.
   span->Sample(sampled_allocation);
@@ -288,6 +417,21 @@ void MaybeUnsampleAllocation(Static& state, void* ptr, Span* span) {
         static_cast<double>(weight) / (requested_size + 1);
     AllocHandle sampled_alloc_handle =
         sampled_allocation->sampled_stack.sampled_alloc_handle;
+    // Stamp the free before the sample reaches the freelist so that
+    // DumpHeapProfileSince() can report it.  The generation is drawn from the
+    // same counter as sampled_alloc_handle so registrations and frees are
+    // ordered against each other.
+    sampled_allocation->death_generation.store(
+        state.sampled_alloc_handle_generator.fetch_add(
+            1, std::memory_order_relaxed) +
+            1,
+        std::memory_order_relaxed);
+    // Return the bytes SampleifyAllocation charged to the site's sketch
+    // entry; both sides extrapolate from the same weight, so they cancel.
+    state.allocation_site_sketch().RecordFree(
+        HashOfStackTrace(sampled_allocation->sampled_stack),
+        allocation_estimate * allocated_size,
+        std::max<size_t>(allocation_estimate + 0.5, 1));
     state.sampled_allocation_recorder().Unregister(sampled_allocation);
 
     // Adjust our estimate of internal fragmentation.
@@ -315,6 +459,11 @@ void MaybeUnsampleAllocation(Static& state, void* ptr, Span* span) {
             policy.AccessAsHot().AlignAs(alignment), allocated_size);
       }
       ASSERT(size_class == state.pagemap().sizeclass(PageIdContaining(proxy)));
+      // The sampled object had a size class (it carries a proxy), so its
+      // death teaches us how long this class's objects live.
+      state.class_lifetimes().RecordDeath(
+          size_class,
+          absl::Now() - sampled_allocation->sampled_stack.allocation_time);
       FreeProxyObject(state, proxy, size_class);
     }
   }
@@ -16,10 +16,12 @@
 #define TCMALLOC_ALLOCATION_SAMPLING_H_
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "absl/base/attributes.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/percpu.h"
 #include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/sampler.h"
@@ -41,8 +43,25 @@ class Static;
 // thus prevents the central free list to return the span to the page heap.
 std::unique_ptr<const ProfileBase> DumpFragmentationProfile(Static& state);
 
+// Monotone count of sampled allocations registered with the sampled
+// allocation recorder since startup.  The adaptive sampling controller
+// (adaptive_sampling.h) differentiates successive readings to estimate the
+// process-wide sampling rate.
+uint64_t TotalSampledAllocationsRecorded();
+
 std::unique_ptr<const ProfileBase> DumpHeapProfile(Static& state);
 
+// Computes an incremental heap profile: samples registered since generation
+// `since` are emitted normally, and samples freed since `since` are emitted
+// with negated count and sum.  `since` == 0 requests a full profile.  On
+// return, `*now` holds the generation the profile is current to, or 0 if the
+// record of a free needed for the delta has been recycled, in which case the
+// returned profile is empty and the caller should start over with a full
+// profile.
+std::unique_ptr<const ProfileBase> DumpHeapProfileSince(Static& state,
+                                                        AllocHandle since,
+                                                        AllocHandle* now);
+
 extern "C" ABSL_CONST_INIT thread_local Sampler tcmalloc_sampler
     ABSL_ATTRIBUTE_INITIAL_EXEC;
 
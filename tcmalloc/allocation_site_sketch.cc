@@ -0,0 +1,112 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/allocation_site_sketch.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "absl/types/span.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+size_t AllocationSiteSketch::Index(size_t site_hash, size_t row) {
+  // Derive per-row indices by finalizing the hash with a row-dependent
+  // stride; the inputs are already absl-hashed, so a cheap mix suffices.
+  size_t h = site_hash + (row + 1) * size_t{0x9E3779B97F4A7C15};
+  h ^= h >> 33;
+  h *= size_t{0xFF51AFD7ED558CCD};
+  h ^= h >> 29;
+  return h % kWidth;
+}
+
+auto AllocationSiteSketch::Estimate(size_t site_hash) const -> SiteStats {
+  SiteStats estimate;
+  estimate.site_hash = site_hash;
+  for (size_t row = 0; row < kDepth; ++row) {
+    const size_t i = Index(site_hash, row);
+    if (row == 0) {
+      estimate.live_bytes = bytes_[row][i];
+      estimate.count = count_[row][i];
+    } else {
+      estimate.live_bytes = std::min(estimate.live_bytes, bytes_[row][i]);
+      estimate.count = std::min(estimate.count, count_[row][i]);
+    }
+  }
+  return estimate;
+}
+
+void AllocationSiteSketch::UpdateTop(size_t site_hash) {
+  const SiteStats estimate = Estimate(site_hash);
+  size_t lightest = 0;
+  for (size_t i = 0; i < kTopSites; ++i) {
+    if (top_[i].site_hash == site_hash) {
+      top_[i] = estimate;
+      return;
+    }
+    if (top_[i].live_bytes < top_[lightest].live_bytes) {
+      lightest = i;
+    }
+  }
+  if (estimate.live_bytes > top_[lightest].live_bytes) {
+    top_[lightest] = estimate;
+  }
+}
+
+void AllocationSiteSketch::RecordAlloc(size_t site_hash, size_t bytes,
+                                       size_t count) {
+  AllocationGuardSpinLockHolder h(&lock_);
+  for (size_t row = 0; row < kDepth; ++row) {
+    const size_t i = Index(site_hash, row);
+    bytes_[row][i] += bytes;
+    count_[row][i] += count;
+  }
+  UpdateTop(site_hash);
+}
+
+void AllocationSiteSketch::RecordFree(size_t site_hash, size_t bytes,
+                                      size_t count) {
+  AllocationGuardSpinLockHolder h(&lock_);
+  for (size_t row = 0; row < kDepth; ++row) {
+    const size_t i = Index(site_hash, row);
+    bytes_[row][i] -= std::min(bytes_[row][i], bytes);
+    count_[row][i] -= std::min(count_[row][i], count);
+  }
+  UpdateTop(site_hash);
+}
+
+size_t AllocationSiteSketch::Snapshot(absl::Span<SiteStats> sites) const {
+  SiteStats top[kTopSites];
+  {
+    AllocationGuardSpinLockHolder h(&lock_);
+    std::copy(top_, top_ + kTopSites, top);
+  }
+  std::sort(top, top + kTopSites, [](const SiteStats& a, const SiteStats& b) {
+    return a.live_bytes > b.live_bytes;
+  });
+  size_t n = 0;
+  for (const SiteStats& site : top) {
+    if (n == sites.size() || site.live_bytes == 0) break;
+    sites[n++] = site;
+  }
+  return n;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,99 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Constant-memory ranking of the heaviest allocation sites.  Full heap
+// profiles are too large for always-on periodic collection at fleet scale;
+// this keeps a count-min sketch of extrapolated live bytes and allocation
+// counts per site -- keyed by the stack trace hash the sampling path already
+// computes -- plus a small table of the heaviest sites by live bytes.  A
+// snapshot of the table is a few hundred bytes, cheap enough to scrape every
+// minute from every process.
+
+#ifndef TCMALLOC_ALLOCATION_SITE_SKETCH_H_
+#define TCMALLOC_ALLOCATION_SITE_SKETCH_H_
+
+#include <cstddef>
+
+#include "absl/base/const_init.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/types/span.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+class AllocationSiteSketch {
+ public:
+  struct SiteStats {
+    size_t site_hash = 0;   // HashOfStackTrace of the allocating stack.
+    size_t live_bytes = 0;  // Extrapolated live bytes charged to the site.
+    size_t count = 0;       // Extrapolated live allocation count.
+  };
+
+  // Number of sites the top table retains.
+  static constexpr size_t kTopSites = 32;
+
+  constexpr AllocationSiteSketch()
+      : lock_(absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY) {}
+
+  // Charges <bytes> live bytes and <count> allocations (both already
+  // extrapolated by the sample's weight) to <site_hash>, and promotes the
+  // site into the top table if it now outweighs the lightest entry.  Called
+  // from the allocation sampling slow path.
+  void RecordAlloc(size_t site_hash, size_t bytes, size_t count);
+
+  // Returns <bytes>/<count> previously charged to <site_hash>.  Estimates
+  // saturate at zero, so a collision-inflated free cannot drive a neighbor
+  // negative.
+  void RecordFree(size_t site_hash, size_t bytes, size_t count);
+
+  // Copies the heaviest sites into <sites>, ordered by live bytes
+  // descending, and returns the number written: at most kTopSites, fewer
+  // when the table holds fewer live sites or <sites> is smaller.
+  size_t Snapshot(absl::Span<SiteStats> sites) const;
+
+ private:
+  // Sketch geometry.  A site's estimate is the minimum across kDepth rows,
+  // so it is exact unless the site collides in every row; with a few hundred
+  // sampled sites live at once that is vanishingly rare.  Memory is
+  // kDepth * kWidth * 2 counters, 32 KiB total, regardless of site count.
+  static constexpr size_t kDepth = 4;
+  static constexpr size_t kWidth = 512;
+
+  static size_t Index(size_t site_hash, size_t row);
+
+  // Sketch estimate (minimum across rows) for <site_hash>.
+  SiteStats Estimate(size_t site_hash) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Re-reads <site_hash>'s estimate and installs it in the top table if the
+  // site is already present or outweighs the lightest entry.
+  void UpdateTop(size_t site_hash) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  mutable absl::base_internal::SpinLock lock_;
+
+  // Counters are plain rather than atomic: every access happens under lock_,
+  // which is only taken on the sampling slow path and in snapshots.
+  size_t bytes_[kDepth][kWidth] ABSL_GUARDED_BY(lock_) = {};
+  size_t count_[kDepth][kWidth] ABSL_GUARDED_BY(lock_) = {};
+  SiteStats top_[kTopSites] ABSL_GUARDED_BY(lock_) = {};
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_ALLOCATION_SITE_SKETCH_H_
@@ -0,0 +1,354 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/allocation_trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
+#include "absl/base/internal/cycleclock.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/optimization.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/sysinfo.h"
+#include "tcmalloc/internal/util.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+namespace allocation_trace_internal {
+ABSL_CONST_INIT std::atomic<bool> trace_enabled{false};
+}  // namespace allocation_trace_internal
+
+namespace {
+
+using allocation_trace_internal::trace_enabled;
+
+// Sized so a reader draining once per second keeps up with ~25k sampled
+// events/s/cpu at the typical ~10 bytes per packed event.
+constexpr size_t kTraceRingBytes = 256 * 1024;
+// Precedes every drained chunk in the output file (format version 2), so
+// consumers can demux the per-ring event streams.  Distinct from the 0/1
+// alloc/free op bytes that start each event.
+constexpr char kFrameMarker = 2;
+// The output file is extended and mapped one window at a time.
+constexpr size_t kTraceFileWindowBytes = 1 << 20;
+
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t sample_interval;
+};
+
+// One ring per CPU.  Producers only TryLock, so they never block an
+// allocation; the reader holds the lock while copying out, and a producer
+// arriving meanwhile records a drop instead of spinning.
+struct TraceRing {
+  absl::base_internal::SpinLock lock{absl::base_internal::SCHEDULE_KERNEL_ONLY};
+  // Byte positions; both grow without bound and are reduced mod
+  // kTraceRingBytes on access, so head - tail is the unread length.
+  size_t head = 0;
+  size_t tail = 0;
+  // Delta-encoding state, guarded by lock.
+  uintptr_t last_addr = 0;
+  int64_t last_cycles = 0;
+  std::atomic<uint64_t> drops{0};
+  char* buf = nullptr;
+};
+
+// Guards session state (start/stop/drain) and the file window below.
+ABSL_CONST_INIT absl::base_internal::SpinLock session_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+// Once allocated, the rings are never freed: a producer racing a Stop may
+// still hold a pointer to them, and they are reused by the next session.
+TraceRing* rings = nullptr;
+int num_rings = 0;
+
+ABSL_CONST_INIT std::atomic<uint64_t> sample_interval_{1};
+ABSL_CONST_INIT std::atomic<uint64_t> events_recorded_{0};
+ABSL_CONST_INIT std::atomic<uint64_t> reader_drops_{0};
+
+int trace_fd = -1;
+char* window = nullptr;
+size_t window_used = 0;
+size_t file_offset = 0;
+
+size_t EncodeVarint(uint64_t value, char* out) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = static_cast<char>(value);
+  return n;
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+bool MapNextWindow() {
+  if (ftruncate(trace_fd, file_offset + kTraceFileWindowBytes) != 0) {
+    return false;
+  }
+  void* m = mmap(nullptr, kTraceFileWindowBytes, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, trace_fd, file_offset);
+  if (m == MAP_FAILED) {
+    return false;
+  }
+  window = static_cast<char*>(m);
+  window_used = 0;
+  return true;
+}
+
+// Appends bytes to the memory-mapped output file, remapping the window as it
+// fills.  Returns false (and leaves the window unmapped) on I/O errors.
+bool FlushBytes(const char* data, size_t n) {
+  while (n > 0) {
+    if (window == nullptr) {
+      return false;
+    }
+    if (window_used == kTraceFileWindowBytes) {
+      munmap(window, kTraceFileWindowBytes);
+      window = nullptr;
+      file_offset += kTraceFileWindowBytes;
+      if (!MapNextWindow()) {
+        return false;
+      }
+    }
+    const size_t chunk = std::min(n, kTraceFileWindowBytes - window_used);
+    memcpy(window + window_used, data, chunk);
+    window_used += chunk;
+    data += chunk;
+    n -= chunk;
+  }
+  return true;
+}
+
+void DrainLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(session_lock) {
+  for (int i = 0; i < num_rings; ++i) {
+    TraceRing& ring = rings[i];
+    // Producers TryLock, so holding the ring lock across the copy (which may
+    // fault on the file mapping) costs drops, not latency.
+    absl::base_internal::SpinLockHolder l(&ring.lock);
+    while (ring.tail != ring.head) {
+      const size_t pos = ring.tail % kTraceRingBytes;
+      const size_t chunk =
+          std::min(ring.head - ring.tail, kTraceRingBytes - pos);
+      // Frame the chunk with its ring so consumers can reassemble per-ring
+      // streams; an event split by ring wraparound continues in the next
+      // frame for the same ring.
+      char frame[1 + 2 * 10];
+      size_t frame_len = 0;
+      frame[frame_len++] = kFrameMarker;
+      frame_len += EncodeVarint(i, frame + frame_len);
+      frame_len += EncodeVarint(chunk, frame + frame_len);
+      if (!FlushBytes(frame, frame_len) ||
+          !FlushBytes(ring.buf + pos, chunk)) {
+        // The file is gone; discard so producers don't pile up drops.
+        reader_drops_.fetch_add(1, std::memory_order_relaxed);
+        ring.tail = ring.head;
+        break;
+      }
+      ring.tail += chunk;
+    }
+  }
+}
+
+void TraceEvent(bool is_free, const void* ptr, size_t size,
+                size_t size_class) {
+  const uint64_t interval = sample_interval_.load(std::memory_order_relaxed);
+  if (interval > 1) {
+    ABSL_CONST_INIT thread_local uint64_t pending = 0;
+    if (++pending < interval) {
+      return;
+    }
+    pending = 0;
+  }
+  TraceRing* all_rings = rings;
+  if (ABSL_PREDICT_FALSE(all_rings == nullptr)) {
+    return;
+  }
+  const int cpu = sched_getcpu();
+  TraceRing& ring = all_rings[cpu >= 0 ? cpu % num_rings : 0];
+  if (!ring.lock.TryLock()) {
+    ring.drops.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Event layout: op byte, then varints for size class, zigzag address delta,
+  // size (allocations only), and timestamp delta in cycles.
+  char buf[1 + 5 * 10];
+  size_t len = 0;
+  buf[len++] = is_free ? 1 : 0;
+  len += EncodeVarint(size_class, buf + len);
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+  len += EncodeVarint(ZigZag(static_cast<int64_t>(addr - ring.last_addr)),
+                      buf + len);
+  if (!is_free) {
+    len += EncodeVarint(size, buf + len);
+  }
+  const int64_t now = absl::base_internal::CycleClock::Now();
+  len += EncodeVarint(static_cast<uint64_t>(now - ring.last_cycles), buf + len);
+
+  if (kTraceRingBytes - (ring.head - ring.tail) < len) {
+    ring.drops.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    for (size_t i = 0; i < len; ++i) {
+      ring.buf[(ring.head + i) % kTraceRingBytes] = buf[i];
+    }
+    ring.head += len;
+    ring.last_addr = addr;
+    ring.last_cycles = now;
+    events_recorded_.fetch_add(1, std::memory_order_relaxed);
+  }
+  ring.lock.Unlock();
+}
+
+}  // namespace
+
+void TraceAllocation(const void* ptr, size_t size, size_t size_class) {
+  TraceEvent(/*is_free=*/false, ptr, size, size_class);
+}
+
+void TraceDeallocation(const void* ptr, size_t size_class) {
+  TraceEvent(/*is_free=*/true, ptr, /*size=*/0, size_class);
+}
+
+int StartAllocationTrace(const char* path, int sample_interval) {
+  if (path == nullptr || sample_interval < 1) {
+    return EINVAL;
+  }
+  AllocationGuardSpinLockHolder h(&session_lock);
+  if (trace_enabled.load(std::memory_order_relaxed)) {
+    return EBUSY;
+  }
+
+  if (rings == nullptr) {
+    const int n = NumCPUs();
+    const size_t total = n * (sizeof(TraceRing) + kTraceRingBytes);
+    void* m = mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED) {
+      return ENOMEM;
+    }
+    char* base = static_cast<char*>(m);
+    TraceRing* r = reinterpret_cast<TraceRing*>(base);
+    char* bufs = base + n * sizeof(TraceRing);
+    for (int i = 0; i < n; ++i) {
+      new (&r[i]) TraceRing;
+      r[i].buf = bufs + i * kTraceRingBytes;
+    }
+    num_rings = n;
+    rings = r;
+  } else {
+    for (int i = 0; i < num_rings; ++i) {
+      absl::base_internal::SpinLockHolder l(&rings[i].lock);
+      rings[i].head = rings[i].tail = 0;
+      rings[i].last_addr = 0;
+      rings[i].last_cycles = 0;
+      rings[i].drops.store(0, std::memory_order_relaxed);
+    }
+  }
+  events_recorded_.store(0, std::memory_order_relaxed);
+  reader_drops_.store(0, std::memory_order_relaxed);
+
+  const int fd = signal_safe_open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return errno != 0 ? errno : EIO;
+  }
+  trace_fd = fd;
+  file_offset = 0;
+  window = nullptr;
+  window_used = 0;
+  if (!MapNextWindow()) {
+    const int err = errno != 0 ? errno : EIO;
+    signal_safe_close(trace_fd);
+    trace_fd = -1;
+    return err;
+  }
+
+  TraceFileHeader header = {};
+  memcpy(header.magic, "TCMTRACE", sizeof(header.magic));
+  header.version = 2;
+  header.sample_interval = static_cast<uint32_t>(sample_interval);
+  FlushBytes(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  sample_interval_.store(sample_interval, std::memory_order_relaxed);
+  trace_enabled.store(true, std::memory_order_release);
+  return 0;
+}
+
+void DrainAllocationTrace() {
+  AllocationGuardSpinLockHolder h(&session_lock);
+  if (!trace_enabled.load(std::memory_order_relaxed)) {
+    return;
+  }
+  DrainLocked();
+}
+
+int StopAllocationTrace() {
+  AllocationGuardSpinLockHolder h(&session_lock);
+  if (!trace_enabled.load(std::memory_order_relaxed)) {
+    return EINVAL;
+  }
+  // Producers already in TraceEvent may still append a few events; they land
+  // in the rings and are discarded when the next session resets them.
+  trace_enabled.store(false, std::memory_order_relaxed);
+  DrainLocked();
+  if (window != nullptr) {
+    munmap(window, kTraceFileWindowBytes);
+    window = nullptr;
+  }
+  int err = 0;
+  if (ftruncate(trace_fd, file_offset + window_used) != 0) {
+    err = errno != 0 ? errno : EIO;
+  }
+  signal_safe_close(trace_fd);
+  trace_fd = -1;
+  return err;
+}
+
+AllocationTraceStats GetAllocationTraceStats() {
+  AllocationGuardSpinLockHolder h(&session_lock);
+  AllocationTraceStats stats = {};
+  stats.events_recorded = events_recorded_.load(std::memory_order_relaxed);
+  stats.events_dropped = reader_drops_.load(std::memory_order_relaxed);
+  for (int i = 0; i < num_rings; ++i) {
+    stats.events_dropped += rings[i].drops.load(std::memory_order_relaxed);
+  }
+  stats.bytes_written = file_offset + window_used;
+  return stats;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,89 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Opt-in capture of temporal allocation traces.  While enabled, sampled
+// alloc/free events (address, size, size class, timestamp delta) are recorded
+// into per-CPU rings, varint-packed, and drained to a memory-mapped file by a
+// reader thread.  Producers never block: a contended or full ring increments
+// a drop counter instead.  Drained chunks are framed with their ring index
+// (format version 2), so consumers can reassemble per-ring streams and
+// attribute events to the CPU that recorded them.  Traces feed offline
+// tooling such as the fragmentation simulator and testing/trace_replay.
+
+#ifndef TCMALLOC_ALLOCATION_TRACE_H_
+#define TCMALLOC_ALLOCATION_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace allocation_trace_internal {
+
+extern std::atomic<bool> trace_enabled;
+
+}  // namespace allocation_trace_internal
+
+// Returns true while a trace session is active.  Checked on allocation slow
+// paths; enabling tracing also uncaches the per-cpu slab (via
+// Static::HaveHooks) so fast-path operations funnel through them.
+inline bool ABSL_ATTRIBUTE_ALWAYS_INLINE AllocationTraceEnabled() {
+  return ABSL_PREDICT_FALSE(allocation_trace_internal::trace_enabled.load(
+      std::memory_order_relaxed));
+}
+
+// Records one event.  size_class is 0 for page-level (non-size-class)
+// allocations; size is ignored for frees (the trace consumer derives it from
+// the matching allocation).  REQUIRES: AllocationTraceEnabled().
+void TraceAllocation(const void* ptr, size_t size, size_t size_class);
+void TraceDeallocation(const void* ptr, size_t size_class);
+
+// Counters for the current (or last) trace session.
+struct AllocationTraceStats {
+  uint64_t events_recorded;
+  // Events lost to a full or contended ring, or to a lagging reader.
+  uint64_t events_dropped;
+  // Bytes drained to the trace file so far.
+  uint64_t bytes_written;
+};
+
+// Begins writing a trace to the file at path, recording one in
+// sample_interval events (>= 1; 64 keeps overhead under ~2% at allocation
+// rates of tens of millions of operations per second).  Returns 0 on success
+// or an errno value; EBUSY if a session is already active.
+int StartAllocationTrace(const char* path, int sample_interval);
+
+// Drains all per-CPU rings to the trace file.  Intended to be called
+// periodically from a dedicated reader thread; the background thread also
+// drains opportunistically.  No-op if tracing is not active.
+void DrainAllocationTrace();
+
+// Ends the trace session: stops recording, performs a final drain, trims and
+// closes the file.  Returns 0 on success or an errno value.
+int StopAllocationTrace();
+
+AllocationTraceStats GetAllocationTraceStats();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_ALLOCATION_TRACE_H_
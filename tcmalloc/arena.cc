@@ -32,43 +32,81 @@ namespace tcmalloc_internal {
 void* Arena::Alloc(size_t bytes, std::align_val_t alignment) {
   size_t align = static_cast<size_t>(alignment);
   TC_ASSERT_GT(align, 0);
+  // Carve from the current NUMA partition's region so the backing pages are
+  // first-touched, and therefore placed, on the allocating thread's node.
+  // GetCurrentPartition() returns 0 before the topology is initialized and
+  // whenever NUMA awareness is disabled.
+  Region& region = regions_[tc_globals.numa_topology().GetCurrentPartition()];
   {  // First we need to move up to the correct alignment.
-    const int misalignment = reinterpret_cast<uintptr_t>(free_area_) % align;
+    const int misalignment =
+        reinterpret_cast<uintptr_t>(region.free_area) % align;
     const int alignment_bytes = misalignment != 0 ? align - misalignment : 0;
-    free_area_ += alignment_bytes;
-    free_avail_ -= alignment_bytes;
+    region.free_area += alignment_bytes;
+    region.free_avail -= alignment_bytes;
     bytes_allocated_ += alignment_bytes;
   }
   char* result;
-  if (free_avail_ < bytes) {
+  if (region.free_avail < bytes) {
     size_t ask = bytes > kAllocIncrement ? bytes : kAllocIncrement;
-    auto [ptr, actual_size] = SystemAlloc(ask, kPageSize, MemoryTag::kMetadata);
-    free_area_ = reinterpret_cast<char*>(ptr);
-    if (ABSL_PREDICT_FALSE(free_area_ == nullptr)) {
+    auto [ptr, actual_size] =
+        SystemAlloc(ask, kPageSize, MemoryTag::kMetadata, "arena");
+    region.free_area = reinterpret_cast<char*>(ptr);
+    if (ABSL_PREDICT_FALSE(region.free_area == nullptr)) {
       Crash(kCrash, __FILE__, __LINE__,
             "FATAL ERROR: Out of memory trying to allocate internal tcmalloc "
             "data (bytes, object-size); is something preventing mmap from "
             "succeeding (sandbox, VSS limitations)?",
             kAllocIncrement, bytes);
     }
-    SystemBack(free_area_, actual_size);
+    SystemBack(region.free_area, actual_size);
 
-    // We've discarded the previous free_area_, so any bytes that were
+    // We've discarded the previous free area, so any bytes that were
     // unallocated are effectively inaccessible to future allocations.
-    bytes_unavailable_ += free_avail_;
+    bytes_unavailable_ += region.free_avail;
     blocks_++;
 
-    free_avail_ = actual_size;
+    region.free_avail = actual_size;
   }
 
-  ASSERT(reinterpret_cast<uintptr_t>(free_area_) % align == 0);
-  result = free_area_;
-  free_area_ += bytes;
-  free_avail_ -= bytes;
+  ASSERT(reinterpret_cast<uintptr_t>(region.free_area) % align == 0);
+  result = region.free_area;
+  region.free_area += bytes;
+  region.free_avail -= bytes;
   bytes_allocated_ += bytes;
   return reinterpret_cast<void*>(result);
 }
 
+bool Arena::Reserve(size_t bytes) {
+  // Split the reservation across the partitions that can actually allocate,
+  // mirroring how Alloc() carves from the current thread's partition.  The
+  // backing pages are first-touched here, on the reserving thread; partitions
+  // that outgrow their share fall back to Alloc()'s first-touch growth.
+  const size_t partitions = tc_globals.numa_topology().active_partitions();
+  const size_t share = (bytes + partitions - 1) / partitions;
+  for (size_t p = 0; p < partitions; ++p) {
+    Region& region = regions_[p];
+    if (region.free_avail >= share) continue;
+    const size_t ask = share > kAllocIncrement ? share : kAllocIncrement;
+    auto [ptr, actual_size] =
+        SystemAlloc(ask, kPageSize, MemoryTag::kMetadata, "arena");
+    if (ABSL_PREDICT_FALSE(ptr == nullptr)) {
+      // Unlike Alloc(), a failed reservation is not fatal: nothing has been
+      // promised to a caller yet, and on-demand growth may still succeed.
+      return false;
+    }
+    SystemBack(ptr, actual_size);
+
+    // We've discarded the previous free area, so any bytes that were
+    // unallocated are effectively inaccessible to future allocations.
+    bytes_unavailable_ += region.free_avail;
+    blocks_++;
+
+    region.free_area = reinterpret_cast<char*>(ptr);
+    region.free_avail = actual_size;
+  }
+  return true;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
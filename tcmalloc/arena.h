@@ -59,6 +59,13 @@ class Arena {
       size_t bytes, std::align_val_t alignment = kAlignment)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Ensures that at least "bytes" of backed memory are available for future
+  // calls to Alloc() without growing the arena, splitting the reservation
+  // evenly across active NUMA partitions.  Returns false if the system refuses
+  // to provide the memory; the arena remains usable and will grow on demand as
+  // before.  Requires pageheap_lock is held.
+  bool Reserve(size_t bytes) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   // Updates the stats for allocated and non-resident bytes.
   void UpdateAllocatedAndNonresident(int64_t allocated, int64_t nonresident)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
@@ -72,7 +79,10 @@ class Arena {
   ArenaStats stats() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
     ArenaStats s;
     s.bytes_allocated = bytes_allocated_;
-    s.bytes_unallocated = free_avail_;
+    s.bytes_unallocated = 0;
+    for (const Region& region : regions_) {
+      s.bytes_unallocated += region.free_avail;
+    }
     s.bytes_unavailable = bytes_unavailable_;
     s.bytes_nonresident = bytes_nonresident_;
     s.blocks = blocks_;
@@ -83,9 +93,17 @@ class Arena {
   // How much to allocate from system at a time
   static constexpr int kAllocIncrement = 128 << 10;
 
-  // Free area from which to carve new objects
-  char* free_area_ ABSL_GUARDED_BY(pageheap_lock) = nullptr;
-  size_t free_avail_ ABSL_GUARDED_BY(pageheap_lock) = 0;
+  // Free area from which to carve new objects.  Each NUMA partition carves
+  // from its own region, so that metadata such as Span objects is backed by
+  // memory on the node of the threads that use it (the first touch in
+  // SystemBack happens on the allocating thread).  With NUMA awareness
+  // compiled out or disabled there is a single region and behavior is
+  // unchanged.
+  struct Region {
+    char* free_area = nullptr;
+    size_t free_avail = 0;
+  };
+  Region regions_[kNumaPartitions] ABSL_GUARDED_BY(pageheap_lock) = {};
 
   // Total number of bytes allocated from this arena
   size_t bytes_allocated_ ABSL_GUARDED_BY(pageheap_lock) = 0;
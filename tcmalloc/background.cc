@@ -13,139 +13,662 @@
 // limitations under the License.
 
 
+#include <sched.h>
+
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "tcmalloc/adaptive_sampling.h"
+#include "tcmalloc/allocation_anomaly.h"
+#include "tcmalloc/allocation_trace.h"
+#include "tcmalloc/background_scheduler.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/compaction.h"
 #include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/crash_state.h"
+#include "tcmalloc/deferred_free_queue.h"
+#include "tcmalloc/emergency_span_reserve.h"
+#include "tcmalloc/eviction_planner.h"
+#include "tcmalloc/fragmentation_alarm.h"
+#include "tcmalloc/heap_limit_backpressure.h"
+#include "tcmalloc/idle_scan.h"
+#include "tcmalloc/internal/clock.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/pageflags.h"
 #include "tcmalloc/internal/percpu.h"
 #include "tcmalloc/internal_malloc_extension.h"
+#include "tcmalloc/large_span_cache.h"
 #include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/memory_pressure.h"
+#include "tcmalloc/pages.h"
 #include "tcmalloc/parameters.h"
+#include "tcmalloc/property_subscription.h"
 #include "tcmalloc/static_vars.h"
+#include "tcmalloc/stats.h"
+#include "tcmalloc/system-alloc.h"
 
-// Release memory to the system at a constant rate.
-void MallocExtension_Internal_ProcessBackgroundActions() {
+namespace {
+
+// Window of demand history consulted by the adaptive release policy.
+constexpr absl::Duration kAdaptiveReleaseDemandWindow = absl::Minutes(5);
+
+// Interval miss count below which the cache shuffle cadence never
+// accelerates; a doubling from a near-idle baseline is noise, not a load
+// shift.
+constexpr uint64_t kShuffleMissPressureFloor = 1024;
+
+// Returns the number of bytes to release this interval under the adaptive
+// release policy.  We retain enough free-but-backed memory to absorb a return
+// to the demand peak observed within kAdaptiveReleaseDemandWindow, and
+// release a quarter of any excess per interval so that transient dips do not
+// cause releases we immediately re-fault.
+ssize_t GetAdaptiveReleaseTarget() {
+  using ::tcmalloc::tcmalloc_internal::BackingStats;
+  using ::tcmalloc::tcmalloc_internal::Length;
+  using ::tcmalloc::tcmalloc_internal::PageHeapSpinLockHolder;
+  using ::tcmalloc::tcmalloc_internal::tc_globals;
+
+  size_t free_bytes, used_bytes;
+  Length demand_peak;
+  {
+    PageHeapSpinLockHolder l;
+    const BackingStats stats = tc_globals.page_allocator().stats();
+    demand_peak = tc_globals.page_allocator().GetRecentDemandPeak(
+        kAdaptiveReleaseDemandWindow);
+    free_bytes = stats.free_bytes;
+    used_bytes = stats.system_bytes - stats.free_bytes - stats.unmapped_bytes;
+  }
+  const size_t headroom = demand_peak.in_bytes() > used_bytes
+                              ? demand_peak.in_bytes() - used_bytes
+                              : 0;
+  if (free_bytes <= headroom) {
+    return 0;
+  }
+  return (free_bytes - headroom) / 4;
+}
+
+// Runs the background maintenance loop.  numa_partition < 0 is the
+// single-thread mode: this caller carries every duty.  numa_partition >= 0
+// makes the caller one worker of a per-NUMA-partition crew: it reclaims and
+// shuffles only its partition's cpu caches and releases its share of the
+// release target, and the partition-0 worker additionally carries the global
+// duties (transfer caches, compaction, alarms, and the like).
+void ProcessBackgroundActionsLoop(int numa_partition) {
+  using ::tcmalloc::tcmalloc_internal::BackgroundScheduler;
   using ::tcmalloc::tcmalloc_internal::Parameters;
   using ::tcmalloc::tcmalloc_internal::tc_globals;
 
+  const bool global_duties = numa_partition <= 0;
+
   tcmalloc::MallocExtension::MarkThreadIdle();
 
-  absl::Time prev_time = absl::Now();
-  absl::Time last_reclaim = prev_time;
-  absl::Time last_shuffle = prev_time;
-  absl::Time last_size_class_resize = prev_time;
-  absl::Time last_slab_resize_check = prev_time;
+  // Shuffle cadence state: misses observed by the previous shuffle round and
+  // whether the miss rate is climbing fast enough to shuffle every tick.
+  uint64_t last_shuffle_misses = 0;
+  bool shuffle_pressure = false;
+
+  // Previous /proc/vmstat THP snapshot and current placement bias for the
+  // thp_aware_region_bias policy below.
+  std::optional<tcmalloc::tcmalloc_internal::ThpStats> prev_thp_stats;
+  bool dense_region_bias = false;
 
+  // Cadences as multiples of the configured sleep interval.  The slab check
+  // interval is coprime to the shuffle interval so the two do not always
+  // land on the same wakeup.
+  constexpr int kShufflePeriodTicks = 5;
+  constexpr int kSizeClassResizePeriodTicks = 2;
+  constexpr int kSlabResizePeriodTicks = 29;
+  constexpr int kLazyReleasePeriodTicks = 10;
+  constexpr int kColdAdvisePeriodTicks = 30;
+  constexpr int kNumaRehomePeriodTicks = 30;
+  constexpr int kThpPressurePeriodTicks = 30;
+  constexpr int kFragmentationAlarmPeriodTicks = 10;
+  constexpr int kCompactionPeriodTicks = 30;
+  constexpr int kGuardedAdjustPeriodTicks = 10;
 #ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
-  absl::Time last_transfer_cache_plunder_check = prev_time;
-  absl::Time last_transfer_cache_resize_check = prev_time;
+  constexpr int kTransferPlunderPeriodTicks = 5;
+  constexpr int kTransferResizePeriodTicks = 2;
 #endif
 
-  while (tcmalloc::MallocExtension::GetBackgroundProcessActionsEnabled()) {
-    const absl::Duration sleep_time =
-        tcmalloc::MallocExtension::GetBackgroundProcessSleepInterval();
+  // cpu_cache_predictive_grow_interval() == 0 disables predictive growth.
+  // The action keeps its slot at a slow placeholder cadence and reports idle
+  // runs, so re-enabling the parameter needs no re-registration.
+  auto predictive_grow_period = [](absl::Duration sleep_time) {
+    const absl::Duration period =
+        Parameters::cpu_cache_predictive_grow_interval();
+    return period > absl::ZeroDuration() ? period
+                                         : kColdAdvisePeriodTicks * sleep_time;
+  };
+
+  // Every duty below registers with the deadline scheduler; the dispatch
+  // loop then runs whatever is due, earliest deadline first, so when this
+  // thread falls behind the most overdue maintenance goes first instead of
+  // whatever sits earliest in program order.  Registration order breaks
+  // deadline ties, and follows the cache hierarchy in TCMalloc from
+  // outermost (per-CPU) to innermost (the page heap): freeing up objects at
+  // one layer can help aid memory coalescing for inner caches.  Periods that
+  // track a parameter or a pressure signal are refreshed every iteration.
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::Now();
+  const absl::Duration start_interval =
+      tcmalloc::MallocExtension::GetBackgroundProcessSleepInterval();
 
-    // Reclaim inactive per-cpu caches once per cpu_cache_shuffle_period.
-    //
-    // We use a longer 30 sleep cycle reclaim period to make sure that caches
-    // are indeed idle. Reclaim drains entire cache, as opposed to cache shuffle
-    // for instance that only shrinks a cache by a few objects at a time. So, we
-    // might have larger performance degradation if we use a shorter reclaim
-    // interval and drain caches that weren't supposed to.
-    const absl::Duration cpu_cache_reclaim_period = 30 * sleep_time;
+  // Reclaim inactive per-cpu caches once per cpu_cache_reclaim_period.
+  //
+  // We default to a longer 30 second reclaim period to make sure that caches
+  // are indeed idle. Reclaim drains entire cache, as opposed to cache shuffle
+  // for instance that only shrinks a cache by a few objects at a time. So, we
+  // might have larger performance degradation if we use a shorter reclaim
+  // interval and drain caches that weren't supposed to.
+  // Both this and the decay interval clamp to the sleep interval from below,
+  // matching the old round-robin where a zero parameter meant "every tick".
+  const int reclaim_action = scheduler.Register(
+      "cpu_cache_reclaim",
+      std::max(Parameters::cpu_cache_reclaim_idle_interval(), start_interval),
+      absl::Milliseconds(1), start);
 
-    // Shuffle per-cpu caches once per cpu_cache_shuffle_period.
-    const absl::Duration cpu_cache_shuffle_period = 5 * sleep_time;
+  // Decay capacity of quiet per-cpu caches once per cpu_cache_decay_period.
+  // Reclaim above only drains caches that are fully idle; decay also returns
+  // capacity parked on caches that still see light traffic.
+  const int decay_action = scheduler.Register(
+      "cpu_cache_decay",
+      std::max(Parameters::cpu_cache_decay_interval(), start_interval),
+      absl::Milliseconds(1), start);
 
-    const absl::Duration size_class_resize_period = 2 * sleep_time;
+  // Pre-provision quiet caches for a coming traffic ramp.  This deliberately
+  // opposes decay above; operators pick one based on whether their load is
+  // diurnal or bursty.
+  const int predictive_grow_action =
+      scheduler.Register("cpu_cache_predictive_grow",
+                         predictive_grow_period(start_interval),
+                         absl::Milliseconds(1), start);
 
-    // See if we should resize the slab once per cpu_cache_slab_resize_period.
-    // This period is coprime to cpu_cache_shuffle_period and
-    // cpu_cache_shuffle_period.
-    const absl::Duration cpu_cache_slab_resize_period = 29 * sleep_time;
+  // Shuffle per-cpu caches once per shuffle period, or every tick while the
+  // global miss rate is climbing, so capacity chases a load shift in seconds
+  // rather than minutes.
+  const int shuffle_action =
+      scheduler.Register("cpu_cache_shuffle",
+                         kShufflePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  const int size_class_resize_action =
+      scheduler.Register("cpu_cache_size_class_resize",
+                         kSizeClassResizePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // See if we should resize the slab once per slab resize period when
+  // enabled.
+  const int slab_resize_action =
+      scheduler.Register("cpu_cache_slab_resize",
+                         kSlabResizePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // The every-tick duties -- trace draining, the sharded transfer cache and
+  // large span cache plunders, pressure and anomaly checks, the incremental
+  // idle scan, and the cheap bookkeeping drains -- run as one action at the
+  // base interval.
+  const int tick_action = scheduler.Register("tick", start_interval,
+                                             absl::Microseconds(100), start);
 
 #ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
-    // We reclaim unused objects from the transfer caches once per
-    // transfer_cache_plunder_period.
-    const absl::Duration transfer_cache_plunder_period = 5 * sleep_time;
-    // Resize transfer caches once per transfer_cache_resize_period.
-    const absl::Duration transfer_cache_resize_period = 2 * sleep_time;
+  // We reclaim unused objects from the transfer caches once per transfer
+  // cache plunder period.
+  const int transfer_plunder_action =
+      scheduler.Register("transfer_cache_plunder",
+                         kTransferPlunderPeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+  const int transfer_resize_action =
+      scheduler.Register("transfer_cache_resize",
+                         kTransferResizePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
 #endif
 
+  // Probe lazily released (MADV_FREE) memory for residency once per lazy
+  // release check period.
+  const int lazy_release_action =
+      scheduler.Register("lazy_release_check",
+                         kLazyReleasePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // Deactivate pages backing cold-tagged allocations with MADV_COLD once per
+  // cold advise period, so the kernel reclaims them ahead of the hot heap
+  // under memory pressure.
+  const int cold_advise_action =
+      scheduler.Register("cold_region_advise",
+                         kColdAdvisePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // Sample the NUMA placement of normal-tagged regions once per rehome
+  // period and migrate pages stranded on remote nodes.  Affinity changes are
+  // rare, so most passes find nothing and report idle.
+  const int numa_rehome_action =
+      scheduler.Register("numa_rehome", kNumaRehomePeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // Re-measure system transparent-hugepage pressure once per THP check
+  // period.  The counters are system-wide, so rapid polling only adds noise
+  // from other processes.
+  const int thp_pressure_action =
+      scheduler.Register("thp_pressure_check",
+                         kThpPressurePeriodTicks * start_interval,
+                         absl::Microseconds(100), start);
+
+  // Scan live sampled allocations for internal fragmentation once per alarm
+  // check period.  The scan walks every live sample, so it runs less often
+  // than the cheap cache maintenance ticks.
+  const int frag_alarm_action =
+      scheduler.Register("fragmentation_alarm",
+                         kFragmentationAlarmPeriodTicks * start_interval,
+                         absl::Milliseconds(1), start);
+
+  // Migrate registered movable allocations off nearly-empty hugepages once
+  // per compaction period.  Each pass copies live buffers, so it runs at the
+  // same low rate as the other heavyweight maintenance ticks.
+  const int compaction_action =
+      scheduler.Register("compaction", kCompactionPeriodTicks * start_interval,
+                         absl::Milliseconds(5), start);
+
+  // Rescale the guarded sampling rate against its overhead budget once per
+  // adjust period.  Longer windows give the cycle counts time to accumulate,
+  // so one slow guarded allocation does not dominate.
+  const int guarded_adjust_action =
+      scheduler.Register("guarded_overhead_adjust",
+                         kGuardedAdjustPeriodTicks * start_interval,
+                         absl::Microseconds(100), start);
+
+  const int release_action = scheduler.Register(
+      "release", start_interval, absl::Milliseconds(1), start);
+
+  absl::Time last_release = start;
+
+  if (global_duties) {
+    // Make the table visible to the stats paths.  The instance lives on this
+    // thread's stack, so it is retracted below if the loop ever stops.
+    tcmalloc::tcmalloc_internal::PublishBackgroundScheduler(&scheduler);
+  }
+
+  while (tcmalloc::MallocExtension::GetBackgroundProcessActionsEnabled()) {
+    const absl::Duration sleep_time =
+        tcmalloc::MallocExtension::GetBackgroundProcessSleepInterval();
     absl::Time now = absl::Now();
 
-    // We follow the cache hierarchy in TCMalloc from outermost (per-CPU) to
-    // innermost (the page heap).  Freeing up objects at one layer can help aid
-    // memory coalescing for inner caches.
+    // Refresh the cadences that follow the configured sleep interval, a
+    // parameter, or the shuffle pressure signal.
+    scheduler.SetPeriod(
+        reclaim_action,
+        std::max(Parameters::cpu_cache_reclaim_idle_interval(), sleep_time),
+        now);
+    scheduler.SetPeriod(
+        decay_action,
+        std::max(Parameters::cpu_cache_decay_interval(), sleep_time), now);
+    scheduler.SetPeriod(predictive_grow_action,
+                        predictive_grow_period(sleep_time), now);
+    scheduler.SetPeriod(
+        shuffle_action,
+        shuffle_pressure ? sleep_time : kShufflePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(size_class_resize_action,
+                        kSizeClassResizePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(slab_resize_action,
+                        kSlabResizePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(tick_action, sleep_time, now);
+#ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+    scheduler.SetPeriod(transfer_plunder_action,
+                        kTransferPlunderPeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(transfer_resize_action,
+                        kTransferResizePeriodTicks * sleep_time, now);
+#endif
+    scheduler.SetPeriod(lazy_release_action,
+                        kLazyReleasePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(cold_advise_action,
+                        kColdAdvisePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(numa_rehome_action,
+                        kNumaRehomePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(thp_pressure_action,
+                        kThpPressurePeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(frag_alarm_action,
+                        kFragmentationAlarmPeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(compaction_action, kCompactionPeriodTicks * sleep_time,
+                        now);
+    scheduler.SetPeriod(guarded_adjust_action,
+                        kGuardedAdjustPeriodTicks * sleep_time, now);
+    scheduler.SetPeriod(release_action, sleep_time, now);
+
+    // Republish the coarse tick consumed by epoch/interval bookkeeping
+    // (cpu cache miss snapshots, subrelease epochs), which reads it instead
+    // of the cycle counter.  Every wakeup: the duties below read it.
+    tcmalloc::tcmalloc_internal::CoarseClock::Update();
 
-    if (tcmalloc::MallocExtension::PerCpuCachesActive()) {
+    const bool percpu = tcmalloc::MallocExtension::PerCpuCachesActive();
+    if (percpu) {
       // Accelerate fences as part of this operation by registering this thread
       // with rseq.  While this is not strictly required to succeed, we do not
       // expect an inconsistent state for rseq (some threads registered and some
       // threads unable to).
       TC_CHECK(tcmalloc::tcmalloc_internal::subtle::percpu::IsFast());
+    }
 
-      // Try to reclaim per-cpu caches once every cpu_cache_reclaim_period
-      // when enabled.
-      if (now - last_reclaim >= cpu_cache_reclaim_period) {
-        tc_globals.cpu_cache().TryReclaimingCaches();
-        last_reclaim = now;
-      }
+    int action;
+    while ((action = scheduler.PickRunnable(now)) >= 0) {
+      BackgroundScheduler::ScopedRun timer(scheduler, action);
 
-      if (now - last_shuffle >= cpu_cache_shuffle_period) {
-        tc_globals.cpu_cache().ShuffleCpuCaches();
-        last_shuffle = now;
-      }
+      if (action == reclaim_action) {
+        if (!percpu) {
+          timer.set_idle();
+          continue;
+        }
+        tc_globals.cpu_cache().TryReclaimingCaches(numa_partition);
 
-      if (now - last_size_class_resize >= size_class_resize_period) {
+        // Eagerly drain caches stranded on CPUs we can no longer run on
+        // (e.g. a container cpuset that shrank), without waiting for them to
+        // pass the idle check above.
+        cpu_set_t allowed;
+        if (global_duties && Parameters::release_inaccessible_cpu_memory() &&
+            sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+          tc_globals.cpu_cache().ReclaimInaccessibleCaches(allowed);
+        }
+      } else if (action == decay_action) {
+        const int64_t decay_miss_floor =
+            Parameters::cpu_cache_decay_miss_floor();
+        if (!percpu || !global_duties || decay_miss_floor <= 0) {
+          timer.set_idle();
+          continue;
+        }
+        tc_globals.cpu_cache().DecayIdleCpuCaches(decay_miss_floor);
+      } else if (action == predictive_grow_action) {
+        if (!percpu || !global_duties ||
+            Parameters::cpu_cache_predictive_grow_interval() <=
+                absl::ZeroDuration()) {
+          timer.set_idle();
+          continue;
+        }
+        tc_globals.cpu_cache().PredictivelyGrowCpuCaches();
+      } else if (action == shuffle_action) {
+        if (!percpu) {
+          timer.set_idle();
+          continue;
+        }
+        const uint64_t shuffle_misses =
+            tc_globals.cpu_cache().ShuffleCpuCaches(numa_partition);
+        // Accelerate while misses more than double between rounds (with a
+        // floor so near-idle noise does not trigger); drop back to the slow
+        // cadence as soon as the climb stops.
+        shuffle_pressure = shuffle_misses >= kShuffleMissPressureFloor &&
+                           shuffle_misses > 2 * last_shuffle_misses;
+        last_shuffle_misses = shuffle_misses;
+      } else if (action == size_class_resize_action) {
+        if (!percpu || !global_duties) {
+          timer.set_idle();
+          continue;
+        }
         tc_globals.cpu_cache().ResizeSizeClasses();
-        last_size_class_resize = now;
-      }
-
-      // See if we need to grow the slab once every kCpuCacheSlabResizePeriod
-      // when enabled.
-      if (Parameters::per_cpu_caches_dynamic_slab_enabled() &&
-          now - last_slab_resize_check >= cpu_cache_slab_resize_period) {
+      } else if (action == slab_resize_action) {
+        if (!percpu || !global_duties ||
+            !Parameters::per_cpu_caches_dynamic_slab_enabled()) {
+          timer.set_idle();
+          continue;
+        }
         tc_globals.cpu_cache().ResizeSlabIfNeeded();
-        last_slab_resize_check = now;
-      }
-    }
+      } else if (action == tick_action) {
+        if (!global_duties) {
+          timer.set_idle();
+          continue;
+        }
 
-    tc_globals.sharded_transfer_cache().Plunder();
+        // Drain allocation trace rings every tick while a trace session is
+        // active.  A dedicated reader thread is still recommended at high
+        // event rates; this keeps slow sessions from dropping events.
+        if (tcmalloc::tcmalloc_internal::AllocationTraceEnabled()) {
+          tcmalloc::tcmalloc_internal::DrainAllocationTrace();
+        }
 
-#ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
-    // Try to plunder and reclaim unused objects from transfer caches.
-    if (now - last_transfer_cache_plunder_check >=
-        transfer_cache_plunder_period) {
-      tc_globals.transfer_cache().TryPlunder();
-      last_transfer_cache_plunder_check = now;
-    }
+        tc_globals.sharded_transfer_cache().Plunder();
+        // Evict large spans the span cache neither took in nor served since
+        // the previous sweep; see large_span_cache.h.
+        tcmalloc::tcmalloc_internal::PlunderLargeSpanCache();
 
-    if (now - last_transfer_cache_resize_check >=
-        transfer_cache_resize_period) {
-      tc_globals.transfer_cache().TryResizingCaches();
-      last_transfer_cache_resize_check = now;
-    }
+        // Sample kernel memory PSI and react to rising pressure -- extra
+        // release increments, escalating to idle cpu cache reclaim -- before
+        // the kernel starts stalling us; see memory_pressure.h.
+        const double memory_pressure_threshold =
+            Parameters::memory_pressure_avg10_threshold();
+        if (memory_pressure_threshold > 0) {
+          tcmalloc::tcmalloc_internal::CheckMemoryPressure(
+              memory_pressure_threshold);
+        }
+
+        // Compare each size class's per-interval allocation-rate proxy (the
+        // per-class cpu cache miss counters the fast path already maintains)
+        // against its trailing baseline, and fire the anomaly tripwire on
+        // departures; see allocation_anomaly.h.  Runs every tick so a
+        // runaway allocation path is reported within seconds.
+        const double allocation_anomaly_factor =
+            Parameters::allocation_anomaly_factor();
+        if (allocation_anomaly_factor > 1.0) {
+          tcmalloc::tcmalloc_internal::CheckAllocationAnomalies(
+              tc_globals, allocation_anomaly_factor);
+        }
+
+        // Advance the incremental page_idle coldness scan by one bounded
+        // batch of hugepages every tick; the cursor carries over, so large
+        // heaps are swept a slice at a time.
+        if (Parameters::page_idle_scan_enabled()) {
+          tcmalloc::tcmalloc_internal::ScanIdleHugePages(
+              tcmalloc::tcmalloc_internal::kIdleScanHugePagesPerTick);
+        }
+
+        // Refresh the crash-dump state snapshot (see crash_state.h) so a
+        // core dump taken at any moment -- an OOM kill included -- carries
+        // recent allocator aggregates and the tail of the growth ledger.
+        tcmalloc::tcmalloc_internal::UpdateCrashState();
+
+        // Sample subscribed properties and notify subscribers whose
+        // thresholds tripped.  Each subscription carries its own sampling
+        // period, so this is a no-op on iterations where none are due.
+        tcmalloc::tcmalloc_internal::CheckPropertySubscriptions(now);
+
+        // Report pending soft heap limit hits to registered backpressure
+        // callbacks.  A single relaxed load on iterations with nothing
+        // pending.
+        tcmalloc::tcmalloc_internal::CheckHeapLimitBackpressure();
+
+        // Return spans whose frees were handed off by latency-critical
+        // threads (see deferred_free_queue.h) to the page allocator.
+        tcmalloc::tcmalloc_internal::DrainDeferredFrees();
+
+        // Restock the emergency span reserve backing bounded-wait central
+        // freelist refills, or drain it when the policy is off; see
+        // emergency_span_reserve.h.
+        tcmalloc::tcmalloc_internal::RefillEmergencySpanReserve();
+
+        // Steer the profile sampling interval toward the configured
+        // samples-per-second target; a relaxed load and return when no
+        // target is set.
+        tcmalloc::tcmalloc_internal::UpdateAdaptiveSamplingInterval(now);
+
+        // Re-probe rseq availability.  A kernel update or a newly installed
+        // seccomp policy can regress it after startup; the handler warns
+        // once and widens the thread-cache budget.
+        if (Parameters::per_cpu_caches() &&
+            !tcmalloc::tcmalloc_internal::UsePerCpuCache(
+                tcmalloc::tcmalloc_internal::tc_globals)) {
+          tcmalloc::tcmalloc_internal::HandlePerCpuUnavailable();
+        }
+
+        // The thp_aware_region_bias policy was turned off while engaged:
+        // restore default placement promptly rather than waiting out the
+        // slow THP check cadence.
+        if (dense_region_bias && !Parameters::thp_aware_region_bias()) {
+          dense_region_bias = false;
+          tc_globals.page_allocator().SetDenseRegionBias(false);
+        }
+#ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+      } else if (action == transfer_plunder_action) {
+        if (!global_duties) {
+          timer.set_idle();
+          continue;
+        }
+        // Try to plunder and reclaim unused objects from transfer caches.
+        tc_globals.transfer_cache().TryPlunder();
+      } else if (action == transfer_resize_action) {
+        if (!global_duties) {
+          timer.set_idle();
+          continue;
+        }
+        tc_globals.transfer_cache().TryResizingCaches();
+        // Piggyback on the resize interval to reconsider which size classes
+        // carry enough freelist traffic to deserve a lock-free batch stack.
+        if (Parameters::lock_free_central_freelist()) {
+          tc_globals.transfer_cache().MaybeEnableLockFreeFreelists();
+        }
 #endif
+      } else if (action == lazy_release_action) {
+        if (!global_duties || !Parameters::madvise_free_lazy()) {
+          timer.set_idle();
+          continue;
+        }
+        tcmalloc::tcmalloc_internal::SystemCheckLazyRelease();
+      } else if (action == cold_advise_action) {
+        if (!global_duties || !Parameters::madvise_cold_regions()) {
+          timer.set_idle();
+          continue;
+        }
+        tcmalloc::tcmalloc_internal::SystemAdviseColdRegions();
+      } else if (action == numa_rehome_action) {
+        if (!global_duties || !Parameters::numa_rehome_enabled()) {
+          timer.set_idle();
+          continue;
+        }
+        if (tcmalloc::tcmalloc_internal::SystemRehomeNumaRegions() == 0) {
+          timer.set_idle();
+        }
+      } else if (action == thp_pressure_action) {
+        if (!global_duties || !Parameters::thp_aware_region_bias()) {
+          timer.set_idle();
+          continue;
+        }
+        // When most recent hugepage faults fell back to native pages, fresh
+        // hugepages are scarce and slack donated to the filler is unlikely
+        // to be hugepage-backed, so bias large allocations toward regions
+        // and dense packing; once fallbacks subside, drop the bias and
+        // return to subrelease-friendly placement.  Engage above a 50%
+        // fallback fraction and disengage below 25% so the bias does not
+        // flap, and hold steady through intervals with no hugepage fault
+        // activity at all.
+        const std::optional<tcmalloc::tcmalloc_internal::ThpStats> thp_stats =
+            tcmalloc::tcmalloc_internal::GetThpStats();
+        if (thp_stats.has_value() && prev_thp_stats.has_value()) {
+          const uint64_t fallback =
+              thp_stats->fault_fallback - prev_thp_stats->fault_fallback;
+          const uint64_t faults =
+              thp_stats->fault_alloc - prev_thp_stats->fault_alloc + fallback;
+          if (faults > 0) {
+            if (!dense_region_bias && 2 * fallback > faults) {
+              dense_region_bias = true;
+              tc_globals.page_allocator().SetDenseRegionBias(true);
+            } else if (dense_region_bias && 4 * fallback < faults) {
+              dense_region_bias = false;
+              tc_globals.page_allocator().SetDenseRegionBias(false);
+            }
+          }
+        }
+        prev_thp_stats = thp_stats;
+      } else if (action == frag_alarm_action) {
+        const int64_t fragmentation_alarm_threshold =
+            Parameters::fragmentation_alarm_threshold_bytes();
+        if (!global_duties || fragmentation_alarm_threshold <= 0) {
+          timer.set_idle();
+          continue;
+        }
+        tcmalloc::tcmalloc_internal::CheckFragmentationAlarm(
+            tc_globals, fragmentation_alarm_threshold);
+      } else if (action == compaction_action) {
+        if (!global_duties) {
+          timer.set_idle();
+          continue;
+        }
+        tcmalloc::tcmalloc_internal::CompactMovableAllocations(
+            tcmalloc::tcmalloc_internal::kCompactionMaxUsedPages);
+      } else if (action == guarded_adjust_action) {
+        const double guarded_overhead_fraction =
+            Parameters::guarded_sampling_overhead_fraction();
+        if (!global_duties || guarded_overhead_fraction <= 0) {
+          timer.set_idle();
+          continue;
+        }
+        tc_globals.guardedpage_allocator().AdjustForOverheadBudget(
+            guarded_overhead_fraction);
+      } else if (action == release_action) {
+        ssize_t bytes_to_release;
+        if (Parameters::background_release_rate() ==
+            tcmalloc::MallocExtension::kAdaptiveBackgroundReleaseRate) {
+          bytes_to_release = GetAdaptiveReleaseTarget();
+        } else {
+          // If time goes backwards, we would like to cap the release rate
+          // at 0.
+          bytes_to_release =
+              static_cast<size_t>(Parameters::background_release_rate()) *
+              absl::ToDoubleSeconds(now - last_release);
+        }
+        last_release = now;
+        bytes_to_release = std::max<ssize_t>(bytes_to_release, 0);
+
+        // Each worker of a per-partition crew releases an equal share of the
+        // target, so the release work -- the madvise calls in particular --
+        // proceeds in parallel instead of bottlenecking on one thread.
+        const size_t num_release_workers =
+            numa_partition < 0
+                ? 1
+                : tc_globals.numa_topology().active_partitions();
+        if (numa_partition >= static_cast<int>(num_release_workers)) {
+          // A worker beyond the active partitions has no cpus and no share.
+          bytes_to_release = 0;
+        } else {
+          bytes_to_release /= static_cast<ssize_t>(num_release_workers);
+        }
 
-    // If time goes backwards, we would like to cap the release rate at 0.
-    ssize_t bytes_to_release =
-        static_cast<size_t>(Parameters::background_release_rate()) *
-        absl::ToDoubleSeconds(now - prev_time);
-    bytes_to_release = std::max<ssize_t>(bytes_to_release, 0);
-
-    // If release rate is set to 0, do not release memory to system. However, if
-    // we want to release free and backed hugepages from HugeRegion,
-    // ReleaseMemoryToSystem should be able to release those pages to the
-    // system even with bytes_to_release = 0.
-    if (bytes_to_release > 0 || Parameters::release_pages_from_huge_region()) {
-      tcmalloc::MallocExtension::ReleaseMemoryToSystem(bytes_to_release);
+        // If release rate is set to 0, do not release memory to system.
+        // However, if we want to release free and backed hugepages from
+        // HugeRegion, ReleaseMemoryToSystem should be able to release those
+        // pages to the system even with bytes_to_release = 0.
+        if (bytes_to_release > 0 ||
+            (global_duties && Parameters::release_pages_from_huge_region())) {
+          if (bytes_to_release > 0 && Parameters::unified_eviction_planner()) {
+            tcmalloc::tcmalloc_internal::ReleaseAtMinimumRefaultCost(
+                bytes_to_release);
+          } else {
+            tcmalloc::MallocExtension::ReleaseMemoryToSystem(bytes_to_release);
+          }
+        } else {
+          // Nothing to release; let the action back off while demand is
+          // flat.  The rate math above scales with the elapsed time, so a
+          // stretched interval releases the same bytes per second.
+          timer.set_idle();
+        }
+      }
     }
 
-    prev_time = now;
-    absl::SleepFor(sleep_time);
+    absl::SleepFor(scheduler.SleepTime(
+        absl::Now(), sleep_time,
+        BackgroundScheduler::kMaxIdleBackoff * sleep_time));
   }
+
+  if (global_duties) {
+    tcmalloc::tcmalloc_internal::PublishBackgroundScheduler(nullptr);
+  }
+}
+
+}  // namespace
+
+// Release memory to the system at a constant rate.
+void MallocExtension_Internal_ProcessBackgroundActions() {
+  ProcessBackgroundActionsLoop(/*numa_partition=*/-1);
+}
+
+void MallocExtension_Internal_ProcessBackgroundActionsForNumaPartition(
+    int numa_partition) {
+  ProcessBackgroundActionsLoop(numa_partition);
 }
@@ -0,0 +1,193 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/background_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/time/time.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+ABSL_CONST_INIT std::atomic<BackgroundScheduler*> published_scheduler{nullptr};
+
+}  // namespace
+
+int BackgroundScheduler::Register(const char* name, absl::Duration period,
+                                  absl::Duration cost, absl::Time now) {
+  const int handle = num_actions_.load(std::memory_order_relaxed);
+  TC_CHECK_LT(handle, kMaxActions);
+  // A non-positive period would make the action permanently due and starve
+  // the rest of the table.
+  TC_ASSERT_GT(absl::ToInt64Nanoseconds(period), 0);
+  Action& action = actions_[handle];
+  action.name = name;
+  action.period_ns.store(absl::ToInt64Nanoseconds(period),
+                         std::memory_order_relaxed);
+  action.cost_estimate_ns.store(absl::ToInt64Nanoseconds(cost),
+                                std::memory_order_relaxed);
+  action.deadline = now + period;
+  // Release so a stats dump that observes the new count sees the entry.
+  num_actions_.store(handle + 1, std::memory_order_release);
+  return handle;
+}
+
+void BackgroundScheduler::SetPeriod(int handle, absl::Duration period,
+                                    absl::Time now) {
+  TC_ASSERT_GE(handle, 0);
+  TC_ASSERT_LT(handle, num_actions_.load(std::memory_order_relaxed));
+  Action& action = actions_[handle];
+  const int64_t period_ns = absl::ToInt64Nanoseconds(period);
+  TC_ASSERT_GT(period_ns, 0);
+  if (action.period_ns.load(std::memory_order_relaxed) == period_ns) {
+    return;
+  }
+  action.period_ns.store(period_ns, std::memory_order_relaxed);
+  action.deadline = std::min(action.deadline, now + period);
+}
+
+int BackgroundScheduler::PickRunnable(absl::Time now) {
+  const int num_actions = num_actions_.load(std::memory_order_relaxed);
+  int best = -1;
+  absl::Time best_deadline = absl::InfiniteFuture();
+  for (int i = 0; i < num_actions; ++i) {
+    const absl::Time deadline = actions_[i].deadline;
+    // Strict comparison keeps registration order on equal deadlines, so ties
+    // run in the order the loop registered them (outermost cache first).
+    if (deadline <= now && deadline < best_deadline) {
+      best = i;
+      best_deadline = deadline;
+    }
+  }
+  if (best < 0) {
+    return -1;
+  }
+  Action& action = actions_[best];
+  const absl::Duration period =
+      absl::Nanoseconds(action.period_ns.load(std::memory_order_relaxed));
+  const absl::Duration step = period * action.idle_backoff;
+  if (now - action.deadline > step) {
+    // The action fell a whole period behind: the thread could not keep up.
+    // Count the miss and restart from now instead of scheduling a burst of
+    // make-up runs.
+    action.missed_deadlines.Add(1);
+    action.deadline = now + step;
+  } else {
+    action.deadline += step;
+  }
+  return best;
+}
+
+void BackgroundScheduler::RecordRun(int handle, absl::Duration elapsed,
+                                    bool idle) {
+  TC_ASSERT_GE(handle, 0);
+  TC_ASSERT_LT(handle, num_actions_.load(std::memory_order_relaxed));
+  Action& action = actions_[handle];
+  action.runs.Add(1);
+  if (idle) {
+    action.idle_runs.Add(1);
+    action.idle_backoff = std::min(2 * action.idle_backoff, kMaxIdleBackoff);
+    return;
+  }
+  action.idle_backoff = 1;
+  const int64_t elapsed_ns = absl::ToInt64Nanoseconds(elapsed);
+  action.total_run_ns.LossyAdd(elapsed_ns);
+  if (elapsed_ns > action.max_run_ns.load(std::memory_order_relaxed)) {
+    action.max_run_ns.store(elapsed_ns, std::memory_order_relaxed);
+  }
+  // Fold the measurement into the cost estimate with a 1/8 weight, so one
+  // outlier run does not dominate but a real cost shift shows up within a
+  // few runs.
+  const int64_t cost_ns =
+      action.cost_estimate_ns.load(std::memory_order_relaxed);
+  action.cost_estimate_ns.store(cost_ns + (elapsed_ns - cost_ns) / 8,
+                                std::memory_order_relaxed);
+}
+
+absl::Duration BackgroundScheduler::SleepTime(absl::Time now,
+                                              absl::Duration min_sleep,
+                                              absl::Duration max_sleep) const {
+  const int num_actions = num_actions_.load(std::memory_order_relaxed);
+  absl::Time earliest = absl::InfiniteFuture();
+  for (int i = 0; i < num_actions; ++i) {
+    earliest = std::min(earliest, actions_[i].deadline);
+  }
+  if (earliest == absl::InfiniteFuture()) {
+    return min_sleep;
+  }
+  return std::clamp(earliest - now, min_sleep, max_sleep);
+}
+
+void BackgroundScheduler::Print(Printer* out) const {
+  const int num_actions = num_actions_.load(std::memory_order_acquire);
+  if (num_actions == 0) {
+    return;
+  }
+  out->printf("------------------------------------------------\n");
+  out->printf("Background scheduler: per-action runtime\n");
+  out->printf("------------------------------------------------\n");
+  for (int i = 0; i < num_actions; ++i) {
+    const Action& action = actions_[i];
+    out->printf(
+        "%-24s period %8.1f s : %10lld runs (%lld idle, %lld missed "
+        "deadlines); %10.3f ms total; %8.3f ms max; %8.3f ms est. cost\n",
+        action.name,
+        absl::ToDoubleSeconds(absl::Nanoseconds(
+            action.period_ns.load(std::memory_order_relaxed))),
+        action.runs.value(), action.idle_runs.value(),
+        action.missed_deadlines.value(),
+        action.total_run_ns.value() / 1e6,
+        action.max_run_ns.load(std::memory_order_relaxed) / 1e6,
+        action.cost_estimate_ns.load(std::memory_order_relaxed) / 1e6);
+  }
+}
+
+void BackgroundScheduler::PrintInPbtxt(PbtxtRegion* region) const {
+  const int num_actions = num_actions_.load(std::memory_order_acquire);
+  for (int i = 0; i < num_actions; ++i) {
+    const Action& action = actions_[i];
+    PbtxtRegion entry = region->CreateSubRegion("background_action");
+    entry.PrintRaw("name", action.name);
+    entry.PrintI64("period_ns",
+                   action.period_ns.load(std::memory_order_relaxed));
+    entry.PrintI64("runs", action.runs.value());
+    entry.PrintI64("idle_runs", action.idle_runs.value());
+    entry.PrintI64("missed_deadlines", action.missed_deadlines.value());
+    entry.PrintI64("total_run_ns", action.total_run_ns.value());
+    entry.PrintI64("max_run_ns",
+                   action.max_run_ns.load(std::memory_order_relaxed));
+    entry.PrintI64("cost_estimate_ns",
+                   action.cost_estimate_ns.load(std::memory_order_relaxed));
+  }
+}
+
+void PublishBackgroundScheduler(BackgroundScheduler* scheduler) {
+  published_scheduler.store(scheduler, std::memory_order_release);
+}
+
+BackgroundScheduler* GetPublishedBackgroundScheduler() {
+  return published_scheduler.load(std::memory_order_acquire);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
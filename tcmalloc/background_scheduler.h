@@ -0,0 +1,168 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_BACKGROUND_SCHEDULER_H_
+#define TCMALLOC_BACKGROUND_SCHEDULER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Deadline scheduler for the background maintenance loop.
+//
+// Each maintenance duty registers once with a name, a period, and a rough
+// per-run cost estimate.  The loop then repeatedly asks PickRunnable() for
+// the due action with the earliest deadline, so when the thread falls behind
+// the most overdue work runs first instead of whatever happens to sit
+// earliest in program order.  Actions that report an idle run (they woke and
+// found nothing to do) back off to a multiple of their period until a run
+// next finds work, and SleepTime() lets the loop sleep to the earliest
+// pending deadline instead of a fixed tick, so a calm process wakes less.
+//
+// The scheduling methods are for the single background thread that owns the
+// instance.  The per-action statistics -- run counts, idle runs, missed
+// deadlines, run times, and the refined cost estimate -- are safe to read
+// concurrently and surface through the MallocExtension stats paths.
+class BackgroundScheduler {
+ public:
+  static constexpr int kMaxActions = 24;
+
+  // An idle action stretches its effective period by doubling up to this
+  // factor, and snaps back to its registered period on the first run that
+  // finds work.
+  static constexpr int kMaxIdleBackoff = 8;
+
+  constexpr BackgroundScheduler() = default;
+
+  BackgroundScheduler(const BackgroundScheduler&) = delete;
+  BackgroundScheduler& operator=(const BackgroundScheduler&) = delete;
+
+  // Registers a periodic action and returns its handle.  `name` must outlive
+  // the scheduler.  `cost` seeds the per-run cost estimate that measured runs
+  // then refine.  The first deadline falls one period after `now`.
+  int Register(const char* name, absl::Duration period, absl::Duration cost,
+               absl::Time now);
+
+  // Updates an action's period, e.g. when the configured sleep interval or a
+  // pressure signal changes.  A shortened period pulls an already-scheduled
+  // deadline in, so the new cadence takes effect this tick rather than next.
+  void SetPeriod(int handle, absl::Duration period, absl::Time now);
+
+  // Returns the handle of the due action with the earliest deadline, or -1
+  // when nothing is due.  The chosen action's next deadline advances by its
+  // (backed-off) period; a deadline that already slipped by more than one
+  // period counts as missed and restarts from `now`, rather than scheduling
+  // a burst of make-up runs.  Each action is returned at most once per value
+  // of `now`, so a dispatch loop around this call terminates.
+  int PickRunnable(absl::Time now);
+
+  // Reports one timed run of an action; `idle` means the run found nothing
+  // to do.  Usually invoked through ScopedRun below.
+  void RecordRun(int handle, absl::Duration elapsed, bool idle);
+
+  // Earliest pending deadline expressed as a sleep from `now`, clamped to
+  // [min_sleep, max_sleep].
+  absl::Duration SleepTime(absl::Time now, absl::Duration min_sleep,
+                           absl::Duration max_sleep) const;
+
+  // Times one run of an action and reports it back on destruction.  Call
+  // set_idle() when the run turned out to have nothing to do.
+  class ScopedRun {
+   public:
+    ScopedRun(BackgroundScheduler& scheduler, int handle)
+        : scheduler_(scheduler), handle_(handle), start_(absl::Now()) {}
+    ~ScopedRun() {
+      scheduler_.RecordRun(handle_, absl::Now() - start_, idle_);
+    }
+
+    ScopedRun(const ScopedRun&) = delete;
+    ScopedRun& operator=(const ScopedRun&) = delete;
+
+    void set_idle() { idle_ = true; }
+
+   private:
+    BackgroundScheduler& scheduler_;
+    int handle_;
+    absl::Time start_;
+    bool idle_ = false;
+  };
+
+  int num_actions() const {
+    return num_actions_.load(std::memory_order_acquire);
+  }
+
+  const char* name(int handle) const { return actions_[handle].name; }
+  absl::Duration period(int handle) const {
+    return absl::Nanoseconds(
+        actions_[handle].period_ns.load(std::memory_order_relaxed));
+  }
+  absl::Duration cost_estimate(int handle) const {
+    return absl::Nanoseconds(
+        actions_[handle].cost_estimate_ns.load(std::memory_order_relaxed));
+  }
+  int64_t runs(int handle) const { return actions_[handle].runs.value(); }
+  int64_t idle_runs(int handle) const {
+    return actions_[handle].idle_runs.value();
+  }
+  int64_t missed_deadlines(int handle) const {
+    return actions_[handle].missed_deadlines.value();
+  }
+
+  void Print(Printer* out) const;
+  void PrintInPbtxt(PbtxtRegion* region) const;
+
+ private:
+  struct Action {
+    // Set once at registration; read by concurrent stats dumps.
+    const char* name = nullptr;
+
+    // Nanosecond representations so the stats paths can read them while the
+    // background thread updates them.
+    std::atomic<int64_t> period_ns{0};
+    std::atomic<int64_t> cost_estimate_ns{0};
+
+    // Touched only by the owning background thread.
+    absl::Time deadline;
+    int idle_backoff = 1;
+
+    StatsCounter runs;
+    StatsCounter idle_runs;
+    StatsCounter missed_deadlines;
+    StatsCounter total_run_ns;
+    std::atomic<int64_t> max_run_ns{0};
+  };
+
+  Action actions_[kMaxActions];
+  std::atomic<int> num_actions_{0};
+};
+
+// Publishes (or, with nullptr, retracts) the scheduler instance owned by the
+// background thread carrying the global duties, for the stats paths to read.
+void PublishBackgroundScheduler(BackgroundScheduler* scheduler);
+BackgroundScheduler* GetPublishedBackgroundScheduler();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_BACKGROUND_SCHEDULER_H_
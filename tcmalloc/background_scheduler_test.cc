@@ -0,0 +1,141 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/background_scheduler.h"
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(BackgroundSchedulerTest, RunsEarliestDeadlineFirst) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int slow = scheduler.Register("slow", absl::Seconds(10),
+                                      absl::Milliseconds(1), start);
+  const int fast = scheduler.Register("fast", absl::Seconds(5),
+                                      absl::Milliseconds(1), start);
+
+  // Nothing is due before the first deadline.
+  EXPECT_EQ(scheduler.PickRunnable(start + absl::Seconds(4)), -1);
+
+  // Both are due at +10s; the earlier deadline (+5s) goes first.
+  const absl::Time late = start + absl::Seconds(10);
+  EXPECT_EQ(scheduler.PickRunnable(late), fast);
+  EXPECT_EQ(scheduler.PickRunnable(late), slow);
+  // Each action dispatches at most once per instant.
+  EXPECT_EQ(scheduler.PickRunnable(late), -1);
+}
+
+TEST(BackgroundSchedulerTest, TiesRunInRegistrationOrder) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int first = scheduler.Register("first", absl::Seconds(1),
+                                       absl::Milliseconds(1), start);
+  const int second = scheduler.Register("second", absl::Seconds(1),
+                                        absl::Milliseconds(1), start);
+
+  const absl::Time due = start + absl::Seconds(1);
+  EXPECT_EQ(scheduler.PickRunnable(due), first);
+  EXPECT_EQ(scheduler.PickRunnable(due), second);
+}
+
+TEST(BackgroundSchedulerTest, CountsMissedDeadlines) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int action = scheduler.Register("action", absl::Seconds(1),
+                                        absl::Milliseconds(1), start);
+
+  // Dispatched a whole period late: one miss, and the cadence restarts from
+  // now instead of scheduling make-up runs.
+  const absl::Time late = start + absl::Seconds(5);
+  EXPECT_EQ(scheduler.PickRunnable(late), action);
+  EXPECT_EQ(scheduler.missed_deadlines(action), 1);
+  EXPECT_EQ(scheduler.PickRunnable(late), -1);
+  EXPECT_EQ(scheduler.PickRunnable(late + absl::Seconds(1)), action);
+  EXPECT_EQ(scheduler.missed_deadlines(action), 1);
+}
+
+TEST(BackgroundSchedulerTest, IdleRunsBackOff) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int action = scheduler.Register("action", absl::Seconds(1),
+                                        absl::Milliseconds(1), start);
+
+  absl::Time now = start + absl::Seconds(1);
+  EXPECT_EQ(scheduler.PickRunnable(now), action);
+  scheduler.RecordRun(action, absl::Microseconds(1), /*idle=*/true);
+
+  // The backoff stretches the advance taken at dispatch, so the already-set
+  // +2s deadline still fires, but the one after lands at +4s, not +3s.
+  now = start + absl::Seconds(2);
+  EXPECT_EQ(scheduler.PickRunnable(now), action);
+  scheduler.RecordRun(action, absl::Microseconds(1), /*idle=*/true);
+  EXPECT_EQ(scheduler.PickRunnable(start + absl::Seconds(3)), -1);
+  EXPECT_EQ(scheduler.idle_runs(action), 2);
+
+  now = start + absl::Seconds(6);
+  EXPECT_EQ(scheduler.PickRunnable(now), action);
+  // A productive run snaps the backoff back to the registered period.
+  scheduler.RecordRun(action, absl::Milliseconds(1), /*idle=*/false);
+  EXPECT_EQ(scheduler.runs(action), 3);
+}
+
+TEST(BackgroundSchedulerTest, SetPeriodPullsDeadlineIn) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int action = scheduler.Register("action", absl::Seconds(30),
+                                        absl::Milliseconds(1), start);
+
+  // Shortening the period takes effect immediately, not after the old
+  // 30-second deadline passes.
+  scheduler.SetPeriod(action, absl::Seconds(1), start);
+  EXPECT_EQ(scheduler.PickRunnable(start + absl::Seconds(1)), action);
+  EXPECT_EQ(scheduler.period(action), absl::Seconds(1));
+}
+
+TEST(BackgroundSchedulerTest, SleepTimeTracksNextDeadline) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  scheduler.Register("action", absl::Seconds(5), absl::Milliseconds(1), start);
+
+  EXPECT_EQ(scheduler.SleepTime(start, absl::Seconds(1), absl::Seconds(60)),
+            absl::Seconds(5));
+  // Clamped from below near the deadline and from above far from it.
+  EXPECT_EQ(scheduler.SleepTime(start + absl::Milliseconds(4900),
+                                absl::Seconds(1), absl::Seconds(60)),
+            absl::Seconds(1));
+  EXPECT_EQ(scheduler.SleepTime(start, absl::Seconds(1), absl::Seconds(2)),
+            absl::Seconds(2));
+}
+
+TEST(BackgroundSchedulerTest, RefinesCostEstimateFromRuns) {
+  BackgroundScheduler scheduler;
+  const absl::Time start = absl::UnixEpoch();
+  const int action = scheduler.Register("action", absl::Seconds(1),
+                                        absl::Milliseconds(1), start);
+
+  for (int i = 0; i < 50; ++i) {
+    scheduler.RecordRun(action, absl::Milliseconds(9), /*idle=*/false);
+  }
+  // The estimate converges toward the measured runtime.
+  EXPECT_GT(scheduler.cost_estimate(action), absl::Milliseconds(8));
+  EXPECT_LE(scheduler.cost_estimate(action), absl::Milliseconds(9));
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -19,14 +19,17 @@
 
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
+#include "tcmalloc/emergency_span_reserve.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/prefetch.h"
 #include "tcmalloc/pagemap.h"
 #include "tcmalloc/pages.h"
+#include "tcmalloc/parameters.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/static_vars.h"
 
@@ -53,6 +56,14 @@ Length StaticForwarder::class_to_pages(int size_class) {
   return Length(tc_globals.sizemap().class_to_pages(size_class));
 }
 
+size_t StaticForwarder::num_objects_to_move(int size_class) {
+  return tc_globals.sizemap().num_objects_to_move(size_class);
+}
+
+bool StaticForwarder::span_coloring(int size_class) {
+  return tc_globals.sizemap().span_coloring(size_class);
+}
+
 void StaticForwarder::MapObjectsToSpans(absl::Span<void*> batch, Span** spans) {
   // Prefetch Span objects to reduce cache misses.
   for (int i = 0; i < batch.size(); ++i) {
@@ -68,8 +79,20 @@ Span* StaticForwarder::AllocateSpan(int size_class,
                                     SpanAllocInfo span_alloc_info,
                                     Length pages_per_span) {
   const MemoryTag tag = MemoryTagFromSizeClass(size_class);
-  Span* span =
-      tc_globals.page_allocator().New(pages_per_span, span_alloc_info, tag);
+  Span* span;
+  const absl::Duration lock_wait_budget =
+      Parameters::pageheap_lock_wait_budget();
+  if (ABSL_PREDICT_FALSE(lock_wait_budget != absl::ZeroDuration()) &&
+      tag == MemoryTag::kNormal) {
+    // Bounded-wait mode: probe pageheap_lock for at most the budget, then
+    // fall back to the emergency reserve.  Only the plain normal tag is
+    // covered; cold and NUMA-partitioned spans take the synchronous path.
+    span = AllocateSpanBoundedWait(pages_per_span, span_alloc_info,
+                                   lock_wait_budget);
+  } else {
+    span = tc_globals.page_allocator().New(pages_per_span, span_alloc_info,
+                                           tag);
+  }
   if (ABSL_PREDICT_FALSE(span == nullptr)) {
     return nullptr;
   }
@@ -83,11 +106,11 @@ Span* StaticForwarder::AllocateSpan(int size_class,
 static void ReturnSpansToPageHeap(MemoryTag tag, absl::Span<Span*> free_spans,
                                   size_t objects_per_span)
     ABSL_LOCKS_EXCLUDED(pageheap_lock) {
-  PageHeapSpinLockHolder l;
   for (Span* const free_span : free_spans) {
     ASSERT(tag == GetMemoryTag(free_span->start_address()));
-    tc_globals.page_allocator().Delete(free_span, objects_per_span, tag);
   }
+  PageHeapSpinLockHolder l;
+  tc_globals.page_allocator().DeleteBatch(free_spans, objects_per_span, tag);
 }
 
 void StaticForwarder::DeallocateSpans(int size_class, size_t objects_per_span,
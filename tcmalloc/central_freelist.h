@@ -18,6 +18,7 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
@@ -32,8 +33,10 @@
 #include "tcmalloc/hinted_tracker_lists.h"
 #include "tcmalloc/internal/atomic_stats_counter.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/lock_telemetry.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/optimization.h"
+#include "tcmalloc/internal/seqlocked_data.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/span_stats.h"
@@ -52,6 +55,8 @@ class StaticForwarder {
  public:
   static size_t class_to_size(int size_class);
   static Length class_to_pages(int size_class);
+  static size_t num_objects_to_move(int size_class);
+  static bool span_coloring(int size_class);
   static void MapObjectsToSpans(absl::Span<void*> batch, Span** spans);
   static Span* AllocateSpan(int size_class, SpanAllocInfo span_alloc_info,
                             Length pages_per_span)
@@ -62,12 +67,25 @@ class StaticForwarder {
 };
 
 // Specifies number of nonempty_ lists that keep track of non-empty spans.
-static constexpr size_t kNumLists = 8;
+static constexpr size_t kNumLists = 16;
+
+// Number of nonempty_ lists that hold exactly one allocated-object count
+// each (the emptiest spans); the remaining lists split the rest of a span's
+// range into equal-width fullness buckets.  See IndexFor.
+static constexpr size_t kNumExactLists = kNumLists / 2;
+
+// Fixed-point shift for the precomputed reciprocal used by the proportional
+// fullness mapping in IndexFor.
+static constexpr size_t kFullnessShift = 16;
 
 // Specifies the threshold for number of objects per span. The threshold is
 // used to consider a span sparsely- vs. densely-accessed.
 static constexpr size_t kFewObjectsAllocMaxLimit = 16;
 
+// Specifies the number of frees between re-evaluations of the span freelist
+// representation for size classes that are valid under both representations.
+static constexpr size_t kRepresentationEvalInterval = 64 * 1024;
+
 // Data kept per size-class in central cache.
 template <typename ForwarderT>
 class CentralFreeList {
@@ -81,6 +99,7 @@ class CentralFreeList {
         objects_per_span_(0),
         first_nonempty_index_(0),
         pages_per_span_(0),
+        span_colors_(1),
         nonempty_(),
         use_all_buckets_for_few_object_spans_(false) {}
 
@@ -104,6 +123,30 @@ class CentralFreeList {
   // Returns the number of free objects in cache.
   size_t length() const { return static_cast<size_t>(counter_.value()); }
 
+  // Enables the lock-free batch stack that fronts the spin-locked span
+  // operations, so that transfer cache misses on this class stop serializing
+  // on lock_.  The stack requires two pointers of scratch space per object and
+  // is pointless for classes that bypass the freelist, so enabling can fail;
+  // returns true if the stack is (now) enabled.  Enabling is one-way.
+  bool EnableBatchStack();
+
+  bool batch_stack_enabled() const {
+    return batch_stack_enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns all batches parked in the batch stack to their spans so that the
+  // memory becomes reclaimable again.  Called from the background thread when
+  // plundering caches.  Returns the number of objects drained.
+  size_t DrainBatchStack() ABSL_LOCKS_EXCLUDED(lock_);
+
+  // Returns the completely-free spans parked in the span cache to the page
+  // heap so their memory becomes reclaimable again.  Called from the
+  // background thread when plundering caches; in between, the cache holds at
+  // most as many spans as the class freed whole since the previous drain, so
+  // its footprint follows the class's churn.  Returns the number of spans
+  // drained.
+  size_t DrainSpanCache() ABSL_LOCKS_EXCLUDED(lock_);
+
   // Returns the memory overhead (internal fragmentation) attributable
   // to the freelist.  This is memory lost when the size of elements
   // in a freelist doesn't exactly divide the page-size (an 8192-byte
@@ -115,6 +158,12 @@ class CentralFreeList {
   size_t NumSpansInList(int n) ABSL_LOCKS_EXCLUDED(lock_);
   SpanStats GetSpanStats() const;
 
+  // Returns the span stats published by the most recent span allocation or
+  // return.  Like GetSpanStats() this takes no lock, but the fields are
+  // additionally mutually consistent: they were captured together under lock_
+  // rather than read from independently updated counters.
+  SpanStats GetSpanStatsSnapshot() const { return span_stats_snapshot_.Read(); }
+
   // Reports span utilization histogram stats.
   void PrintSpanUtilStats(Printer* out);
   void PrintSpanUtilStatsInPbtxt(PbtxtRegion* region);
@@ -126,8 +175,31 @@ class CentralFreeList {
   // histogram.
   size_t NumSpansWith(uint16_t bitwidth) const;
 
+  // Returns true if this size class may revisit its span freelist
+  // representation at runtime (see Span::SupportsBothRepresentations).
+  bool adaptive_representation() const { return adaptive_representation_; }
+
+  // Returns true if spans populated now would be built with the bitmap
+  // representation rather than the compressed list.
+  bool UsesBitmapRepresentation() ABSL_LOCKS_EXCLUDED(lock_) {
+    TelemetrySpinLockHolder h(&lock_, LockId::kCentralFreeList);
+    return use_bitmap_representation_;
+  }
+
+  // Returns the number of times the representation choice has flipped.
+  size_t representation_switches() const {
+    return static_cast<size_t>(representation_switches_.value());
+  }
+
   Forwarder& forwarder() { return forwarder_; }
 
+  // Used by the fork handlers to quiesce the freelist across fork(), so the
+  // child does not inherit a held lock.
+  void AcquireInternalLocks() ABSL_EXCLUSIVE_LOCK_FUNCTION(lock_) {
+    lock_.Lock();
+  }
+  void ReleaseInternalLocks() ABSL_UNLOCK_FUNCTION(lock_) { lock_.Unlock(); }
+
  private:
   // Release an object to spans.
   // Returns object's span if it become completely free.
@@ -135,6 +207,11 @@ class CentralFreeList {
                        uint32_t size_reciprocal)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
 
+  // Records <object>'s position in the class's free order and, every
+  // kRepresentationEvalInterval frees, re-evaluates the span freelist
+  // representation from the fraction of address-monotone frees observed.
+  void RecordFreeOrder(void* object) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
   // Populate cache by fetching from the page heap.
   // May temporarily release lock_.
   // Fill a prefix of batch[0..N-1] with up to N elements removed from central
@@ -144,6 +221,35 @@ class CentralFreeList {
   // Allocate a span from the forwarder.
   Span* AllocateSpan();
 
+  // Slow path of InsertRange: releases batch to its spans under lock_.
+  void InsertRangeSlow(absl::Span<void*> batch) ABSL_LOCKS_EXCLUDED(lock_);
+
+  // Pushes a full batch onto the batch stack.
+  // REQUIRES: batch.size() == batch_length_.
+  void PushBatchStack(absl::Span<void*> batch);
+
+  // Pops one batch (batch_length_ objects) from the batch stack into <batch>.
+  // Returns false if the stack is empty.
+  bool TryPopBatchStack(void** batch);
+
+  // The batch stack head packs the address of the top batch with a
+  // modification counter in the bits above kBatchStackTagShift; the counter
+  // advances on every successful push and pop, which protects concurrent pops
+  // against ABA when a popped batch is reinserted while another thread still
+  // holds a stale head.  Clamped like kTagShift for platforms where pointers
+  // occupy the full word.
+  static constexpr int kBatchStackTagShift = std::min(kAddressBits, 63);
+  static void* BatchStackPtr(uintptr_t head) {
+    return reinterpret_cast<void*>(
+        head & ((uintptr_t{1} << kBatchStackTagShift) - 1));
+  }
+  static uintptr_t MakeBatchStackHead(void* top, uintptr_t tag) {
+    return reinterpret_cast<uintptr_t>(top) | (tag << kBatchStackTagShift);
+  }
+  static uintptr_t BatchStackTag(uintptr_t head) {
+    return head >> kBatchStackTagShift;
+  }
+
   // Parses nonempty_ lists and returns span from the list with the lowest
   // possible index.
   // Returns the span if one exists in the nonempty_ lists. Else, returns
@@ -154,10 +260,9 @@ class CentralFreeList {
   uint8_t GetFirstNonEmptyIndex() const;
 
   // Returns index into nonempty_ based on the number of allocated objects for
-  // the span. Depending on the number of objects per span, either the absolute
-  // number of allocated objects or the absl::bit_width(allocated), passed as
-  // bitwidth, is used to to calculate the list index.
-  uint8_t IndexFor(uint16_t allocated, uint8_t bitwidth);
+  // the span. The emptiest spans keep one exact list per allocated count;
+  // fuller spans map proportionally into equal-width fullness buckets.
+  uint8_t IndexFor(uint16_t allocated);
 
   // Records span utilization in objects_to_span_ map. Instead of using the
   // absolute number of allocated objects, it uses absl::bit_width(allocated),
@@ -180,14 +285,22 @@ class CentralFreeList {
   size_t size_class_;  // My size class (immutable after Init())
   size_t object_size_;
   size_t objects_per_span_;
+  // Number of objects the transfer cache moves per batch; batches of exactly
+  // this size are eligible for the batch stack (immutable after Init()).
+  size_t batch_length_ = 0;
   // Size reciprocal is used to replace division with multiplication when
   // computing object indices in the Span bitmap.
   uint32_t size_reciprocal_ = 0;
+  // Reciprocal of the proportional fullness bucket width; see IndexFor.
+  uint32_t fullness_scale_ = 0;
   // Hint used for parsing through the nonempty_ lists. This prevents us from
   // parsing the lists with an index starting zero, if the lowest possible index
   // is higher than that.
   size_t first_nonempty_index_;
   Length pages_per_span_;
+  // Number of distinct span colors the class's tail waste can rotate through
+  // (immutable after Init()); 1 when spans cannot be colored.
+  size_t span_colors_;
 
   size_t num_spans() const {
     size_t requested = num_spans_requested_.value();
@@ -199,12 +312,14 @@ class CentralFreeList {
   void RecordSpanAllocated() ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
     counter_.LossyAdd(objects_per_span_);
     num_spans_requested_.LossyAdd(1);
+    span_stats_snapshot_.Publish(GetSpanStats());
   }
 
   void RecordMultiSpansDeallocated(size_t num_spans_returned)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
     counter_.LossyAdd(-num_spans_returned * objects_per_span_);
     num_spans_returned_.LossyAdd(num_spans_returned);
+    span_stats_snapshot_.Publish(GetSpanStats());
   }
 
   void UpdateObjectCounts(int num) ABSL_EXCLUSIVE_LOCKS_REQUIRED(lock_) {
@@ -222,6 +337,11 @@ class CentralFreeList {
   StatsCounter num_spans_requested_;
   StatsCounter num_spans_returned_;
 
+  // Consistent shadow copy of GetSpanStats(), republished whenever the span
+  // counters change (always under lock_), so that stats scrapes can read a
+  // coherent triple without stalling allocation.
+  SeqLockedData<SpanStats> span_stats_snapshot_;
+
   // Records histogram of span utilization.
   //
   // Each bucket in the histogram records number of live spans with
@@ -262,6 +382,40 @@ class CentralFreeList {
 #endif
   bool use_all_buckets_for_few_object_spans_;
 
+  // Span freelist representation for classes valid under both the compressed
+  // list and the bitmap (see Span::SupportsBothRepresentations).  Frees
+  // arriving in address-monotone runs favor the list, whose push appends to a
+  // hot array; shuffled frees favor the bitmap, whose push cost is order
+  // independent.  A flipped verdict applies to spans built afterwards; live
+  // spans keep the representation they were built with.
+  bool adaptive_representation_ = false;  // Immutable after Init().
+  bool use_bitmap_representation_ ABSL_GUARDED_BY(lock_) = true;
+  uintptr_t last_freed_ ABSL_GUARDED_BY(lock_) = 0;
+  bool last_free_ascending_ ABSL_GUARDED_BY(lock_) = false;
+  size_t monotone_frees_ ABSL_GUARDED_BY(lock_) = 0;
+  size_t observed_frees_ ABSL_GUARDED_BY(lock_) = 0;
+  // Number of representation flips; readable without taking lock_.
+  StatsCounter representation_switches_;
+
+  // Lock-free Treiber stack of full object batches that absorbs transfer
+  // cache misses for hot classes without touching lock_.  Objects within a
+  // batch are chained through their first word; the first object's second
+  // word links to the batch below, so the stack needs no storage beyond the
+  // objects themselves.  Empty (and disabled) when zero.
+  std::atomic<uintptr_t> batch_stack_{0};
+  std::atomic<bool> batch_stack_enabled_{false};
+
+  // A few completely-free spans parked for same-class reuse instead of being
+  // returned through the page heap: a class whose last object in a span frees
+  // commonly allocates a fresh span moments later during eviction/refill
+  // cycles, and serving that churn here avoids a pageheap_lock round trip in
+  // each direction.  Parked spans count as returned in the span stats and are
+  // re-requested on reuse, so the requested/returned deltas still expose the
+  // churn.  The background thread drains stragglers each plunder sweep.
+  static constexpr size_t kSpanCacheSize = 4;
+  Span* span_cache_[kSpanCacheSize] ABSL_GUARDED_BY(lock_) = {};
+  size_t span_cache_size_ ABSL_GUARDED_BY(lock_) = 0;
+
   ABSL_ATTRIBUTE_NO_UNIQUE_ADDRESS Forwarder forwarder_;
 };
 
@@ -278,11 +432,49 @@ inline void CentralFreeList<Forwarder>::Init(
   pages_per_span_ = forwarder_.class_to_pages(size_class);
   objects_per_span_ =
       pages_per_span_.in_bytes() / (object_size_ ? object_size_ : 1);
+
+  // Size the span color cycle from the tail waste left after carving
+  // objects_per_span_ objects.  Classes that opt into coloring but leave too
+  // little tail give up objects to make room: capacity is traded for
+  // set-index dispersion only for classes configured to pay for it.
+  size_t waste =
+      pages_per_span_.in_bytes() - objects_per_span_ * object_size_;
+  if (forwarder_.span_coloring(size_class)) {
+    const size_t wanted = (Span::kMaxColors - 1) * Span::kColorStride;
+    while (waste < wanted && objects_per_span_ > 1) {
+      --objects_per_span_;
+      waste += object_size_;
+    }
+  }
+  span_colors_ = std::min(Span::kMaxColors, waste / Span::kColorStride + 1);
+
+  batch_length_ = forwarder_.num_objects_to_move(size_class);
   size_reciprocal_ = Span::CalcReciprocal(object_size_);
   use_all_buckets_for_few_object_spans_ =
       use_all_buckets_for_few_object_spans &&
       objects_per_span_ <= 2 * kNumLists;
 
+  // Classes whose spans are valid under both freelist representations may
+  // have the choice revisited from the observed free order.  Cold (expanded)
+  // classes are excluded: the compressed list touches object memory, which
+  // they must not (see Span::IsNonIntrusive).  We do not adapt for
+  // small-but-slow, along with the other per-free accounting.
+#ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+  adaptive_representation_ =
+      !IsExpandedSizeClass(size_class) &&
+      Span::SupportsBothRepresentations(object_size_,
+                                        pages_per_span_.raw_num());
+#endif
+
+  // Precomputed reciprocal of the proportional bucket width used by
+  // IndexFor, so the per-free index computation multiplies instead of
+  // divides.  Zero (unused) when every reachable allocated count has an
+  // exact list.
+  if (objects_per_span_ > kNumExactLists) {
+    fullness_scale_ = (kNumExactLists << kFullnessShift) /
+                      (objects_per_span_ - kNumExactLists);
+  }
+
   // Records nonempty_ list index associated with the span with
   // objects_per_span_ number of allocated objects. Refer to the comment in
   // IndexFor(...) below for a detailed description.
@@ -291,8 +483,7 @@ inline void CentralFreeList<Forwarder>::Init(
           ? (kNumLists + 1 >= objects_per_span_
                  ? kNumLists + 1 - objects_per_span_
                  : 0)
-          : kNumLists -
-                std::min<size_t>(absl::bit_width(objects_per_span_), kNumLists);
+          : IndexFor(objects_per_span_);
 
   ASSERT(absl::bit_width(objects_per_span_) <= kSpanUtilBucketCapacity);
 }
@@ -300,7 +491,10 @@ inline void CentralFreeList<Forwarder>::Init(
 template <class Forwarder>
 inline Span* CentralFreeList<Forwarder>::ReleaseToSpans(
     void* object, Span* span, size_t object_size, uint32_t size_reciprocal) {
-  if (ABSL_PREDICT_FALSE(span->FreelistEmpty(object_size))) {
+  if (adaptive_representation_) {
+    RecordFreeOrder(object);
+  }
+  if (ABSL_PREDICT_FALSE(span->FreelistEmpty())) {
 #ifdef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
     nonempty_.prepend(span);
 #else
@@ -344,7 +538,7 @@ inline Span* CentralFreeList<Forwarder>::ReleaseToSpans(
   // If span allocation changes so that it moved to a different nonempty_ list,
   // we remove it from the previous list and add it to the desired list indexed
   // by cur_index.
-  const uint8_t cur_index = IndexFor(cur_allocated, cur_bitwidth);
+  const uint8_t cur_index = IndexFor(cur_allocated);
   if (cur_index != prev_index) {
     nonempty_.Remove(span, prev_index);
     nonempty_.Add(span, cur_index);
@@ -354,6 +548,37 @@ inline Span* CentralFreeList<Forwarder>::ReleaseToSpans(
 #endif
 }
 
+template <class Forwarder>
+inline void CentralFreeList<Forwarder>::RecordFreeOrder(void* object) {
+  const uintptr_t p = reinterpret_cast<uintptr_t>(object);
+  const bool ascending = p > last_freed_;
+  if (ascending == last_free_ascending_) {
+    ++monotone_frees_;
+  }
+  last_free_ascending_ = ascending;
+  last_freed_ = p;
+  if (ABSL_PREDICT_TRUE(++observed_frees_ < kRepresentationEvalInterval)) {
+    return;
+  }
+  observed_frees_ = 0;
+  const size_t monotone = monotone_frees_;
+  monotone_frees_ = 0;
+  // Crossover thresholds measured with BM_freelist_representation in
+  // span_benchmark.cc: monotone traffic runs markedly faster through the
+  // compressed list, while shuffled traffic (which scores about half its
+  // frees as monotone) favors the bitmap.  The band in between keeps the
+  // current choice so a noisy window does not thrash the representation.
+  const bool prev = use_bitmap_representation_;
+  if (monotone >= kRepresentationEvalInterval / 4 * 3) {
+    use_bitmap_representation_ = false;
+  } else if (monotone <= kRepresentationEvalInterval / 2) {
+    use_bitmap_representation_ = true;
+  }
+  if (use_bitmap_representation_ != prev) {
+    representation_switches_.LossyAdd(1);
+  }
+}
+
 template <class Forwarder>
 inline Span* CentralFreeList<Forwarder>::FirstNonEmptySpan() {
   // Scan nonempty_ lists in the range [first_nonempty_index_, kNumLists) and
@@ -375,8 +600,7 @@ inline uint8_t CentralFreeList<Forwarder>::GetFirstNonEmptyIndex() const {
 }
 
 template <class Forwarder>
-inline uint8_t CentralFreeList<Forwarder>::IndexFor(uint16_t allocated,
-                                                    uint8_t bitwidth) {
+inline uint8_t CentralFreeList<Forwarder>::IndexFor(uint16_t allocated) {
   // We would like to index into the nonempty_ list based on the number of
   // allocated objects from the span. Given a span with fewer allocated objects
   // (i.e. when it is more likely to be freed), we would like to map it to a
@@ -384,9 +608,10 @@ inline uint8_t CentralFreeList<Forwarder>::IndexFor(uint16_t allocated,
   //
   // The number of objects per span is less than or equal to 2 * kNumlists.
   // We index such spans by just the number of allocated objects.  When the
-  // allocated objects are in the range [1, 8], then we map the spans to buckets
-  // 7, 6, ... 0 respectively.  When the allocated objects are more than
-  // kNumlists, then we map the span to bucket 0.
+  // allocated objects are in the range [1, kNumLists], then we map the spans
+  // to buckets kNumLists - 1, kNumLists - 2, ... 0 respectively.  When the
+  // allocated objects are more than kNumlists, then we map the span to
+  // bucket 0.
   ASSUME(allocated > 0);
   if (use_all_buckets_for_few_object_spans_) {
     if (allocated <= kNumLists) {
@@ -394,20 +619,29 @@ inline uint8_t CentralFreeList<Forwarder>::IndexFor(uint16_t allocated,
     }
     return 0;
   }
-  // Depending on the number of kNumLists and the number of objects per span, we
-  // may have to clamp multiple buckets in index 0. It should be ok to do that
-  // because it is less beneficial to differentiate between spans that have 128
-  // vs 256 allocated objects, compared to those that have 16 vs 32 allocated
-  // objects.
+  // The emptiest spans keep one exact list per allocated count, so a span one
+  // or two frees away from death never mixes with fuller spans and stays
+  // deprioritized until it dies.
+  if (allocated <= kNumExactLists) {
+    return kNumLists - allocated;
+  }
+  // The rest of the span's range splits into kNumExactLists equal-width
+  // fullness buckets.  Equal widths keep the full end strictly bucketed --
+  // under the former bit_width mapping, seven eighths of a large span's range
+  // shared one list, so RemoveRange could carve from a span far from full --
+  // and so carving concentrates on the fullest spans and sparse spans die
+  // sooner.  fullness_scale_ replaces the division by the bucket width with a
+  // multiplication.
   //
-  // Consider objects_per_span = 1024 and kNumLists = 8. The following examples
-  // show spans with allocated objects in the range [a, b) indexed to the
-  // nonempty_[idx] list using a notation [a, b) -> idx.
-  // [1, 2) -> 7, [2, 4) -> 6, [4, 8) -> 5, [8, 16) -> 4, [16, 32) -> 3, [32,
-  // 64) -> 2, [64, 128) -> 1, [128, 1024) -> 0.
-  ASSUME(bitwidth > 0);
-  const uint8_t offset = std::min<size_t>(bitwidth, kNumLists);
-  const uint8_t index = kNumLists - offset;
+  // Consider objects_per_span = 1032 and kNumLists = 16. Spans with allocated
+  // objects in the range [a, b) index to the nonempty_[idx] list using a
+  // notation [a, b) -> idx as:
+  // [1, 2) -> 15, [2, 3) -> 14, ... [8, 9) -> 8, then
+  // [9, 137) -> 7, [137, 265) -> 6, ... [905, 1033) -> 0.
+  const size_t scaled =
+      ((allocated - kNumExactLists - 1) * size_t{fullness_scale_}) >>
+      kFullnessShift;
+  const uint8_t index = kNumExactLists - 1 - scaled;
   ASSUME(index < kNumLists);
   return index;
 }
@@ -416,7 +650,7 @@ template <class Forwarder>
 inline size_t CentralFreeList<Forwarder>::NumSpansInList(int n) {
   ASSUME(n >= 0);
   ASSUME(n < kNumLists);
-  absl::base_internal::SpinLockHolder h(&lock_);
+  TelemetrySpinLockHolder h(&lock_, LockId::kCentralFreeList);
 #ifdef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
   return nonempty_.length();
 #else
@@ -428,6 +662,21 @@ template <class Forwarder>
 inline void CentralFreeList<Forwarder>::InsertRange(absl::Span<void*> batch) {
   TC_CHECK(!batch.empty());
   TC_CHECK_LE(batch.size(), kMaxObjectsToMove);
+
+  // Full batches from hot classes are parked on the lock-free batch stack,
+  // skipping both the span mapping and lock_.
+  if (batch_stack_enabled() && batch.size() == batch_length_) {
+    PushBatchStack(batch);
+    counter_.LossyAdd(batch.size());
+    return;
+  }
+
+  InsertRangeSlow(batch);
+}
+
+template <class Forwarder>
+inline void CentralFreeList<Forwarder>::InsertRangeSlow(
+    absl::Span<void*> batch) {
   Span* spans[kMaxObjectsToMove];
   // First, map objects to spans and prefetch spans outside of our mutex
   // (to reduce critical section size and cache misses).
@@ -450,7 +699,7 @@ inline void CentralFreeList<Forwarder>::InsertRange(absl::Span<void*> batch) {
     // Use local copy of variables to ensure that they are not reloaded.
     size_t object_size = object_size_;
     uint32_t size_reciprocal = size_reciprocal_;
-    absl::base_internal::SpinLockHolder h(&lock_);
+    TelemetrySpinLockHolder h(&lock_, LockId::kCentralFreeList);
     for (int i = 0; i < batch.size(); ++i) {
       Span* span =
           ReleaseToSpans(batch[i], spans[i], object_size, size_reciprocal);
@@ -462,6 +711,12 @@ inline void CentralFreeList<Forwarder>::InsertRange(absl::Span<void*> batch) {
 
     RecordMultiSpansDeallocated(free_count);
     UpdateObjectCounts(batch.size());
+
+    // Park what fits in the span cache for same-class reuse; only the
+    // overflow takes the page-heap trip below.
+    while (free_count > 0 && span_cache_size_ < kSpanCacheSize) {
+      span_cache_[span_cache_size_++] = free_spans[--free_count];
+    }
   }
 
   // Then, release all free spans into page heap under its mutex.
@@ -475,6 +730,13 @@ template <class Forwarder>
 inline int CentralFreeList<Forwarder>::RemoveRange(void** batch, int N) {
   ASSUME(N > 0);
 
+  // Serve full-batch requests from the lock-free batch stack when possible.
+  if (batch_stack_enabled() && static_cast<size_t>(N) == batch_length_ &&
+      TryPopBatchStack(batch)) {
+    counter_.LossyAdd(-N);
+    return N;
+  }
+
   if (objects_per_span_ == 1) {
     // If there is only 1 object per span, skip CentralFreeList entirely.
     Span* span = AllocateSpan();
@@ -488,7 +750,7 @@ inline int CentralFreeList<Forwarder>::RemoveRange(void** batch, int N) {
   // Use local copy of variable to ensure that it is not reloaded.
   size_t object_size = object_size_;
   int result = 0;
-  absl::base_internal::SpinLockHolder h(&lock_);
+  TelemetrySpinLockHolder h(&lock_, LockId::kCentralFreeList);
 
   do {
     Span* span = FirstNonEmptySpan();
@@ -501,13 +763,20 @@ inline int CentralFreeList<Forwarder>::RemoveRange(void** batch, int N) {
     // We do not collect histogram stats for small-but-slow.
     int here = span->FreelistPopBatch(batch + result, N - result, object_size);
     TC_ASSERT_GT(here, 0);
-    if (span->FreelistEmpty(object_size)) {
+    if (span->FreelistEmpty()) {
       nonempty_.remove(span);
     }
 #else
     const uint16_t prev_allocated = span->Allocated();
     const uint8_t prev_bitwidth = absl::bit_width(prev_allocated);
     const uint8_t prev_index = span->nonempty_index();
+    // If this span drains below, the loop continues with its successor.
+    // Start pulling the successor's struct in now, while this span is
+    // carved, so a multi-span refill does not stall on back-to-back misses.
+    Span* next_span = nonempty_.PeekSuccessor(span, prev_index);
+    if (next_span != nullptr) {
+      next_span->Prefetch();
+    }
     int here = span->FreelistPopBatch(batch + result, N - result, object_size);
     TC_ASSERT_GT(here, 0);
     // As the objects are being popped from the span, its utilization might
@@ -520,13 +789,19 @@ inline int CentralFreeList<Forwarder>::RemoveRange(void** batch, int N) {
       RecordSpanUtil(prev_bitwidth, /*increase=*/false);
       RecordSpanUtil(cur_bitwidth, /*increase=*/true);
     }
-    if (span->FreelistEmpty(object_size)) {
+    if (span->FreelistEmpty()) {
       nonempty_.Remove(span, prev_index);
+      // The successor's struct was prefetched above; by now it has likely
+      // arrived, so its freelist head index can be read cheaply.  Warm the
+      // object holding it before the next iteration pops from it.
+      if (next_span != nullptr && result + here < N) {
+        next_span->PrefetchFreelist(object_size);
+      }
     } else {
       // If span allocation changes so that it must be moved to a different
       // nonempty_ list, we remove it from the previous list and add it to the
       // desired list indexed by cur_index.
-      const uint8_t cur_index = IndexFor(cur_allocated, cur_bitwidth);
+      const uint8_t cur_index = IndexFor(cur_allocated);
       if (cur_index != prev_index) {
         nonempty_.Remove(span, prev_index);
         nonempty_.Add(span, cur_index);
@@ -540,21 +815,143 @@ inline int CentralFreeList<Forwarder>::RemoveRange(void** batch, int N) {
   return result;
 }
 
+template <class Forwarder>
+inline bool CentralFreeList<Forwarder>::EnableBatchStack() {
+  // Chaining a batch requires two pointers of scratch space in its first
+  // object, and classes with a single object per span bypass the freelist
+  // entirely.
+  if (object_size_ < 2 * sizeof(void*) || objects_per_span_ <= 1 ||
+      batch_length_ == 0) {
+    return false;
+  }
+  batch_stack_enabled_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+template <class Forwarder>
+inline void CentralFreeList<Forwarder>::PushBatchStack(
+    absl::Span<void*> batch) {
+  TC_ASSERT_EQ(batch.size(), batch_length_);
+  // Chain the objects through their first word.
+  for (size_t i = 0; i + 1 < batch.size(); ++i) {
+    *reinterpret_cast<void**>(batch[i]) = batch[i + 1];
+  }
+  *reinterpret_cast<void**>(batch[batch.size() - 1]) = nullptr;
+
+  void** const link = reinterpret_cast<void**>(batch[0]) + 1;
+  uintptr_t old_head = batch_stack_.load(std::memory_order_relaxed);
+  do {
+    *link = BatchStackPtr(old_head);
+  } while (!batch_stack_.compare_exchange_weak(
+      old_head, MakeBatchStackHead(batch[0], BatchStackTag(old_head) + 1),
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <class Forwarder>
+inline bool CentralFreeList<Forwarder>::TryPopBatchStack(void** batch) {
+  uintptr_t old_head = batch_stack_.load(std::memory_order_acquire);
+  void* top;
+  for (;;) {
+    top = BatchStackPtr(old_head);
+    if (top == nullptr) {
+      return false;
+    }
+    // If another thread pops <top> and hands it out before we read its link
+    // word, the value read here is garbage.  That is benign: the head has
+    // changed (the tag advances on every push and pop), so the
+    // compare-exchange below fails and we retry with a fresh head.  The read
+    // itself is safe because spans are never unmapped.
+    void* next = *(reinterpret_cast<void**>(top) + 1);
+    if (batch_stack_.compare_exchange_weak(
+            old_head, MakeBatchStackHead(next, BatchStackTag(old_head) + 1),
+            std::memory_order_acquire, std::memory_order_acquire)) {
+      break;
+    }
+  }
+
+  // The batch is ours now; unchain it.
+  size_t n = 0;
+  for (void* object = top; object != nullptr;
+       object = *reinterpret_cast<void**>(object)) {
+    batch[n++] = object;
+  }
+  TC_ASSERT_EQ(n, batch_length_);
+  return true;
+}
+
+template <class Forwarder>
+inline size_t CentralFreeList<Forwarder>::DrainBatchStack() {
+  if (!batch_stack_enabled()) {
+    return 0;
+  }
+  size_t drained = 0;
+  void* batch[kMaxObjectsToMove];
+  while (TryPopBatchStack(batch)) {
+    counter_.LossyAdd(-static_cast<int64_t>(batch_length_));
+    InsertRangeSlow(absl::MakeSpan(batch, batch_length_));
+    drained += batch_length_;
+  }
+  return drained;
+}
+
+template <class Forwarder>
+inline size_t CentralFreeList<Forwarder>::DrainSpanCache() {
+  Span* spans[kSpanCacheSize];
+  size_t n;
+  {
+    TelemetrySpinLockHolder h(&lock_, LockId::kCentralFreeList);
+    n = span_cache_size_;
+    for (size_t i = 0; i < n; ++i) {
+      spans[i] = span_cache_[i];
+    }
+    span_cache_size_ = 0;
+  }
+  // The spans were recorded as returned when they were parked; only the
+  // page-heap handoff remains.
+  if (n > 0) {
+    forwarder_.DeallocateSpans(size_class_, objects_per_span_,
+                               absl::MakeSpan(spans, n));
+  }
+  return n;
+}
+
 // Fetch memory from the system and add to the central cache freelist.
 template <class Forwarder>
 inline int CentralFreeList<Forwarder>::Populate(void** batch, int N)
     ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  // Same-class churn is served from the span cache first: the parked span
+  // needs only a freelist rebuild, not a page-heap allocation.
+  Span* span = nullptr;
+  if (span_cache_size_ > 0) {
+    span = span_cache_[--span_cache_size_];
+  }
+  // Capture the freelist representation verdict while lock_ is still held.
+  const bool use_bitmap = use_bitmap_representation_;
+
   // Release central list lock while operating on pageheap
   // Note, this could result in multiple calls to populate each allocating
   // a new span and the pushing those partially full spans onto nonempty.
   lock_.Unlock();
 
-  Span* span = AllocateSpan();
-  if (ABSL_PREDICT_FALSE(span == nullptr)) {
-    return 0;
+  if (span == nullptr) {
+    span = AllocateSpan();
+    if (ABSL_PREDICT_FALSE(span == nullptr)) {
+      return 0;
+    }
   }
 
-  int result = span->BuildFreelist(object_size_, objects_per_span_, batch, N);
+  // Rotate the carve offset across spans so that same-class objects from
+  // different spans land on different cache set indices.
+  size_t color = 0;
+  if (span_colors_ > 1 && forwarder_.span_coloring(size_class_)) {
+    color = (span->first_page().index() % span_colors_) * Span::kColorStride;
+  }
+  int result =
+      adaptive_representation_
+          ? span->BuildFreelist(object_size_, objects_per_span_, batch, N,
+                                color, use_bitmap)
+          : span->BuildFreelist(object_size_, objects_per_span_, batch, N,
+                                color);
   TC_ASSERT_GT(result, 0);
   // This is a cheaper check than using FreelistEmpty().
   bool span_empty = result == objects_per_span_;
@@ -574,7 +971,7 @@ inline int CentralFreeList<Forwarder>::Populate(void** batch, int N)
   const uint8_t bitwidth = absl::bit_width(allocated);
   RecordSpanUtil(bitwidth, /*increase=*/true);
   if (!span_empty) {
-    const uint8_t index = IndexFor(allocated, bitwidth);
+    const uint8_t index = IndexFor(allocated);
     nonempty_.Add(span, index);
     span->set_nonempty_index(index);
   }
@@ -106,7 +106,7 @@ TEST_P(StaticForwarderTest, Simple) {
 
   absl::FixedArray<void*> batch(objects_per_span_);
   size_t allocated = span->BuildFreelist(object_size_, objects_per_span_,
-                                         &batch[0], objects_per_span_);
+                                         &batch[0], objects_per_span_, 0);
   ASSERT_EQ(allocated, objects_per_span_);
 
   EXPECT_EQ(size_class_, tc_globals.pagemap().sizeclass(span->first_page()));
@@ -206,7 +206,7 @@ class StaticForwarderEnvironment {
     d->span = span;
 
     size_t allocated = span->BuildFreelist(object_size_, objects_per_span_,
-                                           d->batch, batch_size_);
+                                           d->batch, batch_size_, 0);
     EXPECT_LE(allocated, objects_per_span_);
 
     EXPECT_EQ(size_class_, tc_globals.pagemap().sizeclass(span->first_page()));
@@ -388,6 +388,38 @@ TEST_P(CentralFreeListTest, IsolatedSmoke) {
   }
 }
 
+TEST_P(CentralFreeListTest, SpanStatsSnapshotTracksSpanStats) {
+  TypeParam e(std::get<0>(GetParam()).size, std::get<0>(GetParam()).pages,
+              std::get<0>(GetParam()).num_to_move, std::get<1>(GetParam()));
+
+  // Before any span operation, the snapshot is empty.
+  SpanStats snapshot = e.central_freelist().GetSpanStatsSnapshot();
+  EXPECT_EQ(snapshot.num_spans_requested, 0);
+  EXPECT_EQ(snapshot.num_spans_returned, 0);
+  EXPECT_EQ(snapshot.obj_capacity, 0);
+
+  absl::FixedArray<void*> batch(e.batch_size());
+  int allocated = e.central_freelist().RemoveRange(&batch[0], e.batch_size());
+  ASSERT_GT(allocated, 0);
+
+  // Skip the checks for objects_per_span = 1 since such spans skip most of
+  // the central freelist's logic.
+  if (e.objects_per_span() != 1) {
+    snapshot = e.central_freelist().GetSpanStatsSnapshot();
+    EXPECT_EQ(snapshot.num_spans_requested, 1);
+    EXPECT_EQ(snapshot.num_spans_returned, 0);
+    EXPECT_EQ(snapshot.obj_capacity, e.objects_per_span());
+  }
+
+  e.central_freelist().InsertRange(absl::MakeSpan(&batch[0], allocated));
+  if (e.objects_per_span() != 1) {
+    snapshot = e.central_freelist().GetSpanStatsSnapshot();
+    EXPECT_EQ(snapshot.num_spans_requested, 1);
+    EXPECT_EQ(snapshot.num_spans_returned, 1);
+    EXPECT_EQ(snapshot.obj_capacity, 0);
+  }
+}
+
 TEST_P(CentralFreeListTest, SpanUtilizationHistogram) {
   TypeParam e(std::get<0>(GetParam()).size, std::get<0>(GetParam()).pages,
               std::get<0>(GetParam()).num_to_move, std::get<1>(GetParam()));
@@ -510,6 +542,74 @@ TEST_P(CentralFreeListTest, SinglePopulate) {
   }
 }
 
+// For size classes valid under both span freelist representations, the
+// central freelist revisits the choice from the observed free order:
+// address-monotone frees flip new spans to the compressed list, and
+// direction-alternating frees flip them back to the bitmap.
+TEST(CentralFreeListAdaptiveRepresentationTest, FollowsFreeOrder) {
+#ifdef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+  GTEST_SKIP() << "Adaptive representation is disabled for small-but-slow.";
+#else
+  TypeParam e(kPageSize / 32, 1, 32, false);
+  auto& cfl = e.central_freelist();
+  ASSERT_TRUE(cfl.adaptive_representation());
+  EXPECT_TRUE(cfl.UsesBitmapRepresentation());
+  EXPECT_EQ(cfl.representation_switches(), 0);
+
+  const size_t objects_per_span = e.objects_per_span();
+  std::vector<void*> objects(objects_per_span);
+  // Drains one span and returns every object; InsertRangeSlow releases the
+  // batch in order, so the batch order is the observed free order.
+  auto cycle = [&](bool alternate) {
+    size_t fetched = 0;
+    while (fetched < objects_per_span) {
+      int got = cfl.RemoveRange(&objects[fetched],
+                                objects_per_span - fetched);
+      ASSERT_GT(got, 0);
+      fetched += got;
+    }
+    std::sort(objects.begin(), objects.end());
+    if (alternate) {
+      // Interleave objects from both ends of the span so the free direction
+      // flips on every object.
+      std::vector<void*> zigzag;
+      zigzag.reserve(objects_per_span);
+      for (size_t lo = 0, hi = objects_per_span; lo < hi;) {
+        zigzag.push_back(objects[lo++]);
+        if (lo < hi) zigzag.push_back(objects[--hi]);
+      }
+      objects = std::move(zigzag);
+    }
+    cfl.InsertRange(absl::MakeSpan(objects));
+  };
+
+  const size_t cycles_per_window =
+      central_freelist_internal::kRepresentationEvalInterval / objects_per_span;
+  for (size_t i = 0;
+       i < 2 * cycles_per_window && cfl.representation_switches() == 0; ++i) {
+    cycle(/*alternate=*/false);
+  }
+  EXPECT_EQ(cfl.representation_switches(), 1);
+  EXPECT_FALSE(cfl.UsesBitmapRepresentation());
+
+  for (size_t i = 0;
+       i < 2 * cycles_per_window && cfl.representation_switches() == 1; ++i) {
+    cycle(/*alternate=*/true);
+  }
+  EXPECT_EQ(cfl.representation_switches(), 2);
+  EXPECT_TRUE(cfl.UsesBitmapRepresentation());
+#endif
+}
+
+TEST(CentralFreeListAdaptiveRepresentationTest, IneligibleClasses) {
+  // Multi-page spans cannot use the compressed list, and objects too small
+  // for the bitmap cannot leave it; neither class may adapt.
+  TypeParam multi_page(kPageSize, 4, 2, false);
+  EXPECT_FALSE(multi_page.central_freelist().adaptive_representation());
+  TypeParam small_object(16, 1, 32, false);
+  EXPECT_FALSE(small_object.central_freelist().adaptive_representation());
+}
+
 // Tests whether the index generated by the input indexing function matches the
 // index of the span on which allocations and deallocation operations are
 // carried out.  The test first allocates objects and deallocates them.  After
@@ -562,7 +662,9 @@ void TestIndexing(TypeParam& e, IndexingFunc f) {
   EXPECT_EQ(e.central_freelist().NumSpansInList(0), 0);
 }
 
-TEST_P(CentralFreeListTest, BitwidthIndexedNonEmptyLists) {
+TEST_P(CentralFreeListTest, FullnessIndexedNonEmptyLists) {
+  using central_freelist_internal::kFullnessShift;
+  using central_freelist_internal::kNumExactLists;
   TypeParam e(std::get<0>(GetParam()).size, std::get<0>(GetParam()).pages,
               std::get<0>(GetParam()).num_to_move, std::get<1>(GetParam()));
   if (e.objects_per_span() <= 2 * kNumLists &&
@@ -570,11 +672,18 @@ TEST_P(CentralFreeListTest, BitwidthIndexedNonEmptyLists) {
     GTEST_SKIP()
         << "Skipping test as one hot encoding used for few object spans.";
   }
-  auto bitwidth_indexing = [](size_t allocated) {
-    size_t bitwidth = absl::bit_width(allocated);
-    return kNumLists - std::min(bitwidth, kNumLists);
+  // Mirrors IndexFor: exact lists for the emptiest spans, then equal-width
+  // fullness buckets computed with the same reciprocal arithmetic.
+  auto fullness_indexing = [&](size_t allocated) {
+    if (allocated <= kNumExactLists) {
+      return kNumLists - allocated;
+    }
+    const size_t scale = (kNumExactLists << kFullnessShift) /
+                         (e.objects_per_span() - kNumExactLists);
+    return kNumExactLists - 1 -
+           (((allocated - kNumExactLists - 1) * scale) >> kFullnessShift);
   };
-  TestIndexing(e, bitwidth_indexing);
+  TestIndexing(e, fullness_indexing);
 }
 
 TEST_P(CentralFreeListTest, DirectIndexedEncodedNonEmptyLists) {
@@ -681,15 +790,12 @@ TEST_P(CentralFreeListTest, SpanPriority) {
     for (int i = kNumLists - 2; i >= 0; --i) {
       EXPECT_EQ(e.central_freelist().NumSpansInList(i), 0);
     }
-  } else if (e.objects_per_span() <= 2 * kNumLists &&
-             e.use_all_buckets_for_few_object_spans() == true) {
+  } else {
     // We should have only one span in the third-last nonempty_ list; this is
-    // the span from which we should have allocated the last object.
+    // the span from which we should have allocated the last object.  Both
+    // mappings keep one exact list per allocated count this close to empty,
+    // so the span with three allocated objects lands there either way.
     EXPECT_EQ(e.central_freelist().NumSpansInList(kNumLists - 3), 1);
-  } else {
-    // We should have only one span in the second-last nonempty_ list; this is
-    // the span from which we should have allocated the last object.
-    EXPECT_EQ(e.central_freelist().NumSpansInList(kNumLists - 2), 1);
   }
   // Return previously allocated object.
   e.central_freelist().InsertRange({batch, 1});
@@ -805,11 +911,124 @@ TEST_P(CentralFreeListTest, PassSpanDensityToPageheap) {
       e.central_freelist().InsertRange({&objects[returned], to_return});
       returned += to_return;
     }
+    // The completely-free span parks in the span cache; draining hands it to
+    // the page heap and satisfies the expectation above.
+    e.central_freelist().DrainSpanCache();
   };
   test_function(1, AccessDensityPrediction::kDense);
   test_function(e.objects_per_span(), AccessDensityPrediction::kDense);
 }
 
+TEST_P(CentralFreeListTest, BatchStack) {
+  TypeParam e(std::get<0>(GetParam()).size, std::get<0>(GetParam()).pages,
+              std::get<0>(GetParam()).num_to_move, std::get<1>(GetParam()));
+
+  if (!e.central_freelist().EnableBatchStack()) {
+    // Only classes whose objects cannot hold the two chaining pointers, or
+    // that bypass the freelist entirely, may be declined.
+    EXPECT_TRUE(std::get<0>(GetParam()).size < 2 * sizeof(void*) ||
+                e.objects_per_span() == 1);
+    return;
+  }
+  EXPECT_TRUE(e.central_freelist().batch_stack_enabled());
+
+  absl::FixedArray<void*> batch(e.batch_size());
+  const int allocated =
+      e.central_freelist().RemoveRange(&batch[0], e.batch_size());
+  ASSERT_GT(allocated, 0);
+  if (allocated != e.batch_size()) {
+    // Partial batches take the span path; nothing stack-specific to check.
+    e.central_freelist().InsertRange(absl::MakeSpan(&batch[0], allocated));
+    EXPECT_EQ(e.central_freelist().DrainBatchStack(), 0);
+    return;
+  }
+
+  // A full batch parks on the stack without being released to spans...
+  e.central_freelist().InsertRange(absl::MakeSpan(&batch[0], allocated));
+  EXPECT_EQ(e.central_freelist().length(), e.objects_per_span());
+
+  // ...and the next full-batch request is served straight from the stack
+  // without touching spans.
+  absl::FixedArray<void*> popped(e.batch_size());
+  EXPECT_CALL(e.forwarder(), AllocateSpan).Times(0);
+  ASSERT_EQ(e.central_freelist().RemoveRange(&popped[0], e.batch_size()),
+            e.batch_size());
+  EXPECT_THAT(popped, testing::UnorderedElementsAreArray(batch));
+
+  // Draining a parked batch releases the objects back to their spans.
+  e.central_freelist().InsertRange(absl::MakeSpan(&popped[0], allocated));
+  EXPECT_EQ(e.central_freelist().DrainBatchStack(), e.batch_size());
+  EXPECT_EQ(e.central_freelist().DrainBatchStack(), 0);
+  EXPECT_EQ(e.central_freelist().length(), e.objects_per_span());
+
+  // Pull every object out and return them all (with a final drain for any
+  // batch that parked on the stack) so the environment sees the span freed.
+  absl::FixedArray<void*> rest(e.objects_per_span());
+  size_t taken = 0;
+  while (taken < e.objects_per_span()) {
+    const size_t want =
+        std::min<size_t>(e.batch_size(), e.objects_per_span() - taken);
+    int got = e.central_freelist().RemoveRange(&rest[taken], want);
+    ASSERT_GT(got, 0);
+    taken += got;
+  }
+  for (size_t i = 0; i < taken; i += e.batch_size()) {
+    const size_t n = std::min<size_t>(e.batch_size(), taken - i);
+    e.central_freelist().InsertRange(absl::MakeSpan(&rest[i], n));
+  }
+  e.central_freelist().DrainBatchStack();
+}
+
+TEST_P(CentralFreeListTest, SpanCacheServesSameClassChurn) {
+  TypeParam e(std::get<0>(GetParam()).size, std::get<0>(GetParam()).pages,
+              std::get<0>(GetParam()).num_to_move, std::get<1>(GetParam()));
+  if (e.objects_per_span() == 1) {
+    // Single-object spans bypass the central freelist and its span cache.
+    return;
+  }
+
+  const size_t n = e.objects_per_span();
+  std::vector<void*> objects(n);
+  auto fetch_all = [&] {
+    size_t taken = 0;
+    while (taken < n) {
+      const size_t want = std::min<size_t>(e.batch_size(), n - taken);
+      int got = e.central_freelist().RemoveRange(&objects[taken], want);
+      ASSERT_GT(got, 0);
+      taken += got;
+    }
+  };
+  auto return_all = [&] {
+    for (size_t i = 0; i < n; i += e.batch_size()) {
+      const size_t m = std::min<size_t>(e.batch_size(), n - i);
+      e.central_freelist().InsertRange(absl::MakeSpan(&objects[i], m));
+    }
+  };
+
+  // Fetch a whole span's objects and return them: the now-free span parks in
+  // the span cache instead of going back through the page heap, but counts
+  // as returned so the requested/returned delta still exposes the churn.
+  fetch_all();
+  return_all();
+  SpanStats stats = e.central_freelist().GetSpanStats();
+  EXPECT_EQ(stats.num_spans_requested, 1);
+  EXPECT_EQ(stats.num_spans_returned, 1);
+
+  // The next allocation of this class is served from the parked span with no
+  // page-heap round trip.
+  EXPECT_CALL(e.forwarder(), AllocateSpan).Times(0);
+  fetch_all();
+  stats = e.central_freelist().GetSpanStats();
+  EXPECT_EQ(stats.num_spans_requested, 2);
+
+  // Return everything again and drain, as the background thread does for
+  // spans that linger unreused.
+  return_all();
+  EXPECT_CALL(e.forwarder(), DeallocateSpans).Times(1);
+  EXPECT_EQ(e.central_freelist().DrainSpanCache(), 1);
+  EXPECT_EQ(e.central_freelist().DrainSpanCache(), 0);
+}
+
 TEST_P(CentralFreeListTest, SpanFragmentation) {
   // This test is primarily exercising Span itself to model how tcmalloc.cc uses
   // it, but this gives us a self-contained (and sanitizable) implementation of
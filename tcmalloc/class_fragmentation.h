@@ -0,0 +1,68 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_CLASS_FRAGMENTATION_H_
+#define TCMALLOC_CLASS_FRAGMENTATION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Cumulative per-size-class accounting of bytes callers asked for versus
+// bytes the class granted them.  Fed from the allocation sampling path,
+// extrapolated by each sample's weight, so both columns estimate total
+// traffic and their ratio estimates the class's internal fragmentation as
+// applications actually exercise it.  global_stats joins this with span
+// residency from SpanStats to rank the classes worth regenerating.
+class ClassFragmentationTracker {
+ public:
+  constexpr ClassFragmentationTracker() = default;
+
+  // Adds one sample's extrapolated traffic for size_class.  Bytes are
+  // pre-scaled by the sample's allocation estimate.
+  void Record(size_t size_class, size_t requested_bytes,
+              size_t allocated_bytes) {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    requested_bytes_[size_class].LossyAdd(requested_bytes);
+    allocated_bytes_[size_class].LossyAdd(allocated_bytes);
+  }
+
+  uint64_t requested_bytes(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return requested_bytes_[size_class].value();
+  }
+
+  uint64_t allocated_bytes(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return allocated_bytes_[size_class].value();
+  }
+
+ private:
+  StatsCounter requested_bytes_[kNumClasses];
+  StatsCounter allocated_bytes_[kNumClasses];
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_CLASS_FRAGMENTATION_H_
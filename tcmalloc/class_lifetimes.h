@@ -0,0 +1,119 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_CLASS_LIFETIMES_H_
+#define TCMALLOC_CLASS_LIFETIMES_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Per-size-class lifetime telemetry from sampled deallocations.
+//
+// MaybeUnsampleAllocation observes every sampled object's death and knows
+// how long it lived; folding that into a per-class short-lived fraction
+// tells the cache tiers which classes actually churn.  A class whose
+// objects mostly outlive the transfer cache's turnover gains nothing from
+// parking overflow batches in transfer-cache slots -- no refill will pop
+// them before plunder reclaims them -- so CpuCache routes such batches
+// straight to the central freelist and leaves slot capacity to the
+// high-churn classes that round-trip through it.
+class ClassLifetimeTracker {
+ public:
+  constexpr ClassLifetimeTracker() = default;
+
+  // Objects that die within this horizon count as short-lived.  One second
+  // tracks the background thread's cadence: transfer-cache slots that go
+  // unpopped for about that long become plunder candidates, so a class
+  // whose objects outlive it rarely profits from the slot it would occupy.
+  static constexpr absl::Duration kShortLivedThreshold = absl::Seconds(1);
+
+  // Records the death of a sampled object of <size_class> that lived for
+  // <lifetime>.
+  void RecordDeath(size_t size_class, absl::Duration lifetime) {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    const bool short_lived = lifetime < kShortLivedThreshold;
+    deaths_[size_class].Add(1);
+    if (short_lived) {
+      short_deaths_[size_class].Add(1);
+    }
+    // Fold into the recent-fraction estimate with 1/8 weight: one sample
+    // cannot flip the routing decision, but a phase change shows up within
+    // a few samples.  Racing updates may drop one another; the feed is the
+    // sampling path, so the estimate is statistical to begin with.
+    std::atomic<uint32_t>& fraction = short_fraction_[size_class];
+    const int32_t cur =
+        static_cast<int32_t>(fraction.load(std::memory_order_relaxed));
+    const int32_t target = short_lived ? kFractionScale : 0;
+    fraction.store(static_cast<uint32_t>(cur + (target - cur) / 8),
+                   std::memory_order_relaxed);
+  }
+
+  // Returns true when sampled deaths for <size_class> are numerous enough
+  // to trust and mostly long-lived, so a batch freed from a per-cpu cache
+  // should skip the transfer cache.
+  bool BypassTransferCacheOnFree(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    if (deaths_[size_class].value() < kMinDeaths) {
+      return false;
+    }
+    return short_fraction_[size_class].load(std::memory_order_relaxed) <
+           kFractionScale / 8;
+  }
+
+  uint64_t deaths(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return deaths_[size_class].value();
+  }
+
+  uint64_t short_deaths(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return short_deaths_[size_class].value();
+  }
+
+  // Recent short-lived fraction in [0, 1].
+  double short_lived_fraction(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return short_fraction_[size_class].load(std::memory_order_relaxed) /
+           static_cast<double>(kFractionScale);
+  }
+
+ private:
+  // Fixed-point scale of short_fraction_.
+  static constexpr int32_t kFractionScale = 256;
+  // Below this many sampled deaths the fraction is noise; keep the default
+  // routing.  The fraction starts at zero, so without this gate the first
+  // sampled death of a class could already divert its batches.
+  static constexpr int64_t kMinDeaths = 32;
+
+  StatsCounter deaths_[kNumClasses];
+  StatsCounter short_deaths_[kNumClasses];
+  std::atomic<uint32_t> short_fraction_[kNumClasses] = {};
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_CLASS_LIFETIMES_H_
@@ -30,7 +30,9 @@
 #include "absl/base/optimization.h"
 #include "absl/numeric/bits.h"
 #include "absl/strings/string_view.h"
+#include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/lock_telemetry.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/optimization.h"
 #include "tcmalloc/malloc_extension.h"
@@ -341,12 +343,14 @@ extern absl::base_internal::SpinLock pageheap_lock;
 
 class ABSL_SCOPED_LOCKABLE PageHeapSpinLockHolder {
  public:
-  PageHeapSpinLockHolder()
-      ABSL_EXCLUSIVE_LOCK_FUNCTION(pageheap_lock) = default;
-  ~PageHeapSpinLockHolder() ABSL_UNLOCK_FUNCTION() = default;
+  PageHeapSpinLockHolder() ABSL_EXCLUSIVE_LOCK_FUNCTION(pageheap_lock) {
+    LockWithTelemetry(pageheap_lock, LockId::kPageHeap);
+  }
+  ~PageHeapSpinLockHolder() ABSL_UNLOCK_FUNCTION() { pageheap_lock.Unlock(); }
 
  private:
-  AllocationGuardSpinLockHolder lock_{&pageheap_lock};
+  // In debug mode, enforces no allocations while the lock is held.
+  AllocationGuard enforce_no_alloc_;
 };
 
 // Evaluates a/b, avoiding division by zero.
@@ -0,0 +1,215 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/compaction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/new_extension.h"
+#include "tcmalloc/page_allocator.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Enough for a block cache's actively-movable working set; registration
+// fails gracefully when full.
+constexpr int kMaxMovableAllocations = 2048;
+
+ABSL_CONST_INIT absl::base_internal::SpinLock movable_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+// A fixed table of registrations, so registering is allocation-free.  Slots
+// are protected by movable_lock; the occupancy query, the replacement
+// allocation, and the callback all run with the lock dropped, and
+// generation detects a slot that was unregistered (and possibly reused)
+// while it was.
+struct Movable {
+  void* ptr = nullptr;  // nullptr marks a free slot.
+  size_t size = 0;
+  RelocationCallback callback = nullptr;
+  void* arg = nullptr;
+  uint64_t generation = 0;
+  // Non-null while CompactMovableAllocations has a move of this slot in
+  // flight: the owner adopts the replacement the moment the callback
+  // returns true, so UnregisterMovableAllocation must match it here even
+  // before the slot's ptr is rewritten under the lock.
+  void* moving_to = nullptr;
+};
+ABSL_CONST_INIT Movable movables[kMaxMovableAllocations]
+    ABSL_GUARDED_BY(movable_lock);
+
+}  // namespace
+
+bool RegisterMovableAllocation(void* ptr, size_t size,
+                               RelocationCallback callback, void* arg) {
+  if (ptr == nullptr || size == 0 || callback == nullptr) {
+    return false;
+  }
+  AllocationGuardSpinLockHolder l(&movable_lock);
+  for (int i = 0; i < kMaxMovableAllocations; ++i) {
+    Movable& m = movables[i];
+    if (m.ptr != nullptr) {
+      continue;
+    }
+    m.ptr = ptr;
+    m.size = size;
+    m.callback = callback;
+    m.arg = arg;
+    ++m.generation;
+    return true;
+  }
+  return false;
+}
+
+void UnregisterMovableAllocation(void* ptr) {
+  AllocationGuardSpinLockHolder l(&movable_lock);
+  for (int i = 0; i < kMaxMovableAllocations; ++i) {
+    Movable& m = movables[i];
+    if (m.ptr != ptr && m.moving_to != ptr) {
+      continue;
+    }
+    m.ptr = nullptr;
+    m.moving_to = nullptr;
+    ++m.generation;
+    return;
+  }
+}
+
+size_t CompactMovableAllocations(Length max_used_pages) {
+  size_t moved_bytes = 0;
+  for (int i = 0; i < kMaxMovableAllocations; ++i) {
+    void* ptr;
+    size_t size;
+    RelocationCallback callback;
+    void* arg;
+    uint64_t generation;
+    {
+      AllocationGuardSpinLockHolder l(&movable_lock);
+      const Movable& m = movables[i];
+      if (m.ptr == nullptr) {
+        continue;
+      }
+      ptr = m.ptr;
+      size = m.size;
+      callback = m.callback;
+      arg = m.arg;
+      generation = m.generation;
+    }
+
+    // Normal and cold buffers both live on filler-managed hugepages their
+    // own tier can refill densely.  Sampled allocations exist to be rare
+    // and observable; leave them alone.
+    const MemoryTag tag = GetMemoryTag(ptr);
+    if (tag != MemoryTag::kNormalP0 && tag != MemoryTag::kNormalP1 &&
+        tag != MemoryTag::kCold) {
+      continue;
+    }
+
+    std::optional<Length> used;
+    {
+      PageHeapSpinLockHolder l;
+      used = tc_globals.page_allocator().FillerUsedPagesContaining(
+          PageIdContaining(ptr), tag);
+    }
+    if (!used.has_value() || *used > max_used_pages) {
+      continue;
+    }
+
+    // The replacement comes from the buffer's own tier: a cold buffer must
+    // stay cold, both to keep its access hint and so the move densifies the
+    // cold heap instead of leaking its bytes into the normal one.
+    void* replacement =
+        tag == MemoryTag::kCold
+            ? ::operator new(size, std::nothrow, hot_cold_t{0})
+            : ::operator new(size, std::nothrow);
+    if (replacement == nullptr) {
+      break;
+    }
+    if (tag == MemoryTag::kCold &&
+        GetMemoryTag(replacement) != MemoryTag::kCold) {
+      // Below the cold-placement threshold the hint is advisory; without a
+      // same-tier replacement there is nothing to densify.
+      ::operator delete(replacement);
+      continue;
+    }
+    // The filler prefers well-filled hugepages, so the replacement normally
+    // lands on a denser one; when it lands back on the hugepage we are
+    // draining, moving would accomplish nothing.
+    if (HugePageContaining(replacement) == HugePageContaining(ptr)) {
+      ::operator delete(replacement);
+      continue;
+    }
+
+    // Publish the in-flight move before invoking the callback: once the
+    // callback returns true the owner may free the buffer and unregister it
+    // by the replacement pointer, which must find this slot.
+    bool slot_live;
+    {
+      AllocationGuardSpinLockHolder l(&movable_lock);
+      Movable& m = movables[i];
+      slot_live = m.generation == generation;
+      if (slot_live) {
+        m.moving_to = replacement;
+      }
+    }
+    if (!slot_live) {
+      // Unregistered (and possibly reused) while we allocated.
+      ::operator delete(replacement);
+      continue;
+    }
+
+    if (!callback(ptr, replacement, size, arg)) {
+      {
+        AllocationGuardSpinLockHolder l(&movable_lock);
+        Movable& m = movables[i];
+        if (m.generation == generation) {
+          m.moving_to = nullptr;
+        }
+      }
+      ::operator delete(replacement);
+      continue;
+    }
+
+    {
+      AllocationGuardSpinLockHolder l(&movable_lock);
+      Movable& m = movables[i];
+      if (m.generation == generation) {
+        m.ptr = replacement;
+        m.moving_to = nullptr;
+      }
+    }
+    ::operator delete(ptr);
+    moved_bytes += size;
+  }
+  return moved_bytes;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
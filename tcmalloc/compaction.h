@@ -0,0 +1,81 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Opt-in compaction for relocatable allocations.  A long-lived process
+// accumulates hugepages each pinned by a handful of live objects; the filler
+// cannot subrelease around them and the hugepage never returns to the huge
+// cache whole.  Subsystems whose buffers are movable (e.g. a block cache that
+// reaches every buffer through one pointer) register them here with a
+// relocation callback, and the background thread periodically migrates
+// registered objects off nearly-empty hugepages so those hugepages drain.
+// Both normal and cold-hinted (hot_cold_t) buffers are eligible; each is
+// evacuated within its own tier.  The cold tier gains the most from this
+// over month-long runs: its objects are rarely touched, so copies are cheap,
+// yet its sparse hugepages otherwise pin VA and RSS until a restart.
+
+#ifndef TCMALLOC_COMPACTION_H_
+#define TCMALLOC_COMPACTION_H_
+
+#include <cstddef>
+
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/pages.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Invoked on the background thread to move a registered buffer.  The
+// callback must copy size bytes from old_ptr to new_ptr, repoint the owner's
+// reference at new_ptr, and return true -- all while holding whatever lock
+// the owner uses to keep other threads off the buffer -- or return false to
+// veto the move (e.g. the buffer is pinned by a reader).  On true the engine
+// frees old_ptr and carries the registration over to new_ptr; on false it
+// frees new_ptr and the buffer stays put.
+using RelocationCallback = bool (*)(void* old_ptr, void* new_ptr, size_t size,
+                                    void* arg);
+
+// Marks the size-byte buffer at ptr, which must be the address returned by
+// the allocator, as movable via callback.  Returns false when the (fixed
+// size) registration table is full; the caller then simply keeps an
+// immovable buffer.
+bool RegisterMovableAllocation(void* ptr, size_t size,
+                               RelocationCallback callback, void* arg);
+
+// Removes the registration for ptr, after which the callback will not be
+// invoked for it again.  Must be called before the owner frees or resizes
+// the buffer, and must be synchronized with the owner's callback (e.g. under
+// the same lock the callback takes) so a move in flight either completes or
+// is vetoed first.
+void UnregisterMovableAllocation(void* ptr);
+
+// Migrates registered buffers that sit on a filler-managed hugepage with at
+// most max_used_pages pages in use, so those hugepages can drain and return
+// to the huge cache whole.  Replacement buffers come from the normal
+// allocation path, which prefers well-filled hugepages; a replacement that
+// lands back on the buffer's current hugepage is discarded.  Returns the
+// number of bytes migrated.  Must only be called from the background thread.
+size_t CompactMovableAllocations(Length max_used_pages);
+
+// Occupancy bound used by the background thread: a hugepage at most 1/8th
+// used is worth draining.
+inline constexpr Length kCompactionMaxUsedPages =
+    Length(kPagesPerHugePage.raw_num() / 8);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_COMPACTION_H_
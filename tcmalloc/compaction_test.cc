@@ -0,0 +1,223 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/compaction.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <new>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/new_extension.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Large enough to bypass the object caches, small enough that several fit on
+// a hugepage, so freeing neighbors leaves a sparsely used hugepage pinned by
+// the survivor.
+constexpr size_t kBufferSize = kHugePageSize / 4;
+
+int relocations = 0;
+
+// Owner-side callback: copy the contents and repoint the owner's reference,
+// which is passed as arg.
+bool Relocate(void* old_ptr, void* new_ptr, size_t size, void* arg) {
+  memcpy(new_ptr, old_ptr, size);
+  *static_cast<void**>(arg) = new_ptr;
+  ++relocations;
+  return true;
+}
+
+bool Veto(void* old_ptr, void* new_ptr, size_t size, void* arg) {
+  ++relocations;
+  return false;
+}
+
+// Adopts the replacement and immediately frees and unregisters it, as an
+// owner thread may do the moment the callback returns true.  The engine has
+// not yet rewritten the slot at that point, so the unregistration must match
+// the in-flight move rather than silently no-op.
+bool RelocateAndRelease(void* old_ptr, void* new_ptr, size_t size, void* arg) {
+  ++relocations;
+  UnregisterMovableAllocation(new_ptr);
+  ::operator delete(new_ptr);
+  return true;
+}
+
+TEST(CompactionTest, MigratesOffSparseHugePages) {
+  ScopedProfileSamplingRate sampling_rate(0);
+  relocations = 0;
+
+  // Carve out several hugepages, then free all but one buffer per hugepage
+  // group so each survivor pins a nearly-empty hugepage.
+  constexpr int kBuffersPerHugePage = kHugePageSize / kBufferSize;
+  constexpr int kSurvivors = 8;
+  constexpr int kBuffers = kSurvivors * kBuffersPerHugePage;
+  std::vector<void*> buffers;
+  for (int i = 0; i < kBuffers; ++i) {
+    buffers.push_back(::operator new(kBufferSize));
+  }
+  void* survivors[kSurvivors];
+  for (int i = 0; i < kBuffers; ++i) {
+    if (i % kBuffersPerHugePage == 0) {
+      void*& survivor = survivors[i / kBuffersPerHugePage];
+      survivor = buffers[i];
+      memset(survivor, 'a' + i / kBuffersPerHugePage, kBufferSize);
+      ASSERT_TRUE(RegisterMovableAllocation(survivor, kBufferSize, Relocate,
+                                            &survivor));
+    } else {
+      ::operator delete(buffers[i]);
+    }
+  }
+
+  const size_t moved = CompactMovableAllocations(kPagesPerHugePage);
+
+  // The survivors' hugepages are sparsely used, so at least some buffers
+  // migrate; the engine frees the old copy and the callback repointed
+  // survivors[i], with contents intact.
+  EXPECT_GT(moved, 0);
+  EXPECT_EQ(moved, static_cast<size_t>(relocations) * kBufferSize);
+  for (int i = 0; i < kSurvivors; ++i) {
+    const char* data = static_cast<const char*>(survivors[i]);
+    for (size_t j = 0; j < kBufferSize; j += 64) {
+      ASSERT_EQ(data[j], static_cast<char>('a' + i));
+    }
+    UnregisterMovableAllocation(survivors[i]);
+    ::operator delete(survivors[i]);
+  }
+}
+
+TEST(CompactionTest, MigratesColdBuffersWithinColdTier) {
+  ScopedProfileSamplingRate sampling_rate(0);
+  relocations = 0;
+
+  constexpr int kBuffersPerHugePage = kHugePageSize / kBufferSize;
+  constexpr int kSurvivors = 8;
+  constexpr int kBuffers = kSurvivors * kBuffersPerHugePage;
+  std::vector<void*> buffers;
+  for (int i = 0; i < kBuffers; ++i) {
+    buffers.push_back(::operator new(kBufferSize, hot_cold_t{0}));
+  }
+  if (GetMemoryTag(buffers[0]) != MemoryTag::kCold) {
+    // Cold placement is disabled in this configuration.
+    for (void* ptr : buffers) ::operator delete(ptr);
+    GTEST_SKIP() << "cold tier inactive";
+  }
+
+  void* survivors[kSurvivors];
+  for (int i = 0; i < kBuffers; ++i) {
+    if (i % kBuffersPerHugePage == 0) {
+      void*& survivor = survivors[i / kBuffersPerHugePage];
+      survivor = buffers[i];
+      memset(survivor, 'a' + i / kBuffersPerHugePage, kBufferSize);
+      ASSERT_TRUE(RegisterMovableAllocation(survivor, kBufferSize, Relocate,
+                                            &survivor));
+    } else {
+      ::operator delete(buffers[i]);
+    }
+  }
+
+  const size_t moved = CompactMovableAllocations(kPagesPerHugePage);
+
+  // Migrated survivors stay in the cold tier, with contents intact.
+  EXPECT_GT(moved, 0);
+  EXPECT_EQ(moved, static_cast<size_t>(relocations) * kBufferSize);
+  for (int i = 0; i < kSurvivors; ++i) {
+    EXPECT_EQ(GetMemoryTag(survivors[i]), MemoryTag::kCold);
+    const char* data = static_cast<const char*>(survivors[i]);
+    for (size_t j = 0; j < kBufferSize; j += 64) {
+      ASSERT_EQ(data[j], static_cast<char>('a' + i));
+    }
+    UnregisterMovableAllocation(survivors[i]);
+    ::operator delete(survivors[i]);
+  }
+}
+
+TEST(CompactionTest, VetoKeepsBufferInPlace) {
+  ScopedProfileSamplingRate sampling_rate(0);
+  relocations = 0;
+
+  constexpr int kBuffersPerHugePage = kHugePageSize / kBufferSize;
+  std::vector<void*> buffers;
+  for (int i = 0; i < kBuffersPerHugePage; ++i) {
+    buffers.push_back(::operator new(kBufferSize));
+  }
+  void* pinned = buffers[0];
+  ASSERT_TRUE(RegisterMovableAllocation(pinned, kBufferSize, Veto, nullptr));
+  for (int i = 1; i < kBuffersPerHugePage; ++i) {
+    ::operator delete(buffers[i]);
+  }
+
+  EXPECT_EQ(CompactMovableAllocations(kPagesPerHugePage), 0);
+
+  UnregisterMovableAllocation(pinned);
+  ::operator delete(pinned);
+}
+
+TEST(CompactionTest, UnregisterDuringMoveReleasesSlot) {
+  ScopedProfileSamplingRate sampling_rate(0);
+  relocations = 0;
+
+  constexpr int kBuffersPerHugePage = kHugePageSize / kBufferSize;
+  std::vector<void*> buffers;
+  for (int i = 0; i < kBuffersPerHugePage; ++i) {
+    buffers.push_back(::operator new(kBufferSize));
+  }
+  void* target = buffers[0];
+  ASSERT_TRUE(RegisterMovableAllocation(target, kBufferSize,
+                                        RelocateAndRelease, nullptr));
+  for (int i = 1; i < kBuffersPerHugePage; ++i) {
+    ::operator delete(buffers[i]);
+  }
+
+  const size_t moved = CompactMovableAllocations(kPagesPerHugePage);
+  if (moved == 0) {
+    // The replacement landed back on the same hugepage, so no move was
+    // attempted; nothing to verify.
+    UnregisterMovableAllocation(target);
+    ::operator delete(target);
+    GTEST_SKIP() << "no migration attempted";
+  }
+
+  // The callback unregistered the replacement while the move was still in
+  // flight; the slot must stay released, not resurrect a registration for
+  // the freed buffer.
+  EXPECT_EQ(moved, kBufferSize);
+  EXPECT_EQ(relocations, 1);
+  EXPECT_EQ(CompactMovableAllocations(kPagesPerHugePage), 0);
+  EXPECT_EQ(relocations, 1);
+}
+
+TEST(CompactionTest, UnregisteredBuffersAreIgnored) {
+  relocations = 0;
+  void* ptr = ::operator new(kBufferSize);
+  ASSERT_TRUE(RegisterMovableAllocation(ptr, kBufferSize, Veto, nullptr));
+  UnregisterMovableAllocation(ptr);
+  CompactMovableAllocations(kPagesPerHugePage);
+  EXPECT_EQ(relocations, 0);
+  ::operator delete(ptr);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
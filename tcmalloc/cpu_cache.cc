@@ -16,6 +16,7 @@
 
 #include <stdlib.h>
 
+#include <atomic>
 #include <cstdint>
 #include <new>
 
@@ -24,9 +25,11 @@
 #include "tcmalloc/internal/environment.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/percpu.h"
+#include "tcmalloc/internal/sysinfo.h"
 #include "tcmalloc/internal_malloc_extension.h"
 #include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
+#include "tcmalloc/thread_cache.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
@@ -72,6 +75,29 @@ static void ActivatePerCpuCaches() {
     ThreadCache::BecomeIdle();
     // If there's a problem with this code, let's notice it right away:
     ::operator delete(::operator new(1));
+  } else if (Parameters::per_cpu_caches()) {
+    // Per-CPU caches were requested but rseq is unavailable (old kernel,
+    // seccomp filtering the syscall, or a conflicting registration).
+    HandlePerCpuUnavailable();
+  }
+}
+
+void HandlePerCpuUnavailable() {
+  ABSL_CONST_INIT static std::atomic<bool> handled{false};
+  if (handled.exchange(true, std::memory_order_relaxed)) {
+    return;
+  }
+  Log(kLog, __FILE__, __LINE__,
+      "Per-CPU caches are enabled but rseq is unavailable; falling back to "
+      "thread caches with a widened budget. Check kernel support and seccomp "
+      "policy.");
+  // Hand the capacity budget the per-CPU caches would have used to the
+  // thread caches, so the fallback mode loses less throughput.
+  const size_t budget =
+      static_cast<size_t>(Parameters::max_per_cpu_cache_size()) * NumCPUs();
+  PageHeapSpinLockHolder l;
+  if (budget > ThreadCache::overall_thread_cache_size()) {
+    ThreadCache::set_overall_thread_cache_size(budget);
   }
 }
 
@@ -15,12 +15,14 @@
 #ifndef TCMALLOC_CPU_CACHE_H_
 #define TCMALLOC_CPU_CACHE_H_
 
+#include <sched.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/mman.h>
 
 #include <algorithm>
 #include <atomic>
+#include <limits>
 #include <new>
 #include <tuple>
 #include <type_traits>
@@ -39,9 +41,12 @@
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
+#include "tcmalloc/cpu_cache_miss_profiler.h"
 #include "tcmalloc/experiment.h"
 #include "tcmalloc/experiment_config.h"
 #include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/cache_topology.h"
+#include "tcmalloc/internal/clock.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/environment.h"
 #include "tcmalloc/internal/logging.h"
@@ -49,7 +54,9 @@
 #include "tcmalloc/internal/optimization.h"
 #include "tcmalloc/internal/percpu.h"
 #include "tcmalloc/internal/percpu_tcmalloc.h"
+#include "tcmalloc/internal/prefetch.h"
 #include "tcmalloc/internal/sysinfo.h"
+#include "tcmalloc/latency_profiling.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
@@ -134,6 +141,26 @@ class StaticForwarder {
     return Parameters::per_cpu_caches_dynamic_slab_shrink_threshold();
   }
 
+  static int64_t per_cpu_caches_dynamic_slab_hysteresis_intervals() {
+    return Parameters::per_cpu_caches_dynamic_slab_hysteresis_intervals();
+  }
+
+  static bool per_cpu_caches_eager_slab_init() {
+    return Parameters::per_cpu_caches_eager_slab_init();
+  }
+
+  static int64_t per_cpu_caches_pop_prefetch_min_object_size() {
+    return Parameters::per_cpu_caches_pop_prefetch_min_object_size();
+  }
+
+  static bool per_cpu_caches_steal_objects_from_siblings() {
+    return Parameters::per_cpu_caches_steal_objects_from_siblings();
+  }
+
+  static bool per_cpu_caches_huge_page_slabs() {
+    return Parameters::per_cpu_caches_huge_page_slabs();
+  }
+
   static size_t class_to_size(int size_class) {
     return tc_globals.sizemap().class_to_size(size_class);
   }
@@ -158,6 +185,10 @@ class StaticForwarder {
     return tc_globals.transfer_cache();
   }
 
+  static bool BypassTransferCacheOnFree(size_t size_class) {
+    return tc_globals.class_lifetimes().BypassTransferCacheOnFree(size_class);
+  }
+
   static bool UseGenericShardedCache() {
     return tc_globals.sharded_transfer_cache().UseGenericCache();
   }
@@ -240,6 +271,27 @@ class CpuCache {
     kGrow,
   };
 
+  // Selects which precomputed per-size-class capacity table the slabs use.
+  // The alternate layouts rebalance slab slots between the deep caches of the
+  // small, hot size classes and the shallower caches of everything else, for
+  // workloads whose phases shift between small-object-heavy and
+  // larger-object-heavy allocation mixes.  Every layout is derived from the
+  // default within the same slab byte budget, so each one is valid at every
+  // slab shift.
+  enum class CapacityLayout : uint8_t {
+    // The MaxCapacity()-determined split.
+    kDefault = 0,
+    // Halves the depth of the mid/large classes and hands the freed slots to
+    // the small classes.
+    kSmallDeep,
+    // Halves the depth of the small classes and hands the freed slots to the
+    // mid/large classes.
+    kLargeDeep,
+    kNumLayouts,
+  };
+  static constexpr size_t kNumCapacityLayouts =
+      static_cast<size_t>(CapacityLayout::kNumLayouts);
+
   enum class PerClassMissType {
     // Tracks total number of misses.
     kTotal = 0,
@@ -262,6 +314,12 @@ class CpuCache {
     // Tracks number of misses recorded as of the end of the last slab resize
     // interval.
     kSlabResize,
+    // Tracks number of misses recorded as of the end of the last capacity
+    // decay interval.
+    kDecay,
+    // Tracks number of misses recorded as of the end of the last predictive
+    // grow interval.
+    kPredictiveGrow,
     kNumCounts,
   };
 
@@ -279,6 +337,23 @@ class CpuCache {
     int max_last_overflow_cpu_id = -1;
   };
 
+  // Records one executed slab resize together with the interval miss totals
+  // that triggered it, for offline tuning of the grow/shrink thresholds.
+  struct DynamicSlabResizeTraceEntry {
+    DynamicSlabResize resize = DynamicSlabResize::kNoop;
+    // Per-cpu slab shift after the resize took effect.
+    uint8_t per_cpu_shift = 0;
+    // Cache misses observed during the slab-resize interval that triggered
+    // the resize.
+    CpuCacheMissStats misses;
+    // Cumulative bytes of old slab memory that madvise failed to release, as
+    // of the end of this resize.
+    size_t madvise_failed_bytes = 0;
+  };
+
+  // Number of recent slab resizes retained for GetDynamicSlabResizeTrace.
+  static constexpr size_t kDynamicSlabResizeTraceLength = 32;
+
   // Sets the lower limit on the capacity that can be stolen from the cpu cache.
   static constexpr double kCacheCapacityThreshold = 0.20;
 
@@ -304,6 +379,14 @@ class CpuCache {
   // when it's known that no hooks are installed.
   void* AllocateSlowNoHooks(size_t size_class);
 
+  // Allocate up to <n> objects of the given size class into <batch>.
+  // Objects cached in the current cpu's slab are popped with a single
+  // restartable sequence commit; any remainder is fetched from the backing
+  // cache once for the whole batch rather than once per object.
+  // Returns the number of objects allocated (possibly 0).
+  // REQUIRES: n > 0.
+  size_t AllocateBatch(size_t size_class, void** batch, size_t n);
+
   // Free an object of the given class.
   void Deallocate(void* ptr, size_t size_class);
   // Separate deallocation fast/slow paths.
@@ -315,6 +398,12 @@ class CpuCache {
   // when it's known that no hooks are installed.
   void DeallocateSlowNoHooks(void* ptr, size_t size_class);
 
+  // Free a batch of <n> objects of the given size class.  The batch is pushed
+  // onto the current cpu's slab with a single restartable sequence commit;
+  // objects that do not fit take the regular deallocation slow path.
+  // REQUIRES: n > 0.
+  void DeallocateBatch(size_t size_class, void** batch, size_t n);
+
   // Force all Allocate/DeallocateFast to fail in the current thread
   // if malloc hooks are installed.
   void MaybeForceSlowPath();
@@ -330,6 +419,11 @@ class CpuCache {
 
   PerCPUMetadataState MetadataMemoryUsage() const;
 
+  // Returns the address and size of the per-CPU slabs mapping.
+  std::pair<const void*, size_t> GetSlabExtent() const {
+    return freelist_.GetSlabExtent();
+  }
+
   // Give the number of bytes used in all cpu caches.
   uint64_t TotalUsedBytes() const;
 
@@ -350,14 +444,20 @@ class CpuCache {
   void SetCacheLimit(uint64_t v);
 
   // Shuffles per-cpu caches using the number of underflows and overflows that
-  // occurred in the prior interval. It selects the top per-cpu caches
-  // with highest misses as candidates, iterates through the other per-cpu
-  // caches to steal capacity from them and adds the stolen bytes to the
-  // available capacity of the per-cpu caches. May be called from any processor.
-  //
-  // TODO(vgogte): There are quite a few knobs that we can play around with in
-  // ShuffleCpuCaches.
-  void ShuffleCpuCaches();
+  // occurred in the prior interval.  Populated caches are ranked by interval
+  // misses; the highest-pressure decile receives capacity, stolen from the
+  // rest of the caches starting at the lowest-pressure end, so on wide hosts
+  // capacity converges toward a shifted load in a few rounds rather than by
+  // random sampling.  Returns the total interval misses observed across the
+  // ranked caches, which the background thread uses to speed up the shuffle
+  // cadence while the miss rate climbs.  May be called from any processor.
+  uint64_t ShuffleCpuCaches();
+
+  // As above, but restricted to the cpus of the given NUMA partition: both
+  // the caches grown and the caches stolen from belong to the partition, so
+  // a per-partition background thread shuffles only its local caches and
+  // leaves the other partitions' interval snapshots untouched.
+  uint64_t ShuffleCpuCaches(int numa_partition);
 
   // Tries to reclaim inactive per-CPU caches. It iterates through the set of
   // populated cpu caches and reclaims the caches that:
@@ -365,6 +465,31 @@ class CpuCache {
   // (2) had no change in the number of misses since the last interval.
   void TryReclaimingCaches();
 
+  // As above, but restricted to the cpus of the given NUMA partition.
+  void TryReclaimingCaches(int numa_partition);
+
+  // Reclaims populated per-CPU caches on the CPUs absent from <allowed>,
+  // without waiting for them to pass TryReclaimingCaches' idle check.  The
+  // background thread uses this to promptly return caches stranded when the
+  // affinity mask shrinks, rather than after a full reclaim interval.
+  void ReclaimInaccessibleCaches(const cpu_set_t& allowed);
+
+  // Steps capacity back down on populated per-CPU caches whose underflows
+  // plus overflows during the previous interval stayed below <miss_floor>,
+  // returning the freed objects to the central lists.  Capacity grown toward
+  // CacheLimit() during a load spike thus decays once the spike subsides,
+  // instead of staying parked in the slab until the cache goes fully idle
+  // and TryReclaimingCaches drains it.
+  void DecayIdleCpuCaches(uint64_t miss_floor);
+
+  // Proactively grows per-size-class capacities of quiet caches toward their
+  // decayed demand estimates (see PerClassResizeInfo::UpdateDemandEstimate)
+  // and primes the backing transfer caches for the grown classes.  The
+  // expensive span and slab work thus happens in the low-traffic window,
+  // instead of serializing behind FetchFromBackingCache when traffic ramps
+  // back up.
+  void PredictivelyGrowCpuCaches();
+
   // Resize size classes for up to kNumCpuCachesToResize cpu caches per
   // interval.
   static constexpr int kNumCpuCachesToResize = 10;
@@ -394,10 +519,42 @@ class CpuCache {
   // Reports total number of times any CPU has been reclaimed.
   uint64_t GetNumReclaims() const;
 
+  // Used by the fork handlers to quiesce the per-cpu resize locks across
+  // fork(), so the child does not inherit a held lock.
+  // REQUIRES: the cache has been activated.
+  void AcquireInternalLocks() ABSL_NO_THREAD_SAFETY_ANALYSIS;
+  void ReleaseInternalLocks() ABSL_NO_THREAD_SAFETY_ANALYSIS;
+
   // When dynamic slab size is enabled, checks if there is a need to resize
   // the slab based on miss-counts and resizes if so.
   void ResizeSlabIfNeeded();
 
+  // Copies the most recent slab resize decisions into <entries>, oldest
+  // first, and returns the number of entries copied. The trace is diagnostic
+  // only: a resize racing with the copy may overwrite the oldest entries.
+  size_t GetDynamicSlabResizeTrace(
+      absl::Span<DynamicSlabResizeTraceEntry> entries) const;
+
+  // Swaps the active capacity table for <layout>, rebuilding the slabs at the
+  // current shift through the same stop/drain/repopulate choreography as a
+  // dynamic slab resize.  Per-cpu caches restart empty and refill against the
+  // new per-class bounds, so switches should be driven at phase-change
+  // granularity, not per interval.  No-op if <layout> is already active or
+  // out of range.  Must only be called from the background thread, after
+  // Activate().  Returns true if the active layout changed.
+  bool SetCapacityLayout(CapacityLayout layout);
+
+  // Returns the capacity layout currently applied to the slabs.
+  CapacityLayout capacity_layout() const {
+    return static_cast<CapacityLayout>(
+        capacity_layout_.load(std::memory_order_relaxed));
+  }
+
+  // Reports the number of capacity layout swaps executed.
+  uint64_t GetNumCapacityLayoutSwitches() const {
+    return capacity_layout_switches_.load(std::memory_order_relaxed);
+  }
+
   // Reports total cache underflows and overflows for <cpu>.
   CpuCacheMissStats GetTotalCacheMissStats(int cpu) const;
 
@@ -428,6 +585,11 @@ class CpuCache {
   size_t GetIntervalSizeClassMisses(int cpu, size_t size_class,
                                     PerClassMissType type);
 
+  // Reports the lifetime number of misses recorded for <size_class>, summed
+  // across cpus.  The counters are maintained on the existing miss paths, so
+  // consumers (e.g. the allocation anomaly tripwire) add no fast-path cost.
+  size_t GetTotalSizeClassMisses(size_t size_class);
+
   // Reports if we should use a wider 512KiB slab.
   bool UseWiderSlabs() const;
 
@@ -489,7 +651,21 @@ class CpuCache {
     // <type>.
     void UpdateIntervalMisses(PerClassMissType type);
 
+    // Feeds the demand estimator with the resize misses observed over the
+    // last interval.  The estimate has a fast attack and a slow decay: it
+    // jumps most of the way up when demand rises and loses only 1/64th per
+    // interval when demand falls, so an overnight lull does not erase what
+    // the morning ramp will need.
+    void UpdateDemandEstimate(size_t interval_misses);
+
+    // Reports the decayed estimate of per-interval resize misses.
+    size_t GetDemandEstimate();
+
    private:
+    // Fractional bits of demand_estimate_, so the slow decay makes progress
+    // on small estimates.
+    static constexpr int kDemandFractionBits = 6;
+
     std::atomic<int32_t> state_;
     // state_ layout:
     struct State {
@@ -501,6 +677,9 @@ class CpuCache {
       uint32_t successive : 16;
     };
     PerClassMissCounts misses_;
+    // Decayed demand estimate, in units of interval misses scaled by
+    // kDemandFractionBits.  Written only by the background thread.
+    std::atomic<size_t> demand_estimate_;
     static_assert(sizeof(State) == sizeof(std::atomic<int32_t>),
                   "size mismatch");
   };
@@ -514,7 +693,14 @@ class CpuCache {
     }
   };
 
+  // Fields are grouped by writer so that writes from other CPUs (the
+  // background thread's resize/reclaim passes, capacity stealing, sibling
+  // cache stealing) do not share cachelines with the counters the owning CPU
+  // updates on its miss path.  Each group head is cacheline-aligned; the
+  // layout is audited by CpuCacheTest.ResizeInfoLayout.
   struct ABSL_CACHELINE_ALIGNED ResizeInfo {
+    // -- Cross-CPU control group: written by stealing CPUs and the
+    // -- background thread as well as the owner.
     // cache space on this CPU we're not using.  Modify atomically;
     // we don't want to lose space.
     std::atomic<size_t> available;
@@ -529,15 +715,18 @@ class CpuCache {
     absl::base_internal::SpinLock lock ABSL_ACQUIRED_BEFORE(pageheap_lock){
         absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY};
     PerClassResizeInfo per_class[kNumClasses];
-    std::atomic<size_t> num_size_class_resizes;
+    // -- Owner-hot group: written by the owning CPU on underflow/overflow.
     // Tracks number of underflows on allocate.
-    MissCounts underflows;
+    ABSL_CACHELINE_ALIGNED MissCounts underflows;
     // Tracks number of overflows on deallocate.
     MissCounts overflows;
     std::atomic<int64_t> last_miss_cycles[2][kNumClasses];
+    // -- Background group: written by the background thread's resize and
+    // -- reclaim passes, only read by the owner.
     // total cache space available on this CPU. This tracks the total
     // allocated and unallocated bytes on this CPU cache.
-    std::atomic<size_t> capacity;
+    ABSL_CACHELINE_ALIGNED std::atomic<size_t> capacity;
+    std::atomic<size_t> num_size_class_resizes;
     // Used bytes in the cache as of the end of the last resize interval.
     std::atomic<uint64_t> reclaim_used_bytes;
     // Tracks number of times this CPU has been reclaimed.
@@ -551,12 +740,35 @@ class CpuCache {
     std::atomic<size_t> grow_count[kNumPossiblePerCpuShifts];
     std::atomic<size_t> shrink_count[kNumPossiblePerCpuShifts];
     std::atomic<size_t> madvise_failed_bytes;
+    // Ring of the most recent resize decisions. Written only by the
+    // background thread; trace_count is incremented with release order after
+    // an entry is filled in so that readers only see completed entries.
+    DynamicSlabResizeTraceEntry trace[kDynamicSlabResizeTraceLength];
+    std::atomic<size_t> trace_count;
   };
 
+  // The number of size classes that are commonly used and thus should be
+  // allocated more slots in the per-cpu cache.
+  static constexpr size_t kNumSmall = 10;
+
   // Determines how we distribute memory in the per-cpu cache to the various
   // class sizes.
   size_t MaxCapacity(size_t size_class) const;
 
+  // True for the size classes MaxCapacity() gives the deep small-object
+  // depth; the alternate capacity layouts rebalance slots between these
+  // classes and the rest.
+  bool IsSmallDepthClass(size_t size_class) const;
+
+  // Fills the alternate CapacityLayout tables from the default one: the donor
+  // group's depths are halved and the freed slots are split evenly across the
+  // recipient group, so no layout requires more slab bytes than the default.
+  void BuildAlternateCapacityTables();
+
+  uint16_t* capacity_table(CapacityLayout layout) {
+    return max_capacity_tables_[static_cast<size_t>(layout)];
+  }
+
   // Gets the max capacity for the size class using the current per-cpu shift.
   uint16_t GetMaxCapacity(int size_class, uint8_t shift) const;
 
@@ -568,7 +780,22 @@ class CpuCache {
   // Releases free batch of objects to the backing transfer cache.
   void ReleaseToBackingCache(size_t size_class, absl::Span<void*> batch);
 
-  void* Refill(int cpu, size_t size_class);
+  // Fetches objects for <size_class> from the backing cache and refills the
+  // freelist on <cpu>.  <recently_preempted> says the thread just came back
+  // on CPU (the kernel invalidated the cached slab pointer at the context
+  // switch); on such visits we shed optional work to keep the slow path out
+  // of the scheduler's critical window.
+  void* Refill(int cpu, size_t size_class, bool recently_preempted);
+
+  // Attempts to migrate up to <n> objects of <size_class> directly from the
+  // slab of another cpu sharing an L3 cache with <cpu>, bypassing the
+  // transfer cache.  Returns the number of objects written to <batch>.
+  size_t StealObjectsFromSiblingCache(int cpu, size_t size_class, void** batch,
+                                      size_t n);
+
+  // Slow path of AllocateBatch: caches the cpu slab if necessary and fetches
+  // the remainder of the batch from the backing cache.
+  size_t AllocateBatchSlow(size_t size_class, void** batch, size_t n);
 
   // Returns true if we bypass cpu cache for a <size_class>. We may bypass
   // per-cpu cache when we enable certain configurations of sharded transfer
@@ -582,7 +809,16 @@ class CpuCache {
 
   // Called on <size_class> freelist on <cpu> to record overflow/underflow
   // Returns number of objects to return/request from transfer cache.
-  size_t UpdateCapacity(int cpu, size_t size_class, bool overflow);
+  // When <recently_preempted> is set, capacity growth beyond the minimum is
+  // deferred to a later visit and the target is capped at one batch.
+  size_t UpdateCapacity(int cpu, size_t size_class, bool overflow,
+                        bool recently_preempted);
+
+  // Lays out <cpu>'s slab region (headers and begin/current offsets) exactly
+  // once; concurrent and repeated calls are safe.  Runs lazily on a cpu's
+  // first miss, or for every usable cpu at activation when eager slab
+  // initialization is on.
+  void InitCpuOnce(int cpu);
 
   // Tries to grow freelist <size_class> on the current <cpu> by up to
   // <desired_increase> objects if there is available capacity.
@@ -590,8 +826,8 @@ class CpuCache {
 
   // Depending on the number of misses that cpu caches encountered in the
   // previous resize interval, returns if slabs should be grown, shrunk or
-  // remain the same.
-  DynamicSlabResize ShouldResizeSlab();
+  // remain the same. Records the interval miss totals in <total_misses>.
+  DynamicSlabResize ShouldResizeSlab(CpuCacheMissStats& total_misses);
 
   // Determine if the <size_class> is a good candidate to be shrunk. We use
   // clock-like algorithm to prioritize size classes for shrinking.
@@ -617,20 +853,34 @@ class CpuCache {
   // underflow or overflow.
   void RecordCacheMissStat(int cpu, bool is_alloc);
 
+  // Single-runner detection.  Feeds the consecutive-miss streak for <cpu>;
+  // a miss from any other cpu revokes the streak instantly.
+  void NoteSingleRunnerMiss(int cpu);
+
+  // True while every recent slow-path miss came from one cpu.  In that
+  // regime the transfer cache brokers no sharing, so the backing-cache
+  // accessors borrow straight from the central freelist, removing a lock
+  // level from the miss path (bulk-load phases are commonly
+  // single-threaded).
+  bool IsSingleRunner() const;
+
   // Tries to steal <bytes> for the destination <cpu>. It iterates through the
   // the set of populated cpu caches and steals the bytes from them. A cpu is
   // considered a good candidate to steal from if:
-  // (1) the cache is populated
-  // (2) the numbers of underflows and overflows are both less than 0.8x those
+  // (1) the numbers of underflows and overflows are both less than 0.8x those
   // of the destination per-cpu cache
-  // (3) source cpu is not the same as the destination cpu
-  // (4) capacity of the source cpu/size_class is non-zero
+  // (2) capacity of the source cpu/size_class is non-zero
+  //
+  // <src_cpus> are the donor candidates, ordered by decreasing interval
+  // misses; stealing walks them from the back, so the lowest-pressure caches
+  // give up capacity first.  The caller has already restricted the list to
+  // populated caches of the right NUMA partition, destinations excluded.
   //
   // For a given source cpu, we iterate through the size classes to steal from
   // them. Currently, we use a clock-like algorithm to identify the size_class
   // to steal from.
-  void StealFromOtherCache(int cpu, int max_populated_cpu,
-                           absl::Span<CpuMissStat> skip_cpus, size_t bytes);
+  void StealFromOtherCache(int cpu, absl::Span<const CpuMissStat> src_cpus,
+                           size_t bytes);
 
   // Try to steal one object from cpu/size_class. Return bytes stolen.
   size_t ShrinkOtherCache(int cpu, size_t size_class);
@@ -639,12 +889,13 @@ class CpuCache {
   // single <cpu>.
   void ResizeCpuSizeClasses(int cpu);
 
-  // <shift_offset> is the offset of the shift in slabs_by_shift_. Note that we
-  // can't calculate this from `shift` directly due to numa shift.
-  // Returns the allocated slabs and the number of reused bytes.
+  // Allocates fresh slabs of <shift> size, or reuses <reused_slabs> when it
+  // is non-null (re-enabling huge pages on the reused region).  Updates
+  // <reused_slabs> to the region returned.  Returns the slabs and the number
+  // of reused bytes.
   ABSL_MUST_USE_RESULT std::pair<void*, size_t> AllocOrReuseSlabs(
       absl::FunctionRef<void*(size_t, std::align_val_t)> alloc,
-      subtle::percpu::Shift shift, int num_cpus, uint8_t shift_offset);
+      subtle::percpu::Shift shift, int num_cpus, void*& reused_slabs);
 
   Freelist freelist_;
 
@@ -654,12 +905,26 @@ class CpuCache {
   // Tracks initial and maximum slab shift bounds.
   SlabShiftBounds shift_bounds_{};
 
-  // The maximum capacity of each size class within the slab.
-  uint16_t max_capacity_[kNumClasses] = {0};
-
-  // Provides a hint to StealFromOtherCache() so that we can steal from the
-  // caches in a round-robin fashion.
-  int next_cpu_cache_steal_ = 0;
+  // The maximum capacity of each size class within the slab, one table per
+  // CapacityLayout.  The tables are filled during Activate() and immutable
+  // afterwards; max_capacity_ points at the active table and is rebound by
+  // SetCapacityLayout() while every resize_ lock is held.  Miss-path readers
+  // load it without synchronization: a stale table merely bounds growth with
+  // the previous layout's depths, which is benign.
+  uint16_t max_capacity_tables_[kNumCapacityLayouts][kNumClasses] = {};
+  std::atomic<const uint16_t*> max_capacity_{max_capacity_tables_[0]};
+
+  // Active capacity layout and the number of executed layout swaps.
+  std::atomic<uint8_t> capacity_layout_{0};
+  std::atomic<uint64_t> capacity_layout_switches_{0};
+
+  // Slabs region released by the previous layout swap, kept for ping-pong
+  // reuse by the next swap at the same shift.  slabs_by_shift_ below tracks
+  // the active region for the current shift, so it cannot serve a same-shift
+  // swap.  Stale after a slab resize (wrong size); layout_spare_shift_ guards
+  // against reusing it then.
+  void* layout_spare_slabs_ = nullptr;
+  uint8_t layout_spare_shift_ = 0;
 
   // Provides a hint to ResizeSizeClasses() that records the last CPU for which
   // we resized size classes. We use this to resize size classes for CPUs in a
@@ -669,10 +934,30 @@ class CpuCache {
   // Per-core cache limit in bytes.
   std::atomic<uint64_t> max_per_cpu_cache_size_{kMaxCpuCacheSize};
 
+  // Single-runner state, packed as ((cpu + 1) << 32 | consecutive misses).
+  // Plain relaxed loads and stores: a race merely perturbs the streak by a
+  // miss or two, and the first miss from a second cpu still revokes the
+  // mode.
+  static constexpr uint32_t kSingleRunnerMissThreshold = 256;
+  std::atomic<uint64_t> single_runner_state_{0};
+
   ABSL_ATTRIBUTE_NO_UNIQUE_ADDRESS Forwarder forwarder_;
 
   DynamicSlabInfo dynamic_slab_info_{};
 
+  // Hysteresis state for ResizeSlabIfNeeded: the verdict returned by
+  // ShouldResizeSlab for the previous interval and the number of consecutive
+  // intervals it has repeated. Only touched by the background thread.
+  DynamicSlabResize slab_resize_verdict_ = DynamicSlabResize::kNoop;
+  int64_t slab_resize_verdict_streak_ = 0;
+
+  // Slot-array layout order the freelist applies as CPU regions are
+  // (re)populated: a permutation of the size classes, hottest first, rebuilt
+  // from observed misses on each slab resize.  Written while all resize_
+  // locks are held, which excludes the freelist's InitCpu/ResizeSlabs
+  // readers.
+  uint16_t slab_layout_order_[kNumClasses] = {};
+
   // Pointers to allocations for slabs of each shift value for use in
   // ResizeSlabs. This memory is allocated on the arena, and it is nonresident
   // while not in use.
@@ -692,7 +977,18 @@ template <class Forwarder>
 inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* CpuCache<Forwarder>::AllocateFast(
     size_t size_class) {
   TC_ASSERT_GT(size_class, 0);
-  return freelist_.Pop(size_class);
+  void* ret = freelist_.Pop(size_class);
+  // Pop already prefetches the next object on the slab's stack; opting in via
+  // the parameter additionally prefetches the first line of the object being
+  // returned, which is frequently cold if it sat in the slab for a while.
+  const int64_t prefetch_min_size =
+      forwarder_.per_cpu_caches_pop_prefetch_min_object_size();
+  if (ABSL_PREDICT_FALSE(prefetch_min_size >= 0) && ret != nullptr &&
+      forwarder_.class_to_size(size_class) >=
+          static_cast<size_t>(prefetch_min_size)) {
+    PrefetchT0(ret);
+  }
+  return ret;
 }
 
 template <class Forwarder>
@@ -709,6 +1005,20 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool CpuCache<Forwarder>::DeallocateFast(
   return freelist_.Push(size_class, ptr);
 }
 
+template <class Forwarder>
+void CpuCache<Forwarder>::DeallocateBatch(size_t size_class, void** batch,
+                                          size_t n) {
+  TC_ASSERT_GT(size_class, 0);
+  TC_ASSERT_GT(n, 0);
+  const size_t pushed = freelist_.PushBatch(size_class, batch, n);
+  // Objects that were not pushed are returned at the start of the batch.  The
+  // first slow-path call makes room in the slab (or releases a batch to the
+  // backing cache), so subsequent objects mostly take the fast path again.
+  for (size_t i = 0; i < n - pushed; ++i) {
+    Deallocate(batch[i], size_class);
+  }
+}
+
 template <class Forwarder>
 void CpuCache<Forwarder>::MaybeForceSlowPath() {
   if (ABSL_PREDICT_FALSE(Static::HaveHooks())) {
@@ -742,10 +1052,6 @@ static cpu_set_t FillActiveCpuMask() {
 
 template <class Forwarder>
 inline size_t CpuCache<Forwarder>::MaxCapacity(size_t size_class) const {
-  // The number of size classes that are commonly used and thus should be
-  // allocated more slots in the per-cpu cache.
-  static constexpr size_t kNumSmall = 10;
-
   // When we use wider slabs, we also want to double the maximum capacities for
   // size classes to use that slab.
   const size_t kWiderSlabMultiplier = UseWiderSlabs() ? 2 : 1;
@@ -832,6 +1138,51 @@ inline size_t CpuCache<Forwarder>::MaxCapacity(size_t size_class) const {
   return kLargeObjectDepth;
 }
 
+template <class Forwarder>
+inline bool CpuCache<Forwarder>::IsSmallDepthClass(size_t size_class) const {
+  return !IsExpandedSizeClass(size_class) &&
+         (size_class % kNumBaseClasses) <= kNumSmall;
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::BuildAlternateCapacityTables() {
+  const uint16_t* defaults = capacity_table(CapacityLayout::kDefault);
+  for (CapacityLayout layout :
+       {CapacityLayout::kSmallDeep, CapacityLayout::kLargeDeep}) {
+    uint16_t* table = capacity_table(layout);
+    const bool deepen_small = layout == CapacityLayout::kSmallDeep;
+
+    // Halve the donor classes and pool the freed slots.
+    size_t freed = 0;
+    size_t recipients = 0;
+    for (size_t size_class = 0; size_class < kNumClasses; ++size_class) {
+      const uint16_t cap = defaults[size_class];
+      table[size_class] = cap;
+      if (cap == 0) continue;
+      if (IsSmallDepthClass(size_class) == deepen_small) {
+        ++recipients;
+      } else {
+        table[size_class] = cap / 2;
+        freed += cap - table[size_class];
+      }
+    }
+    if (recipients == 0) continue;
+
+    // Hand the pooled slots out evenly; the division remainder stays unused,
+    // so the alternate layout never needs more slab bytes than the default.
+    const size_t per_class = freed / recipients;
+    for (size_t size_class = 0; size_class < kNumClasses; ++size_class) {
+      if (table[size_class] == 0 ||
+          IsSmallDepthClass(size_class) != deepen_small) {
+        continue;
+      }
+      table[size_class] = static_cast<uint16_t>(
+          std::min<size_t>(table[size_class] + per_class,
+                           std::numeric_limits<uint16_t>::max()));
+    }
+  }
+}
+
 // Returns estimated bytes required and the bytes available.
 inline std::pair<size_t, size_t> EstimateSlabBytes(
     GetShiftMaxCapacity get_shift_capacity) {
@@ -859,7 +1210,7 @@ inline uint16_t CpuCache<Forwarder>::GetMaxCapacity(int size_class,
 template <class Forwarder>
 inline GetShiftMaxCapacity CpuCache<Forwarder>::GetMaxCapacityFunctor(
     uint8_t shift) const {
-  return {max_capacity_, shift, shift_bounds_};
+  return {max_capacity_.load(std::memory_order_relaxed), shift, shift_bounds_};
 }
 
 template <class Forwarder>
@@ -879,7 +1230,7 @@ inline SlabShiftBounds CpuCache<Forwarder>::GetPerCpuSlabShiftBounds() const {
 
 template <class Forwarder>
 inline void CpuCache<Forwarder>::Activate() {
-  int num_cpus = NumCPUs();
+  int num_cpus = NumUsableCPUs();
 
   shift_bounds_.initial_shift = kInitialBasePerCpuShift;
   shift_bounds_.max_shift = kMaxBasePerCpuShift;
@@ -904,28 +1255,42 @@ inline void CpuCache<Forwarder>::Activate() {
   // Deal with size classes that correspond only to NUMA partitions that are in
   // use. If NUMA awareness is disabled then we may have a smaller shift than
   // would suffice for all of the unused size classes.
+  uint16_t* default_capacities = capacity_table(CapacityLayout::kDefault);
   for (int size_class = 0;
        size_class < topology.active_partitions() * kNumBaseClasses;
        ++size_class) {
-    max_capacity_[size_class] = MaxCapacity(size_class);
+    default_capacities[size_class] = MaxCapacity(size_class);
   }
 
   // Deal with expanded size classes.
   for (int size_class = kExpandedClassesStart; size_class < kNumClasses;
        ++size_class) {
-    max_capacity_[size_class] = MaxCapacity(size_class);
-  }
-
-  // Verify that all the possible shifts will have valid max capacities.
-  for (uint8_t shift = shift_bounds_.initial_shift;
-       shift <= shift_bounds_.max_shift; ++shift) {
-    const auto [bytes_required, bytes_available] =
-        EstimateSlabBytes({max_capacity_, shift, shift_bounds_});
-    // We may make certain size classes no-ops by selecting "0" at runtime, so
-    // using a compile-time calculation overestimates worst-case memory usage.
-    if (ABSL_PREDICT_FALSE(bytes_required > bytes_available)) {
-      Crash(kCrash, __FILE__, __LINE__, "per-CPU memory exceeded, have ",
-            bytes_available, " need ", bytes_required);
+    default_capacities[size_class] = MaxCapacity(size_class);
+  }
+
+  BuildAlternateCapacityTables();
+
+  // Verify that all the possible shifts will have valid max capacities, for
+  // every capacity layout.
+  for (size_t layout = 0; layout < kNumCapacityLayouts; ++layout) {
+    for (uint8_t shift = shift_bounds_.initial_shift;
+         shift <= shift_bounds_.max_shift; ++shift) {
+      const auto [bytes_required, bytes_available] = EstimateSlabBytes(
+          {max_capacity_tables_[layout], shift, shift_bounds_});
+      if (ABSL_PREDICT_TRUE(bytes_required <= bytes_available)) continue;
+      // We may make certain size classes no-ops by selecting "0" at runtime,
+      // so using a compile-time calculation overestimates worst-case memory
+      // usage.
+      if (layout == static_cast<size_t>(CapacityLayout::kDefault)) {
+        Crash(kCrash, __FILE__, __LINE__, "per-CPU memory exceeded, have ",
+              bytes_available, " need ", bytes_required);
+      }
+      // An alternate layout that does not fit (only possible through rounding
+      // at scaled shifts) degrades to a copy of the default; selecting it
+      // then simply keeps the default split.
+      std::copy(default_capacities, default_capacities + kNumClasses,
+                max_capacity_tables_[layout]);
+      break;
     }
   }
 
@@ -947,17 +1312,43 @@ inline void CpuCache<Forwarder>::Activate() {
   void* slabs =
       AllocOrReuseSlabs(&forwarder_.Alloc,
                         subtle::percpu::ToShiftType(per_cpu_shift), num_cpus,
-                        ShiftOffset(per_cpu_shift, shift_bounds_.initial_shift))
+                        slabs_by_shift_[ShiftOffset(
+                            per_cpu_shift, shift_bounds_.initial_shift)])
           .first;
-  freelist_.Init(
-      kNumClasses, &forwarder_.Alloc, slabs,
-      GetShiftMaxCapacity{max_capacity_, per_cpu_shift, shift_bounds_},
-      subtle::percpu::ToShiftType(per_cpu_shift));
+  freelist_.Init(kNumClasses, &forwarder_.Alloc, slabs,
+                 GetMaxCapacityFunctor(per_cpu_shift),
+                 subtle::percpu::ToShiftType(per_cpu_shift));
+
+  if (forwarder_.per_cpu_caches_eager_slab_init()) {
+    // Lay out every usable cpu's slab region up front so no thread pays the
+    // first-touch initialization stall in its allocation path.  Capacities
+    // still start at zero; only the miss that would have paid for InitCpu is
+    // saved.
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      InitCpuOnce(cpu);
+    }
+  }
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::InitCpuOnce(int cpu) {
+  absl::base_internal::LowLevelCallOnce(
+      &resize_[cpu].initialized,
+      [](CpuCache* cache, int cpu) {
+        AllocationGuardSpinLockHolder h(&cache->resize_[cpu].lock);
+        cache->freelist_.InitCpu(
+            cpu, cache->GetMaxCapacityFunctor(cache->freelist_.GetShift()));
+
+        // We update this under the lock so it's guaranteed that the populated
+        // CPUs don't change during ResizeSlabs.
+        cache->resize_[cpu].populated.store(true, std::memory_order_relaxed);
+      },
+      this, cpu);
 }
 
 template <class Forwarder>
 inline void CpuCache<Forwarder>::Deactivate() {
-  int num_cpus = NumCPUs();
+  int num_cpus = NumUsableCPUs();
   for (int i = 0; i < num_cpus; i++) {
     Reclaim(i);
   }
@@ -973,10 +1364,16 @@ template <class Forwarder>
 inline int CpuCache<Forwarder>::FetchFromBackingCache(size_t size_class,
                                                       void** batch,
                                                       size_t count) {
+  ScopedLatencyTimer timer(LatencyProfileKind::kBackingCacheFill);
   if (UseBackingShardedTransferCache(size_class)) {
     return forwarder_.sharded_transfer_cache().RemoveRange(size_class, batch,
                                                            count);
   }
+  if (ABSL_PREDICT_FALSE(IsSingleRunner())) {
+    return forwarder_.transfer_cache()
+        .central_freelist(size_class)
+        .RemoveRange(batch, count);
+  }
   return forwarder_.transfer_cache().RemoveRange(size_class, batch, count);
 }
 
@@ -988,6 +1385,20 @@ inline void CpuCache<Forwarder>::ReleaseToBackingCache(
     return;
   }
 
+  if (ABSL_PREDICT_FALSE(IsSingleRunner())) {
+    forwarder_.transfer_cache().central_freelist(size_class).InsertRange(batch);
+    return;
+  }
+
+  // Sampled lifetimes say this class's objects mostly outlive the transfer
+  // cache's turnover: a batch parked in a slot would be plundered before any
+  // refill pops it, so hand it straight to the central freelist and leave
+  // the slot capacity to high-churn classes.
+  if (ABSL_PREDICT_FALSE(forwarder_.BypassTransferCacheOnFree(size_class))) {
+    forwarder_.transfer_cache().central_freelist(size_class).InsertRange(batch);
+    return;
+  }
+
   forwarder_.transfer_cache().InsertRange(size_class, batch);
 }
 
@@ -1000,8 +1411,9 @@ void* CpuCache<Forwarder>::AllocateSlow(size_t size_class) {
 
 template <class Forwarder>
 void* CpuCache<Forwarder>::AllocateSlowNoHooks(size_t size_class) {
+  ScopedLatencyTimer timer(LatencyProfileKind::kPerCpuAllocMiss);
   if (BypassCpuCache(size_class)) {
-    return forwarder_.sharded_transfer_cache().Pop(size_class);
+    return forwarder_.sharded_transfer_cache().PopOutbox(size_class);
   }
   auto [cpu, cached] = freelist_.CacheCpuSlab();
   if (ABSL_PREDICT_FALSE(cached)) {
@@ -1016,7 +1428,11 @@ void* CpuCache<Forwarder>::AllocateSlowNoHooks(size_t size_class) {
     }
   }
   RecordCacheMissStat(cpu, true);
-  return Refill(cpu, size_class);
+  MaybeSampleCpuCacheMiss(size_class);
+  // <cached> means the slab pointer had to be recached: the kernel clobbered
+  // it at the last context switch, so we are freshly rescheduled and any time
+  // we spend here extends the scheduling latency of whoever shares this CPU.
+  return Refill(cpu, size_class, /*recently_preempted=*/cached);
 }
 
 // Fetch more items from the central cache, refill our local cache,
@@ -1030,8 +1446,10 @@ void* CpuCache<Forwarder>::AllocateSlowNoHooks(size_t size_class) {
 // it must be safe to find ourselves migrated (at which point we atomically
 // return memory to the correct CPU.)
 template <class Forwarder>
-inline void* CpuCache<Forwarder>::Refill(int cpu, size_t size_class) {
-  const size_t target = UpdateCapacity(cpu, size_class, false);
+inline void* CpuCache<Forwarder>::Refill(int cpu, size_t size_class,
+                                         bool recently_preempted) {
+  const size_t target =
+      UpdateCapacity(cpu, size_class, false, recently_preempted);
 
   // Refill target objects in batch_length batches.
   size_t total = 0;
@@ -1042,7 +1460,15 @@ inline void* CpuCache<Forwarder>::Refill(int cpu, size_t size_class) {
 
   do {
     const size_t want = std::min(kMaxObjectsToMove, target - total);
-    got = FetchFromBackingCache(size_class, batch, want);
+    got = 0;
+    if (total == 0 && !recently_preempted) {
+      // Stealing stops a sibling cpu; right after a reschedule that is
+      // exactly the kind of optional work worth skipping.
+      got = StealObjectsFromSiblingCache(cpu, size_class, batch, want);
+    }
+    if (got == 0) {
+      got = FetchFromBackingCache(size_class, batch, want);
+    }
     if (got == 0) {
       break;
     }
@@ -1062,6 +1488,84 @@ inline void* CpuCache<Forwarder>::Refill(int cpu, size_t size_class) {
   return result;
 }
 
+template <class Forwarder>
+size_t CpuCache<Forwarder>::StealObjectsFromSiblingCache(int cpu,
+                                                         size_t size_class,
+                                                         void** batch,
+                                                         size_t n) {
+  if (ABSL_PREDICT_TRUE(
+          !forwarder_.per_cpu_caches_steal_objects_from_siblings())) {
+    return 0;
+  }
+  const CacheTopology& topology = CacheTopology::Instance();
+  const unsigned l3 = topology.GetL3FromCpuId(cpu);
+  const int num_cpus = NumUsableCPUs();
+  for (int i = 1; i < num_cpus; ++i) {
+    const int src_cpu = (cpu + i) % num_cpus;
+    if (topology.GetL3FromCpuId(src_cpu) != l3) continue;
+    if (!HasPopulated(src_cpu)) continue;
+    // Stopping the sibling cpu is not free, so only bother when it has at
+    // least a full batch of objects cached.
+    if (freelist_.Length(src_cpu, size_class) < n) continue;
+    AllocationGuardSpinLockHolder h(&resize_[src_cpu].lock);
+    subtle::percpu::ScopedSlabCpuStop cpu_stop(freelist_, src_cpu);
+    const size_t got =
+        freelist_.PopRemoteBatch(src_cpu, size_class, batch, n);
+    if (got > 0) {
+      return got;
+    }
+  }
+  return 0;
+}
+
+template <class Forwarder>
+inline size_t CpuCache<Forwarder>::AllocateBatch(size_t size_class,
+                                                 void** batch, size_t n) {
+  TC_ASSERT_GT(size_class, 0);
+  TC_ASSERT_GT(n, 0);
+  size_t got = freelist_.PopBatch(size_class, batch, n);
+  if (ABSL_PREDICT_TRUE(got == n)) {
+    return got;
+  }
+  got += AllocateBatchSlow(size_class, batch + got, n - got);
+  MaybeForceSlowPath();
+  return got;
+}
+
+template <class Forwarder>
+size_t CpuCache<Forwarder>::AllocateBatchSlow(size_t size_class, void** batch,
+                                              size_t n) {
+  size_t got = 0;
+  if (BypassCpuCache(size_class)) {
+    while (got < n) {
+      void* ptr = forwarder_.sharded_transfer_cache().PopOutbox(size_class);
+      if (ptr == nullptr) break;
+      batch[got++] = ptr;
+    }
+    return got;
+  }
+  auto [cpu, cached] = freelist_.CacheCpuSlab();
+  if (ABSL_PREDICT_TRUE(cpu >= 0)) {
+    if (cached) {
+      // The slab pointer was uncached; retry now that it is cached.
+      got = freelist_.PopBatch(size_class, batch, n);
+      if (got == n) {
+        return got;
+      }
+    }
+    // Count the batch as a single miss: it triggers one trip to the backing
+    // cache regardless of how many objects remain to be fetched.
+    RecordCacheMissStat(cpu, true);
+  }
+  while (got < n) {
+    const size_t want = std::min(kMaxObjectsToMove, n - got);
+    const size_t fetched = FetchFromBackingCache(size_class, batch + got, want);
+    if (fetched == 0) break;
+    got += fetched;
+  }
+  return got;
+}
+
 template <class Forwarder>
 inline bool CpuCache<Forwarder>::BypassCpuCache(size_t size_class) const {
   // We bypass per-cpu cache when sharded transfer cache is enabled for large
@@ -1119,7 +1623,8 @@ inline size_t TargetOverflowRefillCount(size_t capacity, size_t batch_length,
 
 template <class Forwarder>
 inline size_t CpuCache<Forwarder>::UpdateCapacity(int cpu, size_t size_class,
-                                                  bool overflow) {
+                                                  bool overflow,
+                                                  bool recently_preempted) {
   // Freelist size balancing strategy:
   //  - We grow a size class only on overflow/underflow.
   //  - We shrink size classes in Steal as it scans all size classes.
@@ -1142,30 +1647,29 @@ inline size_t CpuCache<Forwarder>::UpdateCapacity(int cpu, size_t size_class,
   // We assert that the return value, target, is non-zero, so starting from an
   // initial capacity of zero means we may be populating this core for the
   // first time.
-  absl::base_internal::LowLevelCallOnce(
-      &resize_[cpu].initialized,
-      [](CpuCache* cache, int cpu) {
-        AllocationGuardSpinLockHolder h(&cache->resize_[cpu].lock);
-        cache->freelist_.InitCpu(
-            cpu, cache->GetMaxCapacityFunctor(cache->freelist_.GetShift()));
-
-        // We update this under the lock so it's guaranteed that the populated
-        // CPUs don't change during ResizeSlabs.
-        cache->resize_[cpu].populated.store(true, std::memory_order_relaxed);
-      },
-      this, cpu);
+  InitCpuOnce(cpu);
   size_t batch_length = forwarder_.num_objects_to_move(size_class);
   const size_t max_capacity = GetMaxCapacity(size_class, freelist_.GetShift());
   size_t capacity = freelist_.Capacity(cpu, size_class);
   const bool grow_by_one = capacity < 2 * batch_length;
   uint32_t successive = 0;
   ResizeInfo& resize = resize_[cpu];
-  const int64_t now = absl::base_internal::CycleClock::Now();
+  // The coarse tick suffices for miss-interval bookkeeping and keeps a
+  // cycle-counter read off every miss.
+  const int64_t now = CoarseClock::Now();
   // TODO(ckennelly): Use a strongly typed enum.
   resize.last_miss_cycles[overflow][size_class].store(
       now, std::memory_order_relaxed);
   bool grow_by_batch =
       resize.per_class[size_class].Update(overflow, grow_by_one, &successive);
+  if (ABSL_PREDICT_FALSE(recently_preempted)) {
+    // Right after a reschedule, defer the batch-sized growth: Update() has
+    // already recorded the streak, so a later miss (or the background
+    // resize) applies it once we have been on CPU for a while.  The
+    // grow-by-one below still runs -- without the minimum capacity the
+    // cache cannot function at all.
+    grow_by_batch = false;
+  }
   if ((grow_by_one || grow_by_batch) && capacity != max_capacity) {
     size_t increase = 1;
     if (grow_by_batch) {
@@ -1178,7 +1682,11 @@ inline size_t CpuCache<Forwarder>::UpdateCapacity(int cpu, size_t size_class,
     Grow(cpu, size_class, increase);
     capacity = freelist_.Capacity(cpu, size_class);
   }
-  return TargetOverflowRefillCount(capacity, batch_length, successive);
+  const size_t target =
+      TargetOverflowRefillCount(capacity, batch_length, successive);
+  // One batch is enough to make forward progress; multi-batch transfers can
+  // wait for a visit that did not interrupt a reschedule.
+  return recently_preempted ? std::min(target, batch_length) : target;
 }
 
 inline size_t subtract_at_least(std::atomic<size_t>* a, size_t min,
@@ -1222,7 +1730,12 @@ inline void CpuCache<Forwarder>::Grow(int cpu, size_t size_class,
 
 template <class Forwarder>
 inline void CpuCache<Forwarder>::TryReclaimingCaches() {
-  const int num_cpus = NumCPUs();
+  TryReclaimingCaches(/*numa_partition=*/-1);
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::TryReclaimingCaches(int numa_partition) {
+  const int num_cpus = NumUsableCPUs();
 
   for (int cpu = 0; cpu < num_cpus; ++cpu) {
     // Nothing to reclaim if the cpu is not populated.
@@ -1230,6 +1743,14 @@ inline void CpuCache<Forwarder>::TryReclaimingCaches() {
       continue;
     }
 
+    // When scoped to a partition, leave the other partitions' caches -- and
+    // their interval snapshots below -- to their own background threads.
+    if (numa_partition >= 0 &&
+        forwarder_.numa_topology().GetCpuPartition(cpu) !=
+            static_cast<size_t>(numa_partition)) {
+      continue;
+    }
+
     uint64_t used_bytes = UsedBytes(cpu);
     uint64_t prev_used_bytes =
         resize_[cpu].reclaim_used_bytes.load(std::memory_order_relaxed);
@@ -1250,16 +1771,186 @@ inline void CpuCache<Forwarder>::TryReclaimingCaches() {
     // Takes a snapshot of used bytes in the cache at the end of this interval
     // so that we can calculate if cache usage changed in the next interval.
     //
-    // Reclaim occurs on a single thread. So, the relaxed store to used_bytes
-    // is safe.
+    // Reclaim occurs on a single thread per cpu (at most one background
+    // thread covers each NUMA partition). So, the relaxed store to
+    // used_bytes is safe.
     resize_[cpu].reclaim_used_bytes.store(used_bytes,
                                           std::memory_order_relaxed);
   }
 }
 
+template <class Forwarder>
+inline void CpuCache<Forwarder>::AcquireInternalLocks() {
+  const int num_cpus = NumUsableCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    resize_[cpu].lock.Lock();
+  }
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::ReleaseInternalLocks() {
+  const int num_cpus = NumUsableCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    resize_[cpu].lock.Unlock();
+  }
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::ReclaimInaccessibleCaches(
+    const cpu_set_t& allowed) {
+  const int num_cpus = NumUsableCPUs();
+
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+
+    // Nothing to reclaim if the cpu is not populated or its cache is already
+    // empty.
+    if (!HasPopulated(cpu) || UsedBytes(cpu) == 0) {
+      continue;
+    }
+
+    Reclaim(cpu);
+  }
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::DecayIdleCpuCaches(uint64_t miss_floor) {
+  // Fraction of a quiet cache's capacity returned per decay interval.
+  // Decaying in small steps provides hysteresis: a cache whose load returns
+  // starts missing again, which halts further decay after at most one step.
+  constexpr double kDecayPercent = 10.0;
+
+  const int num_cpus = NumUsableCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    // Nothing to decay if the cpu is not populated.
+    if (!HasPopulated(cpu)) {
+      continue;
+    }
+
+    const CpuCacheMissStats miss_stats =
+        GetAndUpdateIntervalCacheMissStats(cpu, MissCount::kDecay);
+    const uint64_t misses =
+        uint64_t{miss_stats.underflows} + uint64_t{miss_stats.overflows};
+    if (misses >= miss_floor) {
+      continue;
+    }
+
+    // Never decay below the same lower bound that protects caches from
+    // shuffle-time stealing, so an idle cache keeps a working minimum and a
+    // return of load does not start from an empty cache.
+    const uint64_t capacity = Capacity(cpu);
+    const uint64_t min_capacity = kCacheCapacityThreshold * CacheLimit();
+    if (capacity <= min_capacity) {
+      continue;
+    }
+
+    size_t to_release = kDecayPercent / 100.0 * capacity;
+    to_release = std::min<size_t>(to_release, capacity - min_capacity);
+
+    // Claim unallocated capacity first; this is cheaper than remote slab
+    // operations.
+    size_t released =
+        subtract_at_least(&resize_[cpu].available, 0, to_release);
+    if (released != 0) {
+      resize_[cpu].capacity.fetch_sub(released, std::memory_order_relaxed);
+    }
+    if (released >= to_release) {
+      continue;
+    }
+
+    AllocationGuardSpinLockHolder h(&resize_[cpu].lock);
+    subtle::percpu::ScopedSlabCpuStop cpu_stop(freelist_, cpu);
+    size_t size_class = resize_[cpu].next_steal;
+    for (size_t i = 1; i < kNumClasses; ++i, ++size_class) {
+      if (size_class >= kNumClasses) {
+        size_class = 1;
+      }
+      if (size_t shrunk = ShrinkOtherCache(cpu, size_class)) {
+        resize_[cpu].capacity.fetch_sub(shrunk, std::memory_order_relaxed);
+        released += shrunk;
+        if (released >= to_release) {
+          break;
+        }
+      }
+    }
+    resize_[cpu].next_steal = size_class;
+  }
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::PredictivelyGrowCpuCaches() {
+  void* batch[kMaxObjectsToMove];
+  const int num_cpus = NumUsableCPUs();
+
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    if (!HasPopulated(cpu)) {
+      continue;
+    }
+
+    // Only pre-provision caches that are currently quiet; a busy cache's
+    // reactive resizing is already growing the classes that miss.
+    const CpuCacheMissStats miss_stats =
+        GetAndUpdateIntervalCacheMissStats(cpu, MissCount::kPredictiveGrow);
+    if (miss_stats.underflows + miss_stats.overflows != 0) {
+      continue;
+    }
+
+    bool grew[kNumClasses] = {};
+    size_t available =
+        resize_[cpu].available.exchange(0, std::memory_order_relaxed);
+    {
+      AllocationGuardSpinLockHolder h(&resize_[cpu].lock);
+      subtle::percpu::ScopedSlabCpuStop cpu_stop(freelist_, cpu);
+      const auto max_capacity = GetMaxCapacityFunctor(freelist_.GetShift());
+      for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
+        const size_t predicted =
+            resize_[cpu].per_class[size_class].GetDemandEstimate();
+        if (predicted == 0) continue;
+
+        const ssize_t can_grow =
+            max_capacity(size_class) - freelist_.Capacity(cpu, size_class);
+        if (can_grow <= 0) continue;
+
+        // Step toward the prediction by at most a batch per interval, like
+        // reactive resizing, and only with capacity that is already free:
+        // predictive growth must not steal from classes that are in use.
+        const size_t size = forwarder_.class_to_size(size_class);
+        const size_t want = std::min<size_t>(
+            {static_cast<size_t>(can_grow),
+             forwarder_.num_objects_to_move(size_class), predicted});
+        const size_t to_grow = std::min(want, available / size);
+        if (to_grow == 0) continue;
+
+        const size_t got = freelist_.GrowOtherCache(
+            cpu, size_class, to_grow,
+            [&](uint8_t shift) { return GetMaxCapacity(size_class, shift); });
+        available -= got * size;
+        grew[size_class] = got != 0;
+      }
+    }
+    resize_[cpu].available.fetch_add(available, std::memory_order_relaxed);
+
+    // Prime the backing transfer caches for the grown classes, outside the
+    // resize lock since fetching may allocate spans.  Cycling a batch through
+    // the backing cache leaves it holding objects whose spans are already
+    // faulted in, so the ramp's refills do not pay for that work.
+    for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
+      if (!grew[size_class]) continue;
+      const int got = FetchFromBackingCache(
+          size_class, batch, forwarder_.num_objects_to_move(size_class));
+      if (got > 0) {
+        ReleaseToBackingCache(size_class,
+                              absl::Span<void*>(batch, static_cast<size_t>(got)));
+      }
+    }
+  }
+}
+
 template <class Forwarder>
 inline void CpuCache<Forwarder>::ResizeSizeClasses() {
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
   // Start resizing from where we left off the last time, and resize size class
   // capacities for up to kNumCpuCachesToResize per-cpu caches.
   int cpu = last_cpu_size_class_resize_.load(std::memory_order_relaxed);
@@ -1284,8 +1975,12 @@ inline void CpuCache<Forwarder>::ResizeSizeClasses() {
     // Record full stats in previous full stat counters so that we can collect
     // stats per interval.
     for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
-      resize_[cpu].per_class[size_class].UpdateIntervalMisses(
-          PerClassMissType::kResize);
+      PerClassResizeInfo& per_class = resize_[cpu].per_class[size_class];
+      // Feed the demand estimator with this interval's misses before the
+      // snapshot below starts the next interval.
+      per_class.UpdateDemandEstimate(
+          per_class.GetIntervalMisses(PerClassMissType::kResize));
+      per_class.UpdateIntervalMisses(PerClassMissType::kResize);
     }
 
     if (++num_cpus_resized >= kNumCpuCachesToResize) break;
@@ -1384,54 +2079,62 @@ void CpuCache<Forwarder>::ResizeCpuSizeClasses(int cpu) {
 }
 
 template <class Forwarder>
-inline void CpuCache<Forwarder>::ShuffleCpuCaches() {
-  // Knobs that we can potentially tune depending on the workloads.
+inline uint64_t CpuCache<Forwarder>::ShuffleCpuCaches() {
+  return ShuffleCpuCaches(/*numa_partition=*/-1);
+}
+
+template <class Forwarder>
+inline uint64_t CpuCache<Forwarder>::ShuffleCpuCaches(int numa_partition) {
+  // Knob that we can potentially tune depending on the workloads.
   constexpr double kBytesToStealPercent = 5.0;
-  constexpr int kMaxNumStealCpus = 5;
 
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
   absl::FixedArray<CpuMissStat> misses(num_cpus);
 
   // Record the cumulative misses for the caches so that we can select the
   // caches with the highest misses as the candidates to steal the cache for.
-  int max_populated_cpu = -1;
   int num_populated_cpus = 0;
+  uint64_t total_misses = 0;
   for (int cpu = 0; cpu < num_cpus; ++cpu) {
     if (!HasPopulated(cpu)) {
       continue;
     }
+    if (numa_partition >= 0 &&
+        forwarder_.numa_topology().GetCpuPartition(cpu) !=
+            static_cast<size_t>(numa_partition)) {
+      continue;
+    }
     const CpuCacheMissStats miss_stats =
         GetIntervalCacheMissStats(cpu, MissCount::kShuffle);
     misses[num_populated_cpus] = {cpu,
                                   miss_stats.underflows + miss_stats.overflows};
-    max_populated_cpu = cpu;
+    total_misses += misses[num_populated_cpus].misses;
     ++num_populated_cpus;
   }
-  if (max_populated_cpu == -1) {
-    return;
+  if (num_populated_cpus == 0) {
+    return 0;
   }
 
-  // Sorts misses to identify cpus with highest misses.
-  //
-  // TODO(vgogte): We can potentially sort the entire misses array and use that
-  // in StealFromOtherCache to determine cpus to steal from. That is, [0,
-  // num_dest_cpus) may be the destination cpus and [num_dest_cpus, num_cpus)
-  // may be cpus we may steal from. We can iterate through the array in a
-  // descending order to steal from them. The upside of this mechanism is that
-  // we would be able to do a more fair stealing, starting with cpus with lowest
-  // misses. The downside of this mechanism is that we would have to sort the
-  // entire misses array. This might be compute intensive on servers with high
-  // number of cpus (eg. Rome, Milan). We need to investigate the compute
-  // required to implement this.
-  const int num_dest_cpus = std::min(num_populated_cpus, kMaxNumStealCpus);
-  std::partial_sort(misses.begin(), misses.begin() + num_dest_cpus,
-                    misses.begin() + num_populated_cpus,
-                    [](CpuMissStat a, CpuMissStat b) {
-                      if (a.misses == b.misses) {
-                        return a.cpu < b.cpu;
-                      }
-                      return a.misses > b.misses;
-                    });
+  // Sort every populated cpu by interval misses, highest first.  One order
+  // drives both ends of the transfer: the highest-pressure decile receives
+  // capacity, and stealing walks the remainder from the lowest-pressure end,
+  // so capacity moves straight from the quietest caches to the busiest ones
+  // instead of converging by random sampling.  Even on wide hosts the sort
+  // is a few hundred elements, far cheaper than the slab operations that
+  // follow it.
+  std::sort(misses.begin(), misses.begin() + num_populated_cpus,
+            [](CpuMissStat a, CpuMissStat b) {
+              if (a.misses == b.misses) {
+                return a.cpu < b.cpu;
+              }
+              return a.misses > b.misses;
+            });
+
+  // Grow the highest-pressure decile (always at least one cache).
+  const int num_dest_cpus = std::max(num_populated_cpus / 10, 1);
+  const absl::Span<const CpuMissStat> src_cpus = {
+      misses.begin() + num_dest_cpus,
+      static_cast<size_t>(num_populated_cpus - num_dest_cpus)};
 
   // Try to steal kBytesToStealPercent percentage of max_per_cpu_cache_size for
   // each destination cpu cache.
@@ -1440,21 +2143,25 @@ inline void CpuCache<Forwarder>::ShuffleCpuCaches() {
     if (misses[i].misses == 0) {
       break;
     }
-    absl::Span<CpuMissStat> skip = {misses.begin(), static_cast<size_t>(i + 1)};
-    StealFromOtherCache(misses[i].cpu, max_populated_cpu, skip, to_steal);
+    StealFromOtherCache(misses[i].cpu, src_cpus, to_steal);
   }
 
   // Takes a snapshot of underflows and overflows at the end of this interval
   // so that we can calculate the misses that occurred in the next interval.
   for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    if (numa_partition >= 0 &&
+        forwarder_.numa_topology().GetCpuPartition(cpu) !=
+            static_cast<size_t>(numa_partition)) {
+      continue;
+    }
     UpdateIntervalCacheMissStats(cpu, MissCount::kShuffle);
   }
+  return total_misses;
 }
 
 template <class Forwarder>
 inline void CpuCache<Forwarder>::StealFromOtherCache(
-    int cpu, int max_populated_cpu, absl::Span<CpuMissStat> skip_cpus,
-    size_t bytes) {
+    int cpu, absl::Span<const CpuMissStat> src_cpus, size_t bytes) {
   constexpr double kCacheMissThreshold = 0.80;
 
   const CpuCacheMissStats dest_misses =
@@ -1468,41 +2175,13 @@ inline void CpuCache<Forwarder>::StealFromOtherCache(
 
   size_t acquired = 0;
 
-  // We use next_cpu_cache_steal_ as a hint to start our search for cpu ids to
-  // steal from so that we can iterate through the cpus in a nice round-robin
-  // fashion.
-  int src_cpu = next_cpu_cache_steal_;
-
-  // We iterate through max_populate_cpus number of cpus to steal from.
-  // max_populate_cpus records the max cpu id that has been populated. Note
-  // that, any intermediate changes since the max_populated_cpus was measured
-  // may have populated higher cpu ids, but we do not include those in the
-  // search. The approximation prevents us from doing another pass through the
-  // cpus to just find the latest populated cpu id.
-  //
-  // We break from the loop once we iterate through all the cpus once, or if the
-  // total number of acquired bytes is higher than or equal to the desired bytes
-  // we want to steal.
-  for (int i = 0; i <= max_populated_cpu && acquired < bytes; ++i, ++src_cpu) {
-    if (src_cpu > max_populated_cpu) {
-      src_cpu = 0;
-    }
-    TC_ASSERT_LE(0, src_cpu);
-    TC_ASSERT_LE(src_cpu, max_populated_cpu);
-
-    // We do not steal from the CPUs we want to grow. Maybe we can explore
-    // combining this with stealing from the same CPU later.
-    bool skip = false;
-    for (auto dest : skip_cpus) {
-      if (src_cpu == dest.cpu) {
-        skip = true;
-        break;
-      }
-    }
-    if (skip) continue;
-
-    // We do not steal from the cache that hasn't been populated yet.
-    if (!HasPopulated(src_cpu)) continue;
+  // src_cpus is ordered by decreasing interval misses; walk it from the back
+  // so the lowest-pressure caches give up capacity first, and stop once the
+  // total number of acquired bytes reaches the desired bytes.
+  for (auto it = src_cpus.rbegin(); it != src_cpus.rend() && acquired < bytes;
+       ++it) {
+    const int src_cpu = it->cpu;
+    TC_ASSERT_NE(src_cpu, cpu);
 
     // We do not steal from cache that has capacity less than our lower
     // capacity threshold.
@@ -1547,9 +2226,6 @@ inline void CpuCache<Forwarder>::StealFromOtherCache(
     }
     resize_[src_cpu].next_steal = source_size_class;
   }
-  // Record the last cpu id we stole from, which would provide a hint to the
-  // next time we iterate through the cpus for stealing.
-  next_cpu_cache_steal_ = src_cpu;
 
   // Increment the capacity of the destination cpu cache by the amount of bytes
   // acquired from source caches.
@@ -1561,7 +2237,7 @@ inline void CpuCache<Forwarder>::StealFromOtherCache(
 
 template <class Forwarder>
 size_t CpuCache<Forwarder>::ShrinkOtherCache(int cpu, size_t size_class) {
-  ASSERT(cpu >= 0 && cpu < NumCPUs());
+  ASSERT(cpu >= 0 && cpu < NumUsableCPUs());
   ASSERT(size_class >= 1 && size_class < kNumClasses);
   ASSERT(resize_[cpu].lock.IsHeld());
   const size_t capacity = freelist_.Capacity(cpu, size_class);
@@ -1662,8 +2338,9 @@ void CpuCache<Forwarder>::DeallocateSlow(void* ptr, size_t size_class) {
 
 template <class Forwarder>
 void CpuCache<Forwarder>::DeallocateSlowNoHooks(void* ptr, size_t size_class) {
+  ScopedLatencyTimer timer(LatencyProfileKind::kPerCpuFreeMiss);
   if (BypassCpuCache(size_class)) {
-    return forwarder_.sharded_transfer_cache().Push(size_class, ptr);
+    return forwarder_.sharded_transfer_cache().PushOutbox(size_class, ptr);
   }
   auto [cpu, cached] = freelist_.CacheCpuSlab();
   if (ABSL_PREDICT_FALSE(cached)) {
@@ -1676,7 +2353,9 @@ void CpuCache<Forwarder>::DeallocateSlowNoHooks(void* ptr, size_t size_class) {
     }
   }
   RecordCacheMissStat(cpu, false);
-  const size_t target = UpdateCapacity(cpu, size_class, true);
+  MaybeSampleCpuCacheMiss(size_class);
+  const size_t target =
+      UpdateCapacity(cpu, size_class, true, /*recently_preempted=*/cached);
   size_t total = 0;
   size_t count = 1;
   void* batch[kMaxObjectsToMove];
@@ -1739,7 +2418,7 @@ inline PerCPUMetadataState CpuCache<Forwarder>::MetadataMemoryUsage() const {
 template <class Forwarder>
 inline uint64_t CpuCache<Forwarder>::TotalUsedBytes() const {
   uint64_t total = 0;
-  for (int cpu = 0, num_cpus = NumCPUs(); cpu < num_cpus; ++cpu) {
+  for (int cpu = 0, num_cpus = NumUsableCPUs(); cpu < num_cpus; ++cpu) {
     total += UsedBytes(cpu);
   }
   return total;
@@ -1751,7 +2430,7 @@ inline uint64_t CpuCache<Forwarder>::TotalObjectsOfClass(
   TC_ASSERT_LT(size_class, kNumClasses);
   uint64_t total_objects = 0;
   if (size_class > 0) {
-    for (int cpu = 0, n = NumCPUs(); cpu < n; cpu++) {
+    for (int cpu = 0, n = NumUsableCPUs(); cpu < n; cpu++) {
       if (!HasPopulated(cpu)) {
         continue;
       }
@@ -1822,7 +2501,8 @@ inline uint64_t CpuCache<Forwarder>::Reclaim(int cpu) {
   resize_[cpu].num_reclaims.store(
       resize_[cpu].num_reclaims.load(std::memory_order_relaxed) + 1,
       std::memory_order_relaxed);
-  resize_[cpu].last_reclaim.store(absl::base_internal::CycleClock::Now(),
+  // Coarse, like the miss snapshots it is compared against.
+  resize_[cpu].last_reclaim.store(CoarseClock::Now(),
                                   std::memory_order_relaxed);
 
   return bytes;
@@ -1835,7 +2515,7 @@ inline uint64_t CpuCache<Forwarder>::GetNumResizes(int cpu) const {
 template <class Forwarder>
 inline uint64_t CpuCache<Forwarder>::GetNumResizes() const {
   uint64_t resizes = 0;
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
   for (int cpu = 0; cpu < num_cpus; ++cpu)
     resizes +=
         resize_[cpu].num_size_class_resizes.load(std::memory_order_relaxed);
@@ -1850,7 +2530,7 @@ inline uint64_t CpuCache<Forwarder>::GetNumReclaims(int cpu) const {
 template <class Forwarder>
 inline uint64_t CpuCache<Forwarder>::GetNumReclaims() const {
   uint64_t reclaims = 0;
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
   for (int cpu = 0; cpu < num_cpus; ++cpu)
     reclaims += resize_[cpu].num_reclaims.load(std::memory_order_relaxed);
   return reclaims;
@@ -1859,10 +2539,10 @@ inline uint64_t CpuCache<Forwarder>::GetNumReclaims() const {
 template <class Forwarder>
 inline std::pair<void*, size_t> CpuCache<Forwarder>::AllocOrReuseSlabs(
     absl::FunctionRef<void*(size_t, std::align_val_t)> alloc,
-    subtle::percpu::Shift shift, int num_cpus, uint8_t shift_offset) {
-  void*& reused_slabs = slabs_by_shift_[shift_offset];
+    subtle::percpu::Shift shift, int num_cpus, void*& reused_slabs) {
   const size_t size = GetSlabsAllocSize(shift, num_cpus);
   const bool can_reuse = reused_slabs != nullptr;
+  const bool huge_page_slabs = forwarder_.per_cpu_caches_huge_page_slabs();
   if (can_reuse) {
     // Enable huge pages for reused slabs.
     // TODO(b/214241843): we should be able to remove this once the kernel
@@ -1873,15 +2553,31 @@ inline std::pair<void*, size_t> CpuCache<Forwarder>::AllocOrReuseSlabs(
     reused_slabs = alloc(size, subtle::percpu::kPhysicalPageAlign);
     // MSan does not see writes in assembly.
     ANNOTATE_MEMORY_IS_INITIALIZED(reused_slabs, size);
+    if (huge_page_slabs) {
+      // Ask the kernel to back the slabs with huge pages so that fast path
+      // accesses do not thrash the dTLB on hosts with many cpus.
+      ErrnoRestorer errno_restorer;
+      madvise(reused_slabs, size, MADV_HUGEPAGE);
+    }
   }
+#ifdef MADV_COLLAPSE
+  if (huge_page_slabs) {
+    // Best effort: synchronously collapse any already faulted slab pages
+    // into huge pages.  This can fail (e.g. when compaction cannot produce
+    // a free huge page), in which case the MADV_HUGEPAGE hint above still
+    // lets khugepaged collapse the region in the background.
+    ErrnoRestorer errno_restorer;
+    madvise(reused_slabs, size, MADV_COLLAPSE);
+  }
+#endif
   return {reused_slabs, can_reuse ? size : 0};
 }
 
 template <class Forwarder>
 inline typename CpuCache<Forwarder>::DynamicSlabResize
-CpuCache<Forwarder>::ShouldResizeSlab() {
-  const int num_cpus = NumCPUs();
-  CpuCacheMissStats total_misses{};
+CpuCache<Forwarder>::ShouldResizeSlab(CpuCacheMissStats& total_misses) {
+  const int num_cpus = NumUsableCPUs();
+  total_misses = CpuCacheMissStats{};
   DynamicSlabResize resize = DynamicSlabResize::kNoop;
   const bool wider_slabs_enabled = UseWiderSlabs();
   for (int cpu = 0; cpu < num_cpus; ++cpu) {
@@ -1925,8 +2621,26 @@ template <class Forwarder>
 void CpuCache<Forwarder>::ResizeSlabIfNeeded() ABSL_NO_THREAD_SAFETY_ANALYSIS {
   uint8_t per_cpu_shift = freelist_.GetShift();
 
-  const int num_cpus = NumCPUs();
-  const DynamicSlabResize resize = ShouldResizeSlab();
+  const int num_cpus = NumUsableCPUs();
+  CpuCacheMissStats interval_misses{};
+  const DynamicSlabResize resize = ShouldResizeSlab(interval_misses);
+
+  // Hysteresis: require the same verdict for a configurable number of
+  // consecutive intervals before resizing. When the overflow/underflow ratio
+  // hovers near a threshold, acting on every verdict alternates grow and
+  // shrink, and each flap pays for slab repopulation and an madvise of the
+  // old slabs.
+  if (resize != slab_resize_verdict_) {
+    slab_resize_verdict_ = resize;
+    slab_resize_verdict_streak_ = 0;
+  }
+  ++slab_resize_verdict_streak_;
+  if (resize == DynamicSlabResize::kNoop ||
+      slab_resize_verdict_streak_ <
+          forwarder_.per_cpu_caches_dynamic_slab_hysteresis_intervals()) {
+    return;
+  }
+  slab_resize_verdict_streak_ = 0;
 
   if (resize == DynamicSlabResize::kGrow) {
     if (per_cpu_shift == shift_bounds_.max_shift) return;
@@ -1944,6 +2658,31 @@ void CpuCache<Forwarder>::ResizeSlabIfNeeded() ABSL_NO_THREAD_SAFETY_ANALYSIS {
     return;
   }
 
+  // Rank the size classes by lifetime misses summed across CPUs: the classes
+  // that miss most are the ones whose headers and slots the fast path touches
+  // most often, so the repopulated CPU regions place their slot arrays first,
+  // packed against the header area, instead of scattering them behind colder
+  // classes' arrays.
+  SizeClassMissStat miss_stats[kNumClasses - 1];
+  for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
+    size_t total_misses = 0;
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      total_misses += resize_[cpu].per_class[size_class].GetTotalMisses();
+    }
+    miss_stats[size_class - 1] =
+        SizeClassMissStat{.size_class = size_class, .misses = total_misses};
+  }
+  std::sort(miss_stats, miss_stats + kNumClasses - 1,
+            [](SizeClassMissStat a, SizeClassMissStat b) {
+              // Break ties towards smaller size classes, both to keep the
+              // order deterministic and because they are typically the hotter
+              // ones.
+              if (a.misses == b.misses) {
+                return a.size_class < b.size_class;
+              }
+              return a.misses > b.misses;
+            });
+
   const auto new_shift = subtle::percpu::ToShiftType(per_cpu_shift);
   const int64_t new_slabs_size =
       subtle::percpu::GetSlabsAllocSize(new_shift, num_cpus);
@@ -1953,6 +2692,13 @@ void CpuCache<Forwarder>::ResizeSlabIfNeeded() ABSL_NO_THREAD_SAFETY_ANALYSIS {
   forwarder_.ShrinkToUsageLimit();
 
   for (int cpu = 0; cpu < num_cpus; ++cpu) resize_[cpu].lock.Lock();
+  // All resize locks are held, so no InitCpu or ResizeSlabs is in flight and
+  // the layout order may be updated before the repopulation below reads it.
+  slab_layout_order_[0] = 0;
+  for (size_t i = 0; i < kNumClasses - 1; ++i) {
+    slab_layout_order_[i + 1] = miss_stats[i].size_class;
+  }
+  freelist_.SetClassLayoutOrder(slab_layout_order_);
   ResizeSlabsInfo info;
   int64_t reused_bytes;
   {
@@ -1965,10 +2711,10 @@ void CpuCache<Forwarder>::ResizeSlabIfNeeded() ABSL_NO_THREAD_SAFETY_ANALYSIS {
           return forwarder_.AllocReportedImpending(size, align);
         },
         new_shift, num_cpus,
-        ShiftOffset(per_cpu_shift, shift_bounds_.initial_shift));
+        slabs_by_shift_[ShiftOffset(per_cpu_shift,
+                                    shift_bounds_.initial_shift)]);
     info = freelist_.ResizeSlabs(
-        new_shift, new_slabs,
-        GetShiftMaxCapacity{max_capacity_, per_cpu_shift, shift_bounds_},
+        new_shift, new_slabs, GetMaxCapacityFunctor(per_cpu_shift),
         [this](int cpu) { return HasPopulated(cpu); },
         DrainHandler<CpuCache>{*this, nullptr});
   }
@@ -1992,6 +2738,108 @@ void CpuCache<Forwarder>::ResizeSlabIfNeeded() ABSL_NO_THREAD_SAFETY_ANALYSIS {
   const int64_t old_slabs_size = info.old_slabs_size;
   forwarder_.ArenaUpdateAllocatedAndNonresident(-old_slabs_size,
                                                 old_slabs_size - reused_bytes);
+
+  // Record the executed resize and its trigger metrics in the decision trace.
+  const size_t trace_count =
+      dynamic_slab_info_.trace_count.load(std::memory_order_relaxed);
+  DynamicSlabResizeTraceEntry& entry =
+      dynamic_slab_info_.trace[trace_count % kDynamicSlabResizeTraceLength];
+  entry.resize = resize;
+  entry.per_cpu_shift = per_cpu_shift;
+  entry.misses = interval_misses;
+  entry.madvise_failed_bytes =
+      dynamic_slab_info_.madvise_failed_bytes.load(std::memory_order_relaxed);
+  dynamic_slab_info_.trace_count.store(trace_count + 1,
+                                       std::memory_order_release);
+}
+
+template <class Forwarder>
+inline size_t CpuCache<Forwarder>::GetDynamicSlabResizeTrace(
+    absl::Span<DynamicSlabResizeTraceEntry> entries) const {
+  const size_t count =
+      dynamic_slab_info_.trace_count.load(std::memory_order_acquire);
+  const size_t available = std::min(count, kDynamicSlabResizeTraceLength);
+  // Copy the <n> most recent entries, oldest first.
+  const size_t n = std::min(available, entries.size());
+  for (size_t i = 0; i < n; ++i) {
+    entries[i] = dynamic_slab_info_
+                     .trace[(count - n + i) % kDynamicSlabResizeTraceLength];
+  }
+  return n;
+}
+
+template <class Forwarder>
+bool CpuCache<Forwarder>::SetCapacityLayout(CapacityLayout layout)
+    ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  if (layout >= CapacityLayout::kNumLayouts || layout == capacity_layout()) {
+    return false;
+  }
+
+  const uint8_t per_cpu_shift = freelist_.GetShift();
+  const int num_cpus = NumUsableCPUs();
+  const auto shift = subtle::percpu::ToShiftType(per_cpu_shift);
+  const int64_t new_slabs_size =
+      subtle::percpu::GetSlabsAllocSize(shift, num_cpus);
+  // Account for impending allocation/reusing of new slab so that we can avoid
+  // going over memory limit.
+  forwarder_.ArenaUpdateAllocatedAndNonresident(new_slabs_size, 0);
+  forwarder_.ShrinkToUsageLimit();
+
+  // A spare left behind at a different shift by an intervening slab resize is
+  // the wrong size for this swap; drop it rather than reuse it.
+  if (layout_spare_shift_ != per_cpu_shift) {
+    layout_spare_slabs_ = nullptr;
+  }
+
+  for (int cpu = 0; cpu < num_cpus; ++cpu) resize_[cpu].lock.Lock();
+  // All resize locks are held, so no InitCpu or ResizeSlabs is in flight and
+  // the active table may be rebound before the repopulation below reads it.
+  max_capacity_.store(capacity_table(layout), std::memory_order_relaxed);
+  capacity_layout_.store(static_cast<uint8_t>(layout),
+                         std::memory_order_relaxed);
+  ResizeSlabsInfo info;
+  int64_t reused_bytes;
+  {
+    // We can't allocate while holding the per-cpu spinlocks.
+    AllocationGuard enforce_no_alloc;
+
+    void* new_slabs;
+    std::tie(new_slabs, reused_bytes) = AllocOrReuseSlabs(
+        [&](size_t size, std::align_val_t align) {
+          return forwarder_.AllocReportedImpending(size, align);
+        },
+        shift, num_cpus, layout_spare_slabs_);
+    info = freelist_.ResizeSlabs(
+        shift, new_slabs, GetMaxCapacityFunctor(per_cpu_shift),
+        [this](int cpu) { return HasPopulated(cpu); },
+        DrainHandler<CpuCache>{*this, nullptr});
+  }
+  for (int cpu = 0; cpu < num_cpus; ++cpu) resize_[cpu].lock.Unlock();
+
+  // The region just vacated becomes the spare for the next same-shift swap,
+  // while the now-active region takes its place as this shift's slabs so a
+  // future resize back to this shift reuses the live bookkeeping.
+  slabs_by_shift_[ShiftOffset(per_cpu_shift, shift_bounds_.initial_shift)] =
+      layout_spare_slabs_;
+  layout_spare_slabs_ = info.old_slabs;
+  layout_spare_shift_ = per_cpu_shift;
+
+  // madvise away the old slabs memory; see ResizeSlabIfNeeded for why this
+  // must not be MADV_REMOVE.
+  ErrnoRestorer errno_restorer;
+  const bool madvise_failed =
+      madvise(info.old_slabs, info.old_slabs_size, MADV_NOHUGEPAGE) |
+      madvise(info.old_slabs, info.old_slabs_size, MADV_DONTNEED);
+  if (madvise_failed) {
+    dynamic_slab_info_.madvise_failed_bytes.fetch_add(
+        info.old_slabs_size, std::memory_order_relaxed);
+  }
+  const int64_t old_slabs_size = info.old_slabs_size;
+  forwarder_.ArenaUpdateAllocatedAndNonresident(-old_slabs_size,
+                                                old_slabs_size - reused_bytes);
+
+  capacity_layout_switches_.fetch_add(1, std::memory_order_relaxed);
+  return true;
 }
 
 template <class Forwarder>
@@ -2001,6 +2849,25 @@ inline void CpuCache<Forwarder>::RecordCacheMissStat(const int cpu,
       is_alloc ? resize_[cpu].underflows : resize_[cpu].overflows;
   auto& c = misses[MissCount::kTotal];
   c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  NoteSingleRunnerMiss(cpu);
+}
+
+template <class Forwarder>
+inline void CpuCache<Forwarder>::NoteSingleRunnerMiss(const int cpu) {
+  const uint64_t state = single_runner_state_.load(std::memory_order_relaxed);
+  const uint64_t runner = static_cast<uint64_t>(cpu + 1) << 32;
+  uint32_t streak = 0;
+  if ((state & ~uint64_t{0xffffffff}) == runner) {
+    streak = static_cast<uint32_t>(state);
+    if (streak != 0xffffffffu) ++streak;  // saturate
+  }
+  single_runner_state_.store(runner | streak, std::memory_order_relaxed);
+}
+
+template <class Forwarder>
+inline bool CpuCache<Forwarder>::IsSingleRunner() const {
+  return static_cast<uint32_t>(single_runner_state_.load(
+             std::memory_order_relaxed)) >= kSingleRunnerMissThreshold;
 }
 
 template <class Forwarder>
@@ -2018,7 +2885,7 @@ template <class Forwarder>
 inline typename CpuCache<Forwarder>::CpuCacheMissStats
 CpuCache<Forwarder>::GetTotalCacheMissStats() const {
   CpuCacheMissStats stats;
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
   for (int cpu = 0; cpu < num_cpus; ++cpu) stats += GetTotalCacheMissStats(cpu);
   return stats;
 }
@@ -2074,6 +2941,17 @@ size_t CpuCache<Forwarder>::GetIntervalSizeClassMisses(int cpu,
   return resize_[cpu].per_class[size_class].GetIntervalMisses(type);
 }
 
+template <class Forwarder>
+size_t CpuCache<Forwarder>::GetTotalSizeClassMisses(size_t size_class) {
+  TC_ASSERT_LT(size_class, kNumClasses);
+  size_t total_misses = 0;
+  const int num_cpus = NumUsableCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    total_misses += resize_[cpu].per_class[size_class].GetTotalMisses();
+  }
+  return total_misses;
+}
+
 template <class Forwarder>
 inline typename CpuCache<Forwarder>::SizeClassCapacityStats
 CpuCache<Forwarder>::GetSizeClassCapacityStats(size_t size_class) const {
@@ -2083,12 +2961,14 @@ CpuCache<Forwarder>::GetSizeClassCapacityStats(size_t size_class) const {
   // SizeClassCapacityStats struct to make sure we do not end up with SIZE_MAX
   // in stats.min_capacity when num_populated is equal to zero.
   size_t min_capacity = SIZE_MAX;
+  // Precise on purpose: the snapshots above are coarse ticks, and a precise
+  // reader guarantees now >= every snapshot it is subtracted from.
   const double now = absl::base_internal::CycleClock::Now();
   const double frequency = absl::base_internal::CycleClock::Frequency();
 
   // Scan through all per-CPU caches and calculate minimum, average and maximum
   // capacities for the size class <size_class> across all the populated caches.
-  for (int cpu = 0, num_cpus = NumCPUs(); cpu < num_cpus; ++cpu) {
+  for (int cpu = 0, num_cpus = NumUsableCPUs(); cpu < num_cpus; ++cpu) {
     // We do not include stats for non-populated cpus in our average.
     if (!HasPopulated(cpu)) {
       continue;
@@ -2161,7 +3041,7 @@ inline void CpuCache<Forwarder>::Print(Printer* out) const {
   out->printf("------------------------------------------------\n");
 
   const cpu_set_t allowed_cpus = FillActiveCpuMask();
-  const int num_cpus = NumCPUs();
+  const int num_cpus = NumUsableCPUs();
 
   for (int cpu = 0; cpu < num_cpus; ++cpu) {
     static constexpr double MiB = 1048576.0;
@@ -2246,7 +3126,7 @@ template <class Forwarder>
 inline void CpuCache<Forwarder>::PrintInPbtxt(PbtxtRegion* region) const {
   const cpu_set_t allowed_cpus = FillActiveCpuMask();
 
-  for (int cpu = 0, num_cpus = NumCPUs(); cpu < num_cpus; ++cpu) {
+  for (int cpu = 0, num_cpus = NumUsableCPUs(); cpu < num_cpus; ++cpu) {
     PbtxtRegion entry = region->CreateSubRegion("cpu_cache");
     uint64_t rbytes = UsedBytes(cpu);
     bool populated = HasPopulated(cpu);
@@ -2304,6 +3184,7 @@ inline void CpuCache<Forwarder>::PrintInPbtxt(PbtxtRegion* region) const {
 template <class Forwarder>
 inline void CpuCache<Forwarder>::PerClassResizeInfo::Init() {
   state_.store(0, std::memory_order_relaxed);
+  demand_estimate_.store(0, std::memory_order_relaxed);
 }
 
 template <class Forwarder>
@@ -2372,6 +3253,28 @@ void CpuCache<Forwarder>::PerClassResizeInfo::UpdateIntervalMisses(
   misses_[type].store(total_misses, std::memory_order_relaxed);
 }
 
+template <class Forwarder>
+void CpuCache<Forwarder>::PerClassResizeInfo::UpdateDemandEstimate(
+    size_t interval_misses) {
+  const size_t scaled = interval_misses << kDemandFractionBits;
+  size_t estimate = demand_estimate_.load(std::memory_order_relaxed);
+  if (scaled > estimate) {
+    // Fast attack: close 3/4 of the gap to the new demand.
+    estimate += (scaled - estimate) - ((scaled - estimate) >> 2);
+  } else {
+    // Slow decay: lose 1/64th per interval.
+    estimate -= estimate >> 6;
+  }
+  // Estimate updates occur on a single thread, so the relaxed store is safe.
+  demand_estimate_.store(estimate, std::memory_order_relaxed);
+}
+
+template <class Forwarder>
+inline size_t CpuCache<Forwarder>::PerClassResizeInfo::GetDemandEstimate() {
+  return demand_estimate_.load(std::memory_order_relaxed) >>
+         kDemandFractionBits;
+}
+
 }  // namespace cpu_cache_internal
 
 // Static forward declares CpuCache to avoid a cycle in headers.  Make
@@ -2380,6 +3283,13 @@ class CpuCache final
     : public cpu_cache_internal::CpuCache<cpu_cache_internal::StaticForwarder> {
 };
 
+// Called when per-CPU caches are configured but rseq is unavailable (old
+// kernel, seccomp filtering, or a conflicting registration).  Logs a one-time
+// structured warning and widens the overall thread-cache budget by the
+// capacity the per-CPU caches would have used, so the fallback degrades less.
+// Safe to call repeatedly; only the first call acts.
+void HandlePerCpuUnavailable();
+
 template <typename State>
 inline bool UsePerCpuCache(State& state) {
   // We expect a fast path of per-CPU caches being active and the thread being
@@ -0,0 +1,137 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/cpu_cache_miss_profiler.h"
+
+#include <string.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/debugging/stacktrace.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/stack_trace_table.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Misses are already a slow path (they take backing-cache locks), so a
+// modest period keeps the added cost in the noise while converging on hot
+// sites within seconds.
+constexpr size_t kCpuCacheMissSamplePeriod = 64;
+
+// A process has a handful of subsystems worth arena-ifying; the table exists
+// to rank them, not to enumerate every cold call site.  Overflow is counted
+// so a profile reader can tell when the table was too small.
+constexpr int kMaxMissSites = 256;
+
+struct MissSite {
+  size_t count;  // sampled misses attributed to this site
+  size_t size_class;
+  int depth;
+  void* stack[kMaxStackDepth];
+};
+
+ABSL_CONST_INIT absl::base_internal::SpinLock miss_table_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+ABSL_CONST_INIT MissSite miss_sites[kMaxMissSites]
+    ABSL_GUARDED_BY(miss_table_lock) = {};
+ABSL_CONST_INIT int num_miss_sites ABSL_GUARDED_BY(miss_table_lock) = 0;
+
+ABSL_CONST_INIT std::atomic<size_t> miss_ticker{0};
+ABSL_CONST_INIT std::atomic<size_t> dropped_samples{0};
+
+// Captures the stack of the current miss and merges it into the site table.
+// Outlined so MaybeSampleCpuCacheMiss pays only the ticker on the common
+// path.
+ABSL_ATTRIBUTE_NOINLINE void RecordMissStack(size_t size_class) {
+  void* stack[kMaxStackDepth];
+  // Skip RecordMissStack and MaybeSampleCpuCacheMiss; the profile should
+  // start at the allocation path that missed.
+  const int depth = absl::GetStackTrace(stack, kMaxStackDepth, 2);
+
+  AllocationGuardSpinLockHolder l(&miss_table_lock);
+  for (int i = 0; i < num_miss_sites; ++i) {
+    MissSite& site = miss_sites[i];
+    if (site.size_class == size_class && site.depth == depth &&
+        memcmp(site.stack, stack, depth * sizeof(stack[0])) == 0) {
+      ++site.count;
+      return;
+    }
+  }
+  if (num_miss_sites == kMaxMissSites) {
+    dropped_samples.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  MissSite& site = miss_sites[num_miss_sites++];
+  site.count = 1;
+  site.size_class = size_class;
+  site.depth = depth;
+  memcpy(site.stack, stack, depth * sizeof(stack[0]));
+}
+
+}  // namespace
+
+void MaybeSampleCpuCacheMiss(size_t size_class) {
+  if (ABSL_PREDICT_TRUE(miss_ticker.fetch_add(1, std::memory_order_relaxed) %
+                            kCpuCacheMissSamplePeriod !=
+                        0)) {
+    return;
+  }
+  RecordMissStack(size_class);
+}
+
+std::unique_ptr<const ProfileBase> DumpCpuCacheMissProfile(Static& state) {
+  auto profile = std::make_unique<StackTraceTable>(ProfileType::kCpuCacheMiss);
+  // Sites are only appended, so iterating by index while dropping the lock
+  // between entries is safe; AddTrace allocates and must not run under
+  // miss_table_lock.
+  for (int i = 0;; ++i) {
+    MissSite site;
+    {
+      AllocationGuardSpinLockHolder l(&miss_table_lock);
+      if (i >= num_miss_sites) {
+        break;
+      }
+      site = miss_sites[i];
+    }
+    StackTrace t{};
+    t.depth = site.depth;
+    memcpy(t.stack, site.stack, site.depth * sizeof(t.stack[0]));
+    // With requested_size = 0 and weight = 1, AddTrace reports exactly
+    // sample_weight misses of allocated_size-byte objects; extrapolate the
+    // sampled count by the sampling period.
+    t.weight = 1;
+    t.requested_size = 0;
+    t.allocated_size = state.sizemap().class_to_size(site.size_class);
+    TC_ASSERT_GT(t.allocated_size, 0);
+    profile->AddTrace(site.count * kCpuCacheMissSamplePeriod, t);
+  }
+  return profile;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,50 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sampled attribution of per-CPU cache misses to calling contexts.  The
+// per-cpu miss counters say which size class misses but not who caused it;
+// here every Nth Refill/Overflow captures a stack trace into a small
+// fixed-size site table, and the aggregate is exposed as
+// ProfileType::kCpuCacheMiss through MallocExtension::SnapshotCurrent.
+// Sample counts are extrapolated by the sampling period, so the profile
+// estimates total misses per site, not just sampled ones.
+
+#ifndef TCMALLOC_CPU_CACHE_MISS_PROFILER_H_
+#define TCMALLOC_CPU_CACHE_MISS_PROFILER_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/malloc_extension.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+class Static;
+
+// Called on every per-cpu cache miss (a Refill or Overflow).  Decrements a
+// ticker and, on every kCpuCacheMissSamplePeriod-th call, records the
+// calling stack.  Does not allocate; the miss path is inside the allocator.
+void MaybeSampleCpuCacheMiss(size_t size_class);
+
+// Builds the kCpuCacheMiss profile from the site table.
+std::unique_ptr<const ProfileBase> DumpCpuCacheMissProfile(Static& state);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_CPU_CACHE_MISS_PROFILER_H_
@@ -14,6 +14,7 @@
 
 #include "tcmalloc/cpu_cache.h"
 
+#include <sched.h>
 #include <sys/mman.h>
 
 #include <algorithm>
@@ -61,6 +62,12 @@ class CpuCachePeer {
     return cpu_cache.freelist_.GetShift();
   }
 
+  template <typename CpuCache>
+  static uint16_t GetMaxCapacity(const CpuCache& cpu_cache, int size_class,
+                                 uint8_t shift) {
+    return cpu_cache.GetMaxCapacity(size_class, shift);
+  }
+
   template <typename CpuCache>
   static void IncrementCacheMisses(CpuCache& cpu_cache) {
     cpu_cache.RecordCacheMissStat(/*cpu=*/0, /*is_alloc=*/true);
@@ -89,6 +96,32 @@ class CpuCachePeer {
   static size_t ResizeInfoSize() {
     return sizeof(typename CpuCache::ResizeInfo);
   }
+
+  // Reports the name and byte offset of every ResizeInfo field, in
+  // declaration order, for the layout audit in ResizeInfoLayout.
+  template <typename CpuCache>
+  static std::vector<std::pair<const char*, size_t>> ResizeInfoFieldOffsets() {
+    using ResizeInfo = typename CpuCache::ResizeInfo;
+    static ResizeInfo info;
+    const char* base = reinterpret_cast<const char*>(&info);
+    auto offset = [base](const void* field) {
+      return static_cast<size_t>(reinterpret_cast<const char*>(field) - base);
+    };
+    return {{"available", offset(&info.available)},
+            {"next_steal", offset(&info.next_steal)},
+            {"initialized", offset(&info.initialized)},
+            {"populated", offset(&info.populated)},
+            {"lock", offset(&info.lock)},
+            {"per_class", offset(&info.per_class)},
+            {"underflows", offset(&info.underflows)},
+            {"overflows", offset(&info.overflows)},
+            {"last_miss_cycles", offset(&info.last_miss_cycles)},
+            {"capacity", offset(&info.capacity)},
+            {"num_size_class_resizes", offset(&info.num_size_class_resizes)},
+            {"reclaim_used_bytes", offset(&info.reclaim_used_bytes)},
+            {"num_reclaims", offset(&info.num_reclaims)},
+            {"last_reclaim", offset(&info.last_reclaim)}};
+  }
 };
 
 namespace {
@@ -139,6 +172,18 @@ class TestStaticForwarder {
 
   bool per_cpu_caches_dynamic_slab_enabled() { return dynamic_slab_enabled_; }
 
+  bool per_cpu_caches_eager_slab_init() { return eager_slab_init_; }
+
+  int64_t per_cpu_caches_pop_prefetch_min_object_size() {
+    return pop_prefetch_min_object_size_;
+  }
+
+  bool per_cpu_caches_steal_objects_from_siblings() {
+    return steal_objects_from_siblings_;
+  }
+
+  bool per_cpu_caches_huge_page_slabs() { return huge_page_slabs_; }
+
   double per_cpu_caches_dynamic_slab_grow_threshold() {
     if (dynamic_slab_grow_threshold_ >= 0) return dynamic_slab_grow_threshold_;
     return dynamic_slab_ == DynamicSlab::kGrow
@@ -154,6 +199,10 @@ class TestStaticForwarder {
                : -1.0;
   }
 
+  int64_t per_cpu_caches_dynamic_slab_hysteresis_intervals() {
+    return dynamic_slab_hysteresis_intervals_;
+  }
+
   size_t class_to_size(int size_class) const {
     if (size_map_.has_value()) {
       return size_map_->class_to_size(size_class);
@@ -213,6 +262,10 @@ class TestStaticForwarder {
     return transfer_cache_;
   }
 
+  bool BypassTransferCacheOnFree(size_t size_class) const {
+    return bypass_transfer_cache_on_free_;
+  }
+
   bool UseGenericShardedCache() const { return owner_.UseGenericCache(); }
   void SetGenericShardedCache(bool value) { owner_.SetGenericCache(value); }
   bool UseShardedCacheForLargeClassesOnly() const {
@@ -226,10 +279,16 @@ class TestStaticForwarder {
   int64_t arena_reported_impending_bytes_ = 0;
   size_t shrink_to_usage_limit_calls_ = 0;
   bool dynamic_slab_enabled_ = false;
+  bool eager_slab_init_ = false;
+  int64_t pop_prefetch_min_object_size_ = -1;
+  bool steal_objects_from_siblings_ = false;
+  bool huge_page_slabs_ = false;
   double dynamic_slab_grow_threshold_ = -1;
   double dynamic_slab_shrink_threshold_ = -1;
+  int64_t dynamic_slab_hysteresis_intervals_ = 1;
   bool wider_slabs_enabled_ = false;
   bool configure_size_class_max_capacity_ = false;
+  bool bypass_transfer_cache_on_free_ = false;
   DynamicSlab dynamic_slab_ = DynamicSlab::kNoop;
   std::optional<SizeMap> size_map_;
 
@@ -298,6 +357,29 @@ TEST(CpuCacheTest, MinimumShardsForGenericCache) {
             num_to_move / 2 + 1);
 }
 
+TEST(CpuCacheTest, LongLivedClassBypassesTransferCache) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+  CpuCache cache;
+  cache.Activate();
+
+  TestStaticForwarder& forwarder = cache.forwarder();
+  // Pretend sampled lifetimes marked every class as mostly long-lived.
+  forwarder.bypass_transfer_cache_on_free_ = true;
+
+  constexpr int kCpuId = 0;
+  ScopedFakeCpuId fake_cpu_id(kCpuId);
+  constexpr size_t kSizeClass = 1;
+
+  void* ptr = cache.Allocate(kSizeClass);
+  cache.Deallocate(ptr, kSizeClass);
+  cache.Reclaim(kCpuId);
+  // The reclaimed batch went straight to the central freelist, not into
+  // transfer-cache slots.
+  EXPECT_EQ(forwarder.transfer_cache().tc_length(kSizeClass), 0);
+}
+
 TEST(CpuCacheTest, UsesShardedAsBackingCache) {
   if (!subtle::percpu::IsFast()) {
     return;
@@ -339,10 +421,15 @@ TEST(CpuCacheTest, UsesShardedAsBackingCache) {
   EXPECT_EQ(sharded_transfer_cache.NumActiveShards(), 1);
 
   // Free objects to confirm that they are indeed released back to the sharded
-  // transfer cache.
+  // transfer cache.  Frees park in the per-cpu outbox until it fills or the
+  // background thread flushes it, so flush explicitly before checking.
   cache.Deallocate(ptr, kSizeClass);
   cache.Reclaim(0);
   sharded_stats = sharded_transfer_cache.GetStats(kSizeClass);
+  EXPECT_EQ(sharded_stats.insert_hits, 0);
+  EXPECT_EQ(sharded_stats.insert_misses, 0);
+  sharded_transfer_cache.FlushOutboxes();
+  sharded_stats = sharded_transfer_cache.GetStats(kSizeClass);
   EXPECT_EQ(sharded_stats.insert_hits, 1);
   EXPECT_EQ(sharded_stats.insert_misses, 0);
 
@@ -362,6 +449,34 @@ TEST(CpuCacheTest, ResizeInfoNoFalseSharing) {
   EXPECT_EQ(resize_info_size % ABSL_CACHELINE_SIZE, 0) << resize_info_size;
 }
 
+// Dumps the ResizeInfo layout annotated with cacheline indices and verifies
+// the writer grouping: the counters the owning CPU bumps on its miss path
+// (underflows, overflows, last_miss_cycles) and the fields the background
+// thread writes (capacity onward) each start on their own cacheline, so
+// cross-CPU writes do not invalidate lines the owner's fast path is using.
+TEST(CpuCacheTest, ResizeInfoLayout) {
+  const auto fields = CpuCachePeer::ResizeInfoFieldOffsets<CpuCache>();
+  for (const auto& [name, offset] : fields) {
+    std::cout << name << " offset=" << offset
+              << " cacheline=" << offset / ABSL_CACHELINE_SIZE << "\n";
+  }
+
+  auto offset_of = [&](const char* name) {
+    for (const auto& [field, offset] : fields) {
+      if (std::string(field) == name) return offset;
+    }
+    ADD_FAILURE() << "unknown field " << name;
+    return size_t{0};
+  };
+  // Group heads are cacheline-aligned.
+  EXPECT_EQ(offset_of("available"), 0);
+  EXPECT_EQ(offset_of("underflows") % ABSL_CACHELINE_SIZE, 0);
+  EXPECT_EQ(offset_of("capacity") % ABSL_CACHELINE_SIZE, 0);
+  // The owner-hot group does not spill into the background group's line.
+  EXPECT_LT(offset_of("last_miss_cycles") / ABSL_CACHELINE_SIZE,
+            offset_of("capacity") / ABSL_CACHELINE_SIZE);
+}
+
 TEST(CpuCacheTest, Metadata) {
   if (!subtle::percpu::IsFast()) {
     return;
@@ -503,6 +618,27 @@ TEST(CpuCacheTest, Metadata) {
   cache.Deactivate();
 }
 
+TEST(CpuCacheTest, EagerSlabInitPopulatesAllCpus) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  cache.forwarder().eager_slab_init_ = true;
+  cache.Activate();
+
+  // Every cpu's slab region is laid out at activation: first allocations pay
+  // no InitCpu cost.  Capacities and used bytes still start at zero.
+  const int num_cpus = NumCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    EXPECT_TRUE(cache.HasPopulated(cpu));
+    EXPECT_EQ(cache.UsedBytes(cpu), 0);
+  }
+
+  cache.Deactivate();
+}
+
 TEST(CpuCacheTest, CacheMissStats) {
   if (!subtle::percpu::IsFast()) {
     return;
@@ -710,6 +846,59 @@ TEST(CpuCacheTest, StealCpuCache) {
   cache.Deactivate();
 }
 
+// Stress for the writer-grouped ResizeInfo layout: worker threads drive the
+// owner-hot miss counters from every CPU while a single background thread
+// exercises all the cross-CPU writers at once -- size class resizes, cache
+// shuffling, and reclaim of idle caches.  The test verifies that capacity
+// accounting survives the concurrency; run it under `perf c2c` to measure the
+// coherence traffic between the owner-hot and background cachelines.
+TEST(CpuCacheTest, StressResizeInfoSharing) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  cache.Activate();
+
+  std::vector<std::thread> threads;
+  const int n_threads = NumCPUs();
+  std::atomic<bool> stop(false);
+
+  for (size_t t = 0; t < n_threads; ++t) {
+    threads.push_back(
+        std::thread(StressThread, std::ref(cache), t, std::ref(stop)));
+  }
+  std::thread background([&] {
+    while (!stop.load(std::memory_order_acquire)) {
+      cache.ResizeSizeClasses();
+      cache.ShuffleCpuCaches();
+      cache.TryReclaimingCaches();
+      absl::SleepFor(absl::Milliseconds(10));
+    }
+  });
+
+  absl::SleepFor(absl::Seconds(5));
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  background.join();
+
+  // Check that the total capacity is preserved through the combined resize,
+  // shuffle, and reclaim traffic.
+  size_t capacity = 0;
+  const int num_cpus = NumCPUs();
+  const size_t kTotalCapacity = num_cpus * Parameters::max_per_cpu_cache_size();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    EXPECT_EQ(cache.Allocated(cpu) + cache.Unallocated(cpu),
+              cache.Capacity(cpu));
+    capacity += cache.Capacity(cpu);
+  }
+  EXPECT_EQ(capacity, kTotalCapacity);
+
+  cache.Deactivate();
+}
+
 // Test that when dynamic slab is enabled, nothing goes horribly wrong and that
 // arena non-resident bytes increases as expected.
 TEST(CpuCacheTest, DynamicSlab) {
@@ -790,6 +979,50 @@ TEST(CpuCacheTest, DynamicSlab) {
   cache.Deactivate();
 }
 
+// Verifies that executed slab resizes are recorded in the decision trace and
+// that hysteresis defers a resize until the verdict has repeated for the
+// configured number of intervals.
+TEST(CpuCacheTest, DynamicSlabResizeTrace) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+  CpuCache cache;
+  TestStaticForwarder& forwarder = cache.forwarder();
+  forwarder.dynamic_slab_enabled_ = true;
+  forwarder.dynamic_slab_ = DynamicSlab::kGrow;
+  forwarder.dynamic_slab_hysteresis_intervals_ = 3;
+
+  cache.Activate();
+
+  cpu_cache_internal::SlabShiftBounds shift_bounds =
+      cache.GetPerCpuSlabShiftBounds();
+
+  CpuCache::DynamicSlabResizeTraceEntry
+      trace[CpuCache::kDynamicSlabResizeTraceLength];
+  EXPECT_EQ(cache.GetDynamicSlabResizeTrace(absl::MakeSpan(trace)), 0);
+
+  // With hysteresis of three intervals, the first two grow verdicts must not
+  // resize the slab.
+  for (int i = 0; i < 2; ++i) {
+    CpuCachePeer::IncrementCacheMisses(cache);
+    cache.ResizeSlabIfNeeded();
+    EXPECT_EQ(CpuCachePeer::GetSlabShift(cache), shift_bounds.initial_shift);
+    EXPECT_EQ(cache.GetDynamicSlabResizeTrace(absl::MakeSpan(trace)), 0);
+  }
+
+  // The third consecutive grow verdict resizes the slab and records a trace
+  // entry with the interval misses that triggered it.
+  CpuCachePeer::IncrementCacheMisses(cache);
+  cache.ResizeSlabIfNeeded();
+  EXPECT_EQ(CpuCachePeer::GetSlabShift(cache), shift_bounds.initial_shift + 1);
+  ASSERT_EQ(cache.GetDynamicSlabResizeTrace(absl::MakeSpan(trace)), 1);
+  EXPECT_EQ(trace[0].resize, CpuCache::DynamicSlabResize::kGrow);
+  EXPECT_EQ(trace[0].per_cpu_shift, shift_bounds.initial_shift + 1);
+  EXPECT_GT(trace[0].misses.underflows + trace[0].misses.overflows, 0);
+
+  cache.Deactivate();
+}
+
 void AllocateThenDeallocate(CpuCache& cache, int cpu, size_t size_class,
                             int ops) {
   std::vector<void*> objects;
@@ -804,6 +1037,97 @@ void AllocateThenDeallocate(CpuCache& cache, int cpu, size_t size_class,
   objects.clear();
 }
 
+// Verifies that swapping the capacity layout rebuilds the slabs at the
+// current shift (a shape change, not a shift change), rebinds the per-class
+// capacity bounds in the expected direction, and keeps serving allocations
+// across repeated swaps.
+TEST(CpuCacheTest, CapacityLayoutSwap) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+  CpuCache cache;
+  cache.Activate();
+
+  const uint8_t shift = CpuCachePeer::GetSlabShift(cache);
+  constexpr size_t kSmallClass = 1;
+  constexpr size_t kLargeClass = kNumBaseClasses - 1;
+  const uint16_t default_small =
+      CpuCachePeer::GetMaxCapacity(cache, kSmallClass, shift);
+  const uint16_t default_large =
+      CpuCachePeer::GetMaxCapacity(cache, kLargeClass, shift);
+  ASSERT_GT(default_small, 0);
+  ASSERT_GT(default_large, 0);
+
+  EXPECT_EQ(cache.capacity_layout(), CpuCache::CapacityLayout::kDefault);
+  // Selecting the active layout is a no-op.
+  EXPECT_FALSE(cache.SetCapacityLayout(CpuCache::CapacityLayout::kDefault));
+  EXPECT_EQ(cache.GetNumCapacityLayoutSwitches(), 0);
+
+  ASSERT_TRUE(cache.SetCapacityLayout(CpuCache::CapacityLayout::kSmallDeep));
+  EXPECT_EQ(cache.capacity_layout(), CpuCache::CapacityLayout::kSmallDeep);
+  EXPECT_EQ(CpuCachePeer::GetSlabShift(cache), shift);
+  // The small-deep layout takes depth from the large classes and hands it to
+  // the small ones (or degrades to the default split if it did not fit).
+  EXPECT_GE(CpuCachePeer::GetMaxCapacity(cache, kSmallClass, shift),
+            default_small);
+  EXPECT_LE(CpuCachePeer::GetMaxCapacity(cache, kLargeClass, shift),
+            default_large);
+  AllocateThenDeallocate(cache, /*cpu=*/0, kSmallClass, /*ops=*/128);
+
+  ASSERT_TRUE(cache.SetCapacityLayout(CpuCache::CapacityLayout::kLargeDeep));
+  EXPECT_LE(CpuCachePeer::GetMaxCapacity(cache, kSmallClass, shift),
+            default_small);
+  EXPECT_GE(CpuCachePeer::GetMaxCapacity(cache, kLargeClass, shift),
+            default_large);
+  AllocateThenDeallocate(cache, /*cpu=*/0, kLargeClass, /*ops=*/128);
+
+  // Round-tripping back restores the default table exactly.
+  ASSERT_TRUE(cache.SetCapacityLayout(CpuCache::CapacityLayout::kDefault));
+  EXPECT_EQ(CpuCachePeer::GetMaxCapacity(cache, kSmallClass, shift),
+            default_small);
+  EXPECT_EQ(CpuCachePeer::GetMaxCapacity(cache, kLargeClass, shift),
+            default_large);
+  EXPECT_EQ(cache.GetNumCapacityLayoutSwitches(), 3);
+
+  cache.Deactivate();
+}
+
+// Swaps layouts while allocator threads are running to exercise the
+// stop/drain/repopulate choreography under contention.
+TEST(CpuCacheTest, CapacityLayoutSwapStress) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+  CpuCache cache;
+  cache.Activate();
+
+  std::vector<std::thread> threads;
+  const int n_threads = NumCPUs();
+  std::atomic<bool> stop(false);
+  for (size_t t = 0; t < n_threads; ++t) {
+    threads.push_back(
+        std::thread(StressThread, std::ref(cache), t, std::ref(stop)));
+  }
+
+  const CpuCache::CapacityLayout layouts[] = {
+      CpuCache::CapacityLayout::kSmallDeep,
+      CpuCache::CapacityLayout::kLargeDeep,
+      CpuCache::CapacityLayout::kDefault,
+  };
+  for (int i = 0; i < 9; ++i) {
+    absl::SleepFor(absl::Milliseconds(50));
+    EXPECT_TRUE(cache.SetCapacityLayout(layouts[i % 3]));
+  }
+  EXPECT_EQ(cache.GetNumCapacityLayoutSwitches(), 9);
+
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  cache.Deactivate();
+}
+
 // In this test, we check if we can resize size classes based on the number of
 // misses they encounter. First, we exhaust cache capacity by filling up
 // larger size class as much as possible. Then, we try to allocate objects for
@@ -898,6 +1222,71 @@ TEST(CpuCacheTest, ResizeSizeClassesTest) {
   cache.Deactivate();
 }
 
+// Verifies that the background predictive-grow pass rebuilds per-size-class
+// capacity from recorded demand after a cache has gone quiet and been
+// drained.
+TEST(CpuCacheTest, PredictivelyGrowCpuCaches) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  // Reduce cache capacity so that size classes record capacity misses.
+  const size_t max_cpu_cache_size = 128 << 10;
+  cache.SetCacheLimit(max_cpu_cache_size);
+  cache.Activate();
+
+  constexpr int kCpuId = 0;
+  constexpr int kSmallClass = 1;
+  constexpr int kLargeClass = 2;
+  const int kMaxCapacity = cache.forwarder().max_capacity(kLargeClass);
+  const size_t batch_size_small =
+      cache.forwarder().num_objects_to_move(kSmallClass);
+  const size_t batch_size_large =
+      cache.forwarder().num_objects_to_move(kLargeClass);
+
+  // With no recorded demand, predictive growth is a no-op.
+  cache.PredictivelyGrowCpuCaches();
+  EXPECT_EQ(cache.Allocated(kCpuId), 0);
+
+  // Saturate the cache with the large class, then miss on the small class so
+  // it records capacity misses.
+  size_t ops = 0;
+  while (true) {
+    ops += batch_size_large;
+    if (ops > kMaxCapacity || cache.Allocated(kCpuId) == max_cpu_cache_size)
+      break;
+    AllocateThenDeallocate(cache, kCpuId, kLargeClass, ops);
+  }
+  AllocateThenDeallocate(cache, kCpuId, kSmallClass, batch_size_small);
+  ASSERT_GT(cache.GetIntervalSizeClassMisses(kCpuId, kSmallClass,
+                                             PerClassMissType::kResize),
+            0);
+
+  // Feed the demand estimator.
+  const int num_resizes = NumCPUs() / CpuCache::kNumCpuCachesToResize + 1;
+  for (int i = 0; i < num_resizes; ++i) {
+    cache.ResizeSizeClasses();
+  }
+
+  // Drain the cache, as reclaim of an idle cache would; its capacity returns
+  // to the cpu's slack.
+  cache.Reclaim(kCpuId);
+
+  // The first pass snapshots the misses from the build-up above and skips the
+  // cache as busy; the second finds it quiet and pre-grows toward the
+  // recorded demand.
+  cache.PredictivelyGrowCpuCaches();
+  cache.PredictivelyGrowCpuCaches();
+
+  CpuCache::SizeClassCapacityStats stats =
+      cache.GetSizeClassCapacityStats(kSmallClass);
+  EXPECT_GT(stats.max_capacity, 0);
+
+  // Reclaim caches.
+  cache.Deactivate();
+}
+
 // Runs a single allocate and deallocate operation to warm up the cache. Once a
 // few objects are allocated in the cold cache, we can shuffle cpu caches to
 // steal that capacity from the cold cache to the hot cache.
@@ -1276,6 +1665,167 @@ TEST(CpuCacheTest, ReclaimCpuCache) {
   cache.Deactivate();
 }
 
+// Verifies that a reclaim pass scoped to one NUMA partition drains only that
+// partition's idle caches, and that passes over all partitions cover every
+// cpu between them.
+TEST(CpuCacheTest, ReclaimScopedToNumaPartition) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  cache.Activate();
+
+  const size_t kSizeClass = 2;
+  const int num_cpus = NumCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    ColdCacheOperations(cache, cpu, kSizeClass);
+    ASSERT_TRUE(cache.HasPopulated(cpu));
+  }
+
+  // A pass scoped to a partition with no cpus must not touch any cache.
+  constexpr int kAbsentPartition = static_cast<int>(kNumaPartitions);
+  cache.TryReclaimingCaches(kAbsentPartition);
+  cache.TryReclaimingCaches(kAbsentPartition);
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    EXPECT_GT(cache.UsedBytes(cpu), 0);
+    EXPECT_EQ(cache.GetNumReclaims(cpu), 0);
+  }
+
+  // Passes scoped to the real partitions reach every cpu: the first
+  // snapshots each cache's interval, the second reclaims the now-idle
+  // caches.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int partition = 0; partition < kAbsentPartition; ++partition) {
+      cache.TryReclaimingCaches(partition);
+    }
+  }
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    EXPECT_EQ(cache.UsedBytes(cpu), 0);
+    EXPECT_EQ(cache.GetNumReclaims(cpu), 1);
+  }
+
+  cache.Deactivate();
+}
+
+TEST(CpuCacheTest, ReclaimInaccessibleCaches) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  cache.Activate();
+
+  const size_t kSizeClass = 2;
+
+  // Perform some operations to warm up caches and make sure they are
+  // populated.
+  const int num_cpus = NumCPUs();
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    ColdCacheOperations(cache, cpu, kSizeClass);
+    EXPECT_TRUE(cache.HasPopulated(cpu));
+    EXPECT_GT(cache.UsedBytes(cpu), 0);
+  }
+
+  // With every cpu in the allowed mask, nothing should be reclaimed, busy or
+  // not.
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    CPU_SET(cpu, &allowed);
+  }
+  cache.ReclaimInaccessibleCaches(allowed);
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    EXPECT_GT(cache.UsedBytes(cpu), 0);
+    EXPECT_EQ(cache.GetNumReclaims(cpu), 0);
+  }
+
+  // Drop one cpu from the mask. Only its cache should be drained, without
+  // waiting for it to look idle.
+  absl::BitGen rnd;
+  const int lost_cpu = absl::Uniform<int32_t>(rnd, 0, num_cpus);
+  CPU_CLR(lost_cpu, &allowed);
+  cache.ReclaimInaccessibleCaches(allowed);
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    SCOPED_TRACE(absl::StrFormat("Failed CPU: %d", cpu));
+    if (cpu == lost_cpu) {
+      EXPECT_EQ(cache.UsedBytes(cpu), 0);
+      EXPECT_EQ(cache.GetNumReclaims(cpu), 1);
+    } else {
+      EXPECT_GT(cache.UsedBytes(cpu), 0);
+      EXPECT_EQ(cache.GetNumReclaims(cpu), 0);
+    }
+  }
+
+  // A cache that is already empty should not be reclaimed again.
+  cache.ReclaimInaccessibleCaches(allowed);
+  EXPECT_EQ(cache.GetNumReclaims(lost_cpu), 1);
+
+  cache.Deactivate();
+}
+
+TEST(CpuCacheTest, DecayIdleCpuCaches) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  CpuCache cache;
+  cache.Activate();
+
+  constexpr size_t kSizeClass = 2;
+  const int num_cpus = NumCPUs();
+  if (num_cpus < 2) {
+    return;
+  }
+  absl::BitGen rnd;
+  const int busy_cpu = absl::Uniform<int32_t>(rnd, 0, num_cpus);
+  const int quiet_cpu = (busy_cpu + 1) % num_cpus;
+
+  // Perform some operations to warm up caches and make sure they are
+  // populated.
+  ColdCacheOperations(cache, busy_cpu, kSizeClass);
+  ColdCacheOperations(cache, quiet_cpu, kSizeClass);
+  ASSERT_TRUE(cache.HasPopulated(busy_cpu));
+  ASSERT_TRUE(cache.HasPopulated(quiet_cpu));
+
+  // Consume the misses accumulated while warming up the caches so that the
+  // next decay interval starts clean.
+  for (int cpu = 0; cpu < num_cpus; ++cpu) {
+    cache.GetAndUpdateIntervalCacheMissStats(cpu, MissCount::kDecay);
+  }
+
+  // Keep the busy cache above the miss floor while the quiet cache sees no
+  // traffic this interval.
+  ColdCacheOperations(cache, busy_cpu, kSizeClass);
+
+  const uint64_t busy_capacity = cache.Capacity(busy_cpu);
+  const uint64_t quiet_capacity = cache.Capacity(quiet_cpu);
+
+  cache.DecayIdleCpuCaches(/*miss_floor=*/1);
+
+  // The quiet cache stepped its capacity down; the busy cache kept its
+  // capacity.
+  EXPECT_LT(cache.Capacity(quiet_cpu), quiet_capacity);
+  EXPECT_EQ(cache.Capacity(busy_cpu), busy_capacity);
+
+  // Repeated decay intervals must not take a cache below the lower capacity
+  // bound that also protects caches from shuffle-time stealing.  We keep some
+  // tolerance, up to the size class size, for the object-granular shrink.
+  for (int i = 0; i < 100; ++i) {
+    cache.DecayIdleCpuCaches(/*miss_floor=*/1);
+  }
+  EXPECT_GE(cache.Capacity(quiet_cpu),
+            CpuCache::kCacheCapacityThreshold * cache.CacheLimit() -
+                cache.forwarder().class_to_size(kSizeClass));
+
+  cache.Deactivate();
+}
+
 TEST(CpuCacheTest, SizeClassCapacityTest) {
   if (!subtle::percpu::IsFast()) {
     return;
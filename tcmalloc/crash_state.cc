@@ -0,0 +1,77 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/crash_state.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tcmalloc/global_stats.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/system-alloc.h"
+
+ABSL_CONST_INIT tcmalloc::tcmalloc_internal::CrashState tcmalloc_crash_state;
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+void UpdateCrashState() {
+  CrashState& page = tcmalloc_crash_state;
+
+  // Bracket the refresh with sequence increments, with compiler fences so
+  // the field stores cannot be hoisted outside the brackets.  The only
+  // concurrent "reader" is a point-in-time core dump, so no hardware
+  // ordering is needed: an odd sequence in the dump flags a torn snapshot.
+  page.sequence++;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+
+  TCMallocStats stats;
+  ExtractTCMallocStats(&stats, /*report_residence=*/false);
+
+  page.in_use_by_app_bytes = InUseByApp(stats);
+  page.physical_memory_used_bytes = PhysicalMemoryUsed(stats);
+  page.virtual_memory_used_bytes = VirtualMemoryUsed(stats);
+  page.heap_size_bytes = HeapSizeBytes(stats.pageheap);
+  page.pageheap_free_bytes = stats.pageheap.free_bytes;
+  page.pageheap_unmapped_bytes = stats.pageheap.unmapped_bytes;
+  page.central_bytes = stats.central_bytes;
+  page.transfer_bytes = stats.transfer_bytes;
+  page.sharded_transfer_bytes = stats.sharded_transfer_bytes;
+  page.per_cpu_bytes = stats.per_cpu_bytes;
+  page.thread_cache_bytes = stats.thread_bytes;
+  page.metadata_bytes = stats.metadata_bytes;
+  page.peak_backed_bytes = stats.peak_stats.backed_bytes;
+  page.peak_sampled_application_bytes =
+      stats.peak_stats.sampled_application_bytes;
+
+  uint64_t total_events;
+  page.num_growth_entries = SystemGrowthLedgerSnapshot(
+      page.growth, CrashState::kGrowthEntries, &total_events);
+  page.total_growth_events = total_events;
+
+  page.updated_unix_ns = absl::ToUnixNanos(absl::Now());
+  page.magic = CrashState::kMagic;
+  page.version = CrashState::kVersion;
+
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  page.sequence++;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,91 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Crash-dump-ready allocator state.  A process killed by the kernel OOM
+// killer never gets to run stats code, so the background thread continuously
+// refreshes a statically allocated snapshot of the key TCMallocStats
+// aggregates and the tail of the mapping-growth ledger.  The snapshot lives
+// at the unmangled symbol `tcmalloc_crash_state`, so a crash handler -- or
+// `gdb` against a core dump -- locates it by name without executing any
+// allocator code.  Static storage means refreshing it never allocates.
+
+#ifndef TCMALLOC_CRASH_STATE_H_
+#define TCMALLOC_CRASH_STATE_H_
+
+#include <cstdint>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/system-alloc.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Plain-old-data snapshot, readable straight out of a core dump.  Every
+// field is fixed-size; nothing points outside the struct except the raw
+// program counters in the growth entries' stacks.
+struct CrashState {
+  // "TCMCRASH" in memory order on little-endian targets, so the struct is
+  // also findable by scanning a dump for the string.
+  static constexpr uint64_t kMagic = 0x48534152434d4354;
+  // Bump when the layout changes, so dump tooling can dispatch on it.
+  static constexpr uint64_t kVersion = 1;
+  static constexpr int kGrowthEntries = 8;
+
+  uint64_t magic;
+  uint64_t version;
+  // Incremented before and after every refresh: an odd value in a dump means
+  // the kill landed mid-refresh and the fields below may be torn.
+  uint64_t sequence;
+  // Unix nanoseconds of the last completed refresh.
+  int64_t updated_unix_ns;
+
+  // Aggregates derived from TCMallocStats; see global_stats.h for the
+  // corresponding accessors.
+  uint64_t in_use_by_app_bytes;
+  uint64_t physical_memory_used_bytes;
+  uint64_t virtual_memory_used_bytes;
+  uint64_t heap_size_bytes;
+  uint64_t pageheap_free_bytes;
+  uint64_t pageheap_unmapped_bytes;
+  uint64_t central_bytes;
+  uint64_t transfer_bytes;
+  uint64_t sharded_transfer_bytes;
+  uint64_t per_cpu_bytes;
+  uint64_t thread_cache_bytes;
+  uint64_t metadata_bytes;
+  uint64_t peak_backed_bytes;
+  uint64_t peak_sampled_application_bytes;
+
+  // Tail of the mapping-growth ledger (see system-alloc.h), oldest first;
+  // only the first num_growth_entries are valid.
+  uint64_t total_growth_events;
+  int32_t num_growth_entries;
+  GrowthLedgerEntry growth[kGrowthEntries];
+};
+
+// Refreshes tcmalloc_crash_state from live allocator state.  Called from the
+// background thread every tick; takes pageheap_lock briefly and does not
+// allocate.
+void UpdateCrashState();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+// The snapshot itself.  C linkage keeps the symbol name unmangled for crash
+// handlers and debugger scripts.
+extern "C" tcmalloc::tcmalloc_internal::CrashState tcmalloc_crash_state;
+
+#endif  // TCMALLOC_CRASH_STATE_H_
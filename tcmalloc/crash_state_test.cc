@@ -0,0 +1,62 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/crash_state.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(CrashStateTest, RefreshPopulatesSnapshot) {
+  // Give the allocator some state to report.
+  void* p = ::operator new(1 << 20);
+  sized_delete(p, 1 << 20);
+
+  UpdateCrashState();
+  const CrashState& page = tcmalloc_crash_state;
+
+  EXPECT_EQ(page.magic, CrashState::kMagic);
+  EXPECT_EQ(page.version, CrashState::kVersion);
+  // A completed refresh leaves the sequence even.
+  EXPECT_EQ(page.sequence % 2, 0);
+  EXPECT_GT(page.updated_unix_ns, 0);
+
+  // The process has certainly mapped and used memory by now.
+  EXPECT_GT(page.physical_memory_used_bytes, 0);
+  EXPECT_GT(page.virtual_memory_used_bytes, 0);
+  EXPECT_GT(page.heap_size_bytes, 0);
+  EXPECT_GT(page.metadata_bytes, 0);
+
+  // The heap growth above passed through SystemAlloc, so the ledger tail is
+  // non-empty and bounded by the snapshot capacity.
+  EXPECT_GT(page.total_growth_events, 0);
+  EXPECT_GT(page.num_growth_entries, 0);
+  EXPECT_LE(page.num_growth_entries, CrashState::kGrowthEntries);
+
+  // Each refresh brackets its writes with two sequence increments.
+  const uint64_t seq = page.sequence;
+  const int64_t updated = page.updated_unix_ns;
+  UpdateCrashState();
+  EXPECT_EQ(page.sequence, seq + 2);
+  EXPECT_GE(page.updated_unix_ns, updated);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
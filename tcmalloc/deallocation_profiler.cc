@@ -22,6 +22,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
@@ -80,6 +81,8 @@ class AllocAdaptor final {
 };
 
 const int64_t kMaxStackDepth = 64;
+static_assert(LifetimeBucketRecord::kMaxStackDepth == kMaxStackDepth,
+              "Streamed records must hold a full allocation stack.");
 
 // Stores stack traces and metadata for any allocation or deallocation
 // encountered by the profiler.
@@ -444,19 +447,108 @@ class DeallocationProfiler {
   // Table to store lifetime information collected by this profiler
   std::unique_ptr<DeallocationStackTraceTable> reports_ = nullptr;
 
+  // Streaming mode state; see StreamingDeallocationSample.  Completed
+  // lifetimes are aggregated into a direct-mapped table of kStreamSlots
+  // buckets keyed by allocation stack and bucketed lifetime.  A colliding
+  // bucket flushes its previous occupant through flush_, so memory use stays
+  // constant for arbitrarily long runs.  (allocs_ above is bounded by the
+  // number of live sampled allocations in both modes.)
+  struct StreamSlot {
+    LifetimeBucketRecord record;
+    double weight = 0.0;
+    size_t hash = 0;
+    bool occupied = false;
+  };
+  static constexpr size_t kStreamSlots = 256;
+  // Flush all occupied buckets after this many completed lifetimes so that
+  // buckets for rare stacks still reach the callback in a timely manner.
+  static constexpr size_t kCompletionsPerFlush = 1024;
+
+  LifetimeFlushFn flush_ = nullptr;
+  void* flush_arg_ = nullptr;
+  StreamSlot* stream_slots_ = nullptr;
+  size_t completions_since_flush_ = 0;
+
+  void StreamCompletedLifetime(const DeallocationSampleRecord& alloc,
+                               absl::Duration life_time) {
+    const absl::Duration bucket = internal::LifetimeNsToBucketedDuration(
+        absl::ToDoubleNanoseconds(life_time));
+    const size_t hash = absl::HashOf(
+        absl::Hash<DeallocationSampleRecord>{}(alloc),
+        absl::ToInt64Nanoseconds(bucket));
+    StreamSlot& slot = stream_slots_[hash % kStreamSlots];
+    if (slot.occupied && slot.hash != hash) {
+      FlushStreamSlot(slot);
+    }
+    if (!slot.occupied) {
+      slot.occupied = true;
+      slot.hash = hash;
+      slot.weight = 0.0;
+      LifetimeBucketRecord& r = slot.record;
+      r.depth = alloc.depth;
+      std::copy(alloc.stack, alloc.stack + alloc.depth, r.stack);
+      r.requested_size = alloc.requested_size;
+      r.allocated_size = alloc.allocated_size;
+      r.lifetime = bucket;
+    }
+    slot.weight += alloc.weight;
+    if (++completions_since_flush_ >= kCompletionsPerFlush) {
+      FlushAllStreamSlots();
+    }
+  }
+
+  void FlushStreamSlot(StreamSlot& slot) {
+    LifetimeBucketRecord& r = slot.record;
+    // Scale up by the sampling weight, reporting total bytes that are a
+    // multiple of the object size as in Iterate below.
+    const uintptr_t bytes = std::lround(slot.weight * r.allocated_size);
+    r.count = (bytes + r.allocated_size - 1) / r.allocated_size;
+    r.sum = r.count * r.allocated_size;
+    flush_(flush_arg_, r);
+    slot.occupied = false;
+  }
+
+  void FlushAllStreamSlots() {
+    for (size_t i = 0; i < kStreamSlots; ++i) {
+      if (stream_slots_[i].occupied) {
+        FlushStreamSlot(stream_slots_[i]);
+      }
+    }
+    completions_since_flush_ = 0;
+  }
+
  public:
   explicit DeallocationProfiler(DeallocationProfilerList* list) : list_(list) {
     reports_ = std::make_unique<DeallocationStackTraceTable>();
     list_->Add(this);
   }
 
+  DeallocationProfiler(DeallocationProfilerList* list, LifetimeFlushFn flush,
+                       void* flush_arg)
+      : list_(list), flush_(flush), flush_arg_(flush_arg) {
+    stream_slots_ = static_cast<StreamSlot*>(
+        MyAllocator::Allocate(kStreamSlots * sizeof(StreamSlot)));
+    for (size_t i = 0; i < kStreamSlots; ++i) {
+      new (&stream_slots_[i]) StreamSlot;
+    }
+    list_->Add(this);
+  }
+
   ~DeallocationProfiler() {
-    if (reports_ != nullptr) {
+    if (reports_ != nullptr || stream_slots_ != nullptr) {
       Stop();
     }
   }
 
   const tcmalloc::Profile Stop() {
+    if (stream_slots_ != nullptr) {
+      // As below, leave the list first so no further frees stream in.
+      list_->Remove(this);
+      FlushAllStreamSlots();
+      MyAllocator::Free(stream_slots_, kStreamSlots * sizeof(StreamSlot));
+      stream_slots_ = nullptr;
+      return tcmalloc::Profile();
+    }
     if (reports_ != nullptr) {
       // We first remove the profiler from the list to avoid racing with
       // potential allocations which may modify the allocs_ table.
@@ -505,6 +597,13 @@ class DeallocationProfiler {
     DeallocationSampleRecord sample = it->second;
     allocs_.erase(it);
 
+    if (flush_ != nullptr) {
+      // Streaming mode aggregates by allocation stack only and does not need
+      // the deallocation stack, so skip collecting it.
+      StreamCompletedLifetime(sample, absl::Now() - sample.creation_time);
+      return;
+    }
+
     DeallocationSampleRecord deallocation;
     deallocation.allocated_size = sample.allocated_size;
     deallocation.requested_alignment = sample.requested_alignment;
@@ -714,6 +813,20 @@ void DeallocationProfiler::DeallocationStackTraceTable::Iterate(
   }
 }
 
+StreamingDeallocationSample::StreamingDeallocationSample(
+    DeallocationProfilerList* list, LifetimeFlushFn flush, void* flush_arg) {
+  profiler_ = std::make_unique<DeallocationProfiler>(list, flush, flush_arg);
+}
+
+StreamingDeallocationSample::~StreamingDeallocationSample() { Stop(); }
+
+void StreamingDeallocationSample::Stop() {
+  if (profiler_ != nullptr) {
+    profiler_->Stop();
+    profiler_.reset();
+  }
+}
+
 DeallocationSample::DeallocationSample(DeallocationProfilerList* list) {
   profiler_ = std::make_unique<DeallocationProfiler>(list);
 }
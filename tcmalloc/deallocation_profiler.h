@@ -15,6 +15,8 @@
 #ifndef TCMALLOC_DEALLOCATION_PROFILER_H_
 #define TCMALLOC_DEALLOCATION_PROFILER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "absl/base/const_init.h"
@@ -45,6 +47,49 @@ class DeallocationProfilerList {
       absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY};
 };
 
+// Aggregated lifetimes for one allocation stack and one bucketed lifetime, as
+// produced by streaming lifetime profiling.  Lifetime buckets follow
+// internal::LifetimeNsToBucketedDuration.
+struct LifetimeBucketRecord {
+  static constexpr int kMaxStackDepth = 64;
+
+  int depth = 0;
+  void* stack[kMaxStackDepth];
+  size_t requested_size = 0;
+  size_t allocated_size = 0;
+  absl::Duration lifetime;
+
+  // Allocation count and bytes scaled up by the sampling weight, with the
+  // same rounding as ProfileType::kLifetimes profiles.
+  int64_t count = 0;
+  int64_t sum = 0;
+};
+
+// Receives aggregated records from streaming lifetime profiling.  Called on
+// the deallocating thread while profiler-internal locks are held: the
+// callback must be fast and must not allocate or deallocate memory.
+using LifetimeFlushFn = void (*)(void* arg, const LifetimeBucketRecord& record);
+
+// Streams lifetime data through a callback with constant memory overhead,
+// unlike DeallocationSample, which accumulates every distinct stack pair
+// until Stop.  Completed lifetimes are aggregated into a fixed number of
+// per-stack lifetime buckets and flushed when a bucket is evicted,
+// periodically, and at Stop.  Allocations still live at Stop are dropped
+// rather than reported as censored.
+class StreamingDeallocationSample {
+ public:
+  StreamingDeallocationSample(DeallocationProfilerList* list,
+                              LifetimeFlushFn flush, void* flush_arg);
+  ~StreamingDeallocationSample();
+
+  // Flushes all pending buckets and detaches from the profiler list.  No
+  // further callbacks occur after Stop returns.
+  void Stop();
+
+ private:
+  std::unique_ptr<DeallocationProfiler> profiler_;
+};
+
 class DeallocationSample final
     : public tcmalloc_internal::AllocationProfilingTokenBase {
  public:
@@ -0,0 +1,100 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/deferred_free_queue.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Only frees above the (large) threshold land here and the background thread
+// drains every wakeup, so a short fixed ring suffices; overflow falls back
+// to the synchronous path rather than blocking the freeing thread.
+constexpr int kDeferredFreeQueueLength = 32;
+
+struct DeferredFree {
+  Span* span;
+  MemoryTag tag;
+};
+
+ABSL_CONST_INIT absl::base_internal::SpinLock queue_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+ABSL_CONST_INIT DeferredFree queue[kDeferredFreeQueueLength]
+    ABSL_GUARDED_BY(queue_lock) = {};
+ABSL_CONST_INIT int queue_head ABSL_GUARDED_BY(queue_lock) = 0;
+ABSL_CONST_INIT int queue_count ABSL_GUARDED_BY(queue_lock) = 0;
+
+// Tracked outside queue_lock so GetStats can read it without taking a lock
+// on the free path.
+ABSL_CONST_INIT std::atomic<size_t> in_flight_bytes{0};
+
+}  // namespace
+
+bool DeferLargeFree(Span* span, MemoryTag tag) {
+  const size_t bytes = span->bytes_in_span();
+  {
+    AllocationGuardSpinLockHolder l(&queue_lock);
+    if (queue_count == kDeferredFreeQueueLength) {
+      return false;
+    }
+    queue[(queue_head + queue_count) % kDeferredFreeQueueLength] = {span, tag};
+    ++queue_count;
+  }
+  in_flight_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return true;
+}
+
+void DrainDeferredFrees() {
+  for (;;) {
+    DeferredFree f;
+    {
+      AllocationGuardSpinLockHolder l(&queue_lock);
+      if (queue_count == 0) {
+        return;
+      }
+      f = queue[queue_head];
+      queue_head = (queue_head + 1) % kDeferredFreeQueueLength;
+      --queue_count;
+    }
+    const size_t bytes = f.span->bytes_in_span();
+    {
+      PageHeapSpinLockHolder l;
+      tc_globals.page_allocator().Delete(f.span, /*objects_per_span=*/1,
+                                         f.tag);
+    }
+    in_flight_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+}
+
+size_t DeferredFreeInFlightBytes() {
+  return in_flight_bytes.load(std::memory_order_relaxed);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
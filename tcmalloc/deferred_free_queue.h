@@ -0,0 +1,60 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Deferred destruction for very large frees.  Returning a multi-hundred-MB
+// span performs pagemap updates, filler merges, and potentially release work
+// synchronously under pageheap_lock, which shows up as tail latency on the
+// freeing thread.  When Parameters::deferred_free_threshold() is nonzero,
+// frees of spans at least that large hand the span to a small bounded queue
+// drained by the background thread, and the freeing thread pays only the
+// enqueue.  If the queue is full the caller frees synchronously, so a
+// wedged or absent background thread degrades to today's behavior instead
+// of stranding memory without bound.
+//
+// Until the drain runs, a deferred span still counts as allocated in the
+// page allocator's stats; DeferredFreeInFlightBytes() reports how much is
+// waiting so stats readers can account for the difference.
+
+#ifndef TCMALLOC_DEFERRED_FREE_QUEUE_H_
+#define TCMALLOC_DEFERRED_FREE_QUEUE_H_
+
+#include <cstddef>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/span.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Attempts to enqueue span (whose memory carries tag) for destruction on the
+// background thread.  Returns false if the queue is full, in which case the
+// caller must free the span synchronously.  The caller must already have
+// performed all per-free bookkeeping (hooks, unsampling); only the return of
+// the span to the page allocator is deferred.
+bool DeferLargeFree(Span* span, MemoryTag tag);
+
+// Returns every queued span to the page allocator.  Called periodically from
+// the background thread; tests may call it directly.
+void DrainDeferredFrees();
+
+// Bytes handed to DeferLargeFree but not yet returned to the page allocator.
+size_t DeferredFreeInFlightBytes();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_DEFERRED_FREE_QUEUE_H_
@@ -0,0 +1,95 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/deferred_free_queue.h"
+
+#include <stddef.h>
+
+#include <new>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/parameters.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Sets the handoff threshold for the duration of a test.  The tests drain
+// the queue themselves; no background thread runs here.
+class ScopedDeferredFreeThreshold {
+ public:
+  explicit ScopedDeferredFreeThreshold(int64_t threshold)
+      : previous_(Parameters::deferred_free_threshold()) {
+    Parameters::set_deferred_free_threshold(threshold);
+  }
+  ~ScopedDeferredFreeThreshold() {
+    DrainDeferredFrees();
+    Parameters::set_deferred_free_threshold(previous_);
+  }
+
+ private:
+  int64_t previous_;
+};
+
+TEST(DeferredFreeQueueTest, LargeFreeIsDeferredAndDrained) {
+  constexpr size_t kThreshold = 4 << 20;
+  constexpr size_t kSize = 32 << 20;
+  ScopedDeferredFreeThreshold t(kThreshold);
+
+  void* ptr = ::operator new(kSize);
+  ASSERT_NE(ptr, nullptr);
+  const size_t before = DeferredFreeInFlightBytes();
+  ::operator delete(ptr);
+  EXPECT_GE(DeferredFreeInFlightBytes(), before + kSize);
+
+  DrainDeferredFrees();
+  EXPECT_EQ(DeferredFreeInFlightBytes(), 0);
+}
+
+TEST(DeferredFreeQueueTest, SmallFreeStaysSynchronous) {
+  ScopedDeferredFreeThreshold t(4 << 20);
+
+  // Large enough to bypass the size classes, but below the threshold.
+  void* ptr = ::operator new(1 << 20);
+  ASSERT_NE(ptr, nullptr);
+  ::operator delete(ptr);
+  EXPECT_EQ(DeferredFreeInFlightBytes(), 0);
+}
+
+TEST(DeferredFreeQueueTest, OverflowFallsBackToSynchronousFree) {
+  constexpr size_t kThreshold = 4 << 20;
+  constexpr size_t kSize = 4 << 20;
+  // More frees than the queue can hold; the surplus must be freed inline
+  // rather than rejected or blocked on.
+  constexpr int kAllocations = 64;
+  ScopedDeferredFreeThreshold t(kThreshold);
+
+  void* ptrs[kAllocations];
+  for (int i = 0; i < kAllocations; ++i) {
+    ptrs[i] = ::operator new(kSize);
+    ASSERT_NE(ptrs[i], nullptr);
+  }
+  for (int i = 0; i < kAllocations; ++i) {
+    ::operator delete(ptrs[i]);
+  }
+  // Whatever was queued is bounded by the ring; the rest went synchronously.
+  EXPECT_LE(DeferredFreeInFlightBytes(), kAllocations * kSize);
+
+  DrainDeferredFrees();
+  EXPECT_EQ(DeferredFreeInFlightBytes(), 0);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
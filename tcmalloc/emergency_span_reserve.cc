@@ -0,0 +1,188 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/emergency_span_reserve.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// One bucket per span length the size classes use; lengths above the cap are
+// rare enough (and their refills long enough anyway) that bounding them is
+// not worth the reserve footprint.  At two spans per bucket the reserve tops
+// out at 2 * (1 + 2 + ... + 8) pages, well under a MiB at 8 KiB pages.
+constexpr size_t kReserveBuckets = 8;
+constexpr int kReserveDepth = 2;
+
+// Touched only after a full budget's worth of failed probes on
+// pageheap_lock (or by the background thread), so this lock is effectively
+// uncontended.
+ABSL_CONST_INIT absl::base_internal::SpinLock reserve_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+ABSL_CONST_INIT Span* reserve[kReserveBuckets][kReserveDepth]
+    ABSL_GUARDED_BY(reserve_lock) = {};
+ABSL_CONST_INIT int reserve_count[kReserveBuckets]
+    ABSL_GUARDED_BY(reserve_lock) = {};
+
+ABSL_CONST_INIT std::atomic<size_t> spans_served{0};
+ABSL_CONST_INIT std::atomic<size_t> reserve_misses{0};
+
+// Stocked spans carry a neutral allocation hint; an emergency span may be
+// handed to any size class, and a suboptimal placement beats an unbounded
+// lock wait.
+constexpr SpanAllocInfo kReserveAllocInfo = {
+    .objects_per_span = 1, .density = AccessDensityPrediction::kSparse};
+
+Span* TakeReservedSpan(Length pages) {
+  if (pages.raw_num() == 0 || pages.raw_num() > kReserveBuckets) {
+    return nullptr;
+  }
+  const size_t b = pages.raw_num() - 1;
+  AllocationGuardSpinLockHolder l(&reserve_lock);
+  if (reserve_count[b] == 0) {
+    return nullptr;
+  }
+  return reserve[b][--reserve_count[b]];
+}
+
+}  // namespace
+
+Span* AllocateSpanBoundedWait(Length pages, SpanAllocInfo span_alloc_info,
+                              absl::Duration budget) {
+  // Probe rather than queue: a successful TryLock means the lock is free
+  // right now, so the synchronous path ahead will not sit behind a long
+  // holder.  (Another thread may slip in between the probe and New's own
+  // acquisition, but it costs at most another short wait, not the
+  // pathological one the budget guards against.)
+  const absl::Time deadline = absl::Now() + budget;
+  do {
+    if (pageheap_lock.TryLock()) {
+      pageheap_lock.Unlock();
+      return tc_globals.page_allocator().New(pages, span_alloc_info,
+                                             MemoryTag::kNormal);
+    }
+  } while (absl::Now() < deadline);
+
+  Span* span = TakeReservedSpan(pages);
+  if (span != nullptr) {
+    spans_served.fetch_add(1, std::memory_order_relaxed);
+    return span;
+  }
+  // Budget expired but the reserve cannot cover this size; wait after all.
+  reserve_misses.fetch_add(1, std::memory_order_relaxed);
+  return tc_globals.page_allocator().New(pages, span_alloc_info,
+                                         MemoryTag::kNormal);
+}
+
+void RefillEmergencySpanReserve() {
+  if (Parameters::pageheap_lock_wait_budget() == absl::ZeroDuration()) {
+    // Policy is off; hand any stocked spans back to the page allocator so a
+    // disabled reserve costs nothing.
+    for (;;) {
+      Span* span = nullptr;
+      {
+        AllocationGuardSpinLockHolder l(&reserve_lock);
+        for (size_t b = 0; b < kReserveBuckets; ++b) {
+          if (reserve_count[b] > 0) {
+            span = reserve[b][--reserve_count[b]];
+            break;
+          }
+        }
+      }
+      if (span == nullptr) {
+        return;
+      }
+      PageHeapSpinLockHolder l;
+      tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1,
+                                         MemoryTag::kNormal);
+    }
+  }
+
+  // Stock only the span lengths some size class actually requests, so the
+  // reserve holds nothing that cannot be served.
+  bool used[kReserveBuckets] = {};
+  for (size_t size_class = 1; size_class < kNumClasses; ++size_class) {
+    if (IsExpandedSizeClass(size_class)) {
+      continue;
+    }
+    const size_t pages = tc_globals.sizemap().class_to_pages(size_class);
+    if (pages >= 1 && pages <= kReserveBuckets) {
+      used[pages - 1] = true;
+    }
+  }
+
+  for (size_t b = 0; b < kReserveBuckets; ++b) {
+    if (!used[b]) {
+      continue;
+    }
+    for (;;) {
+      {
+        AllocationGuardSpinLockHolder l(&reserve_lock);
+        if (reserve_count[b] == kReserveDepth) {
+          break;
+        }
+      }
+      Span* span = tc_globals.page_allocator().New(
+          Length(b + 1), kReserveAllocInfo, MemoryTag::kNormal);
+      if (span == nullptr) {
+        // Under memory pressure restocking loses to the application; try
+        // again next tick.
+        return;
+      }
+      AllocationGuardSpinLockHolder l(&reserve_lock);
+      TC_ASSERT_LT(reserve_count[b], kReserveDepth);
+      reserve[b][reserve_count[b]++] = span;
+    }
+  }
+}
+
+size_t EmergencySpansServed() {
+  return spans_served.load(std::memory_order_relaxed);
+}
+
+size_t EmergencySpanReserveMisses() {
+  return reserve_misses.load(std::memory_order_relaxed);
+}
+
+size_t EmergencySpanReserveSpans() {
+  AllocationGuardSpinLockHolder l(&reserve_lock);
+  size_t total = 0;
+  for (size_t b = 0; b < kReserveBuckets; ++b) {
+    total += reserve_count[b];
+  }
+  return total;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
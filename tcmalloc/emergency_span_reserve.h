@@ -0,0 +1,69 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Bounded-wait span allocation for latency-sensitive workloads.  A central
+// freelist refill normally queues on pageheap_lock for however long the
+// current holder -- possibly a multi-ms release or filler rebalance -- takes.
+// When Parameters::pageheap_lock_wait_budget() is nonzero, the refill instead
+// probes the lock for at most that budget and then serves the span from a
+// small reserve of pre-allocated spans the background thread keeps stocked,
+// trading a bounded (few hundred KiB) reserve footprint for a hard ceiling
+// on the refill's lock wait.  Spans served from the reserve are ordinary
+// spans and are returned through the usual deallocation path; only their
+// acquisition bypasses the contended lock.
+
+#ifndef TCMALLOC_EMERGENCY_SPAN_RESERVE_H_
+#define TCMALLOC_EMERGENCY_SPAN_RESERVE_H_
+
+#include <cstddef>
+
+#include "absl/time/time.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/span.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Allocates a normal-tagged span of <pages> pages, waiting at most <budget>
+// for pageheap_lock to come free before falling back to the reserve.  If the
+// reserve has no span of the right size the allocation proceeds on the
+// unbounded synchronous path (and is counted as a miss), so this never fails
+// in situations where PageAllocator::New would have succeeded.
+Span* AllocateSpanBoundedWait(Length pages, SpanAllocInfo span_alloc_info,
+                              absl::Duration budget);
+
+// Restocks the reserve up to its per-size depth, or drains it back to the
+// page allocator when the bounded-wait policy is off.  Called periodically
+// from the background thread; tests may call it directly.
+void RefillEmergencySpanReserve();
+
+// Number of spans served from the reserve because the lock-wait budget
+// expired.
+size_t EmergencySpansServed();
+
+// Number of budget expirations the reserve could not cover (wrong size or
+// already empty); these allocations waited on the lock after all.
+size_t EmergencySpanReserveMisses();
+
+// Number of spans currently stocked in the reserve.
+size_t EmergencySpanReserveSpans();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_EMERGENCY_SPAN_RESERVE_H_
@@ -0,0 +1,121 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/emergency_span_reserve.h"
+
+#include <cstddef>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/static_vars.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Sets the lock-wait budget for the duration of a test and drains the
+// reserve on the way out; no background thread runs here.
+class ScopedLockWaitBudget {
+ public:
+  explicit ScopedLockWaitBudget(absl::Duration budget)
+      : previous_(Parameters::pageheap_lock_wait_budget()) {
+    Parameters::set_pageheap_lock_wait_budget(budget);
+  }
+  ~ScopedLockWaitBudget() {
+    Parameters::set_pageheap_lock_wait_budget(previous_);
+    if (previous_ == absl::ZeroDuration()) {
+      RefillEmergencySpanReserve();
+    }
+  }
+
+ private:
+  absl::Duration previous_;
+};
+
+TEST(EmergencySpanReserveTest, RefillStocksAndDisableDrains) {
+  {
+    ScopedLockWaitBudget budget(absl::Milliseconds(1));
+    RefillEmergencySpanReserve();
+    EXPECT_GT(EmergencySpanReserveSpans(), 0);
+  }
+  // The scoped budget reset to zero and drained; a disabled reserve holds
+  // nothing.
+  EXPECT_EQ(EmergencySpanReserveSpans(), 0);
+}
+
+TEST(EmergencySpanReserveTest, UncontendedAllocationSkipsReserve) {
+  ScopedLockWaitBudget budget(absl::Milliseconds(1));
+  RefillEmergencySpanReserve();
+  const size_t stocked = EmergencySpanReserveSpans();
+  const size_t served_before = EmergencySpansServed();
+
+  constexpr SpanAllocInfo kInfo = {.objects_per_span = 1,
+                                   .density = AccessDensityPrediction::kSparse};
+  Span* span =
+      AllocateSpanBoundedWait(Length(1), kInfo, absl::Milliseconds(1));
+  ASSERT_NE(span, nullptr);
+  // Nobody held pageheap_lock, so the span came from the synchronous path.
+  EXPECT_EQ(EmergencySpansServed(), served_before);
+  EXPECT_EQ(EmergencySpanReserveSpans(), stocked);
+
+  PageHeapSpinLockHolder l;
+  tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1,
+                                     MemoryTag::kNormal);
+}
+
+TEST(EmergencySpanReserveTest, ContendedAllocationServedFromReserve) {
+  ScopedLockWaitBudget budget(absl::Milliseconds(1));
+  RefillEmergencySpanReserve();
+  ASSERT_GT(EmergencySpanReserveSpans(), 0);
+  const size_t served_before = EmergencySpansServed();
+
+  absl::Notification locked;
+  absl::Notification release;
+  std::thread holder([&] {
+    pageheap_lock.Lock();
+    locked.Notify();
+    release.WaitForNotification();
+    pageheap_lock.Unlock();
+  });
+  locked.WaitForNotification();
+
+  // With the lock held past the budget, the span must come from the reserve
+  // without waiting for the holder.
+  constexpr SpanAllocInfo kInfo = {.objects_per_span = 1,
+                                   .density = AccessDensityPrediction::kSparse};
+  Span* span =
+      AllocateSpanBoundedWait(Length(1), kInfo, absl::Milliseconds(1));
+
+  // Release the lock before any assertion; a failure message would allocate,
+  // and allocation may need pageheap_lock.
+  release.Notify();
+  holder.join();
+
+  ASSERT_NE(span, nullptr);
+  EXPECT_EQ(EmergencySpansServed(), served_before + 1);
+
+  PageHeapSpinLockHolder l;
+  tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1,
+                                     MemoryTag::kNormal);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -0,0 +1,172 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/eviction_planner.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/global_stats.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/large_span_cache.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+size_t PageheapFreeBytes() {
+  constexpr char kProperty[] = "tcmalloc.pageheap_free_bytes";
+  size_t value = 0;
+  if (!GetNumericProperty(kProperty, strlen(kProperty), &value)) {
+    return 0;
+  }
+  return value;
+}
+
+// --- free pages: the pageheap free lists, and through the release sweep
+// the huge cache's backed-but-free hugepages.  Entirely cold by definition
+// (the application freed every byte); refaulting one costs a minor fault.
+EvictionOffer FreePagesOffer() {
+  return {.tier = "free_pages",
+          .bytes = PageheapFreeBytes(),
+          .coldness = 1.0,
+          .release_cost = 1.0,
+          .refault_cost = 1.0};
+}
+
+size_t FreePagesRelease(size_t bytes) {
+  const size_t before = PageheapFreeBytes();
+  MallocExtension::ReleaseMemoryToSystem(bytes);
+  const size_t after = PageheapFreeBytes();
+  return before > after ? before - after : 0;
+}
+
+// --- large span cache: parked buffers that were recycling recently, so a
+// refault is a likely pageheap round trip; draining is cheap (no madvise of
+// its own -- the spans land on the free lists and leave via free_pages).
+EvictionOffer LargeSpanCacheOffer() {
+  return {.tier = "large_span_cache",
+          .bytes = LargeSpanCacheBytes(),
+          .coldness = 0.5,
+          .release_cost = 0.2,
+          .refault_cost = 2.0};
+}
+
+size_t LargeSpanCacheRelease(size_t bytes) {
+  // The plunder sweep is all-or-nothing per slot; two sweeps empty the
+  // cache.  Fine-grained trimming is not worth plumbing for a cache this
+  // small.
+  (void)bytes;
+  const size_t before = LargeSpanCacheBytes();
+  PlunderLargeSpanCache();
+  PlunderLargeSpanCache();
+  return before;
+}
+
+// --- cpu caches: warm by design; only caches that pass the idle check are
+// reclaimed, but a refault still means a string of slab misses, so this
+// tier drains last.
+EvictionOffer CpuCachesOffer() {
+  const size_t bytes =
+      UsePerCpuCache(tc_globals) ? tc_globals.cpu_cache().TotalUsedBytes() : 0;
+  return {.tier = "cpu_caches",
+          .bytes = bytes,
+          .coldness = 0.25,
+          .release_cost = 0.5,
+          .refault_cost = 4.0};
+}
+
+size_t CpuCachesRelease(size_t bytes) {
+  (void)bytes;
+  if (!UsePerCpuCache(tc_globals)) {
+    return 0;
+  }
+  const size_t before = tc_globals.cpu_cache().TotalUsedBytes();
+  tc_globals.cpu_cache().TryReclaimingCaches();
+  const size_t after = tc_globals.cpu_cache().TotalUsedBytes();
+  return before > after ? before - after : 0;
+}
+
+struct Tier {
+  EvictionOffer (*offer)();
+  size_t (*release)(size_t bytes);
+  // Whether release() returns memory to the OS itself, rather than moving
+  // it to the pageheap free lists.
+  bool releases_to_os;
+};
+
+constexpr Tier kTiers[kEvictionTierCount] = {
+    {FreePagesOffer, FreePagesRelease, /*releases_to_os=*/true},
+    {LargeSpanCacheOffer, LargeSpanCacheRelease, /*releases_to_os=*/false},
+    {CpuCachesOffer, CpuCachesRelease, /*releases_to_os=*/false},
+};
+
+}  // namespace
+
+void CollectEvictionOffers(EvictionOffer (&offers)[kEvictionTierCount]) {
+  for (int i = 0; i < kEvictionTierCount; ++i) {
+    offers[i] = kTiers[i].offer();
+  }
+}
+
+double EvictionScore(const EvictionOffer& offer) {
+  // Expected per-byte cost of draining the tier: the refault cost applies
+  // only to the warm fraction, the release cost to every byte.
+  return offer.refault_cost * (1.0 - offer.coldness) + offer.release_cost;
+}
+
+size_t ReleaseAtMinimumRefaultCost(size_t target_bytes) {
+  if (target_bytes == 0) {
+    return 0;
+  }
+  EvictionOffer offers[kEvictionTierCount];
+  CollectEvictionOffers(offers);
+
+  int order[kEvictionTierCount];
+  for (int i = 0; i < kEvictionTierCount; ++i) {
+    order[i] = i;
+  }
+  std::sort(order, order + kEvictionTierCount, [&](int a, int b) {
+    return EvictionScore(offers[a]) < EvictionScore(offers[b]);
+  });
+
+  size_t released = 0;
+  size_t moved_to_freelists = 0;
+  for (int i = 0; i < kEvictionTierCount && released < target_bytes; ++i) {
+    const Tier& tier = kTiers[order[i]];
+    if (offers[order[i]].bytes == 0) {
+      continue;
+    }
+    const size_t freed = tier.release(target_bytes - released);
+    released += freed;
+    if (!tier.releases_to_os) {
+      moved_to_freelists += freed;
+    }
+  }
+  // Bytes drained from the inner tiers landed on the pageheap free lists;
+  // push them the rest of the way to the OS.
+  if (moved_to_freelists > 0) {
+    MallocExtension::ReleaseMemoryToSystem(moved_to_freelists);
+  }
+  return released;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,71 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A common eviction-priority vocabulary across the memory tiers.  Each
+// release mechanism -- the pageheap free lists (and through them the huge
+// cache), the large span cache, the per-cpu caches -- has its own notion of
+// what is coldest, so a plain release request can end up taking cheap but
+// warm memory from one tier while colder bytes sit untouched in another.
+// Every tier here reports a uniform (bytes, coldness, cost-to-release,
+// cost-to-refault) offer, and the planner satisfies a byte target by
+// draining tiers in order of expected refault cost per byte.  When
+// Parameters::unified_eviction_planner() is on, the background thread routes
+// its periodic release target through the planner instead of calling
+// ReleaseMemoryToSystem directly.
+
+#ifndef TCMALLOC_EVICTION_PLANNER_H_
+#define TCMALLOC_EVICTION_PLANNER_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// A tier's offer to the release planner.  Costs are relative, unitless
+// per-byte figures; only their ordering matters.
+struct EvictionOffer {
+  const char* tier;
+  // Bytes the tier could release right now.
+  size_t bytes;
+  // Fraction of those bytes believed cold (untouched recently), in [0, 1].
+  double coldness;
+  // Cost to release a byte (madvise work, lock traffic).
+  double release_cost;
+  // Cost if a released byte is wanted again soon (refault, cache refill).
+  double refault_cost;
+};
+
+// Number of tiers the planner consults.
+inline constexpr int kEvictionTierCount = 3;
+
+// Fills <offers> with each tier's current offer, in tier-table order.
+void CollectEvictionOffers(EvictionOffer (&offers)[kEvictionTierCount]);
+
+// Expected cost per byte of draining this offer; lower drains first.
+// Exposed to permit testing the ranking.
+double EvictionScore(const EvictionOffer& offer);
+
+// Releases at least <target_bytes> across the tiers, cheapest expected
+// refault cost first, stopping early when the tiers are exhausted.  Returns
+// the bytes the drained tiers reported giving up.
+size_t ReleaseAtMinimumRefaultCost(size_t target_bytes);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_EVICTION_PLANNER_H_
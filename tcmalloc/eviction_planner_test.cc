@@ -0,0 +1,101 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/eviction_planner.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(EvictionPlannerTest, ScoreRanksColdCheapBelowWarmExpensive) {
+  const EvictionOffer cold_cheap = {.tier = "cold",
+                                    .bytes = 1 << 20,
+                                    .coldness = 1.0,
+                                    .release_cost = 1.0,
+                                    .refault_cost = 1.0};
+  const EvictionOffer warm_expensive = {.tier = "warm",
+                                        .bytes = 1 << 20,
+                                        .coldness = 0.25,
+                                        .release_cost = 0.5,
+                                        .refault_cost = 4.0};
+  EXPECT_LT(EvictionScore(cold_cheap), EvictionScore(warm_expensive));
+}
+
+TEST(EvictionPlannerTest, ScoreIgnoresBytes) {
+  EvictionOffer a = {.tier = "a",
+                     .bytes = 0,
+                     .coldness = 0.5,
+                     .release_cost = 0.2,
+                     .refault_cost = 2.0};
+  EvictionOffer b = a;
+  b.bytes = 1 << 30;
+  EXPECT_DOUBLE_EQ(EvictionScore(a), EvictionScore(b));
+}
+
+TEST(EvictionPlannerTest, OffersAreWellFormed) {
+  EvictionOffer offers[kEvictionTierCount];
+  CollectEvictionOffers(offers);
+  for (const EvictionOffer& offer : offers) {
+    SCOPED_TRACE(offer.tier);
+    EXPECT_GT(strlen(offer.tier), 0);
+    EXPECT_GE(offer.coldness, 0.0);
+    EXPECT_LE(offer.coldness, 1.0);
+    EXPECT_GT(offer.release_cost, 0.0);
+    EXPECT_GT(offer.refault_cost, 0.0);
+  }
+  // Tier names are unique.
+  for (int i = 0; i < kEvictionTierCount; ++i) {
+    for (int j = i + 1; j < kEvictionTierCount; ++j) {
+      EXPECT_NE(std::string(offers[i].tier), offers[j].tier);
+    }
+  }
+}
+
+TEST(EvictionPlannerTest, FreePagesRankFirst) {
+  // The planner must prefer bytes the application has already freed over
+  // dismantling warm caches.
+  EvictionOffer offers[kEvictionTierCount];
+  CollectEvictionOffers(offers);
+  double free_pages_score = 0;
+  for (const EvictionOffer& offer : offers) {
+    if (strcmp(offer.tier, "free_pages") == 0) {
+      free_pages_score = EvictionScore(offer);
+    }
+  }
+  for (const EvictionOffer& offer : offers) {
+    if (strcmp(offer.tier, "free_pages") != 0) {
+      EXPECT_LT(free_pages_score, EvictionScore(offer)) << offer.tier;
+    }
+  }
+}
+
+TEST(EvictionPlannerTest, ReleaseIsSafeToCall) {
+  EXPECT_EQ(ReleaseAtMinimumRefaultCost(0), 0);
+  // Create some releasable memory, then ask for a modest target.
+  constexpr size_t kSize = 4 << 20;
+  void* ptr = ::operator new(kSize);
+  memset(ptr, 0xab, kSize);
+  ::operator delete(ptr);
+  ReleaseAtMinimumRefaultCost(1 << 20);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -182,6 +182,21 @@ const bool* SelectExperiments(bool* buffer, absl::string_view test_target,
   return buffer;
 }
 
+ABSL_CONST_INIT static ExperimentImpact experiment_impact[kNumExperiments];
+
+ExperimentImpact& GetExperimentImpact(Experiment exp) {
+  TC_ASSERT_GE(static_cast<int>(exp), 0);
+  TC_ASSERT_LT(exp, Experiment::kMaxExperimentID);
+
+  return experiment_impact[static_cast<int>(exp)];
+}
+
+void RecordExperimentImpact(Experiment exp, size_t allocations, size_t bytes) {
+  ExperimentImpact& impact = GetExperimentImpact(exp);
+  impact.allocations.Add(allocations);
+  impact.bytes.Add(bytes);
+}
+
 }  // namespace tcmalloc_internal
 
 bool IsExperimentActive(Experiment exp) {
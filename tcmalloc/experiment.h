@@ -23,6 +23,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "tcmalloc/experiment_config.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
 #include "tcmalloc/internal/config.h"
 
 // TCMalloc Experiment Controller
@@ -54,6 +55,24 @@ const bool* SelectExperiments(bool* buffer, absl::string_view test_target,
                               absl::string_view active,
                               absl::string_view disabled, bool unset);
 
+// Per-experiment impact counters.  Code serving an allocation through a path
+// an experiment changed records the traffic here, so that a fleet A/B rollout
+// can read the experiment's own impact directly from the process stats
+// instead of joining against external rollout metadata.  Values recorded from
+// sampled allocations are estimates extrapolated from the sampling weight.
+struct ExperimentImpact {
+  // Allocations served by the experimental path.
+  StatsCounter allocations;
+  // Bytes covered by those allocations.
+  StatsCounter bytes;
+};
+
+// Returns the impact counters for exp.
+ExperimentImpact& GetExperimentImpact(Experiment exp);
+
+// Credits exp with allocations served by its changed path covering bytes.
+void RecordExperimentImpact(Experiment exp, size_t allocations, size_t bytes);
+
 }  // namespace tcmalloc_internal
 
 bool IsExperimentActive(Experiment exp);
@@ -14,7 +14,10 @@
 
 #include "tcmalloc/experiment_config.h"
 
+#include <cstdint>
+
 #include "gtest/gtest.h"
+#include "tcmalloc/experiment.h"
 
 namespace tcmalloc {
 namespace {
@@ -27,5 +30,19 @@ TEST(ExperimentConfigTest, ValidateIDs) {
   }
 }
 
+TEST(ExperimentConfigTest, ImpactCountersAccumulate) {
+  using tcmalloc_internal::GetExperimentImpact;
+  using tcmalloc_internal::RecordExperimentImpact;
+
+  constexpr Experiment kExp = Experiment::TEST_ONLY_TCMALLOC_POW2_SIZECLASS;
+  const int64_t allocations = GetExperimentImpact(kExp).allocations.value();
+  const int64_t bytes = GetExperimentImpact(kExp).bytes.value();
+
+  RecordExperimentImpact(kExp, 3, 4096);
+
+  EXPECT_EQ(GetExperimentImpact(kExp).allocations.value(), allocations + 3);
+  EXPECT_EQ(GetExperimentImpact(kExp).bytes.value(), bytes + 4096);
+}
+
 }  // namespace
 }  // namespace tcmalloc
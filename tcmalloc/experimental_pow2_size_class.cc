@@ -50,7 +50,7 @@ namespace tcmalloc_internal {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -80,7 +80,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -110,7 +110,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -140,7 +140,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -169,7 +169,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -199,7 +199,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -229,7 +229,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -259,7 +259,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
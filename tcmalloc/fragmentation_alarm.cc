@@ -0,0 +1,146 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/fragmentation_alarm.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#include "absl/base/attributes.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/sampled_allocation.h"
+#include "tcmalloc/internal/stacktrace_filter.h"
+#include "tcmalloc/sampler.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+ABSL_CONST_INIT std::atomic<FragmentationAlarmCallback> alarm_callback{
+    nullptr};
+
+// True while waste is at or above the threshold.  The alarm fires on the
+// rising edge only and re-arms when waste drops back below; only the
+// background thread reads or writes this.
+bool alarm_raised = false;
+
+// Fixed-size aggregation table keyed by a hash of the allocation stack, in
+// the spirit of StackTraceFilter: direct-mapped with no chaining, so
+// colliding stacks fold their waste into the resident entry.  That is
+// acceptable for attribution and keeps the scan allocation-free.  The table
+// lives here rather than on the stack because the program counter copies
+// make it large; only the background thread touches it.
+struct Bucket {
+  size_t hash = 0;
+  size_t waste_bytes = 0;
+  int depth = 0;
+  void* stack[kMaxStackDepth];
+};
+constexpr size_t kNumBuckets = 256;
+ABSL_CONST_INIT Bucket buckets[kNumBuckets];
+
+}  // namespace
+
+FragmentationAlarmCallback SetFragmentationAlarmCallback(
+    FragmentationAlarmCallback callback) {
+  return alarm_callback.exchange(callback, std::memory_order_acq_rel);
+}
+
+void CheckFragmentationAlarm(Static& state, size_t threshold_bytes) {
+  FragmentationAlarmCallback callback =
+      alarm_callback.load(std::memory_order_acquire);
+  if (callback == nullptr || threshold_bytes == 0) {
+    return;
+  }
+
+  for (Bucket& bucket : buckets) {
+    bucket.hash = 0;
+    bucket.waste_bytes = 0;
+    bucket.depth = 0;
+  }
+
+  size_t total_waste = 0;
+  state.sampled_allocation_recorder().Iterate(
+      [&total_waste](const SampledAllocation& sampled_allocation) {
+        const StackTrace& t = sampled_allocation.sampled_stack;
+        if (t.allocated_size <= t.requested_size) {
+          return;
+        }
+        // Scale this object's overhead by the bytes the sample represents,
+        // mirroring the unsampling done when building profiles.
+        const size_t waste = AllocatedBytes(t) *
+                             (t.allocated_size - t.requested_size) /
+                             t.allocated_size;
+        if (waste == 0) {
+          return;
+        }
+        total_waste += waste;
+
+        const size_t hash = HashOfStackTrace(t);
+        Bucket& bucket = buckets[hash % kNumBuckets];
+        if (bucket.waste_bytes == 0) {
+          bucket.hash = hash;
+          bucket.depth = t.depth;
+          memcpy(bucket.stack, t.stack, sizeof(t.stack[0]) * t.depth);
+        }
+        bucket.waste_bytes += waste;
+      });
+
+  if (total_waste < threshold_bytes) {
+    alarm_raised = false;
+    return;
+  }
+  if (alarm_raised) {
+    return;
+  }
+  alarm_raised = true;
+
+  FragmentationAlarmReport report;
+  report.total_waste_bytes = total_waste;
+  report.threshold_bytes = threshold_bytes;
+  for (const Bucket& bucket : buckets) {
+    if (bucket.waste_bytes == 0) {
+      continue;
+    }
+    // Insertion sort into the top list, which holds at most kTopStacks
+    // entries ordered by decreasing waste.
+    int i = report.num_stacks;
+    while (i > 0 && report.top[i - 1].waste_bytes < bucket.waste_bytes) {
+      --i;
+    }
+    if (i >= FragmentationAlarmReport::kTopStacks) {
+      continue;
+    }
+    if (report.num_stacks < FragmentationAlarmReport::kTopStacks) {
+      ++report.num_stacks;
+    }
+    for (int j = report.num_stacks - 1; j > i; --j) {
+      report.top[j] = report.top[j - 1];
+    }
+    report.top[i].waste_bytes = bucket.waste_bytes;
+    report.top[i].depth = bucket.depth;
+    memcpy(report.top[i].stack, bucket.stack,
+           sizeof(bucket.stack[0]) * bucket.depth);
+  }
+
+  callback(report);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
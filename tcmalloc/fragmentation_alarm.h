@@ -0,0 +1,78 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Resident watchdog for internal fragmentation: bytes backing allocations
+// beyond what callers requested.  The background thread periodically
+// aggregates estimated waste per allocation stack from the live sampled
+// allocations -- no profile construction and no symbolization -- and fires a
+// registered callback when total waste crosses a threshold.  The report
+// carries raw program counters for the top stacks so an incident handler can
+// attribute the waste offline, without paying for a full
+// SnapshotCurrent(kFragmentation) collection at incident time.
+
+#ifndef TCMALLOC_FRAGMENTATION_ALARM_H_
+#define TCMALLOC_FRAGMENTATION_ALARM_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+class Static;
+
+struct FragmentationAlarmReport {
+  static constexpr int kTopStacks = 8;
+
+  // Estimated waste across all live sampled allocations, after unsampling.
+  size_t total_waste_bytes = 0;
+  // The threshold that was crossed.
+  size_t threshold_bytes = 0;
+
+  struct Stack {
+    size_t waste_bytes = 0;
+    int depth = 0;
+    void* stack[kMaxStackDepth];
+  };
+  // Top stacks by waste, ordered by decreasing waste_bytes; only the first
+  // num_stacks entries are valid.  Program counters are not symbolized.
+  int num_stacks = 0;
+  Stack top[kTopStacks];
+};
+
+// Invoked on the background thread when total waste crosses the threshold.
+// The scan has already completed when the callback runs, so allocating is
+// safe, but the callback delays all other background actions until it
+// returns.
+using FragmentationAlarmCallback = void (*)(const FragmentationAlarmReport&);
+
+// Registers <callback> to receive alarm reports (nullptr disables the
+// alarm).  Returns the previously registered callback.
+FragmentationAlarmCallback SetFragmentationAlarmCallback(
+    FragmentationAlarmCallback callback);
+
+// Scans live sampled allocations and fires the registered callback if the
+// estimated total waste is at least <threshold_bytes>.  Edge-triggered: once
+// fired, the alarm only re-arms after waste falls back under the threshold.
+// Must only be called from the background thread.
+void CheckFragmentationAlarm(Static& state, size_t threshold_bytes);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_FRAGMENTATION_ALARM_H_
@@ -0,0 +1,96 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/fragmentation_alarm.h"
+
+#include <stddef.h>
+
+#include <limits>
+#include <new>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/static_vars.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+FragmentationAlarmReport last_report;
+int fire_count = 0;
+
+void RecordReport(const FragmentationAlarmReport& report) {
+  last_report = report;
+  ++fire_count;
+}
+
+TEST(FragmentationAlarmTest, FiresAndRearms) {
+  // Sample aggressively so the allocations below are reliably recorded.
+  ScopedProfileSamplingRate sampling_rate(512);
+
+  // Request a size just above a size class boundary so every object carries
+  // internal fragmentation.
+  constexpr size_t kItemSize = 520;
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 4096; ++i) {
+    ptrs.push_back(::operator new(kItemSize));
+  }
+
+  FragmentationAlarmCallback previous =
+      SetFragmentationAlarmCallback(RecordReport);
+  EXPECT_EQ(previous, nullptr);
+
+  CheckFragmentationAlarm(tc_globals, 1);
+  ASSERT_EQ(fire_count, 1);
+  EXPECT_GT(last_report.total_waste_bytes, 0);
+  EXPECT_EQ(last_report.threshold_bytes, 1);
+  ASSERT_GT(last_report.num_stacks, 0);
+  for (int i = 0; i < last_report.num_stacks; ++i) {
+    EXPECT_GT(last_report.top[i].waste_bytes, 0);
+    EXPECT_GT(last_report.top[i].depth, 0);
+    if (i > 0) {
+      EXPECT_GE(last_report.top[i - 1].waste_bytes,
+                last_report.top[i].waste_bytes);
+    }
+  }
+
+  // Edge-triggered: waste is still above the threshold, but the alarm has
+  // already fired.
+  CheckFragmentationAlarm(tc_globals, 1);
+  EXPECT_EQ(fire_count, 1);
+
+  // Falling below an (unreachable) threshold re-arms the alarm, and the next
+  // crossing fires again.
+  CheckFragmentationAlarm(tc_globals, std::numeric_limits<size_t>::max());
+  EXPECT_EQ(fire_count, 1);
+  CheckFragmentationAlarm(tc_globals, 1);
+  EXPECT_EQ(fire_count, 2);
+
+  // A zero threshold or no registered callback disables the alarm entirely.
+  CheckFragmentationAlarm(tc_globals, std::numeric_limits<size_t>::max());
+  CheckFragmentationAlarm(tc_globals, 0);
+  EXPECT_EQ(fire_count, 2);
+  SetFragmentationAlarmCallback(nullptr);
+  CheckFragmentationAlarm(tc_globals, 1);
+  EXPECT_EQ(fire_count, 2);
+
+  for (void* ptr : ptrs) {
+    ::operator delete(ptr);
+  }
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -0,0 +1,145 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/fragmentation_simulator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include "absl/strings/string_view.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/huge_page_aware_allocator.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/sizemap.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/stats.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace huge_page_allocator_internal {
+
+FragmentationSimulator::FragmentationSimulator(
+    const HugePageAwareAllocatorOptions& options) {
+  void* p = malloc(sizeof(HugePageAwareAllocator<FakeStaticForwarder>));
+  allocator_ = new (p) HugePageAwareAllocator<FakeStaticForwarder>(options);
+}
+
+size_t FragmentationSimulator::BackedBytes() {
+  BackingStats stats;
+  {
+    PageHeapSpinLockHolder l;
+    stats = allocator_->stats();
+  }
+  return stats.system_bytes - stats.unmapped_bytes;
+}
+
+FragmentationReport FragmentationSimulator::Replay(absl::string_view trace) {
+  FragmentationReport report;
+
+  for (size_t pos = 0; pos + sizeof(FragmentationTraceRecord) <= trace.size();
+       pos += sizeof(FragmentationTraceRecord)) {
+    FragmentationTraceRecord record;
+    memcpy(&record, trace.data() + pos, sizeof(record));
+
+    switch (record.op) {
+      case FragmentationTraceRecord::kAlloc: {
+        if (record.pages == 0 || live_.contains(record.id)) {
+          ++report.records_skipped;
+          continue;
+        }
+        const Length length(record.pages);
+        size_t objects = std::max<size_t>(record.objects, 1);
+        AccessDensityPrediction density =
+            record.density != 0 ? AccessDensityPrediction::kDense
+                                : AccessDensityPrediction::kSparse;
+        const size_t object_size = length.in_bytes() / objects;
+        if (object_size > kMaxSize) {
+          // Too large for a size class; this is a span backing a single large
+          // allocation.
+          objects = 1;
+          density = AccessDensityPrediction::kSparse;
+        } else if (!SizeMap::IsValidSizeClass(object_size, length.raw_num(),
+                                              kMinObjectsToMove)) {
+          ++report.records_skipped;
+          continue;
+        }
+        // Allocations spanning more than half a hugepage may be donated to
+        // HugeRegion, which only accepts sparse spans.
+        if (length > kPagesPerHugePage / 2) {
+          density = AccessDensityPrediction::kSparse;
+        }
+
+        Span* span = allocator_->New(
+            length, {.objects_per_span = objects, .density = density});
+        TC_CHECK_NE(span, nullptr);
+        live_[record.id] = {span, objects};
+        allocated_ += span->num_pages();
+        break;
+      }
+      case FragmentationTraceRecord::kFree: {
+        auto it = live_.find(record.id);
+        if (it == live_.end()) {
+          ++report.records_skipped;
+          continue;
+        }
+        allocated_ -= it->second.span->num_pages();
+        {
+          PageHeapSpinLockHolder l;
+          allocator_->Delete(it->second.span, it->second.objects_per_span);
+        }
+        live_.erase(it);
+        break;
+      }
+      default:
+        ++report.records_skipped;
+        continue;
+    }
+
+    ++report.records_replayed;
+    report.peak_application_bytes =
+        std::max(report.peak_application_bytes, allocated_.in_bytes());
+    report.peak_backed_bytes =
+        std::max(report.peak_backed_bytes, BackedBytes());
+  }
+
+  report.realized_fragmentation_pct = static_cast<size_t>(
+      100. * safe_div(report.peak_backed_bytes - report.peak_application_bytes,
+                      report.peak_application_bytes));
+
+  // Free anything the trace leaked so a subsequent Replay starts from an
+  // empty (but possibly still backed) heap.
+  for (auto& [id, alloc] : live_) {
+    PageHeapSpinLockHolder l;
+    allocator_->Delete(alloc.span, alloc.objects_per_span);
+  }
+  live_.clear();
+  allocated_ = Length(0);
+
+  return report;
+}
+
+}  // namespace huge_page_allocator_internal
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,110 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays a compact binary alloc/free trace against the real
+// HugePageAwareAllocator (and with it HugePageFiller and HugeRegion), backed
+// by FakeStaticForwarder instead of the live pageheap.  It reports realized
+// fragmentation the way testing/realized_fragmentation_test.cc measures it:
+// peak backed memory against peak application demand.  This lets us evaluate
+// configuration changes -- e.g. separate filler allocs for few- and
+// many-object spans, or huge region usage -- on captured traces instead of
+// production experiments.
+
+#ifndef TCMALLOC_FRAGMENTATION_SIMULATOR_H_
+#define TCMALLOC_FRAGMENTATION_SIMULATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tcmalloc/huge_page_aware_allocator.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/mock_huge_page_static_forwarder.h"
+#include "tcmalloc/pages.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace huge_page_allocator_internal {
+
+// One trace record, stored packed in input order.  A trace is simply a
+// concatenation of these; any trailing partial record is ignored.
+struct FragmentationTraceRecord {
+  enum Op : uint8_t { kAlloc = 0, kFree = 1 };
+
+  // Allocation identifier; a kFree record releases the live allocation made
+  // by the kAlloc record with the same id.
+  uint64_t id;
+  // Span length in pages.  Ignored for kFree.
+  uint32_t pages;
+  // Number of objects the span will hold.  Ignored for kFree.
+  uint32_t objects;
+  uint8_t op;
+  // Nonzero if the span is predicted densely accessed.  Ignored for kFree.
+  uint8_t density;
+  // Pads the record to 24 bytes and leaves room for future fields.
+  uint8_t reserved[6];
+};
+static_assert(sizeof(FragmentationTraceRecord) == 24,
+              "trace format is part of the tooling contract");
+
+struct FragmentationReport {
+  size_t peak_backed_bytes = 0;
+  size_t peak_application_bytes = 0;
+  // 100 * (peak_backed - peak_application) / peak_application, matching the
+  // generic.realized_fragmentation property.
+  size_t realized_fragmentation_pct = 0;
+  size_t records_replayed = 0;
+  // Records dropped because they were malformed (zero-length allocations,
+  // invalid size classes, frees of unknown or already-freed ids).
+  size_t records_skipped = 0;
+};
+
+class FragmentationSimulator {
+ public:
+  explicit FragmentationSimulator(const HugePageAwareAllocatorOptions& options);
+
+  FragmentationSimulator(const FragmentationSimulator&) = delete;
+  FragmentationSimulator& operator=(const FragmentationSimulator&) = delete;
+
+  // Replays trace, interpreted as a packed array of
+  // FragmentationTraceRecords, and returns the realized fragmentation over
+  // the replay.  Any allocations still live at the end of the trace are
+  // freed, so Replay may be called again with another trace.
+  FragmentationReport Replay(absl::string_view trace);
+
+  FakeStaticForwarder& forwarder() { return allocator_->forwarder(); }
+
+ private:
+  struct LiveSpan {
+    Span* span;
+    size_t objects_per_span;
+  };
+
+  size_t BackedBytes();
+
+  // HugePageAwareAllocator can't be destroyed cleanly, so we construct one in
+  // place and never free it.
+  HugePageAwareAllocator<FakeStaticForwarder>* allocator_;
+  absl::flat_hash_map<uint64_t, LiveSpan> live_;
+  Length allocated_;
+};
+
+}  // namespace huge_page_allocator_internal
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_FRAGMENTATION_SIMULATOR_H_
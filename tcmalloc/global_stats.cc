@@ -14,8 +14,10 @@
 
 #include "tcmalloc/global_stats.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <optional>
 
 #include "absl/strings/match.h"
@@ -23,22 +25,33 @@
 #include "absl/strings/strip.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "tcmalloc/background_scheduler.h"
 #include "tcmalloc/central_freelist.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/deferred_free_queue.h"
+#include "tcmalloc/emergency_span_reserve.h"
 #include "tcmalloc/experiment.h"
 #include "tcmalloc/experiment_config.h"
 #include "tcmalloc/guarded_page_allocator.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/lock_telemetry.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/large_span_cache.h"
 #include "tcmalloc/internal/memory_stats.h"
+#include "tcmalloc/internal/page_size.h"
+#include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/internal/optimization.h"
+#include "tcmalloc/internal/pageflags.h"
 #include "tcmalloc/internal/percpu.h"
+#include "tcmalloc/internal/residency.h"
 #include "tcmalloc/page_allocator.h"
 #include "tcmalloc/page_heap_allocator.h"
 #include "tcmalloc/pagemap.h"
 #include "tcmalloc/parameters.h"
+#include "tcmalloc/sized_delete_check.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/span_stats.h"
 #include "tcmalloc/stack_trace_table.h"
@@ -87,7 +100,7 @@ void ExtractStats(TCMallocStats* r, uint64_t* class_count,
     }
     if (span_stats) {
       span_stats[size_class] =
-          tc_globals.central_freelist(size_class).GetSpanStats();
+          tc_globals.central_freelist(size_class).GetSpanStatsSnapshot();
     }
   }
 
@@ -152,6 +165,79 @@ void ExtractTCMallocStats(TCMallocStats* r, bool report_residence) {
   ExtractStats(r, nullptr, nullptr, nullptr, nullptr, report_residence);
 }
 
+namespace {
+
+// Maximum number of huge cache / huge region ranges snapshotted by
+// ExtractResidencyStats.  Owners holding more ranges are reported truncated.
+constexpr size_t kMaxResidencyRanges = 128;
+
+// Accumulates kernel-reported information about [ptr, ptr + bytes) into
+// owner.  Queries that fail (e.g. pageflags missing on unpatched kernels)
+// leave the corresponding counters unchanged.
+void MeasureOwnerRange(Residency& residency, PageFlags& pageflags,
+                       const void* ptr, size_t bytes,
+                       ResidencyStats::Owner& owner) {
+  if (bytes == 0) return;
+  owner.virtual_bytes += bytes;
+  if (auto info = residency.Get(ptr, bytes); info.has_value()) {
+    owner.resident_bytes += info->bytes_resident;
+    owner.swapped_bytes += info->bytes_swapped;
+  }
+  if (auto stats = pageflags.Get(ptr, bytes); stats.has_value()) {
+    owner.hugepage_backed_bytes += stats->bytes_huge;
+  }
+}
+
+}  // namespace
+
+void ExtractResidencyStats(ResidencyStats* r) {
+  *r = ResidencyStats{};
+
+  HugeRange cache_ranges[kMaxResidencyRanges];
+  HugeRange region_ranges[kMaxResidencyRanges];
+  size_t cache_count, region_count;
+  {
+    PageHeapSpinLockHolder l;
+    cache_count = tc_globals.page_allocator().GetHugeCacheRanges(
+        cache_ranges, kMaxResidencyRanges);
+    region_count = tc_globals.page_allocator().GetHugeRegionRanges(
+        region_ranges, kMaxResidencyRanges);
+  }
+  r->huge_cache.truncated = cache_count > kMaxResidencyRanges;
+  r->huge_region.truncated = region_count > kMaxResidencyRanges;
+  cache_count = std::min(cache_count, kMaxResidencyRanges);
+  region_count = std::min(region_count, kMaxResidencyRanges);
+
+  // The kernel is queried with pageheap_lock dropped; ranges that changed
+  // hands since the snapshot are misattributed, which we tolerate for
+  // diagnostic output.
+  Residency residency;
+  PageFlags pageflags;
+
+  for (size_t i = 0; i < cache_count; ++i) {
+    MeasureOwnerRange(residency, pageflags, cache_ranges[i].start_addr(),
+                      cache_ranges[i].byte_len(), r->huge_cache);
+  }
+  for (size_t i = 0; i < region_count; ++i) {
+    MeasureOwnerRange(residency, pageflags, region_ranges[i].start_addr(),
+                      region_ranges[i].byte_len(), r->huge_region);
+  }
+
+  // The pagemap root and the per-CPU slabs are fixed-location metadata; as in
+  // ExtractStats(), their extents may be read without pageheap_lock.
+  MeasureOwnerRange(residency, pageflags, &tc_globals.pagemap(),
+                    sizeof(tc_globals.pagemap()), r->pagemap_root);
+  if (UsePerCpuCache(tc_globals)) {
+    const auto [slabs, slabs_bytes] = tc_globals.cpu_cache().GetSlabExtent();
+    MeasureOwnerRange(residency, pageflags, slabs, slabs_bytes,
+                      r->percpu_slab);
+  }
+  const auto [pool, pool_bytes] =
+      tc_globals.guardedpage_allocator().GetPoolRange();
+  MeasureOwnerRange(residency, pageflags, pool, pool_bytes,
+                    r->guarded_page_pool);
+}
+
 // Because different fields of stats are computed from state protected
 // by different locks, they may be inconsistent.  Prevent underflow
 // when subtracting to avoid gigantic results.
@@ -235,6 +321,20 @@ static absl::string_view SizeClassConfigurationString(
   return "SIZE_CLASS_UNKNOWN";
 }
 
+static absl::string_view LockName(LockId id) {
+  switch (id) {
+    case LockId::kPageHeap:
+      return "pageheap_lock";
+    case LockId::kCentralFreeList:
+      return "central_freelist";
+    case LockId::kTransferCache:
+      return "transfer_cache";
+  }
+
+  ASSUME(false);
+  return "unknown";
+}
+
 static absl::string_view PerCpuTypeString(RseqVcpuMode mode) {
   switch (mode) {
     case RseqVcpuMode::kNone:
@@ -303,11 +403,13 @@ void DumpStats(Printer* out, int level) {
       "MALLOC:   %12u (%7.1f MiB) per-CPU slab bytes used\n"
       "MALLOC:   %12u (%7.1f MiB) per-CPU slab resident bytes\n"
       "MALLOC:   %12u (%7.1f MiB) malloc metadata Arena non-resident bytes\n"
+      "MALLOC:   %12u (%7.1f MiB) Deferred free queue in-flight bytes\n"
       "MALLOC:   %12u (%7.1f MiB) Actual memory used at peak\n"
       "MALLOC:   %12u (%7.1f MiB) Estimated in-use at peak\n"
       "MALLOC:   %12.4f               Realized fragmentation (%%)\n"
       "MALLOC:   %12u               Tcmalloc page size\n"
       "MALLOC:   %12u               Tcmalloc hugepage size\n"
+      "MALLOC:   %12u               Kernel page size\n"
       "MALLOC:   %12u               CPUs Allowed in Mask\n"
       "MALLOC:   %12u               Arena blocks\n",
       bytes_in_use_by_app, bytes_in_use_by_app / MiB,
@@ -342,6 +444,8 @@ void DumpStats(Printer* out, int level) {
       stats.percpu_metadata_bytes / MiB,
       stats.percpu_metadata_bytes_res, stats.percpu_metadata_bytes_res / MiB,
       stats.arena.bytes_nonresident, stats.arena.bytes_nonresident / MiB,
+      uint64_t(DeferredFreeInFlightBytes()),
+      DeferredFreeInFlightBytes() / MiB,
       uint64_t(stats.peak_stats.backed_bytes),
       stats.peak_stats.backed_bytes / MiB,
       uint64_t(stats.peak_stats.sampled_application_bytes),
@@ -349,6 +453,7 @@ void DumpStats(Printer* out, int level) {
       100. * safe_div(stats.peak_stats.backed_bytes - stats.peak_stats.sampled_application_bytes, stats.peak_stats.sampled_application_bytes),
       uint64_t(kPageSize),
       uint64_t(kHugePageSize),
+      uint64_t(GetPageSize()),
       CountAllowedCpus(),
       stats.arena.blocks
   );
@@ -361,6 +466,17 @@ void DumpStats(Printer* out, int level) {
   });
   out->printf("\n");
 
+  for (const auto& config : experiments) {
+    if (!IsExperimentActive(config.id)) continue;
+    const ExperimentImpact& impact = GetExperimentImpact(config.id);
+    if (impact.allocations.value() == 0 && impact.bytes.value() == 0) continue;
+    out->printf(
+        "MALLOC EXPERIMENT IMPACT: %s: %zu allocations (estimated), %zu "
+        "bytes\n",
+        config.name, static_cast<size_t>(impact.allocations.value()),
+        static_cast<size_t>(impact.bytes.value()));
+  }
+
   out->printf(
       "MALLOC SAMPLED PROFILES: %zu bytes (current), %zu bytes (internal "
       "fragmentation), %zu bytes (peak), %zu count (total)\n",
@@ -369,6 +485,43 @@ void DumpStats(Printer* out, int level) {
       tc_globals.peak_heap_tracker().CurrentPeakSize(),
       tc_globals.total_sampled_count_.value());
 
+  {
+    size_t leaf_cache_hits, leaf_cache_misses;
+    tc_globals.pagemap().LeafCacheStats(&leaf_cache_hits, &leaf_cache_misses);
+    out->printf(
+        "MALLOC PAGEMAP LEAF CACHE: %zu hits, %zu misses (%0.1f %% hit rate)\n",
+        leaf_cache_hits, leaf_cache_misses,
+        100. * safe_div(leaf_cache_hits, leaf_cache_hits + leaf_cache_misses));
+  }
+
+  {
+    const LazyReleaseStats lazy = SystemLazyReleaseStats();
+    if (lazy.released_bytes > 0) {
+      out->printf(
+          "MALLOC LAZY RELEASE: %zu bytes released with MADV_FREE "
+          "(%zu of %zu sampled bytes still resident)%s\n",
+          lazy.released_bytes, lazy.resident_bytes, lazy.sampled_bytes,
+          lazy.fallback ? " (fell back to MADV_DONTNEED)" : "");
+    }
+  }
+
+  for (int l = 0; l < LockTelemetry::kNumIds; ++l) {
+    const LockId id = static_cast<LockId>(l);
+    const uint64_t waits = lock_telemetry.waits(id);
+    if (waits == 0) continue;
+    out->printf(
+        "MALLOC LOCK WAITS: %s: %u contended acquisitions, %u cycles waiting\n",
+        LockName(id), waits, lock_telemetry.wait_cycles(id));
+    out->printf("MALLOC LOCK WAITS: %s histogram (bucket b: < 2^b cycles):",
+                LockName(id));
+    for (int b = 0; b < LockTelemetry::kNumBuckets; ++b) {
+      const uint64_t count = lock_telemetry.bucket(id, b);
+      if (count == 0) continue;
+      out->printf(" %d:%u", b, count);
+    }
+    out->printf("\n");
+  }
+
   MemoryStats memstats;
   if (GetMemoryStats(&memstats)) {
     uint64_t rss = memstats.rss;
@@ -416,6 +569,30 @@ void DumpStats(Printer* out, int level) {
           span_stats[size_class].prob_returned());
     }
 
+    out->printf("------------------------------------------------\n");
+    out->printf("Internal fragmentation by size class, from sampled\n");
+    out->printf("allocations: extrapolated requested vs granted bytes,\n");
+    out->printf("joined with resident span pages\n");
+    out->printf("------------------------------------------------\n");
+    for (int size_class = 1; size_class < kNumClasses; ++size_class) {
+      const uint64_t requested =
+          tc_globals.class_fragmentation().requested_bytes(size_class);
+      const uint64_t granted =
+          tc_globals.class_fragmentation().allocated_bytes(size_class);
+      if (granted == 0) continue;
+      out->printf(
+          // clang-format off
+          "class %3d [ %8zu bytes ] : %10.1f MiB requested; %10.1f MiB granted; "
+          "%5.1f%% waste; %8u live pages\n",
+          // clang-format on
+          size_class, tc_globals.sizemap().class_to_size(size_class),
+          requested / static_cast<double>(MiB),
+          granted / static_cast<double>(MiB),
+          100.0 * safe_div(granted - requested, granted),
+          span_stats[size_class].num_live_spans() *
+              tc_globals.sizemap().class_to_pages(size_class));
+    }
+
 #ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
     out->printf("------------------------------------------------\n");
     out->printf("Central cache freelist: Span utilization histogram\n");
@@ -431,6 +608,31 @@ void DumpStats(Printer* out, int level) {
 
     if (UsePerCpuCache(tc_globals)) {
       tc_globals.cpu_cache().Print(out);
+    } else {
+      uint64_t occupancy[ThreadCache::kOccupancyBuckets];
+      uint64_t recycled_bytes;
+      uint64_t recycled_capacity;
+      {
+        PageHeapSpinLockHolder l;
+        ThreadCache::GetOccupancyHistogram(occupancy);
+        recycled_bytes = ThreadCache::exit_recycled_object_bytes();
+        recycled_capacity = ThreadCache::exit_recycled_capacity_bytes();
+      }
+      out->printf("------------------------------------------------\n");
+      out->printf("Thread cache occupancy: caches by cached bytes\n");
+      out->printf("as a percentage of the cache's limit\n");
+      out->printf("------------------------------------------------\n");
+      for (size_t i = 0; i < ThreadCache::kOccupancyBuckets - 1; ++i) {
+        out->printf("occupancy [ %3zu%%, %3zu%% ) : %8zu caches\n", i * 10,
+                    (i + 1) * 10, static_cast<size_t>(occupancy[i]));
+      }
+      out->printf("occupancy [ 100%%,  inf ) : %8zu caches\n",
+                  static_cast<size_t>(
+                      occupancy[ThreadCache::kOccupancyBuckets - 1]));
+      out->printf("Bytes merged to transfer caches at thread exit: %zu\n",
+                  static_cast<size_t>(recycled_bytes));
+      out->printf("Capacity returned to unclaimed pool at thread exit: %zu\n",
+                  static_cast<size_t>(recycled_capacity));
     }
 
     tc_globals.page_allocator().Print(out, MemoryTag::kNormal);
@@ -441,6 +643,22 @@ void DumpStats(Printer* out, int level) {
     tc_globals.page_allocator().Print(out, MemoryTag::kCold);
     tc_globals.guardedpage_allocator().Print(out);
 
+    if (tc_globals.pinned_arena().active()) {
+      out->printf(
+          "Pinned arena: %12zu bytes capacity; %12zu bytes used; "
+          "%12llu overflows to normal memory\n",
+          tc_globals.pinned_arena().capacity_bytes(),
+          tc_globals.pinned_arena().used_bytes(),
+          tc_globals.pinned_arena().overflow_count());
+    }
+
+    // Per-action runtime of the background maintenance thread, when one is
+    // running.
+    if (BackgroundScheduler* scheduler = GetPublishedBackgroundScheduler();
+        scheduler != nullptr) {
+      scheduler->Print(out);
+    }
+
     uint64_t soft_limit_bytes =
         tc_globals.page_allocator().limit(PageAllocator::kSoft);
     uint64_t hard_limit_bytes =
@@ -540,6 +758,31 @@ void DumpStatsInPbtxt(Printer* out, int level) {
   region.PrintI64("num_spans_created", uint64_t(stats.span_stats.total));
   region.PrintI64("num_thread_heaps", uint64_t(stats.tc_stats.in_use));
   region.PrintI64("num_thread_heaps_created", uint64_t(stats.tc_stats.total));
+  {
+    PageHeapSpinLockHolder l;
+    region.PrintI64("thread_cache_exit_recycled_bytes",
+                    ThreadCache::exit_recycled_object_bytes());
+    region.PrintI64("thread_cache_exit_recycled_capacity",
+                    ThreadCache::exit_recycled_capacity_bytes());
+  }
+  region.PrintI64("pinned_arena_bytes",
+                  tc_globals.pinned_arena().capacity_bytes());
+  region.PrintI64("pinned_arena_used_bytes",
+                  tc_globals.pinned_arena().used_bytes());
+  region.PrintI64("pinned_arena_overflows",
+                  tc_globals.pinned_arena().overflow_count());
+  if (!UsePerCpuCache(tc_globals)) {
+    uint64_t occupancy[ThreadCache::kOccupancyBuckets];
+    {
+      PageHeapSpinLockHolder l;
+      ThreadCache::GetOccupancyHistogram(occupancy);
+    }
+    for (size_t i = 0; i < ThreadCache::kOccupancyBuckets; ++i) {
+      PbtxtRegion entry = region.CreateSubRegion("thread_cache_occupancy");
+      entry.PrintI64("lower_bound_percent", i * 10);
+      entry.PrintI64("count", occupancy[i]);
+    }
+  }
   region.PrintI64("num_stack_traces", uint64_t(stats.stack_stats.in_use));
   region.PrintI64("num_stack_traces_created",
                   uint64_t(stats.stack_stats.total));
@@ -549,13 +792,22 @@ void DumpStatsInPbtxt(Printer* out, int level) {
                   uint64_t(stats.linked_sample_stats.total));
   region.PrintI64("pagemap_size", uint64_t(stats.pagemap_bytes));
   region.PrintI64("pagemap_root_residence", stats.pagemap_root_bytes_res);
+  {
+    size_t leaf_cache_hits, leaf_cache_misses;
+    tc_globals.pagemap().LeafCacheStats(&leaf_cache_hits, &leaf_cache_misses);
+    region.PrintI64("pagemap_leaf_cache_hits", leaf_cache_hits);
+    region.PrintI64("pagemap_leaf_cache_misses", leaf_cache_misses);
+  }
   region.PrintI64("percpu_slab_size", stats.percpu_metadata_bytes);
   region.PrintI64("percpu_slab_residence", stats.percpu_metadata_bytes_res);
+  region.PrintI64("deferred_free_in_flight_bytes",
+                  DeferredFreeInFlightBytes());
   region.PrintI64("peak_backed", stats.peak_stats.backed_bytes);
   region.PrintI64("peak_application_demand",
                   stats.peak_stats.sampled_application_bytes);
   region.PrintI64("tcmalloc_page_size", uint64_t(kPageSize));
   region.PrintI64("tcmalloc_huge_page_size", uint64_t(kHugePageSize));
+  region.PrintI64("kernel_page_size", uint64_t(GetPageSize()));
   region.PrintI64("cpus_allowed", CountAllowedCpus());
   region.PrintI64("arena_blocks", stats.arena.blocks);
 
@@ -570,6 +822,16 @@ void DumpStatsInPbtxt(Printer* out, int level) {
                               tc_globals.peak_heap_tracker().CurrentPeakSize());
   }
 
+  for (const auto& config : experiments) {
+    if (!IsExperimentActive(config.id)) continue;
+    const ExperimentImpact& impact = GetExperimentImpact(config.id);
+    if (impact.allocations.value() == 0 && impact.bytes.value() == 0) continue;
+    PbtxtRegion entry = region.CreateSubRegion("experiment_impact");
+    entry.PrintRaw("name", config.name);
+    entry.PrintI64("allocations", impact.allocations.value());
+    entry.PrintI64("bytes", impact.bytes.value());
+  }
+
   // Print total process stats (inclusive of non-malloc sources).
   MemoryStats memstats;
   if (GetMemoryStats(&memstats)) {
@@ -595,6 +857,12 @@ void DumpStatsInPbtxt(Printer* out, int level) {
         entry.PrintI64("num_spans_returned",
                        span_stats[size_class].num_spans_returned);
         entry.PrintI64("obj_capacity", span_stats[size_class].obj_capacity);
+        entry.PrintI64(
+            "sampled_requested_bytes",
+            tc_globals.class_fragmentation().requested_bytes(size_class));
+        entry.PrintI64(
+            "sampled_granted_bytes",
+            tc_globals.class_fragmentation().allocated_bytes(size_class));
         tc_globals.central_freelist(size_class)
             .PrintSpanUtilStatsInPbtxt(&entry);
       }
@@ -640,8 +908,33 @@ void DumpStatsInPbtxt(Printer* out, int level) {
     tc_globals.guardedpage_allocator().PrintInPbtxt(&gwp_asan);
   }
 
+  if (BackgroundScheduler* scheduler = GetPublishedBackgroundScheduler();
+      scheduler != nullptr) {
+    scheduler->PrintInPbtxt(&region);
+  }
+
   region.PrintI64("memory_release_failures", SystemReleaseErrors());
 
+  {
+    const LazyReleaseStats lazy = SystemLazyReleaseStats();
+    if (lazy.released_bytes > 0) {
+      region.PrintI64("lazy_release_bytes", lazy.released_bytes);
+      region.PrintI64("lazy_release_sampled_bytes", lazy.sampled_bytes);
+      region.PrintI64("lazy_release_resident_bytes", lazy.resident_bytes);
+      region.PrintBool("lazy_release_fallback", lazy.fallback);
+    }
+  }
+
+  for (int l = 0; l < LockTelemetry::kNumIds; ++l) {
+    const LockId id = static_cast<LockId>(l);
+    const uint64_t waits = lock_telemetry.waits(id);
+    if (waits == 0) continue;
+    auto lock_region = region.CreateSubRegion("lock_waits");
+    lock_region.PrintRaw("lock", LockName(id));
+    lock_region.PrintI64("waits", waits);
+    lock_region.PrintI64("wait_cycles", lock_telemetry.wait_cycles(id));
+  }
+
   region.PrintBool("tcmalloc_per_cpu_caches", Parameters::per_cpu_caches());
   region.PrintI64("tcmalloc_max_per_cpu_cache_size",
                   Parameters::max_per_cpu_cache_size());
@@ -683,6 +976,95 @@ void DumpStatsInPbtxt(Printer* out, int level) {
       SizeClassConfigurationString(tc_globals.size_class_configuration()));
 }
 
+size_t FillBinaryStats(void* buffer, size_t buffer_length) {
+  using BinaryStats = MallocExtension::BinaryStats;
+  if (buffer == nullptr || buffer_length < sizeof(BinaryStats)) {
+    return 0;
+  }
+  BinaryStats& out = *static_cast<BinaryStats*>(buffer);
+  memset(&out, 0, sizeof(out));
+  out.version = BinaryStats::kVersion;
+  out.struct_size = sizeof(BinaryStats);
+
+  // Monitoring scrapes this at high frequency, so we refuse (returning 0)
+  // rather than queue behind the pageheap lock; the caller retries on its
+  // next interval.
+  TCMallocStats stats = {};
+  if (!pageheap_lock.TryLock()) {
+    return 0;
+  }
+  stats.tc_stats = ThreadCache::GetStats(&stats.thread_bytes, nullptr);
+  stats.metadata_bytes = tc_globals.metadata_bytes();
+  stats.pageheap = tc_globals.page_allocator().stats();
+  stats.arena = tc_globals.arena().stats();
+  // As in ExtractStats() when not reporting residence, count bytes released
+  // from the arena as metadata we still hold address space for.
+  stats.metadata_bytes += stats.arena.bytes_nonresident;
+  pageheap_lock.Unlock();
+
+  // The remaining counters are safe to read without the pageheap lock; see
+  // ExtractStats().
+  const size_t num_classes =
+      std::min<size_t>(kNumClasses, BinaryStats::kMaxSizeClasses);
+  out.num_size_classes = num_classes;
+  for (size_t size_class = 0; size_class < num_classes; ++size_class) {
+    const size_t length = tc_globals.central_freelist(size_class).length();
+    const size_t tc_length = tc_globals.transfer_cache().tc_length(size_class);
+    const size_t cache_overhead =
+        tc_globals.central_freelist(size_class).OverheadBytes();
+    const size_t size = tc_globals.sizemap().class_to_size(size_class);
+    stats.central_bytes += (size * length) + cache_overhead;
+    stats.transfer_bytes += (size * tc_length);
+
+    const SpanStats span_stats =
+        tc_globals.central_freelist(size_class).GetSpanStatsSnapshot();
+    const TransferCacheStats tc_stats =
+        tc_globals.transfer_cache().GetStats(size_class);
+    out.class_object_size[size_class] = size;
+    out.class_spans_requested[size_class] = span_stats.num_spans_requested;
+    out.class_spans_returned[size_class] = span_stats.num_spans_returned;
+    out.class_transfer_insert_hits[size_class] = tc_stats.insert_hits;
+    out.class_transfer_insert_misses[size_class] = tc_stats.insert_misses;
+    out.class_transfer_remove_hits[size_class] = tc_stats.remove_hits;
+    out.class_transfer_remove_misses[size_class] = tc_stats.remove_misses;
+  }
+
+  if (UsePerCpuCache(tc_globals)) {
+    stats.per_cpu_bytes = tc_globals.cpu_cache().TotalUsedBytes();
+    stats.sharded_transfer_bytes =
+        tc_globals.sharded_transfer_cache().TotalBytes();
+    const auto miss_stats = tc_globals.cpu_cache().GetTotalCacheMissStats();
+    out.cpu_cache_underflows = miss_stats.underflows;
+    out.cpu_cache_overflows = miss_stats.overflows;
+  }
+
+  static_assert(BinaryStats::kNumLockIds == LockTelemetry::kNumIds,
+                "BinaryStats lock slots out of sync with LockTelemetry");
+  static_assert(BinaryStats::kNumLockWaitBuckets == LockTelemetry::kNumBuckets,
+                "BinaryStats lock buckets out of sync with LockTelemetry");
+  for (int l = 0; l < LockTelemetry::kNumIds; ++l) {
+    const LockId id = static_cast<LockId>(l);
+    out.lock_wait_count[l] = lock_telemetry.waits(id);
+    out.lock_wait_cycles[l] = lock_telemetry.wait_cycles(id);
+    for (int b = 0; b < LockTelemetry::kNumBuckets; ++b) {
+      out.lock_wait_hist[l][b] = lock_telemetry.bucket(id, b);
+    }
+  }
+
+  out.in_use_by_app_bytes = InUseByApp(stats);
+  out.page_heap_free_bytes = stats.pageheap.free_bytes;
+  out.page_heap_unmapped_bytes = UnmappedBytes(stats);
+  out.central_cache_freelist_bytes = stats.central_bytes;
+  out.per_cpu_cache_freelist_bytes = stats.per_cpu_bytes;
+  out.sharded_transfer_cache_freelist_bytes = stats.sharded_transfer_bytes;
+  out.transfer_cache_freelist_bytes = stats.transfer_bytes;
+  out.thread_cache_freelist_bytes = stats.thread_bytes;
+  out.metadata_bytes = stats.metadata_bytes;
+  out.physical_memory_used_bytes = PhysicalMemoryUsed(stats);
+  out.virtual_memory_used_bytes = VirtualMemoryUsed(stats);
+  return sizeof(BinaryStats);
+}
+
 bool GetNumericProperty(const char* name_data, size_t name_size,
                         size_t* value) {
   // LINT.IfChange
@@ -696,6 +1078,14 @@ bool GetNumericProperty(const char* name_data, size_t name_size,
     return true;
   }
 
+  // Unlike per_cpu_caches_active, which reports the configuration, this
+  // probes whether rseq is actually usable from the calling thread.  The two
+  // disagree when the kernel or a seccomp policy rejects rseq registration.
+  if (name == "tcmalloc.percpu_active") {
+    *value = tc_globals.CpuCacheActive() && subtle::percpu::IsFast();
+    return true;
+  }
+
   if (name == "generic.virtual_memory_used") {
     TCMallocStats stats;
     ExtractTCMallocStats(&stats, false);
@@ -789,6 +1179,16 @@ bool GetNumericProperty(const char* name_data, size_t name_size,
     return true;
   }
 
+  if (name == "tcmalloc.huge_va_fragmentation_ppm") {
+    // The page allocator's worst-heap VA fragmentation score (the fraction of
+    // unbacked free virtual address space outside the longest contiguous
+    // run), scaled to parts per million to fit the integer property space.
+    PageHeapSpinLockHolder l;
+    *value = static_cast<size_t>(
+        tc_globals.page_allocator().GetVAFragmentationScore() * 1000000);
+    return true;
+  }
+
   if (name == "tcmalloc.sampled_internal_fragmentation") {
     *value = tc_globals.sampled_internal_fragmentation_.value();
     return true;
@@ -821,6 +1221,33 @@ bool GetNumericProperty(const char* name_data, size_t name_size,
     return true;
   }
 
+  if (name == "tcmalloc.thread_cache_exit_recycled_bytes") {
+    PageHeapSpinLockHolder l;
+    *value = ThreadCache::exit_recycled_object_bytes();
+    return true;
+  }
+
+  if (name == "tcmalloc.thread_cache_exit_recycled_capacity") {
+    PageHeapSpinLockHolder l;
+    *value = ThreadCache::exit_recycled_capacity_bytes();
+    return true;
+  }
+
+  if (name == "tcmalloc.pinned_arena_bytes") {
+    *value = tc_globals.pinned_arena().capacity_bytes();
+    return true;
+  }
+
+  if (name == "tcmalloc.pinned_arena_used_bytes") {
+    *value = tc_globals.pinned_arena().used_bytes();
+    return true;
+  }
+
+  if (name == "tcmalloc.pinned_arena_overflows") {
+    *value = tc_globals.pinned_arena().overflow_count();
+    return true;
+  }
+
   if (name == "tcmalloc.local_bytes") {
     TCMallocStats stats;
     ExtractTCMallocStats(&stats, false);
@@ -875,6 +1302,30 @@ bool GetNumericProperty(const char* name_data, size_t name_size,
         PageAllocator::kHard);
     return true;
   }
+  if (name == "tcmalloc.large_span_cache_bytes") {
+    *value = LargeSpanCacheBytes();
+    return true;
+  }
+  if (name == "tcmalloc.large_span_cache_hits") {
+    *value = LargeSpanCacheHits();
+    return true;
+  }
+  if (name == "tcmalloc.emergency_spans_served") {
+    *value = EmergencySpansServed();
+    return true;
+  }
+  if (name == "tcmalloc.emergency_span_reserve_misses") {
+    *value = EmergencySpanReserveMisses();
+    return true;
+  }
+  if (name == "tcmalloc.sized_delete_mismatch_checks") {
+    *value = SizedDeleteMismatchChecks();
+    return true;
+  }
+  if (name == "tcmalloc.sized_delete_mismatches") {
+    *value = SizedDeleteMismatches();
+    return true;
+  }
   if (name == "tcmalloc.required_bytes") {
     TCMallocStats stats;
     ExtractTCMallocStats(&stats, false);
@@ -882,6 +1333,111 @@ bool GetNumericProperty(const char* name_data, size_t name_size,
     return true;
   }
 
+  const absl::string_view kResidencyPrefix = "tcmalloc.residency.";
+  if (absl::StartsWith(name, kResidencyPrefix)) {
+    ResidencyStats stats;
+    ExtractResidencyStats(&stats);
+    const struct {
+      absl::string_view name;
+      const ResidencyStats::Owner* owner;
+    } owners[] = {
+        {"pagemap_root", &stats.pagemap_root},
+        {"percpu_slab", &stats.percpu_slab},
+        {"guarded_page_pool", &stats.guarded_page_pool},
+        {"huge_cache", &stats.huge_cache},
+        {"huge_region", &stats.huge_region},
+    };
+    const absl::string_view suffix = absl::StripPrefix(name, kResidencyPrefix);
+    for (const auto& o : owners) {
+      absl::string_view metric = suffix;
+      if (!absl::ConsumePrefix(&metric, o.name) ||
+          !absl::ConsumePrefix(&metric, ".")) {
+        continue;
+      }
+      if (metric == "virtual_bytes") {
+        *value = o.owner->virtual_bytes;
+        return true;
+      }
+      if (metric == "resident_bytes") {
+        *value = o.owner->resident_bytes;
+        return true;
+      }
+      if (metric == "swapped_bytes") {
+        *value = o.owner->swapped_bytes;
+        return true;
+      }
+      if (metric == "hugepage_backed_bytes") {
+        *value = o.owner->hugepage_backed_bytes;
+        return true;
+      }
+    }
+  }
+
+  const absl::string_view kTagVaPrefix = "tcmalloc.tag_va.";
+  if (absl::StartsWith(name, kTagVaPrefix)) {
+    absl::string_view suffix = absl::StripPrefix(name, kTagVaPrefix);
+    for (const MemoryTag tag :
+         {MemoryTag::kSampled, MemoryTag::kNormal, MemoryTag::kNormalP1,
+          MemoryTag::kCold, MemoryTag::kMetadata}) {
+      absl::string_view metric = suffix;
+      if (!absl::ConsumePrefix(&metric, MemoryTagToLabel(tag)) ||
+          !absl::ConsumePrefix(&metric, ".")) {
+        continue;
+      }
+      const TagVaStats va = SystemTagVaStats(tag);
+      if (metric == "current_bytes") {
+        *value = va.current_bytes;
+        return true;
+      }
+      if (metric == "peak_bytes") {
+        *value = va.peak_bytes;
+        return true;
+      }
+      if (metric == "budget_bytes") {
+        *value = va.budget_bytes;
+        return true;
+      }
+      if (metric == "denials") {
+        *value = va.denials;
+        return true;
+      }
+      if (metric == "reserve_bytes") {
+        *value = va.reserve_bytes;
+        return true;
+      }
+      if (metric == "reserve_headroom_bytes") {
+        *value = va.reserve_headroom_bytes;
+        return true;
+      }
+      if (metric == "reserve_fallbacks") {
+        *value = va.reserve_fallbacks;
+        return true;
+      }
+    }
+  }
+
+  const absl::string_view kNumaRehomePrefix = "tcmalloc.numa_rehome.";
+  if (absl::StartsWith(name, kNumaRehomePrefix)) {
+    absl::string_view metric = absl::StripPrefix(name, kNumaRehomePrefix);
+    const NumaRehomeStats rehome = SystemNumaRehomeStats();
+    if (metric == "pages_sampled") {
+      *value = rehome.pages_sampled;
+      return true;
+    }
+    if (metric == "pages_misplaced") {
+      *value = rehome.pages_misplaced;
+      return true;
+    }
+    if (metric == "pages_moved") {
+      *value = rehome.pages_moved;
+      return true;
+    }
+    if (metric == "failures") {
+      *value = rehome.failures;
+      return true;
+    }
+  }
+
   const absl::string_view kExperimentPrefix = "tcmalloc.experiment.";
   if (absl::StartsWith(name, kExperimentPrefix)) {
     std::optional<Experiment> exp =
@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "absl/base/thread_annotations.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
@@ -56,6 +57,35 @@ struct TCMallocStats {
 
 void ExtractTCMallocStats(TCMallocStats* r, bool report_residence);
 
+// Kernel-measured residency of the allocator components whose address ranges
+// we can enumerate cheaply.  Each owner reports how much of its mapped
+// address space is resident, swapped, and backed by transparent hugepages, as
+// read from /proc/self/pagemap and /proc/self/pageflags.
+// hugepage_backed_bytes is zero on kernels without pageflags support.
+struct ResidencyStats {
+  struct Owner {
+    size_t virtual_bytes = 0;
+    size_t resident_bytes = 0;
+    size_t swapped_bytes = 0;
+    size_t hugepage_backed_bytes = 0;
+    // Set if the owner held more distinct ranges than we can snapshot without
+    // allocating; the counts above then cover only the snapshotted prefix.
+    bool truncated = false;
+  };
+
+  Owner pagemap_root;
+  Owner percpu_slab;
+  Owner guarded_page_pool;
+  Owner huge_cache;
+  Owner huge_region;
+};
+
+// Snapshots the owners' address ranges under pageheap_lock, then queries the
+// kernel with the lock dropped.  The result is a point-in-time approximation;
+// ranges that move between the snapshot and the query are misattributed.
+void ExtractResidencyStats(ResidencyStats* r)
+    ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
 uint64_t InUseByApp(const TCMallocStats& stats);
 uint64_t VirtualMemoryUsed(const TCMallocStats& stats);
 uint64_t UnmappedBytes(const TCMallocStats& stats);
@@ -70,6 +100,11 @@ size_t SlackBytes(const BackingStats& stats);
 void DumpStats(Printer* out, int level);
 void DumpStatsInPbtxt(Printer* out, int level);
 
+// Fills buffer with a MallocExtension::BinaryStats snapshot in one pass.
+// Returns the number of bytes written, or 0 if buffer is too small or the
+// pageheap lock could not be acquired without blocking.
+size_t FillBinaryStats(void* buffer, size_t buffer_length);
+
 bool GetNumericProperty(const char* name_data, size_t name_size, size_t* value);
 
 }  // namespace tcmalloc_internal
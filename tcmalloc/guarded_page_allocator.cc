@@ -24,6 +24,7 @@
 #include <cstring>
 #include <utility>
 
+#include "absl/base/internal/cycleclock.h"
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/internal/sysinfo.h"
 #include "absl/debugging/stacktrace.h"
@@ -62,6 +63,9 @@ void GuardedPageAllocator::Init(size_t max_alloced_pages, size_t total_pages) {
   TC_ASSERT_EQ(page_size_ % kPageSize, 0);
 
   rand_ = reinterpret_cast<uint64_t>(this);  // Initialize RNG seed.
+  for (size_t size_class = 0; size_class < kNumClasses; ++size_class) {
+    guard_weight_[size_class].store(1, std::memory_order_relaxed);
+  }
   MapPages();
 }
 
@@ -86,11 +90,16 @@ void GuardedPageAllocator::Reset() {
 }
 
 GuardedAllocWithStatus GuardedPageAllocator::TrySample(
-    size_t size, size_t alignment, Length num_pages,
+    size_t size, size_t alignment, Length num_pages, size_t size_class,
     const StackTrace& stack_trace) {
   if (num_pages != Length(1)) {
     return {nullptr, Profile::Sample::GuardedStatus::LargerThanOnePage};
   }
+  const uint8_t weight = guard_weight(size_class);
+  if (weight == 0) {
+    // The class has been exempted from guarding.
+    return {nullptr, Profile::Sample::GuardedStatus::Filtered};
+  }
   const int64_t guarded_sampling_rate =
       tcmalloc::tcmalloc_internal::Parameters::guarded_sampling_rate();
   if (guarded_sampling_rate < 0) {
@@ -109,7 +118,9 @@ GuardedAllocWithStatus GuardedPageAllocator::TrySample(
             : 1.0;
     const double current_ratio = 1.0 * tc_globals.total_sampled_count_.value() /
                                  (std::max(SuccessfulAllocations(), 1UL));
-    if (current_ratio <= target_ratio) {
+    // A class with weight w clears the limiter w times as readily, steering
+    // the fixed guarded-page budget toward the classes weighted up.
+    if (current_ratio * weight <= target_ratio) {
       return {nullptr, Profile::Sample::GuardedStatus::RateLimited};
     }
 
@@ -146,19 +157,24 @@ GuardedAllocWithStatus GuardedPageAllocator::TrySample(
   //
   // In all cases kPageSize <= GPA::page_size_, so Allocate's preconditions
   // are met.
-  auto alloc_with_status = Allocate(size, alignment);
+  auto alloc_with_status = Allocate(size, alignment, &stack_trace);
   if (alloc_with_status.status == Profile::Sample::GuardedStatus::Guarded) {
     stacktrace_filter_.Add(stack_trace);
   }
   return alloc_with_status;
 }
 
-GuardedAllocWithStatus GuardedPageAllocator::Allocate(size_t size,
-                                                      size_t alignment) {
+GuardedAllocWithStatus GuardedPageAllocator::Allocate(
+    size_t size, size_t alignment, const StackTrace* stack_trace) {
+  OverheadTimer timer(*this);
   if (size == 0) {
     return {nullptr, Profile::Sample::GuardedStatus::TooSmall};
   }
   ssize_t free_slot = ReserveFreeSlot();
+  if (free_slot == -1 && GrowPool()) {
+    // The current pool was exhausted; retry with the just-activated slots.
+    free_slot = ReserveFreeSlot();
+  }
   // All slots are reserved.
   if (free_slot == -1) {
     return {nullptr, Profile::Sample::GuardedStatus::NoAvailableSlots};
@@ -181,7 +197,7 @@ GuardedAllocWithStatus GuardedPageAllocator::Allocate(size_t size,
   MaybeRightAlign(free_slot, size, alignment, &result);
 
   // Record stack trace.
-  SlotMetadata& d = data_[free_slot];
+  SlotMetadata& d = SlotData(free_slot);
   // Count the number of pages that have been used at least once.
   if (d.allocation_start == 0) {
     AllocationGuardSpinLockHolder h(&guarded_page_lock_);
@@ -192,8 +208,17 @@ GuardedAllocWithStatus GuardedPageAllocator::Allocate(size_t size,
     }
   }
   d.dealloc_trace.depth = 0;
-  d.alloc_trace.depth = absl::GetStackTrace(d.alloc_trace.stack, kMaxStackDepth,
-                                            /*skip_count=*/3);
+  if (stack_trace != nullptr) {
+    // Reuse the trace the sampler captured for this allocation; walking the
+    // stack is the dominant cost of a guarded sample, and this also keeps the
+    // reported frames identical to the heap profile's.
+    d.alloc_trace.depth = std::min<size_t>(stack_trace->depth, kMaxStackDepth);
+    memcpy(d.alloc_trace.stack, stack_trace->stack,
+           d.alloc_trace.depth * sizeof(d.alloc_trace.stack[0]));
+  } else {
+    d.alloc_trace.depth = absl::GetStackTrace(
+        d.alloc_trace.stack, kMaxStackDepth, /*skip_count=*/3);
+  }
   d.alloc_trace.thread_id = absl::base_internal::GetTID();
   d.requested_size = size;
   d.allocation_start = reinterpret_cast<uintptr_t>(result);
@@ -203,6 +228,7 @@ GuardedAllocWithStatus GuardedPageAllocator::Allocate(size_t size,
 }
 
 void GuardedPageAllocator::Deallocate(void* ptr) {
+  OverheadTimer timer(*this);
   ASSERT(PointerIsMine(ptr));
   const uintptr_t page_addr = GetPageAddr(reinterpret_cast<uintptr_t>(ptr));
   size_t slot = AddrToSlot(page_addr);
@@ -226,7 +252,7 @@ void GuardedPageAllocator::Deallocate(void* ptr) {
 
   // Record stack trace.
   AllocationGuardSpinLockHolder h(&guarded_page_lock_);
-  GuardedAllocationsStackTrace& trace = data_[slot].dealloc_trace;
+  GuardedAllocationsStackTrace& trace = SlotData(slot).dealloc_trace;
   trace.depth = absl::GetStackTrace(trace.stack, kMaxStackDepth,
                                     /*skip_count=*/2);
   trace.thread_id = absl::base_internal::GetTID();
@@ -237,7 +263,7 @@ void GuardedPageAllocator::Deallocate(void* ptr) {
 size_t GuardedPageAllocator::GetRequestedSize(const void* ptr) const {
   ASSERT(PointerIsMine(ptr));
   size_t slot = AddrToSlot(GetPageAddr(reinterpret_cast<uintptr_t>(ptr)));
-  return data_[slot].requested_size;
+  return SlotData(slot).requested_size;
 }
 
 std::pair<off_t, size_t> GuardedPageAllocator::GetAllocationOffsetAndSize(
@@ -245,7 +271,7 @@ std::pair<off_t, size_t> GuardedPageAllocator::GetAllocationOffsetAndSize(
   ASSERT(PointerIsMine(ptr));
   const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
   const size_t slot = GetNearestSlot(addr);
-  return {addr - data_[slot].allocation_start, data_[slot].requested_size};
+  return {addr - SlotData(slot).allocation_start, SlotData(slot).requested_size};
 }
 
 GuardedAllocationsErrorType GuardedPageAllocator::GetStackTraces(
@@ -254,9 +280,43 @@ GuardedAllocationsErrorType GuardedPageAllocator::GetStackTraces(
   ASSERT(PointerIsMine(ptr));
   const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
   size_t slot = GetNearestSlot(addr);
-  *alloc_trace = &data_[slot].alloc_trace;
-  *dealloc_trace = &data_[slot].dealloc_trace;
-  return GetErrorType(addr, data_[slot]);
+  *alloc_trace = &SlotData(slot).alloc_trace;
+  *dealloc_trace = &SlotData(slot).dealloc_trace;
+  return GetErrorType(addr, SlotData(slot));
+}
+
+void GuardedPageAllocator::AdjustForOverheadBudget(double overhead_fraction) {
+  const int64_t now_cycles = absl::base_internal::CycleClock::Now();
+  const int64_t total_spent = overhead_cycles_.value();
+  const int64_t window_cycles = now_cycles - overhead_window_start_cycles_;
+  const int64_t window_spent = total_spent - overhead_window_start_spent_;
+  const bool first_call = overhead_window_start_cycles_ == 0;
+  overhead_window_start_cycles_ = now_cycles;
+  overhead_window_start_spent_ = total_spent;
+  if (first_call || window_cycles <= 0 || overhead_fraction <= 0) {
+    return;
+  }
+  const int64_t rate = Parameters::guarded_sampling_rate();
+  // rate < 0 disables guarded sampling and rate == 0 guards every sampled
+  // allocation by explicit request; neither is ours to rescale.
+  if (rate <= 0) {
+    return;
+  }
+  const double used_fraction =
+      static_cast<double>(window_spent) / window_cycles;
+  const double scale =
+      std::clamp(used_fraction / overhead_fraction, 0.25, 4.0);
+  // A larger rate means a longer sampling interval, i.e. less overhead.  When
+  // the budget goes unused, scale < 1 shortens the interval again, so the
+  // rate converges to whatever holds the budget rather than ratcheting up.
+  int64_t new_rate = static_cast<int64_t>(rate * scale);
+  // Guarding more often than every profiled sample has no effect; see
+  // TrySample.
+  new_rate = std::max<int64_t>(
+      new_rate, std::max<int64_t>(Parameters::profile_sampling_rate(), 1));
+  if (new_rate != rate) {
+    Parameters::set_guarded_sampling_rate(new_rate);
+  }
 }
 
 // We take guarded samples during periodic profiling samples.  Computes the
@@ -318,15 +378,19 @@ void GuardedPageAllocator::PrintInPbtxt(PbtxtRegion* gwp_asan) {
   gwp_asan->PrintI64("tcmalloc_guarded_sample_parameter", GetChainedRate());
 }
 
-// Maps 2 * total_pages_ + 1 pages so that there are total_pages_ unique pages
-// we can return from Allocate with guard pages before and after them.
+// Maps 2 * kGpaMaxPages + 1 pages so that there are kGpaMaxPages unique pages
+// we can return from Allocate with guard pages before and after them.  The
+// whole reservation is made up front even when the initial pool is smaller --
+// it is PROT_NONE, so it only consumes address space -- which lets GrowPool
+// activate more slots without remapping.  PointerIsMine and the SEGV handler
+// rely on the pool staying a single contiguous range.
 void GuardedPageAllocator::MapPages() {
   AllocationGuardSpinLockHolder h(&guarded_page_lock_);
   ASSERT(!first_page_addr_);
   ASSERT(page_size_ % GetPageSize() == 0);
-  size_t len = (2 * total_pages_ + 1) * page_size_;
+  size_t len = (2 * kGpaMaxPages + 1) * page_size_;
   auto base_addr = reinterpret_cast<uintptr_t>(
-      MmapAligned(len, page_size_, MemoryTag::kSampled));
+      MmapAligned(len, page_size_, MemoryTag::kSampled, "guarded"));
   ASSERT(base_addr);
   if (!base_addr) return;
 
@@ -339,11 +403,7 @@ void GuardedPageAllocator::MapPages() {
   }
 
   // Allocate memory for slot metadata.
-  data_ = reinterpret_cast<SlotMetadata*>(
-      tc_globals.arena().Alloc(sizeof(*data_) * total_pages_));
-  for (size_t i = 0; i < total_pages_; ++i) {
-    new (&data_[i]) SlotMetadata;
-  }
+  EnsureSlotMetadata(total_pages_);
 
   pages_base_addr_ = base_addr;
   pages_end_addr_ = pages_base_addr_ + len;
@@ -351,11 +411,45 @@ void GuardedPageAllocator::MapPages() {
   // Align first page to page_size_.
   first_page_addr_ = GetPageAddr(pages_base_addr_ + page_size_);
 
-  std::fill_n(free_pages_, total_pages_, true);
+  free_pages_.SetRange(0, total_pages_);
+  PushFreeSlots(0, total_pages_);
   initialized_ = true;
 }
 
-// Selects a random slot in O(total_pages_) time.
+void GuardedPageAllocator::EnsureSlotMetadata(size_t total_pages) {
+  TC_ASSERT_LE(total_pages, kGpaMaxPages);
+  const size_t chunks =
+      (total_pages + kPoolGrowthChunkPages - 1) / kPoolGrowthChunkPages;
+  for (size_t c = 0; c < chunks; ++c) {
+    if (data_chunks_[c] != nullptr) continue;
+    data_chunks_[c] = reinterpret_cast<SlotMetadata*>(tc_globals.arena().Alloc(
+        sizeof(SlotMetadata) * kPoolGrowthChunkPages));
+    for (size_t i = 0; i < kPoolGrowthChunkPages; ++i) {
+      new (&data_chunks_[c][i]) SlotMetadata;
+    }
+  }
+}
+
+bool GuardedPageAllocator::GrowPool() {
+  // Arena::Alloc requires pageheap_lock; take it before guarded_page_lock_ to
+  // match the lock order established by Init/MapPages.
+  PageHeapSpinLockHolder l;
+  AllocationGuardSpinLockHolder h(&guarded_page_lock_);
+  if (!initialized_ || total_pages_ == kGpaMaxPages) return false;
+  const size_t new_total_pages =
+      std::min(total_pages_ + kPoolGrowthChunkPages, kGpaMaxPages);
+  EnsureSlotMetadata(new_total_pages);
+  // Scale the allocation limit so the max_alloced_pages/total_pages ratio
+  // passed to Init is preserved as the pool grows.
+  max_alloced_pages_ = new_total_pages * max_alloced_pages_ / total_pages_;
+  free_pages_.SetRange(total_pages_, new_total_pages - total_pages_);
+  PushFreeSlots(total_pages_, new_total_pages);
+  total_pages_ = new_total_pages;
+  return true;
+}
+
+// Selects a random free slot by swap-removing a uniformly random entry of
+// free_slots_, so reservation is O(1) no matter how large the pool is.
 ssize_t GuardedPageAllocator::ReserveFreeSlot() {
   AllocationGuardSpinLockHolder h(&guarded_page_lock_);
   if (!initialized_ || !allow_allocations_) return -1;
@@ -365,10 +459,14 @@ ssize_t GuardedPageAllocator::ReserveFreeSlot() {
   }
   num_successful_allocations_.LossyAdd(1);
 
-  size_t num_free_pages = total_pages_ - num_alloced_pages_;
-  size_t slot = GetIthFreeSlot(Rand(num_free_pages));
-  ASSERT(free_pages_[slot]);
-  free_pages_[slot] = false;
+  TC_ASSERT_EQ(num_free_slots_, total_pages_ - num_alloced_pages_);
+  const size_t i = Rand(num_free_slots_);
+  const size_t slot = free_slots_[i];
+  const uint16_t last = free_slots_[--num_free_slots_];
+  free_slots_[i] = last;
+  slot_pos_[last] = i;
+  ASSERT(free_pages_.GetBit(slot));
+  free_pages_.ClearBit(slot);
   num_alloced_pages_++;
   num_alloced_pages_max_ = std::max(num_alloced_pages_, num_alloced_pages_max_);
   return slot;
@@ -380,20 +478,22 @@ size_t GuardedPageAllocator::Rand(size_t max) {
   return ExponentialBiased::GetRandom(x) % max;
 }
 
-size_t GuardedPageAllocator::GetIthFreeSlot(size_t ith_free_slot) {
-  TC_ASSERT_LT(ith_free_slot, total_pages_ - num_alloced_pages_);
-  for (size_t free_slot_count = 0, j = 0;; j++) {
-    if (free_pages_[j]) {
-      if (free_slot_count == ith_free_slot) return j;
-      free_slot_count++;
-    }
+void GuardedPageAllocator::PushFreeSlots(size_t begin, size_t end) {
+  TC_ASSERT_LE(end, kGpaMaxPages);
+  for (size_t slot = begin; slot < end; ++slot) {
+    free_slots_[num_free_slots_] = slot;
+    slot_pos_[slot] = num_free_slots_;
+    ++num_free_slots_;
   }
 }
 
 void GuardedPageAllocator::FreeSlot(size_t slot) {
   TC_ASSERT_LT(slot, total_pages_);
-  ASSERT(!free_pages_[slot]);
-  free_pages_[slot] = true;
+  ASSERT(!free_pages_.GetBit(slot));
+  free_pages_.SetBit(slot);
+  free_slots_[num_free_slots_] = slot;
+  slot_pos_[slot] = num_free_slots_;
+  ++num_free_slots_;
   num_alloced_pages_--;
 }
 
@@ -425,14 +525,14 @@ size_t GuardedPageAllocator::GetNearestSlot(uintptr_t addr) const {
 }
 
 bool GuardedPageAllocator::IsFreed(size_t slot) const {
-  return free_pages_[slot];
+  return free_pages_.GetBit(slot);
 }
 
 bool GuardedPageAllocator::WriteOverflowOccurred(size_t slot) const {
   if (!ShouldRightAlign(slot)) return false;
   uint8_t magic = GetWriteOverflowMagic(slot);
   uintptr_t alloc_end =
-      data_[slot].allocation_start + data_[slot].requested_size;
+      SlotData(slot).allocation_start + SlotData(slot).requested_size;
   uintptr_t page_end = SlotToAddr(slot) + page_size_;
   uintptr_t magic_end = std::min(page_end, alloc_end + kMagicSize);
   for (uintptr_t p = alloc_end; p < magic_end; ++p) {
@@ -22,6 +22,7 @@
 
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
+#include "absl/base/internal/cycleclock.h"
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/thread_annotations.h"
 #include "tcmalloc/common.h"
@@ -29,6 +30,7 @@
 #include "tcmalloc/internal/atomic_stats_counter.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/range_tracker.h"
 #include "tcmalloc/internal/stacktrace_filter.h"
 #include "tcmalloc/pages.h"
 
@@ -72,13 +74,22 @@ class GuardedPageAllocator {
   // Maximum number of pages this class can allocate.
   static constexpr size_t kGpaMaxPages = 512;
 
+  // Number of pages by which a pool smaller than kGpaMaxPages is extended
+  // when Allocate runs out of slots (see GrowPool).
+  static constexpr size_t kPoolGrowthChunkPages = 128;
+  static_assert(kGpaMaxPages % kPoolGrowthChunkPages == 0,
+                "Slot metadata is allocated in whole chunks");
+
   constexpr GuardedPageAllocator()
       : guarded_page_lock_(absl::kConstInit,
                            absl::base_internal::SCHEDULE_KERNEL_ONLY),
         free_pages_{},
+        free_slots_{},
+        slot_pos_{},
+        num_free_slots_(0),
         num_alloced_pages_(0),
         num_alloced_pages_max_(0),
-        data_(nullptr),
+        data_chunks_{},
         pages_base_addr_(0),
         pages_end_addr_(0),
         first_page_addr_(0),
@@ -88,6 +99,8 @@ class GuardedPageAllocator {
         alloced_page_count_when_all_used_once_(0),
         page_size_(0),
         rand_(0),
+        overhead_window_start_cycles_(0),
+        overhead_window_start_spent_(0),
         initialized_(false),
         allow_allocations_(false),
         double_free_detected_(false),
@@ -102,6 +115,11 @@ class GuardedPageAllocator {
   // time from a pool of total_pages pages, where:
   //   1 <= max_alloced_pages <= total_pages <= kGpaMaxPages
   //
+  // A pool smaller than kGpaMaxPages is only the initial size: when Allocate
+  // runs out of slots, the pool grows in kPoolGrowthChunkPages chunks (with
+  // max_alloced_pages scaled to preserve its ratio to total_pages) until it
+  // reaches kGpaMaxPages.
+  //
   // This method should be called non-concurrently and only once to complete
   // initialization.  Dynamic initialization is deliberately done here and not
   // in the constructor, thereby allowing the constructor to be constexpr and
@@ -122,9 +140,24 @@ class GuardedPageAllocator {
   // allocation Span and guarded status. Otherwise, returns nullptr and the
   // status indicating why the allocation may not be guarded.
   GuardedAllocWithStatus TrySample(size_t size, size_t alignment,
-                                   Length num_pages,
+                                   Length num_pages, size_t size_class,
                                    const StackTrace& stack_trace);
 
+  // Relative guard-sampling weight of a size class; every class starts at 1.
+  // TrySample passes a class with weight w through the guard rate limiter w
+  // times as readily as an unweighted one, and weight 0 exempts the class
+  // from guarding entirely.  Overflow bugs cluster in particular classes, so
+  // weighting those up concentrates the fixed guarded-page budget where the
+  // bugs actually are instead of spreading it evenly over all allocations.
+  void SetGuardWeight(size_t size_class, uint8_t weight) {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    guard_weight_[size_class].store(weight, std::memory_order_relaxed);
+  }
+  uint8_t guard_weight(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return guard_weight_[size_class].load(std::memory_order_relaxed);
+  }
+
   // On success, returns an instance of GuardedAllocWithStatus which includes a
   // pointer to size bytes of page-guarded memory, aligned to alignment.  The
   // member 'alloc' is a pointer that is guaranteed to be tagged.  The 'status'
@@ -135,9 +168,15 @@ class GuardedPageAllocator {
   // reflected in the 'status' member of the GuardedAllocWithStatus return
   // value.
   //
+  // If stack_trace is non-null, its frames are recorded as the allocation
+  // stack instead of walking the stack again here; TrySample passes the trace
+  // the sampler already captured, so a guarded allocation performs a single
+  // stack walk.
+  //
   // Precondition:  size and alignment <= page_size_
   // Precondition:  alignment is 0 or a power of 2
-  GuardedAllocWithStatus Allocate(size_t size, size_t alignment)
+  GuardedAllocWithStatus Allocate(size_t size, size_t alignment,
+                                  const StackTrace* stack_trace = nullptr)
       ABSL_LOCKS_EXCLUDED(guarded_page_lock_);
 
   // Deallocates memory pointed to by ptr.  ptr must have been previously
@@ -178,7 +217,23 @@ class GuardedPageAllocator {
     return pages_base_addr_ <= addr && addr < pages_end_addr_;
   }
 
+  // Returns the address and length of the mapped region the page pool (and
+  // its guard pages) is carved from.
+  std::pair<const void*, size_t> GetPoolRange() const {
+    return {reinterpret_cast<const void*>(pages_base_addr_),
+            pages_end_addr_ - pages_base_addr_};
+  }
+
   // Allows Allocate() to start returning allocations.
+  // Used by the fork handlers to quiesce the allocator across fork(), so the
+  // child does not inherit a held lock.
+  void AcquireInternalLocks() ABSL_EXCLUSIVE_LOCK_FUNCTION(guarded_page_lock_) {
+    guarded_page_lock_.Lock();
+  }
+  void ReleaseInternalLocks() ABSL_UNLOCK_FUNCTION(guarded_page_lock_) {
+    guarded_page_lock_.Unlock();
+  }
+
   void AllowAllocations() ABSL_LOCKS_EXCLUDED(guarded_page_lock_) {
     AllocationGuardSpinLockHolder h(&guarded_page_lock_);
     allow_allocations_ = true;
@@ -193,6 +248,16 @@ class GuardedPageAllocator {
 
   size_t SuccessfulAllocations() { return num_successful_allocations_.value(); }
 
+  // Rescales guarded_sampling_rate so that the fraction of wall-clock time
+  // spent inside Allocate/Deallocate (cycles summed across threads) approaches
+  // overhead_fraction.  The first call only opens the measurement window;
+  // subsequent calls compare the window's spent cycles against the budget and
+  // scale the sampling interval proportionally, clamped so a single noisy
+  // window cannot swing the rate by more than 4x.  Must be called from a
+  // single thread; in production this is the background thread, driven by
+  // Parameters::guarded_sampling_overhead_fraction().
+  void AdjustForOverheadBudget(double overhead_fraction);
+
   // Resets sampling state.
   void Reset();
 
@@ -214,14 +279,24 @@ class GuardedPageAllocator {
   void MapPages() ABSL_LOCKS_EXCLUDED(guarded_page_lock_)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Activates up to kPoolGrowthChunkPages more slots of the reserved mapping,
+  // scaling max_alloced_pages_ proportionally.  Returns true if the pool
+  // grew; returns false once total_pages_ has reached kGpaMaxPages.
+  bool GrowPool() ABSL_LOCKS_EXCLUDED(guarded_page_lock_, pageheap_lock);
+
+  // Allocates and constructs metadata chunks covering slots
+  // [0, total_pages).  Chunks that already exist are kept.
+  void EnsureSlotMetadata(size_t total_pages)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(guarded_page_lock_, pageheap_lock);
+
   // Reserves and returns a slot randomly selected from the free slots in
   // free_pages_.  Returns -1 if no slots available, or if AllowAllocations()
   // hasn't been called yet.
   ssize_t ReserveFreeSlot() ABSL_LOCKS_EXCLUDED(guarded_page_lock_);
 
-  // Returns the i-th free slot of free_pages_.  i must be in the range [0,
-  // total_pages_ - num_alloced_pages_).
-  size_t GetIthFreeSlot(size_t i)
+  // Appends slots [begin, end) to the free-slot index.  Used when the pool
+  // is mapped and each time it grows.
+  void PushFreeSlots(size_t begin, size_t end)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(guarded_page_lock_);
 
   // Marks the specified slot as unreserved.
@@ -265,16 +340,53 @@ class GuardedPageAllocator {
   uintptr_t SlotToAddr(size_t slot) const;
   size_t AddrToSlot(uintptr_t addr) const;
 
+  // Returns the metadata for slot.  The chunk holding slot is guaranteed to
+  // exist by EnsureSlotMetadata before the slot can be reserved.
+  SlotMetadata& SlotData(size_t slot) const {
+    TC_ASSERT_NE(data_chunks_[slot / kPoolGrowthChunkPages], nullptr);
+    return data_chunks_[slot / kPoolGrowthChunkPages]
+                       [slot % kPoolGrowthChunkPages];
+  }
+
   // Returns a random number in range [0, max).
   size_t Rand(size_t max);
 
+  // Accumulates the cycles its enclosing scope spends in guarded allocation
+  // into overhead_cycles_.
+  class OverheadTimer {
+   public:
+    explicit OverheadTimer(GuardedPageAllocator& gpa)
+        : gpa_(gpa), start_(absl::base_internal::CycleClock::Now()) {}
+    ~OverheadTimer() {
+      gpa_.overhead_cycles_.Add(absl::base_internal::CycleClock::Now() -
+                                start_);
+    }
+
+   private:
+    GuardedPageAllocator& gpa_;
+    const int64_t start_;
+  };
+
   StackTraceFilter stacktrace_filter_;
 
   absl::base_internal::SpinLock guarded_page_lock_;
 
-  // Maps each bool to one page.
-  // true: Free.  false: Reserved.
-  bool free_pages_[kGpaMaxPages] ABSL_GUARDED_BY(guarded_page_lock_);
+  // Maps each bit to one page.
+  // Set: Free.  Clear: Reserved.  Only bits below total_pages_ are in use.
+  // The crash handler classifies use-after-free by this bitmap; slot
+  // selection uses the O(1) index below, with the bitmap kept in sync.
+  Bitmap<kGpaMaxPages> free_pages_ ABSL_GUARDED_BY(guarded_page_lock_);
+
+  // O(1) free-slot index.  free_slots_[0, num_free_slots_) holds the free
+  // slots in arbitrary order and slot_pos_[slot] is each free slot's position
+  // in that prefix.  ReserveFreeSlot swap-removes a uniformly random entry
+  // and FreeSlot pushes, so slot selection stays uniformly random at
+  // constant cost regardless of pool size, instead of walking the bitmap.
+  static_assert(kGpaMaxPages < (size_t{1} << 16),
+                "Slot indices are stored as uint16_t");
+  uint16_t free_slots_[kGpaMaxPages] ABSL_GUARDED_BY(guarded_page_lock_);
+  uint16_t slot_pos_[kGpaMaxPages] ABSL_GUARDED_BY(guarded_page_lock_);
+  size_t num_free_slots_ ABSL_GUARDED_BY(guarded_page_lock_);
 
   // Number of currently-allocated pages.
   size_t num_alloced_pages_ ABSL_GUARDED_BY(guarded_page_lock_);
@@ -288,10 +400,11 @@ class GuardedPageAllocator {
   // Number of times Allocate has failed.
   tcmalloc_internal::StatsCounter num_failed_allocations_;
 
-  // A dynamically-allocated array of stack trace data captured when each page
+  // Dynamically-allocated chunks of stack trace data captured when each page
   // is allocated/deallocated.  Printed by the SEGV handler when a memory error
-  // is detected.
-  SlotMetadata* data_;
+  // is detected.  Chunks are allocated lazily as the pool grows; see
+  // EnsureSlotMetadata.
+  SlotMetadata* data_chunks_[kGpaMaxPages / kPoolGrowthChunkPages];
 
   uintptr_t pages_base_addr_;  // Points to start of mapped region.
   uintptr_t pages_end_addr_;   // Points to the end of mapped region.
@@ -307,6 +420,20 @@ class GuardedPageAllocator {
   size_t page_size_;           // Size of pages we allocate.
   std::atomic<uint64_t> rand_;  // RNG seed.
 
+  // Per-size-class guard-sampling weights; Init sets every entry to 1.  See
+  // SetGuardWeight.
+  std::atomic<uint8_t> guard_weight_[kNumClasses] = {};
+
+  // Cycles spent inside Allocate/Deallocate, accumulated by OverheadTimer and
+  // consumed by AdjustForOverheadBudget.
+  tcmalloc_internal::StatsCounter overhead_cycles_;
+
+  // Start of the measurement window opened by the previous call to
+  // AdjustForOverheadBudget: the CycleClock reading and the overhead_cycles_
+  // value at that time.  Only touched by the adjusting thread.
+  int64_t overhead_window_start_cycles_;
+  int64_t overhead_window_start_spent_;
+
   // True if this object has been fully initialized.
   bool initialized_ ABSL_GUARDED_BY(guarded_page_lock_);
 
@@ -264,9 +264,17 @@ TEST_F(GuardedPageAllocatorProfileTest, NoAvailableSlots) {
   });
 
   auto token = MallocExtension::StartAllocationProfiling();
-  // This should  fail for lack of slots
+  // Exhausting the initial slots grows the pool on demand, so keep the
+  // allocations live until the pool reaches its kGpaMaxPages cap and
+  // allocations fail for lack of slots.
   AllocateGuardableUntil(1055, [&](void* alloc) -> NextSteps {
-    return {!Static::guardedpage_allocator().PointerIsMine(alloc), true};
+    if (Static::guardedpage_allocator().PointerIsMine(alloc)) {
+      allocs.emplace_back(alloc,
+                          static_cast<void (*)(void*)>(::operator delete));
+      ResetStackTraceFilter();
+      return {false, false};
+    }
+    return {true, true};
   });
 
   auto profile = std::move(token).Stop();
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <thread>  // NOLINT(build/c++11)
 #include <vector>
@@ -26,6 +27,7 @@
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/page_size.h"
 #include "tcmalloc/internal/sysinfo.h"
+#include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
 #include "tcmalloc/testing/testutil.h"
 
@@ -165,6 +167,52 @@ TEST_P(GuardedPageAllocatorParamTest, AllocDeallocAllPages) {
 INSTANTIATE_TEST_SUITE_P(VaryNumPages, GuardedPageAllocatorParamTest,
                          testing::Values(1, kMaxGpaPages / 2, kMaxGpaPages));
 
+class GuardedPageAllocatorPoolGrowthTest : public testing::Test {
+ protected:
+  // Init's ratio of max_alloced_pages to total_pages is preserved as the pool
+  // grows, so at the kGpaMaxPages cap half the pool may be live at once.
+  static constexpr size_t kInitialMaxAllocedPages = 2;
+  static constexpr size_t kInitialTotalPages = 4;
+
+  GuardedPageAllocatorPoolGrowthTest() {
+    PageHeapSpinLockHolder l;
+    gpa_.Init(kInitialMaxAllocedPages, kInitialTotalPages);
+    gpa_.AllowAllocations();
+  }
+
+  ~GuardedPageAllocatorPoolGrowthTest() override { gpa_.Destroy(); }
+
+  GuardedPageAllocator gpa_;
+};
+
+TEST_F(GuardedPageAllocatorPoolGrowthTest, GrowsOnDemand) {
+  // Exhausting the initial pool grows it on demand instead of failing, until
+  // the ratio-scaled allocation limit reaches kMaxGpaPages / 2.
+  constexpr size_t kFinalMaxAllocedPages = kMaxGpaPages / 2;
+  char* bufs[kFinalMaxAllocedPages];
+  for (size_t i = 0; i < kFinalMaxAllocedPages; i++) {
+    auto alloc_with_status = gpa_.Allocate(1, 0);
+    ASSERT_EQ(alloc_with_status.status,
+              Profile::Sample::GuardedStatus::Guarded);
+    bufs[i] = reinterpret_cast<char*>(alloc_with_status.alloc);
+    ASSERT_NE(bufs[i], nullptr);
+    EXPECT_TRUE(gpa_.PointerIsMine(bufs[i]));
+    bufs[i][0] = 'A';
+  }
+
+  // The pool is capped at kGpaMaxPages, so the next allocation fails.
+  auto alloc_with_status = gpa_.Allocate(1, 0);
+  EXPECT_EQ(alloc_with_status.status,
+            Profile::Sample::GuardedStatus::NoAvailableSlots);
+  EXPECT_EQ(alloc_with_status.alloc, nullptr);
+
+  for (size_t i = 0; i < kFinalMaxAllocedPages; i++) {
+    gpa_.Deallocate(bufs[i]);
+  }
+  alloc_with_status = gpa_.Allocate(1, 0);
+  EXPECT_EQ(alloc_with_status.status, Profile::Sample::GuardedStatus::Guarded);
+}
+
 TEST_F(GuardedPageAllocatorTest, PointerIsMine) {
   auto alloc_with_status = gpa_.Allocate(1, 0);
   EXPECT_EQ(alloc_with_status.status, Profile::Sample::GuardedStatus::Guarded);
@@ -177,6 +225,19 @@ TEST_F(GuardedPageAllocatorTest, PointerIsMine) {
   EXPECT_FALSE(gpa_.PointerIsMine(malloc_ptr.get()));
 }
 
+TEST_F(GuardedPageAllocatorTest, GuardWeightZeroExemptsClass) {
+  constexpr size_t kSizeClass = 1;
+  // Init sets every class to the default weight.
+  EXPECT_EQ(gpa_.guard_weight(kSizeClass), 1);
+
+  gpa_.SetGuardWeight(kSizeClass, 0);
+  StackTrace stack_trace = {};
+  auto alloc_with_status = gpa_.TrySample(/*size=*/8, /*alignment=*/0,
+                                          Length(1), kSizeClass, stack_trace);
+  EXPECT_EQ(alloc_with_status.status, Profile::Sample::GuardedStatus::Filtered);
+  EXPECT_EQ(alloc_with_status.alloc, nullptr);
+}
+
 TEST_F(GuardedPageAllocatorTest, Print) {
   char buf[1024] = {};
   Printer out(buf, sizeof(buf));
@@ -184,6 +245,30 @@ TEST_F(GuardedPageAllocatorTest, Print) {
   EXPECT_THAT(buf, testing::ContainsRegex("GWP-ASan Status"));
 }
 
+TEST_F(GuardedPageAllocatorTest, AdjustForOverheadBudget) {
+  constexpr int64_t kInitialRate = 1 << 20;
+  ScopedGuardedSamplingRate gs(kInitialRate);
+
+  // The first call only opens the measurement window.
+  gpa_.AdjustForOverheadBudget(1e-9);
+  for (int i = 0; i < 100; i++) {
+    auto alloc_with_status = gpa_.Allocate(1, 0);
+    ASSERT_EQ(alloc_with_status.status,
+              Profile::Sample::GuardedStatus::Guarded);
+    gpa_.Deallocate(alloc_with_status.alloc);
+  }
+
+  // The mprotect churn above certainly exceeded a 1e-9 budget, so the
+  // sampling interval grows.
+  gpa_.AdjustForOverheadBudget(1e-9);
+  const int64_t raised_rate = Parameters::guarded_sampling_rate();
+  EXPECT_GT(raised_rate, kInitialRate);
+
+  // With the whole CPU as budget, the interval shrinks again.
+  gpa_.AdjustForOverheadBudget(1.0);
+  EXPECT_LT(Parameters::guarded_sampling_rate(), raised_rate);
+}
+
 // Test that no pages are double-allocated or left unallocated, and that no
 // extra pages are allocated when there's concurrent calls to Allocate().
 TEST_F(GuardedPageAllocatorTest, ThreadedAllocCount) {
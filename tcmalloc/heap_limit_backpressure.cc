@@ -0,0 +1,108 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/heap_limit_backpressure.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// A process sheds at most a handful of caches under memory pressure; a fixed
+// table keeps registration allocation-free.
+constexpr int kMaxHeapLimitCallbacks = 8;
+
+ABSL_CONST_INIT absl::base_internal::SpinLock callback_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+ABSL_CONST_INIT HeapLimitCallback callbacks[kMaxHeapLimitCallbacks]
+    ABSL_GUARDED_BY(callback_lock) = {nullptr};
+
+// The most recent soft limit hit, recorded under pageheap_lock and consumed
+// by the background thread.  NotifySoftLimitExceeded cannot take
+// callback_lock (it runs with pageheap_lock held), so the handoff is three
+// atomics: the event fields are published before the pending flag.
+ABSL_CONST_INIT std::atomic<size_t> pending_backed_bytes{0};
+ABSL_CONST_INIT std::atomic<size_t> pending_soft_limit_bytes{0};
+ABSL_CONST_INIT std::atomic<bool> pending{false};
+
+}  // namespace
+
+int RegisterHeapLimitCallback(HeapLimitCallback callback) {
+  if (callback == nullptr) {
+    return -1;
+  }
+  AllocationGuardSpinLockHolder l(&callback_lock);
+  for (int i = 0; i < kMaxHeapLimitCallbacks; ++i) {
+    if (callbacks[i] != nullptr) {
+      continue;
+    }
+    callbacks[i] = callback;
+    return i;
+  }
+  return -1;
+}
+
+void UnregisterHeapLimitCallback(int handle) {
+  if (handle < 0 || handle >= kMaxHeapLimitCallbacks) {
+    return;
+  }
+  AllocationGuardSpinLockHolder l(&callback_lock);
+  callbacks[handle] = nullptr;
+}
+
+void NotifySoftLimitExceeded(size_t backed_bytes, size_t soft_limit_bytes) {
+  pending_backed_bytes.store(backed_bytes, std::memory_order_relaxed);
+  pending_soft_limit_bytes.store(soft_limit_bytes, std::memory_order_relaxed);
+  pending.store(true, std::memory_order_release);
+}
+
+void CheckHeapLimitBackpressure() {
+  if (!pending.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+
+  HeapLimitEvent event;
+  event.backed_bytes = pending_backed_bytes.load(std::memory_order_relaxed);
+  event.soft_limit_bytes =
+      pending_soft_limit_bytes.load(std::memory_order_relaxed);
+
+  // Copy the table so the callbacks (which may allocate, or call back into
+  // Register/Unregister) run without callback_lock held.
+  HeapLimitCallback to_invoke[kMaxHeapLimitCallbacks];
+  {
+    AllocationGuardSpinLockHolder l(&callback_lock);
+    for (int i = 0; i < kMaxHeapLimitCallbacks; ++i) {
+      to_invoke[i] = callbacks[i];
+    }
+  }
+  for (int i = 0; i < kMaxHeapLimitCallbacks; ++i) {
+    if (to_invoke[i] != nullptr) {
+      to_invoke[i](event);
+    }
+  }
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,70 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Backpressure hooks for the soft heap limit.  Hitting the soft limit
+// (MallocExtension::SetMemoryLimit with LimitKind::kSoft) makes the page
+// allocator shed its own free memory, but the real slack often sits in the
+// application -- an in-process block cache, for instance.  A callback
+// registered here is invoked from the background thread after the soft limit
+// was hit, so the application can shrink its caches while the allocator keeps
+// serving from its reserves; only the hard limit remains fatal.
+
+#ifndef TCMALLOC_HEAP_LIMIT_BACKPRESSURE_H_
+#define TCMALLOC_HEAP_LIMIT_BACKPRESSURE_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Report passed to a backpressure callback.
+struct HeapLimitEvent {
+  // The backed heap size, in bytes, that tripped the soft limit.
+  size_t backed_bytes;
+  // The configured soft limit, in bytes.
+  size_t soft_limit_bytes;
+};
+
+// Invoked on the background thread after an allocation pushed the backed
+// heap past the soft limit.  Allocating (and freeing, which is the point) is
+// safe, but the callback delays all other background actions until it
+// returns.
+using HeapLimitCallback = void (*)(const HeapLimitEvent&);
+
+// Registers callback to be invoked on soft limit hits.  Returns a handle for
+// UnregisterHeapLimitCallback, or -1 if all callback slots are in use.
+int RegisterHeapLimitCallback(HeapLimitCallback callback);
+
+// Cancels the registration returned by RegisterHeapLimitCallback.  Once this
+// returns, the callback may still be in flight on the background thread but
+// will not be invoked again.
+void UnregisterHeapLimitCallback(int handle);
+
+// Records a soft limit hit for the background thread to report.  Called by
+// the page allocator with pageheap_lock held, so this only updates atomics;
+// callbacks run later, from CheckHeapLimitBackpressure.
+void NotifySoftLimitExceeded(size_t backed_bytes, size_t soft_limit_bytes);
+
+// Invokes the registered callbacks if a soft limit hit is pending.  Must
+// only be called from the background thread.
+void CheckHeapLimitBackpressure();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_HEAP_LIMIT_BACKPRESSURE_H_
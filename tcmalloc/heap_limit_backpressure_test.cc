@@ -0,0 +1,75 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/heap_limit_backpressure.h"
+
+#include <stddef.h>
+
+#include "gtest/gtest.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+size_t last_backed = 0;
+size_t last_soft_limit = 0;
+int fire_count = 0;
+
+void RecordEvent(const HeapLimitEvent& event) {
+  last_backed = event.backed_bytes;
+  last_soft_limit = event.soft_limit_bytes;
+  ++fire_count;
+}
+
+TEST(HeapLimitBackpressureTest, RejectsNullCallback) {
+  EXPECT_EQ(RegisterHeapLimitCallback(nullptr), -1);
+}
+
+TEST(HeapLimitBackpressureTest, DeliversPendingEvent) {
+  const int handle = RegisterHeapLimitCallback(RecordEvent);
+  ASSERT_GE(handle, 0);
+
+  // Nothing pending: checking is a no-op.
+  CheckHeapLimitBackpressure();
+  EXPECT_EQ(fire_count, 0);
+
+  NotifySoftLimitExceeded(1 << 30, 1 << 29);
+  CheckHeapLimitBackpressure();
+  ASSERT_EQ(fire_count, 1);
+  EXPECT_EQ(last_backed, size_t{1} << 30);
+  EXPECT_EQ(last_soft_limit, size_t{1} << 29);
+
+  // Consuming the event clears it.
+  CheckHeapLimitBackpressure();
+  EXPECT_EQ(fire_count, 1);
+
+  // Repeated notifications before a check collapse into one delivery,
+  // carrying the most recent values.
+  NotifySoftLimitExceeded(100, 50);
+  NotifySoftLimitExceeded(200, 50);
+  CheckHeapLimitBackpressure();
+  ASSERT_EQ(fire_count, 2);
+  EXPECT_EQ(last_backed, 200);
+
+  UnregisterHeapLimitCallback(handle);
+
+  // Unregistered callbacks are never invoked again.
+  NotifySoftLimitExceeded(300, 50);
+  CheckHeapLimitBackpressure();
+  EXPECT_EQ(fire_count, 2);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -28,6 +28,15 @@ namespace tcmalloc_internal {
 
 // This class wraps an array of N TrackerLists and a Bitmap storing which
 // elements are non-empty.
+//
+// The class imposes no ordering within a list; GetLeast pops whichever
+// tracker is at the front.  Callers that need a best-fit choice get it by
+// encoding the fit key exactly in the list index: HugePageFiller assigns one
+// list per (longest-free-range, quantized-alloc-count) pair, so every
+// tracker in a list shares the same longest free range and the first
+// non-empty list at index >= n is the tightest fit.  Within a list the only
+// order is the one callers impose by choosing Add (front) or AddTail (back)
+// to break ties among equal-fit trackers.
 template <class TrackerType, size_t N>
 class HintedTrackerLists {
  public:
@@ -67,6 +76,31 @@ class HintedTrackerLists {
     return lists_[i].first();
   }
 
+  // Returns the tracker that PeekLeast(n <= i) would yield once <pt> —
+  // currently the first element of the nonempty_[i] list — is removed: its
+  // successor in that list, else the head of the next non-empty list.
+  // Returns nullptr if there is none.  Lets callers that drain trackers one
+  // by one warm the next candidate while working on the current one.
+  // REQUIRES: i < N && pt is the first element of the nonempty_[i] list.
+  TrackerType* PeekSuccessor(TrackerType* pt, const size_t i) {
+    TC_ASSERT_LT(i, N);
+    ASSERT(lists_[i].first() == pt);
+    auto next = lists_[i].at(pt);
+    ++next;
+    if (next != lists_[i].end()) {
+      return *next;
+    }
+    if (i + 1 == N) {
+      return nullptr;
+    }
+    const size_t j = nonempty_.FindSet(i + 1);
+    if (j == N) {
+      return nullptr;
+    }
+    ASSERT(!lists_[j].empty());
+    return lists_[j].first();
+  }
+
   // Adds pointer <pt> to the nonempty_[i] list.
   // REQUIRES: i < N && pt != nullptr.
   void Add(TrackerType* pt, const size_t i) {
@@ -77,6 +111,18 @@ class HintedTrackerLists {
     nonempty_.SetBit(i);
   }
 
+  // Adds pointer <pt> to the back of the nonempty_[i] list, so that GetLeast
+  // prefers every tracker added with Add over it.  Callers use this to bias
+  // which of several equal-fit trackers is handed out first.
+  // REQUIRES: i < N && pt != nullptr.
+  void AddTail(TrackerType* pt, const size_t i) {
+    TC_ASSERT_LT(i, N);
+    TC_ASSERT_NE(pt, nullptr);
+    lists_[i].append(pt);
+    ++size_;
+    nonempty_.SetBit(i);
+  }
+
   // Removes pointer <pt> from the nonempty_[i] list.
   // REQUIRES: i < N && pt != nullptr.
   void Remove(TrackerType* pt, const size_t i) {
@@ -112,24 +112,37 @@ void HugeAddressMap::Check() {
   TC_CHECK_EQ(nodes, nranges());
   TC_CHECK_EQ(size, total_mapped());
   TC_CHECK_EQ(total_nodes_, used_nodes_ + freelist_size_);
+  TC_CHECK_EQ(size_index_.size(), used_nodes_);
 }
 
 size_t HugeAddressMap::nranges() const { return used_nodes_; }
 
 HugeLength HugeAddressMap::total_mapped() const { return total_size_; }
 
+HugeLength HugeAddressMap::longest() const {
+  return root_ ? root_->longest_ : NHugePages(0);
+}
+
+double HugeAddressMap::FragmentationScore() const {
+  const size_t total = total_size_.raw_num();
+  if (total == 0) return 0.0;
+  return 1.0 - static_cast<double>(longest().raw_num()) / total;
+}
+
 void HugeAddressMap::Print(Printer* out) const {
   out->printf("HugeAddressMap: treap %zu / %zu nodes used / created\n",
               used_nodes_, total_nodes_);
-  const size_t longest = root_ ? root_->longest_.raw_num() : 0;
-  out->printf("HugeAddressMap: %zu contiguous hugepages available\n", longest);
+  out->printf("HugeAddressMap: %zu contiguous hugepages available\n",
+              longest().raw_num());
+  out->printf("HugeAddressMap: %.4f fragmentation score\n",
+              FragmentationScore());
 }
 
 void HugeAddressMap::PrintInPbtxt(PbtxtRegion* hpaa) const {
   hpaa->PrintI64("num_huge_address_map_treap_nodes_used", used_nodes_);
   hpaa->PrintI64("num_huge_address_map_treap_nodes_created", total_nodes_);
-  const size_t longest = root_ ? root_->longest_.in_bytes() : 0;
-  hpaa->PrintI64("contiguous_free_bytes", longest);
+  hpaa->PrintI64("contiguous_free_bytes", longest().in_bytes());
+  hpaa->PrintDouble("huge_address_map_fragmentation", FragmentationScore());
 }
 
 HugeAddressMap::Node* HugeAddressMap::Predecessor(HugePage p) {
@@ -168,12 +181,16 @@ void HugeAddressMap::Merge(Node* b, HugeRange r, Node* a) {
   // Two way merges are easy.
   if (a == nullptr) {
     b->when_ = merge_when(b->range_, b->when(), r, when);
+    IndexRemove(b);
     b->range_ = Join(b->range_, r);
+    IndexAdd(b);
     FixLongest(b);
     return;
   } else if (b == nullptr) {
     a->when_ = merge_when(r, when, a->range_, a->when());
+    IndexRemove(a);
     a->range_ = Join(r, a->range_);
+    IndexAdd(a);
     FixLongest(a);
     return;
   }
@@ -188,7 +205,9 @@ void HugeAddressMap::Merge(Node* b, HugeRange r, Node* a) {
   // we actually don't change lengths at all; undo that.
   total_size_ += a->range_.len();
   Remove(a);
+  IndexRemove(b);
   b->range_ = full;
+  IndexAdd(b);
   b->when_ = full_when;
   FixLongest(b);
 }
@@ -216,6 +235,7 @@ void HugeAddressMap::Insert(HugeRange r) {
   TC_CHECK(!after || !r.precedes(after->range_));
   // No merging possible; just add a new node.
   Node* n = Get(r);
+  IndexAdd(n);
   Node* curr = root();
   Node* parent = nullptr;
   Node** link = &root_;
@@ -282,6 +302,7 @@ void HugeAddressMap::FixLongest(HugeAddressMap::Node* n) {
 }
 
 void HugeAddressMap::Remove(HugeAddressMap::Node* n) {
+  IndexRemove(n);
   total_size_ -= n->range_.len();
   // We need to merge the left and right children of n into one
   // treap, then glue it into place wherever n was.
@@ -345,6 +366,26 @@ void HugeAddressMap::Remove(HugeAddressMap::Node* n) {
   Put(n);
 }
 
+HugeAddressMap::Node* HugeAddressMap::FindLeast(HugeLength n) {
+  Node* node = size_index_.PeekLeast(SizeIndexBucket(n));
+  if (node == nullptr) return nullptr;
+  if (SizeIndexBucket(node->range_.len()) < kSizeIndexBuckets - 1) {
+    // Ranges below the last bucket are indexed by their exact length, so the
+    // first non-empty bucket at least n long is the best fit.
+    return node;
+  }
+  // The last bucket collects all longer ranges; scan it for the best fit.  It
+  // is expected to be short, since long free ranges are rare and coalesce.
+  Node* best = nullptr;
+  for (Node* curr : size_index_[kSizeIndexBuckets - 1]) {
+    if (curr->range_.len() < n) continue;
+    if (best == nullptr || curr->range_.len() < best->range_.len()) {
+      best = curr;
+    }
+  }
+  return best;
+}
+
 void HugeAddressMap::Put(Node* n) {
   freelist_size_++;
   used_nodes_--;
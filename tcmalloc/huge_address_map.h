@@ -17,9 +17,13 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <algorithm>
+
 #include "absl/base/attributes.h"
+#include "tcmalloc/hinted_tracker_lists.h"
 #include "tcmalloc/huge_pages.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/linked_list.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/metadata_allocator.h"
 
@@ -43,7 +47,7 @@ class HugeAddressMap {
   // AT FREEING ALLOCATED METADATA.
   ~HugeAddressMap() = default;
 
-  class Node {
+  class Node : public TList<Node>::Elem {
    public:
     // the range stored at this point
     HugeRange range() const;
@@ -95,6 +99,13 @@ class HugeAddressMap {
   // Statistics
   size_t nranges() const;
   HugeLength total_mapped() const;
+  // Length of the longest free range (the root's subtree aggregate, so O(1)).
+  HugeLength longest() const;
+  // Fraction of the mapped hugepages lying outside the longest free range, in
+  // [0, 1]; 0 when the map is empty.  A high score means the free VA has
+  // shattered into many short runs, so large requests will miss here despite
+  // plenty of total free space -- worth alerting on for long-lived processes.
+  double FragmentationScore() const;
   void Print(Printer* out) const;
   void PrintInPbtxt(PbtxtRegion* hpaa) const;
 
@@ -104,7 +115,29 @@ class HugeAddressMap {
   // Delete n from the map.
   void Remove(Node* n);
 
+  // Returns a node whose range is at least <n> long, preferring the shortest
+  // such range (best fit); nullptr if there is none.  Served from a
+  // size-bucketed index of the tree's nodes, so this is a bitmap scan plus a
+  // list peek rather than a tree walk for all but the longest ranges.
+  Node* FindLeast(HugeLength n);
+
  private:
+  // The nodes in the tree, indexed by their range length in hugepages; the
+  // last bucket collects all longer ranges.  Kept up to date through every
+  // insert, remove and merge so that FindLeast is cheap.
+  static constexpr size_t kSizeIndexBuckets = 64;
+  static size_t SizeIndexBucket(HugeLength len) {
+    TC_ASSERT_GE(len, NHugePages(1));
+    return std::min(len.raw_num(), kSizeIndexBuckets - 1);
+  }
+  void IndexAdd(Node* n) {
+    size_index_.Add(n, SizeIndexBucket(n->range_.len()));
+  }
+  void IndexRemove(Node* n) {
+    size_index_.Remove(n, SizeIndexBucket(n->range_.len()));
+  }
+  HintedTrackerLists<Node, kSizeIndexBuckets> size_index_;
+
   // our tree
   Node* root_{nullptr};
   size_t used_nodes_{0};
@@ -68,6 +68,69 @@ TEST_F(HugeAddressMapTest, Merging) {
   EXPECT_THAT(Contents(), testing::ElementsAre(all));
 }
 
+// This test verifies that the size index returns best fits, including across
+// merges and removals.
+TEST_F(HugeAddressMapTest, FindLeast) {
+  EXPECT_EQ(map_.FindLeast(hl(1)), nullptr);
+
+  // Insert disjoint (non-mergeable) ranges of 2, 5 and 100 hugepages; 100
+  // lands in the index's shared last bucket.
+  map_.Insert(HugeRange::Make(hp(0), hl(2)));
+  map_.Insert(HugeRange::Make(hp(10), hl(5)));
+  map_.Insert(HugeRange::Make(hp(100), hl(100)));
+  map_.Check();
+
+  auto* node = map_.FindLeast(hl(1));
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->range().len(), hl(2));
+  node = map_.FindLeast(hl(3));
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->range().len(), hl(5));
+  node = map_.FindLeast(hl(80));
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->range().len(), hl(100));
+  EXPECT_EQ(map_.FindLeast(hl(101)), nullptr);
+
+  // Growing the 2-hugepage range to 6 by merging must reindex it.
+  map_.Insert(HugeRange::Make(hp(2), hl(4)));
+  map_.Check();
+  node = map_.FindLeast(hl(6));
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->range().len(), hl(6));
+
+  // Removal must deindex: the next-best fit is the shared last bucket.
+  map_.Remove(node);
+  map_.Check();
+  node = map_.FindLeast(hl(6));
+  ASSERT_NE(node, nullptr);
+  EXPECT_EQ(node->range().len(), hl(100));
+}
+
+// This test verifies the O(1) aggregate statistics: the longest run tracks
+// inserts, merges and removals, and the fragmentation score reflects how much
+// of the free space lies outside it.
+TEST_F(HugeAddressMapTest, FragmentationScore) {
+  EXPECT_EQ(map_.longest(), hl(0));
+  EXPECT_EQ(map_.FragmentationScore(), 0.0);
+
+  // One contiguous range: no fragmentation.
+  map_.Insert(HugeRange::Make(hp(0), hl(10)));
+  EXPECT_EQ(map_.longest(), hl(10));
+  EXPECT_EQ(map_.FragmentationScore(), 0.0);
+
+  // A second, disjoint range of 30: 10 of 40 hugepages lie outside the
+  // longest run.
+  map_.Insert(HugeRange::Make(hp(100), hl(30)));
+  EXPECT_EQ(map_.longest(), hl(30));
+  EXPECT_DOUBLE_EQ(map_.FragmentationScore(), 0.25);
+
+  // Filling the gap merges everything into one run, erasing fragmentation.
+  map_.Insert(HugeRange::Make(hp(10), hl(90)));
+  map_.Check();
+  EXPECT_EQ(map_.longest(), hl(130));
+  EXPECT_EQ(map_.FragmentationScore(), 0.0);
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
@@ -42,50 +42,12 @@ void HugeAllocator::PrintInPbtxt(PbtxtRegion* hpaa) const {
 }
 
 HugeAddressMap::Node* HugeAllocator::Find(HugeLength n) {
-  HugeAddressMap::Node* curr = free_.root();
-  // invariant: curr != nullptr && curr->longest >= n
-  // we favor smaller gaps and lower nodes and lower addresses, in that
-  // order. The net effect is that we are neither a best-fit nor a
-  // lowest-address allocator but vaguely close to both.
-  HugeAddressMap::Node* best = nullptr;
-  while (curr && curr->longest() >= n) {
-    if (curr->range().len() >= n) {
-      if (!best || best->range().len() > curr->range().len()) {
-        best = curr;
-      }
-    }
-
-    // Either subtree could contain a better fit and we don't want to
-    // search the whole tree. Pick a reasonable child to look at.
-    auto left = curr->left();
-    auto right = curr->right();
-    if (!left || left->longest() < n) {
-      curr = right;
-      continue;
-    }
-
-    if (!right || right->longest() < n) {
-      curr = left;
-      continue;
-    }
-
-    // Here, we have a nontrivial choice.
-    if (left->range().len() == right->range().len()) {
-      if (left->longest() <= right->longest()) {
-        curr = left;
-      } else {
-        curr = right;
-      }
-    } else if (left->range().len() < right->range().len()) {
-      // Here, the longest range in both children is the same...look
-      // in the subtree with the smaller root, as that's slightly
-      // more likely to be our best.
-      curr = left;
-    } else {
-      curr = right;
-    }
-  }
-  return best;
+  // This used to be a heuristic treap descent ("vaguely close" to best fit),
+  // whose cost grew with the depth of the tree as the address space
+  // fragmented.  The map's size index makes strict best fit cheaper than the
+  // approximation was, so just use it: tighter fits also shed fewer
+  // leftover fragments back into the map.
+  return free_.FindLeast(n);
 }
 
 void HugeAllocator::CheckFreelist() {
@@ -158,13 +120,10 @@ void HugeAllocator::Release(HugeRange r) {
 
 void HugeAllocator::AddSpanStats(SmallSpanStats* small,
                                  LargeSpanStats* large) const {
-  for (const HugeAddressMap::Node* node = free_.first(); node != nullptr;
-       node = node->next()) {
-    HugeLength n = node->range().len();
-    if (large != nullptr) {
-      large->spans++;
-      large->returned_pages += n.in_pages();
-    }
+  // The map maintains these totals; no need to walk the tree.
+  if (large != nullptr) {
+    large->spans += free_.nranges();
+    large->returned_pages += free_.total_mapped().in_pages();
   }
 }
 
@@ -75,6 +75,10 @@ class HugeAllocator {
 
   void AddSpanStats(SmallSpanStats* small, LargeSpanStats* large) const;
 
+  // How shattered the free (unbacked) VA tracked here is; see
+  // HugeAddressMap::FragmentationScore.
+  double FragmentationScore() const { return free_.FragmentationScore(); }
+
   BackingStats stats() const {
     BackingStats s;
     s.system_bytes = system().in_bytes();
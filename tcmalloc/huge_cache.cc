@@ -58,6 +58,53 @@ HugeLength MinMaxTracker<kEpochs>::MinOverTime(absl::Duration t) const {
   return m;
 }
 
+template <size_t kEpochs>
+absl::Duration MinMaxTracker<kEpochs>::DominantDemandPeriod() const {
+  // Autocorrelate the per-epoch demand maxima; empty epochs count as zero
+  // demand.  This is O(kEpochs^2) in the worst case, but only runs on the
+  // (background) demand-release path.
+  double series[kEpochs] = {0.0};
+  size_t n = 0;
+  timeseries_.Iter(
+      [&](size_t offset, int64_t ts, const Extrema& e) {
+        if (offset >= kEpochs) return;
+        series[offset] = static_cast<double>(e.max.raw_num());
+        n = std::max(n, offset + 1);
+      },
+      timeseries_.kSkipEmptyEntries);
+  // Too little history to distinguish a period from noise.
+  if (n < 8) return absl::ZeroDuration();
+
+  double mean = 0;
+  for (size_t i = 0; i < n; ++i) mean += series[i];
+  mean /= n;
+  double variance = 0;
+  for (size_t i = 0; i < n; ++i) {
+    series[i] -= mean;
+    variance += series[i] * series[i];
+  }
+  variance /= n;
+  if (variance == 0) return absl::ZeroDuration();
+
+  size_t best_lag = 0;
+  double best_r = 0;
+  for (size_t lag = 2; lag <= n / 2; ++lag) {
+    double sum = 0;
+    for (size_t i = 0; i + lag < n; ++i) {
+      sum += series[i] * series[i + lag];
+    }
+    const double r = sum / ((n - lag) * variance);
+    if (r > best_r) {
+      best_r = r;
+      best_lag = lag;
+    }
+  }
+  // Require a pronounced correlation before declaring the demand periodic;
+  // weakly periodic histories fall back to the interval-based prediction.
+  if (best_lag == 0 || best_r < 0.5) return absl::ZeroDuration();
+  return best_lag * kEpochLength;
+}
+
 template <size_t kEpochs>
 void MinMaxTracker<kEpochs>::Print(Printer* out) const {
   // Prints timestamp:min_pages:max_pages for each window with records.
@@ -264,6 +311,10 @@ HugeLength HugeCache::MaybeShrinkCacheLimit() {
 
 HugeLength HugeCache::ShrinkCache(HugeLength target) {
   HugeLength removed = NHugePages(0);
+  // Nodes set aside because they overlap a pinned registration; reinserted
+  // after the loop so Find does not keep handing them back to us.
+  HugeRange set_aside[kMaxUnreleasableRanges];
+  int n_set_aside = 0;
   while (size_ > target) {
     // Remove smallest-ish nodes, to avoid fragmentation where possible.
     auto* node = Find(NHugePages(1));
@@ -285,6 +336,19 @@ HugeLength HugeCache::ShrinkCache(HugeLength target) {
     }
 
     size_ -= r.len();
+    if (Unreleasable(r)) {
+      // The range overlaps a kernel-pinned registration and must stay
+      // backed.  We do not split around the pin: registrations are rare and
+      // typically hugepage-granular, so the simplicity is worth the
+      // occasional extra retained hugepage.
+      if (n_set_aside == kMaxUnreleasableRanges) {
+        size_ += r.len();
+        cache_.Insert(r);
+        break;
+      }
+      set_aside[n_set_aside++] = r;
+      continue;
+    }
     // Note, actual unback implementation is temporarily dropping and
     // re-acquiring the page heap lock here.
     if (ABSL_PREDICT_FALSE(!unback_(r.start_addr(), r.byte_len()))) {
@@ -298,6 +362,11 @@ HugeLength HugeCache::ShrinkCache(HugeLength target) {
     removed += r.len();
   }
 
+  for (int i = 0; i < n_set_aside; ++i) {
+    size_ += set_aside[i].len();
+    cache_.Insert(set_aside[i]);
+  }
+
   return removed;
 }
 
@@ -316,6 +385,126 @@ HugeLength HugeCache::ReleaseCachedPages(HugeLength n) {
   return released;
 }
 
+HugeLength HugeCache::PredictedDemand(absl::Duration short_interval,
+                                      absl::Duration long_interval) {
+  // The detailed tracker holds 10 minutes of history at 1s granularity.
+  constexpr absl::Duration kHistory = absl::Minutes(10);
+  const HugeLength peak = detailed_tracker_.MaxOverTime(kHistory);
+  if (peak == NHugePages(0)) return peak;
+
+  // Mirrors SubreleaseStatsTracker::GetRecentDemand: the recent short-term
+  // fluctuation on top of the long-term trend.
+  const HugeLength short_min = detailed_tracker_.MinOverTime(short_interval);
+  const HugeLength short_max = detailed_tracker_.MaxOverTime(short_interval);
+  const HugeLength fluctuation =
+      short_max > short_min ? short_max - short_min : NHugePages(0);
+  HugeLength trend = detailed_tracker_.MinOverTime(long_interval);
+  // MinOverTime saturates when the interval holds no epochs.
+  if (trend > peak) trend = peak;
+  HugeLength required = fluctuation + trend;
+
+  // Interval-based prediction misfires on periodic demand: right after a
+  // peak, the short interval sees only the trough, so the cache is released
+  // and then refaulted at the next peak.  When the history autocorrelates,
+  // keep the full peak over one period instead.
+  const absl::Duration period = detailed_tracker_.DominantDemandPeriod();
+  if (period != absl::ZeroDuration()) {
+    ++periodic_demand_detections_;
+    required = std::max(required, detailed_tracker_.MaxOverTime(period));
+  }
+
+  // The sum of peaks can exceed any demand actually observed; cap it.
+  return std::min(required, peak);
+}
+
+HugeLength HugeCache::ReleaseCachedPagesByDemand(HugeLength n,
+                                                 absl::Duration short_interval,
+                                                 absl::Duration long_interval) {
+  if (short_interval == absl::ZeroDuration() &&
+      long_interval == absl::ZeroDuration()) {
+    return ReleaseCachedPages(n);
+  }
+  ++demand_release_requests_;
+
+  const HugeLength required = PredictedDemand(short_interval, long_interval);
+  const HugeLength backed = usage_ + size_;
+  const HugeLength releasable =
+      backed > required ? std::min(size_, backed - required) : NHugePages(0);
+  const HugeLength target = std::min(n, releasable);
+  if (target < n) {
+    ++demand_release_skipped_;
+    demand_release_skipped_pages_ += n - target;
+  }
+  if (target == NHugePages(0)) {
+    UpdateSize(size());
+    return target;
+  }
+  // Unlike ReleaseCachedPages, leave the cache limit alone: the demand
+  // prediction, not MaybeShrinkCacheLimit's usage heuristic, decides how
+  // much stays backed here.
+  const HugeLength released = ShrinkCache(size() - target);
+  UpdateSize(size());
+  total_periodic_unbacked_ += released;
+  return released;
+}
+
+void HugeCache::MarkUnreleasable(HugeRange r, bool unreleasable) {
+  if (!r.valid()) return;
+  if (unreleasable) {
+    for (int i = 0; i < n_unreleasable_ranges_; ++i) {
+      if (unreleasable_ranges_[i].start() == r.start()) {
+        unreleasable_ranges_[i] = r;
+        return;
+      }
+    }
+    // Pinned registrations are rare and long-lived; if somebody exceeds the
+    // table we simply stop protecting the excess rather than grow it.
+    if (n_unreleasable_ranges_ < kMaxUnreleasableRanges) {
+      unreleasable_ranges_[n_unreleasable_ranges_++] = r;
+    }
+    return;
+  }
+  for (int i = 0; i < n_unreleasable_ranges_; ++i) {
+    if (unreleasable_ranges_[i].start() == r.start()) {
+      unreleasable_ranges_[i] = unreleasable_ranges_[--n_unreleasable_ranges_];
+      return;
+    }
+  }
+}
+
+bool HugeCache::Unreleasable(HugeRange r) const {
+  for (int i = 0; i < n_unreleasable_ranges_; ++i) {
+    if (r.intersects(unreleasable_ranges_[i])) return true;
+  }
+  return false;
+}
+
+HugeCacheState HugeCache::ExtractState() const {
+  HugeCacheState state;
+  state.limit = limit();
+  state.usage_max = usage_tracker_.MaxOverTime(kCacheTime * 2);
+  // An empty tracker reports its sentinel maximum as the minimum; clamp so a
+  // serialized snapshot always has usage_min <= usage_max.
+  state.usage_min =
+      std::min(usage_tracker_.MinOverTime(kCacheTime * 2), state.usage_max);
+  return state;
+}
+
+void HugeCache::SeedState(const HugeCacheState& state) {
+  // Trust the previous process's limit no further than the demand it actually
+  // recorded: cap at the peak plus the same 10% fragmentation slack
+  // MaybeGrowCacheLimit adds.  Never lower the limit--if this process has
+  // already learned it needs a bigger cache, believe it.
+  const HugeLength cap = state.usage_max + state.usage_max / 10;
+  const HugeLength seeded = std::min(state.limit, cap);
+  if (seeded <= limit()) return;
+  // Start the hysteresis clock now, so MaybeShrinkCacheLimit gives the seeded
+  // limit the same 2 * kCacheTime grace period a learned expansion gets
+  // before reversing it.
+  last_limit_change_ = clock_.now();
+  limit_ = seeded;
+}
+
 void HugeCache::AddSpanStats(SmallSpanStats* small,
                              LargeSpanStats* large) const {
   static_assert(kPagesPerHugePage >= kMaxPages);
@@ -329,51 +518,23 @@ void HugeCache::AddSpanStats(SmallSpanStats* small,
   }
 }
 
-HugeAddressMap::Node* HugeCache::Find(HugeLength n) {
-  HugeAddressMap::Node* curr = cache_.root();
-  // invariant: curr != nullptr && curr->longest >= n
-  // we favor smaller gaps and lower nodes and lower addresses, in that
-  // order. The net effect is that we are neither a best-fit nor a
-  // lowest-address allocator but vaguely close to both.
-  HugeAddressMap::Node* best = nullptr;
-  while (curr && curr->longest() >= n) {
-    if (curr->range().len() >= n) {
-      if (!best || best->range().len() > curr->range().len()) {
-        best = curr;
-      }
-    }
-
-    // Either subtree could contain a better fit and we don't want to
-    // search the whole tree. Pick a reasonable child to look at.
-    auto left = curr->left();
-    auto right = curr->right();
-    if (!left || left->longest() < n) {
-      curr = right;
-      continue;
-    }
-
-    if (!right || right->longest() < n) {
-      curr = left;
-      continue;
-    }
-
-    // Here, we have a nontrivial choice.
-    if (left->range().len() == right->range().len()) {
-      if (left->longest() <= right->longest()) {
-        curr = left;
-      } else {
-        curr = right;
-      }
-    } else if (left->range().len() < right->range().len()) {
-      // Here, the longest range in both children is the same...look
-      // in the subtree with the smaller root, as that's slightly
-      // more likely to be our best.
-      curr = left;
-    } else {
-      curr = right;
+size_t HugeCache::GetRanges(HugeRange* ranges, size_t max) const {
+  size_t total = 0;
+  for (const HugeAddressMap::Node* node = cache_.first(); node != nullptr;
+       node = node->next()) {
+    if (total < max) {
+      ranges[total] = node->range();
     }
+    total++;
   }
-  return best;
+  return total;
+}
+
+HugeAddressMap::Node* HugeCache::Find(HugeLength n) {
+  // The map's size index turns best-fit selection into a bitmap scan plus a
+  // list peek, keeping pageheap_lock hold times flat as the cache grows; the
+  // tree-walk heuristic this replaces was only approximately best-fit.
+  return cache_.FindLeast(n);
 }
 
 void HugeCache::Print(Printer* out) {
@@ -399,6 +560,11 @@ void HugeCache::Print(Printer* out) {
   out->printf("HugeCache: %zu MiB fast unbacked, %zu MiB periodic\n",
               total_fast_unbacked_.in_bytes() / 1024 / 1024,
               total_periodic_unbacked_.in_bytes() / 1024 / 1024);
+  out->printf(
+      "HugeCache: demand-based release: %zu requests, %zu short of target "
+      "(%zu hugepages kept), %zu periodic demand detections\n",
+      demand_release_requests_, demand_release_skipped_,
+      demand_release_skipped_pages_.raw_num(), periodic_demand_detections_);
   UpdateSize(size());
   out->printf(
       "HugeCache: %zu MiB*s cached since startup\n",
@@ -455,6 +621,12 @@ void HugeCache::PrintInPbtxt(PbtxtRegion* hpaa) {
   // bytes unbacked by periodic releaser thread
   hpaa->PrintI64("periodic_unbacked_bytes",
                  total_periodic_unbacked_.in_bytes());
+  // demand-based release decisions
+  hpaa->PrintI64("demand_release_requests", demand_release_requests_);
+  hpaa->PrintI64("demand_release_skipped", demand_release_skipped_);
+  hpaa->PrintI64("demand_release_skipped_bytes",
+                 demand_release_skipped_pages_.in_bytes());
+  hpaa->PrintI64("periodic_demand_detections", periodic_demand_detections_);
   UpdateSize(size());
   // memory cached since startup (in MiB*s)
   hpaa->PrintI64("huge_cache_regret", NHugePages(regret_).in_mib() /
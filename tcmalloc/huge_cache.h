@@ -25,6 +25,7 @@
 #include "absl/base/attributes.h"
 #include "absl/base/internal/cycleclock.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/huge_address_map.h"
 #include "tcmalloc/huge_allocator.h"
 #include "tcmalloc/huge_pages.h"
@@ -34,6 +35,7 @@
 #include "tcmalloc/internal/timeseries_tracker.h"
 #include "tcmalloc/metadata_allocator.h"
 #include "tcmalloc/stats.h"
+#include "tcmalloc/system-alloc.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
@@ -44,6 +46,21 @@ class MemoryModifyFunction {
   virtual ~MemoryModifyFunction() = default;
 
   ABSL_MUST_USE_RESULT virtual bool operator()(void* start, size_t len) = 0;
+
+  // Batched form of operator(), applying the modification to every range in
+  // ranges.  Records per-range success in ok, which must hold ranges.size()
+  // entries, and returns the number of ranges that succeeded.  The default
+  // implementation loops over operator(); implementations backed by the
+  // system allocator override it so a fragmented release is issued as one
+  // submission batch rather than one syscall per range.
+  virtual size_t ModifyMany(absl::Span<const AddressRange> ranges, bool* ok) {
+    size_t successes = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      ok[i] = (*this)(ranges[i].ptr, ranges[i].bytes);
+      successes += ok[i] ? 1 : 0;
+    }
+    return successes;
+  }
 };
 
 // Track the extreme values of a HugeLength value over the past
@@ -63,6 +80,12 @@ class MinMaxTracker {
   HugeLength MaxOverTime(absl::Duration t) const;
   HugeLength MinOverTime(absl::Duration t) const;
 
+  // Estimates the dominant period of the tracked value by autocorrelating
+  // the per-epoch maxima, for workloads with periodic demand (a checkpoint
+  // every minute, say).  Returns the period, with kEpochLength granularity,
+  // or ZeroDuration when the history shows no pronounced periodicity.
+  absl::Duration DominantDemandPeriod() const;
+
  private:
   const absl::Duration kEpochLength;
 
@@ -98,6 +121,17 @@ extern template class MinMaxTracker<600>;
 template <size_t kEpochs>
 constexpr HugeLength MinMaxTracker<kEpochs>::kMaxVal;
 
+// Summary of the sizing state a HugeCache has learned from its demand
+// history, for preservation across a process restart.  Only the learned
+// conclusions are captured (the cache limit and the recent usage extrema);
+// the raw timeseries is relative to this process's clock and has no meaning
+// in another one.
+struct HugeCacheState {
+  HugeLength limit;
+  HugeLength usage_min;
+  HugeLength usage_max;
+};
+
 class HugeCache {
  public:
   // For use in production
@@ -166,6 +200,25 @@ class HugeCache {
   // the number of hugepages released.
   HugeLength ReleaseCachedPages(HugeLength n);
 
+  // As ReleaseCachedPages, but demand-aware: keeps enough backed memory to
+  // cover the demand predicted from the usage history, releasing only the
+  // excess.  The prediction is the short_interval demand fluctuation on top
+  // of the long_interval trend (mirroring the filler's skip-subrelease
+  // policy), raised to the full peak over one demand period when the history
+  // shows periodic demand.  With both intervals zero, behaves exactly like
+  // ReleaseCachedPages.
+  HugeLength ReleaseCachedPagesByDemand(HugeLength n,
+                                        absl::Duration short_interval,
+                                        absl::Duration long_interval);
+
+  // Records (or, with <unreleasable> false, forgets) a range registered via
+  // MallocExtension::MarkUnreleasable.  ShrinkCache keeps cached ranges
+  // overlapping a recorded range backed: the memory is pinned with the
+  // kernel (an RDMA memory region or io_uring fixed buffer), so unbacking
+  // it would COW-break the pin.  At most kMaxUnreleasableRanges ranges are
+  // tracked; registrations beyond that are ignored.
+  void MarkUnreleasable(HugeRange r, bool unreleasable);
+
   // Backed memory available.
   HugeLength size() const { return size_; }
   // Total memory cached (in HugeLength * nanoseconds)
@@ -177,6 +230,11 @@ class HugeCache {
 
   void AddSpanStats(SmallSpanStats* small, LargeSpanStats* large) const;
 
+  // Copies up to <max> of the address ranges currently held in the cache into
+  // <ranges>.  Returns the total number of ranges held; only
+  // std::min(total, max) entries of <ranges> are written.
+  size_t GetRanges(HugeRange* ranges, size_t max) const;
+
   BackingStats stats() const {
     BackingStats s;
     s.system_bytes = (usage() + size()).in_bytes();
@@ -185,6 +243,17 @@ class HugeCache {
     return s;
   }
 
+  // Returns a summary of the sizing state learned from the demand history,
+  // suitable for feeding to SeedState() in a later process.
+  HugeCacheState ExtractState() const;
+
+  // Seeds the learned sizing state from a snapshot taken by a previous
+  // process, so a restarted process sizes its cache for the previous
+  // process's demand immediately instead of re-learning over kCacheTime
+  // windows.  Only ever raises the limit, and trusts the snapshot's limit no
+  // further than the peak demand recorded alongside it.
+  void SeedState(const HugeCacheState& state);
+
   void Print(Printer* out);
   void PrintInPbtxt(PbtxtRegion* hpaa);
 
@@ -206,6 +275,25 @@ class HugeCache {
 
   HugeAddressMap::Node* Find(HugeLength n);
 
+  // The demand ReleaseCachedPagesByDemand must preserve, computed from the
+  // detailed usage history with the given intervals.  Increments
+  // periodic_demand_detections_ when the history shows periodic demand.
+  HugeLength PredictedDemand(absl::Duration short_interval,
+                             absl::Duration long_interval);
+
+  // Decision counters for ReleaseCachedPagesByDemand, for stats only.
+  size_t demand_release_requests_{0};
+  size_t demand_release_skipped_{0};
+  HugeLength demand_release_skipped_pages_{NHugePages(0)};
+  size_t periodic_demand_detections_{0};
+
+  // True iff <r> overlaps a range recorded by MarkUnreleasable.
+  bool Unreleasable(HugeRange r) const;
+
+  static constexpr int kMaxUnreleasableRanges = 16;
+  HugeRange unreleasable_ranges_[kMaxUnreleasableRanges] = {};
+  int n_unreleasable_ranges_{0};
+
   HugeAddressMap cache_;
   HugeLength size_{NHugePages(0)};
 
@@ -90,6 +90,12 @@ class HugeCacheTest : public testing::Test {
   HugeAllocator alloc_{vm_allocator_, metadata_allocator_};
   HugeCache cache_{&alloc_, metadata_allocator_, mock_unback_,
                    Clock{.now = GetClock, .freq = GetClockFrequency}};
+
+  // A second, independent cache, standing in for a restarted process in the
+  // state preservation tests.
+  HugeAllocator alloc2_{vm_allocator_, metadata_allocator_};
+  HugeCache cache2_{&alloc2_, metadata_allocator_, mock_unback_,
+                    Clock{.now = GetClock, .freq = GetClockFrequency}};
 };
 
 int64_t HugeCacheTest::clock_offset_ = 0;
@@ -203,6 +209,80 @@ TEST_F(HugeCacheTest, ReleaseFailure) {
   EXPECT_EQ(NHugePages(0), cache_.ReleaseCachedPages(NHugePages(200)));
 }
 
+TEST_F(HugeCacheTest, ReleaseByDemandZeroIntervals) {
+  // With both intervals zero, demand-based release degenerates to the plain
+  // policy.
+  bool from;
+  cache_.Release(cache_.Get(NHugePages(5), &from));
+  ASSERT_EQ(NHugePages(5), cache_.size());
+
+  EXPECT_CALL(mock_unback_, Unback(testing::_, testing::_))
+      .WillRepeatedly(Return(true));
+  EXPECT_EQ(NHugePages(5),
+            cache_.ReleaseCachedPagesByDemand(
+                NHugePages(200), absl::ZeroDuration(), absl::ZeroDuration()));
+  EXPECT_EQ(NHugePages(0), cache_.size());
+}
+
+TEST_F(HugeCacheTest, ReleaseByDemandRetainsRecentPeak) {
+  bool from;
+  cache_.Release(cache_.Get(NHugePages(5), &from));
+  ASSERT_EQ(NHugePages(5), cache_.size());
+  EXPECT_CALL(mock_unback_, Unback(testing::_, testing::_))
+      .WillRepeatedly(Return(true));
+
+  // Demand hit five hugepages within the short interval, so nothing may be
+  // released, however large the request.
+  EXPECT_EQ(NHugePages(0),
+            cache_.ReleaseCachedPagesByDemand(
+                NHugePages(200), absl::Seconds(10), absl::Seconds(120)));
+  EXPECT_EQ(NHugePages(5), cache_.size());
+
+  // Once the spike ages out of the demand history, the cache is retained only
+  // up to the (now much lower) predicted demand.
+  Advance(absl::Minutes(11));
+  cache_.Release(cache_.Get(NHugePages(1), &from));
+  EXPECT_EQ(NHugePages(4),
+            cache_.ReleaseCachedPagesByDemand(
+                NHugePages(200), absl::Seconds(10), absl::Seconds(120)));
+  EXPECT_EQ(NHugePages(1), cache_.size());
+}
+
+TEST_F(HugeCacheTest, ReleaseSkipsUnreleasable) {
+  bool from;
+  const HugeLength one = NHugePages(1);
+  cache_.Release(cache_.Get(NHugePages(5), &from));
+  HugeRange r1 = cache_.Get(one, &from);
+  HugeRange r2 = cache_.Get(one, &from);
+  HugeRange r3 = cache_.Get(one, &from);
+  HugeRange r4 = cache_.Get(one, &from);
+  HugeRange r5 = cache_.Get(one, &from);
+  // Keep r2 and r4 allocated so the cached ranges cannot merge.
+  cache_.Release(r1);
+  cache_.Release(r3);
+  cache_.Release(r5);
+  ASSERT_EQ(NHugePages(3), cache_.size());
+
+  // Pin r1 and r3 (say, registered as RDMA memory regions that outlive the
+  // allocation); only r5 may be unbacked.
+  cache_.MarkUnreleasable(r1, true);
+  cache_.MarkUnreleasable(r3, true);
+  EXPECT_CALL(mock_unback_, Unback(r5.start_addr(), 1 * kHugePageSize))
+      .WillOnce(Return(true));
+  EXPECT_EQ(NHugePages(1), cache_.ReleaseCachedPages(NHugePages(200)));
+  EXPECT_EQ(NHugePages(2), cache_.size());
+
+  // Deregistering the pins makes the ranges releasable again.
+  cache_.MarkUnreleasable(r1, false);
+  cache_.MarkUnreleasable(r3, false);
+  EXPECT_CALL(mock_unback_, Unback(r1.start_addr(), 1 * kHugePageSize))
+      .WillOnce(Return(true));
+  EXPECT_CALL(mock_unback_, Unback(r3.start_addr(), 1 * kHugePageSize))
+      .WillOnce(Return(true));
+  EXPECT_EQ(NHugePages(2), cache_.ReleaseCachedPages(NHugePages(200)));
+  EXPECT_EQ(NHugePages(0), cache_.size());
+}
+
 TEST_F(HugeCacheTest, Regret) {
   bool from;
   HugeRange r = cache_.Get(NHugePages(20), &from);
@@ -487,6 +567,72 @@ TEST_F(HugeCacheTest, Usage) {
   EXPECT_EQ(NHugePages(0), cache_.usage());
 }
 
+TEST_F(HugeCacheTest, ExtractStateReflectsDemand) {
+  bool from;
+  HugeRange r = cache_.Get(NHugePages(8), &from);
+  HugeCacheState state = cache_.ExtractState();
+  EXPECT_EQ(cache_.limit(), state.limit);
+  EXPECT_EQ(NHugePages(8), state.usage_max);
+  EXPECT_LE(state.usage_min, state.usage_max);
+  cache_.Release(r);
+}
+
+TEST_F(HugeCacheTest, SeedStateSizesCache) {
+  HugeCacheState state;
+  state.limit = NHugePages(100);
+  state.usage_min = NHugePages(0);
+  state.usage_max = NHugePages(100);
+  cache_.SeedState(state);
+  EXPECT_EQ(NHugePages(100), cache_.limit());
+
+  // A burst up to the seeded limit is retained and served back without
+  // re-backing, as if the limit had been learned in this process.
+  bool from;
+  HugeRange r = cache_.Get(NHugePages(80), &from);
+  EXPECT_TRUE(from);
+  cache_.Release(r);
+  r = cache_.Get(NHugePages(80), &from);
+  EXPECT_FALSE(from);
+  cache_.Release(r);
+}
+
+TEST_F(HugeCacheTest, SeedStateTrustsLimitOnlyUpToRecordedDemand) {
+  HugeCacheState state;
+  state.limit = NHugePages(1000);
+  state.usage_min = NHugePages(0);
+  state.usage_max = NHugePages(50);
+  cache_.SeedState(state);
+  // Capped at the recorded peak plus the usual 10% slack.
+  EXPECT_EQ(NHugePages(55), cache_.limit());
+}
+
+TEST_F(HugeCacheTest, SeedStateNeverShrinks) {
+  const HugeLength before = cache_.limit();
+  HugeCacheState state;
+  state.limit = NHugePages(2);
+  state.usage_min = NHugePages(0);
+  state.usage_max = NHugePages(2);
+  cache_.SeedState(state);
+  EXPECT_EQ(before, cache_.limit());
+}
+
+TEST_F(HugeCacheTest, StateRoundTrip) {
+  // Teach the first cache a large limit, and record demand backing it up.
+  HugeCacheState state;
+  state.limit = NHugePages(60);
+  state.usage_min = NHugePages(0);
+  state.usage_max = NHugePages(60);
+  cache_.SeedState(state);
+  bool from;
+  HugeRange r = cache_.Get(NHugePages(60), &from);
+  HugeCacheState exported = cache_.ExtractState();
+  cache_.Release(r);
+
+  // The "restarted" cache adopts the exported limit wholesale.
+  cache2_.SeedState(exported);
+  EXPECT_EQ(cache_.limit(), cache2_.limit());
+}
+
 class MinMaxTrackerTest : public testing::Test {
  protected:
   void Advance(absl::Duration d) {
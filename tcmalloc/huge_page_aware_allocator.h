@@ -16,12 +16,17 @@
 #define TCMALLOC_HUGE_PAGE_AWARE_ALLOCATOR_H_
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <optional>
 
 #include "absl/base/attributes.h"
 #include "absl/base/internal/cycleclock.h"
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/central_freelist.h"
 #include "tcmalloc/common.h"
@@ -32,8 +37,10 @@
 #include "tcmalloc/huge_region.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/linked_list.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/prefetch.h"
+#include "tcmalloc/lifetime_prediction.h"
 #include "tcmalloc/metadata_allocator.h"
 #include "tcmalloc/page_allocator_interface.h"
 #include "tcmalloc/page_heap_allocator.h"
@@ -71,6 +78,16 @@ class StaticForwarder {
     return Parameters::filler_skip_subrelease_long_interval();
   }
 
+  static bool huge_cache_demand_based_release() {
+    return Parameters::huge_cache_demand_based_release();
+  }
+  static absl::Duration cache_demand_release_short_interval() {
+    return Parameters::cache_demand_release_short_interval();
+  }
+  static absl::Duration cache_demand_release_long_interval() {
+    return Parameters::cache_demand_release_long_interval();
+  }
+
   static bool release_partial_alloc_pages() {
     return Parameters::release_partial_alloc_pages();
   }
@@ -104,12 +121,16 @@ class StaticForwarder {
 
   // SystemAlloc state.
   static AddressRange AllocatePages(size_t bytes, size_t align, MemoryTag tag) {
-    return SystemAlloc(bytes, align, tag);
+    return SystemAlloc(bytes, align, tag, "hugepage");
   }
   // TODO(ckennelly): Accept PageId/Length.
   static bool ReleasePages(void* ptr, size_t size) {
     return SystemRelease(ptr, size);
   }
+  static size_t ReleaseRanges(absl::Span<const AddressRange> ranges,
+                              bool* ok) {
+    return SystemReleaseRanges(ranges, ok);
+  }
 };
 
 struct HugePageAwareAllocatorOptions {
@@ -178,6 +199,79 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
   Length ReleaseAtLeastNPagesBreakingHugepages(Length n)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  Length GetRecentDemandPeak(absl::Duration interval)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override {
+    return filler_.GetRecentDemandPeak(interval);
+  }
+
+  // Returns the pages in use on the filler-managed hugepage containing <p>,
+  // or std::nullopt when the hugepage is not filler-managed (a large or
+  // region-backed allocation, or a hugepage still donated by a large
+  // allocation's tail).
+  std::optional<Length> FillerUsedPagesContaining(PageId p)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override {
+    FillerType::Tracker* pt = GetTracker(HugePageContaining(p));
+    if (pt == nullptr || pt->donated()) {
+      return std::nullopt;
+    }
+    return pt->used_pages();
+  }
+
+  // Stores the background idle scan's coldness score on the tracker of the
+  // filler-managed hugepage containing <p>; ignored for hugepages the filler
+  // does not manage.  See PageTracker::idle_score().
+  void SetFillerIdleScoreContaining(PageId p, uint8_t score)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override {
+    FillerType::Tracker* pt = GetTracker(HugePageContaining(p));
+    if (pt == nullptr || pt->donated()) {
+      return;
+    }
+    pt->set_idle_score(score);
+  }
+
+  // Copies the layout of the filler-managed hugepage containing <p> --
+  // tracker flags and allocated/free/released page runs -- into <layout>.
+  // Returns false when the filler does not track that hugepage (large,
+  // region-backed, or cache-resident memory).
+  bool GetFillerLayoutContaining(PageId p, FillerHugePageLayout* layout)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    FillerType::Tracker* pt = GetTracker(HugePageContaining(p));
+    if (pt == nullptr) {
+      return false;
+    }
+    layout->start_addr =
+        reinterpret_cast<uintptr_t>(pt->location().start_addr());
+    layout->donated = pt->donated();
+    layout->unbroken = pt->unbroken();
+    layout->dense = pt->HasDenseSpans();
+    layout->short_lived = pt->short_lived();
+    layout->idle_score = pt->idle_score();
+    layout->nallocs = pt->nallocs();
+    layout->num_runs = pt->GetLayoutRuns(layout->runs);
+    return true;
+  }
+
+  // Marks the hugepages overlapping [p, p + n) as pinned-unreleasable (or
+  // clears the mark).  Filler trackers get a bit that ReleaseCandidates
+  // checks; the huge cache records the range itself so that it stays backed
+  // even if the pages are freed while still registered with the kernel.
+  void MarkUnreleasable(PageId p, Length n, bool unreleasable)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override {
+    if (n == Length(0)) {
+      return;
+    }
+    const HugePage first = HugePageContaining(p);
+    const HugePage last = HugePageContaining(p + n - Length(1));
+    for (HugePage hp = first; hp <= last; ++hp) {
+      FillerType::Tracker* pt = GetTracker(hp);
+      if (pt != nullptr && !pt->donated()) {
+        pt->set_unreleasable(unreleasable);
+      }
+    }
+    cache_.MarkUnreleasable(
+        HugeRange::Make(first, (last - first) + NHugePages(1)), unreleasable);
+  }
+
   // Prints stats about the page heap to *out.
   void Print(Printer* out) ABSL_LOCKS_EXCLUDED(pageheap_lock) override;
 
@@ -215,6 +309,14 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
   }
 
   const HugeCache* cache() const { return &cache_; }
+  HugeCache* cache() { return &cache_; }
+
+  // How shattered this heap's free (unbacked) VA is; see
+  // HugeAddressMap::FragmentationScore.
+  double VAFragmentationScore() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    return alloc_.FragmentationScore();
+  }
 
   const HugeRegionSet<HugeRegion>& region() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
@@ -224,6 +326,18 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
   // IsValidSizeClass verifies size class parameters from the HPAA perspective.
   static bool IsValidSizeClass(size_t size, size_t pages);
 
+  // Biases large-allocation placement toward huge regions and dense filler
+  // packing, as if the use-huge-region-more-often experiment were active.
+  // Set by the background thread when measured hugepage pressure is high (see
+  // Parameters::thp_aware_region_bias) and cleared when it subsides; the
+  // startup HugeRegionUsageOption is never weakened, only strengthened.
+  void SetDenseRegionBias(bool bias) {
+    dense_region_bias_.store(bias, std::memory_order_relaxed);
+  }
+  bool dense_region_bias() const {
+    return dense_region_bias_.load(std::memory_order_relaxed);
+  }
+
   Forwarder& forwarder() { return forwarder_; }
 
  private:
@@ -238,6 +352,11 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
       return hpaa_.forwarder_.ReleasePages(start, length);
     }
 
+    size_t ModifyMany(absl::Span<const AddressRange> ranges,
+                      bool* ok) override {
+      return hpaa_.forwarder_.ReleaseRanges(ranges, ok);
+    }
+
    public:
     HugePageAwareAllocator& hpaa_;
   };
@@ -330,6 +449,36 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
   // reassembled.
   Length abandoned_pages_ ABSL_GUARDED_BY(pageheap_lock);
 
+  // See SetDenseRegionBias().  Atomic rather than lock-guarded since the
+  // background thread toggles it without holding pageheap_lock.
+  std::atomic<bool> dense_region_bias_{false};
+
+  // Whether large allocations should favor huge regions over donating slack to
+  // the filler: either the startup option or the runtime bias requests it.
+  bool UseRegionsMoreOften() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    return regions_.UseHugeRegionMoreOften() ||
+           dense_region_bias_.load(std::memory_order_relaxed);
+  }
+
+  // Predicts which allocation sites produce short-lived spans (see
+  // lifetime_prediction.h); enabled by Parameters::
+  // lifetime_prediction_enabled().  Predicted-short-lived spans are placed on
+  // dedicated hugepages tracked in short_lived_trackers_ rather than the
+  // filler, so the hugepage empties quickly and can be returned to the cache
+  // whole instead of being subreleased piecemeal.
+  LifetimePredictor lifetime_predictor_ ABSL_GUARDED_BY(pageheap_lock);
+  TList<FillerType::Tracker> short_lived_trackers_
+      ABSL_GUARDED_BY(pageheap_lock);
+  HugeLength short_lived_hugepages_ ABSL_GUARDED_BY(pageheap_lock);
+  // Free-but-backed pages on short-lived hugepages; these appear in no
+  // component's stats, so stats() adds them explicitly.
+  Length short_lived_free_pages_ ABSL_GUARDED_BY(pageheap_lock);
+
+  // Bound on the number of short-lived hugepages examined per allocation
+  // before we dedicate a fresh one.
+  static constexpr int kShortLivedScanLimit = 16;
+
   void GetSpanStats(SmallSpanStats* small, LargeSpanStats* large)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
@@ -346,9 +495,19 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
   // Helpers for New().
 
   Span* LockAndAlloc(Length n, SpanAllocInfo span_alloc_info,
-                     bool* from_released);
+                     uintptr_t site_hash, bool* from_released);
+
+  // site_hash identifies the allocation site for lifetime prediction; zero
+  // means no site was captured (prediction disabled or allocation too large).
+  Span* AllocSmall(Length n, SpanAllocInfo span_alloc_info, uintptr_t site_hash,
+                   bool* from_released)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
-  Span* AllocSmall(Length n, SpanAllocInfo span_alloc_info, bool* from_released)
+  // Allocate from a hugepage dedicated to predicted-short-lived spans,
+  // dedicating a new one if none has room.  Returns nullptr if no hugepage
+  // could be obtained; the caller falls back to the filler.
+  Span* AllocShortLived(Length n, SpanAllocInfo span_alloc_info,
+                        bool* from_released)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
   Span* AllocLarge(Length n, SpanAllocInfo span_alloc_info, bool* from_released)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
@@ -364,11 +523,19 @@ class HugePageAwareAllocator final : public PageAllocatorInterface {
 
   void ReleaseHugepage(FillerType::Tracker* pt)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+  // Collect hugepages that emptied while the filler had the pageheap_lock
+  // dropped for an unback syscall; their return from Put was deferred.
+  void CollectDeferredHugepages() ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
   // Return an allocation from a single hugepage.
   void DeleteFromHugepage(FillerType::Tracker* pt, PageId p, Length n,
                           bool might_abandon)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Return an allocation from a hugepage dedicated to short-lived spans,
+  // releasing the hugepage whole once it drains.
+  void DeleteShortLived(FillerType::Tracker* pt, PageId p, Length n)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   // Finish an allocation request - give it a span and mark it in the pagemap.
   Span* Finalize(Length n, SpanAllocInfo span_alloc_info, PageId page);
 
@@ -462,20 +629,64 @@ inline Span* HugePageAwareAllocator<Forwarder>::Finalize(
 // to pack it into a single page.  If we need another page, that's fine.
 template <class Forwarder>
 inline Span* HugePageAwareAllocator<Forwarder>::AllocSmall(
-    Length n, SpanAllocInfo span_alloc_info, bool* from_released) {
+    Length n, SpanAllocInfo span_alloc_info, uintptr_t site_hash,
+    bool* from_released) {
+  // If the allocation site is predicted to produce short-lived spans, try to
+  // segregate the span onto a dedicated hugepage.  On failure we fall back to
+  // the filler below.
+  if (site_hash != 0 && lifetime_predictor_.PredictShortLived(site_hash)) {
+    Span* s = AllocShortLived(n, span_alloc_info, from_released);
+    if (ABSL_PREDICT_TRUE(s != nullptr)) {
+      lifetime_predictor_.RecordAlloc(s->first_page(), site_hash,
+                                      /*predicted_short=*/true);
+      return s;
+    }
+  }
+
   auto [pt, page, released] = filler_.TryGet(n, span_alloc_info);
   *from_released = released;
-  if (ABSL_PREDICT_TRUE(pt != nullptr)) {
-    return Finalize(n, span_alloc_info, page);
+  if (ABSL_PREDICT_FALSE(pt == nullptr)) {
+    page = RefillFiller(n, span_alloc_info, from_released);
+    if (ABSL_PREDICT_FALSE(page == PageId{0})) {
+      return nullptr;
+    }
   }
-
-  page = RefillFiller(n, span_alloc_info, from_released);
-  if (ABSL_PREDICT_FALSE(page == PageId{0})) {
-    return nullptr;
+  if (site_hash != 0) {
+    lifetime_predictor_.RecordAlloc(page, site_hash,
+                                    /*predicted_short=*/false);
   }
   return Finalize(n, span_alloc_info, page);
 }
 
+template <class Forwarder>
+inline Span* HugePageAwareAllocator<Forwarder>::AllocShortLived(
+    Length n, SpanAllocInfo span_alloc_info, bool* from_released) {
+  *from_released = false;
+  // Prefer an existing short-lived hugepage with room.  The list is expected
+  // to stay short; bound the scan so an unlucky mix of sizes cannot make
+  // allocation linear in the number of dedicated hugepages.
+  int scanned = 0;
+  for (FillerType::Tracker* pt : short_lived_trackers_) {
+    if (pt->longest_free_range() >= n) {
+      short_lived_free_pages_ -= n;
+      return Finalize(n, span_alloc_info, pt->Get(n).page);
+    }
+    if (++scanned >= kShortLivedScanLimit) break;
+  }
+
+  HugeRange r = cache_.Get(NHugePages(1), from_released);
+  if (!r.valid()) return nullptr;
+  forwarder_.ShrinkToUsageLimit(n);
+  FillerType::Tracker* pt = tracker_allocator_.New();
+  new (pt) FillerType::Tracker(r.start(), /*was_donated=*/false);
+  pt->set_short_lived(true);
+  SetTracker(r.start(), pt);
+  short_lived_trackers_.prepend(pt);
+  ++short_lived_hugepages_;
+  short_lived_free_pages_ += kPagesPerHugePage - n;
+  return Finalize(n, span_alloc_info, pt->Get(n).page);
+}
+
 template <class Forwarder>
 inline Span* HugePageAwareAllocator<Forwarder>::AllocLarge(
     Length n, SpanAllocInfo span_alloc_info, bool* from_released) {
@@ -513,7 +724,7 @@ inline Span* HugePageAwareAllocator<Forwarder>::AllocLarge(
   // If not, just fall back to direct allocation (and hope we do hit that case!)
   const Length slack = info_.slack();
   const Length donated =
-      regions_.UseHugeRegionMoreOften() ? abandoned_pages_ + slack : slack;
+      UseRegionsMoreOften() ? abandoned_pages_ + slack : slack;
   // Don't bother at all until the binary is reasonably sized.
   if (donated < HLFromBytes(64 * 1024 * 1024).in_pages()) {
     return AllocRawHugepages(n, span_alloc_info, from_released);
@@ -524,9 +735,10 @@ inline Span* HugePageAwareAllocator<Forwarder>::AllocLarge(
   // a handful of binaries fall below 1:1.)
   //
   // If we enable an experiment that tries to use huge regions more frequently,
-  // we skip the check.
+  // or the background thread has observed hugepage pressure and biased us
+  // toward dense packing, we skip the check.
   const Length small = info_.small();
-  if (slack < small && !regions_.UseHugeRegionMoreOften()) {
+  if (slack < small && !UseRegionsMoreOften()) {
     return AllocRawHugepages(n, span_alloc_info, from_released);
   }
 
@@ -587,8 +799,17 @@ template <class Forwarder>
 inline Span* HugePageAwareAllocator<Forwarder>::New(
     Length n, SpanAllocInfo span_alloc_info) {
   TC_CHECK_GT(n, Length(0));
+  // Capture the allocation site before taking pageheap_lock; collecting a
+  // stack trace is too expensive to do under the lock.  Only small
+  // allocations participate: anything larger is not packed onto shared
+  // hugepages, so segregation buys nothing.
+  uintptr_t site_hash = 0;
+  if (n <= kSmallAllocPages &&
+      ABSL_PREDICT_FALSE(Parameters::lifetime_prediction_enabled())) {
+    site_hash = LifetimePredictor::CurrentSiteHash();
+  }
   bool from_released;
-  Span* s = LockAndAlloc(n, span_alloc_info, &from_released);
+  Span* s = LockAndAlloc(n, span_alloc_info, site_hash, &from_released);
   if (s) {
     // Prefetch for writing, as we anticipate using the memory soon.
     PrefetchW(s->start_address());
@@ -600,12 +821,13 @@ inline Span* HugePageAwareAllocator<Forwarder>::New(
 
 template <class Forwarder>
 inline Span* HugePageAwareAllocator<Forwarder>::LockAndAlloc(
-    Length n, SpanAllocInfo span_alloc_info, bool* from_released) {
+    Length n, SpanAllocInfo span_alloc_info, uintptr_t site_hash,
+    bool* from_released) {
   PageHeapSpinLockHolder l;
   // Our policy depends on size.  For small things, we will pack them
   // into single hugepages.
   if (n <= kSmallAllocPages) {
-    return AllocSmall(n, span_alloc_info, from_released);
+    return AllocSmall(n, span_alloc_info, site_hash, from_released);
   }
 
   // For anything too big for the filler, we use either a direct hugepage
@@ -695,9 +917,15 @@ inline void HugePageAwareAllocator<Forwarder>::Delete(Span* span,
   // There are several possibilities.
   FillerType::Tracker* pt = GetTracker(hp);
   // a) We got packed by the filler onto a single hugepage - return our
-  //    allocation to that hugepage in the filler.
+  //    allocation to that hugepage in the filler.  (Or we were placed on a
+  //    hugepage dedicated to short-lived spans - return it there.)
   if (ABSL_PREDICT_TRUE(pt != nullptr)) {
     ASSERT(hp == HugePageContaining(p + n - Length(1)));
+    lifetime_predictor_.RecordFree(p);
+    if (ABSL_PREDICT_FALSE(pt->short_lived())) {
+      DeleteShortLived(pt, p, n);
+      return;
+    }
     DeleteFromHugepage(pt, p, n, might_abandon);
     return;
   }
@@ -757,6 +985,35 @@ inline void HugePageAwareAllocator<Forwarder>::Delete(Span* span,
   cache_.Release({hp, hl});
 }
 
+template <class Forwarder>
+inline void HugePageAwareAllocator<Forwarder>::DeleteShortLived(
+    FillerType::Tracker* pt, PageId p, Length n) {
+  pt->Put(p, n);
+  short_lived_free_pages_ += n;
+  if (!pt->empty()) return;
+  // The hugepage drained, as predicted; return it to the cache whole.
+  short_lived_trackers_.remove(pt);
+  --short_lived_hugepages_;
+  short_lived_free_pages_ -= kPagesPerHugePage;
+  ReleaseHugepage(pt);
+}
+
+template <class Forwarder>
+inline void HugePageAwareAllocator<Forwarder>::CollectDeferredHugepages() {
+  while (FillerType::Tracker* pt = filler_.PopDeferredReturn()) {
+    // Complete the bookkeeping DeleteFromHugepage would have performed had
+    // Put been able to return pt immediately.
+    if (pt->was_donated()) {
+      --donated_huge_pages_;
+      if (pt->abandoned()) {
+        abandoned_pages_ -= pt->abandoned_count();
+        pt->set_abandoned(false);
+      }
+    }
+    ReleaseHugepage(pt);
+  }
+}
+
 template <class Forwarder>
 inline void HugePageAwareAllocator<Forwarder>::ReleaseHugepage(
     FillerType::Tracker* pt) {
@@ -785,6 +1042,9 @@ inline BackingStats HugePageAwareAllocator<Forwarder>::stats() const {
   // since it all comes from HugeAllocator but is then managed by
   // cache/regions/filler. Adjust for that.
   stats.system_bytes = actual_system;
+  // Free space on hugepages dedicated to short-lived spans belongs to no
+  // component above; account for it here.
+  stats.free_bytes += short_lived_free_pages_.in_bytes();
   return stats;
 }
 
@@ -816,6 +1076,9 @@ inline void HugePageAwareAllocator<Forwarder>::GetSpanStats(
   filler_.AddSpanStats(small, large);
   regions_.AddSpanStats(small, large);
   cache_.AddSpanStats(small, large);
+  for (const FillerType::Tracker* pt : short_lived_trackers_) {
+    pt->AddSpanStats(small, large);
+  }
 }
 
 // public
@@ -823,7 +1086,16 @@ template <class Forwarder>
 inline Length HugePageAwareAllocator<Forwarder>::ReleaseAtLeastNPages(
     Length num_pages) {
   Length released;
-  released += cache_.ReleaseCachedPages(HLFromPages(num_pages)).in_pages();
+  if (forwarder_.huge_cache_demand_based_release()) {
+    released += cache_
+                    .ReleaseCachedPagesByDemand(
+                        HLFromPages(num_pages),
+                        forwarder_.cache_demand_release_short_interval(),
+                        forwarder_.cache_demand_release_long_interval())
+                    .in_pages();
+  } else {
+    released += cache_.ReleaseCachedPages(HLFromPages(num_pages)).in_pages();
+  }
 
   // Release all backed-but-free hugepages from HugeRegion.
   // TODO(b/199203282): We release all the free hugepages from HugeRegions when
@@ -864,6 +1136,7 @@ inline Length HugePageAwareAllocator<Forwarder>::ReleaseAtLeastNPages(
                   forwarder_.filler_skip_subrelease_long_interval()},
           forwarder_.release_partial_alloc_pages(),
           /*hit_limit*/ false);
+      CollectDeferredHugepages();
     }
   }
 
@@ -937,6 +1210,27 @@ inline void HugePageAwareAllocator<Forwarder>::Print(Printer* out,
       "donations)\n",
       donated_huge_pages_.raw_num(), abandoned_pages_.raw_num());
 
+  // Only printed once lifetime prediction has been active, to keep the
+  // default output unchanged.
+  const int64_t lifetime_scored =
+      lifetime_predictor_.correct_short_predictions() +
+      lifetime_predictor_.mispredicted_short_predictions() +
+      lifetime_predictor_.correct_long_predictions() +
+      lifetime_predictor_.mispredicted_long_predictions();
+  if (short_lived_hugepages_ > NHugePages(0) || lifetime_scored > 0) {
+    out->printf(
+        "HugePageAware: %zu hugepages dedicated to short-lived spans "
+        "(%zu free pages on them)\n",
+        short_lived_hugepages_.raw_num(), short_lived_free_pages_.raw_num());
+    out->printf(
+        "HugePageAware: lifetime predictions short %lld correct / %lld "
+        "mispredicted, long %lld correct / %lld mispredicted\n",
+        lifetime_predictor_.correct_short_predictions(),
+        lifetime_predictor_.mispredicted_short_predictions(),
+        lifetime_predictor_.correct_long_predictions(),
+        lifetime_predictor_.mispredicted_long_predictions());
+  }
+
   // Component debug output
   // Filler is by far the most important; print (some) of it
   // unconditionally.
@@ -1003,6 +1297,16 @@ inline void HugePageAwareAllocator<Forwarder>::PrintInPbtxt(
     info_.PrintInPbtxt(&hpaa, "hpaa_stat");
 
     hpaa.PrintI64("filler_donated_huge_pages", donated_huge_pages_.raw_num());
+    hpaa.PrintI64("short_lived_hugepages", short_lived_hugepages_.raw_num());
+    hpaa.PrintI64("short_lived_free_pages", short_lived_free_pages_.raw_num());
+    hpaa.PrintI64("lifetime_correct_short_predictions",
+                  lifetime_predictor_.correct_short_predictions());
+    hpaa.PrintI64("lifetime_mispredicted_short_predictions",
+                  lifetime_predictor_.mispredicted_short_predictions());
+    hpaa.PrintI64("lifetime_correct_long_predictions",
+                  lifetime_predictor_.correct_long_predictions());
+    hpaa.PrintI64("lifetime_mispredicted_long_predictions",
+                  lifetime_predictor_.mispredicted_long_predictions());
     hpaa.PrintI64("filler_abandoned_pages", abandoned_pages_.raw_num());
   }
 }
@@ -1042,6 +1346,7 @@ HugePageAwareAllocator<Forwarder>::ReleaseAtLeastNPagesBreakingHugepages(
   released += filler_.ReleasePages(n - released, SkipSubreleaseIntervals{},
                                    /*release_partial_alloc_pages=*/false,
                                    /*hit_limit=*/true);
+  CollectDeferredHugepages();
 
   info_.RecordRelease(n, released);
   return released;
@@ -765,6 +765,49 @@ TEST_P(HugePageAwareAllocatorTest, SmallDonations) {
   EXPECT_EQ(abandoned_pages, Length(0));
 }
 
+TEST_P(HugePageAwareAllocatorTest, LifetimePrediction) {
+  // This test verifies that once an allocation site has demonstrably produced
+  // only short-lived spans, further spans from it are segregated onto
+  // dedicated hugepages that are returned to the cache whole when they drain.
+  const bool old_enabled = Parameters::lifetime_prediction_enabled();
+  Parameters::set_lifetime_prediction_enabled(true);
+
+  static constexpr Length kSize = Length(2);
+  const SpanAllocInfo kSpanInfo = {2, AccessDensityPrediction::kSparse};
+
+  // All allocations must come from a single call site so that they hash to
+  // the same prediction site; the last iteration keeps its span alive.
+  //
+  // The predictor requires 16 observed short lifetimes before it predicts, so
+  // iterations 0..15 train it and iterations 16..32 allocate from dedicated
+  // hugepages.
+  Span* span = nullptr;
+  for (int i = 0; i < 33; ++i) {
+    span = New(kSize, kSpanInfo);
+    if (i < 32) {
+      Delete(span, kSpanInfo.objects_per_span);
+    }
+  }
+
+  EXPECT_THAT(Print(),
+              HasSubstr("1 hugepages dedicated to short-lived spans"));
+  EXPECT_THAT(PrintInPbtxt(), HasSubstr("short_lived_hugepages: 1"));
+
+  // Freeing the last span drains its hugepage: it is returned whole and the
+  // prediction is scored as correct.
+  Delete(span, kSpanInfo.objects_per_span);
+
+  EXPECT_THAT(Print(),
+              HasSubstr("0 hugepages dedicated to short-lived spans"));
+  EXPECT_THAT(PrintInPbtxt(), HasSubstr("short_lived_hugepages: 0"));
+  EXPECT_THAT(PrintInPbtxt(),
+              HasSubstr("lifetime_correct_short_predictions: 17"));
+  EXPECT_THAT(PrintInPbtxt(),
+              HasSubstr("lifetime_mispredicted_long_predictions: 16"));
+
+  Parameters::set_lifetime_prediction_enabled(old_enabled);
+}
+
 TEST_P(HugePageAwareAllocatorTest, LargeDonations) {
   // A small allocation of size (kHugePageSize/2,kHugePageSize]-bytes can be
   // considered not donated if it filled in a gap on an otherwise mostly free
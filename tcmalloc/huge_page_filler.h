@@ -24,7 +24,6 @@
 
 #include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
-#include "absl/base/internal/cycleclock.h"
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
@@ -41,10 +40,12 @@
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/optimization.h"
 #include "tcmalloc/internal/range_tracker.h"
+#include "tcmalloc/internal/seqlocked_data.h"
 #include "tcmalloc/internal/timeseries_tracker.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/stats.h"
+#include "tcmalloc/system-alloc.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
@@ -64,6 +65,7 @@ class PageTracker : public TList<PageTracker>::Elem {
   PageTracker(HugePage p, bool was_donated)
       : location_(p),
         released_count_(0),
+        faulted_count_(0),
         abandoned_count_(0),
         donated_(false),
         was_donated_(was_donated),
@@ -156,6 +158,15 @@ class PageTracker : public TList<PageTracker>::Elem {
   size_t nallocs() const { return free_.allocs(); }
   Length used_pages() const { return Length(free_.used()); }
   Length released_pages() const { return Length(released_count_); }
+  // Free pages that have been faulted (allocated at least once) since this
+  // hugepage was mapped or since they were last released.  Releasing them
+  // reclaims resident memory, at the cost of kernel zeroing if they are
+  // refaulted; the remaining free pages--never-touched donated tails and
+  // already-released pages--are nearly free to release but reclaim nothing.
+  Length dirty_free_pages() const {
+    TC_ASSERT_GE(Length(faulted_count_), used_pages());
+    return Length(faulted_count_) - used_pages();
+  }
   Length free_pages() const;
   bool empty() const;
 
@@ -169,10 +180,80 @@ class PageTracker : public TList<PageTracker>::Elem {
   Length ReleaseFree(MemoryModifyFunction& unback)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Two-phase variant of ReleaseFree, allowing the syscall to be issued
+  // without holding pageheap_lock.  PrepareReleaseFree records every
+  // free-and-backed range in *to_release, marks it released in
+  // released_by_page_, and returns the number of pages recorded.  The caller
+  // then unbacks the recorded ranges with the lock dropped via ReleaseRanges
+  // and, if that fails partway, rolls the unreleased suffix back with
+  // UndoReleaseFrom under the lock.
+  Length PrepareReleaseFree(Bitmap<kPagesPerHugePage.raw_num()>* to_release)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Unbacks the ranges recorded in to_release, stopping at the first failure.
+  // Returns the page index of the range that failed, or kPagesPerHugePage if
+  // every range was released.  Reads only this tracker's immutable location,
+  // so it is safe to call without pageheap_lock held.
+  size_t ReleaseRanges(const Bitmap<kPagesPerHugePage.raw_num()>& to_release,
+                       MemoryModifyFunction& unback);
+
+  // Clears the released marks for the ranges in to_release at and after
+  // failed_index, undoing their PrepareReleaseFree accounting.  Returns the
+  // number of pages undone.
+  Length UndoReleaseFrom(const Bitmap<kPagesPerHugePage.raw_num()>& to_release,
+                         size_t failed_index)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // While true, a two-phase release has this tracker unlinked from the filler
+  // lists with pageheap_lock dropped for the syscall; HugePageFiller::Put must
+  // not adjust its list membership (the releasing thread relists it by its
+  // then-current state) nor hand the hugepage back to the page allocator.
+  bool releasing() const { return releasing_; }
+  void set_releasing(bool status) { releasing_ = status; }
+
   void AddSpanStats(SmallSpanStats* small, LargeSpanStats* large) const;
+
+  // One maximal run of pages in a uniform state, as written by
+  // GetLayoutRuns.
+  struct LayoutRun {
+    enum State : uint8_t { kAllocated = 0, kFree = 1, kReleased = 2 };
+    // First page of the run within the hugepage.
+    uint16_t start_page;
+    uint16_t num_pages;
+    uint8_t state;
+  };
+
+  // Copies this hugepage's page-state runs -- maximal ranges of pages that
+  // are uniformly allocated, free-and-backed, or free-and-released -- into
+  // <runs>, lowest page first.  <runs> must have room for
+  // kPagesPerHugePage.raw_num() entries, the worst case.  Returns the number
+  // of runs written; the runs always cover the whole hugepage.
+  size_t GetLayoutRuns(LayoutRun* runs) const;
+
   bool HasDenseSpans() const { return has_dense_spans_; }
   void SetHasDenseSpans() { has_dense_spans_ = true; }
 
+  // Tracks whether this hugepage is dedicated to predicted-short-lived spans.
+  // Such trackers are owned by the HugePageAwareAllocator directly and never
+  // enter the filler.
+  bool short_lived() const { return short_lived_; }
+  void set_short_lived(bool status) { short_lived_ = status; }
+
+  // Coldness published by the background page_idle scan: the fraction
+  // (0 = hot, 255 = fully idle) of this hugepage's base pages whose kernel
+  // idle bits were still set when the scanner last revisited it.  Stays 0
+  // when scanning is disabled or unavailable, which keeps the score out of
+  // release and placement decisions.  See idle_scan.h.
+  uint8_t idle_score() const { return idle_score_; }
+  void set_idle_score(uint8_t score) { idle_score_ = score; }
+
+  // Set while any part of this hugepage overlaps a range registered via
+  // MallocExtension::MarkUnreleasable (an RDMA memory region or io_uring
+  // fixed buffer, say).  Subrelease skips such hugepages: the madvise either
+  // fails against the pin or breaks up the mapping it depends on.
+  bool unreleasable() const { return unreleasable_; }
+  void set_unreleasable(bool status) { unreleasable_ = status; }
+
  private:
   HugePage location_;
 
@@ -180,6 +261,10 @@ class PageTracker : public TList<PageTracker>::Elem {
   //
   // TODO(b/151663108):  Logically, this is guarded by pageheap_lock.
   uint16_t released_count_;
+  // Cached value of faulted_by_page_.CountBits(0, kPagesPerHugePages)
+  //
+  // TODO(b/151663108):  Logically, this is guarded by pageheap_lock.
+  uint16_t faulted_count_;
   uint16_t abandoned_count_;
   bool donated_;
   bool was_donated_;
@@ -191,6 +276,8 @@ class PageTracker : public TList<PageTracker>::Elem {
   // reset it once we measure those pages in abandoned_count_.
   bool abandoned_;
   bool unbroken_;
+  // Kernel-idle fraction from the last background scan; see idle_score().
+  uint8_t idle_score_ = 0;
 
   RangeTracker<kPagesPerHugePage.raw_num()> free_;
   // Bitmap of pages based on them being released to the OS.
@@ -206,11 +293,25 @@ class PageTracker : public TList<PageTracker>::Elem {
   // TODO(b/151663108):  Logically, this is guarded by pageheap_lock.
   Bitmap<kPagesPerHugePage.raw_num()> released_by_page_;
 
+  // Bitmap of pages that have been faulted since the hugepage was mapped or
+  // since the page was last released.  A clear bit on a free page means the
+  // page is "clean"--a never-touched donated tail or an already-released
+  // page--so releasing it is nearly free but reclaims no resident memory.  A
+  // set bit on a free page means it is "dirty": still backed, so releasing it
+  // actually shrinks our footprint.  ReleaseCandidates uses this to rank
+  // otherwise-equal subrelease candidates (see CompareForSubrelease).
+  //
+  // TODO(b/151663108):  Logically, this is guarded by pageheap_lock.
+  Bitmap<kPagesPerHugePage.raw_num()> faulted_by_page_;
+
   static_assert(kPagesPerHugePage.raw_num() <
                     std::numeric_limits<uint16_t>::max(),
                 "nallocs must be able to support kPagesPerHugePage!");
 
   bool has_dense_spans_ = false;
+  bool short_lived_ = false;
+  bool releasing_ = false;
+  bool unreleasable_ = false;
 
   ABSL_MUST_USE_RESULT bool ReleasePages(PageId p, Length n,
                                          MemoryModifyFunction& unback) {
@@ -224,6 +325,22 @@ class PageTracker : public TList<PageTracker>::Elem {
   }
 };
 
+// Snapshot of one filler-managed hugepage's layout, copied under
+// pageheap_lock by HugePageAwareAllocator::GetFillerLayoutContaining for the
+// heap layout export.
+struct FillerHugePageLayout {
+  uintptr_t start_addr;
+  bool donated;
+  bool unbroken;
+  // Carries densely packed (many-object) spans; see HasDenseSpans.
+  bool dense;
+  bool short_lived;
+  uint8_t idle_score;
+  uint32_t nallocs;
+  size_t num_runs;
+  PageTracker::LayoutRun runs[kPagesPerHugePage.raw_num()];
+};
+
 // Records number of hugepages in different types of allocs.
 //
 // We use an additional element in the array to record the total sum of pages
@@ -290,6 +407,13 @@ class HugePageFiller {
   TrackerType* Put(TrackerType* pt, PageId p, Length n)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Unlinks and returns a hugepage that emptied while a two-phase release had
+  // the pageheap_lock dropped (Put defers such returns so that the releasing
+  // thread's candidate pointers stay valid); nullptr if there are none or a
+  // release is still in flight.  Callers should collect these after each
+  // ReleasePages round, exactly as if Put had returned them.
+  TrackerType* PopDeferredReturn() ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   // Contributes a tracker to the filler. If "donated," then the tracker is
   // marked as having come from the tail of a multi-hugepage allocation, which
   // causes it to be treated slightly differently.
@@ -379,7 +503,26 @@ class HugePageFiller {
   BackingStats stats() const;
   SubreleaseStats subrelease_stats() const { return subrelease_stats_; }
 
+  // Returns the maximum page demand observed by the subrelease demand
+  // history within the most recent <interval>.
+  Length GetRecentDemandPeak(absl::Duration interval) {
+    return fillerstats_tracker_.GetRecentDemandPeak(interval);
+  }
+
   HugePageFillerStats GetStats() const;
+
+  // Filler stats republished at the end of every mutation batch.
+  struct StatsSnapshot {
+    HugePageFillerStats filler;
+    BackingStats backing;
+  };
+
+  // Returns the stats published by the most recent mutation batch, without
+  // acquiring pageheap_lock.  The two members were captured together under
+  // the lock, so they are mutually consistent; they are no staler than the
+  // last allocation, deallocation, or release that touched the filler.
+  StatsSnapshot GetStatsSnapshot() const { return stats_snapshot_.Read(); }
+
   void Print(Printer* out, bool everything) const;
   void PrintInPbtxt(PbtxtRegion* hpaa) const;
 
@@ -400,6 +543,9 @@ class HugePageFiller {
   // then into chunks_per_alloc_ chunks inside there by desirability of
   // allocation.
   static constexpr size_t kChunks = 16;
+  // Hugepages whose idle score is at least this are placed at the back of
+  // their filler list, behind equal-fit hot hugepages (see AddToFillerList).
+  static constexpr uint8_t kColdPlacementScore = 128;
   // Which chunk should this hugepage be in?
   // This returns the largest possible value chunks_per_alloc_ - 1 iff
   // pt has a single allocation.
@@ -461,12 +607,21 @@ class HugePageFiller {
 
     if (a->used_pages() < b->used_pages()) return true;
     if (a->used_pages() > b->used_pages()) return false;
-    // If 'a' has dense spans, then we do not prefer to release from 'a'
-    // compared to 'b'.
-    if (a->HasDenseSpans()) return false;
-    // We know 'a' does not have dense spans.  If 'b' has dense spans, then we
-    // prefer to release from 'a'.  Otherwise, we do not prefer either.
-    return b->HasDenseSpans();
+    // If only one of the two has dense spans, we prefer to release from the
+    // other.
+    if (a->HasDenseSpans() != b->HasDenseSpans()) return b->HasDenseSpans();
+    // Prefer the candidate the page_idle scan found colder: its pages have
+    // demonstrably not been touched, while allocation age alone can point at
+    // hugepages that are old but hot.  Scores are all zero unless scanning
+    // is enabled, leaving the ordering below unchanged.
+    if (a->idle_score() != b->idle_score()) {
+      return a->idle_score() > b->idle_score();
+    }
+    // All else being equal, prefer the candidate with more dirty free pages:
+    // releasing those reclaims resident memory, while a candidate whose free
+    // pages are mostly clean (never faulted, or already released) consumes our
+    // release target and breaks a hugepage without shrinking the footprint.
+    return a->dirty_free_pages() > b->dirty_free_pages();
   }
 
   // SelectCandidates identifies the candidates.size() best candidates in the
@@ -485,6 +640,13 @@ class HugePageFiller {
   Length ReleaseCandidates(absl::Span<TrackerType*> candidates, Length target)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Completes the accounting for removing the now-empty pt (already off the
+  // filler lists) from the filler.  Returns pt for the caller to hand back to
+  // the page allocator, or nullptr if the return was deferred because a
+  // two-phase release is in flight.
+  TrackerType* ReleaseEmptyTracker(TrackerType* pt)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   HugeLength size_;
 
   Length pages_allocated_[AccessDensityPrediction::kPredictionCounts];
@@ -494,10 +656,20 @@ class HugePageFiller {
   // not reported to ReleasePages calls?
   Length unmapping_unaccounted_;
 
+  // True while ReleaseCandidates has (or may drop) the pageheap_lock released
+  // for an unback syscall.  Guarded by pageheap_lock.
+  bool release_in_progress_ = false;
+  // Hugepages that emptied during such a window; no longer part of the filler
+  // (size_ and friends exclude them), awaiting PopDeferredReturn.
+  TList<TrackerType> deferred_return_;
+
   // Functionality related to time series tracking.
   void UpdateFillerStatsTracker();
   using StatsTrackerType = SubreleaseStatsTracker<600>;
   StatsTrackerType fillerstats_tracker_;
+
+  // Lock-free shadow copy of the filler stats; see GetStatsSnapshot().
+  SeqLockedData<StatsSnapshot> stats_snapshot_;
   MemoryModifyFunction& unback_;
 };
 
@@ -520,6 +692,15 @@ inline typename PageTracker::PageAllocation PageTracker::Get(Length n) {
     released_count_ -= unbacked;
   }
 
+  // Once every page has been faulted, the bitmap is all ones and stays that
+  // way until a release clears some bits, so we can skip the scan.
+  if (faulted_count_ < kPagesPerHugePage.raw_num()) {
+    const size_t newly_faulted =
+        n.raw_num() - faulted_by_page_.CountBits(index, n.raw_num());
+    faulted_by_page_.SetRange(index, n.raw_num());
+    faulted_count_ += newly_faulted;
+  }
+
   ASSERT(released_by_page_.CountBits(0, kPagesPerHugePage.raw_num()) ==
          released_count_);
   return PageAllocation{location_.first_page() + Length(index),
@@ -563,6 +744,9 @@ inline Length PageTracker::ReleaseFree(MemoryModifyFunction& unback) {
         // Mark pages as released.  Amortize the update to release_count_.
         released_by_page_.SetRange(free_index, length);
         count += length;
+        // The pages are no longer backed, so they are clean again.
+        faulted_count_ -= faulted_by_page_.CountBits(free_index, length);
+        faulted_by_page_.ClearRange(free_index, length);
       }
 
       index = end;
@@ -580,6 +764,114 @@ inline Length PageTracker::ReleaseFree(MemoryModifyFunction& unback) {
   return Length(count);
 }
 
+inline Length PageTracker::PrepareReleaseFree(
+    Bitmap<kPagesPerHugePage.raw_num()>* to_release) {
+  size_t count = 0;
+  size_t index = 0;
+  size_t n;
+  // Mirrors the scan in ReleaseFree, but instead of releasing each range as
+  // it is found, we record it in *to_release and mark it released up front.
+  // Marking the bitmap before the syscall is required (see released_by_page_):
+  // the caller drops pageheap_lock while unbacking, and any allocation from
+  // these ranges in that window must observe them as released.
+  while (released_by_page_.NextFreeRange(index, &index, &n)) {
+    size_t free_index;
+    size_t free_n;
+
+    if (free_.NextFreeRange(index, &free_index, &free_n) &&
+        free_index < index + n) {
+      size_t end = std::min(free_index + free_n, index + n);
+      size_t length = end - free_index;
+      ASSERT(released_by_page_.CountBits(free_index, length) == 0);
+      to_release->SetRange(free_index, length);
+      released_by_page_.SetRange(free_index, length);
+      count += length;
+      // Treat the pages as clean from here on; if the unback fails,
+      // UndoReleaseFrom conservatively re-marks them dirty.
+      faulted_count_ -= faulted_by_page_.CountBits(free_index, length);
+      faulted_by_page_.ClearRange(free_index, length);
+      index = end;
+    } else {
+      index += n;
+    }
+  }
+
+  released_count_ += count;
+  if (count > 0) {
+    unbroken_ = false;
+  }
+  ASSERT(Length(released_count_) <= kPagesPerHugePage);
+  ASSERT(released_by_page_.CountBits(0, kPagesPerHugePage.raw_num()) ==
+         released_count_);
+  return Length(count);
+}
+
+inline size_t PageTracker::ReleaseRanges(
+    const Bitmap<kPagesPerHugePage.raw_num()>& to_release,
+    MemoryModifyFunction& unback) {
+  constexpr size_t kMaxIndex = kPagesPerHugePage.raw_num();
+  // Gather the ranges up front and unback them as one batch, so an
+  // implementation backed by an async madvise queue pays one submission for
+  // the whole hugepage rather than one syscall per range.  A bitmap holds at
+  // most kMaxIndex / 2 disjoint set ranges.
+  AddressRange ranges[kMaxIndex / 2];
+  size_t starts[kMaxIndex / 2];
+  size_t n = 0;
+  size_t index = to_release.FindSet(0);
+  while (index < kMaxIndex) {
+    const size_t end = std::min(to_release.FindClear(index), kMaxIndex);
+    const size_t length = end - index;
+    ranges[n] = {(location_.first_page() + Length(index)).start_addr(),
+                 Length(length).in_bytes()};
+    starts[n] = index;
+    ++n;
+    index = end < kMaxIndex ? to_release.FindSet(end) : kMaxIndex;
+  }
+  if (n == 0) {
+    return kMaxIndex;
+  }
+
+  bool ok[kMaxIndex / 2];
+  unback.ModifyMany(absl::MakeSpan(ranges, n), ok);
+  for (size_t i = 0; i < n; ++i) {
+    if (ABSL_PREDICT_FALSE(!ok[i])) {
+      // Ranges after the first failure may have been released anyway; the
+      // caller rolling them back as unreleased is safe (a free range can be
+      // unbacked at any time) and preserves stop-at-first-failure
+      // accounting.
+      return starts[i];
+    }
+  }
+  return kMaxIndex;
+}
+
+inline Length PageTracker::UndoReleaseFrom(
+    const Bitmap<kPagesPerHugePage.raw_num()>& to_release,
+    size_t failed_index) {
+  constexpr size_t kMaxIndex = kPagesPerHugePage.raw_num();
+  Length undone;
+  size_t index =
+      failed_index < kMaxIndex ? to_release.FindSet(failed_index) : kMaxIndex;
+  while (index < kMaxIndex) {
+    const size_t end = std::min(to_release.FindClear(index), kMaxIndex);
+    const size_t length = end - index;
+    ASSERT(released_by_page_.CountBits(index, length) == length);
+    released_by_page_.ClearRange(index, length);
+    TC_ASSERT_GE(released_count_, length);
+    released_count_ -= length;
+    // The pages were never unbacked.  PrepareReleaseFree dropped their
+    // faulted marks, and we no longer know which of them had actually been
+    // faulted, so count the whole range as dirty.
+    faulted_by_page_.SetRange(index, length);
+    faulted_count_ += length;
+    undone += Length(length);
+    index = end < kMaxIndex ? to_release.FindSet(end) : kMaxIndex;
+  }
+  ASSERT(released_by_page_.CountBits(0, kPagesPerHugePage.raw_num()) ==
+         released_count_);
+  return undone;
+}
+
 inline void PageTracker::AddSpanStats(SmallSpanStats* small,
                                       LargeSpanStats* large) const {
   size_t index = 0, n;
@@ -621,6 +913,46 @@ inline void PageTracker::AddSpanStats(SmallSpanStats* small,
   }
 }
 
+inline size_t PageTracker::GetLayoutRuns(LayoutRun* runs) const {
+  size_t count = 0;
+  size_t index = 0, n;
+  size_t prev_end = 0;
+
+  while (free_.NextFreeRange(index, &index, &n)) {
+    if (index > prev_end) {
+      runs[count++] = {static_cast<uint16_t>(prev_end),
+                       static_cast<uint16_t>(index - prev_end),
+                       LayoutRun::kAllocated};
+    }
+    // Split the free range where the released state flips, as AddSpanStats
+    // does.
+    const size_t range_end = index + n;
+    while (index < range_end) {
+      const bool is_released = released_by_page_.GetBit(index);
+      size_t end;
+      if (index >= kPagesPerHugePage.raw_num() - 1) {
+        end = kPagesPerHugePage.raw_num();
+      } else {
+        end = is_released ? released_by_page_.FindClear(index + 1)
+                          : released_by_page_.FindSet(index + 1);
+      }
+      end = std::min(end, range_end);
+      runs[count++] = {
+          static_cast<uint16_t>(index), static_cast<uint16_t>(end - index),
+          is_released ? LayoutRun::kReleased : LayoutRun::kFree};
+      index = end;
+    }
+    prev_end = index;
+  }
+  if (prev_end < kPagesPerHugePage.raw_num()) {
+    runs[count++] = {
+        static_cast<uint16_t>(prev_end),
+        static_cast<uint16_t>(kPagesPerHugePage.raw_num() - prev_end),
+        LayoutRun::kAllocated};
+  }
+  return count;
+}
+
 inline bool PageTracker::empty() const { return free_.used() == 0; }
 
 inline Length PageTracker::free_pages() const {
@@ -631,9 +963,11 @@ template <class TrackerType>
 inline HugePageFiller<TrackerType>::HugePageFiller(
     HugePageFillerAllocsOption allocs_option, size_t chunks_per_alloc,
     MemoryModifyFunction& unback)
-    : HugePageFiller(Clock{.now = absl::base_internal::CycleClock::Now,
-                           .freq = absl::base_internal::CycleClock::Frequency},
-                     allocs_option, chunks_per_alloc, unback) {}
+    // The coarse clock keeps per-alloc epoch advancement off the cycle
+    // counter; subrelease epochs are minutes long, so its one-second
+    // resolution is ample.
+    : HugePageFiller(CoarseClock::AsClock(), allocs_option, chunks_per_alloc,
+                     unback) {}
 
 // For testing with mock clock
 template <class TrackerType>
@@ -790,7 +1124,16 @@ HugePageFiller<TrackerType>::TryGet(Length n, SpanAllocInfo span_alloc_info) {
 template <class TrackerType>
 inline TrackerType* HugePageFiller<TrackerType>::Put(TrackerType* pt, PageId p,
                                                      Length n) {
-  RemoveFromFillerList(pt);
+  // If pt is mid two-phase release, the releasing thread has unlinked it from
+  // the filler lists and dropped pageheap_lock for the unback syscall.  Leave
+  // its list membership alone (the releasing thread relists it by its
+  // then-current state) and defer to that thread for the empty-hugepage
+  // handling: unmarking the freed pages is safe, as they are disjoint from the
+  // ranges being unbacked.
+  const bool releasing = pt->releasing();
+  if (!releasing) {
+    RemoveFromFillerList(pt);
+  }
   pt->Put(p, n);
   if (pt->HasDenseSpans()) {
     ASSERT(pages_allocated_[AccessDensityPrediction::kDense] >= n);
@@ -800,47 +1143,80 @@ inline TrackerType* HugePageFiller<TrackerType>::Put(TrackerType* pt, PageId p,
     pages_allocated_[AccessDensityPrediction::kSparse] -= n;
   }
 
-  if (pt->longest_free_range() == kPagesPerHugePage) {
-    ASSERT(pt->nallocs() == 0);
-    --size_;
-    if (pt->released()) {
-      const Length free_pages = pt->free_pages();
-      const Length released_pages = pt->released_pages();
-      TC_ASSERT_GE(free_pages, released_pages);
-      TC_ASSERT_GE(unmapped_, released_pages);
-      unmapped_ -= released_pages;
-
-      if (free_pages > released_pages) {
-        // pt is partially released.  As the rest of the hugepage-aware
-        // allocator works in terms of whole hugepages, we need to release the
-        // rest of the hugepage.  This simplifies subsequent accounting by
-        // allowing us to work with hugepage-granularity, rather than needing to
-        // retain pt's state indefinitely.
-        pageheap_lock.Unlock();
-        bool success = unback_(pt->location().start_addr(), kHugePageSize);
-        pageheap_lock.Lock();
-
-        if (ABSL_PREDICT_TRUE(success)) {
-          unmapping_unaccounted_ += free_pages - released_pages;
-        }
+  if (!releasing && pt->longest_free_range() == kPagesPerHugePage) {
+    TrackerType* ret = ReleaseEmptyTracker(pt);
+    UpdateFillerStatsTracker();
+    return ret;
+  }
+  if (!releasing) {
+    AddToFillerList(pt);
+  }
+  UpdateFillerStatsTracker();
+  return nullptr;
+}
+
+// pt just became completely free and has been unlinked from the filler lists.
+// Completes the accounting for removing it from the filler and returns it so
+// the caller can hand the hugepage back -- unless a two-phase release is in
+// flight, in which case a live candidate pointer to pt may exist on the
+// releasing thread's stack and destroying the tracker now would invalidate
+// it.  In that case pt is parked on deferred_return_ (and nullptr returned)
+// until the page allocator collects it with PopDeferredReturn.
+template <class TrackerType>
+inline TrackerType* HugePageFiller<TrackerType>::ReleaseEmptyTracker(
+    TrackerType* pt) {
+  ASSERT(pt->nallocs() == 0);
+  --size_;
+  if (pt->released()) {
+    const Length free_pages = pt->free_pages();
+    const Length released_pages = pt->released_pages();
+    TC_ASSERT_GE(free_pages, released_pages);
+    TC_ASSERT_GE(unmapped_, released_pages);
+    unmapped_ -= released_pages;
+
+    if (free_pages > released_pages) {
+      // pt is partially released.  As the rest of the hugepage-aware
+      // allocator works in terms of whole hugepages, we need to release the
+      // rest of the hugepage.  This simplifies subsequent accounting by
+      // allowing us to work with hugepage-granularity, rather than needing to
+      // retain pt's state indefinitely.
+      pageheap_lock.Unlock();
+      bool success = unback_(pt->location().start_addr(), kHugePageSize);
+      pageheap_lock.Lock();
+
+      if (ABSL_PREDICT_TRUE(success)) {
+        unmapping_unaccounted_ += free_pages - released_pages;
       }
     }
+  }
 
-    if (pt->was_released()) {
-      pt->set_was_released(/*status=*/false);
-      if (pt->HasDenseSpans()) {
-        --n_was_released_[AccessDensityPrediction::kDense];
-      } else {
-        --n_was_released_[AccessDensityPrediction::kSparse];
-      }
+  if (pt->was_released()) {
+    pt->set_was_released(/*status=*/false);
+    if (pt->HasDenseSpans()) {
+      --n_was_released_[AccessDensityPrediction::kDense];
+    } else {
+      --n_was_released_[AccessDensityPrediction::kSparse];
     }
+  }
 
-    UpdateFillerStatsTracker();
-    return pt;
+  if (ABSL_PREDICT_FALSE(release_in_progress_)) {
+    deferred_return_.append(pt);
+    return nullptr;
   }
-  AddToFillerList(pt);
-  UpdateFillerStatsTracker();
-  return nullptr;
+  return pt;
+}
+
+template <class TrackerType>
+inline TrackerType* HugePageFiller<TrackerType>::PopDeferredReturn() {
+  // While a release is in flight, candidate pointers to these trackers may
+  // still be live on the releasing thread's stack; they are collected once it
+  // completes.
+  if (ABSL_PREDICT_TRUE(deferred_return_.empty()) || release_in_progress_) {
+    return nullptr;
+  }
+  TrackerType* pt = deferred_return_.first();
+  deferred_return_.remove(pt);
+  return pt;
 }
 
 template <class TrackerType>
@@ -922,35 +1298,82 @@ inline Length HugePageFiller<TrackerType>::ReleaseCandidates(
 
   Length total_released;
   HugeLength total_broken = NHugePages(0);
-#ifndef NDEBUG
-  Length last;
-#endif
+
+  // We drop pageheap_lock around each unback syscall below; madvise can take
+  // milliseconds, and holding the lock across it stalls every allocating
+  // thread.  While release_in_progress_, Put parks emptied hugepages on
+  // deferred_return_ instead of handing them back to the page allocator,
+  // keeping our candidate pointers valid until the round completes.
+  //
+  // Two-phase releases are not reentrant (the deferral window must outlive
+  // every live candidate array), so a release that starts while another has
+  // the lock dropped falls back to releasing under the lock.
+  const bool two_phase = !release_in_progress_;
+  release_in_progress_ = two_phase;
+
   for (int i = 0; i < candidates.size() && total_released < target; i++) {
     TrackerType* best = candidates[i];
     TC_ASSERT_NE(best, nullptr);
 
-    // Verify that we have pages that we can release.
-    ASSERT(best->free_pages() != Length(0));
-    // TODO(b/73749855):  This assertion may need to be relaxed if we release
-    // the pageheap_lock here.  A candidate could change state with another
-    // thread while we have the lock released for another candidate.
-    ASSERT(best->free_pages() > best->released_pages());
-
-#ifndef NDEBUG
-    // Double check that our sorting criteria were applied correctly.
-    ASSERT(last <= best->used_pages());
-    last = best->used_pages();
-#endif
+    // A candidate's state may have changed while the lock was dropped for an
+    // earlier candidate (b/73749855).  A candidate that emptied is off the
+    // filler lists awaiting PopDeferredReturn; one with nothing left to
+    // release is not worth unlinking.  Skip both.
+    if (best->longest_free_range() == kPagesPerHugePage) continue;
+    if (best->free_pages() <= best->released_pages()) continue;
+    // Hugepages overlapping a registered pinned range never release; the
+    // syscall is wasted at best and COW-breaks the pin at worst.
+    if (best->unreleasable()) continue;
 
     if (best->unbroken()) {
       ++total_broken;
     }
     RemoveFromFillerList(best);
-    Length ret = best->ReleaseFree(unback_);
-    unmapped_ += ret;
+
+    if (two_phase) {
+      // Phase one (locked): record the ranges to release and mark them
+      // released, so concurrent readers observe a consistent tracker.
+      Bitmap<kPagesPerHugePage.raw_num()> to_release;
+      const Length expected = best->PrepareReleaseFree(&to_release);
+      unmapped_ += expected;
+      total_released += expected;
+
+      // Phase two (unlocked): the syscall.  best is off the filler lists, so
+      // no allocation can be served from the marked ranges; a concurrent Put
+      // on this tracker only unmarks pages disjoint from them.
+      best->set_releasing(true);
+      pageheap_lock.Unlock();
+      const size_t failed_index = best->ReleaseRanges(to_release, unback_);
+      pageheap_lock.Lock();
+      best->set_releasing(false);
+
+      // Phase three (locked): roll back whatever failed to release.
+      if (ABSL_PREDICT_FALSE(failed_index < kPagesPerHugePage.raw_num())) {
+        const Length undone = best->UndoReleaseFrom(to_release, failed_index);
+        TC_ASSERT_GE(unmapped_, undone);
+        TC_ASSERT_GE(total_released, undone);
+        unmapped_ -= undone;
+        total_released -= undone;
+      }
+    } else {
+      const Length ret = best->ReleaseFree(unback_);
+      unmapped_ += ret;
+      total_released += ret;
+    }
     ASSERT(unmapped_ >= best->released_pages());
-    total_released += ret;
-    AddToFillerList(best);
+
+    if (ABSL_PREDICT_FALSE(best->longest_free_range() == kPagesPerHugePage)) {
+      // best emptied while the lock was dropped; Put deferred to us as the
+      // thread holding it off the filler lists.
+      TrackerType* ret = ReleaseEmptyTracker(best);
+      TC_ASSERT_EQ(ret, nullptr);
+    } else {
+      AddToFillerList(best);
+    }
+  }
+
+  if (two_phase) {
+    release_in_progress_ = false;
   }
 
   subrelease_stats_.num_pages_subreleased += total_released;
@@ -1723,6 +2146,11 @@ inline void HugePageFiller<TrackerType>::UpdateFillerStatsTracker() {
   stats.num_hugepages_broken = subrelease_stats_.num_hugepages_broken;
   fillerstats_tracker_.Report(stats);
   subrelease_stats_.reset();
+
+  // Republish the lock-free stats snapshot.  This function is the common
+  // tail of every mutation batch, so readers observe filler state no staler
+  // than the last allocation, deallocation, or release.
+  stats_snapshot_.Publish({GetStats(), this->stats()});
 }
 
 template <class TrackerType>
@@ -1807,13 +2235,29 @@ inline void HugePageFiller<TrackerType>::AddToFillerList(TrackerType* pt) {
           ? AccessDensityPrediction::kDense
           : AccessDensityPrediction::kSparse;
 
+  // Co-locate spans by access intensity.  New allocations are overwhelmingly
+  // hot, so among equal-fit hugepages we hand out the hot ones (front of
+  // list) and park scanned-cold ones at the back.  Cold hugepages then stop
+  // receiving new spans, their remaining spans age out together, and the
+  // whole hugepage becomes a releasable unit; hot hugepages stay densely
+  // packed with hot spans and earn their TLB entry.  Without idle scanning
+  // every score is 0 and this degenerates to the historical prepend.
+  const bool cold = pt->idle_score() >= kColdPlacementScore;
+
+  auto add = [&](PageTrackerLists<kNumLists>& lists) {
+    if (cold) {
+      lists.AddTail(pt, i);
+    } else {
+      lists.Add(pt, i);
+    }
+  };
   if (!pt->released()) {
-    regular_alloc_[type].Add(pt, i);
+    add(regular_alloc_[type]);
   } else if (pt->free_pages() <= pt->released_pages()) {
-    regular_alloc_released_[type].Add(pt, i);
+    add(regular_alloc_released_[type]);
     n_used_released_[type] += pt->used_pages();
   } else {
-    regular_alloc_partial_released_[type].Add(pt, i);
+    add(regular_alloc_partial_released_[type]);
     n_used_partial_released_[type] += pt->used_pages();
   }
 }
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <random>
 #include <string>
@@ -380,6 +381,44 @@ TEST_F(PageTrackerTest, ReleasingRetainFailure) {
   EXPECT_EQ(tracker_.free_pages(), a1.n + a2.n + a3.n + a4.n);
 }
 
+TEST_F(PageTrackerTest, DirtyFreePages) {
+  static const Length kAllocSize = kPagesPerHugePage / 4;
+  SpanAllocInfo info = {1, AccessDensityPrediction::kSparse};
+  // A never-touched hugepage has no faulted pages at all.
+  EXPECT_EQ(tracker_.dirty_free_pages(), Length(0));
+
+  PAlloc a1 = Get(kAllocSize - Length(3), info);
+  PAlloc a2 = Get(kAllocSize, info);
+  PAlloc a3 = Get(kAllocSize + Length(1), info);
+  PAlloc a4 = Get(kAllocSize + Length(2), info);
+  // Allocated pages are faulted but not free.
+  EXPECT_EQ(tracker_.dirty_free_pages(), Length(0));
+
+  // Freed pages remain backed, so they are dirty until released.
+  Put(a2);
+  Put(a4);
+  EXPECT_EQ(tracker_.dirty_free_pages(), a2.n + a4.n);
+
+  // A successful release hands a2's pages back to the system, making them
+  // clean; a failed release leaves a4's pages backed and dirty.
+  ExpectPages(a2, /*success=*/true);
+  ExpectPages(a4, /*success=*/false);
+  ReleaseFree();
+  mock_.VerifyAndClear();
+  EXPECT_EQ(tracker_.dirty_free_pages(), a4.n);
+  EXPECT_EQ(tracker_.released_pages(), a2.n);
+
+  // Reallocating the released range faults it again; freeing it once more
+  // leaves it dirty.
+  PAlloc a5 = Get(a2.n, info);
+  EXPECT_EQ(tracker_.dirty_free_pages(), a4.n);
+  Put(a5);
+  EXPECT_EQ(tracker_.dirty_free_pages(), a4.n + a5.n);
+
+  Put(a1);
+  Put(a3);
+}
+
 TEST_F(PageTrackerTest, Defrag) {
   absl::BitGen rng;
   const Length N = absl::GetFlag(FLAGS_page_tracker_defrag_lim);
@@ -620,6 +659,14 @@ class BlockingUnback final : public MemoryModifyFunction {
   constexpr BlockingUnback() = default;
 
   ABSL_MUST_USE_RESULT bool operator()(void* p, size_t len) override {
+    if (release_hook_) {
+      // One-shot: clear before running so the hook may trigger further unback
+      // calls without recursing.
+      std::function<void()> hook = std::move(release_hook_);
+      release_hook_ = nullptr;
+      hook();
+    }
+
     if (!mu_) {
       return success_;
     }
@@ -635,6 +682,10 @@ class BlockingUnback final : public MemoryModifyFunction {
 
   absl::BlockingCounter* counter_ = nullptr;
   bool success_ = true;
+  // If set, run (once) on the next unback call.  The filler invokes unback
+  // with pageheap_lock dropped, so the hook may mutate the filler the way a
+  // concurrent thread would.
+  std::function<void()> release_hook_;
 
  private:
   static thread_local absl::Mutex* mu_;
@@ -904,6 +955,66 @@ TEST_P(FillerTest, Density) {
   }
 }
 
+// A hugepage the idle scan marked cold is listed behind equal-fit hot
+// hugepages, so new (presumed hot) spans land on hot hugepages and cold
+// ones drain toward a fully-releasable state.
+TEST_P(FillerTest, ColdHugePagesPlacedLast) {
+  randomize_density_ = false;
+  // Two hugepages with identical fit: one allocation each, equal free range.
+  static const Length kAlloc = kPagesPerHugePage / 2 + Length(1);
+  PAlloc a = Allocate(kAlloc);
+  PAlloc b = Allocate(kAlloc);
+  ASSERT_NE(a.pt, b.pt);
+
+  // With no idle scores the most recently listed hugepage wins the tie;
+  // anchor that here so the assertion below tests the cold bias and not
+  // insertion order.
+  PAlloc probe = Allocate(Length(1));
+  ASSERT_EQ(probe.pt, b.pt);
+
+  // Mark b cold; the Delete relists it, now at the back of the list.
+  b.pt->set_idle_score(255);
+  Delete(probe);
+
+  PAlloc hot = Allocate(Length(1));
+  EXPECT_EQ(hot.pt, a.pt);
+
+  Delete(hot);
+  Delete(a);
+  Delete(b);
+}
+
+// The lock-free stats snapshot is republished at the end of every mutation
+// batch, so after any allocation or deallocation it matches the stats
+// computed under the lock.
+TEST_P(FillerTest, StatsSnapshotMatchesLiveStats) {
+  static const Length kAlloc = kPagesPerHugePage / 2;
+  PAlloc p1 = Allocate(kAlloc - Length(1));
+  PAlloc p2 = Allocate(kAlloc + Length(1));
+
+  const HugePageFillerStats live = filler_.GetStats();
+  const auto snapshot = filler_.GetStatsSnapshot();
+  EXPECT_EQ(snapshot.filler.n_total[AccessDensityPrediction::kPredictionCounts],
+            live.n_total[AccessDensityPrediction::kPredictionCounts]);
+  EXPECT_EQ(snapshot.filler.n_full[AccessDensityPrediction::kPredictionCounts],
+            live.n_full[AccessDensityPrediction::kPredictionCounts]);
+  EXPECT_EQ(
+      snapshot.filler.n_released[AccessDensityPrediction::kPredictionCounts],
+      live.n_released[AccessDensityPrediction::kPredictionCounts]);
+
+  const BackingStats backing = filler_.stats();
+  EXPECT_EQ(snapshot.backing.system_bytes, backing.system_bytes);
+  EXPECT_EQ(snapshot.backing.free_bytes, backing.free_bytes);
+  EXPECT_EQ(snapshot.backing.unmapped_bytes, backing.unmapped_bytes);
+
+  Delete(p1);
+  Delete(p2);
+
+  // Deallocation republishes the snapshot as well.
+  EXPECT_EQ(filler_.GetStatsSnapshot().backing.system_bytes,
+            filler_.stats().system_bytes);
+}
+
 // This test makes sure that we continue releasing from regular (non-partial)
 // allocs when we enable a feature to release all free pages from partial
 // allocs.
@@ -1073,6 +1184,22 @@ TEST_P(FillerTest, ReleaseZero) {
       Length(0));
 }
 
+TEST_P(FillerTest, ReleaseSkipsUnreleasable) {
+  static const Length kAlloc = kPagesPerHugePage / 2;
+  PAlloc p1 = Allocate(kAlloc - Length(1));
+  PAlloc p2 = AllocateWithSpanAllocInfo(kAlloc + Length(1), p1.span_alloc_info);
+  Delete(p1);
+  // While the hugepage overlaps a pinned registration (see
+  // MallocExtension::MarkUnreleasable), its free pages must not be
+  // subreleased.
+  p2.pt->set_unreleasable(true);
+  EXPECT_EQ(ReleasePages(kMaxValidPages), Length(0));
+  // Deregistering makes them releasable again.
+  p2.pt->set_unreleasable(false);
+  EXPECT_EQ(ReleasePages(kMaxValidPages), kAlloc - Length(1));
+  Delete(p2);
+}
+
 void FillerTest::FragmentationTest() {
   constexpr Length kRequestLimit = Length(32);
   constexpr Length kSizeLimit = Length(512 * 1024);
@@ -2461,6 +2588,72 @@ TEST_P(FillerTest, b258965495) {
   Delete(a1);
 }
 
+// ReleasePages drops pageheap_lock while unbacking, so another thread may
+// deallocate onto the very hugepage being released.  Verify that such a Put
+// neither corrupts the filler lists nor changes what gets released, and that
+// the freed (but unreleased) page is still accounted.
+TEST_P(FillerTest, DeleteWhileReleasing) {
+  SpanAllocInfo info = {1, AccessDensityPrediction::kSparse};
+  PAlloc a1 = AllocateWithSpanAllocInfo(kPagesPerHugePage / 2, info);
+  PAlloc a2 = AllocateWithSpanAllocInfo(Length(1), info);
+  ASSERT_EQ(a1.pt, a2.pt);
+
+  // Delete a2 from inside the unback call, as a concurrent thread would.
+  blocking_unback_.release_hook_ = [&]() {
+    PageHeapSpinLockHolder l;
+    EXPECT_EQ(filler_.Put(a2.pt, a2.p, a2.n), nullptr);
+  };
+  // Only the pages that were free when the candidate was prepared are
+  // released; a2's page was freed mid-release and stays backed.
+  EXPECT_EQ(ReleasePages(kPagesPerHugePage),
+            kPagesPerHugePage / 2 - Length(1));
+  total_allocated_ -= a2.n;
+
+  EXPECT_EQ(filler_.size(), NHugePages(1));
+  EXPECT_EQ(filler_.unmapped_pages(), kPagesPerHugePage / 2 - Length(1));
+  EXPECT_EQ(filler_.used_pages(), kPagesPerHugePage / 2);
+  {
+    PageHeapSpinLockHolder l;
+    EXPECT_EQ(filler_.PopDeferredReturn(), nullptr);
+  }
+
+  // The hugepage (and its mid-release free page) remains usable.
+  EXPECT_TRUE(Delete(a1));
+}
+
+// If the last allocation on a hugepage is deleted while that hugepage is
+// being released (lock dropped), Put cannot hand it back: the releasing
+// thread still holds a pointer to the tracker.  The filler parks it for the
+// caller to collect with PopDeferredReturn instead.
+TEST_P(FillerTest, TrackerEmptiedWhileReleasing) {
+  SpanAllocInfo info = {1, AccessDensityPrediction::kSparse};
+  PAlloc a = AllocateWithSpanAllocInfo(Length(1), info);
+
+  blocking_unback_.release_hook_ = [&]() {
+    PageHeapSpinLockHolder l;
+    EXPECT_EQ(filler_.Put(a.pt, a.p, a.n), nullptr);
+  };
+  EXPECT_EQ(ReleasePages(kPagesPerHugePage), kPagesPerHugePage - Length(1));
+  total_allocated_ -= a.n;
+
+  // The emptied hugepage has left the filler and awaits collection.
+  EXPECT_EQ(filler_.size(), NHugePages(0));
+  EXPECT_EQ(filler_.unmapped_pages(), Length(0));
+  PageTracker* pt;
+  {
+    PageHeapSpinLockHolder l;
+    pt = filler_.PopDeferredReturn();
+  }
+  ASSERT_EQ(pt, a.pt);
+  EXPECT_TRUE(pt->empty());
+  {
+    PageHeapSpinLockHolder l;
+    EXPECT_EQ(filler_.PopDeferredReturn(), nullptr);
+  }
+  --hp_contained_;
+  delete pt;
+}
+
 TEST_P(FillerTest, CheckFillerStats) {
   // Skip test for single alloc as we test for non-zero hardened output.
   if (std::get<0>(GetParam()) == HugePageFillerAllocsOption::kUnifiedAllocs) {
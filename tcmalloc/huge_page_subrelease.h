@@ -371,6 +371,24 @@ class SubreleaseStatsTracker {
     return max_demand_pages;
   }
 
+  // Returns the maximum demand (in pages) observed within the most recent
+  // <interval>.  Unlike GetRecentPeak, this is a pure query: it does not
+  // record <interval> in the reported skip subrelease intervals.  It is used
+  // by the adaptive background release policy.
+  Length GetRecentDemandPeak(absl::Duration interval) {
+    Length max_demand_pages;
+    int64_t num_epochs = std::min<int64_t>(interval / epoch_length_, kEpochs);
+    tracker_.IterBackwards(
+        [&](size_t offset, int64_t ts, const SubreleaseStatsEntry& e) {
+          if (!e.empty()) {
+            max_demand_pages = std::max(
+                max_demand_pages, e.stats[kStatsAtMaxDemand].num_pages);
+          }
+        },
+        num_epochs);
+    return max_demand_pages;
+  }
+
   // Calculates demand requirements for skip subrelease: HugePageFiller would
   // not subrelease if it has less pages than (or equal to) the required
   // amount. We report that the skipping is correct if future demand is going to
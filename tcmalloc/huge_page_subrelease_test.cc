@@ -212,6 +212,22 @@ TEST_F(StatsTrackerTest, ComputeRecentPeaks) {
   EXPECT_EQ(peak4, Length(150));
 }
 
+TEST_F(StatsTrackerTest, ComputeRecentDemandPeak) {
+  GenerateDemandPoint(Length(3000), Length(1000));
+  Advance(absl::Minutes(1.25));
+  GenerateDemandPoint(Length(1500), Length(0));
+  Advance(absl::Minutes(1));
+  GenerateDemandPoint(Length(100), Length(2000));
+
+  EXPECT_EQ(tracker_.GetRecentDemandPeak(absl::Minutes(2)), Length(1500));
+  EXPECT_EQ(tracker_.GetRecentDemandPeak(absl::Minutes(5)), Length(3000));
+
+  Advance(absl::Minutes(10));
+  GenerateDemandPoint(Length(200), Length(3000));
+
+  EXPECT_EQ(tracker_.GetRecentDemandPeak(absl::Minutes(5)), Length(200));
+}
+
 TEST_F(StatsTrackerTest, ComputeRecentDemand) {
   // Generates max and min demand in each epoch to create short-term demand
   // fluctuations.
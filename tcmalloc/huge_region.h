@@ -18,6 +18,7 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <atomic>
 
 #include "absl/base/attributes.h"
 #include "absl/base/internal/cycleclock.h"
@@ -92,12 +93,16 @@ class HugeRegion : public TList<HugeRegion>::Elem {
   // Is p located in this region?
   bool contains(PageId p) { return location_.contains(p); }
 
+  // The fixed range of address space this region manages.
+  HugeRange location() const { return location_; }
+
   // Stats
   Length used_pages() const { return Length(tracker_.used()); }
   Length free_pages() const {
     return size().in_pages() - unmapped_pages() - used_pages();
   }
   Length unmapped_pages() const { return (size() - nbacked_).in_pages(); }
+  Length longest_free() const { return Length(tracker_.longest_free()); }
 
   void AddSpanStats(SmallSpanStats* small, LargeSpanStats* large) const;
 
@@ -134,8 +139,6 @@ class HugeRegion : public TList<HugeRegion>::Elem {
     return static_cast<int64_t>((aw + bw) / (a.raw_num() + b.raw_num()));
   }
 
-  Length longest_free() const { return Length(tracker_.longest_free()); }
-
   // Adjust counts of allocs-per-hugepage for [p, p + n) being added/removed.
 
   // *from_released is set to true iff [p, p + n) is currently unbacked
@@ -156,6 +159,15 @@ class HugeRegion : public TList<HugeRegion>::Elem {
   MemoryModifyFunction& unback_;
 };
 
+// Occupancy summary of one huge region, as copied by
+// HugeRegionSet::GetRegionStats for the heap layout export.
+struct HugeRegionStats {
+  HugeRange location;
+  Length used_pages;
+  Length free_pages;
+  Length unmapped_pages;
+};
+
 // Manage a set of regions from which we allocate.
 // Strategy: Allocate from the most fragmented region that fits.
 template <typename Region>
@@ -209,6 +221,36 @@ class HugeRegionSet {
   BackingStats stats() const;
   HugeLength free_backed() const;
   size_t ActiveRegions() const;
+
+  // Copies up to <max> of the address ranges managed by regions in this set
+  // into <ranges>.  Returns the total number of regions; only
+  // std::min(total, max) entries of <ranges> are written.
+  size_t GetRanges(HugeRange* ranges, size_t max) const {
+    size_t total = 0;
+    for (Region* region : list_) {
+      if (total < max) {
+        ranges[total] = region->location();
+      }
+      total++;
+    }
+    return total;
+  }
+
+  // Copies up to <max> per-region occupancy summaries into <stats>.  Returns
+  // the total number of regions; only std::min(total, max) entries of
+  // <stats> are written.
+  size_t GetRegionStats(HugeRegionStats* stats, size_t max) const {
+    size_t total = 0;
+    for (Region* region : list_) {
+      if (total < max) {
+        stats[total] = {region->location(), region->used_pages(),
+                        region->free_pages(), region->unmapped_pages()};
+      }
+      total++;
+    }
+    return total;
+  }
+
   bool UseHugeRegionMoreOften() const {
     return use_huge_region_more_often_ ==
            HugeRegionUsageOption::kUseForAllLargeAllocs;
@@ -304,11 +346,30 @@ class HugeRegionSet {
     return size;
   }
 
+  // Raises the hint to cover r's longest free range after it has grown.
+  // Mutations are serialized by pageheap_lock, so the read-modify-write below
+  // cannot race with another writer; only lock-free readers observe the hint
+  // concurrently.
+  void RaiseLongestFreeHint(Region* r) {
+    const size_t longest = r->longest_free().raw_num();
+    if (longest > longest_free_hint_.load(std::memory_order_relaxed)) {
+      longest_free_hint_.store(longest, std::memory_order_relaxed);
+    }
+  }
+
   size_t n_;
   HugeRegionUsageOption use_huge_region_more_often_;
   // Sorted by longest_free increasing.
   TList<Region> list_;
 
+  // Conservative upper bound on longest_free across all regions, readable
+  // without any lock.  MaybeGet uses it as a first-fit feasibility check so
+  // requests no region can serve fail without probing the trackers.  The hint
+  // is raised whenever a region's longest free range grows (Contribute,
+  // MaybePut) and lowered to the true maximum when a full scan fails; it may
+  // be stale-high in between, which only costs a scan, never correctness.
+  std::atomic<size_t> longest_free_hint_{0};
+
   // Computes the recent demand to compute the number of pages that may be
   // released. <desired> determines an upper-bound on the number of pages to
   // release.
@@ -652,13 +713,25 @@ inline void HugeRegionSet<Region>::UpdateStatsTracker() {
 template <typename Region>
 inline bool HugeRegionSet<Region>::MaybeGet(Length n, PageId* page,
                                             bool* from_released) {
+  // Fast rejection without touching any region: the hint is an upper bound
+  // on the longest free range anywhere in the set, so a request exceeding it
+  // cannot be served and the caller can move straight to its fallback.
+  if (n.raw_num() > longest_free_hint_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  Length max_longest_free;
   for (Region* region : list_) {
     if (region->MaybeGet(n, page, from_released)) {
       Fix(region);
       UpdateStatsTracker();
       return true;
     }
+    max_longest_free = std::max(max_longest_free, region->longest_free());
   }
+  // The scan visited every region, so refresh the hint to the true maximum;
+  // this repairs any staleness accumulated since ranges last shrank.
+  longest_free_hint_.store(max_longest_free.raw_num(),
+                           std::memory_order_relaxed);
   return false;
 }
 
@@ -673,6 +746,7 @@ inline bool HugeRegionSet<Region>::MaybePut(PageId p, Length n) {
     if (region->contains(p)) {
       region->Put(p, n, release);
       Fix(region);
+      RaiseLongestFreeHint(region);
       UpdateStatsTracker();
       return true;
     }
@@ -686,6 +760,7 @@ template <typename Region>
 inline void HugeRegionSet<Region>::Contribute(Region* region) {
   n_++;
   AddToList(region);
+  RaiseLongestFreeHint(region);
   UpdateStatsTracker();
 }
 
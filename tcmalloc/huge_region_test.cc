@@ -598,6 +598,45 @@ TEST_P(HugeRegionSetTest, Release) {
   EXPECT_EQ(stats.unmapped_bytes, stats.system_bytes);
 }
 
+// The set keeps a lock-free upper bound on the longest free range to reject
+// unsatisfiable requests quickly.  It must never wrongly reject: whenever
+// capacity comes back (a free, a new region), allocation must succeed again.
+TEST_P(HugeRegionSetTest, LongestFreeHintTracksCapacity) {
+  PageId p;
+  constexpr Length kSize = kPagesPerHugePage + Length(1);
+  bool from_released;
+  // Empty set: nothing to serve.
+  ASSERT_FALSE(set_.MaybeGet(Length(1), &p, &from_released));
+
+  auto r1 = GetRegion();
+  set_.Contribute(r1.get());
+
+  // Drain the region completely, then verify requests fail.
+  std::vector<Alloc> allocs;
+  while (set_.MaybeGet(kSize, &p, &from_released)) {
+    allocs.push_back({p, kSize});
+  }
+  ASSERT_FALSE(set_.MaybeGet(kSize, &p, &from_released));
+
+  // Freeing restores capacity; the same request must succeed again.
+  Delete(allocs.back());
+  allocs.pop_back();
+  ASSERT_TRUE(set_.MaybeGet(kSize, &p, &from_released));
+  allocs.push_back({p, kSize});
+
+  // A fresh region must make even region-sized requests feasible.
+  ASSERT_FALSE(
+      set_.MaybeGet(Region::size().in_pages(), &p, &from_released));
+  auto r2 = GetRegion();
+  set_.Contribute(r2.get());
+  ASSERT_TRUE(set_.MaybeGet(Region::size().in_pages(), &p, &from_released));
+  set_.MaybePut(p, Region::size().in_pages());
+
+  for (auto a : allocs) {
+    Delete(a);
+  }
+}
+
 // Tests that HugeRegions releases all pages in free hugepages when
 // skip-subrelease intervals are not set.
 TEST_P(HugeRegionSetTest, ReleasePagesWithoutIntervals) {
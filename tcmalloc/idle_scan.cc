@@ -0,0 +1,98 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/idle_scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/pageidle.h"
+#include "tcmalloc/page_allocator.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+size_t ScanIdleHugePages(size_t max_hugepages) {
+  // Only the background thread calls this; the scanner and cursor carry
+  // state from tick to tick.
+  static PageIdleScanner scanner;
+  static uintptr_t cursor = 0;  // PageId index of the next page to visit.
+
+  if (!scanner.ok()) {
+    return 0;
+  }
+
+  size_t scanned = 0;
+  bool wrapped = false;
+  while (scanned < max_hugepages) {
+    const std::optional<PageId> next =
+        tc_globals.pagemap().NextSetPage(PageId{cursor});
+    if (!next.has_value()) {
+      // End of the heap; resume from the bottom, but at most once per call
+      // so an empty heap does not spin.
+      if (wrapped) break;
+      wrapped = true;
+      cursor = 0;
+      continue;
+    }
+
+    const HugePage hp = HugePageContaining(next->start_addr());
+    cursor = hp.first_page().index() + kPagesPerHugePage.raw_num();
+
+    // Only the normal heap's filler-managed hugepages carry scores; cold
+    // and sampled heaps have their own lifecycle, and region- or
+    // cache-backed hugepages have no tracker.  The lock-free sidecar probe
+    // filters cheaply; the authoritative lookup below revalidates under the
+    // lock.
+    const MemoryTag tag = GetMemoryTag(hp.start_addr());
+    if (tag != MemoryTag::kNormalP0 && tag != MemoryTag::kNormalP1) {
+      continue;
+    }
+    if (tc_globals.pagemap().TryGetHugepage(hp.first_page()) == nullptr) {
+      continue;
+    }
+
+    // Read last sweep's idle bits and re-mark for the next one.  The
+    // syscalls run without any allocator lock; only publishing the score
+    // takes pageheap_lock.
+    const std::optional<PageIdleScanner::Result> result =
+        scanner.ScanAndRemark(hp.start_addr(), kHugePageSize);
+    if (!result.has_value()) {
+      break;
+    }
+    ++scanned;
+    if (result->pages_scanned == 0) {
+      continue;
+    }
+    const uint8_t score =
+        static_cast<uint8_t>(255 * result->pages_idle / result->pages_scanned);
+    {
+      PageHeapSpinLockHolder l;
+      tc_globals.page_allocator().SetFillerIdleScoreContaining(hp.first_page(),
+                                                               tag, score);
+    }
+  }
+  return scanned;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
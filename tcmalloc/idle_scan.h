@@ -0,0 +1,53 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Incremental idleness scanning over the filler's hugepages.  Release
+// policies otherwise infer coldness from allocation age, which mis-releases
+// hugepages that are old but hot (e.g. under checkpoint load).  When
+// Parameters::page_idle_scan_enabled() is set, the background thread sweeps
+// a bounded batch of hugepages per tick from a persistent cursor, reads each
+// page's true kernel access bit via /sys/kernel/mm/page_idle/bitmap, and
+// publishes a per-tracker coldness score
+// (PageTracker::idle_score()) that the subrelease candidate ordering
+// consumes.  The scan amortizes over ticks, so even 100+ GB heaps see a full
+// sweep every few minutes without a visible CPU spike.
+
+#ifndef TCMALLOC_IDLE_SCAN_H_
+#define TCMALLOC_IDLE_SCAN_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// How many hugepages each background tick scans at most; one batch touches
+// at most this many hugepages' worth of pagemap and idle-bitmap words.
+inline constexpr size_t kIdleScanHugePagesPerTick = 512;
+
+// Scans up to max_hugepages filler-managed hugepages starting at the cursor
+// left by the previous call, wrapping at the end of the address space, and
+// stores their coldness scores on the owning trackers.  Returns the number
+// of hugepages scanned; permanently returns 0 when the kernel interfaces
+// are unavailable (no page_idle support, or insufficient privilege to read
+// frame numbers).  Must be called from a single thread.
+size_t ScanIdleHugePages(size_t max_hugepages);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_IDLE_SCAN_H_
@@ -20,5 +20,8 @@
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc::tcmalloc_internal {
 
+ABSL_CONST_INIT thread_local int allocation_guard_depth
+    ABSL_ATTRIBUTE_INITIAL_EXEC = 0;
+
 }  // namespace tcmalloc::tcmalloc_internal
 GOOGLE_MALLOC_SECTION_END
@@ -23,11 +23,25 @@
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc::tcmalloc_internal {
 
+// Depth of nested AllocationGuard regions on the calling thread.  Nonzero
+// means this thread is inside a section that must not allocate, typically
+// because it holds an allocator lock.  An allocation observed at nonzero
+// depth is therefore a reentrant call, which only legitimately happens when
+// a signal handler interrupts the guarded section; the allocation slow paths
+// consult InAllocationGuard() and route such requests to the per-thread
+// signal-safe pool (signal_safe_allocation.h) instead of taking locks.
+// Initial-exec keeps the access a direct TLS load, safe from signal context.
+ABSL_CONST_INIT extern thread_local int allocation_guard_depth
+    ABSL_ATTRIBUTE_INITIAL_EXEC;
+
 // TODO(b/143069684): actually ensure no allocations in debug mode here.
 struct AllocationGuard {
-  AllocationGuard() {}
+  AllocationGuard() { ++allocation_guard_depth; }
+  ~AllocationGuard() { --allocation_guard_depth; }
 };
 
+inline bool InAllocationGuard() { return allocation_guard_depth > 0; }
+
 // A SpinLockHolder that also enforces no allocations while the lock is held in
 // debug mode.
 class ABSL_SCOPED_LOCKABLE AllocationGuardSpinLockHolder {
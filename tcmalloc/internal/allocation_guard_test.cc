@@ -23,6 +23,20 @@
 namespace tcmalloc::tcmalloc_internal {
 namespace {
 
+TEST(AllocationGuard, TracksNestedDepth) {
+  EXPECT_FALSE(InAllocationGuard());
+  {
+    AllocationGuard outer;
+    EXPECT_TRUE(InAllocationGuard());
+    {
+      AllocationGuard inner;
+      EXPECT_TRUE(InAllocationGuard());
+    }
+    EXPECT_TRUE(InAllocationGuard());
+  }
+  EXPECT_FALSE(InAllocationGuard());
+}
+
 TEST(AllocationGuard, Noncooperative) {
   absl::base_internal::SpinLock lock(absl::kConstInit,
                                      absl::base_internal::SCHEDULE_KERNEL_ONLY);
@@ -16,9 +16,12 @@
 #define TCMALLOC_INTERNAL_ATOMIC_STATS_COUNTER_H_
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 
+#include "absl/base/optimization.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/percpu.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
@@ -67,6 +70,57 @@ class StatsCounter {
   std::atomic<Value> value_;
 };
 
+// A StatsCounter distributed across cache-line-separated shards indexed by
+// the calling CPU.  A hot counter updated from many CPUs at once true-shares
+// a single word; sharding spreads the writes so each CPU mostly stays on its
+// own line, and readers fold the shards on demand.  Counts are exactly as
+// lossy as the underlying StatsCounter calls.
+class ShardedStatsCounter {
+ public:
+  constexpr ShardedStatsCounter() = default;
+  ShardedStatsCounter(const ShardedStatsCounter&) = delete;
+  ShardedStatsCounter& operator=(const ShardedStatsCounter&) = delete;
+
+  using Value = StatsCounter::Value;
+
+  // See StatsCounter::Add.
+  void Add(Value increment) { shard().Add(increment); }
+
+  // See StatsCounter::LossyAdd.
+  void LossyAdd(Value increment) { shard().LossyAdd(increment); }
+
+  // Returns the sum over all shards.
+  Value value() const {
+    Value sum = 0;
+    for (const Shard& shard : shards_) {
+      sum += shard.counter.value();
+    }
+    return sum;
+  }
+
+ private:
+  // Enough shards to keep concurrent writers off each other's cache lines,
+  // few enough that an instance stays small and folding on the read side
+  // stays cheap.  CPUs map onto shards by masking, so this must be a power
+  // of two.
+  static constexpr size_t kShards = 8;
+  static_assert((kShards & (kShards - 1)) == 0,
+                "kShards must be a power of two");
+
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    StatsCounter counter;
+  };
+
+  StatsCounter& shard() {
+    // RseqCpuId() is negative before rseq registration (and without rseq
+    // support); those callers share shard 0.
+    const int cpu = subtle::percpu::RseqCpuId();
+    return shards_[cpu < 0 ? 0 : cpu & (kShards - 1)].counter;
+  }
+
+  Shard shards_[kShards];
+};
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -17,6 +17,10 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/cycleclock.h"
 #include "tcmalloc/internal/config.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
@@ -34,6 +38,41 @@ struct Clock {
   double (*freq)();
 };
 
+// A coarse cycle clock.  Now() returns the CycleClock reading most recently
+// published by Update(), which the background thread calls once per loop
+// iteration, so epoch/interval bookkeeping near allocation paths pays a
+// relaxed load instead of a cycle-counter read.  Readings are in CycleClock
+// ticks and compare and subtract directly against CycleClock::Now();
+// resolution is the publisher's cadence (about a second).  Until the first
+// publication Now() falls through to the cycle counter, so intervals in a
+// young process are not measured from zero.
+class CoarseClock {
+ public:
+  static int64_t Now() {
+    const int64_t tick = tick_.load(std::memory_order_relaxed);
+    return tick != 0 ? tick : absl::base_internal::CycleClock::Now();
+  }
+
+  static double Frequency() {
+    return absl::base_internal::CycleClock::Frequency();
+  }
+
+  // The pluggable-clock view, for trackers that take a Clock.
+  static constexpr Clock AsClock() {
+    return Clock{.now = &Now, .freq = &Frequency};
+  }
+
+  // Publishes the current cycle counter.  Called by the background thread;
+  // anyone may call it to tighten resolution around a burst of readings.
+  static void Update() {
+    tick_.store(absl::base_internal::CycleClock::Now(),
+                std::memory_order_relaxed);
+  }
+
+ private:
+  ABSL_CONST_INIT static inline std::atomic<int64_t> tick_{0};
+};
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,57 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/internal/clock.h"
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+#include "absl/base/internal/cycleclock.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(CoarseClockTest, HoldsPublishedTickUntilNextUpdate) {
+  CoarseClock::Update();
+  const int64_t t1 = CoarseClock::Now();
+  // Time does not advance between publications, no matter how much the
+  // cycle counter does.
+  while (absl::base_internal::CycleClock::Now() - t1 < 1000) {
+  }
+  EXPECT_EQ(CoarseClock::Now(), t1);
+
+  CoarseClock::Update();
+  EXPECT_GT(CoarseClock::Now(), t1);
+}
+
+TEST(CoarseClockTest, InterchangeableWithCycleClock) {
+  // Readings are CycleClock ticks: a published tick is bounded by cycle
+  // counter readings around it, and the frequency is the cycle frequency.
+  const int64_t before = absl::base_internal::CycleClock::Now();
+  CoarseClock::Update();
+  const int64_t after = absl::base_internal::CycleClock::Now();
+  EXPECT_GE(CoarseClock::Now(), before);
+  EXPECT_LE(CoarseClock::Now(), after);
+  EXPECT_EQ(CoarseClock::Frequency(),
+            absl::base_internal::CycleClock::Frequency());
+
+  const Clock clock = CoarseClock::AsClock();
+  EXPECT_EQ(clock.now(), CoarseClock::Now());
+  EXPECT_EQ(clock.freq(), CoarseClock::Frequency());
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -0,0 +1,172 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Wait-time telemetry for TCMalloc's internal spinlocks.  Contended
+// acquisitions record how long they spun into per-lock histograms of
+// log2(cycles) buckets, so a stats scrape can tell which lock serializes a
+// workload and how badly, without attaching a profiler.
+//
+// The instrumentation is designed to stay on in production: the uncontended
+// path costs a single TryLock (the same compare-and-swap Lock() starts with),
+// and the contended path adds two cycle-counter reads plus relaxed counter
+// updates striped by CPU to avoid bouncing the telemetry cachelines between
+// the very threads that are already fighting over a lock.
+
+#ifndef TCMALLOC_INTERNAL_LOCK_TELEMETRY_H_
+#define TCMALLOC_INTERNAL_LOCK_TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/cycleclock.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/numeric/bits.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/percpu.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc::tcmalloc_internal {
+
+// The locks we keep telemetry for.  The transfer cache slot covers both the
+// unsharded and the sharded transfer caches, which share one lock class.
+enum class LockId : int {
+  kPageHeap = 0,
+  kCentralFreeList,
+  kTransferCache,
+};
+
+class LockTelemetry {
+ public:
+  static constexpr int kNumIds = static_cast<int>(LockId::kTransferCache) + 1;
+  // Waits are bucketed by bit_width(cycles): bucket b counts waits of
+  // [2^(b-1), 2^b) cycles, with the last bucket absorbing everything longer
+  // (2^26 cycles is roughly 20ms on contemporary hardware).
+  static constexpr int kNumBuckets = 28;
+
+  constexpr LockTelemetry() = default;
+
+  LockTelemetry(const LockTelemetry&) = delete;
+  LockTelemetry& operator=(const LockTelemetry&) = delete;
+
+  void RecordWait(LockId id, uint64_t cycles) {
+    const int cpu = subtle::percpu::RseqCpuId();
+    Counters& c = shards_[cpu >= 0 ? (cpu & (kNumShards - 1)) : 0]
+                      .locks[static_cast<int>(id)];
+    c.waits.fetch_add(1, std::memory_order_relaxed);
+    c.wait_cycles.fetch_add(cycles, std::memory_order_relaxed);
+    const int bucket =
+        std::min<int>(absl::bit_width(cycles), kNumBuckets - 1);
+    c.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Aggregated counts; each is a sum over CPU stripes of relaxed counters, so
+  // values from concurrent scrapes are approximate but monotone.
+  uint64_t waits(LockId id) const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+      total += shard.locks[static_cast<int>(id)].waits.load(
+          std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  uint64_t wait_cycles(LockId id) const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+      total += shard.locks[static_cast<int>(id)].wait_cycles.load(
+          std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  uint64_t bucket(LockId id, int b) const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+      total += shard.locks[static_cast<int>(id)].buckets[b].load(
+          std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  // Enough stripes that the per-socket CPUs fighting over a lock mostly land
+  // on different telemetry cachelines; power of two for cheap indexing.
+  static constexpr int kNumShards = 16;
+
+  struct Counters {
+    std::atomic<uint64_t> waits{0};
+    std::atomic<uint64_t> wait_cycles{0};
+    std::atomic<uint64_t> buckets[kNumBuckets] = {};
+  };
+
+  struct ABSL_CACHELINE_ALIGNED Shard {
+    Counters locks[kNumIds];
+  };
+
+  Shard shards_[kNumShards];
+};
+
+ABSL_CONST_INIT extern LockTelemetry lock_telemetry;
+
+// Acquires `lock`, recording the spin time under `id` when the uncontended
+// fast path fails.  Thread-safety analysis is suppressed for the body because
+// it acquires the lock on one of two paths; callers see a plain exclusive
+// lock function.
+inline void LockWithTelemetry(absl::base_internal::SpinLock& lock, LockId id)
+    ABSL_EXCLUSIVE_LOCK_FUNCTION(lock) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  if (ABSL_PREDICT_TRUE(lock.TryLock())) {
+    return;
+  }
+  const int64_t start = absl::base_internal::CycleClock::Now();
+  lock.Lock();
+  lock_telemetry.RecordWait(
+      id, static_cast<uint64_t>(absl::base_internal::CycleClock::Now() -
+                                start));
+}
+
+// Drop-in replacement for absl::base_internal::SpinLockHolder that feeds the
+// wait-time telemetry.  Like AllocationGuardSpinLockHolder, it holds an
+// AllocationGuard: the instrumented locks sit on allocation paths, so the
+// no-allocation assertion and the reentrant signal-context routing that the
+// guard provides must survive the swap to the telemetry holder.
+class ABSL_SCOPED_LOCKABLE TelemetrySpinLockHolder {
+ public:
+  TelemetrySpinLockHolder(absl::base_internal::SpinLock* lock, LockId id)
+      ABSL_EXCLUSIVE_LOCK_FUNCTION(lock)
+      : lock_(lock) {
+    LockWithTelemetry(*lock, id);
+  }
+
+  ~TelemetrySpinLockHolder() ABSL_UNLOCK_FUNCTION() { lock_->Unlock(); }
+
+  TelemetrySpinLockHolder(const TelemetrySpinLockHolder&) = delete;
+  TelemetrySpinLockHolder& operator=(const TelemetrySpinLockHolder&) = delete;
+
+ private:
+  absl::base_internal::SpinLock* lock_;
+  // In debug mode, enforces no allocations.
+  AllocationGuard enforce_no_alloc_;
+};
+
+}  // namespace tcmalloc::tcmalloc_internal
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_INTERNAL_LOCK_TELEMETRY_H_
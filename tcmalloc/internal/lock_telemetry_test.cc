@@ -0,0 +1,85 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/internal/lock_telemetry.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "absl/base/const_init.h"
+#include "absl/base/internal/spinlock.h"
+
+namespace tcmalloc::tcmalloc_internal {
+namespace {
+
+TEST(LockTelemetryTest, RecordWaitAccumulates) {
+  LockTelemetry telemetry;
+  EXPECT_EQ(telemetry.waits(LockId::kPageHeap), 0);
+
+  telemetry.RecordWait(LockId::kPageHeap, 100);
+  telemetry.RecordWait(LockId::kPageHeap, 1000);
+  EXPECT_EQ(telemetry.waits(LockId::kPageHeap), 2);
+  EXPECT_EQ(telemetry.wait_cycles(LockId::kPageHeap), 1100);
+  // Other locks are unaffected.
+  EXPECT_EQ(telemetry.waits(LockId::kCentralFreeList), 0);
+  EXPECT_EQ(telemetry.waits(LockId::kTransferCache), 0);
+}
+
+TEST(LockTelemetryTest, Buckets) {
+  LockTelemetry telemetry;
+
+  // bit_width(100) == 7, bit_width(1000) == 10.
+  telemetry.RecordWait(LockId::kCentralFreeList, 100);
+  telemetry.RecordWait(LockId::kCentralFreeList, 1000);
+  // Longer than any bucket boundary lands in the last bucket.
+  telemetry.RecordWait(LockId::kCentralFreeList, UINT64_C(1) << 60);
+
+  EXPECT_EQ(telemetry.bucket(LockId::kCentralFreeList, 7), 1);
+  EXPECT_EQ(telemetry.bucket(LockId::kCentralFreeList, 10), 1);
+  EXPECT_EQ(telemetry.bucket(LockId::kCentralFreeList,
+                             LockTelemetry::kNumBuckets - 1),
+            1);
+
+  uint64_t total = 0;
+  for (int b = 0; b < LockTelemetry::kNumBuckets; ++b) {
+    total += telemetry.bucket(LockId::kCentralFreeList, b);
+  }
+  EXPECT_EQ(total, telemetry.waits(LockId::kCentralFreeList));
+}
+
+TEST(LockTelemetryTest, UncontendedLockRecordsNothing) {
+  absl::base_internal::SpinLock lock(absl::kConstInit,
+                                     absl::base_internal::SCHEDULE_KERNEL_ONLY);
+  const uint64_t waits_before = lock_telemetry.waits(LockId::kPageHeap);
+
+  LockWithTelemetry(lock, LockId::kPageHeap);
+  EXPECT_FALSE(lock.TryLock());
+  lock.Unlock();
+
+  EXPECT_EQ(lock_telemetry.waits(LockId::kPageHeap), waits_before);
+}
+
+TEST(LockTelemetryTest, HolderAcquiresAndReleases) {
+  absl::base_internal::SpinLock lock(absl::kConstInit,
+                                     absl::base_internal::SCHEDULE_KERNEL_ONLY);
+  {
+    TelemetrySpinLockHolder h(&lock, LockId::kTransferCache);
+    EXPECT_FALSE(lock.TryLock());
+  }
+  EXPECT_TRUE(lock.TryLock());
+  lock.Unlock();
+}
+
+}  // namespace
+}  // namespace tcmalloc::tcmalloc_internal
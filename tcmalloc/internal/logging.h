@@ -92,6 +92,10 @@ struct StackTrace {
   // Timestamp of allocation.
   absl::Time allocation_time;
 
+  // NUMA node of the CPU this allocation was sampled on, or -1 when the
+  // kernel could not tell us (e.g. no NUMA support).
+  int allocating_numa_node = -1;
+
   // If not nullptr, this is the start address of the span corresponding to this
   // sampled allocation. This may be nullptr for cases where it is not useful
   // for residency analysis such as for peakheapz.
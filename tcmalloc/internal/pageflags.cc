@@ -24,10 +24,13 @@
 #include <cinttypes>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <optional>
 
 #include "absl/base/optimization.h"
 #include "absl/status/status.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/util.h"
@@ -74,6 +77,9 @@ void MaybeAddToStats(PageFlags::PageStats& stats, const uint64_t flags,
                      const size_t delta) {
   if (PageStale(flags)) stats.bytes_stale += delta;
   if (PageLocked(flags)) stats.bytes_locked += delta;
+  // Tail pages are accounted with the flags of their head page, which carries
+  // KPF_THP, so compound pages of either kind count as hugepage-backed.
+  if (PageThp(flags)) stats.bytes_huge += delta;
 }
 
 }  // namespace
@@ -283,6 +289,73 @@ std::optional<PageFlags::PageStats> PageFlags::Get(const void* const addr,
   return ret;
 }
 
+std::optional<ThpStats> GetThpStats() {
+  const int fd = signal_safe_open("/proc/vmstat", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+
+  ThpStats stats;
+  bool found = false;
+  // The THP counters sit near the end of /proc/vmstat, so stream the file
+  // through a fixed buffer rather than hoping one read captures them.
+  char buf[4096];
+  size_t carry = 0;
+  for (;;) {
+    const ssize_t rc =
+        signal_safe_read(fd, buf + carry, sizeof(buf) - carry, nullptr);
+    if (rc < 0) {
+      signal_safe_close(fd);
+      return std::nullopt;
+    }
+    const absl::string_view contents(buf, carry + static_cast<size_t>(rc));
+    size_t pos = 0;
+    for (;;) {
+      const size_t newline = contents.find('\n', pos);
+      if (newline == absl::string_view::npos) {
+        break;
+      }
+      const absl::string_view line = contents.substr(pos, newline - pos);
+      pos = newline + 1;
+      const size_t space = line.find(' ');
+      if (space == absl::string_view::npos) {
+        continue;
+      }
+      const absl::string_view key = line.substr(0, space);
+      uint64_t value;
+      if (!absl::SimpleAtoi(line.substr(space + 1), &value)) {
+        continue;
+      }
+      if (key == "thp_fault_alloc") {
+        stats.fault_alloc = value;
+        found = true;
+      } else if (key == "thp_fault_fallback") {
+        stats.fault_fallback = value;
+        found = true;
+      } else if (key == "thp_split_page") {
+        stats.split_page = value;
+        found = true;
+      }
+    }
+    // Keep any trailing partial line for the next read.  A line that
+    // overflows the whole buffer cannot be one of the counters we want.
+    carry = contents.size() - pos;
+    if (carry == sizeof(buf)) {
+      carry = 0;
+    } else {
+      memmove(buf, buf + pos, carry);
+    }
+    if (rc == 0) {
+      break;
+    }
+  }
+  signal_safe_close(fd);
+  if (!found) {
+    return std::nullopt;
+  }
+  return stats;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -52,11 +52,14 @@ class PageFlags {
   struct PageStats {
     size_t bytes_stale = 0;
     size_t bytes_locked = 0;
+    // Bytes backed by transparent hugepages (head or tail pages of a THP).
+    size_t bytes_huge = 0;
 
     // This is currently used only by tests. It'll be good to convert this to
     // C++20 "= default" when we increase the baseline compiler requirement.
     bool operator==(const PageStats& rhs) const {
-      return bytes_stale == rhs.bytes_stale && bytes_locked == rhs.bytes_locked;
+      return bytes_stale == rhs.bytes_stale &&
+             bytes_locked == rhs.bytes_locked && bytes_huge == rhs.bytes_huge;
     }
 
     bool operator!=(const PageStats& rhs) const { return !(*this == rhs); }
@@ -113,6 +116,20 @@ class PageFlags {
   const int fd_;
 };
 
+// System-wide transparent hugepage counters from /proc/vmstat.  Values are
+// cumulative since boot; callers difference successive snapshots to observe
+// rates.
+struct ThpStats {
+  uint64_t fault_alloc = 0;     // faults that were served by a fresh THP
+  uint64_t fault_fallback = 0;  // faults where no THP was available
+  uint64_t split_page = 0;      // THPs split back into native pages
+};
+
+// Reads ThpStats from /proc/vmstat.  Returns std::nullopt if the file or the
+// THP counters are unavailable.  Performs no dynamic allocation, so it is
+// safe to call from malloc-internal maintenance paths.
+std::optional<ThpStats> GetThpStats();
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -68,11 +68,12 @@ class PageFlagsFriend {
 
 std::ostream& operator<<(std::ostream& os, const PageFlags::PageStats& s) {
   return os << "{ stale = " << s.bytes_stale << ", locked = " << s.bytes_locked
-            << "}";
+            << ", huge = " << s.bytes_huge << "}";
 }
 
 namespace {
 
+using ::testing::_;
 using ::testing::FieldsAre;
 using ::testing::Optional;
 using PageStats = PageFlags::PageStats;
@@ -216,26 +217,26 @@ TEST(PageFlagsTest, Stale) {
         // only passing when the machine you get scheduled on is out of
         // hugepages.
         EXPECT_THAT(mocks.Get(nullptr, num_pages * kPageSize + offset),
-                    Optional(FieldsAre(num_pages * kPageSize + offset, 0)))
+                    Optional(FieldsAre(num_pages * kPageSize + offset, 0, _)))
             << num_pages << "," << offset;
 
         EXPECT_THAT(
             mocks.Get((char*)fake_p - offset, num_pages * kPageSize + offset),
-            Optional(FieldsAre(num_pages * kPageSize + offset, 0)))
+            Optional(FieldsAre(num_pages * kPageSize + offset, 0, _)))
             << num_pages << "," << offset;
 
         EXPECT_THAT(mocks.Get(fake_p, num_pages * kPageSize + offset),
-                    Optional(FieldsAre(num_pages * kPageSize + offset, 0)))
+                    Optional(FieldsAre(num_pages * kPageSize + offset, 0, _)))
             << num_pages << "," << offset;
 
         EXPECT_THAT(
             mocks.Get((char*)fake_p + offset, num_pages * kPageSize + offset),
-            Optional(FieldsAre(num_pages * kPageSize + offset, 0)))
+            Optional(FieldsAre(num_pages * kPageSize + offset, 0, _)))
             << num_pages << "," << offset;
 
         EXPECT_THAT(
             mocks.Get((char*)kHugePageSize + offset, num_pages * kPageSize),
-            Optional(FieldsAre(num_pages * kPageSize, 0)))
+            Optional(FieldsAre(num_pages * kPageSize, 0, _)))
             << num_pages << "," << offset;
       }
     }
@@ -243,7 +244,7 @@ TEST(PageFlagsTest, Stale) {
     EXPECT_THAT(mocks.Get(reinterpret_cast<char*>(2 * kHugePageSize +
                                                   16 * kPageSize + 2),
                           kHugePageSize * 3),
-                Optional(FieldsAre(kHugePageSize * 3, 0)));
+                Optional(FieldsAre(kHugePageSize * 3, 0, _)));
   }
 
   ASSERT_EQ(munmap(p, kNumPages * kPageSize), 0) << errno;
@@ -355,12 +356,12 @@ TEST(PageFlagsTest, TooManyTails) {
 
   PageFlagsFriend s(file_path.c_str());
   EXPECT_THAT(s.Get(reinterpret_cast<char*>(kHugePageSize), kHugePageSize),
-              Optional(PageStats{}));
+              Optional(PageStats{0, 0, kHugePageSize}));
   EXPECT_THAT(s.Get(reinterpret_cast<char*>(kHugePageSize), 3 * kHugePageSize),
-              Optional(PageStats{}));
+              Optional(PageStats{0, 0, 3 * kHugePageSize}));
 
   EXPECT_THAT(s.Get(reinterpret_cast<char*>(3 * kHugePageSize), kHugePageSize),
-              Optional(PageStats{}));
+              Optional(PageStats{0, 0, kHugePageSize}));
   EXPECT_THAT(
       s.Get(reinterpret_cast<char*>(3 * kHugePageSize), 2 * kHugePageSize),
       std::nullopt);
@@ -405,6 +406,20 @@ TEST(PageFlagsTest, CannotSeek) {
   EXPECT_FALSE(s.Get(&s, 1).has_value());
 }
 
+TEST(ThpStatsTest, Smoke) {
+  // /proc/vmstat carries THP counters only on kernels built with THP support;
+  // just require that a successful read stays consistent with itself.
+  std::optional<ThpStats> stats = GetThpStats();
+  if (!stats.has_value()) {
+    GTEST_SKIP() << "THP counters not available";
+  }
+  std::optional<ThpStats> again = GetThpStats();
+  ASSERT_TRUE(again.has_value());
+  EXPECT_GE(again->fault_alloc, stats->fault_alloc);
+  EXPECT_GE(again->fault_fallback, stats->fault_fallback);
+  EXPECT_GE(again->split_page, stats->split_page);
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
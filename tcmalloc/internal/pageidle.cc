@@ -0,0 +1,140 @@
+// Copyright 2019 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/internal/pageidle.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <optional>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/util.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// From fs/proc/task_mmu.c: bit 63 is PM_PRESENT, bits 0-54 hold the PFN.
+constexpr uint64_t kPagemapPresent = uint64_t{1} << 63;
+constexpr uint64_t kPagemapPfnMask = (uint64_t{1} << 55) - 1;
+
+}  // namespace
+
+PageIdleScanner::PageIdleScanner()
+    : pagemap_fd_(signal_safe_open("/proc/self/pagemap", O_RDONLY)),
+      bitmap_fd_(
+          signal_safe_open("/sys/kernel/mm/page_idle/bitmap", O_RDWR)) {}
+
+PageIdleScanner::PageIdleScanner(const char* const pagemap_filename,
+                                 const char* const bitmap_filename)
+    : pagemap_fd_(signal_safe_open(pagemap_filename, O_RDONLY)),
+      bitmap_fd_(signal_safe_open(bitmap_filename, O_RDWR)) {}
+
+PageIdleScanner::~PageIdleScanner() {
+  if (pagemap_fd_ >= 0) {
+    signal_safe_close(pagemap_fd_);
+  }
+  if (bitmap_fd_ >= 0) {
+    signal_safe_close(bitmap_fd_);
+  }
+}
+
+std::optional<PageIdleScanner::Result> PageIdleScanner::ScanAndRemark(
+    const void* const addr, const size_t size) {
+  if (!ok()) {
+    return std::nullopt;
+  }
+
+  Result result;
+  if (size == 0) return result;
+
+  const uintptr_t uaddr = reinterpret_cast<uintptr_t>(addr);
+  const uintptr_t base_page = uaddr & ~(kPageSize - 1);
+  const uintptr_t end_page = (uaddr + size + kPageSize - 1) & ~(kPageSize - 1);
+  int64_t remaining_pages = (end_page - base_page) / kPageSize;
+  uintptr_t vaddr = base_page;
+
+  // The idle bitmap holds one bit per PFN, 64 PFNs per 64-bit word.  We
+  // read and write back one word at a time, coalescing pages that land in
+  // the same word; a hugepage-backed range is physically contiguous, so a
+  // whole batch typically touches only a handful of words.
+  off_t pending_word_offset = -1;
+  uint64_t pending_word = 0;
+  uint64_t pending_mask = 0;
+  const auto flush_pending = [&]() {
+    if (pending_word_offset < 0) {
+      return;
+    }
+    // Writes only act on set bits, so this re-marks just our pages idle.
+    (void)pwrite(bitmap_fd_, &pending_mask, sizeof(pending_mask),
+                 pending_word_offset);
+    pending_word_offset = -1;
+  };
+
+  while (remaining_pages > 0) {
+    const int64_t batch_pages =
+        std::min<int64_t>(remaining_pages, kEntriesInBuf);
+    const size_t to_read = batch_pages * kPagemapEntrySize;
+    const off_t offset = vaddr / kPageSize * kPagemapEntrySize;
+    if (pread(pagemap_fd_, buf_, to_read, offset) !=
+        static_cast<ssize_t>(to_read)) {
+      flush_pending();
+      return std::nullopt;
+    }
+
+    for (int64_t i = 0; i < batch_pages; ++i) {
+      if ((buf_[i] & kPagemapPresent) == 0) {
+        continue;
+      }
+      const uint64_t pfn = buf_[i] & kPagemapPfnMask;
+      if (pfn == 0) {
+        // The kernel zeroes frame numbers for unprivileged readers; without
+        // them the bitmap cannot be indexed, so stop scanning for good.
+        flush_pending();
+        disabled_ = true;
+        return std::nullopt;
+      }
+      const off_t word_offset = (pfn / 64) * sizeof(uint64_t);
+      const uint64_t bit = uint64_t{1} << (pfn % 64);
+      if (word_offset != pending_word_offset) {
+        flush_pending();
+        if (pread(bitmap_fd_, &pending_word, sizeof(pending_word),
+                  word_offset) != sizeof(pending_word)) {
+          return std::nullopt;
+        }
+        pending_word_offset = word_offset;
+        pending_mask = 0;
+      }
+      ++result.pages_scanned;
+      if (pending_word & bit) {
+        ++result.pages_idle;
+      }
+      pending_mask |= bit;
+    }
+
+    vaddr += batch_pages * kPageSize;
+    remaining_pages -= batch_pages;
+  }
+  flush_pending();
+  return result;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,91 @@
+// Copyright 2019 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_INTERNAL_PAGEIDLE_H_
+#define TCMALLOC_INTERNAL_PAGEIDLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/page_size.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// PageIdleScanner reads true page access information from the kernel's
+// /sys/kernel/mm/page_idle/bitmap: a page's idle bit, once set, is cleared
+// by the MMU the next time the page is accessed, so a bit still set on the
+// following visit means the page went untouched in between.  This is ground
+// truth, unlike inferring coldness from allocation age.
+//
+// Translating virtual pages to the PFNs the bitmap is indexed by requires
+// reading frame numbers from /proc/self/pagemap, which the kernel zeroes for
+// unprivileged readers; ok() reports whether the scan can work so callers
+// degrade gracefully.
+//
+// Not thread-safe; use from a single (background) thread.
+class PageIdleScanner {
+ public:
+  // Keeps open file handles to procfs and sysfs.  Destroy to reclaim them.
+  PageIdleScanner();
+  ~PageIdleScanner();
+
+  // Returns true while the kernel interfaces are usable.  Becomes false
+  // permanently once a scan observes zeroed frame numbers (insufficient
+  // privilege) or either file is unavailable.
+  bool ok() const { return pagemap_fd_ >= 0 && bitmap_fd_ >= 0 && !disabled_; }
+
+  struct Result {
+    // Pages of the range that were resident and had a valid frame number.
+    size_t pages_scanned = 0;
+    // Of those, pages whose idle bit was still set, i.e. untouched since the
+    // previous ScanAndRemark() on the range.
+    size_t pages_idle = 0;
+  };
+
+  // Reads the idle bits accumulated for [addr, addr + size) since the
+  // previous call on the range, then re-marks the resident pages idle for
+  // the next cycle.  The first visit to a range reports it non-idle (the
+  // bits start cleared) and primes it.  Returns std::nullopt when the
+  // kernel interfaces are unusable.
+  std::optional<Result> ScanAndRemark(const void* addr, size_t size);
+
+ private:
+  // For testing.
+  friend class PageIdleScannerSpouse;
+  PageIdleScanner(const char* pagemap_filename, const char* bitmap_filename);
+
+  // Pagemap entries for a batch of virtual pages are read in one pread();
+  // the idle bitmap is then touched one 64-bit word (64 PFNs) at a time,
+  // coalescing consecutive PFNs, which are the common case on
+  // hugepage-backed ranges.
+  static constexpr int kEntriesInBuf = 512;
+  static constexpr int kPagemapEntrySize = 8;
+
+  const size_t kPageSize = GetPageSize();
+  uint64_t buf_[kEntriesInBuf];
+  int pagemap_fd_;
+  int bitmap_fd_;
+  bool disabled_ = false;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_INTERNAL_PAGEIDLE_H_
@@ -37,6 +37,11 @@ TCMalloc_Internal_GetHugePageFillerSkipSubreleaseLongInterval(
     absl::Duration* v);
 ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetReleasePartialAllocPagesEnabled();
 ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetHugeRegionDemandBasedRelease();
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetHugeCacheDemandBasedRelease();
+ABSL_ATTRIBUTE_WEAK void
+TCMalloc_Internal_GetHugeCacheDemandReleaseShortInterval(absl::Duration* v);
+ABSL_ATTRIBUTE_WEAK void
+TCMalloc_Internal_GetHugeCacheDemandReleaseLongInterval(absl::Duration* v);
 ABSL_ATTRIBUTE_WEAK bool
 TCMalloc_Internal_GetReleasePagesFromHugeRegionEnabled();
 ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPrioritizeSpansEnabled();
@@ -46,12 +51,22 @@ ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPerCpuCachesEnabled();
 ABSL_ATTRIBUTE_WEAK size_t TCMalloc_Internal_GetStats(char* buffer,
                                                       size_t buffer_length);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetGuardedSamplingRate(int64_t v);
+ABSL_ATTRIBUTE_WEAK double
+TCMalloc_Internal_GetGuardedSamplingOverheadFraction();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetGuardedSamplingOverheadFraction(
+    double v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetHeapSizeHardLimit(uint64_t v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetHPAASubrelease(bool v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetReleasePartialAllocPagesEnabled(
     bool v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetHugeRegionDemandBasedRelease(
     bool v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetHugeCacheDemandBasedRelease(
+    bool v);
+ABSL_ATTRIBUTE_WEAK void
+TCMalloc_Internal_SetHugeCacheDemandReleaseShortInterval(absl::Duration v);
+ABSL_ATTRIBUTE_WEAK void
+TCMalloc_Internal_SetHugeCacheDemandReleaseLongInterval(absl::Duration v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetReleasePagesFromHugeRegionEnabled(
     bool v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPrioritizeSpansEnabled(bool v);
@@ -62,6 +77,9 @@ ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPeakSamplingHeapGrowthFraction(
     double v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPerCpuCachesEnabled(bool v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetProfileSamplingRate(int64_t v);
+ABSL_ATTRIBUTE_WEAK double TCMalloc_Internal_GetTargetProfileSamplesPerSec();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetTargetProfileSamplesPerSec(
+    double v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetBackgroundProcessActionsEnabled(
     bool v);
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetBackgroundProcessSleepInterval(
@@ -91,8 +109,96 @@ ABSL_ATTRIBUTE_WEAK double
 TCMalloc_Internal_GetPerCpuCachesDynamicSlabShrinkThreshold();
 ABSL_ATTRIBUTE_WEAK void
 TCMalloc_Internal_SetPerCpuCachesDynamicSlabShrinkThreshold(double v);
+ABSL_ATTRIBUTE_WEAK int64_t
+TCMalloc_Internal_GetPerCpuCachesDynamicSlabHysteresisIntervals();
+ABSL_ATTRIBUTE_WEAK void
+TCMalloc_Internal_SetPerCpuCachesDynamicSlabHysteresisIntervals(int64_t v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPerCpuCachesEagerSlabInit();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPerCpuCachesEagerSlabInit(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetHardenedFreeChecks();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetHardenedFreeChecks(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetMadviseColdRegions();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetMadviseColdRegions(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetNumaRehomeEnabled();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetNumaRehomeEnabled(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetThpAwareRegionBias();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetThpAwareRegionBias(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetSortTransferCacheBatches();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetSortTransferCacheBatches(bool v);
 ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetMadviseFree();
 ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetMadviseFree(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetMadviseFreeLazy();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetMadviseFreeLazy(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetLatencyProfilingEnabled();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetLatencyProfilingEnabled(bool v);
+ABSL_ATTRIBUTE_WEAK int64_t TCMalloc_Internal_GetSignalSafePoolBytes();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetSignalSafePoolBytes(int64_t v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPageIdleScanEnabled();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPageIdleScanEnabled(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetLifetimePredictionEnabled();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetLifetimePredictionEnabled(bool v);
+ABSL_ATTRIBUTE_WEAK int64_t
+TCMalloc_Internal_GetPerCpuCachesPopPrefetchMinObjectSize();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPerCpuCachesPopPrefetchMinObjectSize(
+    int64_t v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetShardedTransferCacheNumaAware();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetShardedTransferCacheNumaAware(
+    bool v);
+ABSL_ATTRIBUTE_WEAK bool
+TCMalloc_Internal_GetPerCpuCachesStealObjectsFromSiblings();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPerCpuCachesStealObjectsFromSiblings(
+    bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPerCpuCachesHugePageSlabs();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPerCpuCachesHugePageSlabs(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetLockFreeCentralFreelist();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetLockFreeCentralFreelist(bool v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_GetCpuCacheReclaimIdleInterval(
+    absl::Duration* v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetCpuCacheReclaimIdleInterval(
+    absl::Duration v);
+ABSL_ATTRIBUTE_WEAK int64_t TCMalloc_Internal_GetCpuCacheDecayMissFloor();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetCpuCacheDecayMissFloor(int64_t v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_GetCpuCacheDecayInterval(
+    absl::Duration* v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetCpuCacheDecayInterval(
+    absl::Duration v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_GetCpuCachePredictiveGrowInterval(
+    absl::Duration* v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetCpuCachePredictiveGrowInterval(
+    absl::Duration v);
+ABSL_ATTRIBUTE_WEAK int64_t
+TCMalloc_Internal_GetFragmentationAlarmThresholdBytes();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetFragmentationAlarmThresholdBytes(
+    int64_t v);
+ABSL_ATTRIBUTE_WEAK double TCMalloc_Internal_GetAllocationAnomalyFactor();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetAllocationAnomalyFactor(double v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetReleaseInaccessibleCpuMemory();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetReleaseInaccessibleCpuMemory(
+    bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetPagemapLeafCache();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPagemapLeafCache(bool v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetTransferCacheMissHistory();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetTransferCacheMissHistory(bool v);
+ABSL_ATTRIBUTE_WEAK int32_t TCMalloc_Internal_GetTransferCacheCapacityScale();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetTransferCacheCapacityScale(
+    int32_t v);
+ABSL_ATTRIBUTE_WEAK int64_t TCMalloc_Internal_GetDeferredFreeThreshold();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetDeferredFreeThreshold(int64_t v);
+ABSL_ATTRIBUTE_WEAK int64_t
+TCMalloc_Internal_GetSizedDeleteMismatchCheckInterval();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetSizedDeleteMismatchCheckInterval(
+    int64_t v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_GetPageheapLockWaitBudget(
+    absl::Duration* v);
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetPageheapLockWaitBudget(
+    absl::Duration v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetLargeSpanCacheEnabled();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetLargeSpanCacheEnabled(bool v);
+ABSL_ATTRIBUTE_WEAK double TCMalloc_Internal_GetMemoryPressureAvg10Threshold();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetMemoryPressureAvg10Threshold(
+    double v);
+ABSL_ATTRIBUTE_WEAK bool TCMalloc_Internal_GetUnifiedEvictionPlanner();
+ABSL_ATTRIBUTE_WEAK void TCMalloc_Internal_SetUnifiedEvictionPlanner(bool v);
 }
 
 #endif  // TCMALLOC_INTERNAL_PARAMETER_ACCESSORS_H_
@@ -46,6 +46,10 @@ void TcmallocSlab::Init(
   if (UsingFlatVirtualCpus()) {
     virtual_cpu_id_offset_ = offsetof(kernel_rseq, vcpu_id);
   }
+  // stopped_ is deliberately sized by NumCPUs() rather than NumUsableCPUs():
+  // it is tiny, and keeping every possible CPU indexable means no path needs
+  // to distinguish the two bounds.  Only the slab arrays themselves shrink
+  // under the cpuset bound.
   stopped_ = new (alloc(sizeof(stopped_[0]) * NumCPUs(),
                         std::align_val_t{ABSL_CACHELINE_SIZE}))
       std::atomic<bool>[NumCPUs()];
@@ -96,7 +100,12 @@ void TcmallocSlab::InitCpuImpl(void* slabs, Shift shift, int cpu,
   void* curr_slab = CpuMemoryStart(slabs, shift, cpu);
   void** elems =
       reinterpret_cast<void**>(GetHeader(slabs, shift, cpu, num_classes_));
-  for (size_t size_class = 1; size_class < num_classes_; ++size_class) {
+  for (size_t pos = 1; pos < num_classes_; ++pos) {
+    // Lay out slot arrays in the caller-provided temperature order (hottest
+    // classes first) when one is set; headers stay indexed by size class.
+    const size_t size_class = class_order_ != nullptr ? class_order_[pos] : pos;
+    TC_ASSERT_GT(size_class, 0);
+    TC_ASSERT_LT(size_class, num_classes_);
     size_t cap = capacity(size_class);
     TC_CHECK_EQ(static_cast<uint16_t>(cap), cap);
 
@@ -133,6 +142,13 @@ std::pair<int, bool> TcmallocSlab::CacheCpuSlabSlow() {
     tcmalloc_slabs = TCMALLOC_CACHED_SLABS_MASK;
     CompilerBarrier();
     cpu = GetCurrentVirtualCpuUnsafe(virtual_cpu_id_offset_);
+    if (ABSL_PREDICT_FALSE(cpu >= NumUsableCPUs())) {
+      // The cpuset grew past the slab bound after initialization; this CPU
+      // has no slab region.  Report "stopped" so callers fall back to the
+      // backing caches.
+      tcmalloc_slabs = 0;
+      return {-1, true};
+    }
     auto slabs_and_shift = slabs_and_shift_.load(std::memory_order_relaxed);
     const auto [slabs, shift] = slabs_and_shift.Get();
     void* start = CpuMemoryStart(slabs, shift, cpu);
@@ -199,8 +215,10 @@ auto TcmallocSlab::ResizeSlabs(Shift new_shift, void* new_slabs,
   // already been populated in the old slab.
   const auto [old_slabs, old_shift] =
       GetSlabsAndShift(std::memory_order_relaxed);
-  TC_ASSERT_NE(new_shift, old_shift);
-  const int num_cpus = NumCPUs();
+  // A same-shift call swaps in a different region with a new capacity layout;
+  // the stop/init/drain choreography below only needs the regions to differ.
+  TC_ASSERT(new_shift != old_shift || new_slabs != old_slabs);
+  const int num_cpus = NumUsableCPUs();
   for (size_t cpu = 0; cpu < num_cpus; ++cpu) {
     TC_CHECK(!stopped_[cpu].load(std::memory_order_relaxed));
     stopped_[cpu].store(true, std::memory_order_relaxed);
@@ -229,7 +247,7 @@ auto TcmallocSlab::ResizeSlabs(Shift new_shift, void* new_slabs,
 void* TcmallocSlab::Destroy(
     absl::FunctionRef<void(void*, size_t, std::align_val_t)> free) {
   const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
-  free(slabs, GetSlabsAllocSize(shift, NumCPUs()), kPhysicalPageAlign);
+  free(slabs, GetSlabsAllocSize(shift, NumUsableCPUs()), kPhysicalPageAlign);
   slabs_and_shift_.store({nullptr, shift}, std::memory_order_relaxed);
   return slabs;
 }
@@ -276,6 +294,26 @@ size_t TcmallocSlab::ShrinkOtherCache(int cpu, size_t size_class, size_t len,
   return to_shrink;
 }
 
+size_t TcmallocSlab::PopRemoteBatch(int cpu, size_t size_class, void** batch,
+                                    size_t len) {
+  ASSERT(stopped_[cpu].load(std::memory_order_relaxed));
+  const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
+
+  std::atomic<int64_t>* hdrp = GetHeader(slabs, shift, cpu, size_class);
+  Header hdr = LoadHeader(hdrp);
+  const uint16_t pop = std::min<uint16_t>(len, hdr.current - hdr.begin);
+  if (pop == 0) {
+    return 0;
+  }
+  void** src = reinterpret_cast<void**>(CpuMemoryStart(slabs, shift, cpu)) +
+               hdr.current - pop;
+  TSANAcquireBatch(src, pop);
+  std::copy(src, src + pop, batch);
+  hdr.current -= pop;
+  StoreHeader(hdrp, hdr);
+  return pop;
+}
+
 void TcmallocSlab::Drain(int cpu, DrainHandler drain_handler) {
   ScopedSlabCpuStop cpu_stop(*this, cpu);
   const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
@@ -298,7 +336,7 @@ void TcmallocSlab::StartCpu(int cpu) {
 PerCPUMetadataState TcmallocSlab::MetadataMemoryUsage() const {
   PerCPUMetadataState result;
   const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
-  size_t slabs_size = GetSlabsAllocSize(shift, NumCPUs());
+  size_t slabs_size = GetSlabsAllocSize(shift, NumUsableCPUs());
   size_t stopped_size = NumCPUs() * sizeof(stopped_[0]);
   result.virtual_size = stopped_size + slabs_size;
   result.resident_size = MInCore::residence(slabs, slabs_size);
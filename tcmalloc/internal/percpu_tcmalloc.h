@@ -127,6 +127,14 @@ class TcmallocSlab {
   //  std::atomic<int64_t> header[NumClasses];
   //  void* mem[];
   // };
+  //
+  // Slots are full 8-byte pointers.  Compressing them to 4-byte offsets from
+  // a per-MemoryTag base (doubling capacity within the same slab budget) was
+  // considered and rejected: each tag's VA window is 1 << kTagShift (4TiB)
+  // bytes and small-object spans may land anywhere in it, so a 32-bit offset
+  // cannot address the window even at 8-byte granularity (32GiB of reach).
+  // Revisit if small-object VA is ever confined to a narrow sub-window per
+  // tag.
 
   constexpr TcmallocSlab() = default;
 
@@ -155,6 +163,10 @@ class TcmallocSlab {
   // a pointer to old slabs to be madvised away along with the size of the old
   // slabs and the number of bytes that were reused.
   //
+  // <new_shift> may equal the current shift as long as <new_slabs> is a
+  // different region, which swaps in a same-sized slab laid out with a new
+  // <capacity> table.
+  //
   // <alloc> is memory allocation callback (e.g. malloc).
   // <capacity> callback returns max capacity for size class <cl>.
   // <populated> returns whether the corresponding cpu has been populated.
@@ -175,6 +187,11 @@ class TcmallocSlab {
   // Number of elements (currently) allowed in cpu/size_class slab.
   size_t Capacity(int cpu, size_t size_class) const;
 
+  // Start offset, in pointers from the CPU region start, of the
+  // cpu/size_class slot array.  Primarily for tests and diagnostics of the
+  // layout order; see SetClassLayoutOrder().
+  size_t SlotOffset(int cpu, size_t size_class) const;
+
   // If running on cpu, increment the cpu/size_class slab's capacity to no
   // greater than min(capacity+len, max_capacity(<shift>)) and return the
   // increment applied. Otherwise return 0.
@@ -264,6 +281,15 @@ class TcmallocSlab {
   size_t ShrinkOtherCache(int cpu, size_t size_class, size_t len,
                           ShrinkHandler shrink_handler);
 
+  // Pops up to <len> items from the cpu/size_class slab into <batch> and
+  // returns the number of items popped.  Unlike ShrinkOtherCache, the slab's
+  // capacity is left unchanged, making this suitable for migrating objects
+  // between caches.
+  //
+  // May be called from another processor, not just the <cpu>.
+  // REQUIRES: <cpu> is stopped (see StopCpu/ScopedSlabCpuStop).
+  size_t PopRemoteBatch(int cpu, size_t size_class, void** batch, size_t len);
+
   // Remove all items (of all classes) from <cpu>'s slab; reset capacity for all
   // classes to zero.  Then, for each sizeclass, invoke
   // DrainHandler(size_class, <items from slab>, <previous slab capacity>);
@@ -274,12 +300,30 @@ class TcmallocSlab {
 
   PerCPUMetadataState MetadataMemoryUsage() const;
 
+  // Returns the address and size of the current slabs mapping.
+  std::pair<const void*, size_t> GetSlabExtent() const {
+    const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
+    return {slabs, GetSlabsAllocSize(shift, NumUsableCPUs())};
+  }
+
   // Gets the current shift of the slabs. Intended for use by the thread that
   // calls ResizeSlabs().
   uint8_t GetShift() const {
     return ToUint8(GetSlabsAndShift(std::memory_order_relaxed).second);
   }
 
+  // Sets the order in which InitCpu/ResizeSlabs lay out size-class slot
+  // arrays within each CPU region.  <order> must hold a permutation of
+  // [1, num_classes) in positions [1, num_classes) (position 0 is ignored,
+  // as size class 0 has no slab) and must stay valid and unchanged while any
+  // InitCpu or ResizeSlabs call may be in flight; callers synchronize
+  // exactly as for those calls.  Placing the hottest classes first packs
+  // their slots against the headers the fast path already touches instead of
+  // scattering them behind colder classes' arrays.  Headers remain indexed
+  // by size class, so layout order is invisible to Push/Pop and takes effect
+  // as CPU regions are (re)populated.  Passing nullptr restores index order.
+  void SetClassLayoutOrder(const uint16_t* order) { class_order_ = order; }
+
  private:
   // In order to support dynamic slab metadata sizes, we need to be able to
   // atomically update both the slabs pointer and the shift value so we store
@@ -366,6 +410,9 @@ class TcmallocSlab {
   // Remote Cpu operation (Resize/Drain/Grow/Shrink) is running so any local
   // operations (Push/Pop) should fail.
   std::atomic<bool>* stopped_ = nullptr;
+  // Optional slot-array layout order for InitCpuImpl; see
+  // SetClassLayoutOrder().  Index order when null.
+  const uint16_t* class_order_ = nullptr;
 };
 
 // RAII for StopCpu/StartCpu.
@@ -397,6 +444,12 @@ inline size_t TcmallocSlab::Capacity(int cpu, size_t size_class) const {
   return hdr.end - hdr.begin;
 }
 
+inline size_t TcmallocSlab::SlotOffset(int cpu, size_t size_class) const {
+  const auto [slabs, shift] = GetSlabsAndShift(std::memory_order_relaxed);
+  Header hdr = LoadHeader(GetHeader(slabs, shift, cpu, size_class));
+  return hdr.begin;
+}
+
 #if defined(__x86_64__)
 #define TCMALLOC_RSEQ_RELOC_TYPE "R_X86_64_NONE"
 #define TCMALLOC_RSEQ_JUMP "jmp"
@@ -618,7 +671,7 @@ overflow_label:
 #if TCMALLOC_INTERNAL_PERCPU_USE_RSEQ && defined(__aarch64__)
 static inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool TcmallocSlab_Internal_Push(
     size_t size_class, void* item) {
-  uintptr_t region_start, scratch, end_ptr, end;
+  uintptr_t region_start, scratch, hdr, end;
   // Multiply size_class by the bytesize of each header
   size_t size_class_lsl3 = size_class * 8;
 #if TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
@@ -639,12 +692,15 @@ static inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool TcmallocSlab_Internal_Push(
       "subs %[region_start], %[region_start], %[cached_slabs_mask]\n"
       "b.ls 5f\n"
 #endif
-      // end_ptr = &(slab_headers[0]->end)
-      "add %[end_ptr], %[region_start], #4\n"
-      // scratch = slab_headers[size_class]->current (current index)
-      "ldrh %w[scratch], [%[region_start], %[size_class_lsl3]]\n"
-      // end = slab_headers[size_class]->end (end index)
-      "ldrh %w[end], [%[end_ptr], %[size_class_lsl3]]\n"
+      // hdr = &slab_headers[size_class].  Computing the header address once
+      // and addressing fields with immediate offsets keeps the commit store
+      // dependent on a single early add, mirroring the batch sequences in
+      // percpu_rseq_aarch64.S.
+      "add %[hdr], %[region_start], %[size_class_lsl3]\n"
+      // scratch = hdr->current (current index)
+      "ldrh %w[scratch], [%[hdr]]\n"
+      // end = hdr->end (end index)
+      "ldrh %w[end], [%[hdr], #4]\n"
       // if (ABSL_PREDICT_FALSE(end <= scratch)) { goto overflow_label; }
       "cmp %[end], %[scratch]\n"
 #if TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
@@ -656,10 +712,10 @@ static inline ABSL_ATTRIBUTE_ALWAYS_INLINE bool TcmallocSlab_Internal_Push(
 #endif
       "str %[item], [%[region_start], %[scratch], LSL #3]\n"
       "add %w[scratch], %w[scratch], #1\n"
-      "strh %w[scratch], [%[region_start], %[size_class_lsl3]]\n"
+      "strh %w[scratch], [%[hdr]]\n"
       // Commit
       "5:\n"
-      : [end_ptr] "=&r"(end_ptr), [scratch] "=&r"(scratch), [end] "=&r"(end),
+      : [hdr] "=&r"(hdr), [scratch] "=&r"(scratch), [end] "=&r"(end),
 #if !TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
         [overflow] "=@ccls"(overflow),
 #endif
@@ -809,7 +865,7 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* TcmallocSlab::Pop(size_t size_class) {
   void* prefetch;
   uintptr_t scratch;
   uintptr_t previous;
-  uintptr_t begin;
+  uintptr_t hdr;
 #if TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
   asm goto(
 #else
@@ -828,14 +884,17 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* TcmallocSlab::Pop(size_t size_class) {
       "subs %[region_start], %[region_start], %[cached_slabs_mask]\n"
       "b.ls 5f\n"
 #endif
-      // scratch = slab_headers[size_class]->current (current index)
-      "ldrh %w[scratch], [%[region_start], %[size_class_lsl3]]\n"
-      // begin = slab_headers[size_class]->begin (begin index)
-      // Temporarily use begin as scratch.
-      "add %[begin], %[size_class_lsl3], #2\n"
-      "ldrh %w[begin], [%[region_start], %[begin]]\n"
+      // hdr = &slab_headers[size_class].  As in Push, immediate-offset
+      // header accesses off a single early add mirror the batch sequences
+      // in percpu_rseq_aarch64.S.
+      "add %[hdr], %[region_start], %[size_class_lsl3]\n"
+      // scratch = hdr->current (current index)
+      "ldrh %w[scratch], [%[hdr]]\n"
+      // previous = hdr->begin (begin index)
+      // Temporarily use previous as scratch.
+      "ldrh %w[previous], [%[hdr], #2]\n"
       // if (ABSL_PREDICT_FALSE(begin >= scratch)) { goto underflow_path; }
-      "cmp %w[scratch], %w[begin]\n"
+      "cmp %w[scratch], %w[previous]\n"
 #if TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
       "b.ls %l[underflow_path]\n"
 #else
@@ -848,7 +907,7 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* TcmallocSlab::Pop(size_t size_class) {
       "ldr %[result], [%[region_start], %[scratch], LSL #3]\n"
       "sub %w[previous], %w[scratch], #1\n"
       "ldr %[prefetch], [%[region_start], %[previous], LSL #3]\n"
-      "strh %w[scratch], [%[region_start], %[size_class_lsl3]]\n"
+      "strh %w[scratch], [%[hdr]]\n"
       // Commit
       "5:\n"
       :
@@ -858,7 +917,7 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* TcmallocSlab::Pop(size_t size_class) {
       [result] "=&r"(result), [prefetch] "=&r"(prefetch),
       // Temps
       [region_start] "=&r"(region_start), [previous] "=&r"(previous),
-      [begin] "=&r"(begin), [scratch] "=&r"(scratch)
+      [hdr] "=&r"(hdr), [scratch] "=&r"(scratch)
       // Real inputs
       : TCMALLOC_RSEQ_INPUTS,
 #if !TCMALLOC_INTERNAL_PERCPU_USE_RSEQ_ASM_GOTO_OUTPUT
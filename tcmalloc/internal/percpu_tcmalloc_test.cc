@@ -171,6 +171,29 @@ TEST_F(TcmallocSlabTest, Metadata) {
   EXPECT_GT(post_stats.resident_size, r.resident_size);
 }
 
+TEST_F(TcmallocSlabTest, ClassLayoutOrder) {
+  if (!IsFast()) {
+    GTEST_SKIP() << "Need fast percpu. Skipping.";
+    return;
+  }
+
+  // Reverse the default placement: the highest size class is laid out first.
+  constexpr uint16_t kOrder[kStressSlabs] = {0, 4, 3, 2, 1};
+  slab_.SetClassLayoutOrder(kOrder);
+  slab_.InitCpu(0, [](size_t size_class) { return kCapacity; });
+  EXPECT_LT(slab_.SlotOffset(0, 4), slab_.SlotOffset(0, 3));
+  EXPECT_LT(slab_.SlotOffset(0, 3), slab_.SlotOffset(0, 2));
+  EXPECT_LT(slab_.SlotOffset(0, 2), slab_.SlotOffset(0, 1));
+
+  // Clearing the order restores index-order placement on the next
+  // (re)population.
+  slab_.SetClassLayoutOrder(nullptr);
+  slab_.InitCpu(0, [](size_t size_class) { return kCapacity; });
+  EXPECT_LT(slab_.SlotOffset(0, 1), slab_.SlotOffset(0, 2));
+  EXPECT_LT(slab_.SlotOffset(0, 2), slab_.SlotOffset(0, 3));
+  EXPECT_LT(slab_.SlotOffset(0, 3), slab_.SlotOffset(0, 4));
+}
+
 TEST_F(TcmallocSlabTest, Unit) {
   if (MallocExtension::PerCpuCachesActive()) {
     // This test unregisters rseq temporarily, as to decrease flakiness.
@@ -435,6 +458,28 @@ TEST_F(TcmallocSlabTest, ShrinkEmptyCache) {
   slab_.StartCpu(kCpu);
 }
 
+TEST_F(TcmallocSlabTest, PopRemoteBatchEmptyCache) {
+  if (MallocExtension::PerCpuCachesActive()) {
+    // This test unregisters rseq temporarily, as to decrease flakiness.
+    GTEST_SKIP() << "per-CPU TCMalloc is incompatible with unregistering rseq";
+  }
+
+  if (!IsFast()) {
+    GTEST_SKIP() << "Need fast percpu. Skipping.";
+    return;
+  }
+  constexpr int kCpu = 1;
+  constexpr int kSizeClass = 1;
+  slab_.InitCpu(kCpu, [](size_t size_class) { return kCapacity; });
+  slab_.StopCpu(kCpu);
+  const size_t capacity = slab_.Capacity(kCpu, kSizeClass);
+  void* batch[kCapacity];
+  EXPECT_EQ(slab_.PopRemoteBatch(kCpu, kSizeClass, batch, kCapacity), 0);
+  // Unlike ShrinkOtherCache, popping must leave the capacity untouched.
+  EXPECT_EQ(slab_.Capacity(kCpu, kSizeClass), capacity);
+  slab_.StartCpu(kCpu);
+}
+
 TEST_F(TcmallocSlabTest, SimulatedMadviseFailure) {
   if (!IsFast()) {
     GTEST_SKIP() << "Need fast percpu. Skipping.";
@@ -503,7 +548,7 @@ void StressThread(size_t thread_id, Context& ctx) {
   absl::BitGen rnd(absl::SeedSeq({thread_id}));
   while (!*ctx.stop) {
     size_t size_class = absl::Uniform<int32_t>(rnd, 1, kStressSlabs);
-    const int what = absl::Uniform<int32_t>(rnd, 0, 91);
+    const int what = absl::Uniform<int32_t>(rnd, 0, 101);
     if (what < 10) {
       if (!block.empty()) {
         if (ctx.slab->Push(size_class, block.back())) {
@@ -633,6 +678,25 @@ void StressThread(size_t thread_id, Context& ctx) {
         EXPECT_GE(grown, 0);
         ctx.capacity->fetch_add(to_grow - grown);
       }
+    } else if (what < 100) {
+      int cpu = absl::Uniform<int32_t>(rnd, 0, num_cpus);
+
+      // PopRemoteBatch reads slots the owning cpu committed with plain
+      // stores, so it must run under the stop protocol; racing it against
+      // local Push/Pop here exercises exactly that handoff.
+      InitCpuOnce(ctx, cpu);
+
+      absl::MutexLock lock(&ctx.mutexes[cpu]);
+      void* batch[kStressCapacity];
+      size_t n = absl::Uniform<int32_t>(rnd, 0, kStressCapacity) + 1;
+      ctx.slab->StopCpu(cpu);
+      size_t popped = ctx.slab->PopRemoteBatch(cpu, size_class, batch, n);
+      ctx.slab->StartCpu(cpu);
+      EXPECT_LE(popped, n);
+      for (size_t i = 0; i < popped; ++i) {
+        EXPECT_NE(batch[i], nullptr);
+        block.push_back(batch[i]);
+      }
     } else {
       int cpu = absl::Uniform<int32_t>(rnd, 0, num_cpus);
       // Flip coin on whether to unregister rseq on this thread.
@@ -40,6 +40,7 @@
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "tcmalloc/internal/profile.pb.h"
 #include "absl/base/attributes.h"
@@ -115,7 +116,8 @@ struct SampleEqWithSubFields {
     auto fields = [](const Profile::Sample& s) {
       return std::tie(s.depth, s.requested_size, s.requested_alignment,
                       s.requested_size_returning, s.allocated_size,
-                      s.access_hint, s.access_allocated, s.guarded_status);
+                      s.access_hint, s.access_allocated, s.guarded_status,
+                      s.allocating_numa_node, s.backing_numa_node);
     };
     return fields(a) == fields(b) &&
            std::equal(a.stack, a.stack + a.depth, b.stack, b.stack + b.depth);
@@ -127,7 +129,8 @@ struct SampleHashWithSubFields {
     return absl::HashOf(absl::MakeConstSpan(s.stack, s.depth), s.depth,
                         s.requested_size, s.requested_alignment,
                         s.requested_size_returning, s.allocated_size,
-                        s.access_hint, s.access_allocated, s.guarded_status);
+                        s.access_hint, s.access_allocated, s.guarded_status,
+                        s.allocating_numa_node, s.backing_numa_node);
   }
 };
 
@@ -400,7 +403,13 @@ void ProfileBuilder::InternCallstack(absl::Span<const void* const> stack,
   ASSERT(sample.location_id().size() == stack.size());
 }
 
-void ProfileBuilder::AddCurrentMappings() {
+namespace {
+
+// Walks the dynamic loader's image list and records one MappingInfo per
+// loadable segment.  This is the expensive part of mapping capture (realpath
+// and build ID extraction per image), so callers cache the result.
+std::vector<MappingInfo> CaptureProcessMappings() {
+  std::vector<MappingInfo> mappings;
 #if defined(__linux__)
   auto dl_iterate_callback = +[](dl_phdr_info* info, size_t size, void* data) {
     // Skip dummy entry introduced since glibc 2.18.
@@ -408,8 +417,9 @@ void ProfileBuilder::AddCurrentMappings() {
       return 0;
     }
 
-    ProfileBuilder& builder = *static_cast<ProfileBuilder*>(data);
-    const bool is_main_executable = builder.profile_->mapping_size() == 0;
+    std::vector<MappingInfo>& mappings =
+        *static_cast<std::vector<MappingInfo>*>(data);
+    const bool is_main_executable = mappings.empty();
 
     // Evaluate all the loadable segments.
     for (int i = 0; i < info->dlpi_phnum; ++i) {
@@ -457,16 +467,32 @@ void ProfileBuilder::AddCurrentMappings() {
 
       const std::string build_id = GetBuildId(info);
 
-      // Add to profile.
-      builder.AddMapping(memory_start, memory_limit, file_offset,
-                         resolved_filename, build_id);
+      mappings.push_back(MappingInfo{memory_start, memory_limit, file_offset,
+                                     std::string(resolved_filename), build_id});
     }
     // Keep going.
     return 0;
   };
 
-  dl_iterate_phdr(dl_iterate_callback, this);
+  dl_iterate_phdr(dl_iterate_callback, &mappings);
 #endif  // defined(__linux__)
+  return mappings;
+}
+
+}  // namespace
+
+const std::vector<MappingInfo>& GetProcessMappings() {
+  // Leaked so the table stays valid for profiles emitted during shutdown.
+  static const std::vector<MappingInfo>& mappings =
+      *new std::vector<MappingInfo>(CaptureProcessMappings());
+  return mappings;
+}
+
+void ProfileBuilder::AddCurrentMappings() {
+  for (const MappingInfo& mapping : GetProcessMappings()) {
+    AddMapping(mapping.memory_start, mapping.memory_limit, mapping.file_offset,
+               mapping.filename, mapping.build_id);
+  }
 }
 
 int ProfileBuilder::AddMapping(uintptr_t memory_start, uintptr_t memory_limit,
@@ -655,6 +681,9 @@ absl::StatusOr<std::unique_ptr<perftools::profiles::Profile>> MakeProfileProto(
   const int access_allocated_id = builder.InternString("access_allocated");
   const int cold_id = builder.InternString("cold");
   const int hot_id = builder.InternString("hot");
+  const int allocating_numa_node_id =
+      builder.InternString("allocating_numa_node");
+  const int backing_numa_node_id = builder.InternString("backing_numa_node");
 
   // NOTE: Do not rely on these string constants. They will be removed!
   // TODO(b/259585789): Remove all of these tags when sample type rollout
@@ -712,9 +741,12 @@ absl::StatusOr<std::unique_ptr<perftools::profiles::Profile>> MakeProfileProto(
     case tcmalloc::ProfileType::kFragmentation:
     case tcmalloc::ProfileType::kHeap:
     case tcmalloc::ProfileType::kPeakHeap:
+    case tcmalloc::ProfileType::kPeakHeapLastHour:
+    case tcmalloc::ProfileType::kPeakHeapLastDay:
       default_sample_type_id = space_id;
       break;
     case tcmalloc::ProfileType::kAllocations:
+    case tcmalloc::ProfileType::kCpuCacheMiss:
       default_sample_type_id = objects_id;
       break;
     default:
@@ -765,6 +797,16 @@ absl::StatusOr<std::unique_ptr<perftools::profiles::Profile>> MakeProfileProto(
     add_positive_label(request_id, bytes_id, entry.requested_size);
     add_positive_label(alignment_id, bytes_id, entry.requested_alignment);
     add_positive_label(size_returning_id, 0, entry.requested_size_returning);
+    // Node 0 is valid, so we cannot rely on add_positive_label here; -1 means
+    // the node is unknown and the label is omitted.  Together these labels
+    // form the allocation-site to NUMA-node matrix: samples from the same
+    // site with different node pairs are kept distinct by the merge key.
+    if (entry.allocating_numa_node >= 0) {
+      add_label(allocating_numa_node_id, 0, entry.allocating_numa_node);
+    }
+    if (entry.backing_numa_node >= 0) {
+      add_label(backing_numa_node_id, 0, entry.backing_numa_node);
+    }
     // TODO(b/259585789): Remove all of these when sample type rollout is
     // complete.
     if (data.resident_size.has_value()) {
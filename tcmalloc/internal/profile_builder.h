@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tcmalloc/internal/profile.pb.h"
 #include "absl/container/btree_map.h"
@@ -39,6 +40,22 @@ namespace tcmalloc_internal {
 std::string GetBuildId(const dl_phdr_info* const info);
 #endif  // defined(__linux__)
 
+// A single executable mapping of the process, in the form pprof expects.
+struct MappingInfo {
+  uintptr_t memory_start;
+  uintptr_t memory_limit;
+  uintptr_t file_offset;
+  std::string filename;
+  std::string build_id;
+};
+
+// Returns the process mapping table.  The table is captured from the dynamic
+// loader on first use and cached for the lifetime of the process, so emitting
+// a profile does not re-walk the loaded images (or re-read their build IDs).
+// Images loaded by dlopen after the first profile is emitted do not appear;
+// their frames are left unmapped for the symbolizer to flag.
+const std::vector<MappingInfo>& GetProcessMappings();
+
 // ProfileBuilder manages building up a profile.proto instance and populating
 // common parts using the string/pointer table conventions expected by pprof.
 class ProfileBuilder {
@@ -57,6 +57,13 @@ class Bitmap {
   // Clears the lowest set bit. Special case is faster than more flexible code.
   void ClearLowestBit();
 
+  // Clears up to <n> of the lowest set bits and stores their indices in
+  // <indices>, in increasing order. Returns the number of bits cleared.
+  // Faster than repeated FindSet/ClearLowestBit, which rescan all leading
+  // zero words on every pop: each word is loaded once and its set bits are
+  // extracted with a count-trailing-zeros loop.
+  size_t PopLowestBits(size_t n, size_t* indices);
+
   // If there is at least one free range at or after <start>,
   // put it in *index, *length and return true; else return false.
   bool NextFreeRange(size_t start, size_t* index, size_t* length) const;
@@ -65,6 +72,11 @@ class Bitmap {
   size_t FindSet(size_t index) const;
   size_t FindClear(size_t index) const;
 
+  // Returns the index of the (i + 1)-th set bit, or N if there are i or
+  // fewer set bits.  Whole words are skipped with popcount, so the cost is
+  // proportional to the number of words rather than to i.
+  size_t FindIthSet(size_t i) const;
+
   // Returns index of the first {set, clear} bit in [index, 0] or -1 if none.
   ssize_t FindSetBackwards(size_t index) const;
   ssize_t FindClearBackwards(size_t index) const;
@@ -98,7 +110,7 @@ template <size_t N>
 class RangeTracker {
  public:
   constexpr RangeTracker()
-      : bits_{}, longest_free_(N), nused_(0), nallocs_(0) {}
+      : bits_{}, longest_free_(N), first_free_(0), nused_(0), nallocs_(0) {}
 
   size_t size() const;
   // Number of bits marked
@@ -162,6 +174,10 @@ class RangeTracker {
   using Count = typename UnsignedTypeFittingSize::type;
 
   Count longest_free_;
+  // Index of the first clear bit; every bit below it is marked.  Lets
+  // FindAndMark skip the fully allocated prefix, which dominates in the
+  // densely packed trackers the filler prefers to place into.
+  Count first_free_;
   Count nused_;
   Count nallocs_;
 };
@@ -204,10 +220,24 @@ inline size_t RangeTracker<N>::FindAndMark(size_t n) {
   // TODO(b/134691947): shortest? lowest-addressed?
   size_t best_index = N;
   size_t best_len = 2 * N;
-  // Iterate over free ranges:
-  size_t index = 0, len;
+  // Iterate over free ranges, starting past the fully marked prefix: no bit
+  // below first_free_ is clear.
+  size_t index = first_free_, len;
 
   while (bits_.NextFreeRange(index, &index, &len)) {
+    if (len >= n && len < best_len) {
+      best_index = index;
+      best_len = len;
+      if (len == n && n < longest_free_) {
+        // An exact fit shorter than the longest range cannot be beaten, and
+        // taking it leaves every other range -- the longest included --
+        // untouched, so neither the rest of the scan nor the longest-range
+        // recomputation is needed.
+        longest_len = longest_free_;
+        break;
+      }
+    }
+
     if (len > longest_len) {
       second_len = longest_len;
       longest_len = len;
@@ -215,16 +245,15 @@ inline size_t RangeTracker<N>::FindAndMark(size_t n) {
       second_len = len;
     }
 
-    if (len >= n && len < best_len) {
-      best_index = index;
-      best_len = len;
-    }
-
     index += len;
   }
 
   TC_CHECK_LT(best_index, N);
   bits_.SetRange(best_index, n);
+  if (best_index == first_free_) {
+    const size_t next = best_index + n;
+    first_free_ = next < N ? bits_.FindClear(next) : N;
+  }
 
   if (best_len == longest_len) {
     longest_len -= n;
@@ -243,6 +272,7 @@ template <size_t N>
 inline void RangeTracker<N>::Unmark(size_t index, size_t n) {
   ASSERT(bits_.FindClear(index) >= index + n);
   bits_.ClearRange(index, n);
+  if (index < first_free_) first_free_ = index;
   nused_ -= n;
   nallocs_--;
 
@@ -269,6 +299,7 @@ inline void RangeTracker<N>::Clear() {
   nallocs_ = 0;
   nused_ = 0;
   longest_free_ = N;
+  first_free_ = 0;
 }
 
 // Count the set bits [from, to) in the i-th word to Value.
@@ -385,6 +416,20 @@ inline void Bitmap<N>::ClearLowestBit() {
   }
 }
 
+template <size_t N>
+inline size_t Bitmap<N>::PopLowestBits(size_t n, size_t* indices) {
+  size_t count = 0;
+  for (size_t i = 0; i < kWords && count < n; ++i) {
+    size_t word = bits_[i];
+    while (word != 0 && count < n) {
+      indices[count++] = i * kWordSize + absl::countr_zero(word);
+      word &= word - 1;
+    }
+    bits_[i] = word;
+  }
+  return count;
+}
+
 template <size_t N>
 template <bool Value>
 inline void Bitmap<N>::SetRangeValue(size_t index, size_t n) {
@@ -426,6 +471,24 @@ inline size_t Bitmap<N>::FindClear(size_t index) const {
   return FindValue<false>(index);
 }
 
+template <size_t N>
+inline size_t Bitmap<N>::FindIthSet(size_t i) const {
+  for (size_t word = 0; word < kWords; ++word) {
+    size_t bits = bits_[word];
+    const size_t count = absl::popcount(bits);
+    if (i >= count) {
+      i -= count;
+      continue;
+    }
+    // The target bit is in this word; peel off the i lower set bits.
+    for (; i > 0; --i) {
+      bits &= bits - 1;
+    }
+    return word * kWordSize + absl::countr_zero(bits);
+  }
+  return N;
+}
+
 template <size_t N>
 inline ssize_t Bitmap<N>::FindSetBackwards(size_t index) const {
   return FindValueBackwards<true>(index);
@@ -121,6 +121,42 @@ TEST_F(BitmapTest, CheckClearLowestBit) {
   }
 }
 
+TEST_F(BitmapTest, PopLowestBits) {
+  Bitmap<253> map;
+  size_t indices[253];
+  EXPECT_EQ(map.PopLowestBits(253, indices), 0);
+
+  // Set bits spread across several words, then pop them in two batches.
+  const size_t kSet[] = {0, 1, 7, 63, 64, 100, 200, 252};
+  for (size_t i : kSet) {
+    map.SetBit(i);
+  }
+  ASSERT_EQ(map.PopLowestBits(5, indices), 5);
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_EQ(indices[i], kSet[i]) << i;
+  }
+  ASSERT_EQ(map.PopLowestBits(253, indices), 3);
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(indices[i], kSet[i + 5]) << i;
+  }
+  EXPECT_EQ(map.IsZero(), true);
+}
+
+TEST_F(BitmapTest, FindIthSet) {
+  Bitmap<253> map;
+  EXPECT_EQ(map.FindIthSet(0), 253);
+
+  const size_t kSet[] = {0, 1, 7, 63, 64, 100, 200, 252};
+  for (size_t i : kSet) {
+    map.SetBit(i);
+  }
+  for (size_t i = 0; i < 8; ++i) {
+    EXPECT_EQ(map.FindIthSet(i), kSet[i]) << i;
+  }
+  EXPECT_EQ(map.FindIthSet(8), 253);
+  EXPECT_EQ(map.FindIthSet(252), 253);
+}
+
 TEST_F(BitmapTest, GetBitOneSet) {
   const size_t N = 251;
   for (size_t s = 0; s < N; s++) {
@@ -289,6 +325,26 @@ TEST_F(RangeTrackerTest, Trivial) {
   EXPECT_THAT(FreeRanges(), ElementsAre(Pair(0, 300)));
 }
 
+TEST_F(RangeTrackerTest, ExactFitAndDensePrefix) {
+  // Build a fully marked prefix with two holes behind it: an exact fit for
+  // the next request and a longer range.
+  ASSERT_EQ(0, range_.FindAndMark(kBits));
+  range_.Unmark(400, 10);
+  range_.Unmark(500, 100);
+  EXPECT_EQ(100, range_.longest_free());
+
+  // The exact fit wins over the longer range, which stays intact.
+  EXPECT_EQ(400, range_.FindAndMark(10));
+  EXPECT_EQ(100, range_.longest_free());
+  EXPECT_THAT(FreeRanges(), ElementsAre(Pair(500, 100)));
+
+  // A range freed below the marked prefix is found by the next search.
+  range_.Unmark(0, 10);
+  EXPECT_EQ(0, range_.FindAndMark(10));
+  EXPECT_EQ(100, range_.longest_free());
+  EXPECT_THAT(FreeRanges(), ElementsAre(Pair(500, 100)));
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
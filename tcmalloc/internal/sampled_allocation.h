@@ -15,6 +15,8 @@
 #ifndef TCMALLOC_INTERNAL_SAMPLED_ALLOCATION_H_
 #define TCMALLOC_INTERNAL_SAMPLED_ALLOCATION_H_
 
+#include <atomic>
+#include <cstddef>
 #include <utility>
 
 #include "tcmalloc/internal/logging.h"
@@ -54,6 +56,19 @@ struct SampledAllocation : public tcmalloc_internal::Sample<SampledAllocation> {
 
   // The stack trace of the sampled allocation.
   StackTrace sampled_stack = {};
+
+  // Generation at which the allocation was freed, drawn from the same counter
+  // as `sampled_stack.sampled_alloc_handle`; zero while the allocation is
+  // live.  The value intentionally survives `PrepareForSampling()` so that
+  // reviving an object from the freelist can observe that the record of the
+  // earlier free is about to be overwritten; see DumpHeapProfileSince().
+  std::atomic<AllocHandle> death_generation{0};
+
+  // NUMA partition whose arena region this object was carved from.
+  // Maintained by SampledAllocationAllocator (not by `PrepareForSampling()`,
+  // which runs on revival) and used to return the object to the node-local
+  // freelist on deletion.
+  size_t numa_partition = 0;
 };
 
 }  // namespace tcmalloc_internal
@@ -16,13 +16,15 @@
 // File: sampled_allocation_recorder.h
 // -----------------------------------------------------------------------------
 //
-// This header file defines a lock-free linked list for recording TCMalloc
-// sampled allocations collected from a random/stochastic process.
+// This header file defines a set of hash-sharded lock-free linked lists for
+// recording TCMalloc sampled allocations collected from a random/stochastic
+// process.
 
 #ifndef TCMALLOC_INTERNAL_SAMPLED_ALLOCATION_RECORDER_H_
 #define TCMALLOC_INTERNAL_SAMPLED_ALLOCATION_RECORDER_H_
 
 #include <atomic>
+#include <cstddef>
 
 #include "absl/base/const_init.h"
 #include "absl/base/internal/spinlock.h"
@@ -45,6 +47,10 @@ struct Sample {
                                      absl::base_internal::SCHEDULE_KERNEL_ONLY};
   T* next = nullptr;
   T* dead ABSL_GUARDED_BY(lock) = nullptr;
+  // Index of the recorder shard this sample lives on.  Fixed when the sample
+  // is first registered; dead samples return to their own shard's graveyard,
+  // so revival never migrates a sample across shards.
+  size_t shard = 0;
 };
 
 // Holds samples and their associated stack traces.
@@ -64,13 +70,24 @@ class SampleRecorder {
   SampleRecorder(SampleRecorder&&) = delete;
   SampleRecorder& operator=(SampleRecorder&&) = delete;
 
-  // Sets up the dead pointer of `graveyard_` to make it a circular linked list.
+  // Sets up the dead pointer of every shard's graveyard to make it a circular
+  // linked list.
   void Init();
 
-  // Registers for sampling.  Returns an opaque registration info.
+  // Registers for sampling.  Returns an opaque registration info.  The sample
+  // is placed on shard 0; heavy samplers should prefer `RegisterOnShard` so
+  // registrations spread across shards instead of contending on one graveyard
+  // lock.
   template <typename... Targs>
   T* Register(Targs&&... args);
 
+  // As `Register`, but places the sample on the shard selected by
+  // `shard_hash`.  Callers recording stack traces pass the trace's hash (see
+  // HashOfStackTrace() in stacktrace_filter.h) so distinct stacks land on
+  // distinct shards.
+  template <typename... Targs>
+  T* RegisterOnShard(size_t shard_hash, Targs&&... args);
+
   // Unregisters the sample.
   void Unregister(T* sample);
 
@@ -81,9 +98,9 @@ class SampleRecorder {
   using DisposeCallback = void (*)(const T&);
   DisposeCallback SetDisposeCallback(DisposeCallback f);
 
-  // Unregisters any live samples starting from `all_`. Note that if there are
-  // any samples added in front of `all_` in other threads after this function
-  // reads `all_`, they won't be cleaned up. External synchronization is
+  // Unregisters any live samples, walking each shard's list in turn. Note
+  // that if there are any samples added in front of a shard's list head in
+  // other threads after this function reads it, they won't be cleaned up. External synchronization is
   // required if the intended outcome is to have no live sample after this call.
   // Extra care must be taken when `Unregister()` is invoked concurrently with
   // this function to avoid a dead sample (updated by this function) being
@@ -93,19 +110,22 @@ class SampleRecorder {
   // Iterates over all the registered samples.
   void Iterate(const absl::FunctionRef<void(const T& sample)>& f);
 
- private:
-  void PushNew(T* sample);
-  void PushDead(T* sample);
-  template <typename... Targs>
-  T* PopDead(Targs&&... args);
+  // Iterates over every sample ever registered, including dead samples whose
+  // storage has not been reused for a new registration yet; `live` reports
+  // whether the sample is currently registered.
+  void Iterate(const absl::FunctionRef<void(const T& sample, bool live)>& f);
 
-  // Intrusive lock free linked lists for tracking samples.
+ private:
+  // Samples are sharded by a caller-provided hash so that concurrent
+  // registration and unregistration contend on per-shard graveyard locks and
+  // list heads instead of one of each.  Each shard holds the intrusive lock
+  // free linked lists for tracking its samples.
   //
-  // `all_` records all samples (they are never removed from this list) and is
-  // terminated with a `nullptr`.
+  // `all` records all samples on the shard (they are never removed from this
+  // list) and is terminated with a `nullptr`.
   //
-  // `graveyard_.dead` is a circular linked list.  When it is empty,
-  // `graveyard_.dead == &graveyard`.  The list is circular so that
+  // `graveyard.dead` is a circular linked list.  When it is empty,
+  // `graveyard.dead == &graveyard`.  The list is circular so that
   // every item on it (even the last) has a non-null dead pointer.  This allows
   // `Iterate` to determine if a given sample is live or dead using only
   // information on the sample itself.
@@ -124,8 +144,19 @@ class SampleRecorder {
   //     ^                                      |
   //     +--------------------------------------+
   //
-  std::atomic<T*> all_;
-  T graveyard_;
+  struct Shard {
+    std::atomic<T*> all{nullptr};
+    T graveyard;
+  };
+
+  static constexpr size_t kNumShards = 16;
+
+  void PushNew(Shard& shard, T* sample);
+  void PushDead(T* sample);
+  template <typename... Targs>
+  T* PopDead(Shard& shard, Targs&&... args);
+
+  Shard shards_[kNumShards];
 
   std::atomic<DisposeCallback> dispose_;
   Allocator* const allocator_;
@@ -139,30 +170,34 @@ SampleRecorder<T, Allocator>::SetDisposeCallback(DisposeCallback f) {
 
 template <typename T, typename Allocator>
 constexpr SampleRecorder<T, Allocator>::SampleRecorder(Allocator* allocator)
-    : all_(nullptr), dispose_(nullptr), allocator_(allocator) {}
+    : dispose_(nullptr), allocator_(allocator) {}
 
 template <typename T, typename Allocator>
 SampleRecorder<T, Allocator>::~SampleRecorder() {
-  T* s = all_.load(std::memory_order_acquire);
-  while (s != nullptr) {
-    T* next = s->next;
-    allocator_->Delete(s);
-    s = next;
+  for (Shard& shard : shards_) {
+    T* s = shard.all.load(std::memory_order_acquire);
+    while (s != nullptr) {
+      T* next = s->next;
+      allocator_->Delete(s);
+      s = next;
+    }
   }
 }
 
 template <typename T, typename Allocator>
 void SampleRecorder<T, Allocator>::Init() {
-  AllocationGuardSpinLockHolder l(&graveyard_.lock);
-  graveyard_.dead = &graveyard_;
+  for (Shard& shard : shards_) {
+    AllocationGuardSpinLockHolder l(&shard.graveyard.lock);
+    shard.graveyard.dead = &shard.graveyard;
+  }
 }
 
 template <typename T, typename Allocator>
-void SampleRecorder<T, Allocator>::PushNew(T* sample) {
-  sample->next = all_.load(std::memory_order_relaxed);
-  while (!all_.compare_exchange_weak(sample->next, sample,
-                                     std::memory_order_release,
-                                     std::memory_order_relaxed)) {
+void SampleRecorder<T, Allocator>::PushNew(Shard& shard, T* sample) {
+  sample->next = shard.all.load(std::memory_order_relaxed);
+  while (!shard.all.compare_exchange_weak(sample->next, sample,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
   }
 }
 
@@ -172,25 +207,26 @@ void SampleRecorder<T, Allocator>::PushDead(T* sample) {
     dispose(*sample);
   }
 
-  AllocationGuardSpinLockHolder graveyard_lock(&graveyard_.lock);
+  Shard& shard = shards_[sample->shard];
+  AllocationGuardSpinLockHolder graveyard_lock(&shard.graveyard.lock);
   AllocationGuardSpinLockHolder sample_lock(&sample->lock);
-  sample->dead = graveyard_.dead;
-  graveyard_.dead = sample;
+  sample->dead = shard.graveyard.dead;
+  shard.graveyard.dead = sample;
 }
 
 template <typename T, typename Allocator>
 template <typename... Targs>
-T* SampleRecorder<T, Allocator>::PopDead(Targs&&... args) {
-  AllocationGuardSpinLockHolder graveyard_lock(&graveyard_.lock);
+T* SampleRecorder<T, Allocator>::PopDead(Shard& shard, Targs&&... args) {
+  AllocationGuardSpinLockHolder graveyard_lock(&shard.graveyard.lock);
 
   // The list is circular, so eventually it collapses down to
-  //   graveyard_.dead == &graveyard_
+  //   shard.graveyard.dead == &shard.graveyard
   // when it is empty.
-  T* sample = graveyard_.dead;
-  if (sample == &graveyard_) return nullptr;
+  T* sample = shard.graveyard.dead;
+  if (sample == &shard.graveyard) return nullptr;
 
   AllocationGuardSpinLockHolder sample_lock(&sample->lock);
-  graveyard_.dead = sample->dead;
+  shard.graveyard.dead = sample->dead;
   sample->dead = nullptr;
   sample->PrepareForSampling(std::forward<Targs>(args)...);
   return sample;
@@ -199,11 +235,21 @@ T* SampleRecorder<T, Allocator>::PopDead(Targs&&... args) {
 template <typename T, typename Allocator>
 template <typename... Targs>
 T* SampleRecorder<T, Allocator>::Register(Targs&&... args) {
-  T* sample = PopDead(std::forward<Targs>(args)...);
+  return RegisterOnShard(0, std::forward<Targs>(args)...);
+}
+
+template <typename T, typename Allocator>
+template <typename... Targs>
+T* SampleRecorder<T, Allocator>::RegisterOnShard(size_t shard_hash,
+                                                 Targs&&... args) {
+  const size_t shard_index = shard_hash % kNumShards;
+  Shard& shard = shards_[shard_index];
+  T* sample = PopDead(shard, std::forward<Targs>(args)...);
   if (sample == nullptr) {
     // Resurrection failed.  Hire a new warlock.
     sample = allocator_->New(std::forward<Targs>(args)...);
-    PushNew(sample);
+    sample->shard = shard_index;
+    PushNew(shard, sample);
   }
 
   return sample;
@@ -216,32 +262,49 @@ void SampleRecorder<T, Allocator>::Unregister(T* sample) {
 
 template <typename T, typename Allocator>
 void SampleRecorder<T, Allocator>::UnregisterAll() {
-  AllocationGuardSpinLockHolder graveyard_lock(&graveyard_.lock);
-  T* sample = all_.load(std::memory_order_acquire);
   auto* dispose = dispose_.load(std::memory_order_relaxed);
-  while (sample != nullptr) {
-    {
-      AllocationGuardSpinLockHolder sample_lock(&sample->lock);
-      if (sample->dead == nullptr) {
-        if (dispose) dispose(*sample);
-        sample->dead = graveyard_.dead;
-        graveyard_.dead = sample;
+  for (Shard& shard : shards_) {
+    AllocationGuardSpinLockHolder graveyard_lock(&shard.graveyard.lock);
+    T* sample = shard.all.load(std::memory_order_acquire);
+    while (sample != nullptr) {
+      {
+        AllocationGuardSpinLockHolder sample_lock(&sample->lock);
+        if (sample->dead == nullptr) {
+          if (dispose) dispose(*sample);
+          sample->dead = shard.graveyard.dead;
+          shard.graveyard.dead = sample;
+        }
       }
+      sample = sample->next;
     }
-    sample = sample->next;
   }
 }
 
 template <typename T, typename Allocator>
 void SampleRecorder<T, Allocator>::Iterate(
     const absl::FunctionRef<void(const T& sample)>& f) {
-  T* s = all_.load(std::memory_order_acquire);
-  while (s != nullptr) {
-    AllocationGuardSpinLockHolder l(&s->lock);
-    if (s->dead == nullptr) {
-      f(*s);
+  for (Shard& shard : shards_) {
+    T* s = shard.all.load(std::memory_order_acquire);
+    while (s != nullptr) {
+      AllocationGuardSpinLockHolder l(&s->lock);
+      if (s->dead == nullptr) {
+        f(*s);
+      }
+      s = s->next;
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+void SampleRecorder<T, Allocator>::Iterate(
+    const absl::FunctionRef<void(const T& sample, bool live)>& f) {
+  for (Shard& shard : shards_) {
+    T* s = shard.all.load(std::memory_order_acquire);
+    while (s != nullptr) {
+      AllocationGuardSpinLockHolder l(&s->lock);
+      f(*s, s->dead == nullptr);
+      s = s->next;
     }
-    s = s->next;
   }
 }
 
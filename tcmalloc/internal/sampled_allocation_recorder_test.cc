@@ -136,6 +136,78 @@ TEST_F(SampleRecorderTest, Registration) {
   sample_recorder_.Unregister(info2);
 }
 
+TEST_F(SampleRecorderTest, IterateIncludingDead) {
+  auto GetSizesWithLiveness = [&](bool want_live) {
+    std::vector<size_t> res;
+    res.reserve(5);
+    sample_recorder_.Iterate([&](const Info& info, bool live) {
+      if (live == want_live) {
+        res.push_back(info.size.load(std::memory_order_acquire));
+      }
+    });
+    return res;
+  };
+
+  auto* info1 = Register(1);
+  auto* info2 = Register(2);
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/true),
+              UnorderedElementsAre(1, 2));
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/false), IsEmpty());
+
+  // A dead sample remains visible, with `live` == false, until its storage is
+  // reused by a later registration.
+  sample_recorder_.Unregister(info1);
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/true),
+              UnorderedElementsAre(2));
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/false),
+              UnorderedElementsAre(1));
+
+  auto* info3 = Register(3);
+  EXPECT_EQ(info1, info3);
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/true),
+              UnorderedElementsAre(2, 3));
+  EXPECT_THAT(GetSizesWithLiveness(/*want_live=*/false), IsEmpty());
+
+  sample_recorder_.Unregister(info2);
+  sample_recorder_.Unregister(info3);
+}
+
+TEST_F(SampleRecorderTest, RegisterOnShard) {
+  // Register with hashes that cover many shards; Iterate merges the shards,
+  // so every sample is visible exactly once.
+  constexpr size_t kSamples = 64;
+  std::vector<Info*> infos;
+  for (size_t hash = 0; hash < kSamples; ++hash) {
+    Info* info = sample_recorder_.RegisterOnShard(hash);
+    info->size.store(hash);
+    infos.push_back(info);
+  }
+
+  std::vector<size_t> sizes;
+  sizes.reserve(kSamples);
+  sample_recorder_.Iterate([&](const Info& info) {
+    sizes.push_back(info.size.load(std::memory_order_acquire));
+  });
+  std::sort(sizes.begin(), sizes.end());
+  ASSERT_EQ(sizes.size(), kSamples);
+  for (size_t i = 0; i < kSamples; ++i) {
+    EXPECT_EQ(sizes[i], i);
+  }
+
+  // A dead sample is revived by a later registration hashing to the same
+  // shard; revival never migrates a sample across shards.
+  Info* dead = infos[3];
+  const size_t shard = dead->shard;
+  sample_recorder_.Unregister(dead);
+  Info* revived = sample_recorder_.RegisterOnShard(shard);
+  EXPECT_EQ(revived, dead);
+  EXPECT_EQ(revived->shard, shard);
+
+  for (Info* info : infos) {
+    sample_recorder_.Unregister(info);
+  }
+}
+
 TEST_F(SampleRecorderTest, Unregistration) {
   std::vector<Info*> infos;
   for (size_t i = 0; i < 3; ++i) {
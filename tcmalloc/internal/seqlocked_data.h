@@ -0,0 +1,105 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_INTERNAL_SEQLOCKED_DATA_H_
+#define TCMALLOC_INTERNAL_SEQLOCKED_DATA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// A sequence-locked shadow copy of a statistics struct.  A subsystem that
+// maintains stats under its allocation lock publishes a snapshot with
+// Publish() while holding that lock; readers obtain an internally consistent
+// copy with Read() without acquiring any lock, retrying the (cheap) copy in
+// the unlikely event that a writer raced with them.
+//
+// Writers are assumed to be serialized externally; Publish() itself performs
+// no locking.  Readers never block writers, so a stats scrape cannot stall
+// allocation.
+//
+// Before the first Publish(), Read() returns a value-initialized T.
+template <typename T>
+class SeqLockedData {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLockedData requires a trivially copyable type");
+  static_assert(sizeof(T) % sizeof(uint64_t) == 0,
+                "SeqLockedData requires a word-multiple-sized type");
+
+ public:
+  constexpr SeqLockedData() = default;
+  SeqLockedData(const SeqLockedData&) = delete;
+  SeqLockedData& operator=(const SeqLockedData&) = delete;
+
+  // Publishes <value> as the current snapshot.
+  // REQUIRES: callers are serialized (e.g. by the lock guarding the source).
+  void Publish(const T& value) {
+    uint64_t src[kWords];
+    memcpy(src, &value, sizeof(T));
+
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    // Odd sequence marks a write in progress so that readers retry.
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+      words_[i].store(src[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Returns the most recently published snapshot.  Lock-free; loops only
+  // while a concurrent Publish() is in flight.
+  T Read() const {
+    uint64_t dst[kWords];
+    while (true) {
+      const uint64_t begin = seq_.load(std::memory_order_acquire);
+      if ((begin & 1) == 0) {
+        for (size_t i = 0; i < kWords; ++i) {
+          dst[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == begin) {
+          break;
+        }
+      }
+    }
+
+    T value;
+    memcpy(&value, dst, sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t kWords = sizeof(T) / sizeof(uint64_t);
+
+  std::atomic<uint64_t> seq_{0};
+  // The snapshot is stored as relaxed atomic words rather than a plain T so
+  // that a read racing a write is well-defined; the sequence check discards
+  // any torn copy.
+  std::atomic<uint64_t> words_[kWords] = {};
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_INTERNAL_SEQLOCKED_DATA_H_
@@ -0,0 +1,90 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/internal/seqlocked_data.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+struct Stats {
+  uint64_t a;
+  uint64_t b;
+  uint64_t c;
+};
+
+TEST(SeqLockedDataTest, ReadBeforeFirstPublishIsZero) {
+  SeqLockedData<Stats> data;
+  const Stats s = data.Read();
+  EXPECT_EQ(s.a, 0);
+  EXPECT_EQ(s.b, 0);
+  EXPECT_EQ(s.c, 0);
+}
+
+TEST(SeqLockedDataTest, RoundTrip) {
+  SeqLockedData<Stats> data;
+  data.Publish({1, 2, 3});
+  Stats s = data.Read();
+  EXPECT_EQ(s.a, 1);
+  EXPECT_EQ(s.b, 2);
+  EXPECT_EQ(s.c, 3);
+
+  data.Publish({4, 5, 6});
+  s = data.Read();
+  EXPECT_EQ(s.a, 4);
+  EXPECT_EQ(s.b, 5);
+  EXPECT_EQ(s.c, 6);
+}
+
+// Readers racing a writer must only ever observe snapshots published as a
+// unit, never a mix of two publications.
+TEST(SeqLockedDataTest, ConcurrentReadersSeeConsistentSnapshots) {
+  SeqLockedData<Stats> data;
+  std::atomic<bool> stop{false};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        const Stats s = data.Read();
+        // Every published snapshot satisfies b == 2 * a and c == a + b.
+        ASSERT_EQ(s.b, 2 * s.a);
+        ASSERT_EQ(s.c, s.a + s.b);
+      }
+    });
+  }
+
+  for (uint64_t i = 1; i <= 100000; ++i) {
+    data.Publish({i, 2 * i, 3 * i});
+  }
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  const Stats s = data.Read();
+  EXPECT_EQ(s.a, 100000);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
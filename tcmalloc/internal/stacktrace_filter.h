@@ -29,6 +29,14 @@ class GuardedAllocAlignmentTest;
 
 namespace tcmalloc_internal {
 
+// Hash of a stack trace's program counters.  Shared by StackTraceFilter and
+// other consumers that key data structures by stack identity (e.g. the
+// sampled-allocation recorder's shard selection).
+inline size_t HashOfStackTrace(const StackTrace& stacktrace) {
+  return absl::HashOf(
+      absl::Span<void* const>(stacktrace.stack, stacktrace.depth));
+}
+
 // This class maintains a small collection of StackTrace hashes which are used
 // to inform the selection of allocations to be guarded. It provides two
 // functions:
@@ -66,8 +74,7 @@ class StackTraceFilter {
   std::atomic<size_t> replacement_inserts_{0};
 
   inline size_t HashOfStackTrace(const StackTrace& stacktrace) const {
-    return absl::HashOf(
-        absl::Span<void* const>(stacktrace.stack, stacktrace.depth));
+    return tcmalloc_internal::HashOfStackTrace(stacktrace);
   }
 
   friend class GuardedPageAllocatorProfileTest;
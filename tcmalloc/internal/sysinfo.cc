@@ -28,6 +28,7 @@
 #include "absl/strings/numbers.h"
 #include "absl/strings/string_view.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/environment.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/util.h"
 
@@ -131,6 +132,37 @@ int NumPossibleCPUsNoCache() {
   return *max_so_far + 1;
 }
 
+int NumUsableCPUsNoCache() {
+  const int num_cpus = NumCPUs();
+  const char* e = thread_safe_getenv("TCMALLOC_BOUND_SLABS_TO_CPUSET");
+  if (e == nullptr || e[0] != '1') {
+    return num_cpus;
+  }
+  // cgroup v2, then v1.  These report the effective cpuset, i.e. what the
+  // container can actually be scheduled on.
+  for (const char* path : {"/sys/fs/cgroup/cpuset.cpus.effective",
+                           "/sys/fs/cgroup/cpuset/cpuset.effective_cpus"}) {
+    int fd = signal_safe_open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    std::optional<cpu_set_t> cpus =
+        ParseCpulist([&](char* const buf, const size_t count) {
+          return signal_safe_read(fd, buf, count, /*bytes_read=*/nullptr);
+        });
+    signal_safe_close(fd);
+    if (!cpus.has_value()) {
+      continue;
+    }
+    for (int cpu = std::min(num_cpus, CPU_SETSIZE) - 1; cpu >= 0; --cpu) {
+      if (CPU_ISSET(cpu, &*cpus)) {
+        return cpu + 1;
+      }
+    }
+  }
+  return num_cpus;
+}
+
 }  // namespace sysinfo_internal
 
 #endif  // __linux__
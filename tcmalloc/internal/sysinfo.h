@@ -53,6 +53,14 @@ namespace sysinfo_internal {
 // The result of this function is not cached internally.
 int NumPossibleCPUsNoCache();
 
+// Returns the number of CPU slots per-CPU data structures need to provision:
+// NumCPUs(), or, when TCMALLOC_BOUND_SLABS_TO_CPUSET=1 is set, the highest
+// CPU in the cgroup's effective cpuset plus one.  Falls back to NumCPUs() if
+// the cpuset cannot be read.
+//
+// The result of this function is not cached internally.
+int NumUsableCPUsNoCache();
+
 }  // namespace sysinfo_internal
 #endif  // __linux__
 
@@ -64,6 +72,21 @@ inline int NumCPUs() {
   return result;
 }
 
+// Upper bound (exclusive) on the CPU IDs the per-CPU caches provision slots
+// for.  Defaults to NumCPUs(); with TCMALLOC_BOUND_SLABS_TO_CPUSET=1 it is
+// capped by the cgroup's effective cpuset, which shrinks the slab mapping on
+// cpuset-confined hosts (e.g. a 16-vCPU pod on large metal).  The bound is
+// fixed at first use: if the cpuset later grows past it, threads running on
+// the new CPUs safely bypass the per-CPU caches and are served by the
+// transfer caches instead.
+inline int NumUsableCPUs() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  ABSL_CONST_INIT static int result;
+  absl::base_internal::LowLevelCallOnce(
+      &flag, [&]() { result = sysinfo_internal::NumUsableCPUsNoCache(); });
+  return result;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
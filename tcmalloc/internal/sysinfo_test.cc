@@ -154,6 +154,22 @@ TEST(NumCPUs, Cached) {
   EXPECT_EQ(NumCPUs(), absl::base_internal::NumCPUs());
 }
 
+TEST(NumUsableCPUs, DefaultsToNumCPUs) {
+  // Without the TCMALLOC_BOUND_SLABS_TO_CPUSET opt-in, the bound is the full
+  // possible-CPU count.
+  EXPECT_EQ(NumUsableCPUs(), NumCPUs());
+}
+
+TEST(NumUsableCPUs, NeverExceedsNumCPUs) {
+  const int result = []() {
+    AllocationGuard guard;
+    return sysinfo_internal::NumUsableCPUsNoCache();
+  }();
+
+  EXPECT_GE(result, 1);
+  EXPECT_LE(result, NumCPUs());
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
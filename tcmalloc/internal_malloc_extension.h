@@ -68,6 +68,8 @@ ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetRegionFactory(
 
 ABSL_ATTRIBUTE_WEAK const tcmalloc::tcmalloc_internal::ProfileBase*
 MallocExtension_Internal_SnapshotCurrent(tcmalloc::ProfileType type);
+ABSL_ATTRIBUTE_WEAK const tcmalloc::tcmalloc_internal::ProfileBase*
+MallocExtension_Internal_SnapshotHeapProfileSince(uint64_t* generation);
 
 ABSL_ATTRIBUTE_WEAK tcmalloc::tcmalloc_internal::AllocationProfilingTokenBase*
 MallocExtension_Internal_StartAllocationProfiling();
@@ -77,6 +79,9 @@ MallocExtension_Internal_StartLifetimeProfiling();
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_ActivateGuardedSampling();
 ABSL_ATTRIBUTE_WEAK tcmalloc::MallocExtension::Ownership
 MallocExtension_Internal_GetOwnership(const void* ptr);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetOwnershipBatch(
+    const void* const* ptrs, tcmalloc::MallocExtension::PointerInfo* info,
+    size_t count);
 ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetMemoryLimit(
     tcmalloc::MallocExtension::LimitKind limit_kind);
 ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_GetNumericProperty(
@@ -96,8 +101,39 @@ ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetSkipSubreleaseLongInterval(
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetProperties(
     std::map<std::string, tcmalloc::MallocExtension::Property>* ret);
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetStats(std::string* ret);
+ABSL_ATTRIBUTE_WEAK size_t
+MallocExtension_Internal_GetBinaryStats(void* buffer, size_t buffer_length);
+ABSL_ATTRIBUTE_WEAK size_t
+MallocExtension_Internal_GetHugeCacheState(char* buffer, size_t buffer_length);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_SetHugeCacheState(
+    const char* data, size_t size);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetLatencyProfile(
+    std::string* ret);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_GetLatencyProfilingEnabled();
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetLatencyProfilingEnabled(
+    bool value);
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetMaxPerCpuCacheSize(
     int32_t value);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_SetTuningProfile(
+    const char* name_data, size_t name_size);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_GetTuningProfile(
+    std::string* ret);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetDynamicSlabResizeTrace(
+    tcmalloc::MallocExtension::DynamicSlabResizeTraceEntry* entries,
+    size_t count);
+ABSL_ATTRIBUTE_WEAK int MallocExtension_Internal_GetCacheTopologyShardCount();
+ABSL_ATTRIBUTE_WEAK int MallocExtension_Internal_GetCacheTopologyShardForCpu(
+    int cpu);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetCacheTopologyShardBytes(
+    int shard);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetThreadCacheOccupancy(
+    uint64_t* buckets, size_t count);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetTopAllocationSites(
+    tcmalloc::MallocExtension::AllocationSiteStats* sites, size_t count);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_ActivatePinnedArena(
+    size_t bytes);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_EnterPinnedScope();
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_ExitPinnedScope();
 ABSL_ATTRIBUTE_WEAK void
 MallocExtension_Internal_SetBackgroundProcessActionsEnabled(bool value);
 ABSL_ATTRIBUTE_WEAK void
@@ -112,19 +148,52 @@ ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetSkipSubreleaseLongInterval(
 ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_ReleaseCpuMemory(int cpu);
 ABSL_ATTRIBUTE_WEAK size_t
 MallocExtension_Internal_ReleaseMemoryToSystem(size_t bytes);
+ABSL_ATTRIBUTE_WEAK void
+MallocExtension_Internal_ReleaseMemoryToSystemWithDeadline(
+    size_t bytes, absl::Duration timeout, bool break_hugepages,
+    tcmalloc::MallocExtension::DeadlineReleaseStats* result);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_MarkUnreleasable(
+    void* ptr, size_t len, bool unreleasable);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_ReserveHeapMetadata(
+    size_t max_heap_bytes);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_Prefault(void* ptr,
+                                                             size_t len,
+                                                             int parallelism);
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetMemoryLimit(
     size_t limit, tcmalloc::MallocExtension::LimitKind limit_kind);
+ABSL_ATTRIBUTE_WEAK int MallocExtension_Internal_CreateReservePool(
+    size_t bytes);
+ABSL_ATTRIBUTE_WEAK bool MallocExtension_Internal_DestroyReservePool(
+    int handle);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_AcquireFromReservePool(
+    int handle, size_t bytes);
 
 ABSL_ATTRIBUTE_WEAK size_t
 MallocExtension_Internal_GetAllocatedSize(const void* ptr);
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetAllocSizeClass(
+    size_t size);
+ABSL_ATTRIBUTE_WEAK void* MallocExtension_Internal_AllocOfSizeClass(
+    size_t size_class, size_t size);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_FreeOfSizeClass(
+    void* ptr, size_t size_class);
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_MarkThreadBusy();
+ABSL_ATTRIBUTE_WEAK void MallocExtension_EnableForkSupport();
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_MarkThreadIdle();
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_MarkProcessIdle();
+ABSL_ATTRIBUTE_WEAK size_t MallocExtension_Internal_GetThreadAllocatedBytes();
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_Warmup(
+    const tcmalloc::MallocExtension::WarmupSpec* spec);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_RunSelfTest(
+    tcmalloc::MallocExtension::SelfTestResult* result);
 
 ABSL_ATTRIBUTE_WEAK int64_t MallocExtension_Internal_GetProfileSamplingRate();
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetProfileSamplingRate(
     int64_t);
 
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_ProcessBackgroundActions();
+ABSL_ATTRIBUTE_WEAK void
+MallocExtension_Internal_ProcessBackgroundActionsForNumaPartition(
+    int numa_partition);
 
 ABSL_ATTRIBUTE_WEAK tcmalloc::MallocExtension::BytesPerSecond
 MallocExtension_Internal_GetBackgroundReleaseRate();
@@ -134,6 +203,8 @@ ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetBackgroundReleaseRate(
 ABSL_ATTRIBUTE_WEAK int64_t MallocExtension_Internal_GetGuardedSamplingRate();
 ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetGuardedSamplingRate(
     int64_t);
+ABSL_ATTRIBUTE_WEAK void MallocExtension_Internal_SetGuardedSamplingWeight(
+    size_t min_size, size_t max_size, uint8_t weight);
 
 ABSL_ATTRIBUTE_WEAK int64_t
 MallocExtension_Internal_GetMaxTotalThreadCacheBytes();
@@ -20,6 +20,8 @@
 #ifndef TCMALLOC_INTERNAL_MALLOC_TRACING_EXTENSION_H_
 #define TCMALLOC_INTERNAL_MALLOC_TRACING_EXTENSION_H_
 
+#include <string>
+
 #include "absl/base/attributes.h"
 #include "absl/status/statusor.h"
 #include "tcmalloc/malloc_tracing_extension.h"
@@ -30,6 +32,31 @@ ABSL_ATTRIBUTE_WEAK
 absl::StatusOr<tcmalloc::malloc_tracing_extension::AllocatedAddressRanges>
 MallocTracingExtension_Internal_GetAllocatedAddressRanges();
 
+ABSL_ATTRIBUTE_WEAK void MallocTracingExtension_Internal_ClassifyAddresses(
+    const uintptr_t* addresses, size_t count,
+    tcmalloc::malloc_tracing_extension::AddressOwnership* results);
+
+ABSL_ATTRIBUTE_WEAK
+absl::StatusOr<tcmalloc::malloc_tracing_extension::AllocationSiteTable>
+MallocTracingExtension_Internal_GetAllocationSiteStats();
+
+ABSL_ATTRIBUTE_WEAK
+absl::StatusOr<tcmalloc::malloc_tracing_extension::GrowthLedger>
+MallocTracingExtension_Internal_GetGrowthLedger();
+
+// Allocation trace capture.  Start/Stop return 0 on success or an errno
+// value; see malloc_tracing_extension.h for semantics.
+ABSL_ATTRIBUTE_WEAK int MallocTracingExtension_Internal_StartAllocationTrace(
+    const char* path, int sample_interval);
+ABSL_ATTRIBUTE_WEAK int MallocTracingExtension_Internal_StopAllocationTrace();
+ABSL_ATTRIBUTE_WEAK void MallocTracingExtension_Internal_DrainAllocationTrace();
+ABSL_ATTRIBUTE_WEAK void MallocTracingExtension_Internal_GetAllocationTraceStats(
+    tcmalloc::malloc_tracing_extension::AllocationTraceStats* stats);
+
+ABSL_ATTRIBUTE_WEAK
+absl::StatusOr<std::string>
+MallocTracingExtension_Internal_GetHeapLayoutSnapshot();
+
 #endif
 
 #endif  // TCMALLOC_INTERNAL_MALLOC_TRACING_EXTENSION_H_
@@ -0,0 +1,169 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/large_span_cache.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/cache_topology.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/percpu.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// The cached band starts just past the largest size class and covers the
+// multi-page buffer sizes (up to 1 MiB) that churn in practice; anything
+// larger is rare enough that the pageheap trip does not dominate.
+constexpr size_t kMinCachedPages = kMaxSize / kPageSize + 1;
+constexpr size_t kMaxCachedPages = (1 << 20) / kPageSize;
+
+// Direct-mapped slots per shard, a few spans deep.  A slot holds spans of a
+// single page count; on a collision the resident size keeps the slot, which
+// naturally favors whichever size actually recycles.
+constexpr size_t kShardSlots = 16;
+constexpr int kSlotDepth = 4;
+constexpr size_t kMaxShards = 16;
+
+struct Slot {
+  size_t pages = 0;
+  Span* spans[kSlotDepth] = {};
+  int count = 0;
+  // Set by Insert and Remove, cleared by the plunder sweep; a slot that
+  // stays clear for a full interval holds spans nobody wants.
+  bool touched = false;
+};
+
+struct Shard {
+  absl::base_internal::SpinLock lock{
+      absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY};
+  Slot slots[kShardSlots] ABSL_GUARDED_BY(lock);
+};
+
+ABSL_CONST_INIT Shard shards[kMaxShards];
+
+ABSL_CONST_INIT std::atomic<size_t> cached_bytes{0};
+ABSL_CONST_INIT std::atomic<size_t> cache_hits{0};
+
+Shard& CurrentShard() {
+  const int cpu = subtle::percpu::GetCurrentCpu();
+  if (cpu < 0) {
+    return shards[0];
+  }
+  return shards[CacheTopology::Instance().GetL3FromCpuId(cpu) % kMaxShards];
+}
+
+bool InCachedBand(size_t pages) {
+  return pages >= kMinCachedPages && pages <= kMaxCachedPages;
+}
+
+}  // namespace
+
+Span* LargeSpanCacheRemove(Length pages) {
+  const size_t n = pages.raw_num();
+  if (!InCachedBand(n)) {
+    return nullptr;
+  }
+  Shard& shard = CurrentShard();
+  Span* span;
+  {
+    AllocationGuardSpinLockHolder l(&shard.lock);
+    Slot& slot = shard.slots[n % kShardSlots];
+    if (slot.count == 0 || slot.pages != n) {
+      return nullptr;
+    }
+    span = slot.spans[--slot.count];
+    slot.touched = true;
+  }
+  TC_ASSERT_EQ(span->num_pages(), pages);
+  cached_bytes.fetch_sub(span->bytes_in_span(), std::memory_order_relaxed);
+  cache_hits.fetch_add(1, std::memory_order_relaxed);
+  return span;
+}
+
+bool LargeSpanCacheInsert(Span* span) {
+  const size_t n = span->num_pages().raw_num();
+  if (!InCachedBand(n)) {
+    return false;
+  }
+  Shard& shard = CurrentShard();
+  {
+    AllocationGuardSpinLockHolder l(&shard.lock);
+    Slot& slot = shard.slots[n % kShardSlots];
+    if (slot.count > 0 && slot.pages != n) {
+      // The slot is resident to another size; let that one keep recycling.
+      return false;
+    }
+    if (slot.count == kSlotDepth) {
+      return false;
+    }
+    slot.pages = n;
+    slot.spans[slot.count++] = span;
+    slot.touched = true;
+  }
+  cached_bytes.fetch_add(span->bytes_in_span(), std::memory_order_relaxed);
+  return true;
+}
+
+void PlunderLargeSpanCache() {
+  for (size_t s = 0; s < kMaxShards; ++s) {
+    Shard& shard = shards[s];
+    for (size_t i = 0; i < kShardSlots; ++i) {
+      Span* evicted[kSlotDepth];
+      int num_evicted = 0;
+      {
+        AllocationGuardSpinLockHolder l(&shard.lock);
+        Slot& slot = shard.slots[i];
+        if (slot.touched) {
+          slot.touched = false;
+          continue;
+        }
+        while (slot.count > 0) {
+          evicted[num_evicted++] = slot.spans[--slot.count];
+        }
+      }
+      for (int j = 0; j < num_evicted; ++j) {
+        cached_bytes.fetch_sub(evicted[j]->bytes_in_span(),
+                               std::memory_order_relaxed);
+        PageHeapSpinLockHolder l;
+        tc_globals.page_allocator().Delete(evicted[j], /*objects_per_span=*/1,
+                                           MemoryTag::kNormal);
+      }
+    }
+  }
+}
+
+size_t LargeSpanCacheBytes() {
+  return cached_bytes.load(std::memory_order_relaxed);
+}
+
+size_t LargeSpanCacheHits() {
+  return cache_hits.load(std::memory_order_relaxed);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
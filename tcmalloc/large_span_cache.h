@@ -0,0 +1,66 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A small cache of whole spans for allocations beyond kMaxSize.  The transfer
+// caches stop at the largest size class, so a workload that churns the same
+// 256 KiB buffer pays a pageheap_lock round trip on every cycle even though
+// the identical span was freed moments ago on the same socket.  When
+// Parameters::large_span_cache_enabled() is on, frees of normal-tagged spans
+// up to 1 MiB park the span in a per-L3 shard keyed by exact page count, and
+// a later allocation of the same size on that shard reuses it without
+// touching the page heap.  The background thread evicts spans that went a
+// full plunder interval without being served, so an idle size's spans return
+// to the page heap within seconds.
+
+#ifndef TCMALLOC_LARGE_SPAN_CACHE_H_
+#define TCMALLOC_LARGE_SPAN_CACHE_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/span.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Returns a cached span of exactly <pages> pages from the current CPU's
+// shard, or nullptr on a miss.  The span is ready for reuse; its pagemap
+// registration from the original allocation still stands.
+Span* LargeSpanCacheRemove(Length pages);
+
+// Offers <span> (normal-tagged, fully freed, per-free bookkeeping done) to
+// the current CPU's shard.  Returns false if the span's size is out of the
+// cached band or its slot is full, in which case the caller must free the
+// span normally.
+bool LargeSpanCacheInsert(Span* span);
+
+// Returns every span that was neither inserted nor served since the previous
+// call to the page allocator.  Called periodically from the background
+// thread; tests may call it directly.  Calling it twice empties the cache.
+void PlunderLargeSpanCache();
+
+// Bytes currently parked in the cache.  They still count as in use in the
+// page allocator's stats, like spans held by the central freelists.
+size_t LargeSpanCacheBytes();
+
+// Number of allocations served from the cache.
+size_t LargeSpanCacheHits();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_LARGE_SPAN_CACHE_H_
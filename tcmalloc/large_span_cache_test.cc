@@ -0,0 +1,101 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/large_span_cache.h"
+
+#include <cstddef>
+#include <new>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// 512 KiB: past kMaxSize, within the cached band.
+constexpr size_t kBufferSize = 512 << 10;
+
+// Enables the cache for the duration of a test and empties it on the way
+// out (two plunder sweeps evict even freshly touched slots).
+class ScopedLargeSpanCache {
+ public:
+  ScopedLargeSpanCache() : previous_(Parameters::large_span_cache_enabled()) {
+    Parameters::set_large_span_cache_enabled(true);
+  }
+  ~ScopedLargeSpanCache() {
+    Parameters::set_large_span_cache_enabled(previous_);
+    PlunderLargeSpanCache();
+    PlunderLargeSpanCache();
+  }
+
+ private:
+  bool previous_;
+};
+
+TEST(LargeSpanCacheTest, FreeParksSpanAndAllocationReusesIt) {
+  static_assert(kBufferSize > kMaxSize);
+  ScopedNeverSample never_sample;
+  ScopedLargeSpanCache cache;
+
+  void* ptr = ::operator new(kBufferSize);
+  ASSERT_NE(ptr, nullptr);
+  const size_t bytes_before = LargeSpanCacheBytes();
+  ::operator delete(ptr);
+  ASSERT_GE(LargeSpanCacheBytes(), bytes_before + kBufferSize);
+
+  // Churn the same size a few times; unless the thread migrates to another
+  // L3 shard mid-cycle, every allocation after the first free is a hit.
+  const size_t hits_before = LargeSpanCacheHits();
+  for (int i = 0; i < 5; ++i) {
+    void* reused = ::operator new(kBufferSize);
+    ASSERT_NE(reused, nullptr);
+    ::operator delete(reused);
+  }
+  EXPECT_GE(LargeSpanCacheHits(), hits_before + 1);
+}
+
+TEST(LargeSpanCacheTest, SmallAndHugeAllocationsBypassTheCache) {
+  ScopedNeverSample never_sample;
+  ScopedLargeSpanCache cache;
+
+  const size_t bytes_before = LargeSpanCacheBytes();
+  // Below the band: served by the size classes.
+  void* small = ::operator new(1024);
+  ::operator delete(small);
+  // Above the band: not worth parking.
+  void* huge = ::operator new(8 << 20);
+  ::operator delete(huge);
+  EXPECT_EQ(LargeSpanCacheBytes(), bytes_before);
+}
+
+TEST(LargeSpanCacheTest, PlunderEvictsIdleSpans) {
+  ScopedNeverSample never_sample;
+  ScopedLargeSpanCache cache;
+
+  void* ptr = ::operator new(kBufferSize);
+  ::operator delete(ptr);
+  ASSERT_GT(LargeSpanCacheBytes(), 0);
+
+  // First sweep clears the touched bits, second evicts.
+  PlunderLargeSpanCache();
+  PlunderLargeSpanCache();
+  EXPECT_EQ(LargeSpanCacheBytes(), 0);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
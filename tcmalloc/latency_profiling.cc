@@ -0,0 +1,78 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/latency_profiling.h"
+
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+ABSL_CONST_INIT static LatencyHistogram
+    latency_histograms[static_cast<int>(LatencyProfileKind::kNumKinds)];
+
+LatencyHistogram& GetLatencyHistogram(LatencyProfileKind kind) {
+  TC_ASSERT_LT(static_cast<int>(kind),
+               static_cast<int>(LatencyProfileKind::kNumKinds));
+  return latency_histograms[static_cast<int>(kind)];
+}
+
+static const char* KindName(LatencyProfileKind kind) {
+  switch (kind) {
+    case LatencyProfileKind::kPerCpuAllocMiss:
+      return "percpu_alloc_miss";
+    case LatencyProfileKind::kPerCpuFreeMiss:
+      return "percpu_free_miss";
+    case LatencyProfileKind::kBackingCacheFill:
+      return "backing_cache_fill";
+    case LatencyProfileKind::kPageAllocation:
+      return "page_allocation";
+    default:
+      return "unknown";
+  }
+}
+
+void PrintLatencyProfile(Printer* out) {
+  out->printf("------------------------------------------------\n");
+  out->printf("Slow-path latency profile (cycles; bucket N counts samples in "
+              "[2^(N-1), 2^N))\n");
+  out->printf("Latency profiling enabled: %d\n",
+              LatencyProfilingActive() ? 1 : 0);
+  out->printf("------------------------------------------------\n");
+  for (int kind = 0; kind < static_cast<int>(LatencyProfileKind::kNumKinds);
+       ++kind) {
+    const LatencyHistogram& h =
+        latency_histograms[static_cast<int>(LatencyProfileKind(kind))];
+    int64_t total = 0;
+    for (int b = 0; b < LatencyHistogram::kNumBuckets; ++b) {
+      total += h.bucket_count(b);
+    }
+    out->printf("%s: %d samples\n", KindName(LatencyProfileKind(kind)), total);
+    if (total == 0) continue;
+    for (int b = 0; b < LatencyHistogram::kNumBuckets; ++b) {
+      const int64_t count = h.bucket_count(b);
+      if (count == 0) continue;
+      out->printf("  bucket %2d (< 2^%-2d cycles): %12d\n", b, b, count);
+    }
+  }
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,110 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_LATENCY_PROFILING_H_
+#define TCMALLOC_LATENCY_PROFILING_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "absl/base/internal/cycleclock.h"
+#include "absl/base/optimization.h"
+#include "absl/numeric/bits.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/parameters.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Slow paths instrumented with cycle-count latency histograms.  Miss counts
+// (CpuCacheMissStats) tell us how often we leave the fast path; these
+// histograms tell us how long the excursions take.
+enum class LatencyProfileKind : int {
+  // Per-cpu cache allocation miss: refill from the backing caches.
+  kPerCpuAllocMiss = 0,
+  // Per-cpu cache deallocation miss: overflow to the backing caches.
+  kPerCpuFreeMiss,
+  // Fill from the transfer cache (or sharded transfer cache) into the per-cpu
+  // slab, including central free list and page heap falls underneath.
+  kBackingCacheFill,
+  // Direct page allocator allocation for objects above kMaxSize.
+  kPageAllocation,
+  kNumKinds,
+};
+
+// Histogram of latencies with power-of-two bucket boundaries, in cycles.
+// Bucket i counts samples in [2^(i-1), 2^i); bucket 0 counts zero-cycle
+// samples.  Recording uses lossy per-bucket counters so that concurrent slow
+// paths on different CPUs do not serialize on the histogram.
+class LatencyHistogram {
+ public:
+  static constexpr int kNumBuckets = 32;
+
+  constexpr LatencyHistogram() = default;
+
+  void Record(uint64_t cycles) { buckets_[BucketFor(cycles)].LossyAdd(1); }
+
+  int64_t bucket_count(int bucket) const { return buckets_[bucket].value(); }
+
+  static int BucketFor(uint64_t cycles) {
+    return std::min<int>(kNumBuckets - 1, absl::bit_width(cycles));
+  }
+
+ private:
+  StatsCounter buckets_[kNumBuckets];
+};
+
+// Returns the global histogram for the given slow path.
+LatencyHistogram& GetLatencyHistogram(LatencyProfileKind kind);
+
+// Prints all slow-path histograms in a human readable form.
+void PrintLatencyProfile(Printer* out);
+
+inline bool LatencyProfilingActive() {
+  return Parameters::latency_profiling_enabled();
+}
+
+// RAII cycle timer recording into the <kind> histogram at scope exit.  When
+// latency profiling is disabled (the default) the cost is a single relaxed
+// load of the parameter.
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(LatencyProfileKind kind)
+      : kind_(kind),
+        start_(ABSL_PREDICT_TRUE(!LatencyProfilingActive())
+                   ? -1
+                   : absl::base_internal::CycleClock::Now()) {}
+
+  ~ScopedLatencyTimer() {
+    if (ABSL_PREDICT_TRUE(start_ < 0)) return;
+    const int64_t cycles = absl::base_internal::CycleClock::Now() - start_;
+    GetLatencyHistogram(kind_).Record(cycles < 0 ? 0 : cycles);
+  }
+
+  ScopedLatencyTimer(const ScopedLatencyTimer&) = delete;
+  ScopedLatencyTimer& operator=(const ScopedLatencyTimer&) = delete;
+
+ private:
+  const LatencyProfileKind kind_;
+  const int64_t start_;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_LATENCY_PROFILING_H_
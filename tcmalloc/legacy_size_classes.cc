@@ -50,7 +50,7 @@ namespace tcmalloc_internal {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -149,7 +149,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -240,7 +240,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -342,7 +342,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -405,7 +405,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -504,7 +504,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -595,7 +595,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -697,7 +697,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -0,0 +1,174 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_LIFETIME_PREDICTION_H_
+#define TCMALLOC_LIFETIME_PREDICTION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/internal/cycleclock.h"
+#include "absl/debugging/stacktrace.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/pages.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Predicts, per allocation site, whether a page-level allocation will be
+// short-lived (see docs/lifetime-based-allocator.md).  Sites are identified
+// by a hash of a short stack trace; predictions are trained online by
+// observing the realized lifetime of allocations made from each site.
+//
+// Both tables are fixed-size and direct-mapped so that the predictor never
+// allocates: colliding sites evict each other and colliding live allocations
+// are simply not tracked.  All methods except CurrentSiteHash must be called
+// under pageheap_lock; the HugePageAwareAllocator guards its instance
+// accordingly.
+class LifetimePredictor {
+ public:
+  constexpr LifetimePredictor() = default;
+
+  // Hashes the current allocation stack into a site identifier.  Never
+  // returns zero, so callers can use zero for "no site captured".  Must be
+  // called outside pageheap_lock; collecting the stack trace is too expensive
+  // to do under the lock.
+  static uintptr_t CurrentSiteHash() {
+    void* stack[kSiteStackDepth];
+    const int depth = absl::GetStackTrace(stack, kSiteStackDepth,
+                                          /*skip_count=*/2);
+    uintptr_t h = 0;
+    for (int i = 0; i < depth; ++i) {
+      h = (h + reinterpret_cast<uintptr_t>(stack[i])) * kHashMultiplier;
+    }
+    return h | 1;
+  }
+
+  // Returns true if allocations from this site have been observed to be
+  // overwhelmingly short-lived.  We require a minimum number of observations
+  // and a strong majority so that a site is only segregated once the evidence
+  // is unambiguous; a mispredicted-short allocation pins its dedicated
+  // hugepage until it dies.
+  bool PredictShortLived(uintptr_t site_hash) const {
+    const SiteEntry& site = sites_[site_hash % kSiteSlots];
+    if (site.hash != site_hash) return false;
+    return site.short_count >= kMinShortObservations &&
+           site.short_count >= kShortToLongRatio * site.long_count;
+  }
+
+  // Starts tracking the allocation beginning at page p.  If the slot for p is
+  // already taken, the previous occupant is evicted untrained; this keeps the
+  // predictor O(1) in space at the cost of losing some observations.
+  void RecordAlloc(PageId p, uintptr_t site_hash, bool predicted_short) {
+    LiveEntry& live = live_[SlotForPage(p)];
+    live.first_page = p.index();
+    live.site_hash = site_hash;
+    live.alloc_cycles = absl::base_internal::CycleClock::Now();
+    live.predicted_short = predicted_short;
+  }
+
+  // Observes the deallocation of the allocation beginning at page p, if it is
+  // still tracked, training the site table and the accuracy counters.
+  void RecordFree(PageId p) {
+    LiveEntry& live = live_[SlotForPage(p)];
+    if (live.first_page != p.index() || live.site_hash == 0) return;
+    const double lifetime_cycles =
+        absl::base_internal::CycleClock::Now() - live.alloc_cycles;
+    const bool was_short =
+        lifetime_cycles <
+        kShortLifetimeSeconds * absl::base_internal::CycleClock::Frequency();
+
+    SiteEntry& site = sites_[live.site_hash % kSiteSlots];
+    if (site.hash != live.site_hash) {
+      // Direct-mapped collision: the new site takes over the slot.
+      site.hash = live.site_hash;
+      site.short_count = 0;
+      site.long_count = 0;
+    }
+    if (was_short) {
+      ++site.short_count;
+    } else {
+      ++site.long_count;
+      // A site that produced a long-lived allocation decays quickly: halve
+      // the short evidence so phase changes stop segregation promptly.
+      site.short_count /= 2;
+    }
+
+    if (live.predicted_short) {
+      ++(was_short ? correct_short_ : mispredicted_short_);
+    } else {
+      ++(was_short ? mispredicted_long_ : correct_long_);
+    }
+    live.site_hash = 0;
+  }
+
+  // Accuracy counters: predictions are scored when the allocation dies.
+  // "short"/"long" name the prediction; correct/mispredicted name the
+  // outcome.
+  int64_t correct_short_predictions() const { return correct_short_; }
+  int64_t mispredicted_short_predictions() const {
+    return mispredicted_short_;
+  }
+  int64_t correct_long_predictions() const { return correct_long_; }
+  int64_t mispredicted_long_predictions() const { return mispredicted_long_; }
+
+ private:
+  // Frames hashed into a site identifier.  Deep enough to separate callers of
+  // common allocation wrappers, shallow enough to keep New() cheap.
+  static constexpr int kSiteStackDepth = 8;
+  static constexpr uintptr_t kHashMultiplier = 0x9ddfea08eb382d69ULL;
+
+  // An allocation is short-lived if it is freed within this many seconds.
+  // Matches the threshold discussed in docs/lifetime-based-allocator.md.
+  static constexpr double kShortLifetimeSeconds = 2.0;
+
+  static constexpr uint32_t kMinShortObservations = 16;
+  static constexpr uint32_t kShortToLongRatio = 8;
+
+  static constexpr size_t kSiteSlots = 512;
+  static constexpr size_t kLiveSlots = 256;
+
+  struct SiteEntry {
+    uintptr_t hash = 0;
+    uint32_t short_count = 0;
+    uint32_t long_count = 0;
+  };
+
+  struct LiveEntry {
+    uintptr_t first_page = 0;
+    // Zero while the slot is unoccupied; site hashes are never zero.
+    uintptr_t site_hash = 0;
+    double alloc_cycles = 0;
+    bool predicted_short = false;
+  };
+
+  static size_t SlotForPage(PageId p) {
+    return (p.index() * kHashMultiplier) % kLiveSlots;
+  }
+
+  SiteEntry sites_[kSiteSlots] = {};
+  LiveEntry live_[kLiveSlots] = {};
+
+  int64_t correct_short_ = 0;
+  int64_t mispredicted_short_ = 0;
+  int64_t correct_long_ = 0;
+  int64_t mispredicted_long_ = 0;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_LIFETIME_PREDICTION_H_
@@ -50,7 +50,7 @@ namespace tcmalloc_internal {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -145,7 +145,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -232,7 +232,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -330,7 +330,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -389,7 +389,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -487,7 +487,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -577,7 +577,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 262144, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = true,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 2097152,
   .large_size = 1024,
   .large_size_alignment = 128,
@@ -678,7 +678,7 @@ static constexpr SizeClassInfo List[] = {
 static_assert(kMaxSize == 8192, "kMaxSize mismatch");
 static constexpr SizeClassAssumptions Assumptions{
   .has_expanded_classes = false,
-  .span_size = 48,
+  .span_size = 56,
   .sampling_rate = 524288,
   .large_size = 1024,
   .large_size_alignment = 128,
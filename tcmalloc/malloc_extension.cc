@@ -170,6 +170,12 @@ AddressRegion::~AddressRegion() {}
 
 AddressRegionFactory::~AddressRegionFactory() {}
 
+bool AddressRegionFactory::Release(void* start, size_t size) {
+  static_cast<void>(start);
+  static_cast<void>(size);
+  return false;
+}
+
 size_t AddressRegionFactory::GetStats(absl::Span<char> buffer) {
   static_cast<void>(buffer);
   return 0;
@@ -224,6 +230,70 @@ std::string MallocExtension::GetStats() {
   return "";
 }
 
+size_t MallocExtension::GetBinaryStats(void* buffer, size_t buffer_length) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_GetBinaryStats != nullptr) {
+    return MallocExtension_Internal_GetBinaryStats(buffer, buffer_length);
+  }
+#endif
+  return 0;
+}
+
+size_t MallocExtension::GetHugeCacheState(absl::Span<char> buffer) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_GetHugeCacheState != nullptr) {
+    return MallocExtension_Internal_GetHugeCacheState(buffer.data(),
+                                                      buffer.size());
+  }
+#endif
+  return 0;
+}
+
+bool MallocExtension::SetHugeCacheState(absl::string_view state) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_SetHugeCacheState != nullptr) {
+    return MallocExtension_Internal_SetHugeCacheState(state.data(),
+                                                      state.size());
+  }
+#endif
+  return false;
+}
+
+std::string MallocExtension::GetLatencyProfile() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_GetLatencyProfile != nullptr) {
+    std::string ret;
+    MallocExtension_Internal_GetLatencyProfile(&ret);
+    return ret;
+  }
+#endif
+  return "";
+}
+
+bool MallocExtension::GetLatencyProfilingEnabled() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetLatencyProfilingEnabled == nullptr) {
+    return false;
+  }
+
+  return MallocExtension_Internal_GetLatencyProfilingEnabled();
+#else
+  return false;
+#endif
+}
+
+void MallocExtension::SetLatencyProfilingEnabled(bool value) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_SetLatencyProfilingEnabled == nullptr) {
+    return;
+  }
+
+  MallocExtension_Internal_SetLatencyProfilingEnabled(value);
+#else
+  (void)value;
+#endif
+}
+
 void MallocExtension::ReleaseMemoryToSystem(size_t num_bytes) {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_ReleaseMemoryToSystem != nullptr) {
@@ -232,6 +302,54 @@ void MallocExtension::ReleaseMemoryToSystem(size_t num_bytes) {
 #endif
 }
 
+MallocExtension::DeadlineReleaseStats
+MallocExtension::ReleaseMemoryToSystemWithDeadline(size_t num_bytes,
+                                                   absl::Duration timeout,
+                                                   bool break_hugepages) {
+  DeadlineReleaseStats result;
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_ReleaseMemoryToSystemWithDeadline != nullptr) {
+    MallocExtension_Internal_ReleaseMemoryToSystemWithDeadline(
+        num_bytes, timeout, break_hugepages, &result);
+  }
+#endif
+  return result;
+}
+
+void MallocExtension::MarkUnreleasable(void* ptr, size_t len) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_MarkUnreleasable != nullptr) {
+    MallocExtension_Internal_MarkUnreleasable(ptr, len, true);
+  }
+#endif
+}
+
+void MallocExtension::MarkReleasable(void* ptr, size_t len) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_MarkUnreleasable != nullptr) {
+    MallocExtension_Internal_MarkUnreleasable(ptr, len, false);
+  }
+#endif
+}
+
+size_t MallocExtension::Prefault(void* ptr, size_t len, int parallelism) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_Prefault != nullptr) {
+    return MallocExtension_Internal_Prefault(ptr, len, parallelism);
+  }
+#endif
+  return 0;
+}
+
+bool MallocExtension::ReserveHeapMetadata(size_t max_heap_bytes) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_ReserveHeapMetadata != nullptr) {
+    return MallocExtension_Internal_ReserveHeapMetadata(max_heap_bytes);
+  }
+#endif
+  return false;
+}
+
 AddressRegionFactory* MallocExtension::GetRegionFactory() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_GetRegionFactory == nullptr) {
@@ -269,6 +387,22 @@ Profile MallocExtension::SnapshotCurrent(tcmalloc::ProfileType type) {
 #endif
 }
 
+Profile MallocExtension::SnapshotHeapProfileSince(uint64_t* generation) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_SnapshotHeapProfileSince == nullptr) {
+    *generation = 0;
+    return Profile();
+  }
+
+  return tcmalloc_internal::ProfileAccessor::MakeProfile(
+      std::unique_ptr<const tcmalloc_internal::ProfileBase>(
+          MallocExtension_Internal_SnapshotHeapProfileSince(generation)));
+#else
+  *generation = 0;
+  return Profile();
+#endif
+}
+
 MallocExtension::AllocationProfilingToken
 MallocExtension::StartAllocationProfiling() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
@@ -299,6 +433,14 @@ MallocExtension::StartLifetimeProfiling() {
 #endif
 }
 
+void MallocExtension::EnableForkSupport() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_EnableForkSupport != nullptr) {
+    MallocExtension_EnableForkSupport();
+  }
+#endif
+}
+
 void MallocExtension::MarkThreadIdle() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_MarkThreadIdle == nullptr) {
@@ -322,6 +464,45 @@ void MallocExtension::MarkThreadBusy() {
 #endif
 }
 
+void MallocExtension::MarkProcessIdle() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_MarkProcessIdle == nullptr) {
+    return;
+  }
+
+  MallocExtension_Internal_MarkProcessIdle();
+#endif
+}
+
+void MallocExtension::Warmup(const WarmupSpec& spec) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_Warmup == nullptr) {
+    return;
+  }
+
+  MallocExtension_Internal_Warmup(&spec);
+#endif
+}
+
+MallocExtension::SelfTestResult MallocExtension::RunSelfTest() {
+  SelfTestResult result;
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_RunSelfTest != nullptr) {
+    MallocExtension_Internal_RunSelfTest(&result);
+  }
+#endif
+  return result;
+}
+
+size_t MallocExtension::ThreadAllocatedBytes() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_GetThreadAllocatedBytes != nullptr) {
+    return MallocExtension_Internal_GetThreadAllocatedBytes();
+  }
+#endif
+  return 0;
+}
+
 size_t MallocExtension::GetMemoryLimit(LimitKind limit_kind) {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_GetMemoryLimit != nullptr) {
@@ -357,6 +538,33 @@ void MallocExtension::SetMemoryLimit(const size_t limit, LimitKind limit_kind) {
 #endif
 }
 
+int MallocExtension::CreateReservePool(size_t bytes) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_CreateReservePool != nullptr) {
+    return MallocExtension_Internal_CreateReservePool(bytes);
+  }
+#endif
+  return -1;
+}
+
+bool MallocExtension::DestroyReservePool(int handle) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_DestroyReservePool != nullptr) {
+    return MallocExtension_Internal_DestroyReservePool(handle);
+  }
+#endif
+  return false;
+}
+
+size_t MallocExtension::AcquireFromReservePool(int handle, size_t bytes) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_AcquireFromReservePool != nullptr) {
+    return MallocExtension_Internal_AcquireFromReservePool(handle, bytes);
+  }
+#endif
+  return 0;
+}
+
 int64_t MallocExtension::GetProfileSamplingRate() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_GetProfileSamplingRate != nullptr) {
@@ -399,6 +607,21 @@ void MallocExtension::SetGuardedSamplingRate(int64_t rate) {
 #endif
 }
 
+void MallocExtension::SetGuardedSamplingWeight(size_t min_size, size_t max_size,
+                                               uint8_t weight) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_SetGuardedSamplingWeight == nullptr) {
+    return;
+  }
+
+  MallocExtension_Internal_SetGuardedSamplingWeight(min_size, max_size, weight);
+#else
+  (void)min_size;
+  (void)max_size;
+  (void)weight;
+#endif
+}
+
 void MallocExtension::ActivateGuardedSampling() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (&MallocExtension_Internal_ActivateGuardedSampling != nullptr) {
@@ -443,6 +666,117 @@ void MallocExtension::SetMaxPerCpuCacheSize(int32_t value) {
 #endif
 }
 
+size_t MallocExtension::GetDynamicSlabResizeTrace(
+    absl::Span<DynamicSlabResizeTraceEntry> entries) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetDynamicSlabResizeTrace == nullptr) {
+    return 0;
+  }
+
+  return MallocExtension_Internal_GetDynamicSlabResizeTrace(entries.data(),
+                                                            entries.size());
+#else
+  (void)entries;
+  return 0;
+#endif
+}
+
+int MallocExtension::GetCacheTopologyShardCount() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetCacheTopologyShardCount == nullptr) {
+    return 0;
+  }
+
+  return MallocExtension_Internal_GetCacheTopologyShardCount();
+#else
+  return 0;
+#endif
+}
+
+int MallocExtension::GetCacheTopologyShardForCpu(int cpu) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetCacheTopologyShardForCpu == nullptr) {
+    return -1;
+  }
+
+  return MallocExtension_Internal_GetCacheTopologyShardForCpu(cpu);
+#else
+  (void)cpu;
+  return -1;
+#endif
+}
+
+size_t MallocExtension::GetCacheTopologyShardBytes(int shard) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetCacheTopologyShardBytes == nullptr) {
+    return 0;
+  }
+
+  return MallocExtension_Internal_GetCacheTopologyShardBytes(shard);
+#else
+  (void)shard;
+  return 0;
+#endif
+}
+
+size_t MallocExtension::GetTopAllocationSites(
+    absl::Span<AllocationSiteStats> sites) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetTopAllocationSites == nullptr) {
+    return 0;
+  }
+
+  return MallocExtension_Internal_GetTopAllocationSites(sites.data(),
+                                                        sites.size());
+#else
+  (void)sites;
+  return 0;
+#endif
+}
+
+bool MallocExtension::ActivatePinnedArena(size_t bytes) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_ActivatePinnedArena == nullptr) {
+    return false;
+  }
+
+  return MallocExtension_Internal_ActivatePinnedArena(bytes);
+#else
+  (void)bytes;
+  return false;
+#endif
+}
+
+MallocExtension::ScopedPinnedAllocation::ScopedPinnedAllocation() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_EnterPinnedScope != nullptr) {
+    MallocExtension_Internal_EnterPinnedScope();
+  }
+#endif
+}
+
+MallocExtension::ScopedPinnedAllocation::~ScopedPinnedAllocation() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_ExitPinnedScope != nullptr) {
+    MallocExtension_Internal_ExitPinnedScope();
+  }
+#endif
+}
+
+size_t MallocExtension::GetThreadCacheOccupancy(absl::Span<uint64_t> buckets) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetThreadCacheOccupancy == nullptr) {
+    return 0;
+  }
+
+  return MallocExtension_Internal_GetThreadCacheOccupancy(buckets.data(),
+                                                          buckets.size());
+#else
+  (void)buckets;
+  return 0;
+#endif
+}
+
 int64_t MallocExtension::GetMaxTotalThreadCacheBytes() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   if (MallocExtension_Internal_GetMaxTotalThreadCacheBytes == nullptr) {
@@ -675,6 +1009,24 @@ MallocExtension::Ownership MallocExtension::GetOwnership(const void* p) {
   return MallocExtension::Ownership::kUnknown;
 }
 
+void MallocExtension::GetOwnershipBatch(absl::Span<const void* const> ptrs,
+                                        absl::Span<PointerInfo> info) {
+  assert(ptrs.size() == info.size());
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (MallocExtension_Internal_GetOwnershipBatch != nullptr) {
+    MallocExtension_Internal_GetOwnershipBatch(ptrs.data(), info.data(),
+                                               ptrs.size());
+    return;
+  }
+#endif
+  // Without the batch entry point, fall back to per-pointer queries.  Size
+  // class and span state are unavailable here.
+  for (size_t i = 0; i < ptrs.size(); ++i) {
+    info[i] = {};
+    info[i].ownership = GetOwnership(ptrs[i]);
+  }
+}
+
 std::map<std::string, MallocExtension::Property>
 MallocExtension::GetProperties() {
   std::map<std::string, MallocExtension::Property> ret;
@@ -725,6 +1077,18 @@ void MallocExtension::ProcessBackgroundActions() {
 #endif
 }
 
+void MallocExtension::ProcessBackgroundActionsForNumaPartition(
+    int numa_partition) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (NeedsProcessBackgroundActions() &&
+      &MallocExtension_Internal_ProcessBackgroundActionsForNumaPartition !=
+          nullptr) {
+    MallocExtension_Internal_ProcessBackgroundActionsForNumaPartition(
+        numa_partition);
+  }
+#endif
+}
+
 bool MallocExtension::NeedsProcessBackgroundActions() {
 #if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
   return &MallocExtension_Internal_ProcessBackgroundActions != nullptr;
@@ -750,6 +1114,26 @@ void MallocExtension::SetBackgroundReleaseRate(BytesPerSecond rate) {
 #endif
 }
 
+bool MallocExtension::SetTuningProfile(absl::string_view name) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_SetTuningProfile != nullptr) {
+    return MallocExtension_Internal_SetTuningProfile(name.data(), name.size());
+  }
+#endif
+  return false;
+}
+
+std::string MallocExtension::GetTuningProfile() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  if (&MallocExtension_Internal_GetTuningProfile != nullptr) {
+    std::string ret;
+    MallocExtension_Internal_GetTuningProfile(&ret);
+    return ret;
+  }
+#endif
+  return "";
+}
+
 }  // namespace tcmalloc
 
 // Default implementation just returns size. The expectation is that
@@ -771,6 +1155,27 @@ ABSL_ATTRIBUTE_WEAK ABSL_ATTRIBUTE_NOINLINE void sdallocx(void* ptr, size_t,
   free(ptr);
 }
 
+// Default implementation allocates each object individually.  The linked-in
+// malloc implementation may override this with a batched fast path.
+ABSL_ATTRIBUTE_WEAK ABSL_ATTRIBUTE_NOINLINE int tcmalloc_bulk_alloc(
+    size_t size, void** out, int n) noexcept {
+  int i = 0;
+  for (; i < n; ++i) {
+    out[i] = malloc(size);
+    if (out[i] == nullptr) break;
+  }
+  return i;
+}
+
+// Default implementation frees each object individually.  The linked-in
+// malloc implementation may override this with a batched fast path.
+ABSL_ATTRIBUTE_WEAK ABSL_ATTRIBUTE_NOINLINE void tcmalloc_bulk_free(
+    void** ptrs, int n) noexcept {
+  for (int i = 0; i < n; ++i) {
+    free(ptrs[i]);
+  }
+}
+
 ABSL_ATTRIBUTE_WEAK ABSL_ATTRIBUTE_NOINLINE tcmalloc::sized_ptr_t
 tcmalloc_size_returning_operator_new(size_t size) {
   return {::operator new(size), size};
@@ -824,3 +1229,11 @@ tcmalloc_size_returning_operator_new_aligned_hot_cold_nothrow(
 }
 
 #endif  // _LIBCPP_VERSION && __cpp_aligned_new
+
+// Default implementation does not know the size class geometry, so it
+// allocates exactly min_size and reports size class 0.
+ABSL_ATTRIBUTE_WEAK ABSL_ATTRIBUTE_NOINLINE tcmalloc::sized_class_ptr_t
+tcmalloc_size_returning_alloc_at_least(size_t min_size) noexcept {
+  void* p = malloc(min_size);
+  return {p, p != nullptr ? min_size : 0, 0};
+}
@@ -103,6 +103,17 @@ enum class ProfileType {
   // Lifetimes of sampled objects that are live during the profiling session.
   kLifetimes,
 
+  // Sampled attribution of per-CPU cache misses to calling contexts.  Sample
+  // counts are extrapolated to estimate total misses per site.
+  kCpuCacheMiss,
+
+  // Like kPeakHeap, but restricted to peaks observed during the trailing
+  // hour (respectively day).  A long-lived process retains several distinct
+  // peaks; these variants expose the recent peak structure rather than the
+  // single largest peak since start-up.
+  kPeakHeapLastHour,
+  kPeakHeapLastDay,
+
   // Only present to prevent switch statements without a default clause so that
   // we can extend this enumeration without breaking code.
   kDoNotUse,
@@ -218,6 +229,15 @@ class Profile final {
     // The start address of the sampled allocation, used to calculate the
     // residency info for the objects represented by this sampled allocation.
     void* span_start_address;
+
+    // NUMA locality of the sampled allocation: the node of the CPU that
+    // performed the allocation, and the node backing span_start_address at
+    // the time the profile was collected.  Comparing the two across samples
+    // from the same allocation site exposes cross-node page placement.
+    // Either may be -1 when unknown, e.g. on kernels without NUMA support or
+    // when the sampled page is not resident.
+    int allocating_numa_node = -1;
+    int backing_numa_node = -1;
   };
 
   void Iterate(absl::FunctionRef<void(const Sample&)> f) const;
@@ -281,6 +301,20 @@ class AddressRegionFactory {
   virtual AddressRegion* Create(void* start_addr, size_t size,
                                 UsageHint hint) = 0;
 
+  // Offers the pages in [start, start + size) back to the factory when
+  // TCMalloc releases them as unused.  start and size are page-aligned and
+  // lie within address space handed out via Create().  This lets a factory
+  // that serves allocations from pooled backing storage -- for example a
+  // memfd pool shared between co-located processes -- reclaim the backing
+  // for other users instead of leaving it idle.
+  //
+  // Returns true if the factory reclaimed the backing itself, in which case
+  // TCMalloc skips its own madvise() on the range.  The range must remain
+  // mapped and usable; subsequent accesses must observe zero-filled pages.
+  // The default implementation returns false, which keeps the regular
+  // madvise()-based release.
+  virtual bool Release(void* start, size_t size);
+
   // Gets a human-readable description of the current state of the allocator.
   //
   // The state is stored in the provided buffer.  The number of bytes used (or
@@ -315,6 +349,111 @@ class MallocExtension final {
   // statistics.
   static std::string GetStats();
 
+  // Gets a human readable dump of the cycle-count latency histograms recorded
+  // on allocator slow paths (per-cpu cache misses, backing cache fills, page
+  // allocations).  Histograms are only populated while latency profiling is
+  // enabled; see SetLatencyProfilingEnabled().
+  static std::string GetLatencyProfile();
+
+  // Latency profiling records slow-path latencies into histograms retrievable
+  // via GetLatencyProfile().  It is off by default; when enabled, the
+  // instrumentation overhead is a cycle-counter read on entry/exit of the
+  // instrumented slow paths, which are already orders of magnitude more
+  // expensive than the fast path.
+  static bool GetLatencyProfilingEnabled();
+  static void SetLatencyProfilingEnabled(bool value);
+
+  // A compact, versioned snapshot of allocator statistics for high-frequency
+  // monitoring.  GetBinaryStats() fills it in a single pass with try-lock
+  // semantics, so scraping costs microseconds and never queues behind
+  // allocator locks the way formatting and parsing GetStats() output does.
+  // Per-size-class data is laid out struct-of-arrays so readers can scan one
+  // metric across all classes without striding.
+  struct BinaryStats {
+    // Incremented whenever the layout of this struct changes.  Readers must
+    // check version before interpreting the rest of the snapshot.
+    static constexpr uint32_t kVersion = 2;
+    // Capacity of the per-size-class arrays below; only the first
+    // num_size_classes entries of each are valid.
+    static constexpr uint32_t kMaxSizeClasses = 512;
+    // Slots in the lock wait-time arrays below: 0 is the page heap lock, 1 is
+    // the central freelists' locks, and 2 is the transfer caches' locks
+    // (sharded and unsharded).
+    static constexpr uint32_t kNumLockIds = 3;
+    // Lock waits are bucketed by log2 duration: lock_wait_hist[l][b] counts
+    // contended acquisitions of lock slot l that spun for [2^(b-1), 2^b)
+    // cycles, with the last bucket absorbing everything longer.
+    static constexpr uint32_t kNumLockWaitBuckets = 28;
+
+    uint32_t version;      // kVersion of the writer.
+    uint32_t struct_size;  // sizeof(BinaryStats) as compiled into the writer.
+
+    // Heap-wide byte counts, matching the fields of the same name in the
+    // human-readable GetStats() output.
+    uint64_t in_use_by_app_bytes;
+    uint64_t page_heap_free_bytes;
+    uint64_t page_heap_unmapped_bytes;
+    uint64_t central_cache_freelist_bytes;
+    uint64_t per_cpu_cache_freelist_bytes;
+    uint64_t sharded_transfer_cache_freelist_bytes;
+    uint64_t transfer_cache_freelist_bytes;
+    uint64_t thread_cache_freelist_bytes;
+    uint64_t metadata_bytes;
+    uint64_t physical_memory_used_bytes;
+    uint64_t virtual_memory_used_bytes;
+
+    // Aggregate per-cpu cache miss counts (zero when per-cpu caches are
+    // inactive).
+    uint64_t cpu_cache_underflows;
+    uint64_t cpu_cache_overflows;
+
+    // Wait-time telemetry for the allocator's internal spinlocks, indexed by
+    // the lock slots described at kNumLockIds.  Counts cover contended
+    // acquisitions only; uncontended acquisitions are not instrumented.
+    uint64_t lock_wait_count[kNumLockIds];
+    uint64_t lock_wait_cycles[kNumLockIds];
+    uint64_t lock_wait_hist[kNumLockIds][kNumLockWaitBuckets];
+
+    // Number of valid entries in the per-size-class arrays.
+    uint64_t num_size_classes;
+
+    uint32_t class_object_size[kMaxSizeClasses];
+    uint64_t class_spans_requested[kMaxSizeClasses];
+    uint64_t class_spans_returned[kMaxSizeClasses];
+    uint64_t class_transfer_insert_hits[kMaxSizeClasses];
+    uint64_t class_transfer_insert_misses[kMaxSizeClasses];
+    uint64_t class_transfer_remove_hits[kMaxSizeClasses];
+    uint64_t class_transfer_remove_misses[kMaxSizeClasses];
+  };
+
+  // Fills buffer with a BinaryStats snapshot and returns the number of bytes
+  // written (sizeof(BinaryStats)).  Returns 0 without blocking if
+  // buffer_length is less than sizeof(BinaryStats), if the allocator's lock
+  // is contended, or if the malloc implementation does not support binary
+  // stats; callers scraping periodically should simply retry on the next
+  // interval.
+  static size_t GetBinaryStats(void* buffer, size_t buffer_length);
+
+  // Preserves the hugepage caches' learned sizing state across a process
+  // restart.  GetHugeCacheState() serializes the sizing conclusions each
+  // cache has drawn from its demand history (its size target and recent
+  // usage extrema) into buffer as versioned text; the number of bytes used
+  // (or required, had the buffer been of sufficient size) is returned, or 0
+  // when the malloc implementation does not maintain hugepage caches.  A
+  // process shutting down for a planned restart writes the snapshot to a
+  // file; the restarted process reads it back and passes it to
+  // SetHugeCacheState(), so its caches are sized for the previous process's
+  // demand immediately instead of re-faulting the working set while the
+  // sizing is re-learned.
+  //
+  // SetHugeCacheState() returns true if the snapshot was recognized.
+  // Snapshots only ever raise cache size targets, are validated against the
+  // demand recorded alongside them, and are rejected wholesale on version or
+  // format mismatch, so a stale or truncated file degrades to a normal cold
+  // start.
+  static size_t GetHugeCacheState(absl::Span<char> buffer);
+  static bool SetHugeCacheState(absl::string_view state);
+
   // -------------------------------------------------------------------
   // Control operations for getting malloc implementation specific parameters.
   // Some currently useful properties:
@@ -357,6 +496,13 @@ class MallocExtension final {
   //
   //  "tcmalloc.per_cpu_caches_active"
   //      Whether tcmalloc is using per-CPU caches (1 or 0 respectively).
+  //
+  //  "tcmalloc.percpu_active"
+  //      Whether per-CPU caches are active and rseq is usable from the
+  //      calling thread (1 or 0 respectively).  Unlike
+  //      "tcmalloc.per_cpu_caches_active", which reports the configuration,
+  //      this probes the kernel; the two disagree when rseq registration is
+  //      rejected (old kernel, seccomp policy).
   // -------------------------------------------------------------------
 
   // Gets the named property's value or a nullopt if the property is not valid.
@@ -377,6 +523,81 @@ class MallocExtension final {
   // not called, performance may suffer.
   static void MarkThreadBusy();
 
+  // Marks the whole process as "idle".  Where MarkThreadIdle() drains one
+  // thread cache, this drains every cache tier back to the page heap -- the
+  // caller's thread cache, all per-CPU caches, and the transfer caches -- and
+  // then releases all free memory the page heap holds, returning the process
+  // to near-minimal RSS.  Intended for processes demoted to a standby role;
+  // it is far more expensive than MarkThreadIdle() and the caches refill
+  // lazily, so expect a transient slowdown when the process becomes busy
+  // again.
+  static void MarkProcessIdle();
+
+  // Describes a warmup workload for Warmup().  A useful spec mirrors the
+  // steady-state working set of a warmed-up process: per-size object counts
+  // can be recorded from such a process via the per-size-class entries in
+  // GetStats().
+  struct WarmupSpec {
+    struct SizeCount {
+      // Allocation size in bytes.
+      size_t size = 0;
+      // Number of objects of this size to cycle through the caches.
+      size_t count = 0;
+    };
+    // Per-size object counts.  The referenced array must outlive the call to
+    // Warmup().
+    absl::Span<const SizeCount> allocations;
+    // Bytes of backed memory to leave primed in the page-level caches for
+    // large allocations, beyond what <allocations> touches.
+    size_t backed_bytes = 0;
+  };
+
+  // Pre-populates the allocator's caches with the given workload so the
+  // first seconds of real traffic do not pay for faulting and cache fills.
+  // Allocates, touches, and frees the specified objects on the calling
+  // thread: the allocations fault in span and per-CPU slab memory, and the
+  // frees leave the caches feeding the calling thread's CPU populated.
+  // Call once per relevant CPU (under affinity) to warm more of the fleet.
+  // No-op for malloc implementations that do not support warmup.
+  static void Warmup(const WarmupSpec& spec);
+
+  // Measured per-operation costs, in CPU cycles, of canonical allocator
+  // patterns; filled in by RunSelfTest().  A zero means the pattern did not
+  // run (e.g. no self-test support).
+  struct SelfTestResult {
+    // Allocating and immediately freeing one small object, the per-CPU
+    // cache fast path.
+    double fast_path_cycles = 0;
+    // Freeing small objects that another thread allocated.
+    double cross_thread_free_cycles = 0;
+    // Allocating and freeing a batch of one size class large enough to
+    // force batch moves through the transfer cache.
+    double transfer_cache_cycles = 0;
+  };
+
+  // Runs a short (~50ms) allocator microbenchmark on the calling thread and
+  // reports per-operation cycle costs, so a fleet canary can compare
+  // allocator health numerically across releases and kernels.  Each pattern
+  // takes the fastest of several rounds to reject interference; for stable
+  // numbers, pin the calling thread to an otherwise idle CPU.  The run
+  // perturbs the caches it exercises.  Returns a default-constructed result
+  // for malloc implementations without self-test support.
+  static SelfTestResult RunSelfTest();
+
+  // Returns the total number of bytes the calling thread has requested from
+  // malloc since it started.  The counter is thread-local and updated without
+  // atomic operations, so this is cheap enough to read per allocation.
+  // Returns 0 for malloc implementations that do not track per-thread
+  // allocation totals.
+  static size_t ThreadAllocatedBytes();
+
+  // Enables fork support: installs pthread_atfork handlers that acquire the
+  // allocator's internal locks before fork() and release them in the parent
+  // and child afterwards, so a child forked while another thread allocates
+  // can safely use the heap.  Safe to call multiple times; no-op for malloc
+  // implementations without fork support.
+  static void EnableForkSupport();
+
   // Attempts to free any resources associated with cpu <cpu> (in the sense of
   // only being usable from that CPU.)  Returns the number of bytes previously
   // assigned to "cpu" that were freed.  Safe to call from any processor, not
@@ -418,6 +639,62 @@ class MallocExtension final {
   //   back in.
   static void ReleaseMemoryToSystem(size_t num_bytes);
 
+  // Breakdown of the memory released by ReleaseMemoryToSystemWithDeadline.
+  struct DeadlineReleaseStats {
+    // Bytes released from each tier: cold-hinted allocations, the normal
+    // heaps, and the sampled heap, plus free bytes that were reachable only
+    // by breaking up intact hugepages.
+    size_t cold_bytes = 0;
+    size_t normal_bytes = 0;
+    size_t sampled_bytes = 0;
+    size_t broken_hugepage_bytes = 0;
+    // True if the deadline passed before the byte target was met.
+    bool deadline_exceeded = false;
+  };
+
+  // Like ReleaseMemoryToSystem, but bounded by a deadline and with a
+  // structured result.  Attempts to release num_bytes of free memory within
+  // timeout, draining the coldest tiers first; free memory on intact
+  // hugepages is broken up only when break_hugepages is set and the target
+  // cannot otherwise be met.  The deadline is checked between bounded chunks
+  // of work, so it may be overshot by one chunk.  The total released may
+  // exceed num_bytes since release happens at span granularity.
+  static DeadlineReleaseStats ReleaseMemoryToSystemWithDeadline(
+      size_t num_bytes, absl::Duration timeout, bool break_hugepages);
+
+  // Exempts [ptr, ptr + len) from release to the OS: release passes
+  // (background and explicit) skip hugepages overlapping the range instead
+  // of madvising away their free tails.  Intended for memory pinned with
+  // the kernel -- RDMA memory regions, io_uring fixed buffers -- where the
+  // madvise fails or breaks the mapping the pin depends on, so repeated
+  // release attempts waste syscalls at best.  The exemption is keyed on the
+  // address range, not the allocation: call MarkReleasable with the same
+  // range before deregistering and freeing the memory.
+  static void MarkUnreleasable(void* ptr, size_t len);
+
+  // Reverses a MarkUnreleasable of the same range.
+  static void MarkReleasable(void* ptr, size_t len);
+
+  // Eagerly populates the pages backing [ptr, ptr + len), so a caller that
+  // allocated a large buffer and will write it sequentially does not
+  // serialize on one minor fault per page.  Chunks of the range that are
+  // already resident are skipped.  parallelism is a hint for how many
+  // threads (the calling one included) to spread the faulting over; values
+  // outside a small internal bound are clamped.  Returns the number of
+  // bytes whose population was attempted, i.e. len minus the skipped
+  // already-resident chunks, or 0 if the underlying implementation does not
+  // support prefaulting.
+  static size_t Prefault(void* ptr, size_t len, int parallelism = 1);
+
+  // Pre-reserves the internal metadata (pagemap radix nodes, span objects,
+  // etc.) needed to manage a heap of up to max_heap_bytes, so that later
+  // metadata growth while the heap warms up is a pointer bump rather than a
+  // system allocation under internal locks.  The reservation is advisory: the
+  // heap may still grow past max_heap_bytes, with metadata then allocated on
+  // demand as usual.  Returns false if the underlying implementation does not
+  // support reservation or the system memory could not be obtained.
+  static bool ReserveHeapMetadata(size_t max_heap_bytes);
+
   enum class LimitKind { kSoft, kHard };
 
   // Make a best effort attempt to prevent more than limit bytes of memory
@@ -460,6 +737,26 @@ class MallocExtension final {
   // Deprecated compatibility shim.
   ABSL_DEPRECATED("Use LimitKind version") static MemoryLimit GetMemoryLimit();
 
+  // Reserve pools pre-carve headroom out of the soft memory limit for
+  // critical subsystems, so that an incident which drives the process to its
+  // limit degrades ordinary traffic without also starving them.
+  //
+  // CreateReservePool(bytes) removes bytes from the headroom available to
+  // ordinary allocations: the allocator sheds memory down to
+  // (soft limit - unused reserves).  When the process is at limit, the owning
+  // subsystem calls AcquireFromReservePool before allocating; the grant
+  // returns that much headroom to the global limit, covering the allocation.
+  // Reserves are limit accounting, not physically segregated memory, and are
+  // inert while no soft limit is set.
+  //
+  // CreateReservePool returns a handle for the other calls, or -1 if no pool
+  // could be created.  AcquireFromReservePool returns the number of bytes
+  // granted, which is less than requested once the pool runs dry.
+  // DestroyReservePool returns any unused reserve to the global headroom.
+  static int CreateReservePool(size_t bytes);
+  static bool DestroyReservePool(int handle);
+  static size_t AcquireFromReservePool(int handle, size_t bytes);
+
   // Gets the sampling rate.  Returns a value < 0 if unknown.
   static int64_t GetProfileSamplingRate();
   // Sets the sampling rate for heap profiles.  TCMalloc samples approximately
@@ -477,6 +774,16 @@ class MallocExtension final {
   // ActivateGuardedSampling).
   static void SetGuardedSamplingRate(int64_t rate);
 
+  // Sets the relative guarded-sampling weight of the size classes whose
+  // object size falls within [min_size, max_size] bytes.  Every class starts
+  // at weight 1; a class with weight w is selected for guarding w times as
+  // readily as an unweighted one, and weight 0 exempts it from guarding
+  // entirely.  Raising the weight of classes where overflow bugs cluster
+  // concentrates the fixed guarded-page budget on them without changing the
+  // overall guarding rate.
+  static void SetGuardedSamplingWeight(size_t min_size, size_t max_size,
+                                       uint8_t weight);
+
   // Switches TCMalloc to guard sampled allocations for underflow, overflow, and
   // use-after-free according to the guarded sample parameter value.
   static void ActivateGuardedSampling();
@@ -489,6 +796,100 @@ class MallocExtension final {
   // Sets the maximum cache size per CPU cache.  This is a per-core limit.
   static void SetMaxPerCpuCacheSize(int32_t value);
 
+  // One executed per-CPU slab resize, as recorded by the allocator.
+  struct DynamicSlabResizeTraceEntry {
+    // True if the resize grew the slabs, false if it shrank them.
+    bool grow = false;
+    // Per-CPU slab shift after the resize took effect.
+    uint8_t per_cpu_shift = 0;
+    // Cache misses observed during the slab-resize interval that triggered
+    // the resize.
+    size_t underflows = 0;
+    size_t overflows = 0;
+    // Cumulative bytes of old slab memory that madvise failed to release, as
+    // of the end of the resize.
+    size_t madvise_failed_bytes = 0;
+  };
+
+  // Copies the most recent per-CPU slab resizes into entries, oldest first,
+  // and returns the number of entries written.  Returns 0 if the underlying
+  // allocator does not record a resize trace or per-CPU caches are inactive.
+  static size_t GetDynamicSlabResizeTrace(
+      absl::Span<DynamicSlabResizeTraceEntry> entries);
+
+  // Cache-topology surface for embedders that co-schedule threads with the
+  // allocator's sharding.  The sharded transfer cache groups cpus by the L3
+  // cache they share; a thread pool that places cooperating handlers within
+  // one shard -- or spreads independent work across shards -- shares
+  // allocator state instead of fighting it.
+
+  // Returns the number of L3-based shards, or 0 when the topology is unknown
+  // (e.g. the allocator is not TCMalloc).
+  static int GetCacheTopologyShardCount();
+
+  // Returns the shard serving <cpu>, or -1 if cpu is out of range or the
+  // topology is unknown.
+  static int GetCacheTopologyShardForCpu(int cpu);
+
+  // Returns the bytes the sharded transfer cache currently holds for <shard>,
+  // a proxy for the shard's allocator load.  Returns 0 for unknown shards and
+  // when the sharded transfer cache is inactive.
+  static size_t GetCacheTopologyShardBytes(int shard);
+
+  // A top allocation site, extrapolated from sampled allocations.  The hash
+  // identifies the allocating stack; processes report it alongside a full
+  // profile once so dashboards can symbolize the hot sites, then poll just
+  // these stats at high frequency.
+  struct AllocationSiteStats {
+    uint64_t site_hash = 0;
+    uint64_t live_bytes = 0;
+    uint64_t count = 0;
+  };
+
+  // Copies the heaviest allocation sites by extrapolated live bytes into
+  // sites, heaviest first, and returns the number written.  The ranking is
+  // maintained in constant memory on the allocation sampling path, so a poll
+  // costs a few hundred bytes rather than a full heap profile.  Returns 0 if
+  // the underlying allocator does not maintain the ranking.
+  static size_t GetTopAllocationSites(absl::Span<AllocationSiteStats> sites);
+
+  // Activates the pinned arena: an mlocked, pre-faulted region of `bytes`
+  // (rounded up to whole pages) backing allocations made inside a
+  // ScopedPinnedAllocation, so those allocations cannot take a page fault.
+  // One-shot; once active the region is not resized.  Returns false when the
+  // region cannot be locked (typically RLIMIT_MEMLOCK) or the underlying
+  // allocator does not support pinning.
+  static bool ActivatePinnedArena(size_t bytes);
+
+  // While an instance is live on the calling thread, allocations are served
+  // from the arena activated by ActivatePinnedArena() and are guaranteed not
+  // to fault.  Requests that do not fit fall back to normal memory and bump
+  // the "tcmalloc.pinned_arena_overflows" property -- the latency guarantee
+  // is missed rather than blocking.  Scopes nest; a no-op when the arena is
+  // inactive or the allocator is not TCMalloc.
+  class ScopedPinnedAllocation {
+   public:
+    ScopedPinnedAllocation();
+    ~ScopedPinnedAllocation();
+
+    ScopedPinnedAllocation(const ScopedPinnedAllocation&) = delete;
+    ScopedPinnedAllocation& operator=(const ScopedPinnedAllocation&) = delete;
+  };
+
+  // Number of buckets reported by GetThreadCacheOccupancy: one per decile of
+  // a cache's fill ratio plus a final bucket for caches at or over their
+  // limit.
+  static constexpr size_t kThreadCacheOccupancyBuckets = 11;
+
+  // Fills buckets with a histogram of live per-thread caches by occupancy,
+  // the ratio of cached bytes to the cache's capacity limit.  Bucket i counts
+  // caches with occupancy in [i * 10%, (i + 1) * 10%); the last bucket counts
+  // caches at or over their limit.  Returns the number of buckets written, at
+  // most kThreadCacheOccupancyBuckets, or 0 when the allocator is not
+  // TCMalloc.  Only populated in per-thread mode; with per-cpu caches active
+  // the histogram is empty.
+  static size_t GetThreadCacheOccupancy(absl::Span<uint64_t> buckets);
+
   // Gets the current maximum thread cache.
   static int64_t GetMaxTotalThreadCacheBytes();
   // Sets the maximum thread cache size.  This is a whole-process limit.
@@ -549,6 +950,29 @@ class MallocExtension final {
   enum class Ownership { kUnknown = 0, kOwned, kNotOwned };
   static Ownership GetOwnership(const void* p);
 
+  // Result of a single GetOwnershipBatch() query.  size_class is the tcmalloc
+  // size class index for small objects (0 for large objects and pointers
+  // tcmalloc does not own); sampled/cold report whether the pointer falls in
+  // the sampled or cold region of the heap.
+  struct PointerInfo {
+    Ownership ownership = Ownership::kUnknown;
+    size_t size_class = 0;
+    bool sampled = false;
+    bool cold = false;
+  };
+
+  // Classifies each pointer in ptrs, writing the result to the corresponding
+  // entry of info.  Unlike GetOwnership(), interior pointers are acceptable:
+  // a pointer anywhere inside an allocated object reports kOwned.  The
+  // pointers are looked up in sorted order so that neighbors sharing a
+  // pagemap leaf amortize the radix walk, making this much cheaper than
+  // per-pointer GetOwnership() calls for large batches (e.g. when classifying
+  // pointers found by a conservative scan).
+  //
+  // REQUIRES: ptrs.size() == info.size().
+  static void GetOwnershipBatch(absl::Span<const void* const> ptrs,
+                                absl::Span<PointerInfo> info);
+
   // Type used by GetProperties.  See comment on GetProperties.
   struct Property {
     size_t value;
@@ -572,10 +996,36 @@ class MallocExtension final {
   //  tcmalloc.metadata_bytes      -- Used by internal data structures
   //  tcmalloc.thread_cache_count  -- Number of thread caches in use
   //  tcmalloc.experiment.NAME     -- Experiment NAME is running if 1
+  //  tcmalloc.residency.OWNER.virtual_bytes
+  //  tcmalloc.residency.OWNER.resident_bytes
+  //  tcmalloc.residency.OWNER.swapped_bytes
+  //  tcmalloc.residency.OWNER.hugepage_backed_bytes
+  //    -- Kernel-measured residency of allocator component OWNER (one of
+  //       pagemap_root, percpu_slab, guarded_page_pool, huge_cache,
+  //       huge_region), read from /proc/self/pagemap and
+  //       /proc/self/pageflags.  hugepage_backed_bytes is zero on kernels
+  //       without pageflags support.
   static std::map<std::string, Property> GetProperties();
 
   static Profile SnapshotCurrent(tcmalloc::ProfileType type);
 
+  // Like SnapshotCurrent(ProfileType::kHeap), but incremental, so that
+  // continuous profiling cost scales with allocation churn rather than with
+  // the number of live samples.
+  //
+  // On entry, `*generation` is the token returned by a previous call, or 0 to
+  // request a full profile.  The returned profile contains one entry per
+  // sample recorded since that generation; samples freed since then are
+  // reported with negative count and sum, cancelling the matching entry from
+  // an earlier profile.  On return, `*generation` holds the token to pass to
+  // the next call.
+  //
+  // Freed samples are retained on a best-effort basis.  If too much history
+  // has been recycled to honor `*generation`, the returned profile is empty
+  // and `*generation` is reset to 0; the caller should start over with a full
+  // profile.
+  static Profile SnapshotHeapProfileSince(uint64_t* generation);
+
   // AllocationProfilingToken tracks an active profiling session started with
   // StartAllocationProfiling.  Profiling continues until Stop() is called.
   class AllocationProfilingToken {
@@ -621,6 +1071,19 @@ class MallocExtension final {
   // When linked against TCMalloc, this method does not return.
   static void ProcessBackgroundActions();
 
+  // Like ProcessBackgroundActions, but scoped to one NUMA partition of a
+  // crew: an application may run one thread per active NUMA partition,
+  // passing partitions 0, 1, ..., instead of one ProcessBackgroundActions
+  // thread.  Each worker maintains only its partition's per-CPU caches and
+  // releases its share of the background release rate, keeping the
+  // housekeeping cacheline traffic node-local and parallelizing releases;
+  // the partition-0 worker additionally carries the global housekeeping
+  // duties.  Threads should be affined to their partition's CPUs by the
+  // caller for full benefit.  Do not mix with ProcessBackgroundActions.
+  //
+  // When linked against TCMalloc, this method does not return.
+  static void ProcessBackgroundActionsForNumaPartition(int numa_partition);
+
   // Return true if ProcessBackgroundActions should be called on this platform.
   // Not all platforms need/support background actions. As of 2021 this
   // includes Apple and Emscripten.
@@ -631,12 +1094,32 @@ class MallocExtension final {
   // The enum is used to provide strong-typing for the value.
   enum class BytesPerSecond : size_t {};
 
+  // When passed to SetBackgroundReleaseRate, selects an adaptive release
+  // policy: instead of releasing at a fixed rate, ProcessBackgroundActions
+  // modulates the amount released each interval based on the page heap's
+  // recent demand history, retaining enough free-but-backed memory to absorb
+  // a return to the recent demand peak.
+  static constexpr BytesPerSecond kAdaptiveBackgroundReleaseRate =
+      static_cast<BytesPerSecond>(std::numeric_limits<size_t>::max());
+
   // Gets the current release rate (in bytes per second) from the page heap.
   // Zero inhibits the release path.
   static BytesPerSecond GetBackgroundReleaseRate();
   // Specifies the release rate from the page heap.  ProcessBackgroundActions
   // must be called for this to be operative.
   static void SetBackgroundReleaseRate(BytesPerSecond rate);
+
+  // Applies the named tuning profile: a reviewed, internally consistent
+  // bundle of parameter values (release rate, cache limits, transfer cache
+  // tuning) switched as a unit, in place of flipping individual knobs.
+  // Known profiles are "default", "latency", "footprint", and "throughput".
+  // Re-applying the active profile is a no-op.  Returns false if name is not
+  // a known profile.
+  static bool SetTuningProfile(absl::string_view name);
+
+  // Returns the name of the most recently applied tuning profile, or the
+  // empty string if none has been applied.
+  static std::string GetTuningProfile();
 };
 
 }  // namespace tcmalloc
@@ -659,6 +1142,26 @@ extern "C" size_t nallocx(size_t size, int flags) noexcept;
 // uses the size to improve deallocation performance.
 extern "C" void sdallocx(void* ptr, size_t size, int flags) noexcept;
 
+// Allocates up to <n> objects, each of <size> bytes, storing the resulting
+// pointers into out[0..n).  Returns the number of objects allocated, which may
+// be less than <n> under memory pressure.  Each returned pointer must be freed
+// individually with free() or ::operator delete.
+//
+// TCMalloc overrides the default weak implementation to pop the whole batch
+// from the per-CPU cache in a single restartable sequence and to refill the
+// cache at most once for the batch, which substantially reduces the
+// per-object cost for callers that allocate many same-sized objects at once.
+extern "C" int tcmalloc_bulk_alloc(size_t size, void** out, int n) noexcept;
+
+// Frees the <n> objects in ptrs[0..n).  Equivalent to calling free() on each
+// pointer (null entries are permitted and skipped).
+//
+// TCMalloc overrides the default weak implementation to classify each pointer
+// with a single pass over the pagemap and to return each run of same-sized
+// objects to the per-CPU cache with one restartable sequence commit, rather
+// than paying the full deallocation path per pointer.
+extern "C" void tcmalloc_bulk_free(void** ptrs, int n) noexcept;
+
 namespace tcmalloc {
 
 // sized_ptr_t constains pointer / capacity information as returned
@@ -670,6 +1173,16 @@ struct sized_ptr_t {
   size_t n;
 };
 
+// sized_class_ptr_t extends sized_ptr_t with the size class chosen for the
+// allocation, as returned by `tcmalloc_size_returning_alloc_at_least()`.
+// A size_class of 0 means the allocation has no small size class (it was
+// served at page granularity, or by a non-tcmalloc fallback).
+struct sized_class_ptr_t {
+  void* p;
+  size_t n;
+  size_t size_class;
+};
+
 }  // namespace tcmalloc
 
 // Allocates memory of at least the requested size.
@@ -728,6 +1241,26 @@ tcmalloc_size_returning_operator_new_aligned_hot_cold_nothrow(
 
 }  // extern "C"
 
+// Allocates at least min_size bytes and returns the pointer, the capacity,
+// and the size class that served the request.  Unlike
+// `tcmalloc_size_returning_operator_new`, the chosen size class may be
+// rounded up past the smallest fitting class: while the next class's
+// capacity stays within 25% of min_size, the larger class is used instead.
+// Containers that grow geometrically and re-reserve from the returned
+// capacity therefore step through class-aligned capacities with no slack
+// between the requested and usable size.
+//
+// The returned memory is an ordinary malloc allocation: it may be released
+// with free() or sized delete using the returned capacity.  When size_class
+// is nonzero it may be cached and passed to
+// `MallocExtension_Internal_FreeOfSizeClass` (see SizeClassAllocator) to
+// skip the size-to-class lookup on the free path.
+//
+// The default weak implementation allocates with malloc() and reports a
+// capacity of min_size and a size class of 0.
+extern "C" tcmalloc::sized_class_ptr_t tcmalloc_size_returning_alloc_at_least(
+    size_t min_size) noexcept;
+
 #ifndef MALLOCX_LG_ALIGN
 #define MALLOCX_LG_ALIGN(la) (la)
 #endif
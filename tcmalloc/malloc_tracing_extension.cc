@@ -19,9 +19,15 @@
 
 #include "tcmalloc/malloc_tracing_extension.h"
 
+#include <errno.h>
+
+#include <string>
+
 #include "absl/base/attributes.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tcmalloc/internal_malloc_tracing_extension.h"
 
 namespace tcmalloc {
@@ -37,5 +43,113 @@ absl::StatusOr<AllocatedAddressRanges> GetAllocatedAddressRanges() {
       "malloc_tracing_extension routines not exported by the current malloc.");
 }
 
+absl::Status ClassifyAddresses(const uintptr_t* addresses, size_t count,
+                               AddressOwnership* results) {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_ClassifyAddresses != nullptr) {
+    MallocTracingExtension_Internal_ClassifyAddresses(addresses, count,
+                                                      results);
+    return absl::OkStatus();
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::StatusOr<AllocationSiteTable> GetAllocationSiteStats() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_GetAllocationSiteStats != nullptr) {
+    return MallocTracingExtension_Internal_GetAllocationSiteStats();
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::StatusOr<GrowthLedger> GetGrowthLedger() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_GetGrowthLedger != nullptr) {
+    return MallocTracingExtension_Internal_GetGrowthLedger();
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+namespace {
+
+absl::Status StatusFromErrno(int err, absl::string_view op) {
+  switch (err) {
+    case 0:
+      return absl::OkStatus();
+    case EINVAL:
+      return absl::InvalidArgumentError(op);
+    case EBUSY:
+      return absl::FailedPreconditionError(op);
+    default:
+      return absl::InternalError(absl::StrCat(op, " failed: errno ", err));
+  }
+}
+
+}  // namespace
+
+absl::Status StartAllocationTrace(const char* path, int sample_interval) {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_StartAllocationTrace != nullptr) {
+    return StatusFromErrno(
+        MallocTracingExtension_Internal_StartAllocationTrace(path,
+                                                             sample_interval),
+        "StartAllocationTrace");
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::Status DrainAllocationTrace() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_DrainAllocationTrace != nullptr) {
+    MallocTracingExtension_Internal_DrainAllocationTrace();
+    return absl::OkStatus();
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::Status StopAllocationTrace() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_StopAllocationTrace != nullptr) {
+    return StatusFromErrno(
+        MallocTracingExtension_Internal_StopAllocationTrace(),
+        "StopAllocationTrace");
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::StatusOr<std::string> GetHeapLayoutSnapshot() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_GetHeapLayoutSnapshot != nullptr) {
+    return MallocTracingExtension_Internal_GetHeapLayoutSnapshot();
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
+absl::StatusOr<AllocationTraceStats> GetAllocationTraceStats() {
+#if ABSL_HAVE_ATTRIBUTE_WEAK && !defined(__APPLE__) && !defined(__EMSCRIPTEN__)
+  if (&MallocTracingExtension_Internal_GetAllocationTraceStats != nullptr) {
+    AllocationTraceStats stats = {};
+    MallocTracingExtension_Internal_GetAllocationTraceStats(&stats);
+    return stats;
+  }
+#endif
+  return absl::UnimplementedError(
+      "malloc_tracing_extension routines not exported by the current malloc.");
+}
+
 }  // namespace malloc_tracing_extension
 }  // namespace tcmalloc
@@ -22,6 +22,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "absl/status/statusor.h"
@@ -48,6 +49,119 @@ struct AllocatedAddressRanges {
 // Returns the address ranges currently allocated by TCMalloc.
 absl::StatusOr<AllocatedAddressRanges> GetAllocatedAddressRanges();
 
+// Type used by ClassifyAddresses.  Describes what, if anything, TCMalloc
+// knows about one address.  The ids are opaque identities -- stable for the
+// lifetime of the owning object, equal for addresses with the same owner --
+// and must never be dereferenced: the owner may be freed concurrently.
+struct AddressOwnership {
+  // Identity of the hugepage filler tracker managing the address's
+  // hugepage, or 0 if the hugepage is not filler-managed (regions, the
+  // hugepage cache, direct mappings) or the address is not managed by
+  // TCMalloc at all.
+  uintptr_t tracker_id;
+  // Identity of the Span covering the address, or 0 if none.
+  uintptr_t span_id;
+  // Size-class bytes for small objects on the address's page, as in
+  // AllocatedAddressRanges::SpanDetails; 0 for large-object or unmanaged
+  // pages.
+  size_t object_size;
+};
+
+// Classifies addresses[0..count), writing one AddressOwnership per input.
+// Reads the pagemap lock-free and never dereferences what it reports, so
+// arbitrary -- even wild -- addresses are safe and the allocator is not
+// perturbed; a live-debugging agent can classify millions of addresses per
+// second with this.  Each entry is an independent snapshot; ownership can
+// change concurrently.
+absl::Status ClassifyAddresses(const uintptr_t* addresses, size_t count,
+                               AddressOwnership* results);
+
+// One entry of GetAllocationSiteStats: live usage attributed to a single
+// allocation site.
+struct AllocationSiteStats {
+  // Hash of the site's program-counter vector (the same hasher
+  // StackTraceFilter uses).  Stable for the lifetime of the process, so two
+  // snapshots taken from one process diff numerically -- only sites whose
+  // deltas matter need symbolizing.  The hash is seeded per process, so ids
+  // do not compare across processes.
+  uint64_t site_id;
+  // Live bytes and objects attributed to the site, scaled from the sampled
+  // allocations by sampling weight; the same estimate heap profiles report.
+  size_t live_bytes;
+  size_t live_objects;
+};
+// Result type of GetAllocationSiteStats.  Entries are sorted by site_id.
+struct AllocationSiteTable {
+  std::vector<AllocationSiteStats> sites;
+};
+// Returns the live (site-id -> bytes/objects) table aggregated over the
+// currently sampled allocations.  Purely numeric -- no stack storage or
+// symbolization -- so a snapshot costs microseconds and two snapshots can
+// be diffed by id.
+absl::StatusOr<AllocationSiteTable> GetAllocationSiteStats();
+
+// One mapping-growth event: an address range TCMalloc obtained from the OS.
+struct GrowthEvent {
+  // Unix nanoseconds when the range was handed out.
+  int64_t timestamp_ns;
+  uintptr_t start_addr;
+  size_t bytes;
+  // Label of the range's memory tag ("NORMAL", "COLD", "METADATA", ...), as
+  // printed in stats.
+  std::string tag;
+  // Short label of the subsystem whose request created the mapping.
+  std::string owner;
+  // Program counters of the allocation that forced the mapping.
+  std::vector<uintptr_t> stack;
+};
+// Result of GetGrowthLedger: the most recent growth events, oldest first.
+struct GrowthLedger {
+  std::vector<GrowthEvent> events;
+  // Growth events since start-up.  If the delta between two snapshots
+  // exceeds the number of events returned, the ring wrapped in between.
+  uint64_t total_events;
+};
+// Returns the ledger of recent mapping growth, so "what mapped the last N
+// regions" is answerable at incident time without a heap-profile diff.
+absl::StatusOr<GrowthLedger> GetGrowthLedger();
+
+// Counters for the current (or last) allocation trace session.
+struct AllocationTraceStats {
+  uint64_t events_recorded;
+  // Events lost because a ring was full or contended, or the reader lagged.
+  uint64_t events_dropped;
+  // Bytes drained to the trace file so far.
+  uint64_t bytes_written;
+};
+
+// Starts capturing a temporal allocation trace to the file at path.  While
+// active, one in sample_interval alloc/free events (>= 1) is recorded --
+// address, size, size class, and timestamp delta, varint-packed -- into
+// per-CPU rings that DrainAllocationTrace flushes to a memory-mapped file.
+// Producers never block; events are dropped (and counted) if the consumer
+// lags.  Returns FailedPrecondition if a session is already active.
+absl::Status StartAllocationTrace(const char* path, int sample_interval);
+
+// Flushes buffered events to the trace file.  Call periodically from a
+// dedicated reader thread; the allocator's background thread also drains
+// opportunistically.
+absl::Status DrainAllocationTrace();
+
+// Stops the active trace session, flushing and closing the file.
+absl::Status StopAllocationTrace();
+
+absl::StatusOr<AllocationTraceStats> GetAllocationTraceStats();
+
+// Returns a versioned binary snapshot of the heap's hugepage-level layout:
+// one record per filler-managed hugepage carrying its tracker flags and
+// allocated/free/released page runs, one per huge region with its occupancy,
+// and one per address range held idle in the huge cache.  The format is
+// described alongside the converter, tools/heap_layout_viz.py, which renders
+// snapshots as treemap/heatmap visualizations.  Each hugepage record is
+// consistent (copied under the page heap lock), but the walk as a whole is
+// not atomic: concurrent allocation can move memory between records.
+absl::StatusOr<std::string> GetHeapLayoutSnapshot();
+
 }  // namespace malloc_tracing_extension
 }  // namespace tcmalloc
 
@@ -0,0 +1,183 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/memory_pressure.h"
+
+#include <fcntl.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <optional>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/util.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Extra bytes released per pressured tick, on top of the configured
+// background release rate.  The severe increment is sized so that a stall
+// under a tight memory.max drains the pageheap free lists (and through
+// them the huge cache) within a few ticks.
+constexpr size_t kMildReleaseBytes = 64 << 20;
+constexpr size_t kSevereReleaseBytes = 512 << 20;
+
+ABSL_CONST_INIT std::atomic<size_t> reactions{0};
+
+std::optional<double> ReadAvg10FromFile(const char* path) {
+  const int fd = signal_safe_open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  // PSI files are a few short lines; one read captures them.
+  char buf[512];
+  const ssize_t rc = signal_safe_read(fd, buf, sizeof(buf) - 1, nullptr);
+  signal_safe_close(fd);
+  if (rc <= 0) {
+    return std::nullopt;
+  }
+  return ParseMemoryPressureAvg10(absl::string_view(buf, rc));
+}
+
+// Resolves this process's cgroup2 memory.pressure path once.  Only the
+// background thread calls this, so plain statics suffice.
+const char* CgroupMemoryPressurePath() {
+  static char path[256];
+  static bool resolved = false;
+  static bool valid = false;
+  if (resolved) {
+    return valid ? path : nullptr;
+  }
+  resolved = true;
+
+  const int fd = signal_safe_open("/proc/self/cgroup", O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  char buf[512];
+  const ssize_t rc = signal_safe_read(fd, buf, sizeof(buf) - 1, nullptr);
+  signal_safe_close(fd);
+  if (rc <= 0) {
+    return nullptr;
+  }
+  absl::string_view contents(buf, rc);
+  // The cgroup2 hierarchy is the line "0::<path>".
+  while (!contents.empty()) {
+    const size_t newline = contents.find('\n');
+    absl::string_view line = contents.substr(0, newline);
+    contents = newline == absl::string_view::npos
+                   ? absl::string_view()
+                   : contents.substr(newline + 1);
+    if (!absl::ConsumePrefix(&line, "0::")) {
+      continue;
+    }
+    const int written =
+        snprintf(path, sizeof(path), "/sys/fs/cgroup%.*s/memory.pressure",
+                 static_cast<int>(line.size()), line.data());
+    valid = written > 0 && written < static_cast<int>(sizeof(path));
+    break;
+  }
+  return valid ? path : nullptr;
+}
+
+}  // namespace
+
+std::optional<double> ParseMemoryPressureAvg10(absl::string_view contents) {
+  // Format: "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\nfull ...".
+  constexpr absl::string_view kKey = "some avg10=";
+  const size_t start = contents.find(kKey);
+  if (start == absl::string_view::npos) {
+    return std::nullopt;
+  }
+  absl::string_view value = contents.substr(start + kKey.size());
+  value = value.substr(0, value.find(' '));
+  double avg10;
+  if (!absl::SimpleAtod(value, &avg10) || avg10 < 0) {
+    return std::nullopt;
+  }
+  return avg10;
+}
+
+std::optional<double> ReadMemoryPressureAvg10() {
+  if (const char* cgroup_path = CgroupMemoryPressurePath();
+      cgroup_path != nullptr) {
+    if (std::optional<double> avg10 = ReadAvg10FromFile(cgroup_path);
+        avg10.has_value()) {
+      return avg10;
+    }
+  }
+  return ReadAvg10FromFile("/proc/pressure/memory");
+}
+
+MemoryPressureLevel ClassifyMemoryPressure(double avg10, double threshold) {
+  if (threshold <= 0 || avg10 < threshold) {
+    return MemoryPressureLevel::kNone;
+  }
+  return avg10 >= 2 * threshold ? MemoryPressureLevel::kSevere
+                                : MemoryPressureLevel::kMild;
+}
+
+void CheckMemoryPressure(double threshold) {
+  const std::optional<double> avg10 = ReadMemoryPressureAvg10();
+  if (!avg10.has_value()) {
+    return;
+  }
+  const MemoryPressureLevel level = ClassifyMemoryPressure(*avg10, threshold);
+
+  // Log transitions onto a pressured level, not every pressured tick.
+  static MemoryPressureLevel last_level = MemoryPressureLevel::kNone;
+  if (level > last_level) {
+    Log(kLog, __FILE__, __LINE__,
+        "tcmalloc: reacting to memory pressure, avg10 (x100) / level",
+        static_cast<int>(*avg10 * 100), static_cast<int>(level));
+  }
+  last_level = level;
+
+  if (level == MemoryPressureLevel::kNone) {
+    return;
+  }
+  reactions.fetch_add(1, std::memory_order_relaxed);
+
+  // The release sweep walks the pageheap free lists and, through them, the
+  // huge cache, so this both raises the effective release rate and shrinks
+  // the huge cache's backed footprint.
+  MallocExtension::ReleaseMemoryToSystem(level == MemoryPressureLevel::kSevere
+                                             ? kSevereReleaseBytes
+                                             : kMildReleaseBytes);
+
+  if (level == MemoryPressureLevel::kSevere && UsePerCpuCache(tc_globals)) {
+    // Idle per-cpu caches hold memory nothing is using; hand it back before
+    // the kernel starts reclaiming pages we still want.
+    tc_globals.cpu_cache().TryReclaimingCaches();
+  }
+}
+
+size_t MemoryPressureReactions() {
+  return reactions.load(std::memory_order_relaxed);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
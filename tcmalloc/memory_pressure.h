@@ -0,0 +1,69 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Graduated responses to kernel memory pressure (PSI).  Processes run under
+// memory.max learn about pressure today only when the kernel stalls them or
+// an operator notices and calls ReleaseMemoryToSystem from outside, seconds
+// too late.  When Parameters::memory_pressure_avg10_threshold() is nonzero,
+// the background thread samples the memory PSI "some avg10" figure -- this
+// cgroup's memory.pressure when cgroup2 is mounted, the system-wide
+// /proc/pressure/memory otherwise -- every tick and reacts while reclaim is
+// still cheap: mild pressure adds an extra release increment on top of the
+// configured background release rate (which also shrinks the huge cache's
+// backed pages), and sustained pressure at twice the threshold additionally
+// flushes idle per-cpu caches via TryReclaimingCaches.
+
+#ifndef TCMALLOC_MEMORY_PRESSURE_H_
+#define TCMALLOC_MEMORY_PRESSURE_H_
+
+#include <cstddef>
+#include <optional>
+
+#include "absl/strings/string_view.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+enum class MemoryPressureLevel {
+  kNone,
+  kMild,    // avg10 at or above the threshold.
+  kSevere,  // avg10 at or above twice the threshold.
+};
+
+// Extracts the "some avg10" percentage from PSI file contents.  Exposed to
+// permit testing it.
+std::optional<double> ParseMemoryPressureAvg10(absl::string_view contents);
+
+// Reads the current memory PSI "some avg10" percentage, preferring this
+// process's cgroup2 memory.pressure over the system-wide file.  Returns
+// nullopt if neither is readable (pre-PSI kernels).
+std::optional<double> ReadMemoryPressureAvg10();
+
+// Maps a PSI reading to a response level; a threshold <= 0 disables.
+MemoryPressureLevel ClassifyMemoryPressure(double avg10, double threshold);
+
+// Samples PSI and applies the graduated response for the resulting level.
+// Called every tick from the background thread while the threshold is set.
+void CheckMemoryPressure(double threshold);
+
+// Number of background ticks that triggered a pressure response.
+size_t MemoryPressureReactions();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_MEMORY_PRESSURE_H_
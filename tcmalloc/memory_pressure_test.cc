@@ -0,0 +1,66 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/memory_pressure.h"
+
+#include <cstddef>
+#include <optional>
+
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(MemoryPressureTest, ParsesPsiFileContents) {
+  constexpr absl::string_view kContents =
+      "some avg10=1.25 avg60=0.40 avg300=0.10 total=12345678\n"
+      "full avg10=0.50 avg60=0.20 avg300=0.05 total=2345678\n";
+  const std::optional<double> avg10 = ParseMemoryPressureAvg10(kContents);
+  ASSERT_TRUE(avg10.has_value());
+  EXPECT_DOUBLE_EQ(*avg10, 1.25);
+}
+
+TEST(MemoryPressureTest, RejectsMalformedContents) {
+  EXPECT_FALSE(ParseMemoryPressureAvg10("").has_value());
+  EXPECT_FALSE(ParseMemoryPressureAvg10("full avg10=0.50\n").has_value());
+  EXPECT_FALSE(ParseMemoryPressureAvg10("some avg10=bogus \n").has_value());
+  EXPECT_FALSE(ParseMemoryPressureAvg10("some avg10=-1.0 \n").has_value());
+}
+
+TEST(MemoryPressureTest, ClassifiesAgainstThreshold) {
+  EXPECT_EQ(ClassifyMemoryPressure(/*avg10=*/50.0, /*threshold=*/0),
+            MemoryPressureLevel::kNone);
+  EXPECT_EQ(ClassifyMemoryPressure(0.5, 1.0), MemoryPressureLevel::kNone);
+  EXPECT_EQ(ClassifyMemoryPressure(1.0, 1.0), MemoryPressureLevel::kMild);
+  EXPECT_EQ(ClassifyMemoryPressure(1.9, 1.0), MemoryPressureLevel::kMild);
+  EXPECT_EQ(ClassifyMemoryPressure(2.0, 1.0), MemoryPressureLevel::kSevere);
+}
+
+TEST(MemoryPressureTest, SamplingIsSafeOnThisKernel) {
+  // PSI may be absent (pre-4.20 kernels, psi=0); either way the read must
+  // not fail destructively and a quiet system must not trigger a response.
+  const std::optional<double> avg10 = ReadMemoryPressureAvg10();
+  if (avg10.has_value()) {
+    EXPECT_GE(*avg10, 0);
+  }
+  const size_t reactions_before = MemoryPressureReactions();
+  CheckMemoryPressure(/*threshold=*/101.0);  // avg10 never exceeds 100.
+  EXPECT_EQ(MemoryPressureReactions(), reactions_before);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
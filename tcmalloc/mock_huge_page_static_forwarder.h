@@ -28,6 +28,7 @@
 #include "absl/hash/hash.h"
 #include "absl/numeric/bits.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/huge_pages.h"
@@ -54,6 +55,15 @@ class FakeStaticForwarder {
   absl::Duration filler_skip_subrelease_long_interval() {
     return long_interval_;
   }
+  bool huge_cache_demand_based_release() {
+    return huge_cache_demand_based_release_;
+  }
+  absl::Duration cache_demand_release_short_interval() {
+    return cache_short_interval_;
+  }
+  absl::Duration cache_demand_release_long_interval() {
+    return cache_long_interval_;
+  }
   bool release_partial_alloc_pages() { return release_partial_alloc_pages_; }
   bool hpaa_subrelease() { return hpaa_subrelease_; }
 
@@ -66,6 +76,15 @@ class FakeStaticForwarder {
   void set_filler_skip_subrelease_long_interval(absl::Duration v) {
     long_interval_ = v;
   }
+  void set_huge_cache_demand_based_release(bool v) {
+    huge_cache_demand_based_release_ = v;
+  }
+  void set_cache_demand_release_short_interval(absl::Duration v) {
+    cache_short_interval_ = v;
+  }
+  void set_cache_demand_release_long_interval(absl::Duration v) {
+    cache_long_interval_ = v;
+  }
   void set_release_partial_alloc_pages(bool v) {
     release_partial_alloc_pages_ = v;
   }
@@ -139,6 +158,14 @@ class FakeStaticForwarder {
 
     return release_succeeds_;
   }
+  size_t ReleaseRanges(absl::Span<const AddressRange> ranges, bool* ok) {
+    size_t successes = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      ok[i] = ReleasePages(ranges[i].ptr, ranges[i].bytes);
+      successes += ok[i] ? 1 : 0;
+    }
+    return successes;
+  }
 
  private:
   static absl::base_internal::LowLevelAlloc::Arena* ll_arena() {
@@ -152,6 +179,8 @@ class FakeStaticForwarder {
   }
 
   absl::Duration subrelease_interval_, short_interval_, long_interval_;
+  absl::Duration cache_short_interval_, cache_long_interval_;
+  bool huge_cache_demand_based_release_ = false;
   bool release_partial_alloc_pages_ = false;
   bool hpaa_subrelease_ = true;
   bool release_succeeds_ = true;
@@ -39,6 +39,11 @@ class FakeStaticForwarder {
   size_t class_to_size(int size_class) const { return class_size_; }
   Length class_to_pages(int size_class) const { return pages_; }
   size_t num_objects_to_move() const { return num_objects_to_move_; }
+  size_t num_objects_to_move(int size_class) const {
+    return num_objects_to_move_;
+  }
+  bool span_coloring(int size_class) const { return span_coloring_; }
+  void set_span_coloring(bool enabled) { span_coloring_ = enabled; }
 
   void MapObjectsToSpans(absl::Span<void*> batch, Span** spans) {
     for (size_t i = 0; i < batch.size(); ++i) {
@@ -106,6 +111,7 @@ class FakeStaticForwarder {
   size_t class_size_;
   Length pages_;
   size_t num_objects_to_move_;
+  bool span_coloring_ = false;
 };
 
 class RawMockStaticForwarder : public FakeStaticForwarder {
@@ -146,6 +152,9 @@ class RawMockStaticForwarder : public FakeStaticForwarder {
   MOCK_METHOD(size_t, class_to_size, (int size_class));
   MOCK_METHOD(Length, class_to_pages, (int size_class));
   MOCK_METHOD(size_t, num_objects_to_move, ());
+  // The mocked zero-argument overload above hides the base class' overload
+  // set; CentralFreeList::Init looks the batch size up by size class.
+  size_t num_objects_to_move(int size_class) { return num_objects_to_move(); }
   MOCK_METHOD(void, Init,
               (size_t class_size, size_t pages, size_t num_objects_to_move));
   MOCK_METHOD(void, MapObjectsToSpans, (absl::Span<void*> batch, Span** spans));
@@ -191,7 +200,12 @@ class FakeCentralFreeListEnvironment {
     cache_.Init(kSizeClass, use_all_buckets_for_few_object_spans);
   }
 
-  ~FakeCentralFreeListEnvironment() { EXPECT_EQ(cache_.length(), 0); }
+  ~FakeCentralFreeListEnvironment() {
+    // Completely-free spans may be parked for same-class reuse; hand them
+    // back so the fake forwarder releases their backing memory.
+    cache_.DrainSpanCache();
+    EXPECT_EQ(cache_.length(), 0);
+  }
 
   CentralFreeList& central_freelist() { return cache_; }
 
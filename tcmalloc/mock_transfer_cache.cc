@@ -17,6 +17,7 @@
 namespace tcmalloc {
 namespace tcmalloc_internal {
 
+ABSL_CONST_INIT bool FakeTransferCacheManager::sort_inserted_batches_(false);
 ABSL_CONST_INIT bool
     ArenaBasedFakeTransferCacheManager::partial_legacy_transfer_cache_(false);
 ABSL_CONST_INIT bool FakeShardedTransferCacheManager::enable_generic_cache_(
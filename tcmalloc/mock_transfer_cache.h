@@ -49,6 +49,10 @@ class FakeTransferCacheManager {
     // TODO(b/170732338): test with multiple different num_objects_to_move
     return kNumToMove;
   }
+  static bool sort_inserted_batches() { return sort_inserted_batches_; }
+  static void SetSortInsertedBatches(bool value) {
+    sort_inserted_batches_ = value;
+  }
   void* Alloc(size_t size, std::align_val_t alignment = kAlignment) {
     memory_.push_back(std::make_unique<AlignedPtr>(
         ::operator new(size, alignment), alignment));
@@ -56,6 +60,7 @@ class FakeTransferCacheManager {
   }
 
  private:
+  static bool sort_inserted_batches_;
   struct AlignedPtr {
     AlignedPtr(void* ptr, std::align_val_t alignment)
         : ptr(ptr), alignment(alignment) {}
@@ -83,6 +88,7 @@ class ArenaBasedFakeTransferCacheManager {
     if (size_class == kSizeClass) return kNumToMove;
     return 0;
   }
+  constexpr static bool sort_inserted_batches() { return false; }
   void* Alloc(size_t size, std::align_val_t alignment = kAlignment) {
     size_t space = kTotalSize - used_;
     if (space < size) return nullptr;
@@ -287,6 +293,9 @@ class TwoSizeClassManager : public FakeTransferCacheManager {
   TransferCacheStats GetStats(int size_class) {
     return caches_[size_class]->GetStats();
   }
+  FreeList& central_freelist(int size_class) {
+    return caches_[size_class]->freelist();
+  }
 
   std::vector<std::unique_ptr<TransferCache>> caches_;
 };
@@ -309,6 +318,7 @@ class FakeCpuLayout {
   }
 
   unsigned NumShards() { return num_shards_; }
+  int NumCpus() { return kNumCpus; }
   int CurrentCpu() { return current_cpu_; }
   unsigned CpuShard(int cpu) { return cpu / kCpusPerShard; }
 
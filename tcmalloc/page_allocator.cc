@@ -14,13 +14,19 @@
 
 #include "tcmalloc/page_allocator.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 
 #include "absl/base/attributes.h"
 #include "absl/base/call_once.h"
 #include "absl/base/optimization.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tcmalloc/common.h"
+#include "tcmalloc/heap_limit_backpressure.h"
 #include "tcmalloc/huge_page_aware_allocator.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/environment.h"
@@ -164,7 +170,13 @@ void PageAllocator::ShrinkToUsageLimit(Length n) {
     // Limits are not set.
     return;
   }
-  if (backed <= limits_[kSoft]) {
+  // Unused reserve pools come out of the soft limit: ordinary traffic is shed
+  // down to (limit - reserves), so a subsystem drawing on its pool finds the
+  // headroom free.  The hard limit is absolute and unaffected.
+  const size_t reserved = reserved_bytes();
+  const size_t soft_limit =
+      limits_[kSoft] > reserved ? limits_[kSoft] - reserved : 0;
+  if (backed <= soft_limit) {
     // We're already fine.
     return;
   }
@@ -172,7 +184,14 @@ void PageAllocator::ShrinkToUsageLimit(Length n) {
   ++limit_hits_[kSoft];
   if (limits_[kHard] < backed) ++limit_hits_[kHard];
 
-  const size_t overage = backed - limits_[kSoft];
+  // Record the hit for the background thread, which invokes any registered
+  // backpressure callbacks outside pageheap_lock (see
+  // heap_limit_backpressure.h).  The release attempts below proceed
+  // regardless; the callbacks are for slack the allocator cannot reach, such
+  // as application caches.
+  NotifySoftLimitExceeded(backed, soft_limit);
+
+  const size_t overage = backed - soft_limit;
   const Length pages = LengthFromBytes(overage + kPageSize - 1);
   if (ShrinkHardBy(pages, kSoft)) {
     ++successful_shrinks_after_limit_hit_[kSoft];
@@ -212,7 +231,55 @@ void PageAllocator::ShrinkToUsageLimit(Length n) {
   if (warned) return;
   warned = true;
   Log(kLogWithStack, __FILE__, __LINE__, "Couldn't respect usage limit of",
-      limits_[kSoft], "and OOM is likely to follow.");
+      soft_limit, "and OOM is likely to follow.");
+}
+
+int PageAllocator::CreateReservePool(size_t bytes) {
+  if (bytes == 0) return -1;
+  PageHeapSpinLockHolder l;
+  for (int i = 0; i < kMaxReservePools; ++i) {
+    if (reserve_capacity_[i] != 0) continue;
+    reserve_capacity_[i] = bytes;
+    reserve_available_[i] = bytes;
+    // Start shedding toward the reduced effective limit now, rather than on
+    // the next allocation.
+    ShrinkToUsageLimit(Length(0));
+    return i;
+  }
+  return -1;
+}
+
+bool PageAllocator::DestroyReservePool(int handle) {
+  if (handle < 0 || handle >= kMaxReservePools) return false;
+  PageHeapSpinLockHolder l;
+  if (reserve_capacity_[handle] == 0) return false;
+  reserve_capacity_[handle] = 0;
+  reserve_available_[handle] = 0;
+  return true;
+}
+
+size_t PageAllocator::AcquireFromReservePool(int handle, size_t bytes) {
+  if (handle < 0 || handle >= kMaxReservePools) return 0;
+  PageHeapSpinLockHolder l;
+  if (reserve_capacity_[handle] == 0) return 0;
+  const size_t granted = std::min(bytes, reserve_available_[handle]);
+  reserve_available_[handle] -= granted;
+  return granted;
+}
+
+size_t PageAllocator::ReservePoolAvailable(int handle) const {
+  if (handle < 0 || handle >= kMaxReservePools) return 0;
+  PageHeapSpinLockHolder l;
+  if (reserve_capacity_[handle] == 0) return 0;
+  return reserve_available_[handle];
+}
+
+size_t PageAllocator::reserved_bytes() const {
+  size_t total = 0;
+  for (int i = 0; i < kMaxReservePools; ++i) {
+    total += reserve_available_[i];
+  }
+  return total;
 }
 
 bool PageAllocator::ShrinkHardBy(Length pages, LimitKind limit_kind) {
@@ -261,6 +328,274 @@ size_t PageAllocator::active_numa_partitions() const {
   return tc_globals.numa_topology().active_partitions();
 }
 
+size_t PageAllocator::GetHugeCacheRanges(HugeRange* ranges, size_t max) const {
+  if (alg_ != HPAA) return 0;
+  size_t total = 0;
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    total += static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+                 ->cache()
+                 ->GetRanges(ranges + std::min(total, max),
+                             max - std::min(total, max));
+  }
+  total += static_cast<HugePageAwareAllocator*>(sampled_impl_)
+               ->cache()
+               ->GetRanges(ranges + std::min(total, max),
+                           max - std::min(total, max));
+  if (has_cold_impl_) {
+    total += static_cast<HugePageAwareAllocator*>(cold_impl_)
+                 ->cache()
+                 ->GetRanges(ranges + std::min(total, max),
+                             max - std::min(total, max));
+  }
+  return total;
+}
+
+size_t PageAllocator::GetHugeRegionRanges(HugeRange* ranges, size_t max) const {
+  if (alg_ != HPAA) return 0;
+  size_t total = 0;
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    total += static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+                 ->region()
+                 .GetRanges(ranges + std::min(total, max),
+                            max - std::min(total, max));
+  }
+  total += static_cast<HugePageAwareAllocator*>(sampled_impl_)
+               ->region()
+               .GetRanges(ranges + std::min(total, max),
+                          max - std::min(total, max));
+  if (has_cold_impl_) {
+    total += static_cast<HugePageAwareAllocator*>(cold_impl_)
+                 ->region()
+                 .GetRanges(ranges + std::min(total, max),
+                            max - std::min(total, max));
+  }
+  return total;
+}
+
+size_t PageAllocator::GetHugeRegionStats(HugeRegionStats* stats,
+                                         size_t max) const {
+  if (alg_ != HPAA) return 0;
+  size_t total = 0;
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    total += static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+                 ->region()
+                 .GetRegionStats(stats + std::min(total, max),
+                                 max - std::min(total, max));
+  }
+  total += static_cast<HugePageAwareAllocator*>(sampled_impl_)
+               ->region()
+               .GetRegionStats(stats + std::min(total, max),
+                               max - std::min(total, max));
+  if (has_cold_impl_) {
+    total += static_cast<HugePageAwareAllocator*>(cold_impl_)
+                 ->region()
+                 .GetRegionStats(stats + std::min(total, max),
+                                 max - std::min(total, max));
+  }
+  return total;
+}
+
+bool PageAllocator::GetFillerLayoutContaining(PageId p, MemoryTag tag,
+                                              FillerHugePageLayout* layout) {
+  if (alg_ != HPAA) return false;
+  return static_cast<HugePageAwareAllocator*>(impl(tag))
+      ->GetFillerLayoutContaining(p, layout);
+}
+
+double PageAllocator::GetVAFragmentationScore() const {
+  if (alg_ != HPAA) return 0.0;
+  double worst = 0.0;
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    worst = std::max(
+        worst, static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+                   ->VAFragmentationScore());
+  }
+  worst = std::max(worst, static_cast<HugePageAwareAllocator*>(sampled_impl_)
+                              ->VAFragmentationScore());
+  if (has_cold_impl_) {
+    worst = std::max(worst, static_cast<HugePageAwareAllocator*>(cold_impl_)
+                                ->VAFragmentationScore());
+  }
+  return worst;
+}
+
+void PageAllocator::SetDenseRegionBias(bool bias) {
+  if (alg_ != HPAA) return;
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+        ->SetDenseRegionBias(bias);
+  }
+}
+
+PageAllocator::ReleaseStats PageAllocator::ReleaseUpToDeadline(
+    Length num_pages, absl::Time deadline, bool break_hugepages) {
+  // Small enough that the deadline checks between chunks are meaningful,
+  // large enough to amortize the freelist scan each release performs.
+  constexpr Length kReleaseChunk = Length(2048);
+
+  ReleaseStats stats;
+  auto remaining = [&]() {
+    const Length total = stats.total();
+    return num_pages > total ? num_pages - total : Length(0);
+  };
+  auto expired = [&]() {
+    if (absl::Now() < deadline) return false;
+    stats.deadline_exceeded = true;
+    return true;
+  };
+
+  // Cold data is the most resilient to not being on hugepages and, by the
+  // caller's declaration, the least likely to be touched again soon.
+  if (has_cold_impl_) {
+    while (remaining() > Length(0) && !expired()) {
+      const Length ask = std::min(remaining(), kReleaseChunk);
+      const Length got = cold_impl_->ReleaseAtLeastNPages(ask);
+      stats.cold += got;
+      if (got < ask) break;
+    }
+  }
+
+  // Rotate partitions like ReleaseAtLeastNPages, so recurring rounds do not
+  // persistently drain node 0 first.
+  const size_t partitions = active_numa_partitions();
+  for (size_t i = 0; i < partitions; i++) {
+    const size_t partition = (next_release_partition_ + i) % partitions;
+    while (remaining() > Length(0) && !expired()) {
+      const Length ask = std::min(remaining(), kReleaseChunk);
+      const Length got = normal_impl_[partition]->ReleaseAtLeastNPages(ask);
+      stats.normal += got;
+      if (got < ask) break;
+    }
+  }
+  next_release_partition_ = (next_release_partition_ + 1) % partitions;
+
+  while (remaining() > Length(0) && !expired()) {
+    const Length ask = std::min(remaining(), kReleaseChunk);
+    const Length got = sampled_impl_->ReleaseAtLeastNPages(ask);
+    stats.sampled += got;
+    if (got < ask) break;
+  }
+
+  // Only break hugepages once every tier's intact free memory is exhausted;
+  // this trades TLB pressure on the survivors for the released bytes.
+  if (break_hugepages && alg_ == HPAA) {
+    Interface* heaps[kNumHeaps];
+    size_t num_heaps = 0;
+    if (has_cold_impl_) heaps[num_heaps++] = cold_impl_;
+    for (size_t partition = 0; partition < partitions; partition++) {
+      heaps[num_heaps++] = normal_impl_[partition];
+    }
+    heaps[num_heaps++] = sampled_impl_;
+    for (size_t i = 0; i < num_heaps; i++) {
+      while (remaining() > Length(0) && !expired()) {
+        const Length ask = std::min(remaining(), kReleaseChunk);
+        const Length got = static_cast<HugePageAwareAllocator*>(heaps[i])
+                               ->ReleaseAtLeastNPagesBreakingHugepages(ask);
+        stats.broken_hugepages += got;
+        if (got < ask) break;
+      }
+    }
+  }
+
+  return stats;
+}
+
+// Version tag for serialized huge cache state.  Bump whenever the line format
+// below changes; RestoreHugeCacheState refuses snapshots it does not
+// recognize rather than guessing.
+static constexpr absl::string_view kHugeCacheStateHeader = "hugecache_state v1";
+
+size_t PageAllocator::SerializeHugeCacheState(char* buffer,
+                                              size_t buffer_length) const {
+  if (alg_ != HPAA) return 0;
+  Printer out(buffer, buffer_length);
+  out.printf("%s\n", kHugeCacheStateHeader);
+  auto print_one = [&](MemoryTag tag, const HugeCache* cache) {
+    const HugeCacheState state = cache->ExtractState();
+    out.printf("%s %zu %zu %zu\n", MemoryTagToLabel(tag),
+               state.limit.raw_num(), state.usage_min.raw_num(),
+               state.usage_max.raw_num());
+  };
+  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+    print_one(
+        NumaNormalTag(partition),
+        static_cast<HugePageAwareAllocator*>(normal_impl_[partition])->cache());
+  }
+  print_one(MemoryTag::kSampled,
+            static_cast<HugePageAwareAllocator*>(sampled_impl_)->cache());
+  if (has_cold_impl_) {
+    print_one(MemoryTag::kCold,
+              static_cast<HugePageAwareAllocator*>(cold_impl_)->cache());
+  }
+  return out.SpaceRequired();
+}
+
+bool PageAllocator::RestoreHugeCacheState(absl::string_view serialized) {
+  if (alg_ != HPAA) return false;
+
+  auto cache_for_label = [&](absl::string_view label) -> HugeCache* {
+    for (int partition = 0; partition < active_numa_partitions(); partition++) {
+      const MemoryTag tag = NumaNormalTag(partition);
+      if (label == MemoryTagToLabel(tag)) {
+        return static_cast<HugePageAwareAllocator*>(normal_impl_[partition])
+            ->cache();
+      }
+    }
+    if (label == MemoryTagToLabel(MemoryTag::kSampled)) {
+      return static_cast<HugePageAwareAllocator*>(sampled_impl_)->cache();
+    }
+    if (has_cold_impl_ && label == MemoryTagToLabel(MemoryTag::kCold)) {
+      return static_cast<HugePageAwareAllocator*>(cold_impl_)->cache();
+    }
+    return nullptr;
+  };
+
+  bool saw_header = false;
+  while (!serialized.empty()) {
+    const size_t eol = serialized.find('\n');
+    absl::string_view line = serialized.substr(0, eol);
+    serialized = eol == absl::string_view::npos ? absl::string_view()
+                                                : serialized.substr(eol + 1);
+    if (line.empty()) continue;
+    if (!saw_header) {
+      if (line != kHugeCacheStateHeader) return false;
+      saw_header = true;
+      continue;
+    }
+
+    // Each line is "<label> <limit> <usage_min> <usage_max>", in hugepages.
+    const size_t label_end = line.find(' ');
+    if (label_end == absl::string_view::npos) return false;
+    const absl::string_view label = line.substr(0, label_end);
+    line.remove_prefix(label_end + 1);
+
+    size_t values[3];
+    for (size_t& value : values) {
+      const size_t end = line.find(' ');
+      if (!absl::SimpleAtoi(line.substr(0, end), &value)) return false;
+      // Reject values a real snapshot cannot contain (the byte count must be
+      // representable) so a corrupt file cannot overflow HugeLength
+      // arithmetic in SeedState.
+      if (value > std::numeric_limits<size_t>::max() / kHugePageSize) {
+        return false;
+      }
+      line = end == absl::string_view::npos ? absl::string_view()
+                                            : line.substr(end + 1);
+    }
+
+    // A heap absent from this configuration (e.g. a NUMA partition or the
+    // cold heap) is not an error; just drop its line.
+    HugeCache* cache = cache_for_label(label);
+    if (cache == nullptr) continue;
+    HugeCacheState state;
+    state.limit = NHugePages(values[0]);
+    state.usage_min = NHugePages(values[1]);
+    state.usage_max = NHugePages(values[2]);
+    cache->SeedState(state);
+  }
+  return saw_header;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
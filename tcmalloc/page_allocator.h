@@ -20,10 +20,13 @@
 #include <array>
 #include <cstdint>
 #include <limits>
+#include <optional>
 
 #include "absl/base/attributes.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/huge_page_aware_allocator.h"
 #include "tcmalloc/internal/allocation_guard.h"
@@ -64,6 +67,12 @@ class PageAllocator {
   void Delete(Span* span, size_t objects_per_span, MemoryTag tag)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Deletes every span in <spans>, all returned by earlier calls to New()
+  // with the same value of "tag", in a single call to the underlying
+  // allocator.
+  void DeleteBatch(absl::Span<Span*> spans, size_t objects_per_span,
+                   MemoryTag tag) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   BackingStats stats() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
   void GetSmallSpanStats(SmallSpanStats* result)
@@ -81,6 +90,61 @@ class PageAllocator {
   Length ReleaseAtLeastNPages(Length num_pages)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Per-tier breakdown of a deadline-bounded release; see ReleaseUpToDeadline.
+  struct ReleaseStats {
+    Length cold;
+    Length normal;
+    Length sampled;
+    // Free pages reachable only by breaking up intact hugepages.
+    Length broken_hugepages;
+    // True if the deadline passed before the target was met.
+    bool deadline_exceeded = false;
+
+    Length total() const {
+      return cold + normal + sampled + broken_hugepages;
+    }
+  };
+
+  // Releases free memory until at least num_pages have been returned, no
+  // more can be released, or deadline passes.  Release proceeds in bounded
+  // chunks with the deadline rechecked between chunks, since an individual
+  // release call cannot be interrupted.  Tiers are drained coldest first:
+  // the cold heap, then the normal heaps, then the sampled heap.  Free pages
+  // on intact hugepages are broken up only when break_hugepages is set and
+  // the target was not otherwise met.
+  ReleaseStats ReleaseUpToDeadline(Length num_pages, absl::Time deadline,
+                                   bool break_hugepages)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Attempts to grow <span>, allocated with <tag>, in place to <new_len>
+  // pages.  Returns false if the backing allocator cannot extend the span.
+  bool GrowSpanInPlace(Span* span, Length new_len, MemoryTag tag)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Returns the sum of each heap's peak page demand over the most recent
+  // <interval>, as tracked by the huge page allocators' demand history.
+  // Zero when the underlying allocators do not track demand.
+  Length GetRecentDemandPeak(absl::Duration interval)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Returns the number of pages in use on the hugepage containing <p>,
+  // allocated with <tag>, if the owning heap fills that hugepage with small
+  // allocations; std::nullopt otherwise.
+  std::optional<Length> FillerUsedPagesContaining(PageId p, MemoryTag tag) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Publishes the background idle scan's coldness score for the hugepage
+  // containing <p>, allocated with <tag>; a no-op when the owning heap does
+  // not fill that hugepage with small allocations.
+  void SetFillerIdleScoreContaining(PageId p, MemoryTag tag, uint8_t score)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Marks the hugepages overlapping [p, p + n), allocated with <tag>, as
+  // exempt from (or again subject to) release to the OS.  See
+  // MallocExtension::MarkUnreleasable.
+  void MarkUnreleasable(PageId p, Length n, MemoryTag tag, bool unreleasable)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   // Prints stats about the page heap to *out.
   void Print(Printer* out, MemoryTag tag) ABSL_LOCKS_EXCLUDED(pageheap_lock);
   void PrintInPbtxt(PbtxtRegion* region, MemoryTag tag)
@@ -106,6 +170,35 @@ class PageAllocator {
   void ShrinkToUsageLimit(Length n)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Reserve pools carve headroom out of the soft limit for critical
+  // subsystems.  CreateReservePool(bytes) removes <bytes> from the headroom
+  // available to ordinary traffic: ShrinkToUsageLimit treats the soft limit
+  // as (limit - sum of unused reserves), so the shedding machinery keeps that
+  // much of the limit free.  A subsystem at limit draws its allocations
+  // against its own pool with AcquireFromReservePool, which hands the
+  // headroom back to the global limit as it is consumed.  Pools are
+  // accounting, not physically segregated memory: a reserve guarantees limit
+  // headroom, not residency, and is inert while no soft limit is set.
+  //
+  // Returns a handle for the other calls, or -1 if all pool slots are in use
+  // or bytes is zero.
+  int CreateReservePool(size_t bytes) ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
+  // Releases the pool; any unused reserve returns to the global headroom.
+  // Returns false if handle does not name a live pool.
+  bool DestroyReservePool(int handle) ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
+  // Consumes up to <bytes> of the pool's remaining reserve, returning the
+  // amount granted (less than <bytes> once the pool runs dry).  The caller
+  // then allocates normally; the grant is what keeps that allocation inside
+  // the limit.
+  size_t AcquireFromReservePool(int handle, size_t bytes)
+      ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
+  // The pool's remaining reserve, or 0 for a dead handle.
+  size_t ReservePoolAvailable(int handle) const
+      ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
   const PageAllocInfo& info(MemoryTag tag) const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
@@ -125,10 +218,64 @@ class PageAllocator {
     return PeakStats{peak_backed_bytes_, peak_sampled_application_bytes_};
   }
 
+  // Copies up to <max> of the address ranges currently held by the huge
+  // caches (resp. huge regions) of the underlying huge-page-aware heaps into
+  // <ranges>.  Returns the total number of ranges held; only
+  // std::min(total, max) entries of <ranges> are written.  Returns 0 when the
+  // huge-page-aware allocator is not in use.
+  size_t GetHugeCacheRanges(HugeRange* ranges, size_t max) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+  size_t GetHugeRegionRanges(HugeRange* ranges, size_t max) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Like GetHugeRegionRanges, but copies per-region occupancy summaries
+  // rather than bare address ranges.
+  size_t GetHugeRegionStats(HugeRegionStats* stats, size_t max) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Copies the layout of the filler-managed hugepage containing <p>,
+  // allocated with <tag>, into <layout>; returns false when no filler
+  // tracks that hugepage or the huge-page-aware allocator is not in use.
+  bool GetFillerLayoutContaining(PageId p, MemoryTag tag,
+                                 FillerHugePageLayout* layout)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Worst (highest) VA fragmentation score across the huge-page-aware heaps,
+  // in [0, 1]; see HugeAddressMap::FragmentationScore.  Returns 0 when the
+  // huge-page-aware allocator is not in use.
+  double GetVAFragmentationScore() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Biases large-allocation placement in the normal huge-page-aware heaps
+  // toward huge regions and dense packing (see
+  // HugePageAwareAllocator::SetDenseRegionBias).  The cold heap is left alone:
+  // its placement is reclaim-driven, not TLB-driven.  No-op when the
+  // huge-page-aware allocator is not in use.
+  void SetDenseRegionBias(bool bias);
+
+  // Serializes the sizing state each huge cache has learned from its demand
+  // history into <buffer> as versioned text, one line per heap.  Returns the
+  // number of bytes used (or required, had the buffer been large enough), or
+  // 0 when the huge-page-aware allocator is not in use.
+  size_t SerializeHugeCacheState(char* buffer, size_t buffer_length) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Seeds the huge caches from a snapshot previously written by
+  // SerializeHugeCacheState(), possibly in another process.  Lines for heaps
+  // not present in this configuration are ignored.  Returns false when the
+  // snapshot is malformed or from an incompatible version, in which case no
+  // state is guaranteed to have been adopted.
+  bool RestoreHugeCacheState(absl::string_view serialized)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
  private:
   bool ShrinkHardBy(Length page, LimitKind limit_kind)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Sum of the unused reserves across live pools; the soft limit shrinks by
+  // this much for ordinary traffic.
+  size_t reserved_bytes() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
   using Interface =
       std::conditional<huge_page_allocator_internal::kUnconditionalHPAA,
                        HugePageAwareAllocator, PageAllocatorInterface>::type;
@@ -158,12 +305,24 @@ class PageAllocator {
   size_t limits_[kNumLimits] = {std::numeric_limits<size_t>::max(),
                                 std::numeric_limits<size_t>::max()};
 
+  // Reserve pool slots; a pool is live while its capacity is nonzero.  The
+  // table is small and fixed so the hot ShrinkToUsageLimit path can sum it
+  // without allocation.
+  static constexpr int kMaxReservePools = 8;
+  size_t reserve_capacity_[kMaxReservePools] = {0};
+  size_t reserve_available_[kMaxReservePools] = {0};
+
   // The number of times the limit has been hit.
   int64_t limit_hits_[kNumLimits]{0};
   // Number of times we succeeded in shrinking the memory usage to be less than
   // or at the limit.
   int64_t successful_shrinks_after_limit_hit_[kNumLimits]{0};
 
+  // The NUMA partition ReleaseAtLeastNPages drains first; rotated each round
+  // so release pressure is spread evenly across nodes.  Guarded by
+  // pageheap_lock.
+  size_t next_release_partition_{0};
+
   // peak_backed_bytes_ tracks the maximum number of pages backed (with physical
   // memory) in the page heap and metadata.
   //
@@ -212,6 +371,12 @@ inline void PageAllocator::Delete(Span* span, size_t objects_per_span,
   impl(tag)->Delete(span, objects_per_span);
 }
 
+inline void PageAllocator::DeleteBatch(absl::Span<Span*> spans,
+                                       size_t objects_per_span,
+                                       MemoryTag tag) {
+  impl(tag)->DeleteBatch(spans, objects_per_span);
+}
+
 inline BackingStats PageAllocator::stats() const {
   BackingStats ret = normal_impl_[0]->stats();
   for (int partition = 1; partition < active_numa_partitions(); partition++) {
@@ -224,6 +389,38 @@ inline BackingStats PageAllocator::stats() const {
   return ret;
 }
 
+inline bool PageAllocator::GrowSpanInPlace(Span* span, Length new_len,
+                                           MemoryTag tag) {
+  return impl(tag)->GrowSpanInPlace(span, new_len);
+}
+
+inline std::optional<Length> PageAllocator::FillerUsedPagesContaining(
+    PageId p, MemoryTag tag) const {
+  return impl(tag)->FillerUsedPagesContaining(p);
+}
+
+inline void PageAllocator::SetFillerIdleScoreContaining(PageId p, MemoryTag tag,
+                                                        uint8_t score) {
+  impl(tag)->SetFillerIdleScoreContaining(p, score);
+}
+
+inline void PageAllocator::MarkUnreleasable(PageId p, Length n, MemoryTag tag,
+                                            bool unreleasable) {
+  impl(tag)->MarkUnreleasable(p, n, unreleasable);
+}
+
+inline Length PageAllocator::GetRecentDemandPeak(absl::Duration interval) {
+  Length ret = normal_impl_[0]->GetRecentDemandPeak(interval);
+  for (int partition = 1; partition < active_numa_partitions(); partition++) {
+    ret += normal_impl_[partition]->GetRecentDemandPeak(interval);
+  }
+  ret += sampled_impl_->GetRecentDemandPeak(interval);
+  if (has_cold_impl_) {
+    ret += cold_impl_->GetRecentDemandPeak(interval);
+  }
+  return ret;
+}
+
 inline void PageAllocator::GetSmallSpanStats(SmallSpanStats* result) {
   SmallSpanStats normal, sampled;
   for (int partition = 0; partition < active_numa_partitions(); partition++) {
@@ -263,10 +460,17 @@ inline Length PageAllocator::ReleaseAtLeastNPages(Length num_pages) {
   if (has_cold_impl_) {
     released = cold_impl_->ReleaseAtLeastNPages(num_pages);
   }
-  for (int partition = 0; partition < active_numa_partitions(); partition++) {
+  // Rotate which NUMA partition we release from first.  Each partition's heap
+  // serves (and is bound to) its own node, so recurring release rounds that
+  // always started with partition 0 would persistently drain node 0's free
+  // pages while leaving the other nodes' intact.
+  const size_t partitions = active_numa_partitions();
+  for (size_t i = 0; i < partitions; i++) {
+    const size_t partition = (next_release_partition_ + i) % partitions;
     released += normal_impl_[partition]->ReleaseAtLeastNPages(
         num_pages > released ? num_pages - released : Length(0));
   }
+  next_release_partition_ = (next_release_partition_ + 1) % partitions;
 
   released += sampled_impl_->ReleaseAtLeastNPages(
       num_pages > released ? num_pages - released : Length(0));
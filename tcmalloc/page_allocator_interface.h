@@ -16,8 +16,13 @@
 #define TCMALLOC_PAGE_ALLOCATOR_INTERFACE_H_
 
 #include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
@@ -55,6 +60,17 @@ class PageAllocatorInterface {
   virtual void Delete(Span* span, size_t num_objects)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) = 0;
 
+  // Deletes every span in <spans>, as if by calling Delete on each.  Lets
+  // callers draining many dead spans at once (e.g. the central freelists)
+  // cross the interface once per batch instead of once per span;
+  // implementations may amortize per-call work across the batch.
+  virtual void DeleteBatch(absl::Span<Span*> spans, size_t num_objects)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    for (Span* span : spans) {
+      Delete(span, num_objects);
+    }
+  }
+
   virtual BackingStats stats() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) = 0;
 
@@ -73,6 +89,44 @@ class PageAllocatorInterface {
   virtual Length ReleaseAtLeastNPages(Length num_pages)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) = 0;
 
+  // Attempts to extend <span> in place to <new_len> pages by claiming free
+  // pages adjacent to it, without copying.  Returns true on success; on
+  // failure the span is unchanged.  Backends that cannot extend spans in
+  // place return false.
+  virtual bool GrowSpanInPlace(Span* span, Length new_len)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    return false;
+  }
+
+  // Returns the peak page demand observed within the most recent <interval>,
+  // if this allocator tracks demand history; Length(0) otherwise.
+  virtual Length GetRecentDemandPeak(absl::Duration interval)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    return Length(0);
+  }
+
+  // Returns the number of pages in use on the hugepage containing <p>, if
+  // this allocator fills that hugepage with small allocations; std::nullopt
+  // otherwise.  Backends without hugepage awareness always return
+  // std::nullopt.
+  virtual std::optional<Length> FillerUsedPagesContaining(PageId p)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
+    return std::nullopt;
+  }
+
+  // Publishes the background page_idle scan's coldness score for the
+  // hugepage containing <p>, if this allocator fills that hugepage with
+  // small allocations.  A no-op for backends without hugepage awareness.
+  virtual void SetFillerIdleScoreContaining(PageId p, uint8_t score)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {}
+
+  // Marks every hugepage overlapping [p, p + n) as exempt from (or, with
+  // <unreleasable> false, again subject to) release to the OS.  A no-op for
+  // backends without hugepage awareness, which do not steer release by
+  // hugepage.
+  virtual void MarkUnreleasable(PageId p, Length n, bool unreleasable)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {}
+
   // Prints stats about the page heap to *out.
   virtual void Print(Printer* out) ABSL_LOCKS_EXCLUDED(pageheap_lock) = 0;
 
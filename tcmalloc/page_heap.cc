@@ -56,18 +56,23 @@ Span* PageHeap::SearchFreeAndLargeLists(Length n, bool* from_returned) {
   ASSERT(Check());
   ASSERT(n > Length(0));
 
-  // Find first size >= n that has a non-empty list
-  for (Length s = n; s < kMaxPages; ++s) {
-    SpanList* ll = &free_[s.raw_num()].normal;
-    // If we're lucky, ll is non-empty, meaning it has a suitable span.
-    if (!ll->empty()) {
+  // Find the first size >= n that has a non-empty list via the occupancy
+  // bitmaps.  A tie prefers the normal list, and a closer-fitting returned
+  // span wins over a larger normal one, matching the linear scan this
+  // replaces.
+  if (n < kMaxPages) {
+    const size_t normal_i = normal_nonempty_.FindSet(n.raw_num());
+    const size_t returned_i = returned_nonempty_.FindSet(n.raw_num());
+    if (normal_i <= returned_i && normal_i < kMaxPages.raw_num()) {
+      SpanList* ll = &free_[normal_i].normal;
+      ASSERT(!ll->empty());
       ASSERT(ll->first()->location() == Span::ON_NORMAL_FREELIST);
       *from_returned = false;
       return Carve(ll->first(), n);
     }
-    // Alternatively, maybe there's a usable returned span.
-    ll = &free_[s.raw_num()].returned;
-    if (!ll->empty()) {
+    if (returned_i < kMaxPages.raw_num()) {
+      SpanList* ll = &free_[returned_i].returned;
+      ASSERT(!ll->empty());
       ASSERT(ll->first()->location() == Span::ON_RETURNED_FREELIST);
       *from_returned = true;
       return Carve(ll->first(), n);
@@ -277,6 +282,45 @@ void PageHeap::Delete(Span* span, size_t objects_per_span) {
   ASSERT(Check());
 }
 
+bool PageHeap::GrowSpanInPlace(Span* span, Length new_len) {
+  ASSERT(GetMemoryTag(span->start_address()) == tag_);
+  TC_CHECK_EQ(span->location(), Span::IN_USE);
+  ASSERT(!span->sampled());
+  ASSERT(pagemap_->GetDescriptor(span->last_page()) == span);
+  const Length old_len = span->num_pages();
+  ASSERT(new_len > old_len);
+  const Length need = new_len - old_len;
+
+  // Only extend with backed pages; growing into a returned span would
+  // require backing it first, at which point the copy we are trying to
+  // avoid is comparably cheap.
+  Span* next = pagemap_->GetDescriptor(span->last_page() + Length(1));
+  if (next == nullptr || next->location() != Span::ON_NORMAL_FREELIST ||
+      next->num_pages() < need) {
+    return false;
+  }
+
+  RemoveFromFreeList(next);
+  const Length extra = next->num_pages() - need;
+  if (extra > Length(0)) {
+    Span* leftover = Span::New(next->first_page() + need, extra);
+    leftover->set_location(Span::ON_NORMAL_FREELIST);
+    RecordSpan(leftover);
+    PrependToFreeList(leftover);  // Skip coalescing - no candidates possible
+  }
+  Span::Delete(next);
+  span->set_num_pages(new_len);
+  pagemap_->Set(span->last_page(), span);
+
+  // Account for the growth as a free of the old run plus an allocation of
+  // the new, longer one, keeping info_'s per-size totals consistent with the
+  // RecordFree of new_len pages at Delete time.
+  info_.RecordFree(span->first_page(), old_len);
+  info_.RecordAlloc(span->first_page(), new_len);
+  ASSERT(Check());
+  return true;
+}
+
 void PageHeap::MergeIntoFreeList(Span* span) {
   ASSERT(span->location() != Span::IN_USE);
 
@@ -316,29 +360,33 @@ void PageHeap::MergeIntoFreeList(Span* span) {
 
 void PageHeap::PrependToFreeList(Span* span) {
   ASSERT(span->location() != Span::IN_USE);
-  SpanListPair* list = (span->num_pages() < kMaxPages)
-                           ? &free_[span->num_pages().raw_num()]
-                           : &large_;
+  const bool small = span->num_pages() < kMaxPages;
+  SpanListPair* list = small ? &free_[span->num_pages().raw_num()] : &large_;
   if (span->location() == Span::ON_NORMAL_FREELIST) {
     stats_.free_bytes += span->bytes_in_span();
     list->normal.prepend(span);
+    if (small) normal_nonempty_.SetBit(span->num_pages().raw_num());
   } else {
     stats_.unmapped_bytes += span->bytes_in_span();
     list->returned.prepend(span);
+    if (small) returned_nonempty_.SetBit(span->num_pages().raw_num());
   }
 }
 
 void PageHeap::RemoveFromFreeList(Span* span) {
   ASSERT(span->location() != Span::IN_USE);
-  SpanListPair* list = (span->num_pages() < kMaxPages)
-                           ? &free_[span->num_pages().raw_num()]
-                           : &large_;
+  const bool small = span->num_pages() < kMaxPages;
+  SpanListPair* list = small ? &free_[span->num_pages().raw_num()] : &large_;
   if (span->location() == Span::ON_NORMAL_FREELIST) {
     stats_.free_bytes -= span->bytes_in_span();
-    list->normal.remove(span);
+    if (list->normal.remove(span) && small) {
+      normal_nonempty_.ClearBit(span->num_pages().raw_num());
+    }
   } else {
     stats_.unmapped_bytes -= span->bytes_in_span();
-    list->returned.remove(span);
+    if (list->returned.remove(span) && small) {
+      returned_nonempty_.ClearBit(span->num_pages().raw_num());
+    }
   }
 }
 
@@ -434,7 +482,8 @@ void PageHeap::GetLargeSpanStats(LargeSpanStats* result) {
 
 bool PageHeap::GrowHeap(Length n) {
   if (n > Length::max()) return false;
-  auto [ptr, actual_size] = SystemAlloc(n.in_bytes(), kPageSize, tag_);
+  auto [ptr, actual_size] =
+      SystemAlloc(n.in_bytes(), kPageSize, tag_, "page_heap");
   if (ptr == nullptr) return false;
   n = BytesToLengthFloor(actual_size);
 
@@ -472,6 +521,8 @@ bool PageHeap::GrowHeap(Length n) {
 bool PageHeap::Check() {
   ASSERT(free_[0].normal.empty());
   ASSERT(free_[0].returned.empty());
+  ASSERT(!normal_nonempty_.GetBit(0));
+  ASSERT(!returned_nonempty_.GetBit(0));
   return true;
 }
 
@@ -21,6 +21,7 @@
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/range_tracker.h"
 #include "tcmalloc/page_allocator_interface.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/span.h"
@@ -63,6 +64,13 @@ class PageHeap final : public PageAllocatorInterface {
   void Delete(Span* span, size_t objects_per_span)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override;
 
+  // Attempts to extend <span> in place to <new_len> pages by carving the
+  // needed pages off a free span immediately following it.
+  // REQUIRES: span was returned by earlier call to New() and
+  //           has not yet been deleted, and new_len > span->num_pages().
+  bool GrowSpanInPlace(Span* span, Length new_len)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override;
+
   inline BackingStats stats() const
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) override {
     return stats_;
@@ -104,6 +112,15 @@ class PageHeap final : public PageAllocatorInterface {
   // Array mapping from span length to a doubly linked list of free spans
   SpanListPair free_[kMaxPages.raw_num()] ABSL_GUARDED_BY(pageheap_lock);
 
+  // Occupancy bitmaps over free_, in the spirit of HintedTrackerLists: bit s
+  // is set while the corresponding list of free_[s] is non-empty, so
+  // SearchFreeAndLargeLists() finds the first usable length with a word scan
+  // instead of walking up to kMaxPages empty lists under the contended
+  // pageheap_lock.
+  Bitmap<kMaxPages.raw_num()> normal_nonempty_ ABSL_GUARDED_BY(pageheap_lock);
+  Bitmap<kMaxPages.raw_num()> returned_nonempty_
+      ABSL_GUARDED_BY(pageheap_lock);
+
   // Statistics on system, free, and unmapped bytes
   BackingStats stats_ ABSL_GUARDED_BY(pageheap_lock);
 
@@ -44,8 +44,16 @@ struct AllocatorStats {
 
 // Simple allocator for objects of a specified type.  External locking
 // is required before accessing one of these objects.
-template <class T>
+//
+// Objects are carved from the arena kBatch at a time and handed out in
+// ascending address order, so types whose consumers scan many objects (e.g.
+// Span structs walked by the central freelists) can be packed into
+// contiguous runs instead of being scattered across the arena as other
+// metadata allocations intervene.
+template <class T, size_t kBatch = 1>
 class PageHeapAllocator {
+  static_assert(kBatch >= 1, "batch must hold at least one object");
+
  public:
   constexpr PageHeapAllocator()
       : arena_(nullptr), free_list_(nullptr), stats_{0, 0} {}
@@ -65,9 +73,21 @@ class PageHeapAllocator {
     T* result = free_list_;
     stats_.in_use++;
     if (ABSL_PREDICT_FALSE(result == nullptr)) {
-      stats_.total++;
-      result = reinterpret_cast<T*>(
-          arena_->Alloc(sizeof(T), static_cast<std::align_val_t>(alignof(T))));
+      stats_.total += kBatch;
+      char* batch = reinterpret_cast<char*>(arena_->Alloc(
+          kBatch * sizeof(T), static_cast<std::align_val_t>(alignof(T))));
+      // Free-list the tail of the batch in reverse so that subsequent News
+      // return adjacent objects in ascending address order.
+      for (size_t i = kBatch - 1; i > 0; --i) {
+        T* obj = reinterpret_cast<T*>(batch + i * sizeof(T));
+        *(reinterpret_cast<T**>(obj)) = free_list_;
+#ifdef ABSL_HAVE_ADDRESS_SANITIZER
+        // Poison the object on the freelist, matching Delete().
+        ASAN_POISON_MEMORY_REGION(obj, sizeof(*obj));
+#endif
+        free_list_ = obj;
+      }
+      result = reinterpret_cast<T*>(batch);
       ABSL_ANNOTATE_MEMORY_IS_UNINITIALIZED(result, sizeof(*result));
       return result;
     } else {
@@ -108,6 +108,92 @@ TEST_F(PageHeapTest, Stats) {
   free(memory);
 }
 
+TEST_F(PageHeapTest, GrowSpanInPlace) {
+  auto pagemap = std::make_unique<PageMap>();
+  void* memory = calloc(1, sizeof(PageHeap));
+  PageHeap* ph = new (memory) PageHeap(pagemap.get(), MemoryTag::kNormal);
+  constexpr SpanAllocInfo kSpanAllocInfo = {10,
+                                            AccessDensityPrediction::kSparse};
+
+  static const Length kHalf = kMinSpanLength / 2;
+  Span* s1 = ph->New(kHalf, kSpanAllocInfo);
+  CheckStats(ph, kMinSpanLength, kHalf, Length(0));
+
+  // The rest of the system allocation is free and adjacent, so the span can
+  // grow in place.
+  bool grown;
+  {
+    PageHeapSpinLockHolder l;
+    grown = ph->GrowSpanInPlace(s1, kHalf + Length(1));
+  }
+  EXPECT_TRUE(grown);
+  EXPECT_EQ(s1->num_pages(), kHalf + Length(1));
+  CheckStats(ph, kMinSpanLength, kHalf - Length(1), Length(0));
+
+  // Growing past the free neighbor fails and leaves the span unchanged.
+  {
+    PageHeapSpinLockHolder l;
+    grown = ph->GrowSpanInPlace(s1, kMinSpanLength + Length(1));
+  }
+  EXPECT_FALSE(grown);
+  EXPECT_EQ(s1->num_pages(), kHalf + Length(1));
+
+  // Growing to consume the neighbor exactly succeeds.
+  {
+    PageHeapSpinLockHolder l;
+    grown = ph->GrowSpanInPlace(s1, kMinSpanLength);
+  }
+  EXPECT_TRUE(grown);
+  EXPECT_EQ(s1->num_pages(), kMinSpanLength);
+  CheckStats(ph, kMinSpanLength, Length(0), Length(0));
+
+  Delete(ph, s1, kSpanAllocInfo.objects_per_span);
+  CheckStats(ph, kMinSpanLength, kMinSpanLength, Length(0));
+
+  free(memory);
+}
+
+TEST_F(PageHeapTest, BestFitThroughOccupancyBitmaps) {
+  auto pagemap = std::make_unique<PageMap>();
+  void* memory = calloc(1, sizeof(PageHeap));
+  PageHeap* ph = new (memory) PageHeap(pagemap.get(), MemoryTag::kNormal);
+  constexpr SpanAllocInfo kSpanAllocInfo = {10,
+                                            AccessDensityPrediction::kSparse};
+
+  // Carve alternating live guards and to-be-freed spans out of one system
+  // chunk, so the freed spans cannot coalesce with each other.
+  Span* g1 = ph->New(Length(1), kSpanAllocInfo);
+  Span* f2 = ph->New(Length(2), kSpanAllocInfo);
+  Span* g2 = ph->New(Length(1), kSpanAllocInfo);
+  Span* f4 = ph->New(Length(4), kSpanAllocInfo);
+  Span* g3 = ph->New(Length(1), kSpanAllocInfo);
+  const PageId f2_first = f2->first_page();
+  const PageId f4_first = f4->first_page();
+
+  Delete(ph, f2, kSpanAllocInfo.objects_per_span);
+  Delete(ph, f4, kSpanAllocInfo.objects_per_span);
+
+  // An exact fit is preferred over the larger free span and the chunk's
+  // returned tail.
+  Span* a2 = ph->New(Length(2), kSpanAllocInfo);
+  ASSERT_NE(a2, nullptr);
+  EXPECT_EQ(a2->first_page(), f2_first);
+
+  // With the two-page list empty again, the next allocation carves the
+  // closest larger span, leaving its tail on the one-page list.
+  Span* a3 = ph->New(Length(3), kSpanAllocInfo);
+  ASSERT_NE(a3, nullptr);
+  EXPECT_EQ(a3->first_page(), f4_first);
+  Span* a1 = ph->New(Length(1), kSpanAllocInfo);
+  ASSERT_NE(a1, nullptr);
+  EXPECT_EQ(a1->first_page(), f4_first + Length(3));
+
+  for (Span* s : {g1, g2, g3, a2, a3, a1}) {
+    Delete(ph, s, kSpanAllocInfo.objects_per_span);
+  }
+  free(memory);
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
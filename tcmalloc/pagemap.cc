@@ -76,6 +76,17 @@ void* MetaDataAlloc(size_t bytes) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
   return tc_globals.arena().Alloc(bytes);
 }
 
+void* PageMapReserve(size_t bytes) {
+  // MAP_NORESERVE keeps untouched portions of the reservation free of commit
+  // charge; reads of never-written entries hit the shared zero page.
+  void* result = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (result == MAP_FAILED) {
+    return nullptr;
+  }
+  return result;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -29,17 +29,22 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <atomic>
 #include <optional>
 #include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/percpu.h"
 #include "tcmalloc/malloc_tracing_extension.h"
 #include "tcmalloc/pages.h"
+#include "tcmalloc/parameters.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/static_vars.h"
 
@@ -51,6 +56,16 @@ namespace tcmalloc_internal {
 typedef void* (*PagemapAllocator)(size_t);
 void* MetaDataAlloc(size_t bytes);
 
+// Reserves demand-paged, zero-initialized address space for the flat pagemap
+// arrays.  Untouched portions cost only address space, not memory.  Returns
+// nullptr on failure.
+void* PageMapReserve(size_t bytes);
+
+// Slack used by the EnsureBytesForPages() estimates below: every distinct
+// mapped region (one per memory tag and NUMA partition) can cut an interior
+// node boundary and cost one extra node per level.
+inline constexpr size_t kPageMapEnsureSlack = 16;
+
 template <int BITS, PagemapAllocator Allocator>
 class PageMap2 {
  private:
@@ -70,6 +85,12 @@ class PageMap2 {
   static constexpr size_t kLeafHugepages = kLeafCoveredBytes / kHugePageSize;
   static_assert(kLeafHugepages == 1 << kLeafHugeBits, "sanity");
   struct Leaf {
+    // The page-number prefix (k >> kLeafBits) shared by every page covered by
+    // this leaf.  Written once when the leaf is created and never modified,
+    // it lets the per-cpu leaf cache validate a cached pointer without
+    // consulting the root array.  It shares the leaf's first cache line with
+    // the start of the size class array.
+    uintptr_t prefix;
     // We keep parallel arrays indexed by page number.  One keeps the
     // size class; another span pointers; the last hugepage-related
     // information.  The size class information is kept segregated
@@ -80,13 +101,31 @@ class PageMap2 {
     void* hugepage[kLeafHugepages];
   };
 
+  // A small per-cpu, direct-mapped cache of recently used leaf nodes,
+  // consulted before the radix walk on the deallocation fast path.  Leaves
+  // are allocated once in Ensure() and never freed, so a cached pointer can
+  // never dangle, and the prefix stored in the leaf makes every entry
+  // self-validating: a stale or torn slot merely misses.
+  static constexpr int kLeafCacheSlots = 4;
+  // Cpus at or above kLeafCacheCpus share a cache with their low-order alias.
+  // Sharing only affects hit rates, never correctness.
+  static constexpr int kLeafCacheCpus = 256;
+  struct ABSL_CACHELINE_ALIGNED LeafCache {
+    constexpr LeafCache() : leaf{} {}
+
+    std::atomic<Leaf*> leaf[kLeafCacheSlots];
+    StatsCounter hits;
+    StatsCounter misses;
+  };
+
   Leaf* root_[kRootLength];  // Top-level node
   size_t bytes_used_;
+  LeafCache leaf_cache_[kLeafCacheCpus];
 
  public:
   typedef uintptr_t Number;
 
-  constexpr PageMap2() : root_{}, bytes_used_(0) {}
+  constexpr PageMap2() : root_{}, bytes_used_(0), leaf_cache_{} {}
 
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
   void* get(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
@@ -98,6 +137,39 @@ class PageMap2 {
     return root_[i1]->span[i2];
   }
 
+  // Batched get(): writes the covering span (or nullptr) and size class for
+  // each page number in keys.  Callers should sort keys so that consecutive
+  // keys covered by the same leaf share a single radix walk.  Pages tcmalloc
+  // never managed read as nullptr/0 rather than faulting.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void get_span_and_sizeclass_batch(const Number* keys, size_t n, void** spans,
+                                    CompactSizeClass* sizeclasses) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Leaf* leaf = nullptr;
+    Number cached_i1 = ~Number{0};
+    for (size_t i = 0; i < n; ++i) {
+      const Number k = keys[i];
+      const Number i1 = k >> kLeafBits;
+      const Number i2 = k & (kLeafLength - 1);
+      if ((k >> BITS) > 0) {
+        spans[i] = nullptr;
+        sizeclasses[i] = 0;
+        continue;
+      }
+      if (i1 != cached_i1) {
+        leaf = root_[i1];
+        cached_i1 = i1;
+      }
+      if (leaf == nullptr) {
+        spans[i] = nullptr;
+        sizeclasses[i] = 0;
+        continue;
+      }
+      spans[i] = leaf->span[i2];
+      sizeclasses[i] = leaf->sizeclass[i2];
+    }
+  }
+
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
   std::optional<Number> get_next_set_page(Number k) const {
     Number next_k = k + 1;
@@ -133,6 +205,40 @@ class PageMap2 {
     return root_[i1]->sizeclass[i2];
   }
 
+  // Like sizeclass(), but consults cpu's leaf cache before the radix walk and
+  // refills it on a miss.  REQUIRES: cpu >= 0.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  CompactSizeClass ABSL_ATTRIBUTE_ALWAYS_INLINE
+  sizeclass_cached(Number k, int cpu) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number i1 = k >> kLeafBits;
+    const Number i2 = k & (kLeafLength - 1);
+    ASSERT((k >> BITS) == 0);
+    ASSERT(cpu >= 0);
+    LeafCache& cache = leaf_cache_[cpu & (kLeafCacheCpus - 1)];
+    std::atomic<Leaf*>& slot = cache.leaf[i1 & (kLeafCacheSlots - 1)];
+    Leaf* leaf = slot.load(std::memory_order_relaxed);
+    if (ABSL_PREDICT_TRUE(leaf != nullptr && leaf->prefix == i1)) {
+      cache.hits.LossyAdd(1);
+      return leaf->sizeclass[i2];
+    }
+    leaf = root_[i1];
+    ASSERT(leaf != nullptr);
+    slot.store(leaf, std::memory_order_relaxed);
+    cache.misses.LossyAdd(1);
+    return leaf->sizeclass[i2];
+  }
+
+  // Sums the hit/miss counters of the per-cpu leaf caches.
+  void LeafCacheStats(size_t* hits, size_t* misses) const {
+    size_t h = 0, m = 0;
+    for (const LeafCache& cache : leaf_cache_) {
+      h += cache.hits.value();
+      m += cache.misses.value();
+    }
+    *hits = h;
+    *misses = m;
+  }
+
   void set(Number k, Span* s) {
     TC_ASSERT_EQ(k >> BITS, 0);
     const Number i1 = k >> kLeafBits;
@@ -165,6 +271,31 @@ class PageMap2 {
     return leaf->hugepage[i2 >> (kLeafBits - kLeafHugeBits)];
   }
 
+  // Like get_hugepage(), but returns nullptr for pages that were never
+  // Ensure()d instead of dereferencing a missing leaf, so it is safe for
+  // arbitrary addresses.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void* try_get_hugepage(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number i1 = k >> kLeafBits;
+    const Number i2 = k & (kLeafLength - 1);
+    if ((k >> BITS) > 0 || root_[i1] == nullptr) {
+      return nullptr;
+    }
+    return root_[i1]->hugepage[i2 >> (kLeafBits - kLeafHugeBits)];
+  }
+
+  // Like sizeclass(), but returns 0 for pages that were never Ensure()d, so
+  // it is safe for arbitrary addresses.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  CompactSizeClass try_sizeclass(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number i1 = k >> kLeafBits;
+    const Number i2 = k & (kLeafLength - 1);
+    if ((k >> BITS) > 0 || root_[i1] == nullptr) {
+      return 0;
+    }
+    return root_[i1]->sizeclass[i2];
+  }
+
   void set_hugepage(Number k, void* v) {
     TC_ASSERT_EQ(k >> BITS, 0);
     const Number i1 = k >> kLeafBits;
@@ -186,6 +317,7 @@ class PageMap2 {
         if (leaf == nullptr) return false;
         bytes_used_ += sizeof(Leaf);
         memset(leaf, 0, sizeof(*leaf));
+        leaf->prefix = i1;
         root_[i1] = leaf;
       }
 
@@ -195,6 +327,12 @@ class PageMap2 {
     return true;
   }
 
+  // Upper bound on the bytes Ensure() will request from Allocator to cover n
+  // pages of heap, however they are spread across mapped regions.
+  static constexpr size_t EnsureBytesForPages(size_t n) {
+    return (n / kLeafLength + kPageMapEnsureSlack) * sizeof(Leaf);
+  }
+
   size_t bytes_used() const {
     // Account for size of root node, etc.
     return bytes_used_ + sizeof(*this);
@@ -231,6 +369,12 @@ class PageMap3 {
   static constexpr size_t kLeafHugepages = kLeafCoveredBytes / kHugePageSize;
   static_assert(kLeafHugepages == 1 << kLeafHugeBits, "sanity");
   struct Leaf {
+    // The page-number prefix (k >> kLeafBits) shared by every page covered by
+    // this leaf.  Written once when the leaf is created and never modified,
+    // it lets the per-cpu leaf cache validate a cached pointer without
+    // walking the upper two levels.  It shares the leaf's first cache line
+    // with the start of the size class array.
+    uintptr_t prefix;
     // We keep parallel arrays indexed by page number.  One keeps the
     // size class; another span pointers; the last hugepage-related
     // information.  The size class information is kept segregated
@@ -246,13 +390,31 @@ class PageMap3 {
     Leaf* leafs[kMidLength];
   };
 
+  // A small per-cpu, direct-mapped cache of recently used leaf nodes,
+  // consulted before the radix walk on the deallocation fast path.  Leaves
+  // are allocated once in Ensure() and never freed, so a cached pointer can
+  // never dangle, and the prefix stored in the leaf makes every entry
+  // self-validating: a stale or torn slot merely misses.
+  static constexpr int kLeafCacheSlots = 4;
+  // Cpus at or above kLeafCacheCpus share a cache with their low-order alias.
+  // Sharing only affects hit rates, never correctness.
+  static constexpr int kLeafCacheCpus = 256;
+  struct ABSL_CACHELINE_ALIGNED LeafCache {
+    constexpr LeafCache() : leaf{} {}
+
+    std::atomic<Leaf*> leaf[kLeafCacheSlots];
+    StatsCounter hits;
+    StatsCounter misses;
+  };
+
   Node* root_[kRootLength];  // Top-level node
   size_t bytes_used_;
+  LeafCache leaf_cache_[kLeafCacheCpus];
 
  public:
   typedef uintptr_t Number;
 
-  constexpr PageMap3() : root_{}, bytes_used_(0) {}
+  constexpr PageMap3() : root_{}, bytes_used_(0), leaf_cache_{} {}
 
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
   void* get(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
@@ -266,6 +428,41 @@ class PageMap3 {
     return root_[i1]->leafs[i2]->span[i3];
   }
 
+  // Batched get(): writes the covering span (or nullptr) and size class for
+  // each page number in keys.  Callers should sort keys so that consecutive
+  // keys covered by the same leaf share a single radix walk.  Pages tcmalloc
+  // never managed read as nullptr/0 rather than faulting.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void get_span_and_sizeclass_batch(const Number* keys, size_t n, void** spans,
+                                    CompactSizeClass* sizeclasses) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Leaf* leaf = nullptr;
+    Number cached_prefix = ~Number{0};
+    for (size_t i = 0; i < n; ++i) {
+      const Number k = keys[i];
+      const Number prefix = k >> kLeafBits;
+      const Number i3 = k & (kLeafLength - 1);
+      if ((k >> BITS) > 0) {
+        spans[i] = nullptr;
+        sizeclasses[i] = 0;
+        continue;
+      }
+      if (prefix != cached_prefix) {
+        const Number i1 = k >> (kLeafBits + kMidBits);
+        const Number i2 = (k >> kLeafBits) & (kMidLength - 1);
+        leaf = root_[i1] != nullptr ? root_[i1]->leafs[i2] : nullptr;
+        cached_prefix = prefix;
+      }
+      if (leaf == nullptr) {
+        spans[i] = nullptr;
+        sizeclasses[i] = 0;
+        continue;
+      }
+      spans[i] = leaf->span[i3];
+      sizeclasses[i] = leaf->sizeclass[i3];
+    }
+  }
+
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
   std::optional<Number> get_next_set_page(Number k) const {
     Number next_k = k + 1;
@@ -310,6 +507,43 @@ class PageMap3 {
     return root_[i1]->leafs[i2]->sizeclass[i3];
   }
 
+  // Like sizeclass(), but consults cpu's leaf cache before the radix walk and
+  // refills it on a miss.  REQUIRES: cpu >= 0.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  CompactSizeClass ABSL_ATTRIBUTE_ALWAYS_INLINE
+  sizeclass_cached(Number k, int cpu) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number prefix = k >> kLeafBits;
+    const Number i3 = k & (kLeafLength - 1);
+    ASSERT((k >> BITS) == 0);
+    ASSERT(cpu >= 0);
+    LeafCache& cache = leaf_cache_[cpu & (kLeafCacheCpus - 1)];
+    std::atomic<Leaf*>& slot = cache.leaf[prefix & (kLeafCacheSlots - 1)];
+    Leaf* leaf = slot.load(std::memory_order_relaxed);
+    if (ABSL_PREDICT_TRUE(leaf != nullptr && leaf->prefix == prefix)) {
+      cache.hits.LossyAdd(1);
+      return leaf->sizeclass[i3];
+    }
+    const Number i1 = k >> (kLeafBits + kMidBits);
+    const Number i2 = (k >> kLeafBits) & (kMidLength - 1);
+    ASSERT(root_[i1] != nullptr);
+    leaf = root_[i1]->leafs[i2];
+    ASSERT(leaf != nullptr);
+    slot.store(leaf, std::memory_order_relaxed);
+    cache.misses.LossyAdd(1);
+    return leaf->sizeclass[i3];
+  }
+
+  // Sums the hit/miss counters of the per-cpu leaf caches.
+  void LeafCacheStats(size_t* hits, size_t* misses) const {
+    size_t h = 0, m = 0;
+    for (const LeafCache& cache : leaf_cache_) {
+      h += cache.hits.value();
+      m += cache.misses.value();
+    }
+    *hits = h;
+    *misses = m;
+  }
+
   void set(Number k, Span* s) {
     TC_ASSERT_EQ(k >> BITS, 0);
     const Number i1 = k >> (kLeafBits + kMidBits);
@@ -348,6 +582,41 @@ class PageMap3 {
     return leaf->hugepage[i3 >> (kLeafBits - kLeafHugeBits)];
   }
 
+  // Like get_hugepage(), but returns nullptr for pages that were never
+  // Ensure()d instead of dereferencing a missing node, so it is safe for
+  // arbitrary addresses.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void* try_get_hugepage(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number i1 = k >> (kLeafBits + kMidBits);
+    const Number i2 = (k >> kLeafBits) & (kMidLength - 1);
+    const Number i3 = k & (kLeafLength - 1);
+    if ((k >> BITS) > 0 || root_[i1] == nullptr) {
+      return nullptr;
+    }
+    const Leaf* leaf = root_[i1]->leafs[i2];
+    if (leaf == nullptr) {
+      return nullptr;
+    }
+    return leaf->hugepage[i3 >> (kLeafBits - kLeafHugeBits)];
+  }
+
+  // Like sizeclass(), but returns 0 for pages that were never Ensure()d, so
+  // it is safe for arbitrary addresses.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  CompactSizeClass try_sizeclass(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    const Number i1 = k >> (kLeafBits + kMidBits);
+    const Number i2 = (k >> kLeafBits) & (kMidLength - 1);
+    const Number i3 = k & (kLeafLength - 1);
+    if ((k >> BITS) > 0 || root_[i1] == nullptr) {
+      return 0;
+    }
+    const Leaf* leaf = root_[i1]->leafs[i2];
+    if (leaf == nullptr) {
+      return 0;
+    }
+    return leaf->sizeclass[i3];
+  }
+
   void set_hugepage(Number k, void* v) {
     TC_ASSERT_EQ(k >> BITS, 0);
     const Number i1 = k >> (kLeafBits + kMidBits);
@@ -379,6 +648,7 @@ class PageMap3 {
         if (leaf == nullptr) return false;
         bytes_used_ += sizeof(Leaf);
         memset(leaf, 0, sizeof(*leaf));
+        leaf->prefix = key >> kLeafBits;
         root_[i1]->leafs[i2] = leaf;
       }
 
@@ -388,12 +658,245 @@ class PageMap3 {
     return true;
   }
 
+  // Upper bound on the bytes Ensure() will request from Allocator to cover n
+  // pages of heap, however they are spread across mapped regions.
+  static constexpr size_t EnsureBytesForPages(size_t n) {
+    return (n / kLeafLength + kPageMapEnsureSlack) * sizeof(Leaf) +
+           (n / (static_cast<size_t>(kLeafLength) * kMidLength) +
+            kPageMapEnsureSlack) *
+               sizeof(Node);
+  }
+
   size_t bytes_used() const { return bytes_used_ + sizeof(*this); }
 
   constexpr size_t RootSize() const { return sizeof(root_); }
   const void* RootAddress() { return root_; }
 };
 
+// Flat array pagemap
+//
+// An alternative to the radix trees above for deployments that confine the
+// heap to a modest span of address space (e.g. via SystemAlloc's address hint
+// machinery): every kind of metadata lives in one array indexed directly by
+// page number, so a lookup is a single load with no radix walk and no
+// dependent misses.  The arrays are reserved lazily on the first Ensure()
+// with PageMapReserve(); chunks that are never touched cost only address
+// space.  Select with TCMALLOC_USE_PAGEMAP_FLAT, optionally bounding the
+// covered range with TCMALLOC_FLAT_PAGEMAP_ADDRESS_BITS; Ensure() fails for
+// pages beyond the covered range, just as the radix maps fail on root
+// overflow.
+template <int BITS>
+class PageMapFlat {
+ private:
+  // Ensure() bookkeeping is kept at the granularity of the radix leaves:
+  // 2^15 pages per chunk.  The chunk table also lets get_next_set_page()
+  // skip address space that was never ensured.
+  static constexpr int kChunkBits = 15;
+  static_assert(BITS >= kChunkBits, "flat pagemap covers too little");
+  static constexpr uintptr_t kLength = uintptr_t{1} << BITS;
+  static constexpr uintptr_t kChunkLength = uintptr_t{1} << kChunkBits;
+  static constexpr uintptr_t kChunks = kLength >> kChunkBits;
+
+  static constexpr size_t kHugeShift = kHugePageShift - kPageShift;
+  static constexpr uintptr_t kHugeLength = kLength >> kHugeShift;
+
+  static constexpr size_t kSpanBytes = kLength * sizeof(Span*);
+  static constexpr size_t kSizeClassBytes = kLength * sizeof(CompactSizeClass);
+  static constexpr size_t kHugepageBytes = kHugeLength * sizeof(void*);
+
+  // Parallel arrays indexed by page number, carved out of a single
+  // reservation; see Ensure().  The size class information is kept segregated
+  // since small object deallocations are so frequent and do not need the
+  // other information kept in a Span.
+  Span** span_;
+  CompactSizeClass* sizeclass_;
+  void** hugepage_;
+  // Nonzero for chunks that have been Ensure()d; see kChunkBits.
+  uint8_t ensured_[kChunks];
+  size_t bytes_used_;
+
+ public:
+  typedef uintptr_t Number;
+
+  constexpr PageMapFlat()
+      : span_(nullptr),
+        sizeclass_(nullptr),
+        hugepage_(nullptr),
+        ensured_{},
+        bytes_used_(0) {}
+
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void* get(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    if ((k >> BITS) > 0 || span_ == nullptr) {
+      return nullptr;
+    }
+    // Entries that were never set read as nullptr from the zero-filled
+    // reservation.
+    return span_[k];
+  }
+
+  // Batched get(): writes the covering span (or nullptr) and size class for
+  // each page number in keys.  The flat lookup has no radix levels to
+  // amortize; this exists for interface parity with the radix maps.  Pages
+  // tcmalloc never managed read as nullptr/0 rather than faulting.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void get_span_and_sizeclass_batch(const Number* keys, size_t n, void** spans,
+                                    CompactSizeClass* sizeclasses) const
+      ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    for (size_t i = 0; i < n; ++i) {
+      const Number k = keys[i];
+      if ((k >> BITS) > 0 || span_ == nullptr) {
+        spans[i] = nullptr;
+        sizeclasses[i] = 0;
+        continue;
+      }
+      spans[i] = span_[k];
+      sizeclasses[i] = sizeclass_[k];
+    }
+  }
+
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  std::optional<Number> get_next_set_page(Number k) const {
+    if (span_ == nullptr) return std::nullopt;
+    Number next_k = k + 1;
+    Number i1 = next_k >> kChunkBits;
+    Number i2 = next_k & (kChunkLength - 1);
+    for (; i1 < kChunks; ++i1, i2 = 0) {
+      if (!ensured_[i1]) continue;
+      for (; i2 < kChunkLength; ++i2) {
+        const Number index = (i1 << kChunkBits) | i2;
+        if (span_[index] != nullptr) return index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  // Requires that the span is known to already exist.
+  Span* get_existing(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ASSERT((k >> BITS) == 0);
+    ASSERT(span_ != nullptr);
+    return span_[k];
+  }
+
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  // REQUIRES: Must be a valid page number previously Ensure()d.
+  CompactSizeClass ABSL_ATTRIBUTE_ALWAYS_INLINE
+  sizeclass(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ASSERT((k >> BITS) == 0);
+    ASSERT(sizeclass_ != nullptr);
+    return sizeclass_[k];
+  }
+
+  // The flat lookup is already a single load, so there is no leaf cache;
+  // these exist for interface parity with the radix maps.
+  CompactSizeClass ABSL_ATTRIBUTE_ALWAYS_INLINE
+  sizeclass_cached(Number k, int cpu) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    return sizeclass(k);
+  }
+
+  void LeafCacheStats(size_t* hits, size_t* misses) const {
+    *hits = 0;
+    *misses = 0;
+  }
+
+  void set(Number k, Span* s) {
+    TC_ASSERT_EQ(k >> BITS, 0);
+    span_[k] = s;
+  }
+
+  void set_with_sizeclass(Number k, Span* s, CompactSizeClass sc) {
+    TC_ASSERT_EQ(k >> BITS, 0);
+    span_[k] = s;
+    sizeclass_[k] = sc;
+  }
+
+  void clear_sizeclass(Number k) {
+    TC_ASSERT_EQ(k >> BITS, 0);
+    sizeclass_[k] = 0;
+  }
+
+  void* get_hugepage(Number k) {
+    TC_ASSERT_EQ(k >> BITS, 0);
+    TC_ASSERT_NE(hugepage_, nullptr);
+    return hugepage_[k >> kHugeShift];
+  }
+
+  // Like get_hugepage(), but safe for arbitrary addresses; unset entries
+  // read as nullptr from the zero-filled reservation.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void* try_get_hugepage(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    if ((k >> BITS) > 0 || hugepage_ == nullptr) {
+      return nullptr;
+    }
+    return hugepage_[k >> kHugeShift];
+  }
+
+  // Like sizeclass(), but safe for arbitrary addresses; unset entries read
+  // as 0 from the zero-filled reservation.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  CompactSizeClass try_sizeclass(Number k) const ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    if ((k >> BITS) > 0 || sizeclass_ == nullptr) {
+      return 0;
+    }
+    return sizeclass_[k];
+  }
+
+  void set_hugepage(Number k, void* v) {
+    TC_ASSERT_EQ(k >> BITS, 0);
+    hugepage_[k >> kHugeShift] = v;
+  }
+
+  bool Ensure(Number start, size_t n) {
+    TC_ASSERT_GT(n, 0);
+    const Number last = start + n - 1;
+
+    // Check that the range fits the configured span of address space.
+    if (last >= kLength || last < start) return false;
+
+    if (span_ == nullptr) {
+      // One reservation holds all three arrays; the span array leads so the
+      // later partitions stay pointer-aligned (kLength is a multiple of 8).
+      char* reservation = reinterpret_cast<char*>(
+          PageMapReserve(kSpanBytes + kSizeClassBytes + kHugepageBytes));
+      if (reservation == nullptr) return false;
+      span_ = reinterpret_cast<Span**>(reservation);
+      sizeclass_ = reinterpret_cast<CompactSizeClass*>(reservation +
+                                                       kSpanBytes);
+      hugepage_ = reinterpret_cast<void**>(reservation + kSpanBytes +
+                                           kSizeClassBytes);
+    }
+
+    for (Number key = start; key <= last;) {
+      const Number i1 = key >> kChunkBits;
+      if (!ensured_[i1]) {
+        ensured_[i1] = 1;
+        // Account for the metadata this chunk will fault in once touched.
+        bytes_used_ +=
+            kChunkLength * (sizeof(Span*) + sizeof(CompactSizeClass)) +
+            (kChunkLength >> kHugeShift) * sizeof(void*);
+      }
+
+      // Advance key past whatever is covered by this chunk
+      key = ((key >> kChunkBits) + 1) << kChunkBits;
+    }
+    return true;
+  }
+
+  // The flat map carves chunks from its own demand-paged reservation, not
+  // the metadata arena, so Ensure() consumes no arena bytes.
+  static constexpr size_t EnsureBytesForPages(size_t) { return 0; }
+
+  size_t bytes_used() const {
+    // The reservation is demand-paged; report the chunks Ensure() has handed
+    // out, which bounds what can have been faulted in.
+    return bytes_used_ + sizeof(*this);
+  }
+
+  constexpr size_t RootSize() const { return sizeof(ensured_); }
+  const void* RootAddress() { return ensured_; }
+};
+
 class PageMap {
  public:
   constexpr PageMap() : map_{} {}
@@ -402,18 +905,46 @@ class PageMap {
   // or is a page containing large objects.
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
   //
+  // An in-band alternative -- a class tag stored inside each tiny-object
+  // page, located by address arithmetic alone -- was evaluated and rejected:
+  // nothing in an address distinguishes a page carrying a tag from one whose
+  // first bytes are another class's (or a large object's) user data, and the
+  // address bits above kTagShift that could carve out a dedicated region are
+  // spoken for.  The leaf cache below (and the flat pagemap) get the lookup
+  // down to one or two loads with no layout change; pagemap_benchmark.cc
+  // measures these variants.
+  //
   // TODO(b/193887621): Convert to atomics to permit the PageMap to run cleanly
   // under TSan.
   CompactSizeClass sizeclass(PageId p) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    if (Parameters::pagemap_leaf_cache()) {
+      const int cpu = subtle::percpu::RseqCpuId();
+      if (ABSL_PREDICT_TRUE(cpu >= 0)) {
+        return map_.sizeclass_cached(p.index(), cpu);
+      }
+    }
     return map_.sizeclass(p.index());
   }
 
+  // Sums the hit/miss counters of the per-cpu leaf caches maintained by
+  // sizeclass().  Both stay zero unless Parameters::pagemap_leaf_cache() has
+  // been enabled.
+  void LeafCacheStats(size_t* hits, size_t* misses) const {
+    map_.LeafCacheStats(hits, misses);
+  }
+
   void Set(PageId p, Span* span) { map_.set(p.index(), span); }
 
   bool Ensure(PageId p, Length n) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
     return map_.Ensure(p.index(), n.raw_num());
   }
 
+  // Upper bound on the metadata-arena bytes Ensure() will consume to cover n
+  // pages of heap; see MallocExtension::ReserveHeapMetadata.
+  static constexpr size_t EnsureBytesForPages(Length n) {
+    return decltype(map_)::EnsureBytesForPages(n.raw_num());
+  }
+
   // Mark an allocated span as being used for small objects of the
   // specified size-class.
   // REQUIRES: span was returned by an earlier call to PageAllocator::New()
@@ -434,6 +965,16 @@ class PageMap {
     return reinterpret_cast<Span*>(map_.get(p.index()));
   }
 
+  // Batched GetDescriptor()+sizeclass() over arbitrary page numbers: fills
+  // spans[i]/sizeclasses[i] for each pages[i], writing nullptr/0 for pages
+  // tcmalloc never managed.  Callers should sort pages so consecutive entries
+  // covered by the same pagemap leaf share one radix walk.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void GetSpanAndSizeClassBatch(const uintptr_t* pages, size_t n, void** spans,
+                                CompactSizeClass* sizeclasses) const {
+    map_.get_span_and_sizeclass_batch(pages, n, spans, sizeclasses);
+  }
+
   // Return the descriptor for the specified page.
   // PageId must have been previously allocated.
   // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
@@ -450,8 +991,35 @@ class PageMap {
 
   void* GetHugepage(PageId p) { return map_.get_hugepage(p.index()); }
 
+  // Like GetHugepage()/sizeclass(), but safe for addresses tcmalloc has
+  // never managed: pages without pagemap nodes read as nullptr/0 rather than
+  // faulting.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  void* TryGetHugepage(PageId p) const {
+    return map_.try_get_hugepage(p.index());
+  }
+
+  CompactSizeClass TrySizeclass(PageId p) const {
+    return map_.try_sizeclass(p.index());
+  }
+
   void SetHugepage(PageId p, void* v) { map_.set_hugepage(p.index(), v); }
 
+  // Returns the next page at or after p that has a Span set, or std::nullopt
+  // when no such page exists.
+  // No locks required.  See SYNCHRONIZATION explanation at top of tcmalloc.cc.
+  std::optional<PageId> NextSetPage(PageId p) const {
+    // get_next_set_page() searches strictly after its argument.
+    if (GetDescriptor(p) != nullptr) {
+      return p;
+    }
+    const std::optional<uintptr_t> next = map_.get_next_set_page(p.index());
+    if (!next.has_value()) {
+      return std::nullopt;
+    }
+    return PageId{*next};
+  }
+
   // The PageMap root node can be quite large and sparsely used. If this
   // gets mapped with hugepages we potentially end up holding a large
   // amount of unused memory. So it is better to map the root node with
@@ -496,7 +1064,16 @@ class PageMap {
   }
 
  private:
-#ifdef TCMALLOC_USE_PAGEMAP3
+#if defined(TCMALLOC_USE_PAGEMAP_FLAT)
+// TCMALLOC_FLAT_PAGEMAP_ADDRESS_BITS bounds the span of address space the
+// flat map covers; it defaults to the full usable address space, which makes
+// the reservation large but purely virtual.
+#ifdef TCMALLOC_FLAT_PAGEMAP_ADDRESS_BITS
+  PageMapFlat<TCMALLOC_FLAT_PAGEMAP_ADDRESS_BITS - kPageShift> map_;
+#else
+  PageMapFlat<kAddressBits - kPageShift> map_;
+#endif
+#elif defined(TCMALLOC_USE_PAGEMAP3)
   PageMap3<kAddressBits - kPageShift, MetaDataAlloc> map_;
 #else
   PageMap2<kAddressBits - kPageShift, MetaDataAlloc> map_;
@@ -0,0 +1,83 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/static_vars.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Measures the deallocation-path size class lookup in isolation: the bare
+// radix walk against the per-cpu leaf cache front end, over working sets
+// ranging from one hot page to more memory than a leaf covers.  These are
+// the golden variants to beat when evaluating alternative class-lookup
+// schemes for tiny objects.
+void BM_SizeClassLookup(benchmark::State& state, bool leaf_cache) {
+  const size_t num_pages = state.range(0);
+  std::vector<void*> objects;
+  objects.reserve(num_pages);
+  std::vector<PageId> pages;
+  pages.reserve(num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    // One page-sized object per page, so the lookups below touch num_pages
+    // distinct pagemap entries.
+    objects.push_back(::operator new(kPageSize));
+    pages.push_back(PageIdContaining(objects.back()));
+  }
+  // Shuffle so the lookup order does not stride linearly through the
+  // sizeclass arrays.
+  absl::BitGen rnd;
+  absl::c_shuffle(pages, rnd);
+
+  const bool old_leaf_cache = Parameters::pagemap_leaf_cache();
+  Parameters::set_pagemap_leaf_cache(leaf_cache);
+  int64_t items_processed = 0;
+  while (state.KeepRunningBatch(pages.size())) {
+    for (const PageId p : pages) {
+      benchmark::DoNotOptimize(tc_globals.pagemap().sizeclass(p));
+    }
+    items_processed += pages.size();
+  }
+  Parameters::set_pagemap_leaf_cache(old_leaf_cache);
+  state.SetItemsProcessed(items_processed);
+
+  for (void* object : objects) {
+    ::operator delete(object);
+  }
+}
+
+void BM_SizeClassLookupWalk(benchmark::State& state) {
+  BM_SizeClassLookup(state, /*leaf_cache=*/false);
+}
+
+void BM_SizeClassLookupLeafCache(benchmark::State& state) {
+  BM_SizeClassLookup(state, /*leaf_cache=*/true);
+}
+
+BENCHMARK(BM_SizeClassLookupWalk)->Range(1, 8192);
+BENCHMARK(BM_SizeClassLookupLeafCache)->Range(1, 8192);
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -109,6 +109,27 @@ TEST_P(PageMapTest, Bulk) {
   }
 }
 
+TEST_P(PageMapTest, CachedSizeClass) {
+  const intptr_t limit = GetParam();
+
+  map->Ensure(0, limit);
+  for (intptr_t i = 0; i < limit; i++) {
+    map->set_with_sizeclass(i, span(i), sc(i));
+  }
+  // The cached lookup must agree with the plain radix walk both while it is
+  // filling a cpu's cache (misses) and once the cache is warm (hits).
+  for (int cpu : {0, 1}) {
+    for (intptr_t i = 0; i < limit; i++) {
+      ASSERT_EQ(map->sizeclass_cached(i, cpu), sc(i));
+    }
+  }
+  size_t hits, misses;
+  map->LeafCacheStats(&hits, &misses);
+  EXPECT_GT(hits, 0);
+  EXPECT_GT(misses, 0);
+  EXPECT_EQ(hits + misses, 2 * static_cast<size_t>(limit));
+}
+
 TEST_P(PageMapTest, Overflow) {
   const intptr_t kLimit = 1 << 20;
   ASSERT_FALSE(map->Ensure(kLimit, kLimit + 1));
@@ -135,6 +156,83 @@ TEST_P(PageMapTest, RandomAccess) {
 
 INSTANTIATE_TEST_SUITE_P(Limits, PageMapTest, ::testing::Values(100, 1 << 20));
 
+class PageMapFlatTest : public ::testing::TestWithParam<int> {
+ public:
+  PageMapFlatTest() {
+    memset(storage, 0, sizeof(Map));
+    map = new (storage) Map();
+  }
+
+  // The reservation made by the first Ensure() is leaked when the test ends,
+  // like the radix maps leak their leaves.
+  using Map = PageMapFlat<20>;
+  Map* map;
+
+ private:
+  alignas(Map) char storage[sizeof(Map)];
+};
+
+TEST_P(PageMapFlatTest, Sequential) {
+  const intptr_t limit = GetParam();
+
+  for (intptr_t i = 0; i < limit; i++) {
+    map->Ensure(i, 1);
+    map->set(i, span(i));
+    ASSERT_EQ(map->get(i), span(i));
+
+    ASSERT_EQ(0, map->sizeclass(i));
+    map->set_with_sizeclass(i, span(i), sc(i));
+    ASSERT_EQ(sc(i), map->sizeclass(i));
+    ASSERT_EQ(sc(i), map->sizeclass_cached(i, 0));
+  }
+  for (intptr_t i = 0; i < limit; i++) {
+    ASSERT_EQ(map->get(i), span(i));
+  }
+}
+
+TEST_P(PageMapFlatTest, Bulk) {
+  const intptr_t limit = GetParam();
+
+  ASSERT_TRUE(map->Ensure(0, limit));
+  for (intptr_t i = 0; i < limit; i++) {
+    map->set(i, span(i));
+    ASSERT_EQ(map->get(i), span(i));
+  }
+  for (intptr_t i = 0; i < limit; i++) {
+    ASSERT_EQ(map->get(i), span(i));
+  }
+}
+
+TEST_P(PageMapFlatTest, Overflow) {
+  const intptr_t kLimit = 1 << 20;
+  ASSERT_FALSE(map->Ensure(kLimit, kLimit + 1));
+}
+
+TEST_P(PageMapFlatTest, NextSetPage) {
+  // Before any Ensure(), nothing is set.
+  EXPECT_EQ(map->get(0), nullptr);
+  EXPECT_FALSE(map->get_next_set_page(0).has_value());
+
+  // Set two entries in distant chunks and walk between them.
+  const intptr_t first = 100;
+  const intptr_t second = (1 << 19) + 7;
+  ASSERT_TRUE(map->Ensure(first, 1));
+  ASSERT_TRUE(map->Ensure(second, 1));
+  map->set(first, span(first));
+  map->set(second, span(second));
+
+  auto next = map->get_next_set_page(0);
+  ASSERT_TRUE(next.has_value());
+  EXPECT_EQ(*next, first);
+  next = map->get_next_set_page(first);
+  ASSERT_TRUE(next.has_value());
+  EXPECT_EQ(*next, second);
+  EXPECT_FALSE(map->get_next_set_page(second).has_value());
+}
+
+INSTANTIATE_TEST_SUITE_P(Limits, PageMapFlatTest,
+                         ::testing::Values(100, 1 << 20));
+
 // Surround pagemap with unused memory. This isolates it so that it does not
 // share pages with any other structures. This avoids the risk that adjacent
 // objects might cause it to be mapped in. The padding is of sufficient size
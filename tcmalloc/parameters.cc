@@ -13,15 +13,20 @@
 // limitations under the License.
 #include "tcmalloc/parameters.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <string>
 
 #include "absl/base/attributes.h"
 #include "absl/base/call_once.h"
 #include "absl/base/const_init.h"
 #include "absl/base/internal/spinlock.h"
+#include "absl/base/macros.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/cpu_cache.h"
@@ -78,6 +83,46 @@ static std::atomic<int64_t>& background_process_sleep_interval_ns() {
   return v;
 }
 
+// As cpu_cache_reclaim_idle_interval_ns() is determined at runtime, we cannot
+// require constant initialization for the atomic.  This avoids an
+// initialization order fiasco.
+static std::atomic<int64_t>& cpu_cache_reclaim_idle_interval_ns() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    v.store(absl::ToInt64Nanoseconds(absl::Seconds(30)),
+            std::memory_order_relaxed);
+  });
+  return v;
+}
+
+// As cpu_cache_decay_interval_ns() is determined at runtime, we cannot
+// require constant initialization for the atomic.  This avoids an
+// initialization order fiasco.
+static std::atomic<int64_t>& cpu_cache_decay_interval_ns() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    v.store(absl::ToInt64Nanoseconds(absl::Seconds(30)),
+            std::memory_order_relaxed);
+  });
+  return v;
+}
+
+// Zero (predictive growth disabled) is the default, but the function-local
+// static keeps this safe against initialization order, like its neighbors.
+static std::atomic<int64_t>& cpu_cache_predictive_grow_interval_ns() {
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  return v;
+}
+
+// Zero (bounded-wait allocation disabled) is the default; function-local for
+// the same initialization-order reason as its neighbors.
+static std::atomic<int64_t>& pageheap_lock_wait_budget_ns() {
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  return v;
+}
+
 // As skip_subrelease_interval_ns(), skip_subrelease_short_interval_ns(), and
 // skip_subrelease_long_interval_ns() are determined at runtime, we cannot
 // require constant initialization for the atomic.  This avoids an
@@ -133,6 +178,46 @@ static std::atomic<int64_t>& skip_subrelease_long_interval_ns() {
   return v;
 }
 
+// Demand-based release intervals for the huge cache tier, consulted only
+// when huge_cache_demand_based_release is enabled.  They default to shorter
+// windows than the filler's: the cache holds whole idle hugepages, which are
+// cheaper to re-back than a broken-up filler page.
+static std::atomic<int64_t>& cache_demand_release_short_interval_ns() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    // clang-format off
+    v.store(absl::ToInt64Nanoseconds(
+#if defined(TCMALLOC_INTERNAL_SMALL_BUT_SLOW)
+                absl::ZeroDuration()
+#else
+                absl::Seconds(10)
+#endif
+                    ),
+            std::memory_order_relaxed);
+    // clang-format on
+  });
+  return v;
+}
+
+static std::atomic<int64_t>& cache_demand_release_long_interval_ns() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  ABSL_CONST_INIT static std::atomic<int64_t> v{0};
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    // clang-format off
+    v.store(absl::ToInt64Nanoseconds(
+#if defined(TCMALLOC_INTERNAL_SMALL_BUT_SLOW)
+                absl::ZeroDuration()
+#else
+                absl::Seconds(120)
+#endif
+                    ),
+            std::memory_order_relaxed);
+    // clang-format on
+  });
+  return v;
+}
+
 uint64_t Parameters::heap_size_hard_limit() {
   return tc_globals.page_allocator().limit(PageAllocator::kHard);
 }
@@ -171,12 +256,16 @@ ABSL_CONST_INIT std::atomic<MallocExtension::BytesPerSecond>
 
 ABSL_CONST_INIT std::atomic<int64_t> Parameters::guarded_sampling_rate_(
     50 * kDefaultProfileSamplingRate);
+ABSL_CONST_INIT std::atomic<double>
+    Parameters::guarded_sampling_overhead_fraction_(0.0);
 // TODO(b/285379004):  Remove this opt-out.
 ABSL_CONST_INIT std::atomic<bool> Parameters::release_partial_alloc_pages_(
     true);
 // TODO(b/328440160):  Remove this opt-out.
 ABSL_CONST_INIT std::atomic<bool> Parameters::huge_region_demand_based_release_(
     false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::huge_cache_demand_based_release_(
+    false);
 // TODO(b/199203282):  Remove this opt-out.
 ABSL_CONST_INIT std::atomic<bool> Parameters::release_pages_from_huge_region_(
     true);
@@ -193,16 +282,64 @@ ABSL_CONST_INIT std::atomic<bool> Parameters::per_cpu_caches_enabled_(
 );
 ABSL_CONST_INIT std::atomic<bool> Parameters::per_cpu_caches_dynamic_slab_(
     true);
+ABSL_CONST_INIT std::atomic<bool> Parameters::hardened_free_checks_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::madvise_cold_regions_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::numa_rehome_enabled_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::thp_aware_region_bias_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::sort_transfer_cache_batches_(
+    false);
 ABSL_CONST_INIT std::atomic<bool> Parameters::madvise_free_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::madvise_free_lazy_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::page_idle_scan_enabled_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::latency_profiling_enabled_(false);
+ABSL_CONST_INIT std::atomic<int64_t> Parameters::signal_safe_pool_bytes_(
+    4 * 1024);
+ABSL_CONST_INIT std::atomic<bool> Parameters::lifetime_prediction_enabled_(
+    false);
 ABSL_CONST_INIT std::atomic<tcmalloc::hot_cold_t>
     Parameters::min_hot_access_hint_(static_cast<tcmalloc::hot_cold_t>(128));
 ABSL_CONST_INIT std::atomic<double>
     Parameters::per_cpu_caches_dynamic_slab_grow_threshold_(0.9);
 ABSL_CONST_INIT std::atomic<double>
     Parameters::per_cpu_caches_dynamic_slab_shrink_threshold_(0.4);
+ABSL_CONST_INIT std::atomic<int64_t>
+    Parameters::per_cpu_caches_dynamic_slab_hysteresis_intervals_(1);
+ABSL_CONST_INIT std::atomic<bool> Parameters::per_cpu_caches_eager_slab_init_(
+    false);
+ABSL_CONST_INIT std::atomic<int64_t>
+    Parameters::per_cpu_caches_pop_prefetch_min_object_size_(-1);
+ABSL_CONST_INIT std::atomic<bool> Parameters::sharded_transfer_cache_numa_aware_(
+    false);
+ABSL_CONST_INIT std::atomic<bool>
+    Parameters::per_cpu_caches_steal_objects_from_siblings_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::per_cpu_caches_huge_page_slabs_(
+    false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::lock_free_central_freelist_(
+    false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::release_inaccessible_cpu_memory_(
+    false);
+ABSL_CONST_INIT std::atomic<int64_t> Parameters::cpu_cache_decay_miss_floor_(
+    0);
+ABSL_CONST_INIT std::atomic<int64_t>
+    Parameters::fragmentation_alarm_threshold_bytes_(0);
+ABSL_CONST_INIT std::atomic<double> Parameters::allocation_anomaly_factor_(0);
+ABSL_CONST_INIT std::atomic<bool> Parameters::pagemap_leaf_cache_(false);
+ABSL_CONST_INIT std::atomic<bool> Parameters::transfer_cache_miss_history_(
+    false);
+ABSL_CONST_INIT std::atomic<int32_t> Parameters::transfer_cache_capacity_scale_(
+    1);
+ABSL_CONST_INIT std::atomic<int64_t> Parameters::deferred_free_threshold_(0);
+ABSL_CONST_INIT std::atomic<int64_t>
+    Parameters::sized_delete_mismatch_check_interval_(0);
+ABSL_CONST_INIT std::atomic<bool> Parameters::large_span_cache_enabled_(false);
+ABSL_CONST_INIT std::atomic<double>
+    Parameters::memory_pressure_avg10_threshold_(0);
+ABSL_CONST_INIT std::atomic<bool> Parameters::unified_eviction_planner_(false);
 
 ABSL_CONST_INIT std::atomic<int64_t> Parameters::profile_sampling_rate_(
     kDefaultProfileSamplingRate);
+ABSL_CONST_INIT std::atomic<double> Parameters::target_profile_samples_per_sec_(
+    0.);
 
 bool Parameters::background_process_actions_enabled() {
   return background_process_actions_enabled_ptr().load(
@@ -214,6 +351,26 @@ absl::Duration Parameters::background_process_sleep_interval() {
       background_process_sleep_interval_ns().load(std::memory_order_relaxed));
 }
 
+absl::Duration Parameters::cpu_cache_reclaim_idle_interval() {
+  return absl::Nanoseconds(
+      cpu_cache_reclaim_idle_interval_ns().load(std::memory_order_relaxed));
+}
+
+absl::Duration Parameters::cpu_cache_decay_interval() {
+  return absl::Nanoseconds(
+      cpu_cache_decay_interval_ns().load(std::memory_order_relaxed));
+}
+
+absl::Duration Parameters::cpu_cache_predictive_grow_interval() {
+  return absl::Nanoseconds(
+      cpu_cache_predictive_grow_interval_ns().load(std::memory_order_relaxed));
+}
+
+absl::Duration Parameters::pageheap_lock_wait_budget() {
+  return absl::Nanoseconds(
+      pageheap_lock_wait_budget_ns().load(std::memory_order_relaxed));
+}
+
 absl::Duration Parameters::filler_skip_subrelease_interval() {
   return absl::Nanoseconds(
       skip_subrelease_interval_ns().load(std::memory_order_relaxed));
@@ -229,6 +386,16 @@ absl::Duration Parameters::filler_skip_subrelease_long_interval() {
       skip_subrelease_long_interval_ns().load(std::memory_order_relaxed));
 }
 
+absl::Duration Parameters::cache_demand_release_short_interval() {
+  return absl::Nanoseconds(
+      cache_demand_release_short_interval_ns().load(std::memory_order_relaxed));
+}
+
+absl::Duration Parameters::cache_demand_release_long_interval() {
+  return absl::Nanoseconds(
+      cache_demand_release_long_interval_ns().load(std::memory_order_relaxed));
+}
+
 int ABSL_ATTRIBUTE_WEAK
 default_want_disable_separate_allocs_for_few_and_many_objects_spans();
 
@@ -283,6 +450,112 @@ int32_t Parameters::max_per_cpu_cache_size() {
   return tc_globals.cpu_cache().CacheLimit();
 }
 
+// Named tuning bundles switchable at runtime through
+// MallocExtension::SetTuningProfile().  Each entry is a reviewed-together,
+// internally consistent combination of knobs, so runbooks can select a
+// bundle by name instead of flipping individual accessors one at a time
+// during an incident.
+namespace {
+
+struct TuningProfile {
+  absl::string_view name;
+  MallocExtension::BytesPerSecond background_release_rate;
+  int32_t max_per_cpu_cache_size;
+  int64_t max_total_thread_cache_bytes;
+  int32_t transfer_cache_capacity_scale;
+  int64_t deferred_free_threshold;
+  bool release_partial_alloc_pages;
+  bool huge_cache_demand_based_release;
+};
+
+// "default" restores the compiled-in defaults; keep it in sync with the
+// static initializers above.
+constexpr TuningProfile kTuningProfiles[] = {
+    {"default", MallocExtension::BytesPerSecond{0},
+     static_cast<int32_t>(kMaxCpuCacheSize),
+     static_cast<int64_t>(kDefaultOverallThreadCacheSize),
+     /*transfer_cache_capacity_scale=*/1,
+     /*deferred_free_threshold=*/0,
+     /*release_partial_alloc_pages=*/true,
+     /*huge_cache_demand_based_release=*/false},
+    // Latency: hold on to memory, widen the caches, and move giant-free
+    // work off the request threads.
+    {"latency", MallocExtension::BytesPerSecond{0},
+     static_cast<int32_t>(2 * kMaxCpuCacheSize),
+     static_cast<int64_t>(2 * kDefaultOverallThreadCacheSize),
+     /*transfer_cache_capacity_scale=*/4,
+     /*deferred_free_threshold=*/64 << 20,
+     /*release_partial_alloc_pages=*/false,
+     /*huge_cache_demand_based_release=*/false},
+    // Footprint: shrink the caches and return free memory promptly.
+    {"footprint", MallocExtension::BytesPerSecond{128 << 20},
+     static_cast<int32_t>(kMaxCpuCacheSize / 2),
+     static_cast<int64_t>(kDefaultOverallThreadCacheSize / 2),
+     /*transfer_cache_capacity_scale=*/1,
+     /*deferred_free_threshold=*/0,
+     /*release_partial_alloc_pages=*/true,
+     /*huge_cache_demand_based_release=*/true},
+    // Throughput: maximize cache hit rates; frees stay synchronous since
+    // only tail latency benefits from the handoff.
+    {"throughput", MallocExtension::BytesPerSecond{0},
+     static_cast<int32_t>(2 * kMaxCpuCacheSize),
+     static_cast<int64_t>(2 * kDefaultOverallThreadCacheSize),
+     /*transfer_cache_capacity_scale=*/8,
+     /*deferred_free_threshold=*/0,
+     /*release_partial_alloc_pages=*/true,
+     /*huge_cache_demand_based_release=*/false},
+};
+
+ABSL_CONST_INIT absl::base_internal::SpinLock tuning_profile_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+// Index into kTuningProfiles, or -1 if no profile has been applied.
+ABSL_CONST_INIT int active_tuning_profile
+    ABSL_GUARDED_BY(tuning_profile_lock) = -1;
+
+}  // namespace
+
+bool SetTuningProfile(absl::string_view name) {
+  int index = -1;
+  for (int i = 0; i < static_cast<int>(ABSL_ARRAYSIZE(kTuningProfiles)); ++i) {
+    if (kTuningProfiles[i].name == name) {
+      index = i;
+      break;
+    }
+  }
+  if (index == -1) {
+    return false;
+  }
+  const TuningProfile& profile = kTuningProfiles[index];
+
+  // The lock makes concurrent switches apply whole bundles rather than
+  // interleaved halves; re-applying the active profile is a no-op, so
+  // oscillating callers settle without repeatedly resizing caches.
+  absl::base_internal::SpinLockHolder l(&tuning_profile_lock);
+  if (index == active_tuning_profile) {
+    return true;
+  }
+  Parameters::set_background_release_rate(profile.background_release_rate);
+  Parameters::set_max_per_cpu_cache_size(profile.max_per_cpu_cache_size);
+  Parameters::set_max_total_thread_cache_bytes(
+      profile.max_total_thread_cache_bytes);
+  Parameters::set_transfer_cache_capacity_scale(
+      profile.transfer_cache_capacity_scale);
+  Parameters::set_deferred_free_threshold(profile.deferred_free_threshold);
+  TCMalloc_Internal_SetReleasePartialAllocPagesEnabled(
+      profile.release_partial_alloc_pages);
+  TCMalloc_Internal_SetHugeCacheDemandBasedRelease(
+      profile.huge_cache_demand_based_release);
+  active_tuning_profile = index;
+  return true;
+}
+
+absl::string_view ActiveTuningProfileName() {
+  absl::base_internal::SpinLockHolder l(&tuning_profile_lock);
+  return active_tuning_profile == -1
+             ? absl::string_view()
+             : kTuningProfiles[active_tuning_profile].name;
+}
+
 int ABSL_ATTRIBUTE_WEAK default_want_disable_dynamic_slabs();
 
 // TODO(b/271475288): remove the default_want_disable_dynamic_slabs opt-out
@@ -303,6 +576,14 @@ using tcmalloc::tcmalloc_internal::tc_globals;
 
 extern "C" {
 
+bool MallocExtension_Internal_GetLatencyProfilingEnabled() {
+  return Parameters::latency_profiling_enabled();
+}
+
+void MallocExtension_Internal_SetLatencyProfilingEnabled(bool value) {
+  TCMalloc_Internal_SetLatencyProfilingEnabled(value);
+}
+
 int64_t MallocExtension_Internal_GetProfileSamplingRate() {
   return Parameters::profile_sampling_rate();
 }
@@ -319,6 +600,20 @@ void MallocExtension_Internal_SetGuardedSamplingRate(int64_t value) {
   Parameters::set_guarded_sampling_rate(value);
 }
 
+void MallocExtension_Internal_SetGuardedSamplingWeight(size_t min_size,
+                                                       size_t max_size,
+                                                       uint8_t weight) {
+  tc_globals.InitIfNecessary();
+  for (size_t size_class = 1;
+       size_class < tcmalloc::tcmalloc_internal::kNumClasses; ++size_class) {
+    const size_t object_size = tc_globals.sizemap().class_to_size(size_class);
+    if (object_size != 0 && object_size >= min_size &&
+        object_size <= max_size) {
+      tc_globals.guardedpage_allocator().SetGuardWeight(size_class, weight);
+    }
+  }
+}
+
 int64_t MallocExtension_Internal_GetMaxTotalThreadCacheBytes() {
   return Parameters::max_total_thread_cache_bytes();
 }
@@ -406,6 +701,10 @@ bool TCMalloc_Internal_GetHugeRegionDemandBasedRelease() {
   return Parameters::huge_region_demand_based_release();
 }
 
+bool TCMalloc_Internal_GetHugeCacheDemandBasedRelease() {
+  return Parameters::huge_cache_demand_based_release();
+}
+
 bool TCMalloc_Internal_GetReleasePagesFromHugeRegionEnabled() {
   return Parameters::release_pages_from_huge_region();
 }
@@ -422,6 +721,15 @@ void TCMalloc_Internal_SetGuardedSamplingRate(int64_t v) {
   Parameters::guarded_sampling_rate_.store(v, std::memory_order_relaxed);
 }
 
+double TCMalloc_Internal_GetGuardedSamplingOverheadFraction() {
+  return Parameters::guarded_sampling_overhead_fraction();
+}
+
+void TCMalloc_Internal_SetGuardedSamplingOverheadFraction(double v) {
+  Parameters::guarded_sampling_overhead_fraction_.store(
+      v, std::memory_order_relaxed);
+}
+
 // update_lock guards changes via SetHeapSizeHardLimit.
 ABSL_CONST_INIT static absl::base_internal::SpinLock update_lock(
     absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
@@ -458,6 +766,11 @@ void TCMalloc_Internal_SetHugeRegionDemandBasedRelease(bool v) {
       v, std::memory_order_relaxed);
 }
 
+void TCMalloc_Internal_SetHugeCacheDemandBasedRelease(bool v) {
+  Parameters::huge_cache_demand_based_release_.store(v,
+                                                     std::memory_order_relaxed);
+}
+
 void TCMalloc_Internal_SetReleasePagesFromHugeRegionEnabled(bool v) {
   Parameters::release_pages_from_huge_region_.store(v,
                                                     std::memory_order_relaxed);
@@ -497,6 +810,15 @@ void TCMalloc_Internal_SetProfileSamplingRate(int64_t v) {
   Parameters::profile_sampling_rate_.store(v, std::memory_order_relaxed);
 }
 
+double TCMalloc_Internal_GetTargetProfileSamplesPerSec() {
+  return Parameters::target_profile_samples_per_sec();
+}
+
+void TCMalloc_Internal_SetTargetProfileSamplesPerSec(double v) {
+  Parameters::target_profile_samples_per_sec_.store(v,
+                                                    std::memory_order_relaxed);
+}
+
 void TCMalloc_Internal_GetHugePageFillerSkipSubreleaseInterval(
     absl::Duration* v) {
   *v = Parameters::filler_skip_subrelease_interval();
@@ -540,6 +862,27 @@ void TCMalloc_Internal_SetHugePageFillerSkipSubreleaseLongInterval(
       absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
 }
 
+void TCMalloc_Internal_GetHugeCacheDemandReleaseShortInterval(
+    absl::Duration* v) {
+  *v = Parameters::cache_demand_release_short_interval();
+}
+
+void TCMalloc_Internal_SetHugeCacheDemandReleaseShortInterval(
+    absl::Duration v) {
+  tcmalloc::tcmalloc_internal::cache_demand_release_short_interval_ns().store(
+      absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
+}
+
+void TCMalloc_Internal_GetHugeCacheDemandReleaseLongInterval(
+    absl::Duration* v) {
+  *v = Parameters::cache_demand_release_long_interval();
+}
+
+void TCMalloc_Internal_SetHugeCacheDemandReleaseLongInterval(absl::Duration v) {
+  tcmalloc::tcmalloc_internal::cache_demand_release_long_interval_ns().store(
+      absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
+}
+
 bool TCMalloc_Internal_GetPerCpuCachesDynamicSlabEnabled() {
   return Parameters::per_cpu_caches_dynamic_slab_enabled();
 }
@@ -569,12 +912,297 @@ void TCMalloc_Internal_SetPerCpuCachesDynamicSlabShrinkThreshold(double v) {
       v, std::memory_order_relaxed);
 }
 
+int64_t TCMalloc_Internal_GetPerCpuCachesDynamicSlabHysteresisIntervals() {
+  return Parameters::per_cpu_caches_dynamic_slab_hysteresis_intervals();
+}
+
+void TCMalloc_Internal_SetPerCpuCachesDynamicSlabHysteresisIntervals(
+    int64_t v) {
+  Parameters::per_cpu_caches_dynamic_slab_hysteresis_intervals_.store(
+      v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetPerCpuCachesEagerSlabInit() {
+  return Parameters::per_cpu_caches_eager_slab_init();
+}
+
+void TCMalloc_Internal_SetPerCpuCachesEagerSlabInit(bool v) {
+  Parameters::per_cpu_caches_eager_slab_init_.store(v,
+                                                    std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetPerCpuCachesPopPrefetchMinObjectSize() {
+  return Parameters::per_cpu_caches_pop_prefetch_min_object_size();
+}
+
+void TCMalloc_Internal_SetPerCpuCachesPopPrefetchMinObjectSize(int64_t v) {
+  Parameters::per_cpu_caches_pop_prefetch_min_object_size_.store(
+      v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetPerCpuCachesHugePageSlabs() {
+  return Parameters::per_cpu_caches_huge_page_slabs();
+}
+
+void TCMalloc_Internal_SetPerCpuCachesHugePageSlabs(bool v) {
+  Parameters::per_cpu_caches_huge_page_slabs_.store(v,
+                                                    std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetPerCpuCachesStealObjectsFromSiblings() {
+  return Parameters::per_cpu_caches_steal_objects_from_siblings();
+}
+
+void TCMalloc_Internal_SetPerCpuCachesStealObjectsFromSiblings(bool v) {
+  Parameters::per_cpu_caches_steal_objects_from_siblings_.store(
+      v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetLockFreeCentralFreelist() {
+  return Parameters::lock_free_central_freelist();
+}
+
+void TCMalloc_Internal_SetLockFreeCentralFreelist(bool v) {
+  Parameters::lock_free_central_freelist_.store(v, std::memory_order_relaxed);
+}
+
+void TCMalloc_Internal_GetCpuCacheReclaimIdleInterval(absl::Duration* v) {
+  *v = Parameters::cpu_cache_reclaim_idle_interval();
+}
+
+void TCMalloc_Internal_SetCpuCacheReclaimIdleInterval(absl::Duration v) {
+  tcmalloc::tcmalloc_internal::cpu_cache_reclaim_idle_interval_ns().store(
+      absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetCpuCacheDecayMissFloor() {
+  return Parameters::cpu_cache_decay_miss_floor();
+}
+
+void TCMalloc_Internal_SetCpuCacheDecayMissFloor(int64_t v) {
+  Parameters::cpu_cache_decay_miss_floor_.store(v, std::memory_order_relaxed);
+}
+
+void TCMalloc_Internal_GetCpuCacheDecayInterval(absl::Duration* v) {
+  *v = Parameters::cpu_cache_decay_interval();
+}
+
+void TCMalloc_Internal_SetCpuCacheDecayInterval(absl::Duration v) {
+  tcmalloc::tcmalloc_internal::cpu_cache_decay_interval_ns().store(
+      absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
+}
+
+void TCMalloc_Internal_GetCpuCachePredictiveGrowInterval(absl::Duration* v) {
+  *v = Parameters::cpu_cache_predictive_grow_interval();
+}
+
+void TCMalloc_Internal_SetCpuCachePredictiveGrowInterval(absl::Duration v) {
+  tcmalloc::tcmalloc_internal::cpu_cache_predictive_grow_interval_ns().store(
+      absl::ToInt64Nanoseconds(v), std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetFragmentationAlarmThresholdBytes() {
+  return Parameters::fragmentation_alarm_threshold_bytes();
+}
+
+void TCMalloc_Internal_SetFragmentationAlarmThresholdBytes(int64_t v) {
+  Parameters::fragmentation_alarm_threshold_bytes_.store(
+      v, std::memory_order_relaxed);
+}
+
+double TCMalloc_Internal_GetAllocationAnomalyFactor() {
+  return Parameters::allocation_anomaly_factor();
+}
+
+void TCMalloc_Internal_SetAllocationAnomalyFactor(double v) {
+  Parameters::allocation_anomaly_factor_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetReleaseInaccessibleCpuMemory() {
+  return Parameters::release_inaccessible_cpu_memory();
+}
+
+void TCMalloc_Internal_SetReleaseInaccessibleCpuMemory(bool v) {
+  Parameters::release_inaccessible_cpu_memory_.store(v,
+                                                     std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetPagemapLeafCache() {
+  return Parameters::pagemap_leaf_cache();
+}
+
+void TCMalloc_Internal_SetPagemapLeafCache(bool v) {
+  Parameters::pagemap_leaf_cache_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetTransferCacheMissHistory() {
+  return Parameters::transfer_cache_miss_history();
+}
+
+void TCMalloc_Internal_SetTransferCacheMissHistory(bool v) {
+  Parameters::transfer_cache_miss_history_.store(v, std::memory_order_relaxed);
+}
+
+int32_t TCMalloc_Internal_GetTransferCacheCapacityScale() {
+  return Parameters::transfer_cache_capacity_scale();
+}
+
+void TCMalloc_Internal_SetTransferCacheCapacityScale(int32_t v) {
+  // Each step multiplies the transfer caches' arena footprint, so bound the
+  // scale rather than let a stray setting consume the heap.
+  v = std::clamp<int32_t>(v, 1, 64);
+  Parameters::transfer_cache_capacity_scale_.store(v,
+                                                   std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetDeferredFreeThreshold() {
+  return Parameters::deferred_free_threshold();
+}
+
+void TCMalloc_Internal_SetDeferredFreeThreshold(int64_t v) {
+  Parameters::deferred_free_threshold_.store(std::max<int64_t>(v, 0),
+                                             std::memory_order_relaxed);
+}
+
+void TCMalloc_Internal_GetPageheapLockWaitBudget(absl::Duration* v) {
+  *v = Parameters::pageheap_lock_wait_budget();
+}
+
+void TCMalloc_Internal_SetPageheapLockWaitBudget(absl::Duration v) {
+  tcmalloc::tcmalloc_internal::pageheap_lock_wait_budget_ns().store(
+      std::max<int64_t>(absl::ToInt64Nanoseconds(v), 0),
+      std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetSizedDeleteMismatchCheckInterval() {
+  return Parameters::sized_delete_mismatch_check_interval();
+}
+
+void TCMalloc_Internal_SetSizedDeleteMismatchCheckInterval(int64_t v) {
+  Parameters::sized_delete_mismatch_check_interval_.store(
+      std::max<int64_t>(v, 0), std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetLargeSpanCacheEnabled() {
+  return Parameters::large_span_cache_enabled();
+}
+
+void TCMalloc_Internal_SetLargeSpanCacheEnabled(bool v) {
+  Parameters::large_span_cache_enabled_.store(v, std::memory_order_relaxed);
+}
+
+double TCMalloc_Internal_GetMemoryPressureAvg10Threshold() {
+  return Parameters::memory_pressure_avg10_threshold();
+}
+
+void TCMalloc_Internal_SetMemoryPressureAvg10Threshold(double v) {
+  Parameters::memory_pressure_avg10_threshold_.store(v,
+                                                     std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetUnifiedEvictionPlanner() {
+  return Parameters::unified_eviction_planner();
+}
+
+void TCMalloc_Internal_SetUnifiedEvictionPlanner(bool v) {
+  Parameters::unified_eviction_planner_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetShardedTransferCacheNumaAware() {
+  return Parameters::sharded_transfer_cache_numa_aware();
+}
+
+void TCMalloc_Internal_SetShardedTransferCacheNumaAware(bool v) {
+  Parameters::sharded_transfer_cache_numa_aware_.store(
+      v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetHardenedFreeChecks() {
+  return Parameters::hardened_free_checks();
+}
+
+void TCMalloc_Internal_SetHardenedFreeChecks(bool v) {
+  Parameters::hardened_free_checks_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetMadviseColdRegions() {
+  return Parameters::madvise_cold_regions();
+}
+
+void TCMalloc_Internal_SetMadviseColdRegions(bool v) {
+  Parameters::madvise_cold_regions_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetNumaRehomeEnabled() {
+  return Parameters::numa_rehome_enabled();
+}
+
+void TCMalloc_Internal_SetNumaRehomeEnabled(bool v) {
+  Parameters::numa_rehome_enabled_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetThpAwareRegionBias() {
+  return Parameters::thp_aware_region_bias();
+}
+
+void TCMalloc_Internal_SetThpAwareRegionBias(bool v) {
+  Parameters::thp_aware_region_bias_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetSortTransferCacheBatches() {
+  return Parameters::sort_transfer_cache_batches();
+}
+
+void TCMalloc_Internal_SetSortTransferCacheBatches(bool v) {
+  Parameters::sort_transfer_cache_batches_.store(v, std::memory_order_relaxed);
+}
+
 bool TCMalloc_Internal_GetMadviseFree() { return Parameters::madvise_free(); }
 
 void TCMalloc_Internal_SetMadviseFree(bool v) {
   Parameters::madvise_free_.store(v, std::memory_order_relaxed);
 }
 
+bool TCMalloc_Internal_GetMadviseFreeLazy() {
+  return Parameters::madvise_free_lazy();
+}
+
+void TCMalloc_Internal_SetMadviseFreeLazy(bool v) {
+  Parameters::madvise_free_lazy_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetPageIdleScanEnabled() {
+  return Parameters::page_idle_scan_enabled();
+}
+
+void TCMalloc_Internal_SetPageIdleScanEnabled(bool v) {
+  Parameters::page_idle_scan_enabled_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetLatencyProfilingEnabled() {
+  return Parameters::latency_profiling_enabled();
+}
+
+void TCMalloc_Internal_SetLatencyProfilingEnabled(bool v) {
+  Parameters::latency_profiling_enabled_.store(v, std::memory_order_relaxed);
+}
+
+int64_t TCMalloc_Internal_GetSignalSafePoolBytes() {
+  return Parameters::signal_safe_pool_bytes();
+}
+
+void TCMalloc_Internal_SetSignalSafePoolBytes(int64_t v) {
+  Parameters::signal_safe_pool_bytes_.store(v, std::memory_order_relaxed);
+}
+
+bool TCMalloc_Internal_GetLifetimePredictionEnabled() {
+  return Parameters::lifetime_prediction_enabled();
+}
+
+void TCMalloc_Internal_SetLifetimePredictionEnabled(bool v) {
+  Parameters::lifetime_prediction_enabled_.store(v, std::memory_order_relaxed);
+}
+
 uint8_t TCMalloc_Internal_GetMinHotAccessHint() {
   return static_cast<uint8_t>(Parameters::min_hot_access_hint());
 }
@@ -584,4 +1212,14 @@ void TCMalloc_Internal_SetMinHotAccessHint(uint8_t v) {
                                          std::memory_order_relaxed);
 }
 
+bool MallocExtension_Internal_SetTuningProfile(const char* name_data,
+                                               size_t name_size) {
+  return tcmalloc::tcmalloc_internal::SetTuningProfile(
+      absl::string_view(name_data, name_size));
+}
+
+void MallocExtension_Internal_GetTuningProfile(std::string* ret) {
+  *ret = std::string(tcmalloc::tcmalloc_internal::ActiveTuningProfileName());
+}
+
 }  // extern "C"
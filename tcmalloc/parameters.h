@@ -58,6 +58,20 @@ class Parameters {
     TCMalloc_Internal_SetGuardedSamplingRate(value);
   }
 
+  // Target fraction of wall-clock time (cycles spent in guarded
+  // Allocate/Deallocate, summed across threads) the guarded page allocator may
+  // consume.  When positive, the background thread rescales
+  // guarded_sampling_rate to hold this budget, using the configured rate as a
+  // starting point; see GuardedPageAllocator::AdjustForOverheadBudget().  Zero
+  // (the default) leaves the sampling rate fixed.
+  static double guarded_sampling_overhead_fraction() {
+    return guarded_sampling_overhead_fraction_.load(std::memory_order_relaxed);
+  }
+
+  static void set_guarded_sampling_overhead_fraction(double value) {
+    TCMalloc_Internal_SetGuardedSamplingOverheadFraction(value);
+  }
+
   static int32_t max_per_cpu_cache_size();
 
   static void set_max_per_cpu_cache_size(int32_t value) {
@@ -72,10 +86,68 @@ class Parameters {
     return madvise_free_.load(std::memory_order_relaxed);
   }
 
+  // When true, SystemRelease uses MADV_FREE alone, leaving pages mapped so
+  // that reuse before kernel reclaim avoids the zero-fill fault MADV_DONTNEED
+  // forces.  Ignored while madvise_free() is set, and reverts to
+  // MADV_DONTNEED automatically if probing shows the kernel reclaiming the
+  // lazily released memory aggressively; see SystemCheckLazyRelease().
+  static bool madvise_free_lazy() {
+    return madvise_free_lazy_.load(std::memory_order_relaxed);
+  }
+
+  // When true, the background thread incrementally scans filler hugepages
+  // via the kernel page_idle bitmap and feeds true-coldness scores to the
+  // subrelease candidate ordering; see idle_scan.h.  Off by default, and a
+  // no-op without the privilege to read page frame numbers.
+  static bool page_idle_scan_enabled() {
+    return page_idle_scan_enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void set_page_idle_scan_enabled(bool value) {
+    TCMalloc_Internal_SetPageIdleScanEnabled(value);
+  }
+
+  // Per-thread budget, in bytes, for the signal-safe allocation pool
+  // (signal_safe_allocation.h).  Clamped to SignalSafePool::kPoolBytes, the
+  // static per-thread reservation; zero makes the pool refuse all requests.
+  static int64_t signal_safe_pool_bytes() {
+    return signal_safe_pool_bytes_.load(std::memory_order_relaxed);
+  }
+
+  static void set_signal_safe_pool_bytes(int64_t value) {
+    TCMalloc_Internal_SetSignalSafePoolBytes(value);
+  }
+
+  // When true, slow paths record cycle-count histograms; see
+  // latency_profiling.h.  Off by default.
+  static bool latency_profiling_enabled() {
+    return latency_profiling_enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void set_latency_profiling_enabled(bool value) {
+    TCMalloc_Internal_SetLatencyProfilingEnabled(value);
+  }
+
+  // When true, the HugePageAwareAllocator predicts per allocation site
+  // whether page-level allocations will be short-lived and segregates
+  // predicted-short-lived spans onto dedicated hugepages, so those hugepages
+  // drain quickly and can be returned to the OS whole.  Off by default.
+  static bool lifetime_prediction_enabled() {
+    return lifetime_prediction_enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void set_lifetime_prediction_enabled(bool value) {
+    TCMalloc_Internal_SetLifetimePredictionEnabled(value);
+  }
+
   static void set_madvise_free(bool value) {
     TCMalloc_Internal_SetMadviseFree(value);
   }
 
+  static void set_madvise_free_lazy(bool value) {
+    TCMalloc_Internal_SetMadviseFreeLazy(value);
+  }
+
   static tcmalloc::hot_cold_t min_hot_access_hint() {
     return min_hot_access_hint_.load(std::memory_order_relaxed);
   }
@@ -104,6 +176,10 @@ class Parameters {
     return huge_region_demand_based_release_.load(std::memory_order_relaxed);
   }
 
+  static bool huge_cache_demand_based_release() {
+    return huge_cache_demand_based_release_.load(std::memory_order_relaxed);
+  }
+
   static bool release_pages_from_huge_region() {
     return release_pages_from_huge_region_.load(std::memory_order_relaxed);
   }
@@ -133,6 +209,17 @@ class Parameters {
     TCMalloc_Internal_SetProfileSamplingRate(value);
   }
 
+  // Target process-wide heap-profile samples per second for the adaptive
+  // sampling controller (see adaptive_sampling.h); <= 0 disables it and
+  // leaves profile_sampling_rate() under manual control.
+  static double target_profile_samples_per_sec() {
+    return target_profile_samples_per_sec_.load(std::memory_order_relaxed);
+  }
+
+  static void set_target_profile_samples_per_sec(double value) {
+    TCMalloc_Internal_SetTargetProfileSamplesPerSec(value);
+  }
+
   static void set_filler_skip_subrelease_interval(absl::Duration value) {
     TCMalloc_Internal_SetHugePageFillerSkipSubreleaseInterval(value);
   }
@@ -154,6 +241,18 @@ class Parameters {
 
   static absl::Duration filler_skip_subrelease_long_interval();
 
+  static void set_cache_demand_release_short_interval(absl::Duration value) {
+    TCMalloc_Internal_SetHugeCacheDemandReleaseShortInterval(value);
+  }
+
+  static absl::Duration cache_demand_release_short_interval();
+
+  static void set_cache_demand_release_long_interval(absl::Duration value) {
+    TCMalloc_Internal_SetHugeCacheDemandReleaseLongInterval(value);
+  }
+
+  static absl::Duration cache_demand_release_long_interval();
+
   static bool per_cpu_caches_dynamic_slab_enabled() {
     return per_cpu_caches_dynamic_slab_.load(std::memory_order_relaxed);
   }
@@ -177,21 +276,325 @@ class Parameters {
     TCMalloc_Internal_SetPerCpuCachesDynamicSlabShrinkThreshold(value);
   }
 
+  // Number of consecutive slab-resize intervals that must produce the same
+  // grow/shrink verdict before the slab is actually resized.  Values above
+  // one (the default) trade responsiveness for fewer resizes when the miss
+  // ratio hovers near a grow/shrink threshold.
+  static int64_t per_cpu_caches_dynamic_slab_hysteresis_intervals() {
+    return per_cpu_caches_dynamic_slab_hysteresis_intervals_.load(
+        std::memory_order_relaxed);
+  }
+  static void set_per_cpu_caches_dynamic_slab_hysteresis_intervals(
+      int64_t value) {
+    TCMalloc_Internal_SetPerCpuCachesDynamicSlabHysteresisIntervals(value);
+  }
+
+  // Whether CpuCache::Activate pre-initializes the slab region of every
+  // usable cpu, so no allocation ever pays the first-touch InitCpu cost.
+  // Off by default; only consulted at activation time.
+  static bool per_cpu_caches_eager_slab_init() {
+    return per_cpu_caches_eager_slab_init_.load(std::memory_order_relaxed);
+  }
+  static void set_per_cpu_caches_eager_slab_init(bool value) {
+    TCMalloc_Internal_SetPerCpuCachesEagerSlabInit(value);
+  }
+
+  // Minimum object size for which Pop on the per-cpu slab prefetches the
+  // returned object before handing it to the caller.  Negative values (the
+  // default) disable the prefetch; zero enables it for all size classes.
+  static int64_t per_cpu_caches_pop_prefetch_min_object_size() {
+    return per_cpu_caches_pop_prefetch_min_object_size_.load(
+        std::memory_order_relaxed);
+  }
+  static void set_per_cpu_caches_pop_prefetch_min_object_size(int64_t value) {
+    TCMalloc_Internal_SetPerCpuCachesPopPrefetchMinObjectSize(value);
+  }
+
+  // Whether freshly allocated per-cpu slab metadata is placed on huge pages
+  // (via MADV_HUGEPAGE/MADV_COLLAPSE), keeping the malloc fast path
+  // dTLB-resident on hosts with many cpus.
+  static bool per_cpu_caches_huge_page_slabs() {
+    return per_cpu_caches_huge_page_slabs_.load(std::memory_order_relaxed);
+  }
+  static void set_per_cpu_caches_huge_page_slabs(bool value) {
+    TCMalloc_Internal_SetPerCpuCachesHugePageSlabs(value);
+  }
+
+  // Whether the background thread periodically applies MADV_COLD to the
+  // address space backing cold-tagged allocations (operator new with a
+  // hot_cold_t hint below min_hot_access_hint), so the kernel reclaims those
+  // pages first under memory pressure.
+  static bool madvise_cold_regions() {
+    return madvise_cold_regions_.load(std::memory_order_relaxed);
+  }
+  static void set_madvise_cold_regions(bool value) {
+    TCMalloc_Internal_SetMadviseColdRegions(value);
+  }
+
+  // Whether the background thread periodically samples the NUMA node
+  // placement of normal-tagged regions and migrates pages found on nodes no
+  // longer local to our CPU affinity, repairing locality after the process
+  // is moved to another socket.
+  static bool numa_rehome_enabled() {
+    return numa_rehome_enabled_.load(std::memory_order_relaxed);
+  }
+  static void set_numa_rehome_enabled(bool value) {
+    TCMalloc_Internal_SetNumaRehomeEnabled(value);
+  }
+
+  // Whether the background thread monitors system hugepage pressure (THP
+  // fault fallback rates from /proc/vmstat) and, when allocation of fresh
+  // hugepages is failing, biases large-allocation placement toward huge
+  // regions and dense packing instead of donating slack to the filler.  The
+  // bias is dropped again once fresh hugepages become plentiful.
+  static bool thp_aware_region_bias() {
+    return thp_aware_region_bias_.load(std::memory_order_relaxed);
+  }
+  static void set_thp_aware_region_bias(bool value) {
+    TCMalloc_Internal_SetThpAwareRegionBias(value);
+  }
+
+  // Whether the transfer cache sorts inserted batches by address, so that
+  // batches later handed to a refilling per-cpu cache are ascending runs and
+  // the consumer's subsequent writes walk memory sequentially.  Adds a small
+  // sort to the insert path in exchange for better locality on the remove
+  // side.
+  static bool sort_transfer_cache_batches() {
+    return sort_transfer_cache_batches_.load(std::memory_order_relaxed);
+  }
+  static void set_sort_transfer_cache_batches(bool value) {
+    TCMalloc_Internal_SetSortTransferCacheBatches(value);
+  }
+
+  // Whether the free path runs cheap validation (sized-delete hints checked
+  // against the pagemap, pointers checked against size class object
+  // boundaries, sampled double frees detected) and crashes on a mismatch.  A
+  // middle tier between the unchecked release build and full sanitizers,
+  // intended to be cheap enough for production canaries.
+  static bool hardened_free_checks() {
+    return hardened_free_checks_.load(std::memory_order_relaxed);
+  }
+  static void set_hardened_free_checks(bool value) {
+    TCMalloc_Internal_SetHardenedFreeChecks(value);
+  }
+
+  // How long a populated per-cpu cache must stay idle (no change in used
+  // bytes and no misses) before the background thread reclaims it.
+  static absl::Duration cpu_cache_reclaim_idle_interval();
+  static void set_cpu_cache_reclaim_idle_interval(absl::Duration value) {
+    TCMalloc_Internal_SetCpuCacheReclaimIdleInterval(value);
+  }
+
+  // Number of misses (underflows plus overflows) per decay interval below
+  // which the background thread steps a per-cpu cache's capacity back down
+  // after a load spike.  Zero (the default) disables capacity decay.
+  static int64_t cpu_cache_decay_miss_floor() {
+    return cpu_cache_decay_miss_floor_.load(std::memory_order_relaxed);
+  }
+  static void set_cpu_cache_decay_miss_floor(int64_t value) {
+    TCMalloc_Internal_SetCpuCacheDecayMissFloor(value);
+  }
+
+  // How often the background thread considers quiet per-cpu caches for
+  // capacity decay.  Longer intervals add hysteresis: a cache must stay below
+  // the miss floor for a full interval before it gives up any capacity.
+  static absl::Duration cpu_cache_decay_interval();
+  static void set_cpu_cache_decay_interval(absl::Duration value) {
+    TCMalloc_Internal_SetCpuCacheDecayInterval(value);
+  }
+
+  // How often the background thread pre-grows quiet per-cpu caches toward
+  // their predicted per-size-class demand and primes the backing transfer
+  // caches (see CpuCache::PredictivelyGrowCpuCaches).  Zero (the default)
+  // disables predictive growth.
+  static absl::Duration cpu_cache_predictive_grow_interval();
+  static void set_cpu_cache_predictive_grow_interval(absl::Duration value) {
+    TCMalloc_Internal_SetCpuCachePredictiveGrowInterval(value);
+  }
+
+  // Estimated internal fragmentation (bytes allocated beyond what callers
+  // requested, after unsampling) at which the background thread fires the
+  // registered fragmentation alarm callback (fragmentation_alarm.h).  Zero
+  // (the default) disables the alarm.
+  static int64_t fragmentation_alarm_threshold_bytes() {
+    return fragmentation_alarm_threshold_bytes_.load(
+        std::memory_order_relaxed);
+  }
+  static void set_fragmentation_alarm_threshold_bytes(int64_t value) {
+    TCMalloc_Internal_SetFragmentationAlarmThresholdBytes(value);
+  }
+
+  // Factor by which a size class's per-interval allocation rate must depart
+  // its trailing baseline before the background thread fires the registered
+  // allocation anomaly callback (allocation_anomaly.h).  Values at or below
+  // 1 (the default 0 included) disable the tripwire.
+  static double allocation_anomaly_factor() {
+    return allocation_anomaly_factor_.load(std::memory_order_relaxed);
+  }
+  static void set_allocation_anomaly_factor(double value) {
+    TCMalloc_Internal_SetAllocationAnomalyFactor(value);
+  }
+
+  // Whether the background thread also reclaims per-cpu caches on CPUs
+  // outside its current affinity mask, without waiting for an idle interval.
+  // Threads whose affinity is broader than the background thread's repopulate
+  // such caches on their next allocation, so this is only profitable when all
+  // threads share one mask (e.g. a container cpuset that shrank).
+  static bool release_inaccessible_cpu_memory() {
+    return release_inaccessible_cpu_memory_.load(std::memory_order_relaxed);
+  }
+  static void set_release_inaccessible_cpu_memory(bool value) {
+    TCMalloc_Internal_SetReleaseInaccessibleCpuMemory(value);
+  }
+
+  // Whether a per-cpu cache miss may migrate objects directly from the slab
+  // of another cpu sharing the same L3 cache, bypassing the transfer cache.
+  static bool per_cpu_caches_steal_objects_from_siblings() {
+    return per_cpu_caches_steal_objects_from_siblings_.load(
+        std::memory_order_relaxed);
+  }
+  static void set_per_cpu_caches_steal_objects_from_siblings(bool value) {
+    TCMalloc_Internal_SetPerCpuCachesStealObjectsFromSiblings(value);
+  }
+
+  // Whether the sharded transfer cache partitions its shards by NUMA domain
+  // first and L3 cache second.  Only consulted while the sharded transfer
+  // cache initializes, so this must be set before the first allocation to
+  // take effect.
+  static bool sharded_transfer_cache_numa_aware() {
+    return sharded_transfer_cache_numa_aware_.load(std::memory_order_relaxed);
+  }
+  static void set_sharded_transfer_cache_numa_aware(bool value) {
+    TCMalloc_Internal_SetShardedTransferCacheNumaAware(value);
+  }
+
+  // Whether the background thread enables the lock-free batch stack in the
+  // central freelists of the size classes with the highest transfer cache
+  // miss volume, so that misses on those classes stop serializing on one
+  // spinlock per class.
+  static bool lock_free_central_freelist() {
+    return lock_free_central_freelist_.load(std::memory_order_relaxed);
+  }
+  static void set_lock_free_central_freelist(bool value) {
+    TCMalloc_Internal_SetLockFreeCentralFreelist(value);
+  }
+
+  // Whether deallocation consults a small per-cpu cache of recently used
+  // pagemap leaf nodes before walking the pagemap radix tree, trading a few
+  // bytes of metadata per cpu for fewer dependent cache misses on free.
+  static bool pagemap_leaf_cache() {
+    return pagemap_leaf_cache_.load(std::memory_order_relaxed);
+  }
+  static void set_pagemap_leaf_cache(bool value) {
+    TCMalloc_Internal_SetPagemapLeafCache(value);
+  }
+
+  // Whether transfer cache resizing ranks size classes by their peak miss
+  // volume over a sliding window rather than by the last resize interval
+  // alone, so that classes whose hot phase briefly pauses do not immediately
+  // lose their capacity to the currently hot classes.
+  static bool transfer_cache_miss_history() {
+    return transfer_cache_miss_history_.load(std::memory_order_relaxed);
+  }
+  static void set_transfer_cache_miss_history(bool value) {
+    TCMalloc_Internal_SetTransferCacheMissHistory(value);
+  }
+
+  // Multiplier applied to the compiled-in per-size-class transfer cache
+  // capacity ceilings, so that deployment tiers willing to spend more memory
+  // on the transfer caches can trade it for fewer central freelist trips.
+  // Takes effect at the next background resize pass; see
+  // TransferCache::SetMaxCapacityScale() for how the ceilings move.
+  static int32_t transfer_cache_capacity_scale() {
+    return transfer_cache_capacity_scale_.load(std::memory_order_relaxed);
+  }
+  static void set_transfer_cache_capacity_scale(int32_t value) {
+    TCMalloc_Internal_SetTransferCacheCapacityScale(value);
+  }
+
+  // Span size, in bytes, at or above which a free is handed off to the
+  // background thread instead of returning the span to the page allocator
+  // synchronously.  Zero (the default) disables the handoff.  Only useful
+  // when MallocExtension::ProcessBackgroundActions is running; see
+  // deferred_free_queue.h.
+  static int64_t deferred_free_threshold() {
+    return deferred_free_threshold_.load(std::memory_order_relaxed);
+  }
+  static void set_deferred_free_threshold(int64_t value) {
+    TCMalloc_Internal_SetDeferredFreeThreshold(value);
+  }
+
+  // Roughly one in this many sized deletes per thread re-derives the size
+  // class from the pagemap and counts (and logs, with a stack) any
+  // disagreement with the caller's size hint; see sized_delete_check.h.
+  // Zero (the default) disables the sampling.  Unlike
+  // hardened_free_checks(), a detected mismatch does not crash.
+  static int64_t sized_delete_mismatch_check_interval() {
+    return sized_delete_mismatch_check_interval_.load(
+        std::memory_order_relaxed);
+  }
+  static void set_sized_delete_mismatch_check_interval(int64_t value) {
+    TCMalloc_Internal_SetSizedDeleteMismatchCheckInterval(value);
+  }
+
+  // Longest a central freelist refill will wait for pageheap_lock before
+  // serving the span from the emergency reserve the background thread keeps
+  // stocked (emergency_span_reserve.h).  Zero (the default) disables the
+  // bounded wait and the reserve.
+  static absl::Duration pageheap_lock_wait_budget();
+  static void set_pageheap_lock_wait_budget(absl::Duration value) {
+    TCMalloc_Internal_SetPageheapLockWaitBudget(value);
+  }
+
+  // Memory PSI "some avg10" percentage at which the background thread
+  // starts its graduated pressure response (memory_pressure.h); twice this
+  // value escalates to flushing idle cpu caches.  Zero (the default)
+  // disables PSI sampling.
+  static double memory_pressure_avg10_threshold() {
+    return memory_pressure_avg10_threshold_.load(std::memory_order_relaxed);
+  }
+  static void set_memory_pressure_avg10_threshold(double value) {
+    TCMalloc_Internal_SetMemoryPressureAvg10Threshold(value);
+  }
+
+  // Whether allocations beyond kMaxSize may be served from and returned to
+  // the per-L3 large span cache (large_span_cache.h) instead of the page
+  // heap.  Off by default.
+  static bool large_span_cache_enabled() {
+    return large_span_cache_enabled_.load(std::memory_order_relaxed);
+  }
+  static void set_large_span_cache_enabled(bool value) {
+    TCMalloc_Internal_SetLargeSpanCacheEnabled(value);
+  }
+
+  // Whether the background thread routes its periodic release target through
+  // the cross-tier eviction planner (eviction_planner.h) rather than calling
+  // ReleaseMemoryToSystem directly.  Off by default.
+  static bool unified_eviction_planner() {
+    return unified_eviction_planner_.load(std::memory_order_relaxed);
+  }
+  static void set_unified_eviction_planner(bool value) {
+    TCMalloc_Internal_SetUnifiedEvictionPlanner(value);
+  }
+
   static bool separate_allocs_for_few_and_many_objects_spans();
   static size_t chunks_per_alloc();
 
  private:
   friend void ::TCMalloc_Internal_SetBackgroundReleaseRate(size_t v);
   friend void ::TCMalloc_Internal_SetGuardedSamplingRate(int64_t v);
+  friend void ::TCMalloc_Internal_SetGuardedSamplingOverheadFraction(double v);
   friend void ::TCMalloc_Internal_SetHPAASubrelease(bool v);
   friend void ::TCMalloc_Internal_SetReleasePartialAllocPagesEnabled(bool v);
   friend void ::TCMalloc_Internal_SetHugeRegionDemandBasedRelease(bool v);
+  friend void ::TCMalloc_Internal_SetHugeCacheDemandBasedRelease(bool v);
   friend void ::TCMalloc_Internal_SetReleasePagesFromHugeRegionEnabled(bool v);
   friend void ::TCMalloc_Internal_SetMaxPerCpuCacheSize(int32_t v);
   friend void ::TCMalloc_Internal_SetMaxTotalThreadCacheBytes(int64_t v);
   friend void ::TCMalloc_Internal_SetPeakSamplingHeapGrowthFraction(double v);
   friend void ::TCMalloc_Internal_SetPerCpuCachesEnabled(bool v);
   friend void ::TCMalloc_Internal_SetProfileSamplingRate(int64_t v);
+  friend void ::TCMalloc_Internal_SetTargetProfileSamplesPerSec(double v);
 
   friend void ::TCMalloc_Internal_SetHugePageFillerSkipSubreleaseInterval(
       absl::Duration v);
@@ -199,34 +602,112 @@ class Parameters {
       absl::Duration v);
   friend void ::TCMalloc_Internal_SetHugePageFillerSkipSubreleaseLongInterval(
       absl::Duration v);
+  friend void ::TCMalloc_Internal_SetHugeCacheDemandReleaseShortInterval(
+      absl::Duration v);
+  friend void ::TCMalloc_Internal_SetHugeCacheDemandReleaseLongInterval(
+      absl::Duration v);
   friend void ::TCMalloc_Internal_SetPerCpuCachesDynamicSlabEnabled(bool v);
   friend void ::TCMalloc_Internal_SetPerCpuCachesDynamicSlabGrowThreshold(
       double v);
   friend void ::TCMalloc_Internal_SetPerCpuCachesDynamicSlabShrinkThreshold(
       double v);
+  friend void ::TCMalloc_Internal_SetPerCpuCachesDynamicSlabHysteresisIntervals(
+      int64_t v);
+  friend void ::TCMalloc_Internal_SetPerCpuCachesEagerSlabInit(bool v);
 
   friend void TCMalloc_Internal_SetLifetimeAllocatorOptions(
       absl::string_view s);
+  friend void ::TCMalloc_Internal_SetMadviseColdRegions(bool v);
+  friend void ::TCMalloc_Internal_SetNumaRehomeEnabled(bool v);
+  friend void ::TCMalloc_Internal_SetThpAwareRegionBias(bool v);
+  friend void ::TCMalloc_Internal_SetSortTransferCacheBatches(bool v);
   friend void ::TCMalloc_Internal_SetMadviseFree(bool v);
+  friend void ::TCMalloc_Internal_SetMadviseFreeLazy(bool v);
+  friend void ::TCMalloc_Internal_SetLatencyProfilingEnabled(bool v);
+  friend void ::TCMalloc_Internal_SetSignalSafePoolBytes(int64_t v);
+  friend void ::TCMalloc_Internal_SetLifetimePredictionEnabled(bool v);
   friend void ::TCMalloc_Internal_SetMinHotAccessHint(uint8_t v);
+  friend void ::TCMalloc_Internal_SetPerCpuCachesPopPrefetchMinObjectSize(
+      int64_t v);
+  friend void ::TCMalloc_Internal_SetShardedTransferCacheNumaAware(bool v);
+  friend void ::TCMalloc_Internal_SetPerCpuCachesStealObjectsFromSiblings(
+      bool v);
+  friend void ::TCMalloc_Internal_SetPerCpuCachesHugePageSlabs(bool v);
+  friend void ::TCMalloc_Internal_SetLockFreeCentralFreelist(bool v);
+  friend void ::TCMalloc_Internal_SetReleaseInaccessibleCpuMemory(bool v);
+  friend void ::TCMalloc_Internal_SetCpuCacheDecayMissFloor(int64_t v);
+  friend void ::TCMalloc_Internal_SetFragmentationAlarmThresholdBytes(
+      int64_t v);
+  friend void ::TCMalloc_Internal_SetAllocationAnomalyFactor(double v);
+  friend void ::TCMalloc_Internal_SetPagemapLeafCache(bool v);
+  friend void ::TCMalloc_Internal_SetTransferCacheMissHistory(bool v);
+  friend void ::TCMalloc_Internal_SetTransferCacheCapacityScale(int32_t v);
+  friend void ::TCMalloc_Internal_SetDeferredFreeThreshold(int64_t v);
+  friend void ::TCMalloc_Internal_SetSizedDeleteMismatchCheckInterval(
+      int64_t v);
+  friend void ::TCMalloc_Internal_SetLargeSpanCacheEnabled(bool v);
+  friend void ::TCMalloc_Internal_SetMemoryPressureAvg10Threshold(double v);
+  friend void ::TCMalloc_Internal_SetUnifiedEvictionPlanner(bool v);
 
   static std::atomic<MallocExtension::BytesPerSecond> background_release_rate_;
   static std::atomic<int64_t> guarded_sampling_rate_;
+  static std::atomic<double> guarded_sampling_overhead_fraction_;
   static std::atomic<int32_t> max_per_cpu_cache_size_;
   static std::atomic<int64_t> max_total_thread_cache_bytes_;
   static std::atomic<double> peak_sampling_heap_growth_fraction_;
   static std::atomic<bool> per_cpu_caches_enabled_;
   static std::atomic<bool> release_partial_alloc_pages_;
   static std::atomic<bool> huge_region_demand_based_release_;
+  static std::atomic<bool> huge_cache_demand_based_release_;
   static std::atomic<bool> release_pages_from_huge_region_;
   static std::atomic<int64_t> profile_sampling_rate_;
+  static std::atomic<double> target_profile_samples_per_sec_;
   static std::atomic<bool> per_cpu_caches_dynamic_slab_;
+  static std::atomic<bool> hardened_free_checks_;
+  static std::atomic<bool> madvise_cold_regions_;
+  static std::atomic<bool> numa_rehome_enabled_;
+  static std::atomic<bool> thp_aware_region_bias_;
+  static std::atomic<bool> sort_transfer_cache_batches_;
   static std::atomic<bool> madvise_free_;
+  static std::atomic<bool> madvise_free_lazy_;
+  static std::atomic<bool> page_idle_scan_enabled_;
+  static std::atomic<bool> latency_profiling_enabled_;
+  static std::atomic<int64_t> signal_safe_pool_bytes_;
+  static std::atomic<bool> lifetime_prediction_enabled_;
   static std::atomic<tcmalloc::hot_cold_t> min_hot_access_hint_;
   static std::atomic<double> per_cpu_caches_dynamic_slab_grow_threshold_;
   static std::atomic<double> per_cpu_caches_dynamic_slab_shrink_threshold_;
+  static std::atomic<int64_t>
+      per_cpu_caches_dynamic_slab_hysteresis_intervals_;
+  static std::atomic<bool> per_cpu_caches_eager_slab_init_;
+  static std::atomic<int64_t> per_cpu_caches_pop_prefetch_min_object_size_;
+  static std::atomic<bool> sharded_transfer_cache_numa_aware_;
+  static std::atomic<bool> per_cpu_caches_steal_objects_from_siblings_;
+  static std::atomic<bool> per_cpu_caches_huge_page_slabs_;
+  static std::atomic<bool> lock_free_central_freelist_;
+  static std::atomic<bool> release_inaccessible_cpu_memory_;
+  static std::atomic<int64_t> cpu_cache_decay_miss_floor_;
+  static std::atomic<int64_t> fragmentation_alarm_threshold_bytes_;
+  static std::atomic<double> allocation_anomaly_factor_;
+  static std::atomic<bool> pagemap_leaf_cache_;
+  static std::atomic<bool> transfer_cache_miss_history_;
+  static std::atomic<int32_t> transfer_cache_capacity_scale_;
+  static std::atomic<int64_t> deferred_free_threshold_;
+  static std::atomic<int64_t> sized_delete_mismatch_check_interval_;
+  static std::atomic<bool> large_span_cache_enabled_;
+  static std::atomic<double> memory_pressure_avg10_threshold_;
+  static std::atomic<bool> unified_eviction_planner_;
 };
 
+// Applies the named tuning profile -- a reviewed, internally consistent
+// bundle of parameter values -- atomically with respect to other profile
+// switches.  Returns false if name is not a known profile.  Backs
+// MallocExtension::SetTuningProfile().
+bool SetTuningProfile(absl::string_view name);
+
+// Name of the most recently applied tuning profile, or empty if none.
+absl::string_view ActiveTuningProfileName();
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -16,15 +16,19 @@
 
 #include <stdio.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 #include "absl/base/internal/spinlock.h"
 #include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/sampled_allocation.h"
+#include "tcmalloc/internal/stacktrace_filter.h"
 #include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/parameters.h"
 #include "tcmalloc/stack_trace_table.h"
@@ -35,9 +39,53 @@ namespace tcmalloc {
 namespace tcmalloc_internal {
 
 bool PeakHeapTracker::IsNewPeak() {
-  size_t current_peak_size = CurrentPeakSize();
+  const int64_t recent_ns = recent_peak_ns_.load(std::memory_order_relaxed);
+  if (absl::Now() - absl::FromUnixNanos(recent_ns) > kRecentPeakWindow) {
+    // No peak within the window; whatever is live now is the new in-window
+    // peak. The locked check rejects the degenerate empty heap.
+    return true;
+  }
+  const int64_t recent_size = recent_peak_size_.load(std::memory_order_relaxed);
   return (static_cast<double>(tc_globals.sampled_objects_size_.value()) >
-          current_peak_size * Parameters::peak_sampling_heap_growth_fraction());
+          recent_size * Parameters::peak_sampling_heap_growth_fraction());
+}
+
+bool PeakHeapTracker::IsNewPeakLocked(absl::Time now, int64_t sampled_size) {
+  int64_t in_window_max = 0;
+  for (const PeakRecord& peak : peaks_) {
+    if (peak.sampled_heap_size > 0 && now - peak.when <= kRecentPeakWindow) {
+      in_window_max = std::max(in_window_max, peak.sampled_heap_size);
+    }
+  }
+  return sampled_size > 0 &&
+         (static_cast<double>(sampled_size) >
+          in_window_max * Parameters::peak_sampling_heap_growth_fraction());
+}
+
+PeakHeapTracker::PeakRecord* PeakHeapTracker::VictimSlot(absl::Time now) {
+  PeakRecord* largest = nullptr;
+  for (PeakRecord& peak : peaks_) {
+    if (peak.sampled_heap_size == 0) {
+      return &peak;
+    }
+    if (largest == nullptr ||
+        peak.sampled_heap_size > largest->sampled_heap_size) {
+      largest = &peak;
+    }
+  }
+  PeakRecord* victim = nullptr;
+  for (PeakRecord& peak : peaks_) {
+    // Keep the all-time high so kPeakHeap stays meaningful.
+    if (&peak == largest) continue;
+    if (now - peak.when > kPeakRetention) {
+      return &peak;
+    }
+    if (victim == nullptr ||
+        peak.sampled_heap_size < victim->sampled_heap_size) {
+      victim = &peak;
+    }
+  }
+  return victim;
 }
 
 void PeakHeapTracker::MaybeSaveSample() {
@@ -47,32 +95,77 @@ void PeakHeapTracker::MaybeSaveSample() {
 
   AllocationGuardSpinLockHolder h(&recorder_lock_);
 
+  const absl::Time now = absl::Now();
+  const int64_t sampled_size = tc_globals.sampled_objects_size_.value();
   // double-check in case another allocation was sampled (or a sampled
   // allocation freed) while we were waiting for the lock
-  if (!IsNewPeak()) {
+  if (!IsNewPeakLocked(now, sampled_size)) {
     return;
   }
-  SetCurrentPeakSize(tc_globals.sampled_objects_size_.value());
+  if (sampled_size > static_cast<int64_t>(CurrentPeakSize())) {
+    SetCurrentPeakSize(sampled_size);
+  }
+
+  PeakRecord* record = VictimSlot(now);
+  record->sampled_heap_size = sampled_size;
+  record->when = now;
 
   // Guaranteed to have no live sample after this call since we are doing this
   // under `recorder_lock_`.
-  peak_heap_recorder_.get_mutable().UnregisterAll();
+  record->recorder.get_mutable().UnregisterAll();
   tc_globals.sampled_allocation_recorder().Iterate(
-      [this](const SampledAllocation& sampled_allocation) {
+      [this, record](const SampledAllocation& sampled_allocation) {
         recorder_lock_.AssertHeld();
         StackTrace st = sampled_allocation.sampled_stack;
-        peak_heap_recorder_.get_mutable().Register(std::move(st));
+        record->recorder.get_mutable().RegisterOnShard(HashOfStackTrace(st),
+                                                       std::move(st));
       });
+
+  // Refresh the unlocked pre-filter's view of the in-window maximum.
+  int64_t in_window_max = 0;
+  absl::Time in_window_when = absl::UnixEpoch();
+  for (const PeakRecord& peak : peaks_) {
+    if (peak.sampled_heap_size > in_window_max &&
+        now - peak.when <= kRecentPeakWindow) {
+      in_window_max = peak.sampled_heap_size;
+      in_window_when = peak.when;
+    }
+  }
+  recent_peak_size_.store(in_window_max, std::memory_order_relaxed);
+  recent_peak_ns_.store(absl::ToUnixNanos(in_window_when),
+                        std::memory_order_relaxed);
 }
 
-std::unique_ptr<ProfileBase> PeakHeapTracker::DumpSample() {
-  auto profile = std::make_unique<StackTraceTable>(ProfileType::kPeakHeap);
+std::unique_ptr<ProfileBase> PeakHeapTracker::DumpSample(ProfileType type) {
+  auto profile = std::make_unique<StackTraceTable>(type);
+
+  absl::Time cutoff = absl::InfinitePast();
+  switch (type) {
+    case ProfileType::kPeakHeapLastHour:
+      cutoff = absl::Now() - kRecentPeakWindow;
+      break;
+    case ProfileType::kPeakHeapLastDay:
+      cutoff = absl::Now() - kPeakRetention;
+      break;
+    default:
+      // kPeakHeap: the largest peak still retained, regardless of age.
+      break;
+  }
 
   AllocationGuardSpinLockHolder h(&recorder_lock_);
-  peak_heap_recorder_.get_mutable().Iterate(
-      [&profile](const SampledAllocation& peak_heap_record) {
-        profile->AddTrace(1.0, peak_heap_record.sampled_stack);
-      });
+  PeakRecord* best = nullptr;
+  for (PeakRecord& peak : peaks_) {
+    if (peak.sampled_heap_size == 0 || peak.when < cutoff) continue;
+    if (best == nullptr || peak.sampled_heap_size > best->sampled_heap_size) {
+      best = &peak;
+    }
+  }
+  if (best != nullptr) {
+    best->recorder.get_mutable().Iterate(
+        [&profile](const SampledAllocation& peak_heap_record) {
+          profile->AddTrace(1.0, peak_heap_record.sampled_stack);
+        });
+  }
   return profile;
 }
 
@@ -23,6 +23,7 @@
 #include "absl/base/const_init.h"
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/config.h"
@@ -41,24 +42,30 @@ class PeakHeapTracker {
   constexpr PeakHeapTracker()
       : recorder_lock_(absl::kConstInit,
                        absl::base_internal::SCHEDULE_KERNEL_ONLY),
-        peak_heap_recorder_() {}
+        peaks_() {}
 
   void Init(Arena* arena) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock)
       ABSL_LOCKS_EXCLUDED(recorder_lock_) {
     peak_heap_record_allocator_.Init(arena);
     AllocationGuardSpinLockHolder h(&recorder_lock_);
-    peak_heap_recorder_.Construct(&peak_heap_record_allocator_);
-    peak_heap_recorder_.get_mutable().Init();
+    for (PeakRecord& peak : peaks_) {
+      peak.recorder.Construct(&peak_heap_record_allocator_);
+      peak.recorder.get_mutable().Init();
+    }
   }
 
   // Possibly save high-water-mark allocation stack traces for peak-heap
   // profile. Should be called immediately after sampling an allocation. If
-  // the heap has grown by a sufficient amount since the last high-water-mark,
-  // it will save a copy of the sample profile.
+  // the heap has grown by a sufficient amount over the largest peak recorded
+  // within the trailing window, it will save a copy of the sample profile
+  // into the peak ring.
   void MaybeSaveSample() ABSL_LOCKS_EXCLUDED(recorder_lock_);
 
-  // Return the saved high-water-mark heap profile, if any.
-  std::unique_ptr<ProfileBase> DumpSample() ABSL_LOCKS_EXCLUDED(recorder_lock_);
+  // Return a saved peak heap profile, if any. ProfileType::kPeakHeap reports
+  // the largest peak still retained; kPeakHeapLastHour and kPeakHeapLastDay
+  // report the largest peak recorded within the trailing hour or day.
+  std::unique_ptr<ProfileBase> DumpSample(ProfileType type)
+      ABSL_LOCKS_EXCLUDED(recorder_lock_);
 
   size_t CurrentPeakSize() const {
     return do_not_access_directly_peak_sampled_heap_size_.load(
@@ -66,6 +73,22 @@ class PeakHeapTracker {
   }
 
  private:
+  // Number of distinct peaks retained. A long-lived process typically sees a
+  // handful of load plateaus (the daily peak, deploy spikes, the all-time
+  // high); a few slots cover the structure capacity planning looks at
+  // without keeping many sampled stack trace copies alive.
+  static constexpr int kPeakRingSize = 4;
+
+  // Trailing window that a new peak competes against in MaybeSaveSample (and
+  // that kPeakHeapLastHour reports on). Outside the window a peak no longer
+  // suppresses snapshots, so after a quiet hour the tracker re-learns the
+  // current peak instead of comparing against a stale maximum forever.
+  static constexpr absl::Duration kRecentPeakWindow = absl::Hours(1);
+
+  // Peaks older than this are preferred victims when the ring is full; they
+  // have aged out of every reported window except kPeakHeap itself.
+  static constexpr absl::Duration kPeakRetention = absl::Hours(24);
+
   void SetCurrentPeakSize(int64_t value)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(recorder_lock_) {
     return do_not_access_directly_peak_sampled_heap_size_.store(
@@ -75,26 +98,53 @@ class PeakHeapTracker {
   using PeakHeapRecorder =
       SampleRecorder<SampledAllocation, SampledAllocationAllocator>;
 
+  // One retained peak: the stack traces of the samples that were live at the
+  // peak, the sampled heap size, and when it was recorded.
+  // PeakHeapRecorder is based off
+  // `tcmalloc::tcmalloc_internal::SampleRecorder`, which is mainly used as
+  // the allocator and also for iteration here. It reuses memory so we don't
+  // have to take the pageheap_lock every time for allocation.
+  // `SampleRecorder` has a non-trivial destructor. So wrapping
+  // `ExplicitlyConstructed` around it to make the destructor never run.
+  struct PeakRecord {
+    ExplicitlyConstructed<PeakHeapRecorder> recorder;
+    // Sampled heap size at the peak; zero marks a slot that has never been
+    // used.
+    int64_t sampled_heap_size = 0;
+    absl::Time when;
+  };
+
+  // True if the current sampled heap size exceeds the growth fraction over
+  // the largest peak recorded within kRecentPeakWindow. The unlocked
+  // overload is a racy pre-filter based on the hint atomics below; the
+  // locked overload consults the ring.
+  bool IsNewPeak();
+  bool IsNewPeakLocked(absl::Time now, int64_t sampled_size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(recorder_lock_);
+
+  // Picks the slot a new peak overwrites: an empty slot, else an aged-out
+  // entry, else the smallest peak -- but never the largest retained one, so
+  // ProfileType::kPeakHeap keeps reporting the all-time high.
+  PeakRecord* VictimSlot(absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(recorder_lock_);
+
   SampledAllocationAllocator peak_heap_record_allocator_;
 
-  // Guards the peak heap samples stored in `peak_heap_recorder_`.
+  // Guards the peak heap samples stored in `peaks_`.
   absl::base_internal::SpinLock recorder_lock_;
 
-  // Linked list that stores the stack traces of the sampled allocation saved
-  // when we allocate memory from the system.
-  // PeakHeapRecorder is based off `tcmalloc::tcmalloc_internal::SampleRecorder`
-  // , which is mainly used as the allocator and also for iteration here. It
-  // reuses memory so we don't have to take the pageheap_lock every time for
-  // allocation. `SampleRecorder` has a non-trivial destructor. So wrapping
-  // `ExplicitlyConstructed` around it to make the destructor never run.
-  ExplicitlyConstructed<PeakHeapRecorder> peak_heap_recorder_
-      ABSL_GUARDED_BY(recorder_lock_);
+  // Ring of the top distinct peaks still retained.
+  PeakRecord peaks_[kPeakRingSize] ABSL_GUARDED_BY(recorder_lock_);
 
-  // Sampled heap size last time peak_heap_recorder_ was saved. Only written
-  // under `recorder_lock_`; may be read without it.
+  // Largest sampled heap size ever recorded (the monotone high-water mark
+  // reported in stats). Only written under `recorder_lock_`; may be read
+  // without it.
   std::atomic<int64_t> do_not_access_directly_peak_sampled_heap_size_{0};
 
-  bool IsNewPeak();
+  // Hint mirroring the largest in-window peak so IsNewPeak() can pre-filter
+  // without the lock. Only written under `recorder_lock_`.
+  std::atomic<int64_t> recent_peak_size_{0};
+  std::atomic<int64_t> recent_peak_ns_{0};
 };
 
 }  // namespace tcmalloc_internal
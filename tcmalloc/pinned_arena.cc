@@ -0,0 +1,140 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/pinned_arena.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/base/attributes.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/page_size.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+ABSL_CONST_INIT thread_local int pinned_scope_depth
+    ABSL_ATTRIBUTE_INITIAL_EXEC = 0;
+ABSL_CONST_INIT std::atomic<bool> PinnedArena::any_active_{false};
+
+int PinnedArena::BucketIndex(size_t block_bytes) {
+  size_t rounded = BucketBytes(0);
+  for (int bucket = 0; bucket < kNumBuckets; ++bucket, rounded <<= 1) {
+    if (block_bytes <= rounded) return bucket;
+  }
+  return -1;
+}
+
+size_t PinnedArena::AllocatedSize(size_t size) {
+  const int bucket = BucketIndex(std::max(size, size_t{1}) + kHeaderBytes);
+  if (bucket < 0) return 0;
+  return BucketBytes(bucket) - kHeaderBytes;
+}
+
+bool PinnedArena::Activate(size_t bytes) {
+  if (bytes == 0) return false;
+  const size_t page_size = GetPageSize();
+  const size_t capacity = (bytes + page_size - 1) & ~(page_size - 1);
+
+  AllocationGuardSpinLockHolder h(&lock_);
+  if (start_.load(std::memory_order_relaxed) != 0) {
+    // Already active; the region is not resized after the fact.
+    return true;
+  }
+  void* region = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    return false;
+  }
+  // mlock() faults every page in and pins it resident, so allocations from
+  // the region can never take a major fault.  Failure is usually
+  // RLIMIT_MEMLOCK; stay inactive rather than hand out unpinned memory.
+  if (mlock(region, capacity) != 0) {
+    munmap(region, capacity);
+    return false;
+  }
+  cursor_ = 0;
+  capacity_.store(capacity, std::memory_order_relaxed);
+  start_.store(reinterpret_cast<uintptr_t>(region), std::memory_order_relaxed);
+  any_active_.store(true, std::memory_order_release);
+  return true;
+}
+
+void* PinnedArena::Allocate(size_t size) {
+  const int bucket = BucketIndex(std::max(size, size_t{1}) + kHeaderBytes);
+  const uintptr_t start = start_.load(std::memory_order_relaxed);
+  if (ABSL_PREDICT_FALSE(bucket < 0 || start == 0)) {
+    overflow_count_.Add(1);
+    return nullptr;
+  }
+  const size_t block = BucketBytes(bucket);
+  unsigned char* payload;
+  {
+    AllocationGuardSpinLockHolder h(&lock_);
+    if (void* head = freelists_[bucket]) {
+      freelists_[bucket] = *static_cast<void**>(head);
+      payload = static_cast<unsigned char*>(head);
+    } else {
+      const size_t capacity = capacity_.load(std::memory_order_relaxed);
+      if (block > capacity - cursor_) {
+        overflow_count_.Add(1);
+        return nullptr;
+      }
+      payload = reinterpret_cast<unsigned char*>(start) + cursor_ +
+                kHeaderBytes;
+      cursor_ += block;
+    }
+  }
+  // The bucket index in the header is all Free() needs to recycle the block.
+  memcpy(payload - kHeaderBytes, &bucket, sizeof(bucket));
+  used_bytes_.fetch_add(block, std::memory_order_relaxed);
+  return payload;
+}
+
+bool PinnedArena::Owns(const void* ptr) const {
+  const uintptr_t start = start_.load(std::memory_order_relaxed);
+  const uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
+  return start != 0 && p >= start &&
+         p < start + capacity_.load(std::memory_order_relaxed);
+}
+
+bool PinnedArena::FreeSlow(void* ptr) {
+  if (!Owns(ptr)) {
+    return false;
+  }
+  unsigned char* payload = static_cast<unsigned char*>(ptr);
+  int bucket;
+  memcpy(&bucket, payload - kHeaderBytes, sizeof(bucket));
+  TC_CHECK(bucket >= 0 && bucket < kNumBuckets,
+           "Invalid free of pinned arena block");
+  {
+    AllocationGuardSpinLockHolder h(&lock_);
+    *reinterpret_cast<void**>(payload) = freelists_[bucket];
+    freelists_[bucket] = payload;
+  }
+  used_bytes_.fetch_sub(BucketBytes(bucket), std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
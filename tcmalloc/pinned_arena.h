@@ -0,0 +1,143 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_PINNED_ARENA_H_
+#define TCMALLOC_PINNED_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "tcmalloc/internal/atomic_stats_counter.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Depth of nested pinned-allocation scopes on the calling thread; see
+// MallocExtension::ScopedPinnedAllocation.  Initial-exec keeps the fast-path
+// access a direct TLS load.
+ABSL_CONST_INIT extern thread_local int pinned_scope_depth
+    ABSL_ATTRIBUTE_INITIAL_EXEC;
+
+// An mlocked, pre-faulted region serving latency-critical paths that cannot
+// afford a page fault.  Activate() maps and locks the region up front;
+// allocations made inside a pinned scope come from it, so they touch only
+// resident memory.  The region is carved into power-of-two blocks recycled
+// through per-bucket freelists under a non-cooperative spinlock: bounded
+// work, no syscalls, no faults.
+//
+// The arena is a hard cap, not a reservation that grows: when a request does
+// not fit, Allocate() returns nullptr, the caller falls back to normal
+// memory, and overflow_count() records that the guarantee was missed -- we
+// would rather know than block.
+class PinnedArena {
+ public:
+  // Block payloads are at least this large and this aligned; a one-word
+  // (padded) header precedes each payload.
+  static constexpr size_t kMinPayload = 16;
+  static constexpr size_t kHeaderBytes = alignof(std::max_align_t);
+
+  constexpr PinnedArena() = default;
+
+  // Maps, locks and thereby pre-faults a region of at least `bytes`
+  // (rounded up to whole pages).  Returns false and stays inactive when the
+  // mapping or mlock() fails -- typically RLIMIT_MEMLOCK -- or bytes is
+  // zero.  One-shot: once active, later calls return true without resizing.
+  bool Activate(size_t bytes);
+
+  bool active() const {
+    return any_active_.load(std::memory_order_relaxed);
+  }
+
+  // Allocates size bytes from the pinned region.  Returns nullptr -- and
+  // counts an overflow -- when the request cannot be satisfied or the arena
+  // is inactive; callers fall back to normal memory.
+  void* Allocate(size_t size);
+
+  // Usable bytes of the block Allocate(size) returns.
+  static size_t AllocatedSize(size_t size);
+
+  // Returns a block to the arena.  Returns false, freeing nothing, when ptr
+  // is not from the pinned region; the regular free paths use this to
+  // divert arena blocks before consulting span metadata they do not have.
+  // Cheap while no arena is active: a single load.
+  bool Free(void* ptr) {
+    if (ABSL_PREDICT_TRUE(!any_active_.load(std::memory_order_acquire))) {
+      return false;
+    }
+    return FreeSlow(ptr);
+  }
+
+  // True iff ptr lies within the pinned region.
+  bool Owns(const void* ptr) const;
+
+  size_t capacity_bytes() const {
+    return capacity_.load(std::memory_order_relaxed);
+  }
+  size_t used_bytes() const {
+    return used_bytes_.load(std::memory_order_relaxed);
+  }
+  uint64_t overflow_count() const { return overflow_count_.value(); }
+
+  // True only when an arena is active and the calling thread is inside a
+  // pinned scope; the allocation fast path tests this before routing.  The
+  // global flag goes first so threads that never pin pay one predictable
+  // load, not a TLS access.
+  static bool InScope() {
+    return any_active_.load(std::memory_order_relaxed) &&
+           pinned_scope_depth > 0;
+  }
+
+  static void EnterScope() { ++pinned_scope_depth; }
+  static void ExitScope() { --pinned_scope_depth; }
+
+ private:
+  // Power-of-two block sizes from kMinPayload + kHeaderBytes up; 26 buckets
+  // cover blocks to 1 GiB, far beyond any plausible arena.
+  static constexpr int kNumBuckets = 26;
+
+  static int BucketIndex(size_t block_bytes);
+  static constexpr size_t BucketBytes(int bucket) {
+    return (kMinPayload + kHeaderBytes) << bucket;
+  }
+
+  bool FreeSlow(void* ptr);
+
+  absl::base_internal::SpinLock lock_{
+      absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY};
+  std::atomic<uintptr_t> start_{0};
+  std::atomic<size_t> capacity_{0};
+  std::atomic<size_t> used_bytes_{0};
+  size_t cursor_ ABSL_GUARDED_BY(lock_) = 0;
+  void* freelists_[kNumBuckets] ABSL_GUARDED_BY(lock_) = {};
+  StatsCounter overflow_count_;
+
+  // Set (with release) by the first successful Activate() anywhere, so the
+  // fast-path scope test and the free-path diversion stay a predicted-false
+  // branch in processes that never pin.
+  ABSL_CONST_INIT static std::atomic<bool> any_active_;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_PINNED_ARENA_H_
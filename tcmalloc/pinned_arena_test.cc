@@ -0,0 +1,151 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/pinned_arena.h"
+
+#include <stdlib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/static_vars.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+constexpr size_t kArenaBytes = 1 << 20;
+
+// Activation mlocks the region, which RLIMIT_MEMLOCK can forbid; skip rather
+// than fail where the environment denies pinning.
+bool ActivateOrSkip() {
+  return MallocExtension::ActivatePinnedArena(kArenaBytes);
+}
+
+TEST(PinnedArenaTest, AllocateAndRecycle) {
+  if (!ActivateOrSkip()) GTEST_SKIP() << "mlock not permitted";
+  PinnedArena& arena = tc_globals.pinned_arena();
+
+  void* p = arena.Allocate(100);
+  ASSERT_NE(p, nullptr);
+  EXPECT_TRUE(arena.Owns(p));
+  // The full carved capacity is usable.
+  memset(p, 0xa5, PinnedArena::AllocatedSize(100));
+  const size_t used = arena.used_bytes();
+  EXPECT_GT(used, 0);
+
+  ASSERT_TRUE(arena.Free(p));
+  EXPECT_LT(arena.used_bytes(), used);
+
+  // A freed block recycles through its bucket's freelist.
+  void* q = arena.Allocate(100);
+  EXPECT_EQ(q, p);
+  ASSERT_TRUE(arena.Free(q));
+
+  // Foreign pointers are refused.
+  int local;
+  EXPECT_FALSE(arena.Free(&local));
+}
+
+TEST(PinnedArenaTest, ScopeRoutesAllocations) {
+  if (!ActivateOrSkip()) GTEST_SKIP() << "mlock not permitted";
+  PinnedArena& arena = tc_globals.pinned_arena();
+
+  void* outside = ::operator new(64);
+  EXPECT_FALSE(arena.Owns(outside));
+  ::operator delete(outside);
+
+  void* inside;
+  {
+    MallocExtension::ScopedPinnedAllocation scope;
+    inside = ::operator new(64);
+  }
+  ASSERT_NE(inside, nullptr);
+  EXPECT_TRUE(arena.Owns(inside));
+  // Arena blocks release through the ordinary free paths.
+  ::operator delete(inside);
+
+  {
+    MallocExtension::ScopedPinnedAllocation scope;
+    inside = malloc(64);
+  }
+  ASSERT_NE(inside, nullptr);
+  EXPECT_TRUE(arena.Owns(inside));
+  free(inside);
+}
+
+TEST(PinnedArenaTest, OveralignedAllocationsBypassArena) {
+  if (!ActivateOrSkip()) GTEST_SKIP() << "mlock not permitted";
+  PinnedArena& arena = tc_globals.pinned_arena();
+
+  // Arena payloads are only kMinPayload-aligned, so stricter requests must
+  // route to normal memory rather than come back misaligned.
+  void* aligned;
+  {
+    MallocExtension::ScopedPinnedAllocation scope;
+    aligned = ::operator new(64, static_cast<std::align_val_t>(64));
+  }
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+  EXPECT_FALSE(arena.Owns(aligned));
+  ::operator delete(aligned, static_cast<std::align_val_t>(64));
+
+  {
+    MallocExtension::ScopedPinnedAllocation scope;
+    ASSERT_EQ(posix_memalign(&aligned, 128, 64), 0);
+  }
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 128, 0);
+  EXPECT_FALSE(arena.Owns(aligned));
+  free(aligned);
+}
+
+TEST(PinnedArenaTest, OverflowFallsBackAndCounts) {
+  if (!ActivateOrSkip()) GTEST_SKIP() << "mlock not permitted";
+  PinnedArena& arena = tc_globals.pinned_arena();
+
+  const uint64_t overflows = arena.overflow_count();
+  void* p;
+  {
+    MallocExtension::ScopedPinnedAllocation scope;
+    // Larger than the whole arena: must fall back to normal memory.
+    p = ::operator new(2 * kArenaBytes);
+  }
+  ASSERT_NE(p, nullptr);
+  EXPECT_FALSE(arena.Owns(p));
+  EXPECT_GT(arena.overflow_count(), overflows);
+  ::operator delete(p);
+
+  std::optional<size_t> property =
+      MallocExtension::GetNumericProperty("tcmalloc.pinned_arena_overflows");
+  ASSERT_TRUE(property.has_value());
+  EXPECT_EQ(*property, arena.overflow_count());
+}
+
+TEST(PinnedArenaTest, ReportsCapacity) {
+  if (!ActivateOrSkip()) GTEST_SKIP() << "mlock not permitted";
+
+  std::optional<size_t> capacity =
+      MallocExtension::GetNumericProperty("tcmalloc.pinned_arena_bytes");
+  ASSERT_TRUE(capacity.has_value());
+  EXPECT_GE(*capacity, kArenaBytes);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -14,10 +14,18 @@
 
 #include "tcmalloc/profile_marshaler.h"
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "google/protobuf/io/gzip_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "absl/base/casts.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/profile_builder.h"
 
 namespace tcmalloc {
@@ -43,4 +51,160 @@ absl::StatusOr<std::string> Marshal(const tcmalloc::Profile& profile) {
   return output;
 }
 
+namespace {
+
+constexpr absl::string_view kRawProfileHeader = "tcmalloc-raw-profile v1\n";
+
+void AppendWord(std::string& out, uint64_t value) {
+  char bytes[sizeof(value)];
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    bytes[i] = static_cast<char>(value >> (8 * i));
+  }
+  out.append(bytes, sizeof(bytes));
+}
+
+void AppendLengthPrefixed(std::string& out, absl::string_view sv) {
+  AppendWord(out, sv.size());
+  out.append(sv.data(), sv.size());
+}
+
+// Emits the raw format into a fixed caller-provided buffer.  Writes past the
+// end are dropped and latch the overflow flag, so emission can run to
+// completion (Iterate offers no early exit) and report failure once.
+class RawBufferWriter {
+ public:
+  explicit RawBufferWriter(absl::Span<char> buffer) : buffer_(buffer) {}
+
+  void Append(absl::string_view bytes) {
+    if (bytes.size() > buffer_.size() - pos_) {
+      overflowed_ = true;
+      return;
+    }
+    memcpy(buffer_.data() + pos_, bytes.data(), bytes.size());
+    pos_ += bytes.size();
+  }
+
+  void AppendWord(uint64_t value) {
+    char bytes[sizeof(value)];
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      bytes[i] = static_cast<char>(value >> (8 * i));
+    }
+    Append(absl::string_view(bytes, sizeof(bytes)));
+  }
+
+  void AppendLengthPrefixed(absl::string_view sv) {
+    AppendWord(sv.size());
+    Append(sv);
+  }
+
+  // Overwrites the word previously appended at offset.
+  void PatchWord(size_t offset, uint64_t value) {
+    TC_ASSERT_LE(offset + sizeof(value), pos_);
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      buffer_[offset + i] = static_cast<char>(value >> (8 * i));
+    }
+  }
+
+  size_t written() const { return pos_; }
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  absl::Span<char> buffer_;
+  size_t pos_ = 0;
+  bool overflowed_ = false;
+};
+
+}  // namespace
+
+absl::StatusOr<std::string> MarshalRaw(const tcmalloc::Profile& profile) {
+  // Captured once per process; see GetProcessMappings.
+  const std::vector<tcmalloc_internal::MappingInfo>& mappings =
+      tcmalloc_internal::GetProcessMappings();
+
+  std::string output;
+  output.append(kRawProfileHeader.data(), kRawProfileHeader.size());
+  AppendWord(output, static_cast<uint64_t>(profile.Type()));
+  AppendWord(output,
+             static_cast<uint64_t>(absl::ToInt64Nanoseconds(profile.Duration())));
+
+  AppendWord(output, mappings.size());
+  for (const tcmalloc_internal::MappingInfo& mapping : mappings) {
+    AppendWord(output, mapping.memory_start);
+    AppendWord(output, mapping.memory_limit);
+    AppendWord(output, mapping.file_offset);
+    AppendLengthPrefixed(output, mapping.filename);
+    AppendLengthPrefixed(output, mapping.build_id);
+  }
+
+  // The sample count is not known until Iterate completes, so reserve its slot
+  // and patch it afterwards.
+  const size_t sample_count_offset = output.size();
+  AppendWord(output, 0);
+  uint64_t sample_count = 0;
+  profile.Iterate([&](const tcmalloc::Profile::Sample& entry) {
+    ++sample_count;
+    AppendWord(output, static_cast<uint64_t>(entry.count));
+    AppendWord(output, static_cast<uint64_t>(entry.sum));
+    AppendWord(output, entry.requested_size);
+    AppendWord(output, entry.allocated_size);
+    AppendWord(output, entry.depth);
+    for (int i = 0; i < entry.depth; ++i) {
+      AppendWord(output, absl::bit_cast<uintptr_t>(entry.stack[i]));
+    }
+  });
+
+  char patched[sizeof(uint64_t)];
+  for (size_t i = 0; i < sizeof(patched); ++i) {
+    patched[i] = static_cast<char>(sample_count >> (8 * i));
+  }
+  memcpy(&output[sample_count_offset], patched, sizeof(patched));
+
+  return output;
+}
+
+absl::StatusOr<size_t> MarshalRawToBuffer(const tcmalloc::Profile& profile,
+                                          absl::Span<char> buffer) {
+  // Captured once per process; see GetProcessMappings.
+  const std::vector<tcmalloc_internal::MappingInfo>& mappings =
+      tcmalloc_internal::GetProcessMappings();
+
+  RawBufferWriter writer(buffer);
+  writer.Append(kRawProfileHeader);
+  writer.AppendWord(static_cast<uint64_t>(profile.Type()));
+  writer.AppendWord(
+      static_cast<uint64_t>(absl::ToInt64Nanoseconds(profile.Duration())));
+
+  writer.AppendWord(mappings.size());
+  for (const tcmalloc_internal::MappingInfo& mapping : mappings) {
+    writer.AppendWord(mapping.memory_start);
+    writer.AppendWord(mapping.memory_limit);
+    writer.AppendWord(mapping.file_offset);
+    writer.AppendLengthPrefixed(mapping.filename);
+    writer.AppendLengthPrefixed(mapping.build_id);
+  }
+
+  // As in MarshalRaw, the sample count slot is reserved and patched once
+  // Iterate completes.
+  const size_t sample_count_offset = writer.written();
+  writer.AppendWord(0);
+  uint64_t sample_count = 0;
+  profile.Iterate([&](const tcmalloc::Profile::Sample& entry) {
+    ++sample_count;
+    writer.AppendWord(static_cast<uint64_t>(entry.count));
+    writer.AppendWord(static_cast<uint64_t>(entry.sum));
+    writer.AppendWord(entry.requested_size);
+    writer.AppendWord(entry.allocated_size);
+    writer.AppendWord(entry.depth);
+    for (int i = 0; i < entry.depth; ++i) {
+      writer.AppendWord(absl::bit_cast<uintptr_t>(entry.stack[i]));
+    }
+  });
+
+  if (writer.overflowed()) {
+    return absl::ResourceExhaustedError("buffer too small for raw profile");
+  }
+  writer.PatchWord(sample_count_offset, sample_count);
+  return writer.written();
+}
+
 }  // namespace tcmalloc
@@ -15,9 +15,11 @@
 #ifndef TCMALLOC_PROFILE_MARSHALER_H_
 #define TCMALLOC_PROFILE_MARSHALER_H_
 
+#include <cstddef>
 #include <string>
 
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "tcmalloc/malloc_extension.h"
 
 namespace tcmalloc {
@@ -27,6 +29,31 @@ namespace tcmalloc {
 // (https://github.com/google/pprof).
 absl::StatusOr<std::string> Marshal(const tcmalloc::Profile& profile);
 
+// MarshalRaw converts a Profile instance into a compact binary representation
+// containing the sample stacks as bare PCs plus the process mapping table,
+// with no symbolization, proto conversion, or compression performed
+// in-process.  It is intended for profile collectors that symbolize
+// off-process; use Marshal for profiles viewed directly with PProf.
+//
+// The format is a header line ("tcmalloc-raw-profile v1\n") followed by
+// little-endian 64-bit words: the profile type and duration in nanoseconds,
+// the mapping table (count, then per mapping start/limit/file offset and
+// length-prefixed filename and build ID), and the samples (count, then per
+// sample the allocation count, byte sum, requested size, allocated size, and
+// length-prefixed stack of PCs).
+absl::StatusOr<std::string> MarshalRaw(const tcmalloc::Profile& profile);
+
+// Serializes profile in the same raw format as MarshalRaw, but directly into
+// the caller-provided buffer -- typically a mapped region or memfd the
+// collector hands over -- so emission performs no allocations of its own and
+// does not perturb the allocator state being measured.  (The one exception is
+// the process mapping table, which is captured and cached on the first
+// profile emitted; emit a throwaway profile at startup to front-load it.)
+// Returns the number of bytes written, or ResourceExhaustedError if the
+// buffer is too small; the buffer contents are unspecified on failure.
+absl::StatusOr<size_t> MarshalRawToBuffer(const tcmalloc::Profile& profile,
+                                          absl::Span<char> buffer);
+
 }  // namespace tcmalloc
 
 #endif  // TCMALLOC_PROFILE_MARSHALER_H_
@@ -15,6 +15,7 @@
 #include <stddef.h>
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <new>
 #include <optional>
@@ -284,6 +285,46 @@ TEST(AllocationSampleTest, SampleAccuracy) {
   }
 }
 
+TEST(HeapProfileDeltaTest, TracksChurn) {
+  // Allocations this large are always sampled, so the deltas below are
+  // deterministic.
+  static const size_t kSize = 512 * 1024 * 1024;
+
+  // Establish a baseline and a generation token.
+  uint64_t generation = 0;
+  MallocExtension::SnapshotHeapProfileSince(&generation);
+
+#if defined(UNDEFINED_BEHAVIOR_SANITIZER)
+  // UBSan does not implement our profiling API.
+  (void)kSize;
+#else
+  ASSERT_NE(generation, 0);
+
+  void* ptr = ::operator new(kSize);
+  benchmark::DoNotOptimize(ptr);
+
+  auto CountDelta = [&] {
+    auto profile = MallocExtension::SnapshotHeapProfileSince(&generation);
+    int64_t count = 0;
+    profile.Iterate([&](const Profile::Sample& e) {
+      if (e.requested_size == kSize) count += e.count;
+    });
+    return count;
+  };
+
+  // The new allocation appears in the delta exactly once...
+  EXPECT_EQ(CountDelta(), 1);
+  // ...and is not reported again by the next delta.
+  EXPECT_EQ(CountDelta(), 0);
+
+  ::operator delete(ptr);
+
+  // The free appears as a cancelling entry with negative count.
+  EXPECT_EQ(CountDelta(), -1);
+  ASSERT_NE(generation, 0);
+#endif
+}
+
 TEST(FragmentationzTest, Accuracy) {
   // Increase sampling rate to decrease flakiness.
   ScopedProfileSamplingRate ps(512 * 1024);
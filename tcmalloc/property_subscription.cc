@@ -0,0 +1,160 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/property_subscription.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/base/attributes.h"
+#include "absl/base/internal/spinlock.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tcmalloc/global_stats.h"
+#include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Enough for every property emitted by GetProperties today, with room to
+// spare.
+constexpr size_t kMaxPropertyNameLength = 64;
+constexpr int kMaxPropertySubscriptions = 16;
+
+ABSL_CONST_INIT absl::base_internal::SpinLock subscription_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+// A fixed table of subscription slots; monitoring clients register a handful
+// of properties, not hundreds, and a fixed table keeps registration
+// allocation-free.  Slots are protected by subscription_lock; the property
+// sample and the callback run with the lock dropped, and generation_ detects
+// a slot that was unsubscribed (and possibly reused) in the meantime.
+struct Subscription {
+  bool active = false;
+  uint64_t generation = 0;
+  char name[kMaxPropertyNameLength];
+  size_t name_size = 0;
+  size_t threshold = 0;
+  absl::Duration period;
+  PropertyChangeCallback callback = nullptr;
+  // The value delivered by the last callback (initially the baseline sampled
+  // at subscription).
+  size_t last_value = 0;
+  absl::Time last_sample = absl::InfinitePast();
+};
+ABSL_CONST_INIT Subscription subscriptions[kMaxPropertySubscriptions]
+    ABSL_GUARDED_BY(subscription_lock);
+
+}  // namespace
+
+int SubscribeProperty(absl::string_view property, size_t threshold,
+                      absl::Duration period, PropertyChangeCallback callback) {
+  if (callback == nullptr || property.empty() ||
+      property.size() > kMaxPropertyNameLength) {
+    return -1;
+  }
+
+  // Sample the baseline outside the lock.  This also validates the name:
+  // subscribing to a property GetNumericProperty does not serve fails here
+  // rather than silently never firing.
+  size_t baseline;
+  if (!GetNumericProperty(property.data(), property.size(), &baseline)) {
+    return -1;
+  }
+
+  AllocationGuardSpinLockHolder l(&subscription_lock);
+  for (int i = 0; i < kMaxPropertySubscriptions; ++i) {
+    Subscription& s = subscriptions[i];
+    if (s.active) {
+      continue;
+    }
+    s.active = true;
+    ++s.generation;
+    memcpy(s.name, property.data(), property.size());
+    s.name_size = property.size();
+    s.threshold = threshold;
+    s.period = period;
+    s.callback = callback;
+    s.last_value = baseline;
+    s.last_sample = absl::InfinitePast();
+    return i;
+  }
+  return -1;
+}
+
+void UnsubscribeProperty(int handle) {
+  if (handle < 0 || handle >= kMaxPropertySubscriptions) {
+    return;
+  }
+  AllocationGuardSpinLockHolder l(&subscription_lock);
+  Subscription& s = subscriptions[handle];
+  s.active = false;
+  ++s.generation;
+}
+
+void CheckPropertySubscriptions(absl::Time now) {
+  for (int i = 0; i < kMaxPropertySubscriptions; ++i) {
+    char name[kMaxPropertyNameLength];
+    size_t name_size;
+    size_t threshold;
+    size_t last_value;
+    PropertyChangeCallback callback;
+    uint64_t generation;
+    {
+      AllocationGuardSpinLockHolder l(&subscription_lock);
+      Subscription& s = subscriptions[i];
+      if (!s.active || now - s.last_sample < s.period) {
+        continue;
+      }
+      s.last_sample = now;
+      memcpy(name, s.name, s.name_size);
+      name_size = s.name_size;
+      threshold = s.threshold;
+      last_value = s.last_value;
+      callback = s.callback;
+      generation = s.generation;
+    }
+
+    size_t current;
+    if (!GetNumericProperty(name, name_size, &current)) {
+      continue;
+    }
+    const size_t moved =
+        current > last_value ? current - last_value : last_value - current;
+    if (moved < threshold) {
+      continue;
+    }
+
+    PropertyDelta delta;
+    delta.name = absl::string_view(name, name_size);
+    delta.previous_value = last_value;
+    delta.current_value = current;
+    callback(delta);
+
+    AllocationGuardSpinLockHolder l(&subscription_lock);
+    Subscription& s = subscriptions[i];
+    if (s.generation == generation) {
+      s.last_value = current;
+    }
+  }
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
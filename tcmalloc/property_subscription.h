@@ -0,0 +1,75 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Push-based monitoring for numeric malloc properties.  Instead of scraping
+// the full property map on a fixed schedule, a monitoring client subscribes
+// to a named property with a threshold and a sampling period; the background
+// thread samples just that property and invokes the client's callback with
+// the old and new values when the value has moved by at least the threshold.
+// A subscriber catches transients (e.g. a tcmalloc.page_heap_free spike)
+// within one period without paying for periodic full scrapes.
+
+#ifndef TCMALLOC_PROPERTY_SUBSCRIPTION_H_
+#define TCMALLOC_PROPERTY_SUBSCRIPTION_H_
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Change report passed to a subscription callback.
+struct PropertyDelta {
+  // The subscribed property name.  Only valid for the duration of the
+  // callback.
+  absl::string_view name;
+  // The value delivered by the previous callback, or the value sampled when
+  // the subscription was created if the callback has not fired yet.
+  size_t previous_value;
+  // The value that tripped the threshold.
+  size_t current_value;
+};
+
+// Invoked on the background thread when a subscribed property moves by at
+// least the subscription's threshold.  Allocating is safe, but the callback
+// delays all other background actions until it returns.
+using PropertyChangeCallback = void (*)(const PropertyDelta&);
+
+// Subscribes callback to property.  The background thread samples the
+// property once per period and fires the callback when the sampled value
+// differs from the last delivered value by at least threshold, in either
+// direction.  The current value is sampled immediately as the baseline.
+// Returns a handle for UnsubscribeProperty, or -1 if the property name is
+// unknown or too long, or all subscription slots are in use.
+int SubscribeProperty(absl::string_view property, size_t threshold,
+                      absl::Duration period, PropertyChangeCallback callback);
+
+// Cancels the subscription returned by SubscribeProperty.  Once this
+// returns, the callback may still be in flight on the background thread but
+// will not be invoked again.
+void UnsubscribeProperty(int handle);
+
+// Samples subscriptions whose period has elapsed and fires the callbacks
+// whose thresholds tripped.  Must only be called from the background thread.
+void CheckPropertySubscriptions(absl::Time now);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_PROPERTY_SUBSCRIPTION_H_
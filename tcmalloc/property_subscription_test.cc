@@ -0,0 +1,115 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/property_subscription.h"
+
+#include <stddef.h>
+
+#include <new>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+constexpr char kProperty[] = "generic.current_allocated_bytes";
+
+std::string last_name;
+size_t last_previous = 0;
+size_t last_current = 0;
+int fire_count = 0;
+
+void RecordDelta(const PropertyDelta& delta) {
+  last_name = std::string(delta.name);
+  last_previous = delta.previous_value;
+  last_current = delta.current_value;
+  ++fire_count;
+}
+
+TEST(PropertySubscriptionTest, RejectsUnknownProperty) {
+  EXPECT_EQ(
+      SubscribeProperty("no.such.property", 1, absl::Seconds(1), RecordDelta),
+      -1);
+}
+
+TEST(PropertySubscriptionTest, FiresOnThreshold) {
+  constexpr size_t kDelta = 1 << 20;
+  const int handle =
+      SubscribeProperty(kProperty, kDelta / 2, absl::ZeroDuration(),
+                        RecordDelta);
+  ASSERT_GE(handle, 0);
+
+  // Before the property moves by the threshold, sampling stays quiet.
+  CheckPropertySubscriptions(absl::Now());
+  EXPECT_EQ(fire_count, 0);
+
+  void* ptr = ::operator new(kDelta);
+  benchmark::DoNotOptimize(ptr);
+  CheckPropertySubscriptions(absl::Now());
+  ASSERT_EQ(fire_count, 1);
+  EXPECT_EQ(last_name, kProperty);
+  EXPECT_GE(last_current, last_previous + kDelta);
+
+  // The delivered value is the new comparison baseline.
+  CheckPropertySubscriptions(absl::Now());
+  EXPECT_EQ(fire_count, 1);
+
+  ::operator delete(ptr);
+  UnsubscribeProperty(handle);
+
+  // Unsubscribed slots are never sampled again.
+  void* ptr2 = ::operator new(kDelta);
+  benchmark::DoNotOptimize(ptr2);
+  CheckPropertySubscriptions(absl::Now());
+  EXPECT_EQ(fire_count, 1);
+  ::operator delete(ptr2);
+}
+
+TEST(PropertySubscriptionTest, HonorsSamplingPeriod) {
+  constexpr size_t kDelta = 1 << 20;
+  fire_count = 0;
+  const int handle =
+      SubscribeProperty(kProperty, kDelta / 2, absl::Hours(1), RecordDelta);
+  ASSERT_GE(handle, 0);
+
+  void* ptr = ::operator new(kDelta);
+  benchmark::DoNotOptimize(ptr);
+
+  // The first sample is due immediately; afterwards the subscription is left
+  // alone until its period elapses.
+  const absl::Time now = absl::Now();
+  CheckPropertySubscriptions(now);
+  ASSERT_EQ(fire_count, 1);
+
+  void* ptr2 = ::operator new(kDelta);
+  benchmark::DoNotOptimize(ptr2);
+  CheckPropertySubscriptions(now + absl::Seconds(1));
+  EXPECT_EQ(fire_count, 1);
+
+  CheckPropertySubscriptions(now + absl::Hours(2));
+  EXPECT_EQ(fire_count, 2);
+
+  ::operator delete(ptr);
+  ::operator delete(ptr2);
+  UnsubscribeProperty(handle);
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
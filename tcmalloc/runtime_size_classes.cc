@@ -0,0 +1,140 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/runtime_size_classes.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+
+#include "absl/strings/string_view.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/environment.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/util.h"
+#include "tcmalloc/size_class_info.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+int ParseSizeClasses(absl::string_view input, int max_classes,
+                     SizeClassInfo* parsed) {
+  parsed[0] = {0, 0, 0, 0};
+  int count = 1;
+  size_t pos = 0;
+  while (pos < input.size()) {
+    size_t eol = input.find('\n', pos);
+    absl::string_view line = input.substr(
+        pos, eol == absl::string_view::npos ? absl::string_view::npos
+                                            : eol - pos);
+    pos = eol == absl::string_view::npos ? input.size() : eol + 1;
+
+    const size_t comment = line.find('#');
+    if (comment != absl::string_view::npos) {
+      line = line.substr(0, comment);
+    }
+
+    uint64_t fields[5];
+    int num_fields = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+      const char c = line[i];
+      if (c == ' ' || c == '\t' || c == '\r') {
+        ++i;
+        continue;
+      }
+      if (c < '0' || c > '9' || num_fields == 5) {
+        Log(kLog, __FILE__, __LINE__, "malformed size class line", count);
+        return -1;
+      }
+      uint64_t value = 0;
+      while (i < line.size() && line[i] >= '0' && line[i] <= '9') {
+        value = value * 10 + (line[i] - '0');
+        if (value > std::numeric_limits<uint32_t>::max()) {
+          Log(kLog, __FILE__, __LINE__, "size class field overflows", count);
+          return -1;
+        }
+        ++i;
+      }
+      fields[num_fields++] = value;
+    }
+    if (num_fields == 0) {
+      // Blank or comment-only line.
+      continue;
+    }
+    if (num_fields != 4 && num_fields != 5) {
+      Log(kLog, __FILE__, __LINE__, "expected 4 or 5 size class fields, got",
+          num_fields);
+      return -1;
+    }
+    if (count >= max_classes) {
+      Log(kLog, __FILE__, __LINE__, "too many size classes", max_classes);
+      return -1;
+    }
+    // pages and num_to_move are stored in a byte apiece; out-of-range values
+    // would be rejected by SizeMap::Init anyway, but catch truncation here so
+    // the log points at the offending line.
+    if (fields[1] > std::numeric_limits<uint8_t>::max() ||
+        fields[2] > std::numeric_limits<uint8_t>::max()) {
+      Log(kLog, __FILE__, __LINE__, "size class field overflows", count);
+      return -1;
+    }
+    parsed[count] = {
+        .size = static_cast<uint32_t>(fields[0]),
+        .pages = static_cast<uint8_t>(fields[1]),
+        .num_to_move = static_cast<uint8_t>(fields[2]),
+        .max_capacity = static_cast<uint32_t>(fields[3]),
+        // The optional fifth field declares the alignment the class must
+        // guarantee; SizeMap::Init validates it against the class layout.
+        .alignment =
+            num_fields == 5 ? static_cast<uint32_t>(fields[4]) : uint32_t{0},
+    };
+    ++count;
+  }
+  return count > 1 ? count : -1;
+}
+
+int MaybeSizeClassesFromEnv(int max_classes, SizeClassInfo* parsed) {
+  const char* path = thread_safe_getenv("TCMALLOC_SIZE_CLASSES_FILE");
+  if (path == nullptr) {
+    return 0;
+  }
+  const int fd = signal_safe_open(path, O_RDONLY);
+  if (fd < 0) {
+    Log(kLog, __FILE__, __LINE__, "failed to open size class table", path);
+    return -1;
+  }
+  // This runs before the allocator is usable, so the table lands in a static
+  // buffer rather than heap memory.  SlowInitIfNecessary serializes callers.
+  static char buf[16 << 10];
+  size_t total = 0;
+  const ssize_t rc = signal_safe_read(fd, buf, sizeof(buf), &total);
+  signal_safe_close(fd);
+  if (rc < 0) {
+    Log(kLog, __FILE__, __LINE__, "failed to read size class table", path);
+    return -1;
+  }
+  if (total == sizeof(buf)) {
+    Log(kLog, __FILE__, __LINE__, "size class table too large", path);
+    return -1;
+  }
+  return ParseSizeClasses(absl::string_view(buf, total), max_classes, parsed);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,53 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Loads a size-class table supplied at runtime, so per-workload tables
+// generated offline (e.g. from fragmentation profiles) can be deployed
+// without recompiling.  A runtime table is subject to the same validation
+// in SizeMap::Init as the compiled-in tables.
+
+#ifndef TCMALLOC_RUNTIME_SIZE_CLASSES_H_
+#define TCMALLOC_RUNTIME_SIZE_CLASSES_H_
+
+#include "absl/strings/string_view.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/size_class_info.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Parses a serialized size-class table.  The format is one size class per
+// line, "size pages num_to_move max_capacity [alignment]" as
+// whitespace-separated decimal integers; blank lines and text following '#'
+// are ignored.  The optional fifth field declares the alignment the class
+// must guarantee (see SizeClassInfo::alignment).  Classes are
+// written to parsed[1..] in input order, and parsed[0] is zero-filled to
+// match the sentinel entry the compiled tables carry.  Returns the number of
+// populated entries (including the sentinel), or -1 if the input is
+// malformed, empty, or holds more than max_classes entries.
+int ParseSizeClasses(absl::string_view input, int max_classes,
+                     SizeClassInfo* parsed);
+
+// If the environment variable TCMALLOC_SIZE_CLASSES_FILE names a readable
+// file, parses its contents as above.  Returns the number of populated
+// entries, 0 if the variable is unset, or -1 on I/O or parse errors.  Runs
+// before the allocator is initialized, so it does not allocate.
+int MaybeSizeClassesFromEnv(int max_classes, SizeClassInfo* parsed);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_RUNTIME_SIZE_CLASSES_H_
@@ -0,0 +1,114 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/runtime_size_classes.h"
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/size_class_info.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+constexpr int kMaxClasses = 8;
+
+TEST(RuntimeSizeClassesTest, ParseWellFormedTable) {
+  SizeClassInfo parsed[kMaxClasses];
+  EXPECT_EQ(ParseSizeClasses("8 1 32 1024\n16 1 32 512\n", kMaxClasses,
+                             parsed),
+            3);
+  // Entry 0 is the zero-filled sentinel the compiled tables carry.
+  EXPECT_EQ(parsed[0].size, 0);
+  EXPECT_EQ(parsed[0].pages, 0);
+  EXPECT_EQ(parsed[1].size, 8);
+  EXPECT_EQ(parsed[1].pages, 1);
+  EXPECT_EQ(parsed[1].num_to_move, 32);
+  EXPECT_EQ(parsed[1].max_capacity, 1024);
+  EXPECT_EQ(parsed[2].size, 16);
+  EXPECT_EQ(parsed[2].max_capacity, 512);
+}
+
+TEST(RuntimeSizeClassesTest, SkipsCommentsAndBlankLines) {
+  SizeClassInfo parsed[kMaxClasses];
+  EXPECT_EQ(ParseSizeClasses("# generated from fragmentation profile\n"
+                             "\n"
+                             "8 1 32 1024  # trailing comment\n",
+                             kMaxClasses, parsed),
+            2);
+  EXPECT_EQ(parsed[1].size, 8);
+}
+
+TEST(RuntimeSizeClassesTest, OptionalAlignmentField) {
+  SizeClassInfo parsed[kMaxClasses];
+  EXPECT_EQ(ParseSizeClasses("8 1 32 1024\n4096 1 16 256 4096\n", kMaxClasses,
+                             parsed),
+            3);
+  // Omitted alignment means no requirement beyond the natural one.
+  EXPECT_EQ(parsed[1].alignment, 0);
+  EXPECT_EQ(parsed[2].size, 4096);
+  EXPECT_EQ(parsed[2].alignment, 4096);
+  // A sixth field is malformed.
+  EXPECT_EQ(ParseSizeClasses("8 1 32 1024 8 0\n", kMaxClasses, parsed), -1);
+}
+
+TEST(RuntimeSizeClassesTest, MissingNewlineOnLastLine) {
+  SizeClassInfo parsed[kMaxClasses];
+  EXPECT_EQ(ParseSizeClasses("8 1 32 1024", kMaxClasses, parsed), 2);
+  EXPECT_EQ(parsed[1].size, 8);
+}
+
+TEST(RuntimeSizeClassesTest, RejectsMalformedInput) {
+  SizeClassInfo parsed[kMaxClasses];
+  // Wrong field count.
+  EXPECT_EQ(ParseSizeClasses("8 1 32\n", kMaxClasses, parsed), -1);
+  // Non-numeric field.
+  EXPECT_EQ(ParseSizeClasses("8 1 32 x\n", kMaxClasses, parsed), -1);
+  // Empty input.
+  EXPECT_EQ(ParseSizeClasses("", kMaxClasses, parsed), -1);
+  EXPECT_EQ(ParseSizeClasses("# only a comment\n", kMaxClasses, parsed), -1);
+}
+
+TEST(RuntimeSizeClassesTest, RejectsOverflowingFields) {
+  SizeClassInfo parsed[kMaxClasses];
+  // size exceeds uint32_t.
+  EXPECT_EQ(ParseSizeClasses("4294967296 1 32 1024\n", kMaxClasses, parsed),
+            -1);
+  // pages and num_to_move are stored in a byte apiece.
+  EXPECT_EQ(ParseSizeClasses("8 256 32 1024\n", kMaxClasses, parsed), -1);
+  EXPECT_EQ(ParseSizeClasses("8 1 256 1024\n", kMaxClasses, parsed), -1);
+}
+
+TEST(RuntimeSizeClassesTest, RejectsTooManyClasses) {
+  SizeClassInfo parsed[kMaxClasses];
+  EXPECT_EQ(ParseSizeClasses("8 1 32 1024\n16 1 32 512\n", 2, parsed), -1);
+}
+
+TEST(RuntimeSizeClassesTest, EnvVariableNotSet) {
+  SizeClassInfo parsed[kMaxClasses];
+  unsetenv("TCMALLOC_SIZE_CLASSES_FILE");
+  EXPECT_EQ(MaybeSizeClassesFromEnv(kMaxClasses, parsed), 0);
+}
+
+TEST(RuntimeSizeClassesTest, EnvVariableNamesMissingFile) {
+  SizeClassInfo parsed[kMaxClasses];
+  setenv("TCMALLOC_SIZE_CLASSES_FILE", "/nonexistent/size_classes", 1);
+  EXPECT_EQ(MaybeSizeClassesFromEnv(kMaxClasses, parsed), -1);
+  unsetenv("TCMALLOC_SIZE_CLASSES_FILE");
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -0,0 +1,57 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/sampled_allocation_allocator.h"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/sampled_allocation.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+SampledAllocation* SampledAllocationAllocator::New(StackTrace stack_trace) {
+  // Carve from the calling thread's partition: the arena first-touches fresh
+  // blocks on this thread's node, and the per-partition freelist only ever
+  // held objects carved the same way, so the write below stays node-local.
+  const size_t partition = tc_globals.numa_topology().GetCurrentPartition();
+  SampledAllocation* s;
+  {
+    PageHeapSpinLockHolder l;
+    s = allocators_[partition].New();
+  }
+  SampledAllocation* result = new (s) SampledAllocation(std::move(stack_trace));
+  // Recorded after construction so revival does not reset it.
+  result->numa_partition = partition;
+  return result;
+}
+
+void SampledAllocationAllocator::Delete(SampledAllocation* s) {
+  // Return the object to the partition it was carved from, which need not be
+  // the partition the deleting thread runs on.
+  const size_t partition = s->numa_partition;
+  PageHeapSpinLockHolder l;
+  allocators_[partition].Delete(s);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -15,8 +15,6 @@
 #ifndef TCMALLOC_SAMPLED_ALLOCATION_ALLOCATOR_H_
 #define TCMALLOC_SAMPLED_ALLOCATION_ALLOCATOR_H_
 
-#include <utility>
-
 #include "absl/base/thread_annotations.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/common.h"
@@ -37,35 +35,42 @@ namespace tcmalloc_internal {
 // arena and requires the pageheap_lock here.
 // 2) PageHeapAllocator only allocates/deallocates memory, so we need to
 // manually invoke the constructor/destructor to initialize/clear some fields.
+// 3) Sampling runs on every thread, so objects are carved from (and returned
+// to) a freelist per NUMA partition to keep the hot path writing node-local
+// memory.
 class SampledAllocationAllocator {
  public:
   constexpr SampledAllocationAllocator() = default;
 
   void Init(Arena* arena) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
-    allocator_.Init(arena);
+    for (PageHeapAllocator<SampledAllocation>& allocator : allocators_) {
+      allocator.Init(arena);
+    }
   }
 
+  // Allocates from the calling thread's NUMA partition; defined in
+  // sampled_allocation_allocator.cc, which can consult the topology.
   SampledAllocation* New(StackTrace stack_trace)
-      ABSL_LOCKS_EXCLUDED(pageheap_lock) {
-    SampledAllocation* s;
-    {
-      PageHeapSpinLockHolder l;
-      s = allocator_.New();
-    }
-    return new (s) SampledAllocation(std::move(stack_trace));
-  }
+      ABSL_LOCKS_EXCLUDED(pageheap_lock);
 
-  void Delete(SampledAllocation* s) ABSL_LOCKS_EXCLUDED(pageheap_lock) {
-    PageHeapSpinLockHolder l;
-    allocator_.Delete(s);
-  }
+  // Returns s to the freelist of the partition it was carved from.
+  void Delete(SampledAllocation* s) ABSL_LOCKS_EXCLUDED(pageheap_lock);
 
   AllocatorStats stats() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
-    return allocator_.stats();
+    AllocatorStats total = {0, 0};
+    for (const PageHeapAllocator<SampledAllocation>& allocator : allocators_) {
+      const AllocatorStats s = allocator.stats();
+      total.in_use += s.in_use;
+      total.total += s.total;
+    }
+    return total;
   }
 
  private:
-  PageHeapAllocator<SampledAllocation> allocator_
+  // One freelist per NUMA partition.  The arena backs fresh blocks on the
+  // allocating thread's node (first touch), and keeping freed objects
+  // partition-local preserves that placement across reuse.
+  PageHeapAllocator<SampledAllocation> allocators_[kNumaPartitions]
       ABSL_GUARDED_BY(pageheap_lock);
 };
 
@@ -128,10 +128,16 @@ class Sampler {
     return offsetof(Sampler, bytes_until_sample_);
   }
 
+  // Total number of bytes this thread has requested from malloc.  Maintained
+  // on the allocation fast path, so reading it is cheap enough to do per
+  // operation.
+  size_t allocated_bytes() const { return allocated_bytes_; }
+
   constexpr Sampler()
       : sample_period_(0),
         rnd_(0),
         initialized_(false),
+        allocated_bytes_(0),
         bytes_until_sample_(0) {}
 
  private:
@@ -143,6 +149,10 @@ class Sampler {
   uint64_t rnd_;  // Cheap random number generator
   bool initialized_;
 
+  // Running total of requested bytes, see allocated_bytes().  Placed next to
+  // bytes_until_sample_ so that both counters share the hot cache line.
+  size_t allocated_bytes_;
+
   // Bytes until we sample next.
   //
   // More specifically when bytes_until_sample_ is X, we can allocate
@@ -172,6 +182,11 @@ inline bool ABSL_ATTRIBUTE_ALWAYS_INLINE
 Sampler::TryRecordAllocationFast(size_t k) {
   TC_ASSERT_GE(bytes_until_sample_, 0);
 
+  // Every allocation's record passes through here exactly once (including the
+  // ones that escalate to RecordAllocationSlow), so this is the single point
+  // where the per-thread byte counter is maintained.
+  allocated_bytes_ += k;
+
   // Avoid missampling 0.  Callers pass in requested size (which based on the
   // assertion below k>=0 at this point).  Since subtracting 0 from
   // bytes_until_sample_ is a no-op, we increment k by one.
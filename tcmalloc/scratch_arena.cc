@@ -0,0 +1,128 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/scratch_arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <new>
+
+#include "absl/base/optimization.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/span.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+MemoryTag ScratchArenaTag() {
+  if (tc_globals.numa_topology().numa_aware()) {
+    return NumaNormalTag(tc_globals.numa_topology().GetCurrentPartition());
+  }
+  return MemoryTag::kNormal;
+}
+
+}  // namespace
+
+Span* ScratchArena::NewSpan(Length n) {
+  Span* span = tc_globals.page_allocator().New(
+      n, {1, AccessDensityPrediction::kSparse}, ScratchArenaTag());
+  if (ABSL_PREDICT_FALSE(span == nullptr)) {
+    return nullptr;
+  }
+  spans_.prepend(span);
+  return span;
+}
+
+ScratchArena* ScratchArena::Create() {
+  Span* span = tc_globals.page_allocator().New(
+      kChunkPages, {1, AccessDensityPrediction::kSparse}, ScratchArenaTag());
+  if (ABSL_PREDICT_FALSE(span == nullptr)) {
+    return nullptr;
+  }
+  ScratchArena* arena = new (span->start_address()) ScratchArena();
+  arena->spans_.append(span);
+  arena->free_area_ = reinterpret_cast<char*>(arena + 1);
+  arena->free_avail_ = kChunkPages.in_bytes() - sizeof(ScratchArena);
+  return arena;
+}
+
+void ScratchArena::Destroy(ScratchArena* arena) {
+  TC_ASSERT_NE(arena, nullptr);
+  // Pop spans front to back.  The span holding the arena header (whose
+  // start_address is the header itself; see Create) carries the list state,
+  // so deleting it inside the loop would leave the empty() check reading
+  // freed memory; hold it back and delete it once the loop is done with the
+  // list.
+  PageHeapSpinLockHolder l;
+  Span* header_span = nullptr;
+  while (!arena->spans_.empty()) {
+    Span* span = arena->spans_.first();
+    arena->spans_.remove(span);
+    if (span->start_address() == static_cast<void*>(arena)) {
+      header_span = span;
+      continue;
+    }
+    tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1,
+                                       GetMemoryTag(span->start_address()));
+  }
+  TC_ASSERT_NE(header_span, nullptr);
+  tc_globals.page_allocator().Delete(
+      header_span, /*objects_per_span=*/1,
+      GetMemoryTag(header_span->start_address()));
+}
+
+void* ScratchArena::Alloc(size_t bytes, std::align_val_t alignment) {
+  const size_t align = static_cast<size_t>(alignment);
+  TC_ASSERT_GT(align, 0);
+  TC_ASSERT_LE(align, kPageSize);
+
+  const size_t misalignment = reinterpret_cast<uintptr_t>(free_area_) % align;
+  const size_t alignment_bytes = misalignment != 0 ? align - misalignment : 0;
+  if (ABSL_PREDICT_FALSE(free_avail_ < bytes + alignment_bytes)) {
+    if (bytes > kChunkPages.in_bytes()) {
+      // Too large for a fresh chunk: give the allocation a span of its exact
+      // size and keep the current bump region for smaller requests.  Span
+      // starts are page aligned, so alignment is already satisfied.
+      Span* span = NewSpan(BytesToLengthCeil(bytes));
+      if (span == nullptr) return nullptr;
+      return span->start_address();
+    }
+    Span* span = NewSpan(kChunkPages);
+    if (span == nullptr) return nullptr;
+    free_area_ = reinterpret_cast<char*>(span->start_address());
+    free_avail_ = kChunkPages.in_bytes();
+    char* result = free_area_;
+    free_area_ += bytes;
+    free_avail_ -= bytes;
+    return result;
+  }
+
+  free_area_ += alignment_bytes;
+  free_avail_ -= alignment_bytes;
+  char* result = free_area_;
+  free_area_ += bytes;
+  free_avail_ -= bytes;
+  return result;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
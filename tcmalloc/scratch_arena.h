@@ -0,0 +1,84 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Request-scoped bulk-free allocation layered on tcmalloc spans.
+//
+// A ScratchArena serves allocations by bump pointer from dedicated spans
+// obtained from the page allocator, and Destroy() returns those spans whole,
+// without visiting individual objects.  This suits request- or query-scoped
+// scratch memory that is allocated piecemeal but always freed at once: the
+// free side is O(spans) instead of O(objects).
+//
+// Arena memory must never be passed to free() or operator delete, and objects
+// with non-trivial destructors must be destroyed by the caller before
+// Destroy().  A ScratchArena is not thread-safe; callers serialize access.
+
+#ifndef TCMALLOC_SCRATCH_ARENA_H_
+#define TCMALLOC_SCRATCH_ARENA_H_
+
+#include <stddef.h>
+
+#include <new>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/span.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+class ScratchArena {
+ public:
+  // Creates an arena backed by a fresh span; the arena header lives at the
+  // start of that span, so an arena costs no metadata beyond its spans.
+  // Returns nullptr if the page allocator is out of memory.
+  static ScratchArena* Create();
+
+  // Returns every span the arena owns to the page heap, including the one
+  // holding the arena itself.  All memory handed out by Alloc() becomes
+  // invalid.
+  static void Destroy(ScratchArena* arena);
+
+  // Returns bytes of memory aligned to alignment (at most kPageSize), or
+  // nullptr if growing the arena failed.
+  void* Alloc(size_t bytes, std::align_val_t alignment = kAlignment);
+
+ private:
+  ScratchArena() = default;
+
+  // Spans are requested from the page allocator in fixed-size chunks;
+  // allocations too large for a fresh chunk get a span of their exact size.
+  static constexpr Length kChunkPages = Length(32);
+
+  // Allocates a span of n pages and links it into spans_.  Returns nullptr
+  // on failure.
+  Span* NewSpan(Length n);
+
+  // Every span the arena owns; membership in this list is what ties a span
+  // to the arena.  New spans are prepended, so the span holding this header
+  // stays at the tail and Destroy() frees it last.
+  SpanList spans_;
+
+  // Bump region inside the most recently allocated chunk.
+  char* free_area_ = nullptr;
+  size_t free_avail_ = 0;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_SCRATCH_ARENA_H_
@@ -0,0 +1,78 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/scratch_arena.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <new>
+
+#include "gtest/gtest.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(ScratchArenaTest, AllocAndBulkFree) {
+  ScratchArena* arena = ScratchArena::Create();
+  ASSERT_NE(arena, nullptr);
+
+  // Small allocations bump within a chunk and do not overlap.
+  char* a = static_cast<char*>(arena->Alloc(100));
+  char* b = static_cast<char*>(arena->Alloc(100));
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  EXPECT_GE(b, a + 100);
+  memset(a, 0xaa, 100);
+  memset(b, 0xbb, 100);
+
+  // Alignment is honored.
+  void* aligned = arena->Alloc(64, static_cast<std::align_val_t>(64));
+  ASSERT_NE(aligned, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+
+  // An allocation larger than a chunk gets a span of its own.
+  constexpr size_t kBig = 1 << 20;
+  char* big = static_cast<char*>(arena->Alloc(kBig));
+  ASSERT_NE(big, nullptr);
+  memset(big, 0xcc, kBig);
+
+  // Sustained allocation spills into additional chunks.
+  for (int i = 0; i < 1000; ++i) {
+    void* p = arena->Alloc(1024);
+    ASSERT_NE(p, nullptr);
+    memset(p, 0xdd, 1024);
+  }
+
+  ScratchArena::Destroy(arena);
+}
+
+TEST(ScratchArenaTest, ManyArenas) {
+  // Arenas are independent; destroying one leaves the others usable.
+  ScratchArena* arenas[8];
+  for (ScratchArena*& arena : arenas) {
+    arena = ScratchArena::Create();
+    ASSERT_NE(arena, nullptr);
+    ASSERT_NE(arena->Alloc(256), nullptr);
+  }
+  for (ScratchArena* arena : arenas) {
+    ASSERT_NE(arena->Alloc(256), nullptr);
+    ScratchArena::Destroy(arena);
+  }
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
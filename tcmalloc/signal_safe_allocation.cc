@@ -0,0 +1,105 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/signal_safe_allocation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/parameters.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+ABSL_CONST_INIT thread_local SignalSafePool::Pool SignalSafePool::pool_
+    ABSL_ATTRIBUTE_INITIAL_EXEC;
+ABSL_CONST_INIT std::atomic<bool> SignalSafePool::ever_used_{false};
+
+namespace {
+
+constexpr uint64_t PackState(size_t used, size_t outstanding) {
+  return static_cast<uint64_t>(used) |
+         (static_cast<uint64_t>(outstanding) << 32);
+}
+
+constexpr size_t StateUsed(uint64_t state) {
+  return static_cast<uint32_t>(state);
+}
+
+constexpr size_t StateOutstanding(uint64_t state) { return state >> 32; }
+
+}  // namespace
+
+void* SignalSafePool::Allocate(size_t size) {
+  if (ABSL_PREDICT_FALSE(size > kPoolBytes)) {
+    return nullptr;
+  }
+  // Zero-size requests still get a distinct, freeable block, as with malloc.
+  const size_t bytes = AllocatedSize(std::max<size_t>(size, 1));
+  const size_t budget = std::min<size_t>(
+      kPoolBytes,
+      std::max<int64_t>(Parameters::signal_safe_pool_bytes(), 0));
+  Pool& pool = pool_;
+  uint64_t state = pool.state.load(std::memory_order_relaxed);
+  size_t offset;
+  uint64_t next;
+  do {
+    // With no blocks outstanding the region recycles in whole; individual
+    // frees never return space (see class comment).
+    offset = StateOutstanding(state) == 0 ? 0 : StateUsed(state);
+    if (bytes > budget || bytes > budget - offset) {
+      return nullptr;
+    }
+    next = PackState(offset + bytes, StateOutstanding(state) + 1);
+    // The CAS fails only if a nested signal carved or freed between the load
+    // and the update, so retries are bounded by signal nesting depth.
+  } while (!pool.state.compare_exchange_weak(state, next,
+                                             std::memory_order_relaxed));
+  ever_used_.store(true, std::memory_order_relaxed);
+  return pool.bytes + offset;
+}
+
+bool SignalSafePool::FreeSlow(void* ptr) {
+  Pool& pool = pool_;
+  unsigned char* p = static_cast<unsigned char*>(ptr);
+  if (p < pool.bytes || p >= pool.bytes + kPoolBytes) {
+    return false;
+  }
+  uint64_t state = pool.state.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    TC_ASSERT_GT(StateOutstanding(state), 0);
+    next = PackState(StateUsed(state), StateOutstanding(state) - 1);
+  } while (!pool.state.compare_exchange_weak(state, next,
+                                             std::memory_order_relaxed));
+  return true;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+extern "C" void* tcmalloc_signal_safe_alloc(size_t size) {
+  return tcmalloc::tcmalloc_internal::SignalSafePool::Allocate(size);
+}
+
+extern "C" int tcmalloc_signal_safe_free(void* ptr) {
+  return tcmalloc::tcmalloc_internal::SignalSafePool::Free(ptr) ? 1 : 0;
+}
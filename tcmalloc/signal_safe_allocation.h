@@ -0,0 +1,114 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_SIGNAL_SAFE_ALLOCATION_H_
+#define TCMALLOC_SIGNAL_SAFE_ALLOCATION_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// A fixed per-thread pool for allocations that must make progress from
+// signal context.  Regular allocation slow paths take locks and may block
+// unboundedly; a signal handler that interrupts the allocator inside one of
+// its no-allocation regions (see InAllocationGuard()) and then allocates
+// would deadlock.  Such reentrant requests -- and explicit
+// tcmalloc_signal_safe_alloc() calls -- are served by carving from this
+// pool instead.
+//
+// The pool is a bump region: Allocate() claims the next aligned chunk with a
+// single compare-and-swap on a state word packing the bump offset and the
+// count of outstanding blocks, so it is lock-free and async-signal-safe.
+// Individual frees do not return space; the region recycles in whole once
+// every outstanding block has been returned, which suits the
+// allocate-use-free pattern of a signal handler.  Blocks must be freed on
+// the thread that allocated them.
+class SignalSafePool {
+ public:
+  // Bytes reserved per thread.  Parameters::signal_safe_pool_bytes() caps
+  // how much of the reservation Allocate() may carve, clamped to this.
+  static constexpr size_t kPoolBytes = 8 * 1024;
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+  // Carves size bytes from the calling thread's pool.  Lock-free and
+  // async-signal-safe.  Returns nullptr when the request does not fit in the
+  // remaining budget, or when the budget parameter is zero.
+  static void* Allocate(size_t size);
+
+  // Bytes a successful Allocate(size) carves, and the usable capacity of the
+  // returned block.
+  static constexpr size_t AllocatedSize(size_t size) {
+    return (size + kAlignment - 1) & ~(kAlignment - 1);
+  }
+
+  // Returns a block to the calling thread's pool.  Returns false, freeing
+  // nothing, when ptr is not from this thread's pool; callers on the regular
+  // free paths use this to divert pool blocks before consulting span
+  // metadata that pool addresses do not have.  Cheap when the pool has never
+  // been used: a single relaxed load.
+  static bool Free(void* ptr) {
+    if (ABSL_PREDICT_TRUE(!ever_used_.load(std::memory_order_relaxed))) {
+      return false;
+    }
+    return FreeSlow(ptr);
+  }
+
+ private:
+  struct Pool {
+    // Low 32 bits: bump offset into bytes.  High 32 bits: outstanding
+    // blocks.  Updated only by the owning thread and its signal handlers,
+    // which nest rather than race, so CAS retries are bounded by signal
+    // nesting depth.
+    std::atomic<uint64_t> state{0};
+    alignas(kAlignment) unsigned char bytes[kPoolBytes];
+  };
+
+  static bool FreeSlow(void* ptr);
+
+  ABSL_CONST_INIT static thread_local Pool pool_ ABSL_ATTRIBUTE_INITIAL_EXEC;
+  // Set on the first successful Allocate() anywhere; lets Free() stay a
+  // predicted-false branch on free paths in the common no-signal-alloc case.
+  ABSL_CONST_INIT static std::atomic<bool> ever_used_;
+};
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+extern "C" {
+
+// Allocates size bytes that are safe to obtain from a signal handler.  The
+// memory comes from the calling thread's fixed pool
+// (tcmalloc::tcmalloc_internal::SignalSafePool); returns nullptr when the
+// pool budget is exhausted.  The block may be released with
+// tcmalloc_signal_safe_free(), or with free()/operator delete, on the
+// allocating thread.
+void* tcmalloc_signal_safe_alloc(size_t size);
+
+// Frees a block obtained from tcmalloc_signal_safe_alloc() on this thread.
+// Async-signal-safe.  Returns 1 if the block was recognized and freed, 0
+// otherwise (the pointer is untouched and still owned by the caller).
+int tcmalloc_signal_safe_free(void* ptr);
+
+}  // extern "C"
+
+#endif  // TCMALLOC_SIGNAL_SAFE_ALLOCATION_H_
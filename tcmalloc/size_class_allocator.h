@@ -0,0 +1,98 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Fixed-size allocation fast path for clients that repeatedly allocate a
+// small number of known sizes.
+//
+// tcmalloc::SizeClassAllocator<kSize> resolves kSize to its TCMalloc size
+// class once per process and then allocates and frees directly through the
+// per-CPU cache for that class, skipping the size-to-class lookup and policy
+// dispatch that malloc() performs on every call.  Sampling, allocation
+// hooks, and OOM behavior are identical to malloc(): allocations may still
+// be sampled, and New() returns nullptr on failure.
+//
+// The size class cannot be resolved at compile time: the active size class
+// table is selected at runtime (per-size-class configuration flags and NUMA
+// partitioning), so resolution happens at first use and is cached.  The
+// cached class reflects the NUMA partition of the first resolving thread.
+//
+// When the binary is not linked against this malloc implementation, New()
+// and Delete() fall back to the global operator new/delete, so callers can
+// use this header unconditionally.
+
+#ifndef TCMALLOC_SIZE_CLASS_ALLOCATOR_H_
+#define TCMALLOC_SIZE_CLASS_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "tcmalloc/internal_malloc_extension.h"
+
+#if !ABSL_HAVE_ATTRIBUTE_WEAK || defined(__APPLE__) || defined(__EMSCRIPTEN__)
+#define ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS 0
+#else
+#define ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS 1
+#endif
+
+namespace tcmalloc {
+
+template <size_t kSize>
+class SizeClassAllocator {
+ public:
+  // Returns kSize bytes of memory, suitably aligned for any object of that
+  // size, or nullptr on failure.  The allocation must be released with
+  // Delete() (or free(), sized delete, etc. -- it is an ordinary malloc
+  // allocation).
+  static void* New() {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+    if (&MallocExtension_Internal_AllocOfSizeClass != nullptr) {
+      const size_t size_class = SizeClass();
+      if (ABSL_PREDICT_TRUE(size_class != 0)) {
+        return MallocExtension_Internal_AllocOfSizeClass(size_class, kSize);
+      }
+    }
+#endif
+    return ::operator new(kSize, std::nothrow);
+  }
+
+  // Releases memory returned by New().
+  static void Delete(void* ptr) {
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+    if (&MallocExtension_Internal_FreeOfSizeClass != nullptr) {
+      const size_t size_class = SizeClass();
+      if (ABSL_PREDICT_TRUE(size_class != 0)) {
+        return MallocExtension_Internal_FreeOfSizeClass(ptr, size_class);
+      }
+    }
+#endif
+    ::operator delete(ptr);
+  }
+
+ private:
+#if ABSL_INTERNAL_HAVE_WEAK_MALLOCEXTENSION_STUBS
+  // Resolved once per process; 0 means kSize has no small size class
+  // (kSize > kMaxSize) and callers take the generic path.
+  static size_t SizeClass() {
+    static const size_t size_class =
+        MallocExtension_Internal_GetAllocSizeClass(kSize);
+    return size_class;
+  }
+#endif
+};
+
+}  // namespace tcmalloc
+
+#endif  // TCMALLOC_SIZE_CLASS_ALLOCATOR_H_
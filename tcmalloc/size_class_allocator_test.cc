@@ -0,0 +1,78 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/size_class_allocator.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include <new>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tcmalloc/malloc_extension.h"
+
+namespace tcmalloc {
+namespace {
+
+template <size_t kSize>
+void RoundTrip() {
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    void* ret = SizeClassAllocator<kSize>::New();
+    ASSERT_NE(ret, nullptr);
+    benchmark::DoNotOptimize(memset(ret, 0xBF, kSize));
+    ptrs.push_back(ret);
+  }
+  for (void* ptr : ptrs) {
+    SizeClassAllocator<kSize>::Delete(ptr);
+  }
+}
+
+TEST(SizeClassAllocatorTest, RoundTrip) {
+  // A few fixed sizes typical of the intended clients.
+  RoundTrip<16>();
+  RoundTrip<72>();
+  RoundTrip<1024>();
+  RoundTrip<8192>();
+}
+
+TEST(SizeClassAllocatorTest, AllocatedSizeMatchesMalloc) {
+  // New() produces an ordinary malloc allocation: it must be rounded up to
+  // the same size class malloc(kSize) would use.
+  constexpr size_t kSize = 72;
+  void* from_allocator = SizeClassAllocator<kSize>::New();
+  void* from_malloc = ::operator new(kSize);
+  EXPECT_EQ(MallocExtension::GetAllocatedSize(from_allocator),
+            MallocExtension::GetAllocatedSize(from_malloc));
+
+  // Allocations are interchangeable with the generic paths in both
+  // directions.
+  ::operator delete(from_allocator);
+  SizeClassAllocator<kSize>::Delete(from_malloc);
+}
+
+TEST(SizeClassAllocatorTest, LargeSizeFallsBack) {
+  // Sizes above kMaxSize have no small size class; New() must still produce
+  // usable memory through the generic path.
+  constexpr size_t kLarge = 4 << 20;
+  void* ret = SizeClassAllocator<kLarge>::New();
+  ASSERT_NE(ret, nullptr);
+  benchmark::DoNotOptimize(memset(ret, 0xBF, kLarge));
+  SizeClassAllocator<kLarge>::Delete(ret);
+}
+
+}  // namespace
+}  // namespace tcmalloc
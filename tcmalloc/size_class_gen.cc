@@ -0,0 +1,97 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Offline size-class generator: reads an allocation-size histogram ("size
+// count" per line; '#' comments) from the file named by argv[1], or stdin
+// if absent, and writes a fitted size-class table to stdout in the format
+// TCMALLOC_SIZE_CLASSES_FILE accepts (see runtime_size_classes.h).  The
+// expected internal fragmentation of the compiled-in table and of the
+// fitted table are reported on stderr.
+//
+// Usage:
+//   size_class_gen sizes.txt > fitted_table.txt
+//   TCMALLOC_SIZE_CLASSES_FILE=fitted_table.txt ./server
+
+#include <stdio.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/size_class_info.h"
+#include "tcmalloc/size_class_optimizer.h"
+#include "tcmalloc/sizemap.h"
+
+namespace {
+
+bool ReadAll(FILE* f, std::string& out) {
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    out.append(buf, n);
+  }
+  return !ferror(f);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  using tcmalloc::tcmalloc_internal::ExpectedFragmentation;
+  using tcmalloc::tcmalloc_internal::FormatSizeClasses;
+  using tcmalloc::tcmalloc_internal::kNumBaseClasses;
+  using tcmalloc::tcmalloc_internal::OptimizeSizeClasses;
+  using tcmalloc::tcmalloc_internal::ParseSizeHistogram;
+  using tcmalloc::tcmalloc_internal::SizeCount;
+  using tcmalloc::tcmalloc_internal::SizeMap;
+
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "r");
+    if (in == nullptr) {
+      fprintf(stderr, "size_class_gen: cannot open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  std::string input;
+  const bool read_ok = ReadAll(in, input);
+  if (in != stdin) fclose(in);
+  if (!read_ok) {
+    fprintf(stderr, "size_class_gen: read error\n");
+    return 1;
+  }
+
+  std::optional<std::vector<SizeCount>> histogram = ParseSizeHistogram(input);
+  if (!histogram.has_value()) {
+    fprintf(stderr, "size_class_gen: malformed histogram\n");
+    return 1;
+  }
+  if (histogram->empty()) {
+    fprintf(stderr, "size_class_gen: empty histogram\n");
+    return 1;
+  }
+
+  const auto fitted = OptimizeSizeClasses(*histogram, kNumBaseClasses);
+  fprintf(stderr,
+          "size_class_gen: %zu histogram buckets, %zu classes fitted\n",
+          histogram->size(), fitted.size() - 1);
+  fprintf(stderr,
+          "expected internal fragmentation: %.2f%% (compiled-in table) -> "
+          "%.2f%% (fitted)\n",
+          100 * ExpectedFragmentation(SizeMap::CurrentClasses().classes,
+                                      *histogram),
+          100 * ExpectedFragmentation(fitted, *histogram));
+  fputs(FormatSizeClasses(fitted).c_str(), stdout);
+  return 0;
+}
@@ -44,6 +44,17 @@ struct SizeClassInfo {
   // Max per-CPU slab capacity for the default 256KB slab size.
   // Scaled up/down for larger/smaller slab sizes.
   uint32_t max_capacity;
+
+  // Minimum alignment every object of this class must provide, or 0 if the
+  // class carries no alignment requirement beyond its natural one.  Objects
+  // are laid out end to end from a page-aligned span start, so a class
+  // naturally guarantees the largest power of two dividing its size (capped
+  // at the page size); a nonzero value documents a class that exists to
+  // provide that alignment (e.g. for direct-I/O buffers) and is validated
+  // against the natural guarantee by SizeMap::Init().  Span cache coloring
+  // (TCMALLOC_COLORED_SIZE_CLASSES) voids guarantees beyond kAlignment, so
+  // aligned lookups skip colored classes.
+  uint32_t alignment;
 };
 
 struct SizeClassAssumptions {
@@ -0,0 +1,297 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/size_class_optimizer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/huge_page_aware_allocator.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/size_class_info.h"
+#include "tcmalloc/sizemap.h"
+#include "tcmalloc/span.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Above this many distinct candidate boundaries the O(m^2) search gets slow;
+// the least-weighted candidates are folded upward first.
+constexpr size_t kMaxCandidates = 4096;
+
+size_t BoundaryAlignment(size_t size) {
+  return size > SizeMap::kLargeSize ? SizeMap::kLargeSizeAlignment
+                                    : static_cast<size_t>(kAlignment);
+}
+
+// Mirrors the checks of SizeMap::IsValidSizeClass without its logging, so
+// the boundary search can probe candidates freely.
+bool ValidSizeClassQuiet(size_t size, size_t pages, size_t num_to_move) {
+  if (size == 0 || size > kMaxSize) return false;
+  if (size >= kMinAllocSizeForCold && !Span::IsNonIntrusive(size)) return false;
+  if ((size & (BoundaryAlignment(size) - 1)) != 0) return false;
+  if (pages == 0 || pages >= 255) return false;
+  if (Length(pages).in_bytes() < size) return false;
+  if (!Span::IsValidSizeClass(size, pages)) return false;
+  if (!HugePageAwareAllocator::IsValidSizeClass(size, pages)) return false;
+  if (num_to_move < 2 || num_to_move > kMaxObjectsToMove) return false;
+  return true;
+}
+
+// Bytes of span slack amortized over the objects carved from one span.
+double SlackPerObject(const SizeClassInfo& info) {
+  const size_t span_bytes = Length(info.pages).in_bytes();
+  const size_t objects = span_bytes / info.size;
+  return static_cast<double>(span_bytes % info.size) / objects;
+}
+
+}  // namespace
+
+std::optional<std::vector<SizeCount>> ParseSizeHistogram(
+    absl::string_view input) {
+  std::vector<SizeCount> entries;
+  for (absl::string_view line : absl::StrSplit(input, '\n')) {
+    const size_t comment = line.find('#');
+    if (comment != absl::string_view::npos) {
+      line = line.substr(0, comment);
+    }
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, absl::ByAnyChar(" \t"), absl::SkipEmpty());
+    if (fields.empty()) continue;
+    size_t size;
+    uint64_t count;
+    if (fields.size() != 2 || !absl::SimpleAtoi(fields[0], &size) ||
+        !absl::SimpleAtoi(fields[1], &count) || size == 0) {
+      return std::nullopt;
+    }
+    if (count == 0 || size > kMaxSize) continue;
+    entries.push_back({size, count});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const SizeCount& a, const SizeCount& b) {
+              return a.size < b.size;
+            });
+  std::vector<SizeCount> merged;
+  for (const SizeCount& e : entries) {
+    if (!merged.empty() && merged.back().size == e.size) {
+      merged.back().count += e.count;
+    } else {
+      merged.push_back(e);
+    }
+  }
+  return merged;
+}
+
+std::optional<SizeClassInfo> MakeSizeClass(size_t size) {
+  if (size == 0 || size > kMaxSize) return std::nullopt;
+  const size_t num_to_move =
+      std::clamp<size_t>((64 * 1024) / size, 2, kMaxObjectsToMove);
+  // Prefer the shortest span whose slack stays under 1/8 of the span; fall
+  // back to the valid span length with the least slack.
+  size_t best_pages = 0;
+  double best_slack = std::numeric_limits<double>::infinity();
+  for (size_t pages = 1; pages < 255; ++pages) {
+    if (!ValidSizeClassQuiet(size, pages, num_to_move)) continue;
+    const size_t span_bytes = Length(pages).in_bytes();
+    const double slack =
+        static_cast<double>(span_bytes % size) / span_bytes;
+    if (slack < best_slack) {
+      best_slack = slack;
+      best_pages = pages;
+    }
+    if (slack <= 1.0 / 8) break;
+  }
+  if (best_pages == 0) return std::nullopt;
+
+  SizeClassInfo info{};
+  info.size = size;
+  info.pages = best_pages;
+  info.num_to_move = num_to_move;
+  // Per-CPU slab capacity: proportional to how many objects fit in the
+  // default 256KB slab share, within the range the static tables use.
+  info.max_capacity = std::clamp<size_t>((256 * 1024) / size, 64, 2048);
+  return info;
+}
+
+std::optional<size_t> RoundUpToValidBoundary(size_t size) {
+  size = std::max<size_t>(size, 1);
+  while (size <= kMaxSize) {
+    const size_t alignment = BoundaryAlignment(size);
+    size = (size + alignment - 1) & ~(alignment - 1);
+    if (MakeSizeClass(size).has_value()) return size;
+    ++size;
+  }
+  return std::nullopt;
+}
+
+std::vector<SizeClassInfo> OptimizeSizeClasses(
+    absl::Span<const SizeCount> histogram, int max_classes) {
+  // Candidate boundaries: every histogram size rounded up to an admissible
+  // boundary, plus kMaxSize, which the runtime requires as the last class.
+  std::vector<size_t> candidates;
+  for (const SizeCount& e : histogram) {
+    if (std::optional<size_t> b = RoundUpToValidBoundary(e.size)) {
+      candidates.push_back(*b);
+    }
+  }
+  candidates.push_back(kMaxSize);
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+
+  // Group weight per candidate, for thinning.
+  auto group_count = [&](size_t lo, size_t hi) {
+    uint64_t count = 0;
+    for (const SizeCount& e : histogram) {
+      if (e.size > lo && e.size <= hi) count += e.count;
+    }
+    return count;
+  };
+  if (candidates.size() > kMaxCandidates) {
+    // Fold the least-weighted boundaries upward; kMaxSize always stays.
+    std::vector<std::pair<uint64_t, size_t>> weighted;
+    for (size_t i = 0; i + 1 < candidates.size(); ++i) {
+      weighted.push_back(
+          {group_count(i == 0 ? 0 : candidates[i - 1], candidates[i]),
+           candidates[i]});
+    }
+    std::sort(weighted.begin(), weighted.end());
+    weighted.erase(weighted.begin(),
+                   weighted.begin() + (candidates.size() - kMaxCandidates));
+    candidates.clear();
+    for (const auto& [count, size] : weighted) candidates.push_back(size);
+    candidates.push_back(kMaxSize);
+    std::sort(candidates.begin(), candidates.end());
+  }
+
+  const size_t m = candidates.size();
+  std::vector<SizeClassInfo> infos(m);
+  std::vector<double> overhead(m);
+  for (size_t i = 0; i < m; ++i) {
+    infos[i] = *MakeSizeClass(candidates[i]);
+    overhead[i] = SlackPerObject(infos[i]);
+  }
+
+  // Prefix sums of request count and requested bytes at or below each
+  // candidate.
+  std::vector<double> prefix_count(m), prefix_bytes(m);
+  {
+    size_t h = 0;
+    double count = 0, bytes = 0;
+    for (size_t i = 0; i < m; ++i) {
+      for (; h < histogram.size() && histogram[h].size <= candidates[i]; ++h) {
+        count += static_cast<double>(histogram[h].count);
+        bytes += static_cast<double>(histogram[h].count) * histogram[h].size;
+      }
+      prefix_count[i] = count;
+      prefix_bytes[i] = bytes;
+    }
+  }
+  // Expected fragmentation bytes when one class at candidates[i] serves
+  // every request in (candidates[j], candidates[i]]; j < 0 means from zero.
+  auto cost = [&](int j, size_t i) {
+    const double count = prefix_count[i] - (j >= 0 ? prefix_count[j] : 0);
+    const double bytes = prefix_bytes[i] - (j >= 0 ? prefix_bytes[j] : 0);
+    return count * (static_cast<double>(candidates[i]) + overhead[i]) - bytes;
+  };
+
+  // dp[k][i]: minimal fragmentation covering everything at or below
+  // candidates[i] with k classes, the k-th ending exactly at candidates[i].
+  const int budget = std::max(1, max_classes - 1);  // minus the sentinel
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  std::vector<std::vector<double>> dp(
+      budget + 1, std::vector<double>(m, kInf));
+  std::vector<std::vector<int>> parent(budget + 1, std::vector<int>(m, -1));
+  for (size_t i = 0; i < m; ++i) {
+    dp[1][i] = cost(-1, i);
+  }
+  for (int k = 2; k <= budget; ++k) {
+    for (size_t i = k - 1; i < m; ++i) {
+      for (size_t j = k - 2; j < i; ++j) {
+        if (dp[k - 1][j] == kInf) continue;
+        const double c = dp[k - 1][j] + cost(j, i);
+        if (c < dp[k][i]) {
+          dp[k][i] = c;
+          parent[k][i] = j;
+        }
+      }
+    }
+  }
+
+  // Best class count ending at kMaxSize; ties prefer fewer classes.
+  int best_k = 1;
+  for (int k = 2; k <= budget; ++k) {
+    if (dp[k][m - 1] < dp[best_k][m - 1]) best_k = k;
+  }
+  std::vector<size_t> chosen;
+  for (int k = best_k, i = m - 1; i >= 0 && k >= 1;
+       i = parent[k][i], --k) {
+    chosen.push_back(i);
+  }
+  std::reverse(chosen.begin(), chosen.end());
+
+  std::vector<SizeClassInfo> result;
+  result.push_back(SizeClassInfo{});  // the zero sentinel
+  for (size_t i : chosen) {
+    result.push_back(infos[i]);
+  }
+  return result;
+}
+
+double ExpectedFragmentation(absl::Span<const SizeClassInfo> classes,
+                             absl::Span<const SizeCount> histogram) {
+  double waste = 0, requested = 0;
+  for (const SizeCount& e : histogram) {
+    const SizeClassInfo* cls = nullptr;
+    for (const SizeClassInfo& c : classes) {
+      if (c.size != 0 && c.size >= e.size) {
+        cls = &c;
+        break;
+      }
+    }
+    if (cls == nullptr) continue;  // above the table; served in whole pages
+    const double count = static_cast<double>(e.count);
+    waste += count * (cls->size - e.size + SlackPerObject(*cls));
+    requested += count * e.size;
+  }
+  return requested == 0 ? 0 : waste / requested;
+}
+
+std::string FormatSizeClasses(absl::Span<const SizeClassInfo> classes) {
+  std::string out = "# size pages num_to_move max_capacity\n";
+  for (const SizeClassInfo& c : classes) {
+    if (c.size == 0) continue;  // the sentinel
+    absl::StrAppend(&out, c.size, " ", c.pages, " ", c.num_to_move, " ",
+                    c.max_capacity, "\n");
+  }
+  return out;
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
@@ -0,0 +1,91 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Offline size-class optimizer backing the size_class_gen tool: given a
+// histogram of allocation request sizes, it searches class boundaries that
+// minimize expected internal fragmentation (round-up waste plus each
+// object's share of span slack) subject to the class-count budget and the
+// alignment and span constraints the runtime enforces in
+// SizeMap::IsValidSizeClass.  The result serializes to the format
+// ParseSizeClasses() accepts (see runtime_size_classes.h), so fitted tables
+// deploy without recompiling.  Not used by the allocator itself.
+
+#ifndef TCMALLOC_SIZE_CLASS_OPTIMIZER_H_
+#define TCMALLOC_SIZE_CLASS_OPTIMIZER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/size_class_info.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// One histogram bucket: <count> requests of exactly <size> bytes.
+struct SizeCount {
+  size_t size;
+  uint64_t count;
+};
+
+// Parses a size histogram: one "size count" pair of decimal integers per
+// line; blank lines and text following '#' are ignored.  Entries are
+// returned sorted by size with duplicates merged.  Sizes above kMaxSize are
+// dropped (they are served in whole pages, outside the size-class table).
+// Returns std::nullopt if the input is malformed.
+std::optional<std::vector<SizeCount>> ParseSizeHistogram(
+    absl::string_view input);
+
+// Builds the full SizeClassInfo for a class boundary: picks the span length
+// with acceptable slack, a num_to_move that amortizes central-list locking,
+// and a per-CPU capacity heuristic.  Returns std::nullopt if <size> cannot
+// be a class boundary (misaligned, above kMaxSize, or rejected by the
+// runtime's span constraints).
+std::optional<SizeClassInfo> MakeSizeClass(size_t size);
+
+// Rounds <size> up to the nearest admissible class boundary, skipping sizes
+// the runtime would reject.
+std::optional<size_t> RoundUpToValidBoundary(size_t size);
+
+// Searches boundaries minimizing expected fragmentation for <histogram>
+// (sorted, as returned by ParseSizeHistogram), using at most <max_classes>
+// table entries including the zero sentinel at index 0.  The last class is
+// always kMaxSize, as the runtime requires.  Exact for up to a few thousand
+// distinct (aligned) sizes; beyond that the least-weighted candidate
+// boundaries are folded upward before the search.
+std::vector<SizeClassInfo> OptimizeSizeClasses(
+    absl::Span<const SizeCount> histogram, int max_classes);
+
+// Expected fraction of requested bytes lost to internal fragmentation
+// (round-up waste plus span slack share) when <histogram> is served by
+// <classes> (with sentinel entry 0).
+double ExpectedFragmentation(absl::Span<const SizeClassInfo> classes,
+                             absl::Span<const SizeCount> histogram);
+
+// Serializes <classes> (skipping the sentinel) in the line format
+// ParseSizeClasses() accepts.
+std::string FormatSizeClasses(absl::Span<const SizeClassInfo> classes);
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_SIZE_CLASS_OPTIMIZER_H_
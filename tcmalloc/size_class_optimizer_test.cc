@@ -0,0 +1,110 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/size_class_optimizer.h"
+
+#include <stddef.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/runtime_size_classes.h"
+#include "tcmalloc/size_class_info.h"
+#include "tcmalloc/sizemap.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+TEST(SizeClassOptimizerTest, ParseHistogram) {
+  auto h = ParseSizeHistogram(
+      "# document sizes\n"
+      "512 100\n"
+      "  320\t50  # mid\n"
+      "512 25\n"
+      "\n");
+  ASSERT_TRUE(h.has_value());
+  ASSERT_EQ(h->size(), 2);
+  EXPECT_EQ((*h)[0].size, 320);
+  EXPECT_EQ((*h)[0].count, 50);
+  EXPECT_EQ((*h)[1].size, 512);
+  EXPECT_EQ((*h)[1].count, 125);
+
+  EXPECT_FALSE(ParseSizeHistogram("512\n").has_value());
+  EXPECT_FALSE(ParseSizeHistogram("512 x\n").has_value());
+  EXPECT_FALSE(ParseSizeHistogram("0 10\n").has_value());
+}
+
+TEST(SizeClassOptimizerTest, MakeSizeClassSatisfiesRuntimeChecks) {
+  constexpr size_t kSizes[] = {8, 64, 520, 1024, 4096, kMaxSize};
+  for (size_t size : kSizes) {
+    auto info = MakeSizeClass(size);
+    ASSERT_TRUE(info.has_value()) << size;
+    EXPECT_EQ(info->size, size);
+    EXPECT_TRUE(
+        SizeMap::IsValidSizeClass(info->size, info->pages, info->num_to_move))
+        << size;
+  }
+  // Misaligned boundaries are rejected; RoundUpToValidBoundary fixes them.
+  EXPECT_FALSE(MakeSizeClass(9).has_value());
+  auto b = RoundUpToValidBoundary(9);
+  ASSERT_TRUE(b.has_value());
+  EXPECT_GE(*b, 9);
+  EXPECT_TRUE(MakeSizeClass(*b).has_value());
+}
+
+TEST(SizeClassOptimizerTest, FitsDocumentWorkload) {
+  // A 300-700 byte document workload, uniform over 8-byte steps.
+  std::vector<SizeCount> histogram;
+  for (size_t size = 300; size <= 700; size += 8) {
+    histogram.push_back({size, 1000});
+  }
+
+  const auto fitted = OptimizeSizeClasses(histogram, kNumBaseClasses);
+  ASSERT_GT(fitted.size(), 1);
+  ASSERT_LE(fitted.size(), kNumBaseClasses);
+  EXPECT_EQ(fitted[0].size, 0);
+  for (size_t c = 1; c < fitted.size(); ++c) {
+    EXPECT_GT(fitted[c].size, fitted[c - 1].size);
+    EXPECT_TRUE(SizeMap::IsValidSizeClass(fitted[c].size, fitted[c].pages,
+                                          fitted[c].num_to_move));
+  }
+  EXPECT_EQ(fitted.back().size, kMaxSize);
+
+  // The fitted table must not fragment this workload worse than the
+  // compiled-in table it replaces.
+  EXPECT_LE(ExpectedFragmentation(fitted, histogram),
+            ExpectedFragmentation(SizeMap::CurrentClasses().classes,
+                                  histogram));
+
+  // The serialized form round-trips through the runtime-table parser.
+  const std::string serialized = FormatSizeClasses(fitted);
+  std::vector<SizeClassInfo> parsed(kNumBaseClasses);
+  const int n = ParseSizeClasses(serialized, kNumBaseClasses, parsed.data());
+  ASSERT_EQ(n, static_cast<int>(fitted.size()));
+  for (int c = 1; c < n; ++c) {
+    EXPECT_EQ(parsed[c].size, fitted[c].size);
+    EXPECT_EQ(parsed[c].pages, fitted[c].pages);
+    EXPECT_EQ(parsed[c].num_to_move, fitted[c].num_to_move);
+    EXPECT_EQ(parsed[c].max_capacity, fitted[c].max_capacity);
+  }
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
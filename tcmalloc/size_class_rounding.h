@@ -0,0 +1,58 @@
+// Copyright 2019 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TCMALLOC_SIZE_CLASS_ROUNDING_H_
+#define TCMALLOC_SIZE_CLASS_ROUNDING_H_
+
+#include <stddef.h>
+
+#include "tcmalloc/common.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/size_classes.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+
+// Returns the number of bytes TCMalloc will actually hand out for a request
+// of size bytes: the smallest default size class that fits, or, above
+// kMaxSize, size rounded up to whole pages.  Usable in constant
+// expressions, so arenas and containers can pick growth targets that fill
+// their size class exactly instead of leaving internal fragmentation
+// behind:
+//
+//   constexpr size_t kBlockSize = tcmalloc::RoundToSizeClass(60000);
+//
+// The answer reflects the size-class table compiled for this page size and
+// default operator new alignment.  Runtime table overrides (legacy or
+// runtime size classes, size-class coloring) can shift individual
+// boundaries; nallocx() gives the authoritative answer for the running
+// process.
+constexpr size_t RoundToSizeClass(size_t size) {
+  if (size <= tcmalloc_internal::kMaxSize) {
+    for (const tcmalloc_internal::SizeClassInfo& info :
+         tcmalloc_internal::size_classes_internal::List) {
+      // Entry 0 is the reserved zero class; skip it so even size == 0 maps
+      // to a real class, as malloc(0) does.
+      if (info.size != 0 && size <= info.size) return info.size;
+    }
+  }
+  // Large allocations are served in whole pages.
+  return (size + tcmalloc_internal::kPageSize - 1) &
+         ~(tcmalloc_internal::kPageSize - 1);
+}
+
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_SIZE_CLASS_ROUNDING_H_
@@ -22,6 +22,7 @@
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/size_class_info.h"
+#include "tcmalloc/size_class_rounding.h"
 #include "tcmalloc/sizemap.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/static_vars.h"
@@ -456,6 +457,21 @@ TEST(SizeMapTest, Preinit) {
 
 TEST(SizeMapTest, CheckAssumptions) { SizeMap::CheckAssumptions(); }
 
+TEST(RoundToSizeClassTest, MatchesSizeMap) {
+  // Compile-time usability is the point of the API.
+  static_assert(RoundToSizeClass(64) == 64);
+  static_assert(RoundToSizeClass(kMaxSize) == kMaxSize);
+  static_assert(RoundToSizeClass(kMaxSize + 1) % kPageSize == 0);
+  static_assert(RoundToSizeClass(kMaxSize + 1) > kMaxSize);
+
+  SizeMap m;
+  m.Init(kSizeClasses.classes);
+  for (size_t size = 0; size <= kMaxSize; ++size) {
+    const uint32_t size_class = m.SizeClass(CppPolicy(), size);
+    ASSERT_EQ(RoundToSizeClass(size), m.class_to_size(size_class)) << size;
+  }
+}
+
 }  // namespace
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
@@ -0,0 +1,70 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/sized_delete_check.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/logging.h"
+#include "tcmalloc/pages.h"
+#include "tcmalloc/static_vars.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+ABSL_CONST_INIT std::atomic<size_t> checks{0};
+ABSL_CONST_INIT std::atomic<size_t> mismatches{0};
+
+}  // namespace
+
+void SampledSizedDeleteCheck(void* ptr, size_t provided_size,
+                             size_t hinted_size_class) {
+  checks.fetch_add(1, std::memory_order_relaxed);
+  const size_t actual =
+      tc_globals.pagemap().sizeclass(PageIdContaining(ptr));
+  if (ABSL_PREDICT_TRUE(actual == hinted_size_class)) {
+    return;
+  }
+  // Distinct classes can still describe the same allocated bytes (e.g. a
+  // cold-capable twin); only a byte-size disagreement means the object will
+  // be freed into the wrong freelist.
+  const size_t actual_bytes = tc_globals.sizemap().class_to_size(actual);
+  const size_t hinted_bytes =
+      tc_globals.sizemap().class_to_size(hinted_size_class);
+  if (ABSL_PREDICT_TRUE(actual_bytes == hinted_bytes)) {
+    return;
+  }
+  mismatches.fetch_add(1, std::memory_order_relaxed);
+  Log(kLogWithStack, __FILE__, __LINE__,
+      "Mismatched sized delete: hinted size / bytes / actual bytes",
+      provided_size, hinted_bytes, actual_bytes);
+}
+
+size_t SizedDeleteMismatchChecks() {
+  return checks.load(std::memory_order_relaxed);
+}
+
+size_t SizedDeleteMismatches() {
+  return mismatches.load(std::memory_order_relaxed);
+}
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
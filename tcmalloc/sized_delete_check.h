@@ -0,0 +1,54 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sampled cross-checking of sized-delete size hints.  The sized-delete fast
+// path derives the size class from the caller's hint and never consults the
+// pagemap, so a wrong hint silently frees the object into the wrong
+// freelist.  When Parameters::sized_delete_mismatch_check_interval() is
+// nonzero, roughly one in that many sized deletes per thread additionally
+// reads the pagemap and compares; a disagreement is counted and logged with
+// a stack, but -- unlike Parameters::hardened_free_checks() -- does not
+// crash, so the sampling is safe to leave on in production to measure how
+// often the hint can actually be trusted.
+
+#ifndef TCMALLOC_SIZED_DELETE_CHECK_H_
+#define TCMALLOC_SIZED_DELETE_CHECK_H_
+
+#include <cstddef>
+
+#include "tcmalloc/internal/config.h"
+
+GOOGLE_MALLOC_SECTION_BEGIN
+namespace tcmalloc {
+namespace tcmalloc_internal {
+
+// Verifies that hinted_size_class (derived from the caller's size hint,
+// provided_size) matches the size class the pagemap records for ptr,
+// updating the counters below and logging on disagreement.  ptr must be
+// normal-tagged memory that resolved to a small size class.
+void SampledSizedDeleteCheck(void* ptr, size_t provided_size,
+                             size_t hinted_size_class);
+
+// Number of sized deletes that were cross-checked against the pagemap.
+size_t SizedDeleteMismatchChecks();
+
+// Number of cross-checked sized deletes whose hint disagreed with the
+// pagemap.
+size_t SizedDeleteMismatches();
+
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
+GOOGLE_MALLOC_SECTION_END
+
+#endif  // TCMALLOC_SIZED_DELETE_CHECK_H_
@@ -0,0 +1,77 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tcmalloc/sized_delete_check.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/parameters.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Runs first (before any test enables the sampling) so the counter baseline
+// reflects the default-off configuration.
+TEST(SizedDeleteCheckTest, DisabledByDefault) {
+  ASSERT_EQ(Parameters::sized_delete_mismatch_check_interval(), 0);
+  const size_t checks_before = SizedDeleteMismatchChecks();
+  for (int i = 0; i < 100; ++i) {
+    void* p = ::operator new(64);
+    sized_delete(p, 64);
+  }
+  EXPECT_EQ(SizedDeleteMismatchChecks(), checks_before);
+}
+
+TEST(SizedDeleteCheckTest, CorrectHintsCheckClean) {
+  const int64_t old_interval =
+      Parameters::sized_delete_mismatch_check_interval();
+  Parameters::set_sized_delete_mismatch_check_interval(1);
+
+  const size_t checks_before = SizedDeleteMismatchChecks();
+  const size_t mismatches_before = SizedDeleteMismatches();
+  constexpr int kFrees = 100;
+  for (int i = 0; i < kFrees; ++i) {
+    void* p = ::operator new(64);
+    sized_delete(p, 64);
+  }
+  // Sampled and guarded allocations bypass the sized-delete fast path, so
+  // not every free is necessarily cross-checked even at interval 1.
+  EXPECT_GE(SizedDeleteMismatchChecks(), checks_before + kFrees / 2);
+  EXPECT_EQ(SizedDeleteMismatches(), mismatches_before);
+
+  Parameters::set_sized_delete_mismatch_check_interval(old_interval);
+}
+
+TEST(SizedDeleteCheckTest, CountersExposedAsProperties) {
+  std::optional<size_t> checks = MallocExtension::GetNumericProperty(
+      "tcmalloc.sized_delete_mismatch_checks");
+  ASSERT_TRUE(checks.has_value());
+  EXPECT_EQ(*checks, SizedDeleteMismatchChecks());
+
+  std::optional<size_t> mismatches = MallocExtension::GetNumericProperty(
+      "tcmalloc.sized_delete_mismatches");
+  ASSERT_TRUE(mismatches.has_value());
+  EXPECT_EQ(*mismatches, SizedDeleteMismatches());
+}
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
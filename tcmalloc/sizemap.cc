@@ -14,18 +14,25 @@
 
 #include "tcmalloc/sizemap.h"
 
+#include <errno.h>
+#include <sys/mman.h>
+
 #include <algorithm>
 #include <cstddef>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <new>
 
 #include "absl/base/macros.h"
+#include "absl/numeric/bits.h"
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/huge_page_aware_allocator.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/environment.h"
 #include "tcmalloc/internal/logging.h"
+#include "tcmalloc/internal/page_size.h"
 #include "tcmalloc/internal/sampled_allocation.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/size_class_info.h"
@@ -35,6 +42,16 @@
 GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
 namespace tcmalloc_internal {
+namespace {
+
+// Objects of a size class are laid out end to end from a page-aligned span
+// start, so the class naturally guarantees the largest power of two dividing
+// its size, capped at the page size.
+uint32_t NaturalAlignment(size_t size) {
+  return static_cast<uint32_t>(std::min(size & (~size + 1), kPageSize));
+}
+
+}  // namespace
 
 const SizeClasses& SizeMap::CurrentClasses() {
   switch (Static::size_class_configuration()) {
@@ -161,6 +178,7 @@ bool SizeMap::SetSizeClasses(absl::Span<const SizeClassInfo> size_classes) {
   class_to_size_[0] = 0;
   class_to_pages_[0] = 0;
   num_objects_to_move_[0] = 0;
+  class_to_alignment_[0] = 0;
 
   int curr = 1;
   for (int c = 1; c < num_classes; c++) {
@@ -168,6 +186,7 @@ bool SizeMap::SetSizeClasses(absl::Span<const SizeClassInfo> size_classes) {
     class_to_pages_[curr] = size_classes[c].pages;
     num_objects_to_move_[curr] = size_classes[c].num_to_move;
     max_capacity_[curr] = size_classes[c].max_capacity;
+    class_to_alignment_[curr] = NaturalAlignment(size_classes[c].size);
     ++curr;
   }
 
@@ -176,6 +195,7 @@ bool SizeMap::SetSizeClasses(absl::Span<const SizeClassInfo> size_classes) {
     class_to_size_[x] = 0;
     class_to_pages_[x] = 0;
     num_objects_to_move_[x] = 0;
+    class_to_alignment_[x] = 0;
   }
 
   // Copy selected size classes into the upper registers.
@@ -186,6 +206,8 @@ bool SizeMap::SetSizeClasses(absl::Span<const SizeClassInfo> size_classes) {
               &class_to_pages_[kNumBaseClasses * i]);
     std::copy(&num_objects_to_move_[0], &num_objects_to_move_[kNumBaseClasses],
               &num_objects_to_move_[kNumBaseClasses * i]);
+    std::copy(&class_to_alignment_[0], &class_to_alignment_[kNumBaseClasses],
+              &class_to_alignment_[kNumBaseClasses * i]);
   }
 
   return true;
@@ -220,6 +242,15 @@ bool SizeMap::ValidSizeClasses(absl::Span<const SizeClassInfo> size_classes) {
     if (!IsValidSizeClass(class_size, pages, num_objects_to_move)) {
       return false;
     }
+    // A declared alignment is a promise to callers; the class's layout must
+    // actually provide it.
+    const size_t alignment = size_classes[c].alignment;
+    if (alignment != 0 && (!absl::has_single_bit(alignment) ||
+                           alignment > NaturalAlignment(class_size))) {
+      Log(kLog, __FILE__, __LINE__, "declared alignment not provided by class",
+          c, class_size, alignment);
+      return false;
+    }
   }
   // Last size class must be kMaxSize.  This is not strictly
   // class_to_size_[kNumBaseClasses - 1] because several size class
@@ -265,6 +296,26 @@ bool SizeMap::Init(absl::Span<const SizeClassInfo> size_classes) {
     }
   }
 
+  // Opt-in span cache coloring: TCMALLOC_COLORED_SIZE_CLASSES is a
+  // comma-separated list of class byte sizes (e.g. "512,1024") whose spans
+  // the central freelist colors.  See SetSpanColoring().
+  const char* colored = thread_safe_getenv("TCMALLOC_COLORED_SIZE_CLASSES");
+  while (colored != nullptr && *colored != '\0') {
+    char* end;
+    const size_t colored_size = strtoul(colored, &end, 10);
+    if (colored_size != 0) {
+      for (int c = 1; c < kNumClasses; c++) {
+        if (class_to_size_[c] == colored_size) {
+          SetSpanColoring(c, true);
+        }
+      }
+    }
+    if (end == colored || *end != ',') {
+      break;
+    }
+    colored = end + 1;
+  }
+
   if (!ColdFeatureActive()) {
     return true;
   }
@@ -304,6 +355,53 @@ bool SizeMap::Init(absl::Span<const SizeClassInfo> size_classes) {
   return true;
 }
 
+bool SizeMap::Seal() {
+  const size_t page_size = GetPageSize();
+  // alignas guarantees both the base alignment and the padded size, so on
+  // page sizes dividing kSizeMapAlignment the instance is exactly a run of
+  // whole pages.  Larger pages (e.g. 64KiB) would sweep neighbors into the
+  // protection change; skip sealing there.
+  if (page_size == 0 || kSizeMapAlignment % page_size != 0) {
+    return false;
+  }
+  TC_ASSERT_EQ(reinterpret_cast<uintptr_t>(this) % kSizeMapAlignment, 0);
+  if (mprotect(this, sizeof(*this), PROT_READ) != 0) {
+    Log(kLog, __FILE__, __LINE__, "mprotect() sizemap seal failed (errno)",
+        errno);
+    return false;
+  }
+  return true;
+}
+
+bool SizeMap::Unseal() {
+  const size_t page_size = GetPageSize();
+  if (page_size == 0 || kSizeMapAlignment % page_size != 0) {
+    return false;
+  }
+  return mprotect(this, sizeof(*this), PROT_READ | PROT_WRITE) == 0;
+}
+
+bool SizeMap::SetSpanColoring(size_t size_class, bool enabled) {
+  if (size_class >= kNumClasses) {
+    return false;
+  }
+  const size_t size = class_to_size_[size_class];
+  if (size == 0) {
+    return false;
+  }
+  // The aligned-allocation search in GetSizeClass skips colored classes and
+  // relies on a kPageSize-aligned class always remaining; never color one.
+  if (enabled && (size % kPageSize) == 0) {
+    return false;
+  }
+  span_coloring_[size_class] = enabled;
+  // Colored spans offset objects by per-span multiples of kAlignment, so the
+  // class guarantees only kAlignment until coloring is turned off again.
+  class_to_alignment_[size_class] =
+      enabled ? static_cast<uint32_t>(kAlignment) : NaturalAlignment(size);
+  return true;
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -40,8 +40,15 @@ extern const SizeClasses kExperimentalPow2SizeClasses;
 extern const SizeClasses kLegacySizeClasses;
 extern const SizeClasses kLowFragSizeClasses;
 
+// SizeMap instances are aligned and padded (sizeof is rounded up to the
+// alignment) to this many bytes, so the tables occupy whole pages of their
+// own on 4KiB-page systems: the most-read data in the process never shares a
+// page -- or a cache line -- with mutable state, and the global instance can
+// be sealed read-only after initialization (see Seal()).
+inline constexpr size_t kSizeMapAlignment = 4096;
+
 // Size-class information + mapping
-class SizeMap {
+class alignas(kSizeMapAlignment) SizeMap {
  public:
   // Min allocation size for cold. Once more applications can provide cold hints
   // with PGHO, we can consider adding more size classes for cold to increase
@@ -134,6 +141,15 @@ class SizeMap {
 
   uint32_t max_capacity_[kNumClasses] = {0};
 
+  // Classes whose spans are cache-colored; see SetSpanColoring().
+  bool span_coloring_[kNumClasses] = {false};
+
+  // Alignment guaranteed by each size class: the largest power of two
+  // dividing its size (capped at kPageSize), reduced to kAlignment while the
+  // class's spans are cache-colored.  Folding both into one array keeps the
+  // aligned-allocation search in GetSizeClass() to a single load per class.
+  uint32_t class_to_alignment_[kNumClasses] = {0};
+
   // If size is no more than kMaxSize, compute index of the
   // class_array[] entry for it, putting the class index in output
   // parameter idx and returning true. Otherwise return false.
@@ -186,6 +202,16 @@ class SizeMap {
   // Initialize the mapping arrays.  Returns true on success.
   bool Init(absl::Span<const SizeClassInfo> size_classes);
 
+  // Remaps this instance's pages read-only, sealing the tables against stray
+  // writes: they are read on every malloc and never change after Init(), so
+  // a wild store that lands here now faults at the store instead of
+  // silently misclassifying every subsequent allocation.  Call after Init()
+  // and any SetSpanColoring() configuration.  Best effort: returns false
+  // without sealing when the system page size does not divide
+  // kSizeMapAlignment.  Unseal() reverts it (tests reuse instances).
+  bool Seal();
+  bool Unseal();
+
   // Returns the size class for size `size` respecting the alignment
   // & access requirements of `policy`.
   //
@@ -241,11 +267,13 @@ class SizeMap {
     // (at least kMaxSize is aligned on kPageSize).
     static_assert((kMaxSize % kPageSize) == 0, "the loop below won't work");
     // Profiles say we usually get the right class based on the size,
-    // so avoid the loop overhead on the fast path.
-    if (ABSL_PREDICT_FALSE(class_to_size(*size_class) & (align - 1))) {
+    // so avoid the loop overhead on the fast path.  class_to_alignment_
+    // already accounts for cache-colored classes, which do not place objects
+    // at size-multiple offsets and so satisfy no alignment beyond kAlignment.
+    if (ABSL_PREDICT_FALSE(class_to_alignment_[*size_class] < align)) {
       do {
         ++*size_class;
-      } while (ABSL_PREDICT_FALSE(class_to_size(*size_class) & (align - 1)));
+      } while (ABSL_PREDICT_FALSE(class_to_alignment_[*size_class] < align));
     }
     return true;
   }
@@ -261,6 +289,39 @@ class SizeMap {
     return ret;
   }
 
+  // Classifies a batch of sizes at once, writing sizes.size() entries to out.
+  // Returns true iff every size was classified; if any size exceeds kMaxSize
+  // the corresponding output entries are unspecified.
+  //
+  // Unlike GetSizeClass(), the loop body computes both candidate indices and
+  // selects between them, so it contains no per-size branches and the
+  // compiler can unroll and vectorize it.  This makes it substantially
+  // cheaper than per-size calls when classifying bulk deallocations (see
+  // sizemap_benchmark.cc).
+  //
+  // Requires that policy requests no alignment beyond kAlignment and no cold
+  // access; callers with such requirements must use GetSizeClass() per size.
+  template <typename Policy>
+  inline bool GetSizeClasses(Policy policy, absl::Span<const size_t> sizes,
+                             CompactSizeClass* out) const {
+    ASSERT(policy.align() <= static_cast<size_t>(kAlignment));
+    ASSERT(!IsColdHint(policy.access()));
+    const size_t numa_shift = policy.scaled_numa_partition();
+    bool all_ok = true;
+    for (size_t i = 0, n = sizes.size(); i < n; ++i) {
+      const size_t s = sizes[i];
+      const size_t small_idx = (s + 7) >> 3;
+      const size_t large_idx = (s + 127 + (120 << 7)) >> 7;
+      size_t idx = s <= kLargeSize ? small_idx : large_idx;
+      all_ok &= s <= kMaxSize;
+      // Clamp out-of-range indices to keep the load in bounds without
+      // branching; all_ok already records the failure.
+      idx = idx < kClassArraySize ? idx : 0;
+      out[i] = class_array_[idx] + numa_shift;
+    }
+    return all_ok;
+  }
+
   // Get the byte-size for a specified class. REQUIRES: size_class <=
   // kNumClasses.
   ABSL_ATTRIBUTE_ALWAYS_INLINE inline size_t class_to_size(
@@ -300,6 +361,32 @@ class SizeMap {
     return {cold_sizes_, cold_sizes_count_};
   }
 
+  // Returns the alignment every object of the given size class is guaranteed
+  // to have: the largest power of two dividing the class size (capped at
+  // kPageSize), or kAlignment while the class's spans are cache-colored.
+  // Returns 0 for unpopulated classes.  REQUIRES: size_class < kNumClasses.
+  ABSL_ATTRIBUTE_ALWAYS_INLINE size_t
+  class_to_alignment(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return class_to_alignment_[size_class];
+  }
+
+  // Returns true if spans of this size class are cache-colored: the central
+  // freelist offsets each span's objects by a rotating per-span color so that
+  // same-class objects allocated together spread across cache set indices.
+  ABSL_ATTRIBUTE_ALWAYS_INLINE bool span_coloring(size_t size_class) const {
+    TC_ASSERT_LT(size_class, kNumClasses);
+    return span_coloring_[size_class];
+  }
+
+  // Opts the size class in or out of span cache coloring.  Returns false if
+  // the class cannot be colored: it must be populated and its size must not
+  // be a multiple of kPageSize, since the aligned-allocation search in
+  // GetSizeClass() skips colored classes and relies on a page-aligned class
+  // always remaining usable.  Classes are typically configured at startup via
+  // the TCMALLOC_COLORED_SIZE_CLASSES environment variable; see Init().
+  bool SetSpanColoring(size_t size_class, bool enabled);
+
   static bool IsValidSizeClass(size_t size, size_t num_pages,
                                size_t num_objects_to_move);
 };
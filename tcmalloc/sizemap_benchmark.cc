@@ -0,0 +1,83 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "tcmalloc/common.h"
+#include "tcmalloc/sizemap.h"
+#include "tcmalloc/static_vars.h"
+#include "tcmalloc/tcmalloc_policy.h"
+
+namespace tcmalloc {
+namespace tcmalloc_internal {
+namespace {
+
+// Number of sizes classified per benchmark iteration.  Large enough to
+// amortize the loop overhead, small enough that the size array stays in L1.
+constexpr int kNumSizes = 4096;
+
+std::vector<size_t> RandomSizes() {
+  absl::BitGen rnd;
+  std::vector<size_t> sizes(kNumSizes);
+  for (size_t& size : sizes) {
+    size = absl::Uniform<size_t>(rnd, 1, kMaxSize + 1);
+  }
+  return sizes;
+}
+
+// Baseline: classify one size at a time, the way the scalar fast path does.
+void BM_GetSizeClass(benchmark::State& state) {
+  const std::vector<size_t> sizes = RandomSizes();
+  const SizeMap& sizemap = tc_globals.sizemap();
+  std::vector<CompactSizeClass> classes(kNumSizes);
+
+  for (auto s : state) {
+    for (int i = 0; i < kNumSizes; ++i) {
+      size_t size_class;
+      sizemap.GetSizeClass(CppPolicy(), sizes[i], &size_class);
+      classes[i] = size_class;
+    }
+    benchmark::DoNotOptimize(classes);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSizes);
+}
+BENCHMARK(BM_GetSizeClass);
+
+// Classify the same sizes through the branch-free batch API, varying the
+// batch length handed to each call.
+void BM_GetSizeClasses(benchmark::State& state) {
+  const size_t batch_size = state.range(0);
+  const std::vector<size_t> sizes = RandomSizes();
+  const SizeMap& sizemap = tc_globals.sizemap();
+  std::vector<CompactSizeClass> classes(kNumSizes);
+
+  for (auto s : state) {
+    for (int i = 0; i < kNumSizes; i += batch_size) {
+      sizemap.GetSizeClasses(CppPolicy(),
+                             absl::MakeConstSpan(&sizes[i], batch_size),
+                             &classes[i]);
+    }
+    benchmark::DoNotOptimize(classes);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSizes);
+}
+BENCHMARK(BM_GetSizeClasses)->RangeMultiplier(2)->Range(8, 512);
+
+}  // namespace
+}  // namespace tcmalloc_internal
+}  // namespace tcmalloc
@@ -110,4 +110,127 @@ TEST(ColdSizeClassTest, VerifyAllocationFullRange) {
   }
 }
 
+TEST(SizeMapTest, GetSizeClassesMatchesScalar) {
+  SizeMap size_map;
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+
+  std::vector<size_t> sizes;
+  for (size_t size = 0; size <= kMaxSize; ++size) {
+    sizes.push_back(size);
+  }
+  std::vector<CompactSizeClass> classes(sizes.size());
+  ASSERT_TRUE(size_map.GetSizeClasses(CppPolicy(), sizes, classes.data()));
+  for (size_t size = 0; size <= kMaxSize; ++size) {
+    size_t expected;
+    ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), size, &expected));
+    ASSERT_EQ(classes[size], expected) << size;
+  }
+}
+
+TEST(SizeMapTest, SpanColoring) {
+  SizeMap size_map;
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+
+  // Default-aligned lookups are unaffected by coloring.
+  size_t colored;
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), 512, &colored));
+  ASSERT_TRUE(size_map.SetSpanColoring(colored, true));
+  EXPECT_TRUE(size_map.span_coloring(colored));
+  size_t got;
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), 512, &got));
+  EXPECT_EQ(got, colored);
+
+  // Aligned lookups must skip the colored class, since its objects are no
+  // longer placed at size-multiple offsets.
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy().AlignAs(256), 512, &got));
+  EXPECT_NE(got, colored);
+  EXPECT_EQ(size_map.class_to_size(got) % 256, 0);
+
+  // Coloring can be turned off again.
+  ASSERT_TRUE(size_map.SetSpanColoring(colored, false));
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy().AlignAs(256), 512, &got));
+  EXPECT_EQ(got, colored);
+
+  // Unpopulated classes and classes whose size is a kPageSize multiple (the
+  // aligned-allocation fallback) cannot be colored.
+  EXPECT_FALSE(size_map.SetSpanColoring(kNumClasses, true));
+  size_t page_class;
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), kMaxSize, &page_class));
+  EXPECT_FALSE(size_map.SetSpanColoring(page_class, true));
+}
+
+TEST(SizeMapTest, ClassToAlignment) {
+  SizeMap size_map;
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+
+  // Every populated class guarantees the largest power of two dividing its
+  // size, capped at the page size.
+  for (size_t c = 1; c < kNumClasses; ++c) {
+    const size_t size = size_map.class_to_size(c);
+    if (size == 0) continue;
+    EXPECT_EQ(size_map.class_to_alignment(c),
+              std::min(size & (~size + 1), kPageSize))
+        << c;
+  }
+
+  // Page-aligned buffer sizes typical of direct I/O resolve to size classes
+  // (and thus the per-CPU caches) rather than falling back to the page heap.
+  for (size_t size = 4096; size <= std::min(kMaxSize, size_t{65536});
+       size += 4096) {
+    size_t size_class;
+    ASSERT_TRUE(
+        size_map.GetSizeClass(CppPolicy().AlignAs(4096), size, &size_class));
+    EXPECT_GE(size_map.class_to_alignment(size_class), 4096) << size;
+    EXPECT_GE(size_map.class_to_size(size_class), size);
+  }
+
+  // Coloring a class reduces its guarantee to kAlignment; turning coloring
+  // off restores the natural guarantee.
+  size_t colored;
+  ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), 512, &colored));
+  const size_t natural = size_map.class_to_alignment(colored);
+  ASSERT_TRUE(size_map.SetSpanColoring(colored, true));
+  EXPECT_EQ(size_map.class_to_alignment(colored),
+            static_cast<size_t>(kAlignment));
+  ASSERT_TRUE(size_map.SetSpanColoring(colored, false));
+  EXPECT_EQ(size_map.class_to_alignment(colored), natural);
+}
+
+TEST(SizeMapTest, SealedLookupsStillWork) {
+  // The alignas padding makes every instance an exact run of pages, so
+  // sealing covers the tables and nothing else.
+  static_assert(sizeof(SizeMap) % kSizeMapAlignment == 0);
+
+  SizeMap size_map;
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+
+  std::vector<size_t> expected(kMaxSize + 1);
+  for (size_t size = 0; size <= kMaxSize; ++size) {
+    ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), size, &expected[size]));
+  }
+
+  if (!size_map.Seal()) {
+    GTEST_SKIP() << "system page size does not divide kSizeMapAlignment";
+  }
+  for (size_t size = 0; size <= kMaxSize; ++size) {
+    size_t got;
+    ASSERT_TRUE(size_map.GetSizeClass(CppPolicy(), size, &got));
+    EXPECT_EQ(got, expected[size]) << size;
+    EXPECT_GE(size_map.class_to_size(got), size);
+  }
+
+  // Unseal must make the instance writable again.
+  ASSERT_TRUE(size_map.Unseal());
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+}
+
+TEST(SizeMapTest, GetSizeClassesRejectsOversized) {
+  SizeMap size_map;
+  ASSERT_TRUE(size_map.Init(kSizeClasses.classes));
+
+  const size_t sizes[] = {8, kMaxSize, kMaxSize + 1};
+  CompactSizeClass classes[3];
+  EXPECT_FALSE(size_map.GetSizeClasses(CppPolicy(), sizes, classes));
+}
+
 }  // namespace tcmalloc::tcmalloc_internal
@@ -16,6 +16,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 
@@ -127,7 +128,7 @@ double Span::Fragmentation(size_t object_size) const {
 //
 
 void* Span::BitmapIdxToPtr(ObjIdx idx, size_t size) const {
-  uintptr_t off = first_page_.start_uintptr() + idx * size;
+  uintptr_t off = first_page_.start_uintptr() + bitmap_color() + idx * size;
   return reinterpret_cast<ObjIdx*>(off);
 }
 
@@ -136,15 +137,15 @@ size_t Span::BitmapPopBatch(void** __restrict batch, size_t N, size_t size) {
   size_t before = bitmap_.CountBits(0, bitmap_.size());
 #endif  // NDEBUG
 
-  size_t count = 0;
   // Want to fill the batch either with N objects, or the number of objects
-  // remaining in the span.
-  while (!bitmap_.IsZero() && count < N) {
-    size_t offset = bitmap_.FindSet(0);
-    ASSERT(offset < bitmap_.size());
-    batch[count] = BitmapIdxToPtr(offset, size);
-    bitmap_.ClearLowestBit();
-    count++;
+  // remaining in the span.  Extracting the set bits a word at a time avoids
+  // rescanning the bitmap from the start for every object, which dominated
+  // this path during central freelist refills.
+  size_t indices[kBitmapSize];
+  const size_t count =
+      bitmap_.PopLowestBits(std::min(N, bitmap_.size()), indices);
+  for (size_t i = 0; i < count; ++i) {
+    batch[i] = BitmapIdxToPtr(indices[i], size);
   }
 
   ASSERT(bitmap_.CountBits(0, bitmap_.size()) + count == before);
@@ -154,9 +155,7 @@ size_t Span::BitmapPopBatch(void** __restrict batch, size_t N, size_t size) {
 }
 
 size_t Span::FreelistPopBatch(void** __restrict batch, size_t N, size_t size) {
-  // Handle spans with bitmap_.size() or fewer objects using a bitmap. We expect
-  // spans to frequently hold smaller objects.
-  if (ABSL_PREDICT_FALSE(UseBitmapForSize(size))) {
+  if (ABSL_PREDICT_FALSE(has_bitmap())) {
     return BitmapPopBatch(batch, N, size);
   }
   return ListPopBatch(batch, N, size);
@@ -237,18 +236,29 @@ void Span::BuildBitmap(size_t size, size_t count) {
   ASSERT(bitmap_.CountBits(0, bitmap_.size()) == count);
 }
 
-int Span::BuildFreelist(size_t size, size_t count, void** batch, int N) {
+int Span::BuildFreelist(size_t size, size_t count, void** batch, int N,
+                        size_t color, bool use_bitmap) {
   TC_ASSERT_GT(count, 0);
+  TC_ASSERT_EQ(color % static_cast<size_t>(kAlignment), 0);
+  TC_ASSERT_LE(color + count * size, bytes_in_span());
+  // The representation may deviate from the size-based default only where
+  // both are valid.
+  ASSERT(use_bitmap == UseBitmapForSize(size) ||
+         SupportsBothRepresentations(size, num_pages_.raw_num()));
   freelist_ = kListEnd;
 
-  if (UseBitmapForSize(size)) {
+  if (use_bitmap) {
+    cache_size_ = kBitmapMarker;
+    // Bitmap indices do not encode the offset, so the color must be stored
+    // for the pointer <-> index conversions.
+    embed_count_ = color >> kAlignmentShift;
     BuildBitmap(size, count);
     return BitmapPopBatch(batch, N, size);
   }
 
   // First, push as much as we can into the batch.
   const uintptr_t start = first_page_.start_uintptr();
-  char* ptr = reinterpret_cast<char*>(start);
+  char* ptr = reinterpret_cast<char*>(start + color);
   int result = N <= count ? N : count;
   for (int i = 0; i < result; ++i) {
     batch[i] = ptr;
@@ -257,8 +267,12 @@ int Span::BuildFreelist(size_t size, size_t count, void** batch, int N) {
   allocated_.store(result, std::memory_order_relaxed);
 
   const ObjIdx idxStep = size / static_cast<size_t>(kAlignment);
-  // Valid objects are {0, idxStep, idxStep * 2, ..., idxStep * (count - 1)}.
-  ObjIdx idx = idxStep * result;
+  // Compressed-list indices are plain offsets from the span start, so the
+  // color folds into the index of the first object.
+  const ObjIdx idxColor = color / static_cast<size_t>(kAlignment);
+  // Valid objects are {idxColor, idxColor + idxStep, ...,
+  // idxColor + idxStep * (count - 1)}.
+  ObjIdx idx = idxColor + idxStep * result;
 
   // Verify that the end of the useful portion of the span (and the beginning of
   // the span waste) has an index that doesn't overflow or risk confusion with
@@ -266,10 +280,10 @@ int Span::BuildFreelist(size_t size, size_t count, void** batch, int N) {
   // PtrToIdx for that) but rules out some bugs and weakening it wouldn't
   // actually help. One example of the potential bugs that are ruled out is the
   // possibility of idxEnd (below) overflowing.
-  ASSERT(count * idxStep < kListEnd);
+  ASSERT(idxColor + count * idxStep < kListEnd);
 
   // The index of the end of the useful portion of the span.
-  ObjIdx idxEnd = count * idxStep;
+  ObjIdx idxEnd = idxColor + count * idxStep;
 
   // Then, push as much as we can into the cache_.
   int cache_size = 0;
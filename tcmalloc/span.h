@@ -178,10 +178,8 @@ class Span : public SpanList::Elem {
   // These methods REQUIRE a SMALL_OBJECT span.
   // ---------------------------------------------------------------------------
 
-  // Indicate whether the Span is empty. Size is used to determine whether
-  // the span is using a compressed linked list of objects, or a bitmap
-  // to hold available objects.
-  bool FreelistEmpty(size_t size) const;
+  // Indicate whether the Span is empty.
+  bool FreelistEmpty() const;
 
   // Pushes ptr onto freelist unless the freelist becomes full, in which case
   // just return false.
@@ -196,14 +194,41 @@ class Span : public SpanList::Elem {
   // Reset a Span object to track the range [p, p + n).
   void Init(PageId p, Length n);
 
-  // Initialize freelist to contain all objects in the span.
+  // Spacing between span colors, in bytes.  One cache line, so that
+  // successive colors shift objects onto distinct cache set indices.
+  static constexpr size_t kColorStride = ABSL_CACHELINE_SIZE;
+
+  // Maximum number of distinct span colors.  A span's usable colors are
+  // additionally limited by its tail waste; see CentralFreeList.
+  static constexpr size_t kMaxColors = 8;
+
+  // Initialize freelist to contain all objects in the span.  The first object
+  // is placed <color> bytes past the span start; rotating the color across
+  // spans spreads same-class objects over cache set indices.  <color> must be
+  // a multiple of kAlignment and, together with the <count> objects, must fit
+  // in the span.
   // Pops up to N objects from the freelist and returns them in the batch array.
   // Returns number of objects actually popped.
-  int BuildFreelist(size_t size, size_t count, void** batch, int N);
+  int BuildFreelist(size_t size, size_t count, void** batch, int N,
+                    size_t color);
+
+  // As above, but with the freelist representation chosen by the caller
+  // rather than derived from the object size.  <use_bitmap> may deviate from
+  // the size-based default only for size/pages combinations where
+  // SupportsBothRepresentations() holds.  The chosen representation is
+  // recorded in the span and stays fixed until the next BuildFreelist.
+  int BuildFreelist(size_t size, size_t count, void** batch, int N,
+                    size_t color, bool use_bitmap);
 
   // Prefetch cacheline containing most important span information.
   void Prefetch();
 
+  // Prefetch the object holding the freelist head: the first span memory a
+  // batch pop touches once the embedded cache drains.  Bitmap-managed spans
+  // keep all freelist state inline, so there is nothing to fetch for them.
+  // REQUIRES: this is a SMALL_OBJECT span.
+  void PrefetchFreelist(size_t size);
+
   // IsValidSizeClass verifies size class parameters from the Span perspective.
   static bool IsValidSizeClass(size_t size, size_t pages);
 
@@ -211,6 +236,13 @@ class Span : public SpanList::Elem {
   // for cold size classes.
   static bool IsNonIntrusive(size_t size);
 
+  // Returns true if spans of <pages> pages holding objects of <size> are
+  // valid under both freelist representations: the compressed list addresses
+  // only a single page, and the bitmap requires the span's objects to fit in
+  // it.  Only for such combinations may BuildFreelist be asked to deviate
+  // from the size-based default.
+  static bool SupportsBothRepresentations(size_t size, size_t pages);
+
   // For bitmap'd spans conversion from an offset to an index is performed
   // by multiplying by the scaled reciprocal of the object size.
   static uint32_t CalcReciprocal(size_t size);
@@ -229,6 +261,10 @@ class Span : public SpanList::Elem {
   // look at b/35680381 and cl/199502226.
   // For available objects stored as a compressed linked list, the index of
   // the first object in recorded in freelist_.
+  // Bitmap-managed spans do not use the compressed list; for them embed_count_
+  // instead records the span's color (in kAlignment units), see
+  // bitmap_color(), and cache_size_ holds kBitmapMarker to identify the
+  // representation.
   struct {
     uint16_t embed_count_;
     uint16_t freelist_;
@@ -243,14 +279,22 @@ class Span : public SpanList::Elem {
   uint8_t is_donated_ : 1;
 
   static constexpr size_t kCacheSize = 4;
-  static constexpr size_t kBitmapSize = 8 * sizeof(ObjIdx) * kCacheSize;
+  // Two 64-bit words, i.e. twice the embed cache.  Widening the bitmap past
+  // the cache extends the non-intrusive representation to smaller objects
+  // and permits multi-page size classes with up to kBitmapSize objects;
+  // Bitmap skips over empty words, so the extra word costs nothing on pops.
+  static constexpr size_t kBitmapSize = 2 * 8 * sizeof(ObjIdx) * kCacheSize;
+
+  // cache_size_ value marking a span whose freelist is bitmap-managed.  Such
+  // spans never use the embedded cache, so the value cannot occur naturally.
+  static constexpr uint8_t kBitmapMarker = 0xff;
 
   union {
     // Used only for spans in CentralFreeList (SMALL_OBJECT state).
     // Embed cache of free objects.
     ObjIdx cache_[kCacheSize];
 
-    // Used for spans with in CentralFreeList with fewer than 64 objects.
+    // Used for spans in CentralFreeList with kBitmapSize or fewer objects.
     // Each bit is set to one when the object is available, and zero
     // when the object is used.
     Bitmap<kBitmapSize> bitmap_{};
@@ -265,6 +309,10 @@ class Span : public SpanList::Elem {
   // Returns true if Span will use bitmap for objects of size <size>.
   static bool UseBitmapForSize(size_t size);
 
+  // Returns true if this span's freelist is bitmap-managed.  The
+  // representation is recorded by BuildFreelist, which chooses it.
+  bool has_bitmap() const { return cache_size_ == kBitmapMarker; }
+
   // Convert object pointer <-> freelist index.
   ObjIdx PtrToIdx(void* ptr, size_t size) const;
   ObjIdx* IdxToPtr(ObjIdx idx, size_t size, uintptr_t start) const;
@@ -273,6 +321,12 @@ class Span : public SpanList::Elem {
   ObjIdx BitmapPtrToIdx(void* ptr, size_t size, uint32_t reciprocal) const;
   void* BitmapIdxToPtr(ObjIdx idx, size_t size) const;
 
+  // Color offset of a bitmap-managed span, in bytes.  Stored in embed_count_,
+  // which the compressed-list representation of such spans leaves unused.
+  size_t bitmap_color() const {
+    return static_cast<size_t>(embed_count_) << kAlignmentShift;
+  }
+
   // Helper function for converting a pointer to an index.
   static ObjIdx OffsetToIdx(uintptr_t offset, uint32_t reciprocal);
 
@@ -280,16 +334,16 @@ class Span : public SpanList::Elem {
 
   bool ListPush(void* ptr, size_t size);
 
-  // For spans containing 64 or fewer objects, indicate that the object at the
-  // index has been returned. Always returns true.
+  // For spans containing kBitmapSize or fewer objects, indicate that the
+  // object at the index has been returned. Always returns true.
   bool BitmapPush(void* ptr, size_t size, uint32_t reciprocal);
 
   // A bitmap is used to indicate object availability for spans containing
-  // 64 or fewer objects.
+  // kBitmapSize or fewer objects.
   void BuildBitmap(size_t size, size_t count);
 
-  // For spans with 64 or fewer objects populate batch with up to N objects.
-  // Returns number of objects actually popped.
+  // For spans with kBitmapSize or fewer objects populate batch with up to N
+  // objects.  Returns number of objects actually popped.
   size_t BitmapPopBatch(void** batch, size_t N, size_t size);
 
   // Friend class to enable more indepth testing of bitmap code.
@@ -330,9 +384,7 @@ inline bool Span::FreelistPush(void* ptr, size_t size, uint32_t reciprocal) {
     return false;
   }
   allocated_.store(allocated - 1, std::memory_order_relaxed);
-  // Bitmaps are used to record object availability when there are fewer than
-  // 64 objects in a span.
-  if (ABSL_PREDICT_FALSE(UseBitmapForSize(size))) {
+  if (ABSL_PREDICT_FALSE(has_bitmap())) {
     return BitmapPush(ptr, size, reciprocal);
   }
   return ListPush(ptr, size);
@@ -372,7 +424,8 @@ inline Span::ObjIdx Span::OffsetToIdx(uintptr_t offset, uint32_t reciprocal) {
 inline Span::ObjIdx Span::BitmapPtrToIdx(void* ptr, size_t size,
                                          uint32_t reciprocal) const {
   uintptr_t p = reinterpret_cast<uintptr_t>(ptr);
-  uintptr_t off = static_cast<uint32_t>(p - first_page_.start_uintptr());
+  uintptr_t off =
+      static_cast<uint32_t>(p - first_page_.start_uintptr() - bitmap_color());
   ObjIdx idx = OffsetToIdx(off, reciprocal);
   ASSERT(BitmapIdxToPtr(idx, size) == ptr);
   return idx;
@@ -429,8 +482,8 @@ inline void Span::set_num_pages(Length len) { num_pages_ = len; }
 
 inline size_t Span::bytes_in_span() const { return num_pages_.in_bytes(); }
 
-inline bool Span::FreelistEmpty(size_t size) const {
-  if (UseBitmapForSize(size)) {
+inline bool Span::FreelistEmpty() const {
+  if (has_bitmap()) {
     return bitmap_.IsZero();
   } else {
     return cache_size_ == 0 && freelist_ == kListEnd;
@@ -441,7 +494,7 @@ inline void Span::Prefetch() {
   // TODO(b/304135905): Will revisit this.
   // The first 16 bytes of a Span are the next and previous pointers
   // for when it is stored in a linked list. Since the sizeof(Span) is
-  // 48 bytes, spans fit into 2 cache lines 50% of the time, with either
+  // 56 bytes, spans fit into 2 cache lines most of the time, with either
   // the first 16-bytes or the last 16-bytes in a different cache line.
   // Prefetch the cacheline that contains the most frequestly accessed
   // data by offseting into the middle of the Span.
@@ -449,6 +502,16 @@ inline void Span::Prefetch() {
   PrefetchT0(&this->allocated_);
 }
 
+inline void Span::PrefetchFreelist(size_t size) {
+  if (has_bitmap()) return;
+  if (freelist_ == kListEnd) {
+    // The remaining objects all sit in the embedded cache; no span memory
+    // is read to pop them.
+    return;
+  }
+  PrefetchT0(IdxToPtr(freelist_, size, first_page_.start_uintptr()));
+}
+
 inline void Span::Init(PageId p, Length n) {
   ASSERT(p > PageId{0});
 #ifndef NDEBUG
@@ -486,6 +549,17 @@ inline bool Span::UseBitmapForSize(size_t size) {
 // callers care about, while use of bitmap is an implementation detail.
 inline bool Span::IsNonIntrusive(size_t size) { return UseBitmapForSize(size); }
 
+inline bool Span::SupportsBothRepresentations(size_t size, size_t pages) {
+  // A single page bounds the object count by kPageSize / size, which
+  // UseBitmapForSize guarantees fits in the bitmap.
+  return pages == 1 && UseBitmapForSize(size);
+}
+
+inline int Span::BuildFreelist(size_t size, size_t count, void** batch, int N,
+                               size_t color) {
+  return BuildFreelist(size, count, batch, N, color, UseBitmapForSize(size));
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
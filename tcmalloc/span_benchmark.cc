@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 
@@ -44,7 +45,7 @@ class RawSpan {
     int res = posix_memalign(&mem, kPageSize, npages.in_bytes());
     TC_CHECK_EQ(res, 0);
     span_.Init(PageIdContaining(mem), npages);
-    span_.BuildFreelist(size, objects_per_span, nullptr, 0);
+    span_.BuildFreelist(size, objects_per_span, nullptr, 0, 0);
   }
 
   ~RawSpan() { free(span_.start_address()); }
@@ -153,6 +154,115 @@ BENCHMARK(BM_single_span_fulldrain)
     ->Arg(40)
     ->Arg(80);
 
+// BM_span_rebuild_pop measures the central freelist refill path in
+// isolation: rebuild the span's freelist and pop every object in batches.
+// For the larger size class arguments the span is in bitmap mode, so this is
+// dominated by Span::BitmapPopBatch.
+void BM_span_rebuild_pop(benchmark::State& state) {
+  const int size_class = state.range(0);
+
+  const size_t size = tc_globals.sizemap().class_to_size(size_class);
+  TC_CHECK_GT(size, 0);
+  const size_t npages = tc_globals.sizemap().class_to_pages(size_class);
+  const size_t batch_size =
+      tc_globals.sizemap().num_objects_to_move(size_class);
+  const size_t objects_per_span = npages * kPageSize / size;
+  RawSpan raw_span;
+  raw_span.Init(size_class);
+  Span& span = raw_span.span();
+
+  void* batch[kMaxObjectsToMove];
+
+  int64_t processed = 0;
+  while (state.KeepRunningBatch(objects_per_span)) {
+    size_t popped = 0;
+    while (popped < objects_per_span) {
+      size_t n = span.FreelistPopBatch(batch, batch_size, size);
+      if (n == 0) break;
+      popped += n;
+      benchmark::DoNotOptimize(batch);
+    }
+    processed += popped;
+
+    // Return every object to the span by rebuilding its freelist, as happens
+    // when a span returns to the central freelist and is refilled.
+    span.BuildFreelist(size, objects_per_span, nullptr, 0, 0);
+  }
+
+  state.SetItemsProcessed(processed);
+}
+
+BENCHMARK(BM_span_rebuild_pop)
+    ->Arg(12)
+    ->Arg(16)
+    ->Arg(20)
+    ->Arg(30)
+    ->Arg(40)
+    ->Arg(80);
+
+// BM_freelist_representation drives a span through full drain/refill cycles
+// with the freelist representation forced to the compressed list or the
+// bitmap, and with objects returned in pop order (monotone, LIFO-like) or
+// shuffled.  Comparing the four combinations sets the monotone-fraction
+// thresholds at which CentralFreeList flips the representation; see
+// CentralFreeList::RecordFreeOrder.
+void BM_freelist_representation(benchmark::State& state) {
+  const size_t size = state.range(0);
+  const bool use_bitmap = state.range(1) != 0;
+  const bool shuffled = state.range(2) != 0;
+
+  TC_CHECK(Span::SupportsBothRepresentations(size, 1));
+  const uint32_t reciprocal = Span::CalcReciprocal(size);
+  const size_t objects_per_span = kPageSize / size;
+
+  void* mem;
+  TC_CHECK_EQ(posix_memalign(&mem, kPageSize, kPageSize), 0);
+  Span span;
+  span.Init(PageIdContaining(mem), Length(1));
+  span.BuildFreelist(size, objects_per_span, nullptr, 0, /*color=*/0,
+                     use_bitmap);
+
+  std::vector<void*> objects(objects_per_span, nullptr);
+  absl::BitGen rng;
+
+  int64_t processed = 0;
+  while (state.KeepRunningBatch(objects_per_span)) {
+    size_t popped = 0;
+    while (popped < objects_per_span) {
+      size_t n = span.FreelistPopBatch(&objects[popped],
+                                       objects_per_span - popped, size);
+      TC_CHECK_GT(n, 0);
+      popped += n;
+    }
+    processed += popped;
+
+    if (shuffled) {
+      std::shuffle(objects.begin(), objects.end(), rng);
+    }
+    for (size_t i = 0; i + 1 < objects_per_span; ++i) {
+      span.FreelistPush(objects[i], size, reciprocal);
+    }
+    // The last push would report the span fully free; rebuild instead so the
+    // next cycle starts from a full freelist in the same representation.
+    span.BuildFreelist(size, objects_per_span, nullptr, 0, /*color=*/0,
+                       use_bitmap);
+  }
+
+  state.SetItemsProcessed(processed);
+  free(mem);
+}
+
+BENCHMARK(BM_freelist_representation)
+    ->ArgNames({"size", "bitmap", "shuffled"})
+    ->Args({kPageSize / 64, 0, 0})
+    ->Args({kPageSize / 64, 1, 0})
+    ->Args({kPageSize / 64, 0, 1})
+    ->Args({kPageSize / 64, 1, 1})
+    ->Args({kPageSize / 16, 0, 0})
+    ->Args({kPageSize / 16, 1, 0})
+    ->Args({kPageSize / 16, 0, 1})
+    ->Args({kPageSize / 16, 1, 1});
+
 void BM_NewDelete(benchmark::State& state) {
   constexpr SpanAllocInfo kSpanInfo = {/*objects_per_span=*/7,
                                        AccessDensityPrediction::kSparse};
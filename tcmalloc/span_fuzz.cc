@@ -57,7 +57,12 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   TC_CHECK_EQ(res, 0);
   Span span;
   span.Init(PageIdContaining(mem), pages);
-  span.BuildFreelist(object_size, objects_per_span, nullptr, 0);
+  // Derive a legal color from the input so colored carving is fuzzed too.
+  const size_t waste = pages.in_bytes() - objects_per_span * object_size;
+  const size_t colors =
+      std::min(Span::kMaxColors, waste / Span::kColorStride + 1);
+  const size_t color = (state[2] % colors) * Span::kColorStride;
+  span.BuildFreelist(object_size, objects_per_span, nullptr, 0, color);
 
   TC_CHECK_EQ(span.Allocated(), 0);
 
@@ -68,7 +73,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     size_t want = std::min(num_to_move, objects_per_span - ptrs.size());
     TC_CHECK_GT(want, 0);
     void* batch[kMaxObjectsToMove];
-    TC_CHECK(!span.FreelistEmpty(object_size));
+    TC_CHECK(!span.FreelistEmpty());
     size_t n = span.FreelistPopBatch(batch, want, object_size);
 
     TC_CHECK_GT(n, 0);
@@ -77,7 +82,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     ptrs.insert(ptrs.end(), batch, batch + n);
   }
 
-  TC_CHECK(span.FreelistEmpty(object_size));
+  TC_CHECK(span.FreelistEmpty());
   TC_CHECK_EQ(ptrs.size(), objects_per_span);
   TC_CHECK_EQ(ptrs.size(), span.Allocated());
 
@@ -88,7 +93,7 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
     // element onto the freelist.
     //
     // For single object spans, the freelist always stays "empty" as a result.
-    TC_CHECK(popped == 1 || !span.FreelistEmpty(object_size));
+    TC_CHECK(popped == 1 || !span.FreelistEmpty());
   }
 
   free(mem);
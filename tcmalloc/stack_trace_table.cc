@@ -16,6 +16,8 @@
 
 #include <stddef.h>
 #include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <cstdint>
 
@@ -33,6 +35,24 @@ GOOGLE_MALLOC_SECTION_BEGIN
 namespace tcmalloc {
 namespace tcmalloc_internal {
 
+namespace {
+
+// Returns the NUMA node currently backing `addr`, determined by calling
+// move_pages(2) in its query mode (a nullptr nodes argument).  Returns -1 if
+// the page is not resident or the kernel has no NUMA support.  Profile
+// collection is already a slow path, so one syscall per sample is fine.
+int BackingNumaNode(void* addr) {
+  if (addr == nullptr) return -1;
+  int status = -1;
+  if (syscall(__NR_move_pages, /*pid=*/0, /*count=*/1, &addr,
+              /*nodes=*/nullptr, &status, /*flags=*/0) != 0) {
+    return -1;
+  }
+  return status >= 0 ? status : -1;
+}
+
+}  // namespace
+
 StackTraceTable::StackTraceTable(ProfileType type)
     : type_(type), depth_total_(0), all_(nullptr) {}
 
@@ -95,6 +115,8 @@ void StackTraceTable::AddTrace(double sample_weight, const StackTrace& t) {
   s->sample.allocation_time = t.allocation_time;
 
   s->sample.span_start_address = t.span_start_address;
+  s->sample.allocating_numa_node = t.allocating_numa_node;
+  s->sample.backing_numa_node = BackingNumaNode(t.span_start_address);
   s->sample.guarded_status =
       static_cast<Profile::Sample::GuardedStatus>(t.guarded_status);
 
@@ -107,6 +129,13 @@ void StackTraceTable::AddTrace(double sample_weight, const StackTrace& t) {
   all_ = s;
 }
 
+void StackTraceTable::AddRemovedTrace(double sample_weight,
+                                      const StackTrace& t) {
+  AddTrace(sample_weight, t);
+  all_->sample.count = -all_->sample.count;
+  all_->sample.sum = -all_->sample.sum;
+}
+
 void StackTraceTable::Iterate(
     absl::FunctionRef<void(const Profile::Sample&)> func) const {
   LinkedSample* cur = all_;
@@ -52,6 +52,12 @@ class StackTraceTable final : public ProfileBase {
   void AddTrace(double sample_weight, const StackTrace& t)
       ABSL_LOCKS_EXCLUDED(pageheap_lock);
 
+  // Adds stack trace "t" of a freed sample to the table, with count and sum
+  // negated so that the entry cancels the matching AddTrace() entry from an
+  // earlier profile.  Used for incremental heap profiles.
+  void AddRemovedTrace(double sample_weight, const StackTrace& t)
+      ABSL_LOCKS_EXCLUDED(pageheap_lock);
+
   // Exposed for PageHeapAllocator
   struct LinkedSample {
     Profile::Sample sample;
@@ -14,17 +14,22 @@
 
 #include "tcmalloc/static_vars.h"
 
+#include <pthread.h>
 #include <stddef.h>
 
 #include <atomic>
 
 #include "absl/base/attributes.h"
+#include "absl/base/call_once.h"
 #include "absl/base/const_init.h"
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/optimization.h"
 #include "absl/types/span.h"
 #include "tcmalloc/allocation_sample.h"
+#include "tcmalloc/allocation_site_sketch.h"
 #include "tcmalloc/arena.h"
+#include "tcmalloc/class_fragmentation.h"
+#include "tcmalloc/class_lifetimes.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/cpu_cache.h"
 #include "tcmalloc/deallocation_profiler.h"
@@ -39,6 +44,7 @@
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/mincore.h"
 #include "tcmalloc/internal/numa.h"
+#include "tcmalloc/internal/page_size.h"
 #include "tcmalloc/internal/percpu.h"
 #include "tcmalloc/internal/sysinfo.h"
 #include "tcmalloc/malloc_extension.h"
@@ -46,11 +52,14 @@
 #include "tcmalloc/page_heap_allocator.h"
 #include "tcmalloc/pagemap.h"
 #include "tcmalloc/peak_heap_tracker.h"
+#include "tcmalloc/pinned_arena.h"
+#include "tcmalloc/runtime_size_classes.h"
 #include "tcmalloc/sampled_allocation_allocator.h"
 #include "tcmalloc/size_class_info.h"
 #include "tcmalloc/sizemap.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/stack_trace_table.h"
+#include "tcmalloc/system-alloc.h"
 #include "tcmalloc/thread_cache.h"
 #include "tcmalloc/transfer_cache.h"
 
@@ -74,24 +83,33 @@ ABSL_CONST_INIT ShardedTransferCacheManager
     Static::sharded_transfer_cache_(nullptr, nullptr);
 ABSL_CONST_INIT CpuCache ABSL_CACHELINE_ALIGNED Static::cpu_cache_;
 ABSL_CONST_INIT SampledAllocationAllocator Static::sampledallocation_allocator_;
-ABSL_CONST_INIT PageHeapAllocator<Span> Static::span_allocator_;
+ABSL_CONST_INIT PageHeapAllocator<Span, kSpanAllocBatch>
+    Static::span_allocator_;
 ABSL_CONST_INIT PageHeapAllocator<ThreadCache> Static::threadcache_allocator_;
 ABSL_CONST_INIT ExplicitlyConstructed<SampledAllocationRecorder>
     Static::sampled_allocation_recorder_;
 ABSL_CONST_INIT tcmalloc_internal::StatsCounter Static::sampled_objects_size_;
 ABSL_CONST_INIT tcmalloc_internal::StatsCounter
     Static::sampled_internal_fragmentation_;
-ABSL_CONST_INIT tcmalloc_internal::StatsCounter Static::total_sampled_count_;
+ABSL_CONST_INIT tcmalloc_internal::ShardedStatsCounter
+    Static::total_sampled_count_;
 ABSL_CONST_INIT AllocationSampleList Static::allocation_samples;
 ABSL_CONST_INIT deallocationz::DeallocationProfilerList
     Static::deallocation_samples;
 ABSL_CONST_INIT std::atomic<AllocHandle> Static::sampled_alloc_handle_generator{
     0};
+ABSL_CONST_INIT std::atomic<AllocHandle>
+    Static::sampled_recycled_death_generation{0};
 ABSL_CONST_INIT PeakHeapTracker Static::peak_heap_tracker_;
+ABSL_CONST_INIT AllocationSiteSketch Static::allocation_site_sketch_;
+ABSL_CONST_INIT ClassFragmentationTracker Static::class_fragmentation_;
+ABSL_CONST_INIT ClassLifetimeTracker Static::class_lifetimes_;
+ABSL_CONST_INIT PinnedArena Static::pinned_arena_;
 ABSL_CONST_INIT PageHeapAllocator<StackTraceTable::LinkedSample>
     Static::linked_sample_allocator_;
 ABSL_CONST_INIT std::atomic<bool> Static::inited_{false};
 ABSL_CONST_INIT std::atomic<bool> Static::cpu_cache_active_{false};
+ABSL_CONST_INIT std::atomic<bool> Static::fork_support_enabled_{false};
 ABSL_CONST_INIT Static::PageAllocatorStorage Static::page_allocator_;
 ABSL_CONST_INIT PageMap Static::pagemap_;
 ABSL_CONST_INIT GuardedPageAllocator Static::guardedpage_allocator_;
@@ -120,7 +138,11 @@ size_t Static::metadata_bytes() {
       sizeof(pagemap_) + sizeof(sampled_objects_size_) +
       sizeof(sampled_internal_fragmentation_) + sizeof(total_sampled_count_) +
       sizeof(allocation_samples) + sizeof(deallocation_samples) +
-      sizeof(sampled_alloc_handle_generator) + sizeof(peak_heap_tracker_) +
+      sizeof(sampled_alloc_handle_generator) +
+      sizeof(sampled_recycled_death_generation) + sizeof(peak_heap_tracker_) +
+      sizeof(allocation_site_sketch_) + sizeof(class_fragmentation_) +
+      sizeof(class_lifetimes_) +
+      sizeof(pinned_arena_) +
       sizeof(guardedpage_allocator_) + sizeof(numa_topology_) +
       sizeof(CacheTopology::Instance());
   // LINT.ThenChange(:static_vars)
@@ -153,16 +175,92 @@ SizeClassConfiguration Static::size_class_configuration() {
   }
 }
 
+// The pre-fork handler acquires every internal allocator lock, in an order
+// consistent with the allocator's own nesting (cache locks before
+// pageheap_lock, pageheap_lock before the system allocator's lock), so that
+// fork() snapshots the heap in a consistent state.  The post-fork handler
+// releases them in both the parent and the child; the child's slab and cache
+// memory is inherited copy-on-write and remains valid as is.
+static void TCMallocPreFork() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  if (!Static::ForkSupportEnabled()) return;
+  Static::InitIfNecessary();
+  if (Static::CpuCacheActive()) {
+    tc_globals.cpu_cache().AcquireInternalLocks();
+  }
+  tc_globals.transfer_cache().AcquireInternalLocks();
+  tc_globals.sharded_transfer_cache().AcquireInternalLocks();
+  tc_globals.guardedpage_allocator().AcquireInternalLocks();
+  pageheap_lock.Lock();
+  AcquireSystemAllocLock();
+}
+
+static void TCMallocPostFork() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  if (!Static::ForkSupportEnabled()) return;
+  ReleaseSystemAllocLock();
+  pageheap_lock.Unlock();
+  tc_globals.guardedpage_allocator().ReleaseInternalLocks();
+  tc_globals.sharded_transfer_cache().ReleaseInternalLocks();
+  tc_globals.transfer_cache().ReleaseInternalLocks();
+  if (Static::CpuCacheActive()) {
+    tc_globals.cpu_cache().ReleaseInternalLocks();
+  }
+}
+
+void Static::EnableForkSupport() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    pthread_atfork(TCMallocPreFork, TCMallocPostFork, TCMallocPostFork);
+    fork_support_enabled_.store(true, std::memory_order_relaxed);
+  });
+}
+
 ABSL_ATTRIBUTE_COLD ABSL_ATTRIBUTE_NOINLINE void Static::SlowInitIfNecessary() {
   PageHeapSpinLockHolder l;
 
   // double-checked locking
   if (!inited_.load(std::memory_order_acquire)) {
-    TC_CHECK(sizemap_.Init(SizeMap::CurrentClasses().classes));
+    // A size-class table supplied at runtime takes precedence over the
+    // compiled-in tables, so per-workload tables can be deployed without a
+    // rebuild.  It must pass the same validation in SizeMap::Init; if it does
+    // not, fall back to the compiled tables rather than crash.
+    bool sizemap_inited = false;
+    SizeClassInfo runtime_classes[kNumBaseClasses];
+    const int num_runtime_classes =
+        MaybeSizeClassesFromEnv(kNumBaseClasses, runtime_classes);
+    if (num_runtime_classes > 0) {
+      sizemap_inited =
+          sizemap_.Init(absl::MakeSpan(runtime_classes, num_runtime_classes));
+      if (!sizemap_inited) {
+        Log(kLog, __FILE__, __LINE__,
+            "runtime size classes failed validation; using compiled tables");
+      }
+    }
+    if (!sizemap_inited) {
+      TC_CHECK(sizemap_.Init(SizeMap::CurrentClasses().classes));
+    }
+    // The tables never change after Init (span coloring is configured inside
+    // it); seal them read-only so a wild store faults here instead of
+    // silently misclassifying every later allocation.
+    (void)sizemap_.Seal();
     // Verify we can determine the number of CPUs now, since we will need it
     // later for per-CPU caches and initializing the cache topology.
     (void)NumCPUs();
     (void)subtle::percpu::IsFast();
+    // One artifact may run on hosts with different kernel page sizes (4K x86
+    // alongside 16K/64K ARM).  The allocator's geometry (kPageShift,
+    // kHugePageSize) is compile-time, and release paths clamp madvise calls
+    // to kernel page granularity, so a larger kernel page is safe -- but a
+    // TCMalloc page smaller than the kernel's makes single-page release
+    // inert and memory only returns in larger runs.  Surface the mismatch
+    // once at startup instead of leaving it to show up as unexplained RSS;
+    // the large-page build variants exist for exactly these hosts.
+    if (ABSL_PREDICT_FALSE(static_cast<size_t>(GetPageSize()) > kPageSize)) {
+      Log(kLog, __FILE__, __LINE__,
+          "kernel page size exceeds TCMalloc page size; page release is "
+          "limited to kernel-page-sized runs.  Consider a build with larger "
+          "TCMalloc pages (kernel page size, TCMalloc page size)",
+          GetPageSize(), kPageSize);
+    }
     numa_topology_.Init();
     CacheTopology::Instance().Init();
     sampledallocation_allocator_.Init(&arena_);
@@ -27,8 +27,12 @@
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "tcmalloc/allocation_sample.h"
+#include "tcmalloc/allocation_site_sketch.h"
+#include "tcmalloc/allocation_trace.h"
 #include "tcmalloc/arena.h"
 #include "tcmalloc/central_freelist.h"
+#include "tcmalloc/class_fragmentation.h"
+#include "tcmalloc/class_lifetimes.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/deallocation_profiler.h"
 #include "tcmalloc/guarded_page_allocator.h"
@@ -44,6 +48,7 @@
 #include "tcmalloc/page_heap_allocator.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/peak_heap_tracker.h"
+#include "tcmalloc/pinned_arena.h"
 #include "tcmalloc/sampled_allocation_allocator.h"
 #include "tcmalloc/sizemap.h"
 #include "tcmalloc/span.h"
@@ -62,6 +67,12 @@ using SampledAllocationRecorder =
     ::tcmalloc::tcmalloc_internal::SampleRecorder<SampledAllocation,
                                                   SampledAllocationAllocator>;
 
+// Number of Span structs carved from the arena at a time.  The central
+// freelists allocate spans for one size class in bursts when they populate,
+// so handing out contiguous batches keeps their span scans walking packed
+// memory instead of structs scattered between other metadata allocations.
+inline constexpr size_t kSpanAllocBatch = 32;
+
 enum class SizeClassConfiguration {
   kPow2Below64 = 1,
   kPow2Only = 2,
@@ -98,6 +109,18 @@ class Static final {
 
   static PeakHeapTracker& peak_heap_tracker() { return peak_heap_tracker_; }
 
+  static AllocationSiteSketch& allocation_site_sketch() {
+    return allocation_site_sketch_;
+  }
+
+  static ClassFragmentationTracker& class_fragmentation() {
+    return class_fragmentation_;
+  }
+
+  static ClassLifetimeTracker& class_lifetimes() { return class_lifetimes_; }
+
+  static PinnedArena& pinned_arena() { return pinned_arena_; }
+
   static NumaTopology<kNumaPartitions, kNumBaseClasses>& numa_topology() {
     return numa_topology_;
   }
@@ -123,7 +146,9 @@ class Static final {
     return sampledallocation_allocator_;
   }
 
-  static PageHeapAllocator<Span>& span_allocator() { return span_allocator_; }
+  static PageHeapAllocator<Span, kSpanAllocBatch>& span_allocator() {
+    return span_allocator_;
+  }
 
   static PageHeapAllocator<ThreadCache>& threadcache_allocator() {
     return threadcache_allocator_;
@@ -142,7 +167,10 @@ class Static final {
       sampled_internal_fragmentation_;
   // total_sampled_count_ tracks the total number of allocations that are
   // sampled.
-  ABSL_CONST_INIT static tcmalloc_internal::StatsCounter total_sampled_count_;
+  // Sharded: it is bumped on every sampled allocation from whichever CPU
+  // allocates, and only folded when stats are reported.
+  ABSL_CONST_INIT static tcmalloc_internal::ShardedStatsCounter
+      total_sampled_count_;
 
   ABSL_CONST_INIT static AllocationSampleList allocation_samples;
 
@@ -154,6 +182,12 @@ class Static final {
   ABSL_CONST_INIT static std::atomic<AllocHandle>
       sampled_alloc_handle_generator;
 
+  // Largest death generation whose record has been recycled for a new sampled
+  // allocation.  Incremental heap profiles against generations older than
+  // this can no longer be completed; see DumpHeapProfileSince().
+  ABSL_CONST_INIT static std::atomic<AllocHandle>
+      sampled_recycled_death_generation;
+
   static PageHeapAllocator<StackTraceTable::LinkedSample>&
   linked_sample_allocator() {
     return linked_sample_allocator_;
@@ -167,7 +201,19 @@ class Static final {
   }
 
   static bool ABSL_ATTRIBUTE_ALWAYS_INLINE HaveHooks() {
-    return false;
+    // Allocation tracing rides the hook mechanism: while a trace session is
+    // active, fast paths are disabled so every event funnels through the
+    // hook-invoking slow paths.
+    return AllocationTraceEnabled();
+  }
+
+  // Installs pthread_atfork handlers that quiesce the allocator's internal
+  // locks around fork(), so a child forked while another thread allocates
+  // does not inherit a held lock and deadlock on its first heap operation.
+  // Safe to call multiple times; the handlers are registered once.
+  static void EnableForkSupport();
+  static bool ForkSupportEnabled() {
+    return fork_support_enabled_.load(std::memory_order_relaxed);
   }
 
   static size_t metadata_bytes() ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
@@ -198,13 +244,18 @@ class Static final {
   static CpuCache cpu_cache_;
   ABSL_CONST_INIT static GuardedPageAllocator guardedpage_allocator_;
   static SampledAllocationAllocator sampledallocation_allocator_;
-  static PageHeapAllocator<Span> span_allocator_;
+  static PageHeapAllocator<Span, kSpanAllocBatch> span_allocator_;
   static PageHeapAllocator<ThreadCache> threadcache_allocator_;
   static PageHeapAllocator<StackTraceTable::LinkedSample>
       linked_sample_allocator_;
   ABSL_CONST_INIT static std::atomic<bool> inited_;
   ABSL_CONST_INIT static std::atomic<bool> cpu_cache_active_;
+  ABSL_CONST_INIT static std::atomic<bool> fork_support_enabled_;
   ABSL_CONST_INIT static PeakHeapTracker peak_heap_tracker_;
+  ABSL_CONST_INIT static AllocationSiteSketch allocation_site_sketch_;
+  ABSL_CONST_INIT static ClassFragmentationTracker class_fragmentation_;
+  ABSL_CONST_INIT static ClassLifetimeTracker class_lifetimes_;
+  ABSL_CONST_INIT static PinnedArena pinned_arena_;
   ABSL_CONST_INIT static NumaTopology<kNumaPartitions, kNumBaseClasses>
       numa_topology_;
 
@@ -16,6 +16,7 @@
 
 #include <asm/unistd.h>
 #include <errno.h>
+#include <sched.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/mman.h>
@@ -26,6 +27,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <cstdlib>
 #include <cstring>
 #include <limits>
 #include <optional>
@@ -38,18 +40,24 @@
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/debugging/stacktrace.h"
 #include "absl/numeric/bits.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/environment.h"
 #include "tcmalloc/internal/exponential_biased.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/numa.h"
 #include "tcmalloc/internal/optimization.h"
 #include "tcmalloc/internal/page_size.h"
+#include "tcmalloc/internal/residency.h"
+#include "tcmalloc/internal/sysinfo.h"
+#include "tcmalloc/internal/util.h"
 #include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
@@ -84,6 +92,11 @@ extern "C" int madvise(caddr_t, size_t, int);
 
 #ifdef __linux__
 #include <linux/mempolicy.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define TCMALLOC_INTERNAL_HAVE_IO_URING 1
+#endif
 #endif
 
 GOOGLE_MALLOC_SECTION_BEGIN
@@ -166,7 +179,8 @@ ABSL_CONST_INIT std::aligned_storage<sizeof(MmapRegionFactory),
 
 class RegionManager {
  public:
-  std::pair<void*, size_t> Alloc(size_t size, size_t alignment, MemoryTag tag)
+  std::pair<void*, size_t> Alloc(size_t size, size_t alignment, MemoryTag tag,
+                                 absl::string_view owner)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock);
 
   void DiscardMappedRegions() ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock) {
@@ -181,7 +195,7 @@ class RegionManager {
   // for the next allocation, if not allocate a new region.
   // Then returns a pointer to the new memory.
   std::pair<void*, size_t> Allocate(size_t size, size_t alignment,
-                                    MemoryTag tag)
+                                    MemoryTag tag, absl::string_view owner)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock);
 
   std::array<AddressRegion*, kNumaPartitions> normal_region_{{nullptr}};
@@ -290,7 +304,8 @@ static AddressRegionFactory::UsageHint TagToHint(MemoryTag tag) {
 
 std::pair<void*, size_t> RegionManager::Alloc(size_t request_size,
                                               size_t alignment,
-                                              const MemoryTag tag) {
+                                              const MemoryTag tag,
+                                              const absl::string_view owner) {
   constexpr uintptr_t kTagFree = uintptr_t{1} << kTagShift;
 
   // We do not support size or alignment larger than kTagFree.
@@ -306,7 +321,7 @@ std::pair<void*, size_t> RegionManager::Alloc(size_t request_size,
     size_t size = RoundUp(request_size, kMinSystemAlloc);
     if (size < request_size) return {nullptr, 0};
     alignment = std::max(alignment, preferred_alignment);
-    void* ptr = MmapAligned(size, alignment, tag);
+    void* ptr = MmapAligned(size, alignment, tag, owner);
     if (!ptr) return {nullptr, 0};
 
     const auto region_type = TagToHint(tag);
@@ -324,11 +339,12 @@ std::pair<void*, size_t> RegionManager::Alloc(size_t request_size,
     }
     return result;
   }
-  return Allocate(request_size, alignment, tag);
+  return Allocate(request_size, alignment, tag, owner);
 }
 
 std::pair<void*, size_t> RegionManager::Allocate(size_t size, size_t alignment,
-                                                 const MemoryTag tag) {
+                                                 const MemoryTag tag,
+                                                 const absl::string_view owner) {
   AddressRegion*& region = *[&]() {
     switch (tag) {
       case MemoryTag::kNormal:
@@ -355,7 +371,7 @@ std::pair<void*, size_t> RegionManager::Allocate(size_t size, size_t alignment,
 
   // Allocation failed so we need to reserve more memory.
   // Reserve new region and try allocation again.
-  void* ptr = MmapAligned(kMinMmapAlloc, kMinMmapAlloc, tag);
+  void* ptr = MmapAligned(kMinMmapAlloc, kMinMmapAlloc, tag, owner);
   if (!ptr) return {nullptr, 0};
 
   const auto region_type = TagToHint(tag);
@@ -414,6 +430,282 @@ void BindMemory(void* const base, const size_t size, const size_t partition) {
 
 ABSL_CONST_INIT std::atomic<int> system_release_errors(0);
 
+#ifdef MADV_FREE
+// State for lazy (MADV_FREE-only) release.  Lazily released pages stay
+// resident until the kernel needs the memory, so we remember a few recent
+// ranges and probe them from SystemCheckLazyRelease(): if the kernel is
+// reclaiming them aggressively, laziness only delays the zero-fill fault
+// while inflating RSS, and we fall back to MADV_DONTNEED.
+//
+// Slot updates are not synchronized with the prober; a torn entry only skews
+// one probe sample of what is already a heuristic.
+struct LazyReleaseRange {
+  std::atomic<uintptr_t> ptr;
+  std::atomic<size_t> length;
+};
+constexpr int kLazyReleaseRanges = 16;
+// Do not fall back until the probe has covered at least this much memory.
+constexpr size_t kLazyReleaseMinSampleBytes = 1 << 20;
+ABSL_CONST_INIT LazyReleaseRange lazy_release_ranges[kLazyReleaseRanges] = {};
+ABSL_CONST_INIT std::atomic<size_t> lazy_release_next_range(0);
+ABSL_CONST_INIT std::atomic<size_t> lazy_release_bytes(0);
+ABSL_CONST_INIT std::atomic<size_t> lazy_release_sampled_bytes(0);
+ABSL_CONST_INIT std::atomic<size_t> lazy_release_resident_bytes(0);
+ABSL_CONST_INIT std::atomic<bool> lazy_release_fallback(false);
+#endif  // MADV_FREE
+
+// Reservations made for cold-tagged memory, recorded so the background
+// thread can periodically deactivate them with MADV_COLD.  We record whole
+// mmap() reservations rather than individual allocations, so the ring stays
+// small; an entry that falls off the ring simply stops being advised.
+//
+// Slot updates are not synchronized with the advisor; madvise() on a torn or
+// stale entry fails harmlessly and is ignored.
+struct ColdRegionRange {
+  std::atomic<uintptr_t> ptr;
+  std::atomic<size_t> length;
+};
+constexpr int kColdRegionRanges = 64;
+ABSL_CONST_INIT ColdRegionRange cold_region_ranges[kColdRegionRanges] = {};
+ABSL_CONST_INIT std::atomic<size_t> cold_region_next_range(0);
+
+void RecordColdRegion(void* ptr, size_t length) {
+  const size_t i =
+      cold_region_next_range.fetch_add(1, std::memory_order_relaxed) %
+      kColdRegionRanges;
+  cold_region_ranges[i].ptr.store(reinterpret_cast<uintptr_t>(ptr),
+                                  std::memory_order_relaxed);
+  cold_region_ranges[i].length.store(length, std::memory_order_relaxed);
+}
+
+// Reservations made for normal-tagged memory, recorded so the background
+// thread can re-home their resident pages after the process's cpuset moves
+// to another socket.  As with cold regions above, we record whole mmap()
+// reservations so the ring stays small; an entry that falls off the ring
+// simply stops being repaired.
+struct NormalRegionRange {
+  std::atomic<uintptr_t> ptr;
+  std::atomic<size_t> length;
+};
+constexpr int kNormalRegionRanges = 64;
+ABSL_CONST_INIT NormalRegionRange normal_region_ranges[kNormalRegionRanges] =
+    {};
+ABSL_CONST_INIT std::atomic<size_t> normal_region_next_range(0);
+
+void RecordNormalRegion(void* ptr, size_t length) {
+  const size_t i =
+      normal_region_next_range.fetch_add(1, std::memory_order_relaxed) %
+      kNormalRegionRanges;
+  normal_region_ranges[i].ptr.store(reinterpret_cast<uintptr_t>(ptr),
+                                    std::memory_order_relaxed);
+  normal_region_ranges[i].length.store(length, std::memory_order_relaxed);
+}
+
+// Progress counters for the NUMA re-home pass; see SystemRehomeNumaRegions.
+ABSL_CONST_INIT std::atomic<size_t> numa_rehome_pages_sampled(0);
+ABSL_CONST_INIT std::atomic<size_t> numa_rehome_pages_misplaced(0);
+ABSL_CONST_INIT std::atomic<size_t> numa_rehome_pages_moved(0);
+ABSL_CONST_INIT std::atomic<size_t> numa_rehome_failures(0);
+
+#ifdef TCMALLOC_INTERNAL_HAVE_IO_URING
+// Returns the page-aligned subrange of [start, start + length): the start
+// rounded up and the end rounded down to page boundaries.  bytes is 0 if the
+// range does not cover a whole page.
+AddressRange PageAlignedSubrange(void* start, size_t length) {
+  const size_t pagemask = GetPageSize() - 1;
+  const size_t new_start =
+      (reinterpret_cast<size_t>(start) + pagemask) & ~pagemask;
+  const size_t new_end = (reinterpret_cast<size_t>(start) + length) & ~pagemask;
+  if (new_end <= new_start) {
+    return {nullptr, 0};
+  }
+  return {reinterpret_cast<void*>(new_start), new_end - new_start};
+}
+
+// Batched madvise submission queue built on io_uring (see
+// SystemReleaseRanges).  The ring is created lazily on first use; if
+// io_uring_setup() fails (old kernel, seccomp filter) or the kernel rejects
+// IORING_OP_MADVISE, the ring marks itself unusable and callers stay on the
+// synchronous path.
+//
+// Guarded by madvise_ring_lock: release batches are infrequent enough that
+// serializing them is cheaper than per-thread rings.
+ABSL_CONST_INIT absl::base_internal::SpinLock madvise_ring_lock(
+    absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY);
+
+class MadviseRing {
+ public:
+  // Submission queue depth, and the batch size of SystemReleaseRanges.
+  static constexpr unsigned kDepth = 64;
+
+  constexpr MadviseRing() = default;
+
+  // Creates the ring.  Returns false if io_uring is unavailable.
+  bool Init();
+
+  // Issues madvise(advice) for the first n ranges, waits for every
+  // completion, and records per-range success in ok.  Returns the number of
+  // ranges that succeeded.
+  //
+  // REQUIRES: n <= kDepth.
+  size_t MadviseBatch(const AddressRange* ranges, size_t n, int advice,
+                      bool* ok);
+
+  // False once a batch failed to submit completely.  The unsubmitted SQEs
+  // stay pending in the submission queue, and a later io_uring_enter() would
+  // apply their stale MADV_DONTNEEDs to ranges the page heap may have
+  // reallocated; the ring must never be touched again.
+  bool usable() const { return !broken_; }
+
+ private:
+  std::atomic<unsigned>* RingField(void* ring, size_t offset) {
+    return reinterpret_cast<std::atomic<unsigned>*>(static_cast<char*>(ring) +
+                                                    offset);
+  }
+
+  int fd_ = -1;
+  std::atomic<unsigned>* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  struct io_uring_sqe* sqes_ = nullptr;
+  std::atomic<unsigned>* cq_head_ = nullptr;
+  std::atomic<unsigned>* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+  bool broken_ = false;
+};
+
+ABSL_CONST_INIT MadviseRing madvise_ring ABSL_GUARDED_BY(madvise_ring_lock);
+// 0: not yet initialized, 1: usable, -1: unusable.
+ABSL_CONST_INIT int madvise_ring_state ABSL_GUARDED_BY(madvise_ring_lock) = 0;
+// True once any batch has completed successfully, i.e. the kernel is known
+// to support IORING_OP_MADVISE.
+ABSL_CONST_INIT bool madvise_ring_proven ABSL_GUARDED_BY(madvise_ring_lock) =
+    false;
+
+bool MadviseRing::Init() {
+  struct io_uring_params params = {};
+  fd_ = syscall(__NR_io_uring_setup, kDepth, &params);
+  if (fd_ < 0) {
+    fd_ = -1;
+    return false;
+  }
+
+  size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_bytes =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  void* sq_ring;
+  void* cq_ring;
+#ifdef IORING_FEAT_SINGLE_MMAP
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_bytes = cq_bytes = std::max(sq_bytes, cq_bytes);
+    sq_ring = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    cq_ring = sq_ring;
+  } else  // NOLINT(readability/braces)
+#endif
+  {
+    sq_ring = mmap(nullptr, sq_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    cq_ring = mmap(nullptr, cq_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+  }
+  void* sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe),
+                    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                    IORING_OFF_SQES);
+  if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+    // Leak whatever did map: this is a once-per-process failure path and the
+    // ring is never retried.
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  sq_tail_ = RingField(sq_ring, params.sq_off.tail);
+  sq_mask_ =
+      RingField(sq_ring, params.sq_off.ring_mask)->load(std::memory_order_relaxed);
+  sq_array_ = reinterpret_cast<unsigned*>(static_cast<char*>(sq_ring) +
+                                          params.sq_off.array);
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+  cq_head_ = RingField(cq_ring, params.cq_off.head);
+  cq_tail_ = RingField(cq_ring, params.cq_off.tail);
+  cq_mask_ =
+      RingField(cq_ring, params.cq_off.ring_mask)->load(std::memory_order_relaxed);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(static_cast<char*>(cq_ring) +
+                                                 params.cq_off.cqes);
+  return true;
+}
+
+size_t MadviseRing::MadviseBatch(const AddressRange* ranges, size_t n,
+                                 int advice, bool* ok) {
+  TC_ASSERT_LE(n, kDepth);
+  for (size_t i = 0; i < n; ++i) {
+    ok[i] = false;
+  }
+
+  const unsigned tail = sq_tail_->load(std::memory_order_relaxed);
+  for (size_t i = 0; i < n; ++i) {
+    struct io_uring_sqe* sqe = &sqes_[(tail + i) & sq_mask_];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_MADVISE;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uintptr_t>(ranges[i].ptr);
+    sqe->len = ranges[i].bytes;
+    sqe->fadvise_advice = advice;
+    sqe->user_data = i;
+    sq_array_[(tail + i) & sq_mask_] = (tail + i) & sq_mask_;
+  }
+  // Publish the new tail; the kernel reads it with acquire semantics.
+  sq_tail_->store(tail + n, std::memory_order_release);
+
+  // Submit.  io_uring_enter() returns the number of SQEs consumed.
+  size_t submitted = 0;
+  while (submitted < n) {
+    int ret =
+        syscall(__NR_io_uring_enter, fd_, n - submitted, 0, 0, nullptr, 0);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (ret == 0) break;
+    submitted += ret;
+  }
+  if (submitted < n) {
+    // The tail was already published, so the unconsumed SQEs stay pending
+    // and the next enter would madvise ranges whose failure the caller has
+    // meanwhile handled synchronously.  Latch the ring broken; the caller
+    // disables it for good.
+    broken_ = true;
+  }
+
+  // Wait for and reap every completion of what we submitted: the caller may
+  // reuse the ranges as soon as the batch returns, and a straggling
+  // MADV_DONTNEED completing after reuse would zero live data.
+  size_t successes = 0;
+  size_t completed = 0;
+  unsigned head = cq_head_->load(std::memory_order_relaxed);
+  while (completed < submitted) {
+    if (head == cq_tail_->load(std::memory_order_acquire)) {
+      int ret = syscall(__NR_io_uring_enter, fd_, 0, submitted - completed,
+                        IORING_ENTER_GETEVENTS, nullptr, 0);
+      // Only EINTR can occur on a valid idle ring; anything else would leave
+      // operations in flight, so keep waiting regardless.
+      (void)ret;
+      continue;
+    }
+    const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    ++head;
+    ++completed;
+    cq_head_->store(head, std::memory_order_release);
+    if (cqe.user_data < n && cqe.res == 0) {
+      ok[cqe.user_data] = true;
+      ++successes;
+    }
+  }
+  return successes;
+}
+#endif  // TCMALLOC_INTERNAL_HAVE_IO_URING
+
 int MapFixedNoReplaceFlagAvailable() {
   ABSL_CONST_INIT static int noreplace_flag;
   ABSL_CONST_INIT static absl::once_flag flag;
@@ -445,7 +737,470 @@ int MapFixedNoReplaceFlagAvailable() {
 
 }  // namespace
 
-AddressRange SystemAlloc(size_t bytes, size_t alignment, const MemoryTag tag) {
+static uintptr_t RandomMmapHint(size_t size, size_t alignment,
+                                const MemoryTag tag);
+
+#ifdef MAP_HUGETLB
+namespace {
+
+// Defined below, with the rest of the per-tag VA accounting.
+void TagVaAccount(MemoryTag tag, size_t size);
+
+// Optional explicit-hugetlbfs pool for huge allocations.
+//
+// THP backing for large ranges is best effort: a fresh mapping starts on
+// 4KiB pages and stays there until khugepaged collapses it, which can take
+// seconds on a loaded machine.  When TCMALLOC_HUGETLB_POOL_PAGES=N is set,
+// we reserve N explicit hugepages with MAP_HUGETLB on first use and carve
+// huge requests from that reservation, so they are 2MiB-backed from the
+// first touch.  mmap() without MAP_NORESERVE charges the kernel's hugepage
+// pool up front, so an undersized vm.nr_hugepages shows up as a failed
+// reservation here rather than a SIGBUS on first touch.  Requests that do
+// not fit the remaining reservation fall back to the normal path.
+//
+// The reservation is carved with a bump pointer and never reused at this
+// level; the page allocator above holds onto and reuses the ranges it is
+// handed, just as it does for MmapRegion carvings.  SystemRelease on pool
+// memory ends up in MADV_DONTNEED, which returns hugepages to the kernel
+// pool while keeping the reservation mapped.
+ABSL_CONST_INIT uintptr_t hugetlb_pool_next ABSL_GUARDED_BY(spinlock) = 0;
+ABSL_CONST_INIT size_t hugetlb_pool_free ABSL_GUARDED_BY(spinlock) = 0;
+ABSL_CONST_INIT bool hugetlb_pool_initialized ABSL_GUARDED_BY(spinlock) =
+    false;
+
+// Requests below this size gain little from guaranteed backing and would
+// fragment the fixed reservation, so they stay on the normal path.
+constexpr size_t kHugetlbPoolMinRequest = 32 * 1024 * 1024;
+
+size_t HugetlbPoolConfiguredBytes() {
+  const char* e = thread_safe_getenv("TCMALLOC_HUGETLB_POOL_PAGES");
+  if (e == nullptr) return 0;
+  char* end;
+  const long pages = strtol(e, &end, 10);  // NOLINT(runtime/int)
+  if (end == e || *end != '\0' || pages < 0) {
+    Crash(kCrash, __FILE__, __LINE__, "bad TCMALLOC_HUGETLB_POOL_PAGES", e);
+  }
+  return static_cast<size_t>(pages) * kHugePageSize;
+}
+
+void InitHugetlbPoolIfNecessary() ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock) {
+  if (hugetlb_pool_initialized) return;
+  hugetlb_pool_initialized = true;
+  const size_t bytes = HugetlbPoolConfiguredBytes();
+  if (bytes == 0) return;
+  // Place the reservation in the kNormal window so pool-served allocations
+  // carry the tag SystemAlloc promises; RandomMmapHint() over-aligns the
+  // hint so the whole reservation shares one tag.
+  const int map_fixed_noreplace_flag = MapFixedNoReplaceFlagAvailable();
+  for (int i = 0; i < 16; ++i) {
+    void* hint = reinterpret_cast<void*>(
+        RandomMmapHint(bytes, kHugePageSize, MemoryTag::kNormal));
+    void* result =
+        mmap(hint, bytes, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                 map_fixed_noreplace_flag,
+             -1, 0);
+    if (result == hint) {
+      hugetlb_pool_next = reinterpret_cast<uintptr_t>(result);
+      hugetlb_pool_free = bytes;
+      // The operator asked for the pool explicitly, so it is accounted
+      // against -- but not refused by -- the normal tag's VA budget.
+      TagVaAccount(MemoryTag::kNormal, bytes);
+      return;
+    }
+    if (result != MAP_FAILED) {
+      munmap(result, bytes);
+      continue;
+    }
+    if (errno != EEXIST) {
+      // Most likely the kernel's hugepage pool cannot cover the request;
+      // run without the pool rather than retry at a smaller size the
+      // operator did not ask for.
+      Log(kLog, __FILE__, __LINE__,
+          "MAP_HUGETLB pool reservation failed; check vm.nr_hugepages "
+          "(bytes, errno)",
+          bytes, errno);
+      return;
+    }
+  }
+  Log(kLogWithStack, __FILE__, __LINE__,
+      "MAP_HUGETLB pool placement failed (bytes)", bytes);
+}
+
+AddressRange HugetlbPoolAlloc(size_t bytes, size_t alignment, MemoryTag tag)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock) {
+  if (tag != MemoryTag::kNormal || bytes < kHugetlbPoolMinRequest ||
+      alignment > kHugePageSize) {
+    return {nullptr, 0};
+  }
+  InitHugetlbPoolIfNecessary();
+  const size_t size = RoundUp(bytes, kHugePageSize);
+  if (size < bytes || size > hugetlb_pool_free) return {nullptr, 0};
+  void* result = reinterpret_cast<void*>(hugetlb_pool_next);
+  hugetlb_pool_next += size;
+  hugetlb_pool_free -= size;
+  return {result, size};
+}
+
+}  // namespace
+#endif  // MAP_HUGETLB
+
+namespace {
+
+// Pre-reserved, commit-on-demand VA pool for metadata allocations.
+//
+// Metadata grows in small increments (Arena asks for 128KiB blocks, the
+// pagemap and huge-page trackers somewhat more), and each increment that
+// reaches mmap()/mprotect() is a mapping transition: a new VMA and a TLB
+// shootdown across every thread in the process.  Instead of paying that per
+// increment, we reserve one kMetadataPoolBytes window of address space up
+// front (PROT_NONE, so it costs nothing but VA) and carve metadata requests
+// from it with a bump pointer, extending the read-write prefix in
+// kMetadataCommitStep jumps.  The committed prefix always grows from the
+// base, so the kernel merges it into a single VMA and the whole pool is at
+// most two mappings regardless of how many allocations it has served.
+//
+// Requests the pool cannot take (outsized alignment, or a pool that has
+// filled up) fall through to the regular region path; nothing above this
+// level can tell the difference.
+ABSL_CONST_INIT uintptr_t metadata_pool_base ABSL_GUARDED_BY(spinlock) = 0;
+ABSL_CONST_INIT uintptr_t metadata_pool_next ABSL_GUARDED_BY(spinlock) = 0;
+ABSL_CONST_INIT uintptr_t metadata_pool_committed ABSL_GUARDED_BY(spinlock) =
+    0;
+ABSL_CONST_INIT uintptr_t metadata_pool_end ABSL_GUARDED_BY(spinlock) = 0;
+ABSL_CONST_INIT bool metadata_pool_failed ABSL_GUARDED_BY(spinlock) = false;
+
+// VA reservation only; resident memory is bounded by what is committed and
+// touched, exactly as with per-increment mappings.
+constexpr size_t kMetadataPoolBytes = kMinMmapAlloc;
+constexpr size_t kMetadataCommitStep = 8 << 20;
+
+AddressRange MetadataPoolAlloc(size_t bytes, size_t alignment)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock) {
+  if (alignment > kMetadataCommitStep) return {nullptr, 0};
+  // A replacement region factory expects to observe every reservation, so
+  // only short-circuit it with the pool when the default factory is in use.
+  if (region_factory !=
+      reinterpret_cast<AddressRegionFactory*>(&mmap_space)) {
+    return {nullptr, 0};
+  }
+  if (metadata_pool_base == 0) {
+    if (metadata_pool_failed) return {nullptr, 0};
+    void* ptr = MmapAligned(kMetadataPoolBytes, kMinSystemAlloc,
+                            MemoryTag::kMetadata, "metadata_pool");
+    if (ptr == nullptr) {
+      metadata_pool_failed = true;
+      return {nullptr, 0};
+    }
+    metadata_pool_base = reinterpret_cast<uintptr_t>(ptr);
+    metadata_pool_next = metadata_pool_base;
+    metadata_pool_committed = metadata_pool_base;
+    metadata_pool_end = metadata_pool_base + kMetadataPoolBytes;
+  }
+  const uintptr_t result = RoundUp(metadata_pool_next, alignment);
+  const size_t size = RoundUp(bytes, GetPageSize());
+  if (size < bytes || result + size < result ||
+      result + size > metadata_pool_end) {
+    return {nullptr, 0};
+  }
+  if (result + size > metadata_pool_committed) {
+    const uintptr_t new_committed =
+        std::min(metadata_pool_end,
+                 metadata_pool_base +
+                     RoundUp(result + size - metadata_pool_base,
+                             kMetadataCommitStep));
+    void* commit_ptr = reinterpret_cast<void*>(metadata_pool_committed);
+    const size_t commit_size = new_committed - metadata_pool_committed;
+    if (mprotect(commit_ptr, commit_size, PROT_READ | PROT_WRITE) != 0) {
+      Log(kLogWithStack, __FILE__, __LINE__,
+          "mprotect() metadata pool failed (ptr, size, error)", commit_ptr,
+          commit_size, strerror(errno));
+      return {nullptr, 0};
+    }
+    // Metadata is touched sparsely; as in MmapRegion::Alloc, keep access
+    // telemetry at 4kiB granularity.  Advisory, so ignore errors.
+    {
+      ErrnoRestorer errno_restorer;
+      (void)madvise(commit_ptr, commit_size, MADV_NOHUGEPAGE);
+    }
+    metadata_pool_committed = new_committed;
+  }
+  metadata_pool_next = result + size;
+  return {reinterpret_cast<void*>(result), size};
+}
+
+// Mapping-growth ledger: a fixed ring of the most recent ranges SystemAlloc
+// handed out, so "what mapped the last N regions" is answerable at incident
+// time without a heap-profile diff.  Every successful return is recorded --
+// including carve-outs from the pre-reserved pools, since those commit
+// memory even though the VA was reserved up front.  SystemAlloc is rare
+// (each event is at least a pageful of growth), so capturing a stack trace
+// per event is cheap relative to the mapping itself.
+ABSL_CONST_INIT GrowthLedgerEntry growth_ledger[kGrowthLedgerSize]
+    ABSL_GUARDED_BY(spinlock) = {};
+ABSL_CONST_INIT uint64_t growth_ledger_events ABSL_GUARDED_BY(spinlock) = 0;
+
+void RecordGrowth(void* ptr, size_t bytes, MemoryTag tag,
+                  absl::string_view owner)
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(spinlock) {
+  GrowthLedgerEntry& e =
+      growth_ledger[growth_ledger_events % kGrowthLedgerSize];
+  e.timestamp_ns = absl::GetCurrentTimeNanos();
+  e.start_addr = reinterpret_cast<uintptr_t>(ptr);
+  e.bytes = bytes;
+  e.tag = tag;
+  const size_t n = std::min(owner.size(), sizeof(e.owner) - 1);
+  memcpy(e.owner, owner.data(), n);
+  e.owner[n] = '\0';
+  // Skip RecordGrowth and SystemAlloc; the requester's frames are what an
+  // incident responder wants to see.
+  e.depth =
+      absl::GetStackTrace(e.stack, GrowthLedgerEntry::kMaxStackDepth, 2);
+  ++growth_ledger_events;
+}
+
+// Per-tag VA reservation accounting and budgets.
+//
+// The sampled, cold and metadata tags each draw from dedicated VA windows,
+// and nothing else bounds their growth: a sampling misconfiguration can
+// reserve terabytes of address space, bloating page tables and breaking
+// core-dump tooling long before any resident-memory limit trips.  A budget,
+// when configured, caps the address space each tag may reserve; MmapAligned
+// is the single point where tagged reservations are created, so enforcing
+// there covers every SystemAlloc path.  Counters are atomics so the stats
+// surfaces can read them without the allocator lock.
+//
+// Reservations are effectively permanent (release is madvise-based and keeps
+// the VA), so current_bytes is monotone in practice; peak is tracked anyway
+// so the accounting stays honest if that ever changes.
+struct TagVaUsage {
+  std::atomic<size_t> current{0};
+  std::atomic<size_t> peak{0};
+  std::atomic<size_t> budget{0};  // 0 = no budget configured
+  std::atomic<size_t> denials{0};
+  std::atomic<size_t> reserve{0};            // window size; 0 = no window
+  std::atomic<size_t> reserve_headroom{0};   // unconsumed bytes in the window
+  std::atomic<size_t> reserve_fallbacks{0};  // carves the window refused
+};
+constexpr MemoryTag kAllMemoryTags[] = {MemoryTag::kSampled,
+                                        MemoryTag::kNormalP0,
+                                        MemoryTag::kNormalP1, MemoryTag::kCold,
+                                        MemoryTag::kMetadata};
+constexpr size_t kNumMemoryTags =
+    sizeof(kAllMemoryTags) / sizeof(kAllMemoryTags[0]);
+ABSL_CONST_INIT TagVaUsage tag_va_usage[kNumMemoryTags] = {};
+
+size_t TagVaIndex(const MemoryTag tag) {
+  switch (tag) {
+    case MemoryTag::kSampled:
+      return 0;
+    case MemoryTag::kNormalP0:
+      return 1;
+    case MemoryTag::kNormalP1:
+      return 2;
+    case MemoryTag::kCold:
+      return 3;
+    case MemoryTag::kMetadata:
+      return 4;
+  }
+
+  ASSUME(false);
+  __builtin_unreachable();
+}
+
+// Budgets come from TCMALLOC_<TAG>_VA_BUDGET_BYTES (e.g.
+// TCMALLOC_SAMPLED_VA_BUDGET_BYTES), read once; an absent or zero value
+// leaves the tag unbounded.
+void InitTagVaBudgetsIfNecessary() {
+  ABSL_CONST_INIT static absl::once_flag flag;
+
+  absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    for (const MemoryTag tag : kAllMemoryTags) {
+      char name[64];
+      absl::SNPrintF(name, sizeof(name), "TCMALLOC_%s_VA_BUDGET_BYTES",
+                     MemoryTagToLabel(tag));
+      const char* e = thread_safe_getenv(name);
+      if (e == nullptr) continue;
+      char* end;
+      const unsigned long long bytes =  // NOLINT(runtime/int)
+          strtoull(e, &end, 10);
+      if (end == e || *end != '\0') {
+        Crash(kCrash, __FILE__, __LINE__, "bad VA budget (name, value)", name,
+              e);
+      }
+      tag_va_usage[TagVaIndex(tag)].budget.store(bytes,
+                                                 std::memory_order_relaxed);
+    }
+  });
+}
+
+// Returns true if a reservation of <size> fits under the tag's budget; on
+// refusal, bumps the denial counter and logs a stack for the first denial
+// per tag, since repeated failures share one cause.
+bool TagVaBudgetAllows(const MemoryTag tag, size_t size) {
+  InitTagVaBudgetsIfNecessary();
+  TagVaUsage& usage = tag_va_usage[TagVaIndex(tag)];
+  const size_t budget = usage.budget.load(std::memory_order_relaxed);
+  const size_t current = usage.current.load(std::memory_order_relaxed);
+  if (budget != 0 && (current + size < current || current + size > budget)) {
+    if (usage.denials.fetch_add(1, std::memory_order_relaxed) == 0) {
+      Log(kLogWithStack, __FILE__, __LINE__,
+          "Per-tag VA budget exhausted; refusing reservation "
+          "(tag, reserved, request, budget)",
+          MemoryTagToLabel(tag), current, size, budget);
+    }
+    return false;
+  }
+  return true;
+}
+
+// Accounts a successful reservation of <size> bytes against the tag.
+void TagVaAccount(const MemoryTag tag, size_t size) {
+  TagVaUsage& usage = tag_va_usage[TagVaIndex(tag)];
+  const size_t updated =
+      usage.current.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = usage.peak.load(std::memory_order_relaxed);
+  while (updated > peak && !usage.peak.compare_exchange_weak(
+                               peak, updated, std::memory_order_relaxed)) {
+  }
+}
+
+// Optional pre-reserved VA windows, one per tag.
+//
+// A long-lived process shreds its VA map: after enough churn the random
+// hint chain in MmapAligned keeps landing on occupied ranges, and on a
+// kernel without MAP_FIXED_NOREPLACE every miss is a map/unmap pair with
+// the TLB shootdown that entails.  When TCMALLOC_<TAG>_VA_RESERVE_BYTES is
+// set (e.g. TCMALLOC_COLD_VA_RESERVE_BYTES), one PROT_NONE window of that
+// size is reserved for the tag on first use and tagged reservations are
+// carved from it by pointer bump -- no mmap() per reservation, so no hint
+// to miss -- until the window fills, after which the hint chain takes over
+// as before.  Like the metadata pool, the window costs only address space;
+// resident memory is whatever the carvings commit and touch.
+//
+// The window is reserved through MmapAligned itself (a carve is only
+// attempted once a window exists, so the recursion terminates), which
+// applies the usual tag placement, NUMA binding, VMA naming, cold-region
+// recording and VA accounting.  The whole window is therefore accounted
+// when it is reserved, and carves from it are not accounted again.
+//
+// Like MmapAligned's hint state, the bump pointers are protected by
+// <spinlock> in practice (every caller holds it) but are not annotated,
+// since MmapAligned itself carries no lock annotation.
+struct TagVaReserve {
+  uintptr_t next = 0;  // 0 = no window configured (or reservation failed)
+  uintptr_t end = 0;
+  // One-shot log flags: a shrinking window warns once, not per carve.
+  bool low_headroom_logged = false;
+  bool exhaustion_logged = false;
+};
+ABSL_CONST_INIT TagVaReserve tag_va_reserve[kNumMemoryTags] = {};
+ABSL_CONST_INIT bool tag_va_reserve_initialized = false;
+
+void InitTagVaReservesIfNecessary() {
+  if (tag_va_reserve_initialized) return;
+  tag_va_reserve_initialized = true;
+  for (const MemoryTag tag : kAllMemoryTags) {
+    char name[64];
+    absl::SNPrintF(name, sizeof(name), "TCMALLOC_%s_VA_RESERVE_BYTES",
+                   MemoryTagToLabel(tag));
+    const char* e = thread_safe_getenv(name);
+    if (e == nullptr) continue;
+    char* end;
+    const unsigned long long bytes =  // NOLINT(runtime/int)
+        strtoull(e, &end, 10);
+    if (end == e || *end != '\0' || bytes == 0 || bytes > kTagMask) {
+      Crash(kCrash, __FILE__, __LINE__, "bad VA reserve (name, value)", name,
+            e);
+    }
+    const size_t size = RoundUp(bytes, kMinSystemAlloc);
+    void* ptr = MmapAligned(size, kMinSystemAlloc, tag, "va_reserve");
+    if (ptr == nullptr) {
+      // The process runs correctly without the window, just with the
+      // per-reservation hint chain the operator tried to avoid.
+      Log(kLog, __FILE__, __LINE__,
+          "Per-tag VA reserve failed; continuing without it (tag, bytes)",
+          MemoryTagToLabel(tag), size);
+      continue;
+    }
+    TagVaReserve& r = tag_va_reserve[TagVaIndex(tag)];
+    r.next = reinterpret_cast<uintptr_t>(ptr);
+    r.end = r.next + size;
+    TagVaUsage& usage = tag_va_usage[TagVaIndex(tag)];
+    usage.reserve.store(size, std::memory_order_relaxed);
+    usage.reserve_headroom.store(size, std::memory_order_relaxed);
+  }
+}
+
+// Returns a carve from the tag's pre-reserved window, or nullptr when no
+// window is configured or the request does not fit what remains.
+void* TagVaReserveAlloc(const MemoryTag tag, size_t size, size_t alignment) {
+  InitTagVaReservesIfNecessary();
+  TagVaReserve& r = tag_va_reserve[TagVaIndex(tag)];
+  if (r.next == 0) return nullptr;
+  TagVaUsage& usage = tag_va_usage[TagVaIndex(tag)];
+  const uintptr_t result = RoundUp(r.next, alignment);
+  if (result < r.next || result + size < result || result + size > r.end) {
+    if (!r.exhaustion_logged) {
+      r.exhaustion_logged = true;
+      Log(kLogWithStack, __FILE__, __LINE__,
+          "Per-tag VA reserve exhausted; falling back to mmap hints "
+          "(tag, reserve, request)",
+          MemoryTagToLabel(tag),
+          usage.reserve.load(std::memory_order_relaxed), size);
+    }
+    usage.reserve_fallbacks.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  r.next = result + size;
+  const size_t headroom = r.end - r.next;
+  usage.reserve_headroom.store(headroom, std::memory_order_relaxed);
+  if (!r.low_headroom_logged &&
+      headroom < usage.reserve.load(std::memory_order_relaxed) / 8) {
+    // Warn while there is still room to act (resize the reserve, or accept
+    // the coming fallback); exhaustion itself logs separately above.
+    r.low_headroom_logged = true;
+    Log(kLog, __FILE__, __LINE__,
+        "Per-tag VA reserve below 1/8 headroom (tag, headroom, reserve)",
+        MemoryTagToLabel(tag), headroom,
+        usage.reserve.load(std::memory_order_relaxed));
+  }
+  return reinterpret_cast<void*>(result);
+}
+
+}  // namespace
+
+TagVaStats SystemTagVaStats(MemoryTag tag) {
+  const TagVaUsage& usage = tag_va_usage[TagVaIndex(tag)];
+  TagVaStats stats;
+  stats.current_bytes = usage.current.load(std::memory_order_relaxed);
+  stats.peak_bytes = usage.peak.load(std::memory_order_relaxed);
+  stats.budget_bytes = usage.budget.load(std::memory_order_relaxed);
+  stats.denials = usage.denials.load(std::memory_order_relaxed);
+  stats.reserve_bytes = usage.reserve.load(std::memory_order_relaxed);
+  stats.reserve_headroom_bytes =
+      usage.reserve_headroom.load(std::memory_order_relaxed);
+  stats.reserve_fallbacks =
+      usage.reserve_fallbacks.load(std::memory_order_relaxed);
+  return stats;
+}
+
+int SystemGrowthLedgerSnapshot(GrowthLedgerEntry* entries, int max_entries,
+                               uint64_t* total_events) {
+  AllocationGuardSpinLockHolder lock_holder(&spinlock);
+  const uint64_t total = growth_ledger_events;
+  const int n = static_cast<int>(std::min<uint64_t>(
+      {total, static_cast<uint64_t>(kGrowthLedgerSize),
+       static_cast<uint64_t>(max_entries)}));
+  for (int i = 0; i < n; ++i) {
+    entries[i] = growth_ledger[(total - n + i) % kGrowthLedgerSize];
+  }
+  *total_events = total;
+  return n;
+}
+
+AddressRange SystemAlloc(size_t bytes, size_t alignment, const MemoryTag tag,
+                         const absl::string_view owner) {
   // If default alignment is set request the minimum alignment provided by
   // the system.
   alignment = std::max(alignment, GetPageSize());
@@ -457,12 +1212,40 @@ AddressRange SystemAlloc(size_t bytes, size_t alignment, const MemoryTag tag) {
 
   InitSystemAllocatorIfNecessary();
 
-  auto [result, actual_bytes] = region_manager->Alloc(bytes, alignment, tag);
+#ifdef MAP_HUGETLB
+  // Serve huge requests from the explicit hugetlb pool when one is
+  // configured, for guaranteed 2MiB backing instead of best-effort THP.
+  if (AddressRange pooled = HugetlbPoolAlloc(bytes, alignment, tag);
+      pooled.ptr != nullptr) {
+    CheckAddressBits<kAddressBits>(reinterpret_cast<uintptr_t>(pooled.ptr) +
+                                   pooled.bytes - 1);
+    ASSERT(GetMemoryTag(pooled.ptr) == tag);
+    RecordGrowth(pooled.ptr, pooled.bytes, tag, owner);
+    return pooled;
+  }
+#endif
+
+  // Serve metadata from the pre-reserved pool so metadata growth does not
+  // manufacture mappings one increment at a time.
+  if (tag == MemoryTag::kMetadata) {
+    if (AddressRange pooled = MetadataPoolAlloc(bytes, alignment);
+        pooled.ptr != nullptr) {
+      CheckAddressBits<kAddressBits>(reinterpret_cast<uintptr_t>(pooled.ptr) +
+                                     pooled.bytes - 1);
+      ASSERT(GetMemoryTag(pooled.ptr) == tag);
+      RecordGrowth(pooled.ptr, pooled.bytes, tag, owner);
+      return pooled;
+    }
+  }
+
+  auto [result, actual_bytes] =
+      region_manager->Alloc(bytes, alignment, tag, owner);
 
   if (result != nullptr) {
     CheckAddressBits<kAddressBits>(reinterpret_cast<uintptr_t>(result) +
                                    actual_bytes - 1);
     ASSERT(GetMemoryTag(result) == tag);
+    RecordGrowth(result, actual_bytes, tag, owner);
   }
   return {result, actual_bytes};
 }
@@ -493,6 +1276,25 @@ static bool ReleasePages(void* start, size_t length) {
     } while (ret == -1 && errno == EAGAIN);
 
     // We deliberately fall through to use MADV_DONTNEED.
+  } else if (Parameters::madvise_free_lazy() &&
+             !lazy_release_fallback.load(std::memory_order_relaxed)) {
+    do {
+      ret = madvise(start, length, MADV_FREE);
+    } while (ret == -1 && errno == EAGAIN);
+
+    if (ret == 0) {
+      // Leave the pages mapped: reuse before kernel reclaim skips the
+      // zero-fill fault.  Remember the range for reclaim probing.
+      const size_t i = lazy_release_next_range.fetch_add(
+                           1, std::memory_order_relaxed) %
+                       kLazyReleaseRanges;
+      lazy_release_ranges[i].ptr.store(reinterpret_cast<uintptr_t>(start),
+                                       std::memory_order_relaxed);
+      lazy_release_ranges[i].length.store(length, std::memory_order_relaxed);
+      lazy_release_bytes.fetch_add(length, std::memory_order_relaxed);
+      return true;
+    }
+    // The kernel rejected MADV_FREE; fall through to MADV_DONTNEED.
   }
 #endif
 #ifdef MADV_DONTNEED
@@ -513,6 +1315,244 @@ int SystemReleaseErrors() {
   return system_release_errors.load(std::memory_order_relaxed);
 }
 
+void AcquireSystemAllocLock() ABSL_EXCLUSIVE_LOCK_FUNCTION(spinlock) {
+  spinlock.Lock();
+}
+
+void ReleaseSystemAllocLock() ABSL_UNLOCK_FUNCTION(spinlock) {
+  spinlock.Unlock();
+}
+
+LazyReleaseStats SystemLazyReleaseStats() {
+  LazyReleaseStats stats;
+#ifdef MADV_FREE
+  stats.released_bytes = lazy_release_bytes.load(std::memory_order_relaxed);
+  stats.sampled_bytes =
+      lazy_release_sampled_bytes.load(std::memory_order_relaxed);
+  stats.resident_bytes =
+      lazy_release_resident_bytes.load(std::memory_order_relaxed);
+  stats.fallback = lazy_release_fallback.load(std::memory_order_relaxed);
+#endif
+  return stats;
+}
+
+size_t SystemAdviseColdRegions() {
+  size_t advised = 0;
+#ifdef MADV_COLD
+  ErrnoRestorer errno_restorer;
+  for (int i = 0; i < kColdRegionRanges; ++i) {
+    const uintptr_t ptr =
+        cold_region_ranges[i].ptr.load(std::memory_order_relaxed);
+    const size_t length =
+        cold_region_ranges[i].length.load(std::memory_order_relaxed);
+    if (ptr == 0 || length == 0) {
+      continue;
+    }
+    int ret;
+    do {
+      ret = madvise(reinterpret_cast<void*>(ptr), length, MADV_COLD);
+    } while (ret == -1 && errno == EAGAIN);
+    if (ret == 0) {
+      advised += length;
+    }
+  }
+#endif  // MADV_COLD
+  return advised;
+}
+
+#if defined(__linux__) && defined(__NR_move_pages)
+namespace {
+
+// Derives the set of NUMA nodes hosting CPUs in `affinity`, as a nodemask in
+// the format mbind()/move_pages() use.  Walks the same sysfs cpulist files as
+// InitNumaTopology; returns 0 if they are unavailable.
+uint64_t LocalNodesForAffinity(const cpu_set_t& affinity) {
+  uint64_t nodes = 0;
+  for (size_t node = 0; node < sizeof(nodes) * 8; ++node) {
+    const int fd = OpenSysfsCpulist(node);
+    if (fd == -1) {
+      // We expect to encounter ENOENT once node surpasses the actual number
+      // of nodes; anything else means sysfs is unusable here.
+      break;
+    }
+    std::optional<cpu_set_t> node_cpus =
+        ParseCpulist([&](char* const buf, const size_t count) {
+          return signal_safe_read(fd, buf, count, /*bytes_read=*/nullptr);
+        });
+    signal_safe_close(fd);
+    if (!node_cpus.has_value()) {
+      continue;
+    }
+    cpu_set_t overlap;
+    CPU_AND(&overlap, &*node_cpus, &affinity);
+    if (CPU_COUNT(&overlap) != 0) {
+      nodes |= uint64_t{1} << node;
+    }
+  }
+  return nodes;
+}
+
+}  // namespace
+#endif  // __linux__ && __NR_move_pages
+
+size_t SystemRehomeNumaRegions() {
+  size_t moved = 0;
+#if defined(__linux__) && defined(__NR_move_pages)
+  ErrnoRestorer errno_restorer;
+
+  // A cpuset move shows up as a changed affinity mask.  Deriving the local
+  // node set walks sysfs, so cache it and refresh only when the mask differs
+  // from the last pass.
+  static cpu_set_t last_affinity;
+  static bool have_affinity = false;
+  static uint64_t local_nodes = 0;
+  cpu_set_t affinity;
+  if (sched_getaffinity(0, sizeof(affinity), &affinity) != 0) {
+    return 0;
+  }
+  if (!have_affinity || !CPU_EQUAL(&affinity, &last_affinity)) {
+    last_affinity = affinity;
+    have_affinity = true;
+    local_nodes = LocalNodesForAffinity(affinity);
+  }
+  if (local_nodes == 0) {
+    return 0;
+  }
+
+  // Walk the recorded regions with a persistent cursor so successive passes
+  // sample different windows rather than rescanning the same leading pages.
+  static size_t cursor_region = 0;
+  static size_t cursor_offset = 0;
+
+  constexpr size_t kRehomePagesPerPass = 512;
+  static void* pages[kRehomePagesPerPass];
+  static int status[kRehomePagesPerPass];
+  const size_t page_size = GetPageSize();
+  size_t n = 0;
+  for (int scanned = 0; scanned < kNormalRegionRanges && n < kRehomePagesPerPass;
+       ++scanned) {
+    const size_t i = cursor_region % kNormalRegionRanges;
+    const uintptr_t ptr =
+        normal_region_ranges[i].ptr.load(std::memory_order_relaxed);
+    const size_t length =
+        normal_region_ranges[i].length.load(std::memory_order_relaxed);
+    if (ptr == 0 || length == 0) {
+      ++cursor_region;
+      cursor_offset = 0;
+      continue;
+    }
+    while (cursor_offset < length && n < kRehomePagesPerPass) {
+      pages[n++] = reinterpret_cast<void*>(ptr + cursor_offset);
+      cursor_offset += page_size;
+    }
+    if (cursor_offset >= length) {
+      ++cursor_region;
+      cursor_offset = 0;
+    }
+  }
+  if (n == 0) {
+    return 0;
+  }
+
+  // With no target nodes, move_pages() only reports where each page lives:
+  // its node number, or a negative errno (-ENOENT for non-resident pages,
+  // which we leave alone -- their next fault places them locally anyway).
+  if (syscall(__NR_move_pages, /*pid=*/0, n, pages, nullptr, status,
+              /*flags=*/0) != 0) {
+    numa_rehome_failures.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  numa_rehome_pages_sampled.fetch_add(n, std::memory_order_relaxed);
+
+  static int target_nodes[kRehomePagesPerPass];
+  static int rr_node = 0;
+  size_t misplaced = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const int node = status[i];
+    if (node < 0 || node >= 64 || (local_nodes >> node) & 1) {
+      continue;
+    }
+    // Spread migrated pages round-robin across the local nodes.
+    do {
+      rr_node = (rr_node + 1) % 64;
+    } while (((local_nodes >> rr_node) & 1) == 0);
+    pages[misplaced] = pages[i];
+    target_nodes[misplaced] = rr_node;
+    ++misplaced;
+  }
+  numa_rehome_pages_misplaced.fetch_add(misplaced, std::memory_order_relaxed);
+  if (misplaced == 0) {
+    return 0;
+  }
+
+  if (syscall(__NR_move_pages, /*pid=*/0, misplaced, pages, target_nodes,
+              status, MPOL_MF_MOVE) != 0) {
+    numa_rehome_failures.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  size_t failed = 0;
+  for (size_t i = 0; i < misplaced; ++i) {
+    if (status[i] >= 0) {
+      ++moved;
+    } else {
+      ++failed;
+    }
+  }
+  numa_rehome_pages_moved.fetch_add(moved, std::memory_order_relaxed);
+  if (failed > 0) {
+    numa_rehome_failures.fetch_add(failed, std::memory_order_relaxed);
+  }
+#endif  // __linux__ && __NR_move_pages
+  return moved;
+}
+
+NumaRehomeStats SystemNumaRehomeStats() {
+  NumaRehomeStats stats;
+  stats.pages_sampled =
+      numa_rehome_pages_sampled.load(std::memory_order_relaxed);
+  stats.pages_misplaced =
+      numa_rehome_pages_misplaced.load(std::memory_order_relaxed);
+  stats.pages_moved = numa_rehome_pages_moved.load(std::memory_order_relaxed);
+  stats.failures = numa_rehome_failures.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void SystemCheckLazyRelease() {
+#ifdef MADV_FREE
+  if (lazy_release_fallback.load(std::memory_order_relaxed)) {
+    return;
+  }
+  Residency residency;
+  size_t sampled = 0;
+  size_t resident = 0;
+  for (int i = 0; i < kLazyReleaseRanges; ++i) {
+    const uintptr_t ptr =
+        lazy_release_ranges[i].ptr.load(std::memory_order_relaxed);
+    const size_t length =
+        lazy_release_ranges[i].length.load(std::memory_order_relaxed);
+    if (ptr == 0 || length == 0) {
+      continue;
+    }
+    std::optional<Residency::Info> info =
+        residency.Get(reinterpret_cast<void*>(ptr), length);
+    if (!info.has_value()) {
+      continue;
+    }
+    sampled += length;
+    resident += info->bytes_resident;
+  }
+  lazy_release_sampled_bytes.store(sampled, std::memory_order_relaxed);
+  lazy_release_resident_bytes.store(resident, std::memory_order_relaxed);
+  // Ranges that were reallocated and touched again count as resident, which
+  // is exactly the reuse MADV_FREE is meant to make cheap.  If instead the
+  // kernel reclaimed most of what we released lazily, it is under enough
+  // memory pressure that laziness buys nothing; revert to MADV_DONTNEED.
+  if (sampled >= kLazyReleaseMinSampleBytes && resident < sampled / 4) {
+    lazy_release_fallback.store(true, std::memory_order_relaxed);
+  }
+#endif
+}
+
 bool SystemRelease(void* start, size_t length) {
   bool result = false;
 
@@ -538,6 +1578,18 @@ bool SystemRelease(void* start, size_t length) {
     void* new_ptr = reinterpret_cast<void*>(new_start);
     size_t new_length = new_end - new_start;
 
+    // Give the region factory first claim on the range.  A factory serving
+    // allocations from pooled backing storage (e.g. a memfd pool shared
+    // between co-located processes) can return the pages to its pool for
+    // other users instead of having us madvise them away.
+    {
+      AllocationGuardSpinLockHolder lock_holder(&spinlock);
+      if (region_factory != nullptr &&
+          region_factory->Release(new_ptr, new_length)) {
+        return true;
+      }
+    }
+
     if (!ReleasePages(new_ptr, new_length)) {
       // Try unlocking.
       int ret;
@@ -561,6 +1613,86 @@ bool SystemRelease(void* start, size_t length) {
   return result;
 }
 
+size_t SystemReleaseRanges(absl::Span<const AddressRange> ranges, bool* ok) {
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    ok[i] = false;
+  }
+
+#ifdef TCMALLOC_INTERNAL_HAVE_IO_URING
+  // The ring issues plain MADV_DONTNEED, so any configuration with per-range
+  // policy -- the MADV_FREE modes with their fallbacks and bookkeeping, or a
+  // custom region factory with first claim on released ranges -- stays on
+  // the synchronous path.
+  bool use_ring =
+      !Parameters::madvise_free() && !Parameters::madvise_free_lazy();
+  if (use_ring) {
+    AllocationGuardSpinLockHolder lock_holder(&spinlock);
+    use_ring = region_factory == nullptr ||
+               region_factory ==
+                   reinterpret_cast<AddressRegionFactory*>(&mmap_space);
+  }
+  if (use_ring) {
+    AllocationGuardSpinLockHolder ring_holder(&madvise_ring_lock);
+    if (madvise_ring_state == 0) {
+      madvise_ring_state = madvise_ring.Init() ? 1 : -1;
+    }
+    AddressRange batch[MadviseRing::kDepth];
+    size_t batch_index[MadviseRing::kDepth];
+    bool batch_ok[MadviseRing::kDepth];
+    size_t i = 0;
+    while (i < ranges.size() && madvise_ring_state == 1) {
+      size_t n = 0;
+      for (; i < ranges.size() && n < MadviseRing::kDepth; ++i) {
+        AddressRange aligned =
+            PageAlignedSubrange(ranges[i].ptr, ranges[i].bytes);
+        // SQE lengths are 32 bits; oversized ranges take the fallback.
+        if (aligned.bytes == 0 ||
+            aligned.bytes > std::numeric_limits<uint32_t>::max()) {
+          continue;
+        }
+        batch[n] = aligned;
+        batch_index[n] = i;
+        ++n;
+      }
+      if (n == 0) break;
+      const size_t successes =
+          madvise_ring.MadviseBatch(batch, n, MADV_DONTNEED, batch_ok);
+      if (successes == 0 && !madvise_ring_proven) {
+        // The first batch failing outright most likely means the kernel
+        // predates IORING_OP_MADVISE (every completion returns -EINVAL);
+        // disable the ring rather than pay for a doomed submission on every
+        // release.
+        madvise_ring_state = -1;
+        break;
+      }
+      if (successes > 0) {
+        madvise_ring_proven = true;
+      }
+      for (size_t j = 0; j < n; ++j) {
+        ok[batch_index[j]] = batch_ok[j];
+      }
+      if (!madvise_ring.usable()) {
+        // A short submission left stale SQEs in the queue; see
+        // MadviseRing::usable().  The unsubmitted ranges fall through to the
+        // synchronous path below.
+        madvise_ring_state = -1;
+        break;
+      }
+    }
+  }
+#endif  // TCMALLOC_INTERNAL_HAVE_IO_URING
+
+  // Synchronous fallback for every range the ring did not release.
+  size_t released = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (!ok[i]) {
+      ok[i] = SystemRelease(ranges[i].ptr, ranges[i].bytes);
+    }
+    released += ok[i] ? 1 : 0;
+  }
+  return released;
+}
+
 AddressRegionFactory* GetRegionFactory() {
   AllocationGuardSpinLockHolder lock_holder(&spinlock);
   InitSystemAllocatorIfNecessary();
@@ -581,6 +1713,26 @@ static uintptr_t RandomMmapHint(size_t size, size_t alignment,
   ABSL_CONST_INIT static absl::once_flag flag;
 
   absl::base_internal::LowLevelCallOnce(&flag, [&]() {
+    // Escape hatch for A/B benchmarking: a fixed seed makes the hint chain
+    // -- and with it the process's heap VA layout -- identical from run to
+    // run, so experiments measure code changes rather than layout noise.
+    // This forfeits the heap's share of ASLR, so it must be requested
+    // explicitly and never becomes a default.
+    const char* e = thread_safe_getenv("TCMALLOC_DETERMINISTIC_MMAP_SEED");
+    if (e != nullptr) {
+      char* end;
+      const unsigned long s = strtoul(e, &end, 10);  // NOLINT(runtime/int)
+      if (end == e || *end != '\0') {
+        Crash(kCrash, __FILE__, __LINE__,
+              "bad TCMALLOC_DETERMINISTIC_MMAP_SEED", e);
+      }
+      Log(kLog, __FILE__, __LINE__,
+          "TCMALLOC_DETERMINISTIC_MMAP_SEED set; heap layout is "
+          "deterministic and ASLR for heap mappings is disabled",
+          s);
+      rnd = static_cast<uintptr_t>(s);
+      return;
+    }
     void* seed =
         mmap(nullptr, kPageSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (seed == MAP_FAILED) {
@@ -620,10 +1772,24 @@ static uintptr_t RandomMmapHint(size_t size, size_t alignment,
   return addr;
 }
 
-void* MmapAligned(size_t size, size_t alignment, const MemoryTag tag) {
+void* MmapAligned(size_t size, size_t alignment, const MemoryTag tag,
+                  const absl::string_view owner) {
   TC_ASSERT_LE(size, kTagMask);
   TC_ASSERT_LE(alignment, kTagMask);
 
+  // A carve from the tag's pre-reserved window creates no new mapping and
+  // consumes VA that was counted -- and checked against the budget -- when
+  // the window was reserved, so it bypasses both below.
+  if (void* reserved = TagVaReserveAlloc(tag, size, alignment);
+      reserved != nullptr) {
+    ASSERT(GetMemoryTag(reserved) == tag);
+    return reserved;
+  }
+
+  if (!TagVaBudgetAllows(tag, size)) {
+    return nullptr;
+  }
+
   static uintptr_t next_sampled_addr = 0;
   static std::array<uintptr_t, kNumaPartitions> next_normal_addr = {0};
   static uintptr_t next_cold_addr = 0;
@@ -676,20 +1842,26 @@ void* MmapAligned(size_t size, size_t alignment, const MemoryTag tag) {
       // Give the mmaped region a name based on its tag.
 #ifdef __linux__
       // Make a best-effort attempt to name the allocated region based on its
-      // tag.
+      // tag and the subsystem that requested it.
       //
       // The call to prctl() may fail if the kernel was not configured with the
       // CONFIG_ANON_VMA_NAME kernel option.  This is OK since the call is
       // primarily a debugging aid.
       char name[256];
-      absl::SNPrintF(name, sizeof(name), "tcmalloc_region_%s",
-                     MemoryTagToLabel(tag));
+      absl::SNPrintF(name, sizeof(name), "tcmalloc_region_%s_%s",
+                     MemoryTagToLabel(tag), owner);
       // Save the existing errno and restore it after the prctl system call.
       // Since PR_SET_VMA is a best effort call, we don't want it to overwrite
       // the existing errno value.
       ErrnoRestorer errno_restorer;
       prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, result, size, name);
 #endif  // __linux__
+      if (tag == MemoryTag::kCold) {
+        RecordColdRegion(result, size);
+      } else if (numa_partition.has_value()) {
+        RecordNormalRegion(result, size);
+      }
+      TagVaAccount(tag, size);
       return result;
     }
     if (map_fixed_noreplace_flag) {
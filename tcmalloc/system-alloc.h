@@ -19,8 +19,11 @@
 #define TCMALLOC_SYSTEM_ALLOC_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/malloc_extension.h"
@@ -48,12 +51,119 @@ struct AddressRange {
 //
 // The returned pointer is guaranteed to satisfy GetMemoryTag(ptr) == "tag".
 // Returns nullptr when out of memory.
-AddressRange SystemAlloc(size_t bytes, size_t alignment, MemoryTag tag);
+//
+// "owner" is a short label for the requesting subsystem (e.g. "page_heap",
+// "arena").  It is included in the name given to new mmap() reservations
+// (visible in /proc/self/maps and smaps), so RSS attribution tooling can
+// distinguish the allocator's mappings without in-process scraping.  Since
+// reservations are shared per tag, the recorded owner is the subsystem whose
+// request created the reservation.
+AddressRange SystemAlloc(size_t bytes, size_t alignment, MemoryTag tag,
+                         absl::string_view owner);
 
 // Returns the number of times we failed to give pages back to the OS after a
 // call to SystemRelease.
 int SystemReleaseErrors();
 
+// Used by the fork handlers to quiesce the system allocator across fork(),
+// so the child does not inherit a held lock.
+void AcquireSystemAllocLock();
+void ReleaseSystemAllocLock();
+
+// Counters describing lazy (MADV_FREE-only) release, active when
+// Parameters::madvise_free_lazy() is set.  Lazily released pages remain
+// resident until the kernel reclaims them, so released_bytes can overstate
+// how much memory was actually returned; resident_bytes/sampled_bytes from
+// the most recent SystemCheckLazyRelease() probe bounds the discrepancy.
+struct LazyReleaseStats {
+  size_t released_bytes = 0;  // cumulative bytes released with MADV_FREE only
+  size_t sampled_bytes = 0;   // bytes covered by the most recent probe
+  size_t resident_bytes = 0;  // of sampled_bytes, still resident at the probe
+  bool fallback = false;      // true once we reverted to MADV_DONTNEED
+};
+LazyReleaseStats SystemLazyReleaseStats();
+
+// Probes a sample of recently lazily released ranges for residency, updating
+// SystemLazyReleaseStats().  If the kernel has reclaimed most of the sampled
+// bytes, disables lazy release in favor of MADV_DONTNEED.  Called
+// periodically from the background thread.
+void SystemCheckLazyRelease();
+
+// Applies MADV_COLD to the mmap() reservations made for cold-tagged
+// allocations, marking their resident pages as preferred reclaim candidates.
+// Returns the number of bytes advised; 0 if the kernel lacks MADV_COLD or no
+// cold reservations exist.  Called periodically from the background thread
+// when Parameters::madvise_cold_regions() is set.
+size_t SystemAdviseColdRegions();
+
+// Samples the node placement of pages in the mmap() reservations made for
+// normal-tagged allocations and migrates pages that are no longer local to
+// the CPUs we may run on -- repairing NUMA locality after a cpuset move
+// without a restart.  Returns the number of pages migrated; 0 if the kernel
+// lacks move_pages(2) or everything sampled was already local.  Called
+// periodically from the background thread when
+// Parameters::numa_rehome_enabled() is set.
+size_t SystemRehomeNumaRegions();
+
+// Progress counters for SystemRehomeNumaRegions(), cumulative since startup.
+// pages_misplaced persistently tracking pages_sampled means migration is not
+// keeping up (or keeps failing; see failures); both near zero after a cpuset
+// move means locality has been repaired.
+struct NumaRehomeStats {
+  size_t pages_sampled = 0;    // pages whose placement we queried
+  size_t pages_misplaced = 0;  // of those, found on a non-local node
+  size_t pages_moved = 0;      // successfully migrated to a local node
+  size_t failures = 0;         // failed syscalls plus per-page move failures
+};
+NumaRehomeStats SystemNumaRehomeStats();
+
+// Per-tag virtual address accounting.  Every tagged mmap() reservation is
+// counted against its MemoryTag; when a budget is configured for a tag (via
+// the TCMALLOC_<TAG>_VA_BUDGET_BYTES environment variables, e.g.
+// TCMALLOC_SAMPLED_VA_BUDGET_BYTES), reservations that would exceed it are
+// refused -- surfacing a runaway tag (a sampling misconfiguration, say) as
+// an allocation failure and a logged stack instead of unbounded VA growth.
+//
+// A tag may additionally carry a pre-reserved VA window (via
+// TCMALLOC_<TAG>_VA_RESERVE_BYTES): one PROT_NONE mapping reserved up
+// front, from which tagged reservations are carved by pointer bump instead
+// of fresh mmap() calls.  reserve_headroom_bytes is the window's remaining
+// capacity; a monitor alerting on it approaching zero sees the fallback to
+// per-reservation mmap() coming before reserve_fallbacks starts counting.
+struct TagVaStats {
+  size_t current_bytes = 0;  // VA currently reserved for the tag
+  size_t peak_bytes = 0;     // high-water mark of current_bytes
+  size_t budget_bytes = 0;   // configured budget; 0 when unbounded
+  size_t denials = 0;        // reservations refused because of the budget
+  size_t reserve_bytes = 0;  // pre-reserved VA window size; 0 when none
+  size_t reserve_headroom_bytes = 0;  // unconsumed bytes left in the window
+  size_t reserve_fallbacks = 0;  // reservations the window could not take
+};
+TagVaStats SystemTagVaStats(MemoryTag tag);
+
+// One entry of the mapping-growth ledger: a range SystemAlloc handed out.
+// The fields are fixed-size so recording needs no allocation.
+struct GrowthLedgerEntry {
+  static constexpr int kMaxStackDepth = 32;
+  int64_t timestamp_ns;  // unix nanoseconds when the range was handed out
+  uintptr_t start_addr;
+  size_t bytes;
+  MemoryTag tag;
+  char owner[16];  // NUL-terminated, possibly truncated
+  int depth;
+  void* stack[kMaxStackDepth];
+};
+
+// Number of entries the ledger retains.
+inline constexpr int kGrowthLedgerSize = 64;
+
+// Copies the most recent growth events, oldest first, into
+// entries[0..max_entries).  Returns the number copied and stores the count
+// of events ever recorded in *total_events, so a poller comparing two
+// snapshots can tell whether the ring wrapped between them.
+int SystemGrowthLedgerSnapshot(GrowthLedgerEntry* entries, int max_entries,
+                               uint64_t* total_events);
+
 // This call is a hint to the operating system that the pages
 // contained in the specified range of memory will not be used for a
 // while, and can be released for use by other processes or the OS.
@@ -67,6 +177,20 @@ int SystemReleaseErrors();
 // Returns true on success.
 ABSL_MUST_USE_RESULT bool SystemRelease(void* start, size_t length);
 
+// Batched form of SystemRelease.  When the kernel supports io_uring, the
+// page-aligned ranges are issued as a queue of IORING_OP_MADVISE operations,
+// so a fragmented release pays one submission syscall per batch instead of
+// one madvise per range, and the kernel may process the queued operations in
+// parallel.  Completions are reaped before returning, because callers may
+// hand the ranges out for reuse as soon as this returns.  Ranges the queue
+// cannot serve (io_uring unavailable, a non-default release mode such as
+// MADV_FREE or lazy release configured, a custom region factory installed,
+// or a per-range failure) fall back to SystemRelease.
+//
+// Records per-range success in ok, which must hold ranges.size() entries,
+// and returns the number of ranges successfully released.
+size_t SystemReleaseRanges(absl::Span<const AddressRange> ranges, bool* ok);
+
 // This call is the inverse of SystemRelease: the pages in this range
 // are in use and should be faulted in.  (In principle this is a
 // best-effort hint, but in practice we will unconditionally fault the
@@ -91,7 +215,11 @@ void SetRegionFactory(AddressRegionFactory* factory);
 //
 // REQUIRES: pagesize <= alignment <= kTagMask
 // REQUIRES: size <= kTagMask
-void* MmapAligned(size_t size, size_t alignment, MemoryTag tag);
+//
+// The mapping is named "tcmalloc_region_<tag>_<owner>" via
+// PR_SET_VMA_ANON_NAME on kernels that support it.
+void* MmapAligned(size_t size, size_t alignment, MemoryTag tag,
+                  absl::string_view owner);
 
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
@@ -55,19 +55,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <limits>
 #include <map>
 #include <memory>
 #include <new>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
+#include "absl/base/internal/cycleclock.h"
 #include "absl/base/internal/spinlock.h"
 #include "absl/base/optimization.h"
 #include "absl/numeric/bits.h"
@@ -76,25 +81,39 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "tcmalloc/allocation_sample.h"
 #include "tcmalloc/allocation_sampling.h"
+#include "tcmalloc/allocation_site_sketch.h"
+#include "tcmalloc/allocation_trace.h"
 #include "tcmalloc/common.h"
 #include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/cpu_cache_miss_profiler.h"
 #include "tcmalloc/deallocation_profiler.h"
+#include "tcmalloc/deferred_free_queue.h"
 #include "tcmalloc/experiment.h"
 #include "tcmalloc/global_stats.h"
 #include "tcmalloc/guarded_allocations.h"
 #include "tcmalloc/guarded_page_allocator.h"
+#include "tcmalloc/huge_page_filler.h"
+#include "tcmalloc/huge_pages.h"
+#include "tcmalloc/huge_region.h"
 #include "tcmalloc/internal/allocation_guard.h"
+#include "tcmalloc/internal/cache_topology.h"
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/optimization.h"
 #include "tcmalloc/internal/overflow.h"
 #include "tcmalloc/internal/page_size.h"
 #include "tcmalloc/internal/percpu.h"
+#include "tcmalloc/internal/residency.h"
 #include "tcmalloc/internal/sampled_allocation.h"
+#include "tcmalloc/internal/stacktrace_filter.h"
+#include "tcmalloc/internal/sysinfo.h"
 #include "tcmalloc/internal_malloc_extension.h"
+#include "tcmalloc/large_span_cache.h"
+#include "tcmalloc/latency_profiling.h"
 #include "tcmalloc/malloc_extension.h"
 #include "tcmalloc/malloc_tracing_extension.h"
 #include "tcmalloc/new_extension.h"
@@ -103,8 +122,11 @@
 #include "tcmalloc/pagemap.h"
 #include "tcmalloc/pages.h"
 #include "tcmalloc/parameters.h"
+#include "tcmalloc/pinned_arena.h"
 #include "tcmalloc/sampler.h"
 #include "tcmalloc/segv_handler.h"
+#include "tcmalloc/signal_safe_allocation.h"
+#include "tcmalloc/sized_delete_check.h"
 #include "tcmalloc/span.h"
 #include "tcmalloc/static_vars.h"
 #include "tcmalloc/stats.h"
@@ -197,6 +219,28 @@ static void PrintStats(int level) {
   delete[] buffer;
 }
 
+extern "C" size_t MallocExtension_Internal_GetBinaryStats(
+    void* buffer, size_t buffer_length) {
+  return FillBinaryStats(buffer, buffer_length);
+}
+
+extern "C" size_t MallocExtension_Internal_GetHugeCacheState(
+    char* buffer, size_t buffer_length) {
+  if (buffer_length == 0) return 0;
+  tc_globals.InitIfNecessary();
+  PageHeapSpinLockHolder l;
+  return tc_globals.page_allocator().SerializeHugeCacheState(buffer,
+                                                             buffer_length);
+}
+
+extern "C" bool MallocExtension_Internal_SetHugeCacheState(const char* data,
+                                                           size_t size) {
+  const absl::string_view serialized(data, size);
+  tc_globals.InitIfNecessary();
+  PageHeapSpinLockHolder l;
+  return tc_globals.page_allocator().RestoreHugeCacheState(serialized);
+}
+
 extern "C" void MallocExtension_Internal_GetStats(std::string* ret) {
   size_t shift = std::max<size_t>(18, absl::bit_width(ret->capacity()) - 1);
   for (; shift < 22; shift++) {
@@ -240,6 +284,15 @@ extern "C" size_t TCMalloc_Internal_GetStats(char* buffer,
   return n;
 }
 
+extern "C" void MallocExtension_Internal_GetLatencyProfile(std::string* ret) {
+  // The latency profile is small; a fixed buffer is plenty.
+  const size_t kBufferSize = 16 << 10;
+  ret->resize(kBufferSize - 1);
+  Printer printer(&*ret->begin(), kBufferSize - 1);
+  PrintLatencyProfile(&printer);
+  ret->resize(std::min(kBufferSize - 2, printer.SpaceRequired()));
+}
+
 extern "C" const ProfileBase* MallocExtension_Internal_SnapshotCurrent(
     ProfileType type) {
   switch (type) {
@@ -248,12 +301,25 @@ extern "C" const ProfileBase* MallocExtension_Internal_SnapshotCurrent(
     case ProfileType::kFragmentation:
       return DumpFragmentationProfile(tc_globals).release();
     case ProfileType::kPeakHeap:
-      return tc_globals.peak_heap_tracker().DumpSample().release();
+    case ProfileType::kPeakHeapLastHour:
+    case ProfileType::kPeakHeapLastDay:
+      return tc_globals.peak_heap_tracker().DumpSample(type).release();
+    case ProfileType::kCpuCacheMiss:
+      return DumpCpuCacheMissProfile(tc_globals).release();
     default:
       return nullptr;
   }
 }
 
+extern "C" const ProfileBase* MallocExtension_Internal_SnapshotHeapProfileSince(
+    uint64_t* generation) {
+  AllocHandle now = 0;
+  auto profile = DumpHeapProfileSince(
+      tc_globals, static_cast<AllocHandle>(*generation), &now);
+  *generation = static_cast<uint64_t>(now);
+  return profile.release();
+}
+
 extern "C" AllocationProfilingTokenBase*
 MallocExtension_Internal_StartAllocationProfiling() {
   return new AllocationSample(&tc_globals.allocation_samples, absl::Now());
@@ -298,10 +364,61 @@ extern "C" void MallocExtension_Internal_SetMemoryLimit(
       limit, static_cast<PageAllocator::LimitKind>(limit_kind));
 }
 
+extern "C" int MallocExtension_Internal_CreateReservePool(size_t bytes) {
+  tc_globals.InitIfNecessary();
+  return tc_globals.page_allocator().CreateReservePool(bytes);
+}
+
+extern "C" bool MallocExtension_Internal_DestroyReservePool(int handle) {
+  return tc_globals.page_allocator().DestroyReservePool(handle);
+}
+
+extern "C" size_t MallocExtension_Internal_AcquireFromReservePool(int handle,
+                                                                  size_t bytes) {
+  return tc_globals.page_allocator().AcquireFromReservePool(handle, bytes);
+}
+
+extern "C" void MallocExtension_EnableForkSupport() {
+  tc_globals.EnableForkSupport();
+}
+
 extern "C" void MallocExtension_Internal_MarkThreadIdle() {
   ThreadCache::BecomeIdle();
 }
 
+extern "C" void MallocExtension_Internal_MarkProcessIdle() {
+  // Drain the caches from the outside in, so each tier's objects reach the
+  // page heap before we ask it to release: thread caches feed the transfer
+  // caches, per-CPU caches feed the transfer caches, and the transfer caches
+  // return spans to the central free lists.
+  ThreadCache::BecomeIdle();
+
+  if (tc_globals.CpuCacheActive() && subtle::percpu::IsFast()) {
+    CpuCache& cpu_cache = tc_globals.cpu_cache();
+    const int num_cpus = NumUsableCPUs();
+    for (int cpu = 0; cpu < num_cpus; ++cpu) {
+      cpu_cache.Reclaim(cpu);
+    }
+  }
+
+  // TryPlunder only returns objects untouched since the previous plunder, so
+  // two passes empty the caches completely: the first marks everything
+  // currently cached (including what the reclaim above just deposited), the
+  // second returns it.  The sharded caches drain into the unsharded ones, so
+  // they go first within each pass.
+  for (int pass = 0; pass < 2; ++pass) {
+    tc_globals.sharded_transfer_cache().Plunder();
+    tc_globals.transfer_cache().TryPlunder();
+  }
+
+  // With the caches drained, release everything the page heap can give back.
+  // This walks every release path -- HugeCache shrink, huge region release,
+  // and filler subrelease where enabled -- and covers the sampled/guarded
+  // page allocator as well.
+  MallocExtension_Internal_ReleaseMemoryToSystem(
+      std::numeric_limits<size_t>::max());
+}
+
 extern "C" AddressRegionFactory* MallocExtension_Internal_GetRegionFactory() {
   PageHeapSpinLockHolder l;
   return GetRegionFactory();
@@ -361,6 +478,144 @@ extern "C" size_t MallocExtension_Internal_ReleaseMemoryToSystem(
   return bytes_released;
 }
 
+extern "C" void MallocExtension_Internal_ReleaseMemoryToSystemWithDeadline(
+    size_t num_bytes, absl::Duration timeout, bool break_hugepages,
+    MallocExtension::DeadlineReleaseStats* result) {
+  TC_ASSERT_NE(result, nullptr);
+  // Compute the deadline before waiting on release_lock, so that time spent
+  // behind a concurrent release counts against the caller's budget.
+  const absl::Time deadline = absl::Now() + timeout;
+  AllocationGuardSpinLockHolder rh(&release_lock);
+
+  PageHeapSpinLockHolder l;
+  const PageAllocator::ReleaseStats released =
+      tc_globals.page_allocator().ReleaseUpToDeadline(
+          BytesToLengthCeil(num_bytes), deadline, break_hugepages);
+  result->cold_bytes = released.cold.in_bytes();
+  result->normal_bytes = released.normal.in_bytes();
+  result->sampled_bytes = released.sampled.in_bytes();
+  result->broken_hugepage_bytes = released.broken_hugepages.in_bytes();
+  result->deadline_exceeded = released.deadline_exceeded;
+}
+
+extern "C" void MallocExtension_Internal_MarkUnreleasable(void* ptr, size_t len,
+                                                          bool unreleasable) {
+  if (ptr == nullptr || len == 0) {
+    return;
+  }
+  // A single registration cannot straddle heaps: the range was returned by
+  // one allocation, so it carries one memory tag.
+  const PageId first = PageIdContaining(ptr);
+  const PageId last = PageIdContaining(static_cast<char*>(ptr) + len - 1);
+  const Length n = Length(last.index() - first.index() + 1);
+  PageHeapSpinLockHolder l;
+  tc_globals.page_allocator().MarkUnreleasable(first, n, GetMemoryTag(ptr),
+                                               unreleasable);
+}
+
+extern "C" bool MallocExtension_Internal_ReserveHeapMetadata(
+    size_t max_heap_bytes) {
+  tc_globals.InitIfNecessary();
+  // The pagemap bound covers the radix-tree spine; the extra share it leaves
+  // in each arena region also absorbs other per-span metadata, keeping later
+  // Ensure() misses to pointer bumps from already-backed memory.
+  const Length pages = BytesToLengthCeil(max_heap_bytes);
+  PageHeapSpinLockHolder l;
+  return tc_globals.arena().Reserve(PageMap::EnsureBytesForPages(pages));
+}
+
+namespace {
+
+// Populates the page-aligned range [addr, addr + len).  Prefers a single
+// MADV_POPULATE_WRITE call; when the kernel lacks it, falls back to a
+// read-modify-write touch of one byte per page, which forces a write fault
+// without altering contents.
+void PrefaultPages(char* addr, size_t len, size_t page_size) {
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(addr, len, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+#endif
+  for (size_t offset = 0; offset < len; offset += page_size) {
+    volatile char* page = reinterpret_cast<volatile char*>(addr + offset);
+    *page = *page;
+  }
+}
+
+// One worker's share of a Prefault over [base, base + len): the chunks with
+// index first_chunk, first_chunk + stride, ...  Each worker carries its own
+// Residency reader (the class is not thread-safe) and skips chunks that are
+// already fully resident.  Returns the bytes whose population was attempted.
+size_t PrefaultWorker(char* base, size_t len, size_t chunk_bytes,
+                      size_t first_chunk, size_t stride, size_t page_size) {
+  Residency residency;
+  const size_t num_chunks = (len + chunk_bytes - 1) / chunk_bytes;
+  size_t attempted = 0;
+  for (size_t i = first_chunk; i < num_chunks; i += stride) {
+    char* chunk = base + i * chunk_bytes;
+    const size_t chunk_len = std::min(chunk_bytes, len - i * chunk_bytes);
+    const std::optional<Residency::Info> info =
+        residency.Get(chunk, chunk_len);
+    if (info.has_value() && info->bytes_resident >= chunk_len) {
+      continue;
+    }
+    PrefaultPages(chunk, chunk_len, page_size);
+    attempted += chunk_len;
+  }
+  return attempted;
+}
+
+}  // namespace
+
+extern "C" size_t MallocExtension_Internal_Prefault(void* ptr, size_t len,
+                                                    int parallelism) {
+  if (ptr == nullptr || len == 0) {
+    return 0;
+  }
+  const size_t page_size = GetPageSize();
+  // Work on whole pages: faulting is page-granular anyway, and madvise
+  // requires an aligned start.
+  const uintptr_t start = reinterpret_cast<uintptr_t>(ptr) & ~(page_size - 1);
+  const uintptr_t end =
+      (reinterpret_cast<uintptr_t>(ptr) + len + page_size - 1) &
+      ~(page_size - 1);
+  char* base = reinterpret_cast<char*>(start);
+  const size_t total = end - start;
+
+  // Residency is consulted (and work handed out) per chunk: large enough to
+  // amortize the pagemap reads, small enough to balance across workers.
+  constexpr size_t kChunkBytes = 2 * 1024 * 1024;
+  const size_t num_chunks = (total + kChunkBytes - 1) / kChunkBytes;
+  const size_t workers =
+      std::min<size_t>({static_cast<size_t>(std::max(parallelism, 1)),
+                        num_chunks, size_t{16}});
+  if (workers == 1) {
+    return PrefaultWorker(base, total, kChunkBytes, /*first_chunk=*/0,
+                          /*stride=*/1, page_size);
+  }
+
+  // Deal chunks round-robin across the workers; the calling thread is
+  // worker 0.  Spawning threads here is fine: the caller is application
+  // code holding no allocator locks.
+  std::atomic<size_t> attempted{0};
+  std::vector<std::thread> helpers;
+  helpers.reserve(workers - 1);
+  for (size_t w = 1; w < workers; ++w) {
+    helpers.emplace_back([&, w] {
+      attempted.fetch_add(
+          PrefaultWorker(base, total, kChunkBytes, w, workers, page_size),
+          std::memory_order_relaxed);
+    });
+  }
+  attempted.fetch_add(
+      PrefaultWorker(base, total, kChunkBytes, 0, workers, page_size),
+      std::memory_order_relaxed);
+  for (std::thread& helper : helpers) {
+    helper.join();
+  }
+  return attempted.load(std::memory_order_relaxed);
+}
+
 // nallocx slow path.
 // Moved to a separate function because size_class_with_alignment is not inlined
 // which would cause nallocx to become non-leaf function with stack frame and
@@ -404,6 +659,47 @@ extern "C" MallocExtension::Ownership MallocExtension_Internal_GetOwnership(
   return GetOwnership(ptr);
 }
 
+extern "C" void MallocExtension_Internal_GetOwnershipBatch(
+    const void* const* ptrs, MallocExtension::PointerInfo* info, size_t count) {
+  // Sort the queries by page number so that consecutive lookups covered by
+  // the same pagemap leaf share a single radix walk; the results are written
+  // back in the caller's order.
+  struct Query {
+    uintptr_t page;
+    size_t index;
+  };
+  std::vector<Query> queries(count);
+  for (size_t i = 0; i < count; ++i) {
+    queries[i] = {PageIdContaining(ptrs[i]).index(), i};
+  }
+  std::sort(queries.begin(), queries.end(),
+            [](const Query& a, const Query& b) { return a.page < b.page; });
+  std::vector<uintptr_t> pages(count);
+  for (size_t i = 0; i < count; ++i) {
+    pages[i] = queries[i].page;
+  }
+  std::vector<void*> spans(count);
+  std::vector<CompactSizeClass> sizeclasses(count);
+  tc_globals.pagemap().GetSpanAndSizeClassBatch(pages.data(), count,
+                                                spans.data(),
+                                                sizeclasses.data());
+  for (size_t i = 0; i < count; ++i) {
+    MallocExtension::PointerInfo& out = info[queries[i].index];
+    if (spans[i] == nullptr) {
+      out = {};
+      out.ownership = MallocExtension::Ownership::kNotOwned;
+      continue;
+    }
+    out.ownership = MallocExtension::Ownership::kOwned;
+    out.size_class = sizeclasses[i];
+    // Classify from the pointer's address tag rather than by dereferencing
+    // the span, which would be unsafe for pointers found by scanning.
+    const MemoryTag tag = GetMemoryTag(ptrs[queries[i].index]);
+    out.sampled = tag == MemoryTag::kSampled;
+    out.cold = tag == MemoryTag::kCold;
+  }
+}
+
 extern "C" void MallocExtension_Internal_GetProperties(
     std::map<std::string, MallocExtension::Property>* result) {
   TCMallocStats stats;
@@ -448,6 +744,8 @@ extern "C" void MallocExtension_Internal_GetProperties(
       stats.sharded_transfer_bytes;
   (*result)["tcmalloc.per_cpu_caches_active"].value =
       tc_globals.CpuCacheActive();
+  (*result)["tcmalloc.percpu_active"].value =
+      tc_globals.CpuCacheActive() && subtle::percpu::IsFast();
   // Thread Cache Free List
   (*result)["tcmalloc.current_total_thread_cache_bytes"].value =
       stats.thread_bytes;
@@ -497,6 +795,70 @@ extern "C" void MallocExtension_Internal_GetProperties(
       tc_globals.page_allocator().successful_shrinks_after_limit_hit(
           PageAllocator::kHard);
 
+  // Kernel-measured residency of the allocator components with enumerable
+  // address ranges.  Unlike the accounting-derived properties above, these
+  // reflect what the kernel actually has resident, swapped, and backed by
+  // transparent hugepages at the time of the call.
+  ResidencyStats residency_stats;
+  ExtractResidencyStats(&residency_stats);
+  const struct {
+    absl::string_view name;
+    const ResidencyStats::Owner* owner;
+  } residency_owners[] = {
+      {"pagemap_root", &residency_stats.pagemap_root},
+      {"percpu_slab", &residency_stats.percpu_slab},
+      {"guarded_page_pool", &residency_stats.guarded_page_pool},
+      {"huge_cache", &residency_stats.huge_cache},
+      {"huge_region", &residency_stats.huge_region},
+  };
+  for (const auto& o : residency_owners) {
+    (*result)[absl::StrCat("tcmalloc.residency.", o.name, ".virtual_bytes")]
+        .value = o.owner->virtual_bytes;
+    (*result)[absl::StrCat("tcmalloc.residency.", o.name, ".resident_bytes")]
+        .value = o.owner->resident_bytes;
+    (*result)[absl::StrCat("tcmalloc.residency.", o.name, ".swapped_bytes")]
+        .value = o.owner->swapped_bytes;
+    (*result)[absl::StrCat("tcmalloc.residency.", o.name,
+                           ".hugepage_backed_bytes")]
+        .value = o.owner->hugepage_backed_bytes;
+  }
+
+  // Per-tag VA reservation accounting from the system allocator (see
+  // SystemTagVaStats).  budget_bytes is 0 for tags without a configured
+  // budget, in which case denials is always 0 as well; likewise
+  // reserve_bytes is 0 for tags without a pre-reserved VA window.
+  for (const MemoryTag tag :
+       {MemoryTag::kSampled, MemoryTag::kNormal, MemoryTag::kNormalP1,
+        MemoryTag::kCold, MemoryTag::kMetadata}) {
+    const TagVaStats va = SystemTagVaStats(tag);
+    const absl::string_view label = MemoryTagToLabel(tag);
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".current_bytes")]
+        .value = va.current_bytes;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".peak_bytes")].value =
+        va.peak_bytes;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".budget_bytes")].value =
+        va.budget_bytes;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".denials")].value =
+        va.denials;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".reserve_bytes")]
+        .value = va.reserve_bytes;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label,
+                           ".reserve_headroom_bytes")]
+        .value = va.reserve_headroom_bytes;
+    (*result)[absl::StrCat("tcmalloc.tag_va.", label, ".reserve_fallbacks")]
+        .value = va.reserve_fallbacks;
+  }
+
+  // Progress of the background NUMA re-home pass (see
+  // SystemNumaRehomeStats); all zero unless Parameters::numa_rehome_enabled()
+  // has been set.
+  const NumaRehomeStats rehome = SystemNumaRehomeStats();
+  (*result)["tcmalloc.numa_rehome.pages_sampled"].value = rehome.pages_sampled;
+  (*result)["tcmalloc.numa_rehome.pages_misplaced"].value =
+      rehome.pages_misplaced;
+  (*result)["tcmalloc.numa_rehome.pages_moved"].value = rehome.pages_moved;
+  (*result)["tcmalloc.numa_rehome.failures"].value = rehome.failures;
+
   WalkExperiments([&](absl::string_view name, bool active) {
     (*result)[absl::StrCat("tcmalloc.experiment.", name)].value = active;
   });
@@ -504,6 +866,8 @@ extern "C" void MallocExtension_Internal_GetProperties(
 
 extern "C" size_t MallocExtension_Internal_ReleaseCpuMemory(int cpu) {
   if (ABSL_PREDICT_FALSE(!subtle::percpu::IsFast())) return 0;
+  // CPUs beyond the provisioned slab bound (see NumUsableCPUs) have no cache.
+  if (cpu < 0 || cpu >= NumUsableCPUs()) return 0;
 
   size_t bytes = 0;
   if (tc_globals.CpuCacheActive()) {
@@ -512,6 +876,93 @@ extern "C" size_t MallocExtension_Internal_ReleaseCpuMemory(int cpu) {
   return bytes;
 }
 
+extern "C" size_t MallocExtension_Internal_GetDynamicSlabResizeTrace(
+    tcmalloc::MallocExtension::DynamicSlabResizeTraceEntry* entries,
+    size_t count) {
+  if (!tc_globals.CpuCacheActive()) return 0;
+
+  CpuCache::DynamicSlabResizeTraceEntry
+      trace[CpuCache::kDynamicSlabResizeTraceLength];
+  const size_t limit =
+      std::min(count, CpuCache::kDynamicSlabResizeTraceLength);
+  const size_t n = tc_globals.cpu_cache().GetDynamicSlabResizeTrace(
+      absl::MakeSpan(trace, limit));
+  for (size_t i = 0; i < n; ++i) {
+    entries[i].grow = trace[i].resize == CpuCache::DynamicSlabResize::kGrow;
+    entries[i].per_cpu_shift = trace[i].per_cpu_shift;
+    entries[i].underflows = trace[i].misses.underflows;
+    entries[i].overflows = trace[i].misses.overflows;
+    entries[i].madvise_failed_bytes = trace[i].madvise_failed_bytes;
+  }
+  return n;
+}
+
+extern "C" int MallocExtension_Internal_GetCacheTopologyShardCount() {
+  tc_globals.InitIfNecessary();
+  return CacheTopology::Instance().l3_count();
+}
+
+extern "C" int MallocExtension_Internal_GetCacheTopologyShardForCpu(int cpu) {
+  tc_globals.InitIfNecessary();
+  if (cpu < 0 || cpu >= NumCPUs() ||
+      CacheTopology::Instance().l3_count() == 0) {
+    return -1;
+  }
+  return CacheTopology::Instance().GetL3FromCpuId(cpu);
+}
+
+extern "C" size_t MallocExtension_Internal_GetCacheTopologyShardBytes(
+    int shard) {
+  tc_globals.InitIfNecessary();
+  return tc_globals.sharded_transfer_cache().ShardTotalBytes(shard);
+}
+
+extern "C" size_t MallocExtension_Internal_GetTopAllocationSites(
+    tcmalloc::MallocExtension::AllocationSiteStats* sites, size_t count) {
+  tc_globals.InitIfNecessary();
+  AllocationSiteSketch::SiteStats top[AllocationSiteSketch::kTopSites];
+  const size_t limit = std::min(count, AllocationSiteSketch::kTopSites);
+  const size_t n = tc_globals.allocation_site_sketch().Snapshot(
+      absl::MakeSpan(top, limit));
+  for (size_t i = 0; i < n; ++i) {
+    sites[i].site_hash = top[i].site_hash;
+    sites[i].live_bytes = top[i].live_bytes;
+    sites[i].count = top[i].count;
+  }
+  return n;
+}
+
+extern "C" size_t MallocExtension_Internal_GetThreadCacheOccupancy(
+    uint64_t* buckets, size_t count) {
+  static_assert(tcmalloc::MallocExtension::kThreadCacheOccupancyBuckets ==
+                    ThreadCache::kOccupancyBuckets,
+                "public bucket count must match the thread cache's");
+  tc_globals.InitIfNecessary();
+  uint64_t histogram[ThreadCache::kOccupancyBuckets];
+  {
+    PageHeapSpinLockHolder l;
+    ThreadCache::GetOccupancyHistogram(histogram);
+  }
+  const size_t n = std::min(count, ThreadCache::kOccupancyBuckets);
+  for (size_t i = 0; i < n; ++i) {
+    buckets[i] = histogram[i];
+  }
+  return n;
+}
+
+extern "C" bool MallocExtension_Internal_ActivatePinnedArena(size_t bytes) {
+  tc_globals.InitIfNecessary();
+  return tc_globals.pinned_arena().Activate(bytes);
+}
+
+extern "C" void MallocExtension_Internal_EnterPinnedScope() {
+  PinnedArena::EnterScope();
+}
+
+extern "C" void MallocExtension_Internal_ExitPinnedScope() {
+  PinnedArena::ExitScope();
+}
+
 //-------------------------------------------------------------------
 // Helpers for the exported routines below
 //-------------------------------------------------------------------
@@ -542,6 +993,9 @@ inline size_t GetSize(const void* ptr) {
 // This slow path also handles delete hooks and non-per-cpu mode.
 ABSL_ATTRIBUTE_NOINLINE static void FreeWithHooksOrPerThread(
     void* ptr, size_t size_class) {
+  if (AllocationTraceEnabled()) {
+    TraceDeallocation(ptr, size_class);
+  }
   if (ABSL_PREDICT_TRUE(UsePerCpuCache(tc_globals))) {
     tc_globals.cpu_cache().DeallocateSlow(ptr, size_class);
   } else if (ThreadCache* cache = ThreadCache::GetCacheIfPresent();
@@ -587,6 +1041,7 @@ static inline ABSL_ATTRIBUTE_ALWAYS_INLINE void FreeSmall(void* ptr,
   //  - per-thread mode is enabled
   if (ABSL_PREDICT_FALSE(
           !tc_globals.cpu_cache().DeallocateFast(ptr, size_class))) {
+    SLOW_PATH_BARRIER();
     FreeSmallSlow(ptr, size_class);
   }
 }
@@ -595,6 +1050,7 @@ namespace {
 
 template <typename Policy>
 inline sized_ptr_t do_malloc_pages(size_t size, size_t weight, Policy policy) {
+  ScopedLatencyTimer timer(LatencyProfileKind::kPageAllocation);
   // Page allocator does not deal well with num_pages = 0.
   Length num_pages = std::max<Length>(BytesToLengthCeil(size), Length(1));
 
@@ -604,9 +1060,20 @@ inline sized_ptr_t do_malloc_pages(size_t size, size_t weight, Policy policy) {
   } else if (tc_globals.numa_topology().numa_aware()) {
     tag = NumaNormalTag(policy.numa_partition());
   }
-  Span* span = tc_globals.page_allocator().NewAligned(
-      num_pages, BytesToLengthCeil(policy.align()),
-      {1, AccessDensityPrediction::kSparse}, tag);
+  Span* span = nullptr;
+  if (ABSL_PREDICT_FALSE(Parameters::large_span_cache_enabled()) &&
+      tag == MemoryTag::kNormal && weight == 0 &&
+      policy.align() <= kPageSize) {
+    // A cached span is page-aligned and already registered in the pagemap;
+    // sampled allocations (weight != 0) skip the cache so their spans keep
+    // going through the sampling machinery.
+    span = LargeSpanCacheRemove(num_pages);
+  }
+  if (span == nullptr) {
+    span = tc_globals.page_allocator().NewAligned(
+        num_pages, BytesToLengthCeil(policy.align()),
+        {1, AccessDensityPrediction::kSparse}, tag);
+  }
   if (span == nullptr) return {nullptr, 0};
 
   // Set capacity to the exact size for a page allocation.  This needs to be
@@ -629,11 +1096,37 @@ inline sized_ptr_t do_malloc_pages(size_t size, size_t weight, Policy policy) {
 // prologue/epilogue for fast-path freeing functions.
 ABSL_ATTRIBUTE_NOINLINE
 static void InvokeHooksAndFreePages(void* ptr) {
+  // Blocks carved from the per-thread signal-safe pool or the pinned arena
+  // land here (their addresses resolve to no size class) but have no span;
+  // return them to their owner before touching span metadata.
+  if (ABSL_PREDICT_FALSE(SignalSafePool::Free(ptr))) {
+    return;
+  }
+  if (ABSL_PREDICT_FALSE(tc_globals.pinned_arena().Free(ptr))) {
+    return;
+  }
+  if (AllocationTraceEnabled()) {
+    TraceDeallocation(ptr, /*size_class=*/0);
+  }
   const PageId p = PageIdContaining(ptr);
 
   Span* span = tc_globals.pagemap().GetExistingDescriptor(p);
   TC_CHECK_NE(span, nullptr, "Possible double free detected");
 
+  if (DefaultStaticHooksPolicy::enabled()) {
+    DefaultStaticHooksPolicy::on_deallocate(span->bytes_in_span(),
+                                            /*size_class=*/0);
+  }
+
+  if (ABSL_PREDICT_FALSE(Parameters::hardened_free_checks()) &&
+      GetMemoryTag(ptr) == MemoryTag::kSampled && !span->sampled() &&
+      !tc_globals.guardedpage_allocator().PointerIsMine(ptr)) {
+    // A sampled-heap span holds exactly one sampled allocation and is
+    // unmarked exactly once, on its first free; arriving here unmarked while
+    // the span is still live means the pointer was freed twice.
+    TC_BUG("Double free of sampled allocation detected");
+  }
+
   MaybeUnsampleAllocation(tc_globals, ptr, span);
 
   if (ABSL_PREDICT_FALSE(
@@ -644,9 +1137,26 @@ static void InvokeHooksAndFreePages(void* ptr) {
   } else {
     ASSERT(span->first_page() == p);
     ASSERT(reinterpret_cast<uintptr_t>(ptr) % kPageSize == 0);
+    const MemoryTag tag = GetMemoryTag(ptr);
+    // Popular multi-page sizes can park the span in the large span cache for
+    // reuse on this L3 without a pageheap_lock trip; per-free bookkeeping
+    // already happened above, only the span's return is elided.
+    if (ABSL_PREDICT_FALSE(Parameters::large_span_cache_enabled()) &&
+        tag == MemoryTag::kNormal && !span->sampled() &&
+        LargeSpanCacheInsert(span)) {
+      return;
+    }
+    // Very large spans can be handed to the background thread so this thread
+    // pays only the enqueue; on overflow we fall through to the synchronous
+    // path.  All other per-free bookkeeping already happened above.
+    const int64_t deferred_threshold = Parameters::deferred_free_threshold();
+    if (ABSL_PREDICT_FALSE(deferred_threshold != 0) &&
+        span->bytes_in_span() >= static_cast<size_t>(deferred_threshold) &&
+        DeferLargeFree(span, tag)) {
+      return;
+    }
     PageHeapSpinLockHolder l;
-    tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1,
-                                       GetMemoryTag(ptr));
+    tc_globals.page_allocator().Delete(span, /*objects_per_span=*/1, tag);
   }
 }
 
@@ -657,6 +1167,42 @@ static size_t GetSizeClass(void* ptr) {
 }
 #endif
 
+// Validation run when Parameters::hardened_free_checks() is enabled: a
+// middle tier between the unchecked release free path and full sanitizers,
+// cheap enough for production canaries.  The checks are outlined so the fast
+// path pays only the flag test.
+ABSL_ATTRIBUTE_NOINLINE static void HardenedCheckObjectBoundary(
+    void* ptr, size_t size_class) {
+  // Objects of a size class are laid out end to end from a page-aligned span
+  // start, so a valid pointer is aligned to the largest power of two
+  // dividing the class size (capped at the page size).  A misaligned pointer
+  // points into an object's interior and would corrupt the freelists.
+  const size_t size = tc_globals.sizemap().class_to_size(size_class);
+  const size_t align = std::min(size & (~size + 1), kPageSize);
+  TC_CHECK_EQ(reinterpret_cast<uintptr_t>(ptr) & (align - 1), uintptr_t{0},
+              "Invalid free: pointer is not at an object boundary");
+}
+
+ABSL_ATTRIBUTE_NOINLINE static void HardenedCheckSizedDelete(
+    void* ptr, size_t size_class) {
+  // The sized-delete fast path trusts the caller's size hint instead of the
+  // pagemap; verify the hint resolves to the object's actual size class, so
+  // a wrong-size delete -- or a delete of a pointer whose page holds another
+  // size class, or no small allocation at all -- crashes here instead of
+  // corrupting the freelists.
+  const size_t actual = tc_globals.pagemap().sizeclass(PageIdContaining(ptr));
+  TC_CHECK_EQ(tc_globals.sizemap().class_to_size(actual),
+              tc_globals.sizemap().class_to_size(size_class),
+              "Mismatched sized delete detected");
+  HardenedCheckObjectBoundary(ptr, size_class);
+}
+
+// Per-thread countdown to the next sampled sized-delete cross-check
+// (sized_delete_check.h).  Initial-exec keeps the fast-path access a direct
+// TLS load, as with tcmalloc_sampler.
+ABSL_CONST_INIT static thread_local int64_t sized_delete_check_countdown
+    ABSL_ATTRIBUTE_INITIAL_EXEC = 0;
+
 // Helper for the object deletion (free, delete, etc.).  Inputs:
 //   ptr is object to be freed
 //   size_class is the size class of that object, or 0 if it's unknown
@@ -681,6 +1227,13 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void do_free(void* ptr) {
   if (ABSL_PREDICT_TRUE(size_class != 0)) {
     ASSERT(size_class == GetSizeClass(ptr));
     TC_ASSERT_NE(ptr, nullptr);
+    if (ABSL_PREDICT_FALSE(Parameters::hardened_free_checks())) {
+      HardenedCheckObjectBoundary(ptr, size_class);
+    }
+    if (DefaultStaticHooksPolicy::enabled()) {
+      DefaultStaticHooksPolicy::on_deallocate(
+          tc_globals.sizemap().class_to_size(size_class), size_class);
+    }
     FreeSmall(ptr, size_class);
   } else {
     SLOW_PATH_BARRIER();
@@ -693,15 +1246,16 @@ bool CorrectSize(void* ptr, size_t size, AlignPolicy align);
 
 bool CorrectAlignment(void* ptr, std::align_val_t alignment);
 
+// Per-tag handlers for the non-normal free path.  Each is outlined so the
+// sized-delete fast path pays only the single normal-tag bit test; the tag
+// discrimination below happens once per non-normal free.
+
 template <typename AlignPolicy>
-ABSL_ATTRIBUTE_NOINLINE static void free_sampled(void* ptr, size_t size,
-                                                 AlignPolicy align) {
-  TC_ASSERT_NE(ptr, nullptr);
-  // IsColdMemory(ptr) implies IsSampledMemory(ptr).
-  if (GetMemoryTag(ptr) != MemoryTag::kCold) {
-    // we don't know true class size of the ptr
-    return InvokeHooksAndFreePages(ptr);
-  }
+ABSL_ATTRIBUTE_NOINLINE static void free_cold(void* ptr, size_t size,
+                                              AlignPolicy align) {
+  TC_ASSERT(GetMemoryTag(ptr) == MemoryTag::kCold);
+  // Cold objects still have a size class; the cheap size-to-class mapping
+  // applies, just against the expanded (cold) classes.
   size_t size_class;
   if (ABSL_PREDICT_FALSE(!tc_globals.sizemap().GetSizeClass(
           CppPolicy().AlignAs(align.align()).AccessAsCold(), size,
@@ -711,28 +1265,68 @@ ABSL_ATTRIBUTE_NOINLINE static void free_sampled(void* ptr, size_t size,
     static_assert(kMaxSize >= kPageSize, "kMaxSize must be at least kPageSize");
     return InvokeHooksAndFreePages(ptr);
   }
+  if (DefaultStaticHooksPolicy::enabled()) {
+    DefaultStaticHooksPolicy::on_deallocate(size, size_class);
+  }
   FreeSmall(ptr, size_class);
 }
 
+template <typename AlignPolicy>
+ABSL_ATTRIBUTE_NOINLINE static void free_non_normal(void* ptr, size_t size,
+                                                    AlignPolicy align) {
+  TC_ASSERT_NE(ptr, nullptr);
+  // Dispatch indexed on the tag bits rather than chained compares, so adding
+  // a tag extends the switch instead of lengthening every non-normal free.
+  // A dense switch (not a function-pointer table: indirect calls are off the
+  // menu on the free path) is what the compiler lowers to an indexed jump
+  // where that wins.  kSampled covers guarded pages too, which are carved
+  // from the sampled region; kMetadata never backs user objects.
+  switch (GetMemoryTag(ptr)) {
+    case MemoryTag::kCold:
+      return free_cold(ptr, size, align);
+    case MemoryTag::kSampled:
+    default:
+      // We don't know the true size class of the ptr; its deletion must
+      // visit the span metadata.
+      return InvokeHooksAndFreePages(ptr);
+  }
+}
+
 template <typename AlignPolicy>
 inline ABSL_ATTRIBUTE_ALWAYS_INLINE void do_free_with_size(void* ptr,
                                                            size_t size,
                                                            AlignPolicy align) {
+  // Signal-safe pool and pinned arena blocks have neither a span nor a size
+  // class; divert them before the size hint is trusted.  Each check costs
+  // one predicted-false branch on a flag load while its facility has never
+  // been used.
+  if (ABSL_PREDICT_FALSE(SignalSafePool::Free(ptr))) {
+    return;
+  }
+  if (ABSL_PREDICT_FALSE(tc_globals.pinned_arena().Free(ptr))) {
+    return;
+  }
+
   ASSERT(CorrectSize(ptr, size, align));
   ASSERT(CorrectAlignment(ptr, static_cast<std::align_val_t>(align.align())));
 
   // This is an optimized path that may be taken if the binary is compiled
   // with -fsized-delete. We attempt to discover the size class cheaply
   // without any cache misses by doing a plain computation that
-  // maps from size to size-class.
+  // maps from size to size-class.  The pagemap radix walk is skipped
+  // entirely: the tag bits of the address distinguish sampled, guarded and
+  // cold memory, so a normal-tagged pointer with a size that resolves to a
+  // size class can be pushed straight to the per-cpu slab.  (When
+  // Parameters::hardened_free_checks() is on, HardenedCheckSizedDelete
+  // re-verifies the hint against the pagemap before trusting it.)
   //
   // The optimized path doesn't work with sampled objects, whose deletions
   // trigger more operations and require to visit metadata.
   if (ABSL_PREDICT_FALSE(!IsNormalMemory(ptr))) {
     if (ABSL_PREDICT_TRUE(ptr == nullptr)) return;
-    // Outline cold path to avoid putting cold size lookup on the fast path.
+    // Outline the tag dispatch to keep the fast path to the bit test above.
     SLOW_PATH_BARRIER();
-    return free_sampled(ptr, size, align);
+    return free_non_normal(ptr, size, align);
   }
 
   // At this point, since ptr's tag bit is 1, it means that it
@@ -750,8 +1344,39 @@ inline ABSL_ATTRIBUTE_ALWAYS_INLINE void do_free_with_size(void* ptr,
     return InvokeHooksAndFreePages(ptr);
   }
 
+  if (ABSL_PREDICT_FALSE(Parameters::hardened_free_checks())) {
+    HardenedCheckSizedDelete(ptr, size_class);
+  }
+  const int64_t check_interval =
+      Parameters::sized_delete_mismatch_check_interval();
+  if (ABSL_PREDICT_FALSE(check_interval > 0) &&
+      ABSL_PREDICT_FALSE(--sized_delete_check_countdown <= 0)) {
+    sized_delete_check_countdown = check_interval;
+    SampledSizedDeleteCheck(ptr, size, size_class);
+  }
+  if (DefaultStaticHooksPolicy::enabled()) {
+    DefaultStaticHooksPolicy::on_deallocate(size, size_class);
+  }
+  FreeSmall(ptr, size_class);
+}
+
+#ifdef TCMALLOC_UNCHECKED_FREE
+// Validation-free free for callers that already know the size class: no tag
+// dispatch, no size-to-class mapping, no hardened or mismatch sampling
+// checks -- just the per-cpu slab push.  Everything do_free_with_size
+// verifies becomes a caller promise here, re-checked only in debug builds.
+inline ABSL_ATTRIBUTE_ALWAYS_INLINE void do_free_unchecked(void* ptr,
+                                                           size_t size_class) {
+  TC_ASSERT_NE(ptr, nullptr);
+  TC_ASSERT_GT(size_class, 0);
+  TC_ASSERT_LT(size_class, kNumClasses);
+  // A sampled, guarded or large allocation resolves to size class 0 in the
+  // pagemap; this catches a caller freeing a pointer it did not allocate
+  // with sampling suppressed, as well as a stale or miscomputed class.
+  ASSERT(tc_globals.pagemap().sizeclass(PageIdContaining(ptr)) == size_class);
   FreeSmall(ptr, size_class);
 }
+#endif  // TCMALLOC_UNCHECKED_FREE
 
 // Checks that an asserted object size for <ptr> is valid.
 template <typename AlignPolicy>
@@ -907,6 +1532,12 @@ alloc_small_sampled_hooks_or_perthread(size_t size, size_t size_class,
                                 ptr);
   }
   if (Policy::invoke_hooks()) {
+    if (AllocationTraceEnabled()) {
+      TraceAllocation(ptr.p, size, size_class);
+    }
+  }
+  if (Policy::has_static_hooks()) {
+    Policy::on_allocate(size, size_class);
   }
   return Policy::as_pointer(ptr.p, ptr.n);
 }
@@ -924,7 +1555,22 @@ __attribute__((flatten))
 #endif
 ABSL_ATTRIBUTE_NOINLINE static typename Policy::pointer_type
 slow_alloc_small(size_t size, uint32_t size_class, Policy policy) {
-  size_t weight = GetThreadSampler()->RecordedAllocationFast(size);
+  if (ABSL_PREDICT_FALSE(InAllocationGuard())) {
+    // A reentrant allocation: a signal handler interrupted a no-allocation
+    // region (e.g. while pageheap_lock was held).  Taking locks or invoking
+    // hooks here can deadlock, so carve from the per-thread signal-safe pool
+    // instead; sampling and hooks are skipped for these blocks.  On pool
+    // exhaustion -- or a request for more than the pool's max_align_t
+    // alignment -- fall through and take our chances, as before.
+    if (policy.align() <= SignalSafePool::kAlignment) {
+      if (void* res = SignalSafePool::Allocate(size)) {
+        return Policy::as_pointer(res, SignalSafePool::AllocatedSize(size));
+      }
+    }
+  }
+  size_t weight = Policy::do_sampling()
+                      ? GetThreadSampler()->RecordedAllocationFast(size)
+                      : 0;
   if (ABSL_PREDICT_FALSE(weight != 0) ||
       ABSL_PREDICT_FALSE(tcmalloc::tcmalloc_internal::Static::HaveHooks()) ||
       ABSL_PREDICT_FALSE(!UsePerCpuCache(tc_globals))) {
@@ -934,17 +1580,37 @@ slow_alloc_small(size_t size, uint32_t size_class, Policy policy) {
 
   void* res = tc_globals.cpu_cache().AllocateSlowNoHooks(size_class);
   if (ABSL_PREDICT_FALSE(res == nullptr)) return policy.handle_oom(size);
+  if (Policy::has_static_hooks()) {
+    Policy::on_allocate(size, size_class);
+  }
   return Policy::to_pointer(res, size_class);
 }
 
 template <typename Policy>
 ABSL_ATTRIBUTE_NOINLINE static typename Policy::pointer_type slow_alloc_large(
     size_t size, Policy policy) {
-  size_t weight = GetThreadSampler()->RecordAllocation(size);
+  if (ABSL_PREDICT_FALSE(InAllocationGuard())) {
+    // Reentrant (signal-context) requests carve from the signal-safe pool;
+    // see slow_alloc_small.  Large or overaligned requests rarely fit its
+    // budget or its max_align_t alignment, in which case we fall through.
+    if (policy.align() <= SignalSafePool::kAlignment) {
+      if (void* res = SignalSafePool::Allocate(size)) {
+        return Policy::as_pointer(res, SignalSafePool::AllocatedSize(size));
+      }
+    }
+  }
+  size_t weight =
+      Policy::do_sampling() ? GetThreadSampler()->RecordAllocation(size) : 0;
   tcmalloc::sized_ptr_t res = do_malloc_pages(size, weight, policy);
   if (ABSL_PREDICT_FALSE(res.p == nullptr)) return policy.handle_oom(size);
 
   if (Policy::invoke_hooks()) {
+    if (AllocationTraceEnabled()) {
+      TraceAllocation(res.p, size, /*size_class=*/0);
+    }
+  }
+  if (Policy::has_static_hooks()) {
+    Policy::on_allocate(size, /*size_class=*/0);
   }
   return Policy::as_pointer(res.p, res.n);
 }
@@ -957,6 +1623,19 @@ static inline Pointer ABSL_ATTRIBUTE_ALWAYS_INLINE fast_alloc(Policy policy,
   // path. If malloc is not yet initialized, we may end up with size_class == 0
   // (regardless of size), but in this case should also delegate to the slow
   // path by the fast path check further down.
+  if (ABSL_PREDICT_FALSE(PinnedArena::InScope())) {
+    // Latency-critical scope: serve from the mlocked, pre-faulted arena so
+    // this allocation cannot take a page fault.  Sampling and hooks are
+    // skipped; on overflow the arena counts the miss and we fall through to
+    // normal memory.  Arena payloads are only kMinPayload-aligned, so
+    // requests for stricter alignment stay on the normal paths.
+    if (policy.align() <= PinnedArena::kMinPayload) {
+      if (void* res = tc_globals.pinned_arena().Allocate(size)) {
+        return Policy::as_pointer(res, PinnedArena::AllocatedSize(size));
+      }
+    }
+  }
+
   size_t size_class;
   bool is_small = tc_globals.sizemap().GetSizeClass(policy, size, &size_class);
   if (ABSL_PREDICT_FALSE(!is_small)) {
@@ -969,7 +1648,9 @@ static inline Pointer ABSL_ATTRIBUTE_ALWAYS_INLINE fast_alloc(Policy policy,
   // - no new/delete hooks need to be invoked
   // - no need to initialize thread globals, data or caches.
   // The method updates 'bytes until next sample' thread sampler counters.
-  if (ABSL_PREDICT_FALSE(!GetThreadSampler()->TryRecordAllocationFast(size))) {
+  // Policies that disable sampling fold the check away at compile time.
+  if (Policy::do_sampling() &&
+      ABSL_PREDICT_FALSE(!GetThreadSampler()->TryRecordAllocationFast(size))) {
     SLOW_PATH_BARRIER();
     return slow_alloc_small(size, size_class, policy);
   }
@@ -987,9 +1668,197 @@ static inline Pointer ABSL_ATTRIBUTE_ALWAYS_INLINE fast_alloc(Policy policy,
   }
 
   TC_ASSERT_NE(ret, nullptr);
+  if (Policy::has_static_hooks()) {
+    Policy::on_allocate(size, size_class);
+  }
   return Policy::to_pointer(ret, size_class);
 }
 
+// Entry points for tcmalloc::SizeClassAllocator (size_class_allocator.h).
+// Clients resolve a fixed allocation size to its size class once via
+// MallocExtension_Internal_GetAllocSizeClass and then allocate/free through
+// the per-size-class functions, skipping the size-to-class lookup that
+// fast_alloc performs on every call.
+
+extern "C" size_t MallocExtension_Internal_GetAllocSizeClass(size_t size) {
+  tc_globals.InitIfNecessary();
+  size_t size_class;
+  if (!tc_globals.sizemap().GetSizeClass(MallocPolicy(), size, &size_class)) {
+    // size > kMaxSize; there is no small size class for it.
+    return 0;
+  }
+  return size_class;
+}
+
+extern "C" ABSL_CACHELINE_ALIGNED void*
+MallocExtension_Internal_AllocOfSizeClass(size_t size_class, size_t size) {
+  ASSERT(size_class > 0 && size_class < kNumClasses);
+  ASSERT(size <= tc_globals.sizemap().class_to_size(size_class));
+
+  // The slow path covers sampling, hooks, per-thread mode, and lazy
+  // initialization, exactly as fast_alloc does for malloc().
+  if (ABSL_PREDICT_FALSE(
+          !GetThreadSampler()->TryRecordAllocationFast(size))) {
+    SLOW_PATH_BARRIER();
+    return slow_alloc_small(size, size_class, MallocPolicy());
+  }
+
+  void* ret = tc_globals.cpu_cache().AllocateFast(size_class);
+  if (ABSL_PREDICT_FALSE(ret == nullptr)) {
+    SLOW_PATH_BARRIER();
+    return slow_alloc_small(size, size_class, MallocPolicy());
+  }
+  return MallocPolicy::to_pointer(ret, size_class);
+}
+
+extern "C" ABSL_CACHELINE_ALIGNED void
+MallocExtension_Internal_FreeOfSizeClass(void* ptr, size_t size_class) {
+  ASSERT(size_class > 0 && size_class < kNumClasses);
+
+  // Sampled (and guarded) allocations carry a non-normal tag and must visit
+  // their metadata on deletion; same structure as do_free_with_size.
+  if (ABSL_PREDICT_FALSE(!IsNormalMemory(ptr))) {
+    if (ABSL_PREDICT_TRUE(ptr == nullptr)) return;
+    SLOW_PATH_BARRIER();
+    return free_non_normal(ptr, tc_globals.sizemap().class_to_size(size_class),
+                           DefaultAlignPolicy());
+  }
+
+  TC_ASSERT_NE(ptr, nullptr);
+  FreeSmall(ptr, size_class);
+}
+
+// Implements MallocExtension::Warmup.  Cycling the requested allocation
+// profile through malloc and free exercises the same paths a warm process
+// does: the allocations fault in span and per-cpu slab memory, and the
+// frees leave the caches feeding the calling thread's CPU populated.
+extern "C" void MallocExtension_Internal_Warmup(
+    const tcmalloc::MallocExtension::WarmupSpec* spec) {
+  tc_globals.InitIfNecessary();
+
+  for (const auto& entry : spec->allocations) {
+    if (entry.size == 0 || entry.count == 0) continue;
+    std::vector<void*> objects;
+    objects.reserve(entry.count);
+    for (size_t i = 0; i < entry.count; ++i) {
+      void* ptr = fast_alloc(MallocPolicy(), entry.size);
+      if (ptr == nullptr) break;
+      // Touch the object so its pages are faulted in, not merely mapped.
+      *static_cast<volatile char*>(ptr) = 0;
+      objects.push_back(ptr);
+    }
+    for (void* ptr : objects) {
+      do_free(ptr);
+    }
+  }
+
+  if (spec->backed_bytes > 0) {
+    // One large allocation backs a contiguous range; freeing it parks the
+    // still-backed hugepages in the page-level caches, ready for reuse.
+    void* ptr = fast_alloc(MallocPolicy(), spec->backed_bytes);
+    if (ptr != nullptr) {
+      volatile char* memory = static_cast<volatile char*>(ptr);
+      for (size_t offset = 0; offset < spec->backed_bytes;
+           offset += kPageSize) {
+        memory[offset] = 0;
+      }
+      do_free(ptr);
+    }
+  }
+}
+
+namespace {
+
+// Keeps the compiler from eliding a benchmarked allocation.
+ABSL_ATTRIBUTE_ALWAYS_INLINE inline void SinkPointer(void* ptr) {
+  asm volatile("" : : "r"(ptr) : "memory");
+}
+
+}  // namespace
+
+// Implements MallocExtension::RunSelfTest.  Each pattern repeats in rounds
+// until it has spent its share of the ~50ms budget and reports the fastest
+// round: the minimum is the least noisy estimator on a quiesced CPU, and it
+// discards the first rounds' cache-fill costs.
+extern "C" void MallocExtension_Internal_RunSelfTest(
+    tcmalloc::MallocExtension::SelfTestResult* result) {
+  tc_globals.InitIfNecessary();
+
+  // One well-populated small size class; all three patterns use it so their
+  // numbers differ only in the path exercised.
+  constexpr size_t kObjectSize = 64;
+  const double budget_cycles =
+      0.050 / 3 * absl::base_internal::CycleClock::Frequency();
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+
+  // Fast path: allocate and free one object back to back; the object stays
+  // at the head of the per-CPU freelist.
+  {
+    constexpr int kPairs = 10 * 1024;
+    double best = kInf;
+    for (double spent = 0; spent < budget_cycles;) {
+      const double start = absl::base_internal::CycleClock::Now();
+      for (int i = 0; i < kPairs; ++i) {
+        void* ptr = fast_alloc(MallocPolicy(), kObjectSize);
+        SinkPointer(ptr);
+        do_free(ptr);
+      }
+      const double elapsed = absl::base_internal::CycleClock::Now() - start;
+      spent += elapsed;
+      best = std::min(best, elapsed / kPairs);
+    }
+    result->fast_path_cycles = best;
+  }
+
+  // Cross-thread free: a helper thread allocates a batch that the measured
+  // thread frees, modeling producer/consumer traffic where frees never hit
+  // objects the local slab handed out.
+  {
+    constexpr size_t kBatch = 8 * 1024;
+    std::vector<void*> objects(kBatch);
+    double best = kInf;
+    for (double spent = 0; spent < budget_cycles;) {
+      std::thread filler([&] {
+        for (size_t i = 0; i < kBatch; ++i) {
+          objects[i] = fast_alloc(MallocPolicy(), kObjectSize);
+        }
+      });
+      filler.join();
+      const double start = absl::base_internal::CycleClock::Now();
+      for (void* ptr : objects) {
+        do_free(ptr);
+      }
+      const double elapsed = absl::base_internal::CycleClock::Now() - start;
+      spent += elapsed;
+      best = std::min(best, elapsed / kBatch);
+    }
+    result->cross_thread_free_cycles = best;
+  }
+
+  // Transfer-cache churn: holding far more live objects of one size class
+  // than the per-CPU cache caps out at forces the allocations to drain the
+  // transfer cache and the frees to flush batches back into it.
+  {
+    constexpr size_t kBatch = 32 * 1024;
+    std::vector<void*> objects(kBatch);
+    double best = kInf;
+    for (double spent = 0; spent < budget_cycles;) {
+      const double start = absl::base_internal::CycleClock::Now();
+      for (size_t i = 0; i < kBatch; ++i) {
+        objects[i] = fast_alloc(MallocPolicy(), kObjectSize);
+        SinkPointer(objects[i]);
+      }
+      for (void* ptr : objects) {
+        do_free(ptr);
+      }
+      const double elapsed = absl::base_internal::CycleClock::Now() - start;
+      spent += elapsed;
+      best = std::min(best, elapsed / kBatch);
+    }
+    result->transfer_cache_cycles = best;
+  }
+}
+
 }  // namespace tcmalloc_internal
 }  // namespace tcmalloc
 GOOGLE_MALLOC_SECTION_END
@@ -1003,6 +1872,10 @@ extern "C" size_t MallocExtension_Internal_GetAllocatedSize(const void* ptr) {
   return GetSize(ptr);
 }
 
+extern "C" size_t MallocExtension_Internal_GetThreadAllocatedBytes() {
+  return tcmalloc::tcmalloc_internal::GetThreadSampler()->allocated_bytes();
+}
+
 extern "C" void MallocExtension_Internal_MarkThreadBusy() {
   tc_globals.InitIfNecessary();
 
@@ -1044,6 +1917,316 @@ MallocTracingExtension_Internal_GetAllocatedAddressRanges() {
       "output vector.");
 }
 
+void MallocTracingExtension_Internal_ClassifyAddresses(
+    const uintptr_t* addresses, size_t count,
+    tcmalloc::malloc_tracing_extension::AddressOwnership* results) {
+  using tcmalloc::tcmalloc_internal::PageId;
+  using tcmalloc::tcmalloc_internal::PageIdContaining;
+  for (size_t i = 0; i < count; ++i) {
+    const PageId p =
+        PageIdContaining(reinterpret_cast<const void*>(addresses[i]));
+    // Lock-free pagemap snapshots.  The pointers read here serve only as
+    // identities -- the owning Span or tracker may be freed concurrently,
+    // so neither this function nor the caller may dereference them.
+    results[i].span_id =
+        reinterpret_cast<uintptr_t>(tc_globals.pagemap().GetDescriptor(p));
+    results[i].tracker_id =
+        reinterpret_cast<uintptr_t>(tc_globals.pagemap().TryGetHugepage(p));
+    const uint8_t size_class = tc_globals.pagemap().TrySizeclass(p);
+    results[i].object_size =
+        size_class == 0 ? 0 : tc_globals.sizemap().class_to_size(size_class);
+  }
+}
+
+absl::StatusOr<tcmalloc::malloc_tracing_extension::AllocationSiteTable>
+MallocTracingExtension_Internal_GetAllocationSiteStats() {
+  using tcmalloc::tcmalloc_internal::AllocatedBytes;
+  using tcmalloc::tcmalloc_internal::HashOfStackTrace;
+  using tcmalloc::tcmalloc_internal::SampledAllocation;
+  using tcmalloc::tcmalloc_internal::StackTrace;
+  tcmalloc::malloc_tracing_extension::AllocationSiteTable table;
+  constexpr float kSiteCountReserveFactor = 1.2;
+  constexpr int kMaxAttempts = 10;
+  for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+    size_t live_samples = 0;
+    tc_globals.sampled_allocation_recorder().Iterate(
+        [&live_samples](const SampledAllocation&) { ++live_samples; });
+    // As in GetAllocatedAddressRanges, all vector growth happens out here:
+    // allocating inside Iterate could sample and deadlock on the recorder.
+    table.sites.reserve(live_samples * kSiteCountReserveFactor + 1);
+    bool overflow = false;
+    tc_globals.sampled_allocation_recorder().Iterate(
+        [&](const SampledAllocation& sampled_allocation) {
+          if (table.sites.size() == table.sites.capacity()) {
+            overflow = true;
+            return;
+          }
+          const StackTrace& t = sampled_allocation.sampled_stack;
+          // Scale the sample to an estimate of actual usage, keeping the
+          // byte total a multiple of the object size as StackTraceTable
+          // does.
+          const uintptr_t bytes = AllocatedBytes(t) + 0.5;
+          const size_t count =
+              (bytes + t.allocated_size / 2) / t.allocated_size;
+          table.sites.push_back({HashOfStackTrace(t),
+                                 count * t.allocated_size, count});
+        });
+    if (!overflow) {
+      // Merge per-sample entries into one entry per site.
+      std::sort(table.sites.begin(), table.sites.end(),
+                [](const auto& a, const auto& b) {
+                  return a.site_id < b.site_id;
+                });
+      size_t out = 0;
+      for (size_t i = 0; i < table.sites.size(); ++i) {
+        if (out > 0 && table.sites[out - 1].site_id == table.sites[i].site_id) {
+          table.sites[out - 1].live_bytes += table.sites[i].live_bytes;
+          table.sites[out - 1].live_objects += table.sites[i].live_objects;
+        } else {
+          table.sites[out++] = table.sites[i];
+        }
+      }
+      table.sites.resize(out);
+      return table;
+    }
+    table.sites.clear();
+  }
+  return absl::InternalError(
+      "Could not snapshot all sampled allocations due to insufficient "
+      "reserved capacity in the output vector.");
+}
+
+absl::StatusOr<tcmalloc::malloc_tracing_extension::GrowthLedger>
+MallocTracingExtension_Internal_GetGrowthLedger() {
+  using tcmalloc::tcmalloc_internal::GrowthLedgerEntry;
+  using tcmalloc::tcmalloc_internal::kGrowthLedgerSize;
+  tcmalloc::malloc_tracing_extension::GrowthLedger ledger;
+  // Fixed-size snapshot under the system allocator's lock; conversion to
+  // heap-allocated strings and vectors happens out here.
+  std::vector<GrowthLedgerEntry> entries(kGrowthLedgerSize);
+  uint64_t total_events = 0;
+  const int n = tcmalloc::tcmalloc_internal::SystemGrowthLedgerSnapshot(
+      entries.data(), static_cast<int>(entries.size()), &total_events);
+  ledger.total_events = total_events;
+  ledger.events.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    const GrowthLedgerEntry& entry = entries[i];
+    tcmalloc::malloc_tracing_extension::GrowthEvent event;
+    event.timestamp_ns = entry.timestamp_ns;
+    event.start_addr = entry.start_addr;
+    event.bytes = entry.bytes;
+    event.tag = std::string(
+        tcmalloc::tcmalloc_internal::MemoryTagToLabel(entry.tag));
+    event.owner = entry.owner;
+    event.stack.reserve(entry.depth);
+    for (int j = 0; j < entry.depth; ++j) {
+      event.stack.push_back(reinterpret_cast<uintptr_t>(entry.stack[j]));
+    }
+    ledger.events.push_back(std::move(event));
+  }
+  return ledger;
+}
+
+int MallocTracingExtension_Internal_StartAllocationTrace(const char* path,
+                                                          int sample_interval) {
+  return tcmalloc::tcmalloc_internal::StartAllocationTrace(path,
+                                                           sample_interval);
+}
+
+int MallocTracingExtension_Internal_StopAllocationTrace() {
+  return tcmalloc::tcmalloc_internal::StopAllocationTrace();
+}
+
+void MallocTracingExtension_Internal_DrainAllocationTrace() {
+  tcmalloc::tcmalloc_internal::DrainAllocationTrace();
+}
+
+void MallocTracingExtension_Internal_GetAllocationTraceStats(
+    tcmalloc::malloc_tracing_extension::AllocationTraceStats* stats) {
+  const tcmalloc::tcmalloc_internal::AllocationTraceStats internal_stats =
+      tcmalloc::tcmalloc_internal::GetAllocationTraceStats();
+  stats->events_recorded = internal_stats.events_recorded;
+  stats->events_dropped = internal_stats.events_dropped;
+  stats->bytes_written = internal_stats.bytes_written;
+}
+
+namespace {
+
+// Heap layout snapshot format, version 1 (all integers little-endian):
+//   Header: the bytes 'T' 'C' 'H' 'L', uint16 version, uint16 reserved,
+//           uint32 page size in bytes, uint32 pages per hugepage.
+//   Records, each introduced by a uint8 type, until end of blob:
+//     1 (filler hugepage): uint64 start address, uint8 heap (0 = normal
+//       partition 0, 1 = normal partition 1, 2 = sampled, 3 = cold), uint8
+//       flags (bit 0 donated, bit 1 broken, bit 2 dense, bit 3
+//       short-lived), uint8 idle score, uint16 allocation count, uint16 run
+//       count, then per run uint16 first page, uint16 pages, uint8 state
+//       (0 = allocated, 1 = free, 2 = released).
+//     2 (huge region): uint64 start address, uint64 bytes, uint64 used
+//       pages, uint64 free pages, uint64 unmapped pages.
+//     3 (huge cache range): uint64 start address, uint64 bytes.
+// tools/heap_layout_viz.py is the reference reader.
+void AppendLE16(uint16_t v, std::string& out) {
+  out.push_back(static_cast<char>(v & 0xff));
+  out.push_back(static_cast<char>(v >> 8));
+}
+
+void AppendLE32(uint32_t v, std::string& out) {
+  AppendLE16(v & 0xffff, out);
+  AppendLE16(v >> 16, out);
+}
+
+void AppendLE64(uint64_t v, std::string& out) {
+  AppendLE32(v & 0xffffffff, out);
+  AppendLE32(v >> 32, out);
+}
+
+// Maps a heap's memory tag to the stable heap code serialized in hugepage
+// records; std::nullopt for heaps (metadata, say) the export skips.
+std::optional<uint8_t> HeapCodeForTag(
+    tcmalloc::tcmalloc_internal::MemoryTag tag) {
+  using tcmalloc::tcmalloc_internal::MemoryTag;
+  switch (tag) {
+    case MemoryTag::kNormalP0:
+      return 0;
+    case MemoryTag::kNormalP1:
+      return 1;
+    case MemoryTag::kSampled:
+      return 2;
+    case MemoryTag::kCold:
+      return 3;
+    default:
+      return std::nullopt;
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<std::string>
+MallocTracingExtension_Internal_GetHeapLayoutSnapshot() {
+  using tcmalloc::tcmalloc_internal::FillerHugePageLayout;
+  using tcmalloc::tcmalloc_internal::GetMemoryTag;
+  using tcmalloc::tcmalloc_internal::HugePage;
+  using tcmalloc::tcmalloc_internal::HugePageContaining;
+  using tcmalloc::tcmalloc_internal::HugeRange;
+  using tcmalloc::tcmalloc_internal::HugeRegionStats;
+  using tcmalloc::tcmalloc_internal::kPagesPerHugePage;
+  using tcmalloc::tcmalloc_internal::MemoryTag;
+  using tcmalloc::tcmalloc_internal::PageHeapSpinLockHolder;
+  using tcmalloc::tcmalloc_internal::PageId;
+
+  std::string blob;
+  blob.append("TCHL", 4);
+  AppendLE16(1, blob);
+  AppendLE16(0, blob);
+  AppendLE32(tcmalloc::tcmalloc_internal::GetPageSize(), blob);
+  AppendLE32(kPagesPerHugePage.raw_num(), blob);
+
+  // Filler hugepages: walk the pagemap the way the background idle scanner
+  // does, copying each tracker's layout under pageheap_lock and serializing
+  // with the lock dropped.
+  FillerHugePageLayout layout;
+  uintptr_t cursor = 0;
+  for (;;) {
+    const std::optional<PageId> next =
+        tc_globals.pagemap().NextSetPage(PageId{cursor});
+    if (!next.has_value()) break;
+    const HugePage hp = HugePageContaining(next->start_addr());
+    cursor = hp.first_page().index() + kPagesPerHugePage.raw_num();
+
+    const MemoryTag tag = GetMemoryTag(hp.start_addr());
+    const std::optional<uint8_t> heap = HeapCodeForTag(tag);
+    if (!heap.has_value()) continue;
+    // Cheap lock-free filter; the authoritative lookup below revalidates
+    // under the lock.
+    if (tc_globals.pagemap().TryGetHugepage(hp.first_page()) == nullptr) {
+      continue;
+    }
+    bool tracked;
+    {
+      PageHeapSpinLockHolder l;
+      tracked = tc_globals.page_allocator().GetFillerLayoutContaining(
+          hp.first_page(), tag, &layout);
+    }
+    if (!tracked) continue;
+
+    blob.push_back(1);
+    AppendLE64(layout.start_addr, blob);
+    blob.push_back(static_cast<char>(*heap));
+    blob.push_back(static_cast<char>(
+        (layout.donated ? 1 : 0) | (layout.unbroken ? 0 : 2) |
+        (layout.dense ? 4 : 0) | (layout.short_lived ? 8 : 0)));
+    blob.push_back(static_cast<char>(layout.idle_score));
+    AppendLE16(layout.nallocs, blob);
+    AppendLE16(layout.num_runs, blob);
+    for (size_t i = 0; i < layout.num_runs; ++i) {
+      AppendLE16(layout.runs[i].start_page, blob);
+      AppendLE16(layout.runs[i].num_pages, blob);
+      blob.push_back(static_cast<char>(layout.runs[i].state));
+    }
+  }
+
+  // Region and cache counts can grow between the sizing and copying calls;
+  // as in GetAllocatedAddressRanges, all vector growth happens with the
+  // lock dropped and undersized copies retry.
+  constexpr int kMaxAttempts = 10;
+  std::vector<HugeRegionStats> regions(16);
+  for (int attempt = 0;; ++attempt) {
+    size_t total;
+    {
+      PageHeapSpinLockHolder l;
+      total = tc_globals.page_allocator().GetHugeRegionStats(regions.data(),
+                                                             regions.size());
+    }
+    if (total <= regions.size()) {
+      regions.resize(total);
+      break;
+    }
+    if (attempt == kMaxAttempts - 1) {
+      return absl::InternalError(
+          "Could not snapshot all huge regions due to insufficient reserved "
+          "capacity in the output vector.");
+    }
+    regions.resize(total + total / 4 + 1);
+  }
+  for (const HugeRegionStats& region : regions) {
+    blob.push_back(2);
+    AppendLE64(reinterpret_cast<uintptr_t>(region.location.start_addr()),
+               blob);
+    AppendLE64(region.location.byte_len(), blob);
+    AppendLE64(region.used_pages.raw_num(), blob);
+    AppendLE64(region.free_pages.raw_num(), blob);
+    AppendLE64(region.unmapped_pages.raw_num(), blob);
+  }
+
+  std::vector<HugeRange> cache_ranges(16);
+  for (int attempt = 0;; ++attempt) {
+    size_t total;
+    {
+      PageHeapSpinLockHolder l;
+      total = tc_globals.page_allocator().GetHugeCacheRanges(
+          cache_ranges.data(), cache_ranges.size());
+    }
+    if (total <= cache_ranges.size()) {
+      cache_ranges.resize(total);
+      break;
+    }
+    if (attempt == kMaxAttempts - 1) {
+      return absl::InternalError(
+          "Could not snapshot the huge cache due to insufficient reserved "
+          "capacity in the output vector.");
+    }
+    cache_ranges.resize(total + total / 4 + 1);
+  }
+  for (const HugeRange& range : cache_ranges) {
+    blob.push_back(3);
+    AppendLE64(reinterpret_cast<uintptr_t>(range.start_addr()), blob);
+    AppendLE64(range.byte_len(), blob);
+  }
+
+  return blob;
+}
+
 //-------------------------------------------------------------------
 // Exported routines
 //-------------------------------------------------------------------
@@ -1116,6 +2299,106 @@ extern "C" ABSL_CACHELINE_ALIGNED ABSL_ATTRIBUTE_SECTION(google_malloc)
                               .SizeReturning(),
                           size);
 }
+
+extern "C" ABSL_CACHELINE_ALIGNED ABSL_ATTRIBUTE_SECTION(google_malloc)
+    tcmalloc::sized_class_ptr_t
+    tcmalloc_size_returning_alloc_at_least(size_t min_size) noexcept {
+  tc_globals.InitIfNecessary();
+  size_t size_class;
+  if (ABSL_PREDICT_TRUE(tc_globals.sizemap().GetSizeClass(
+                            MallocPolicy(), min_size, &size_class) &&
+                        size_class != 0)) {
+    // Round up past the smallest fitting class while the larger class's
+    // capacity stays within 25% of min_size.  Size classes within a NUMA
+    // partition have contiguous indices with strictly increasing sizes, so
+    // the largest class not exceeding `allowed` is either the class that
+    // GetSizeClass picks for `allowed` or its immediate predecessor.
+    const size_t allowed = min_size + min_size / 4;
+    size_t upper_class;
+    if (tc_globals.sizemap().GetSizeClass(MallocPolicy(), allowed,
+                                          &upper_class) &&
+        upper_class != 0) {
+      if (tc_globals.sizemap().class_to_size(upper_class) > allowed &&
+          upper_class > size_class) {
+        --upper_class;
+      }
+      if (upper_class > size_class) size_class = upper_class;
+    }
+    const size_t size = tc_globals.sizemap().class_to_size(size_class);
+    void* p = MallocExtension_Internal_AllocOfSizeClass(size_class, size);
+    if (p == nullptr) return {nullptr, 0, 0};
+    return {p, size, size_class};
+  }
+  // No small size class fits: page-level allocations already return their
+  // full page-aligned capacity.
+  const tcmalloc::sized_ptr_t res =
+      fast_alloc(MallocPolicy().SizeReturning(), min_size);
+  return {res.p, res.n, 0};
+}
+
+extern "C" ABSL_CACHELINE_ALIGNED ABSL_ATTRIBUTE_SECTION(google_malloc) int
+    tcmalloc_bulk_alloc(size_t size, void** out, int n) noexcept {
+  if (ABSL_PREDICT_FALSE(n <= 0)) return 0;
+  int i = 0;
+  size_t size_class;
+  // The batched fast path handles neither sampling nor hooks; when either
+  // triggers (or per-cpu mode is inactive), the per-object path below picks up
+  // the remainder of the batch.
+  if (ABSL_PREDICT_TRUE(
+          tc_globals.sizemap().GetSizeClass(MallocPolicy(), size,
+                                            &size_class) &&
+          size_class != 0 &&
+          !tcmalloc::tcmalloc_internal::Static::HaveHooks() &&
+          UsePerCpuCache(tc_globals) &&
+          (!MallocPolicy::do_sampling() ||
+           GetThreadSampler()->TryRecordAllocationFast(size * n)))) {
+    i = static_cast<int>(tc_globals.cpu_cache().AllocateBatch(
+        size_class, out, static_cast<size_t>(n)));
+    if (ABSL_PREDICT_TRUE(i == n)) return n;
+  }
+  for (; i < n; ++i) {
+    void* ptr = fast_alloc(MallocPolicy(), size);
+    if (ABSL_PREDICT_FALSE(ptr == nullptr)) break;
+    out[i] = ptr;
+  }
+  return i;
+}
+
+extern "C" ABSL_CACHELINE_ALIGNED ABSL_ATTRIBUTE_SECTION(google_malloc) void
+    tcmalloc_bulk_free(void** ptrs, int n) noexcept {
+  if (ABSL_PREDICT_FALSE(n <= 0)) return;
+  ASSERT(tc_globals.IsInited());
+  const bool batched = !tcmalloc::tcmalloc_internal::Static::HaveHooks() &&
+                       UsePerCpuCache(tc_globals);
+  int i = 0;
+  while (i < n) {
+    void* ptr = ptrs[i];
+    if (ABSL_PREDICT_FALSE(ptr == nullptr)) {
+      ++i;
+      continue;
+    }
+    const size_t size_class = tc_globals.pagemap().sizeclass(
+        tcmalloc::tcmalloc_internal::PageIdContaining(ptr));
+    if (ABSL_PREDICT_FALSE(size_class == 0 || !batched)) {
+      // Large, sampled, or hooks/per-thread mode: pay the full path.
+      do_free(ptr);
+      ++i;
+      continue;
+    }
+    // Extend the run of pointers that share this size class; each pagemap
+    // lookup is made exactly once per pointer.
+    int j = i + 1;
+    while (j < n && ptrs[j] != nullptr &&
+           tc_globals.pagemap().sizeclass(
+               tcmalloc::tcmalloc_internal::PageIdContaining(ptrs[j])) ==
+               size_class) {
+      ++j;
+    }
+    tc_globals.cpu_cache().DeallocateBatch(size_class, ptrs + i,
+                                           static_cast<size_t>(j - i));
+    i = j;
+  }
+}
 #endif  // !TCMALLOC_INTERNAL_METHODS_ONLY
 
 extern "C" ABSL_CACHELINE_ALIGNED void* TCMallocInternalMemalign(
@@ -1186,6 +2469,28 @@ static inline ABSL_ATTRIBUTE_ALWAYS_INLINE void* do_realloc(void* old_ptr,
   if ((new_size > old_size) || (new_size < upper_bound_to_shrink) ||
       will_sample ||
       tc_globals.guardedpage_allocator().PointerIsMine(old_ptr)) {
+    // Growing a page-backed span: try to extend it in place by claiming free
+    // pages adjacent to it before falling back to allocate-and-copy.  Skip
+    // sampled spans so that the recorded allocation size stays accurate.
+    if (new_size > old_size && !will_sample &&
+        !tc_globals.guardedpage_allocator().PointerIsMine(old_ptr)) {
+      const tcmalloc::tcmalloc_internal::PageId p =
+          tcmalloc::tcmalloc_internal::PageIdContaining(old_ptr);
+      if (tc_globals.pagemap().sizeclass(p) == 0) {
+        tcmalloc::tcmalloc_internal::Span* span =
+            tc_globals.pagemap().GetExistingDescriptor(p);
+        if (span != nullptr && !span->sampled()) {
+          const tcmalloc::tcmalloc_internal::PageHeapSpinLockHolder l;
+          if (tc_globals.page_allocator().GrowSpanInPlace(
+                  span, tcmalloc::tcmalloc_internal::BytesToLengthCeil(
+                            alloc_size),
+                  tcmalloc::tcmalloc_internal::GetMemoryTag(old_ptr))) {
+            return old_ptr;
+          }
+        }
+      }
+    }
+
     // Need to reallocate.
     void* new_ptr = nullptr;
 
@@ -1310,6 +2615,13 @@ extern "C" ABSL_CACHELINE_ALIGNED void TCMallocInternalFreeAlignedSized(
   do_free_with_size(ptr, size, AlignAsPolicy(align));
 }
 
+#ifdef TCMALLOC_UNCHECKED_FREE
+extern "C" ABSL_CACHELINE_ALIGNED void tcmalloc_free_sized_unchecked(
+    void* ptr, size_t size_class) noexcept {
+  tcmalloc::tcmalloc_internal::do_free_unchecked(ptr, size_class);
+}
+#endif  // TCMALLOC_UNCHECKED_FREE
+
 extern "C" void TCMallocInternalCfree(void* ptr) noexcept
     TCMALLOC_ALIAS(TCMallocInternalFree);
 
@@ -100,6 +100,22 @@ ABSL_ATTRIBUTE_UNUSED int TCMallocInternalMallocInfo(int opts,
 ABSL_ATTRIBUTE_UNUSED size_t TCMallocInternalMallocSize(void* ptr) noexcept
     ABSL_ATTRIBUTE_SECTION(google_malloc);
 
+#ifdef TCMALLOC_UNCHECKED_FREE
+// Expert-only, compiled in when the build defines TCMALLOC_UNCHECKED_FREE.
+//
+// Frees <ptr> as an object of <size_class> (see size_class_rounding.h for
+// computing classes at compile time), pushing it straight to the per-cpu
+// slab with no tag dispatch, pagemap confirmation, or hardened checks.
+// The caller vouches that ptr came from this allocator, that it is a small
+// normal or cold allocation of exactly that class, and that it was not
+// sampled or guarded (e.g. allocated with profile sampling suppressed).
+// Debug builds re-validate every one of these promises; release builds
+// corrupt the heap if any of them is broken.
+ABSL_ATTRIBUTE_UNUSED void tcmalloc_free_sized_unchecked(
+    void* ptr, size_t size_class) noexcept
+    ABSL_ATTRIBUTE_SECTION(google_malloc);
+#endif  // TCMALLOC_UNCHECKED_FREE
+
 #ifdef __cplusplus
 ABSL_ATTRIBUTE_UNUSED void* TCMallocInternalNew(size_t size)
     ABSL_ATTRIBUTE_SECTION(google_malloc);
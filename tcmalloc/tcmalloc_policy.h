@@ -63,6 +63,14 @@
 //     static bool invoke_hooks();
 //   };
 //
+// - Sampling policy
+//   dictates participation in allocation sampling
+//
+//   struct SamplingPolicyTemplate {
+//     // Returns true if allocations may be sampled.
+//     static bool do_sampling();
+//   };
+//
 // - NUMA partition policy
 //   When NUMA awareness is enabled this dictates which NUMA partition we will
 //   allocate memory from. Must be trivially copyable.
@@ -76,6 +84,23 @@
 //     // NUMA partition to allocate from.
 //     size_t scaled_partition() const;
 //   };
+//
+// - Static hooks policy
+//   Compile-time registered accounting callbacks, invoked inline from the
+//   allocation and deallocation paths as direct calls.  Unlike the dynamic
+//   allocation hooks (HooksPolicy above), these add no indirection and the
+//   default empty policy folds away entirely.
+//
+//   struct StaticHooksPolicyTemplate {
+//     // Returns true if the callbacks do anything; call sites use this to
+//     // skip computing callback arguments.
+//     static constexpr bool enabled();
+//
+//     // Invoked with the requested size and the resolved size class
+//     // (0 for page-level allocations).
+//     static void on_allocate(size_t size, size_t size_class);
+//     static void on_deallocate(size_t size, size_t size_class);
+//   };
 
 #ifndef TCMALLOC_TCMALLOC_POLICY_H_
 #define TCMALLOC_TCMALLOC_POLICY_H_
@@ -191,6 +216,65 @@ struct NoHooksPolicy {
   static constexpr bool invoke_hooks() { return false; }
 };
 
+// MaybeSampledPolicy: allocations pass through the thread sampler
+struct MaybeSampledPolicy {
+  static constexpr bool do_sampling() { return true; }
+};
+
+// UnsampledPolicy: allocations bypass the thread sampler entirely, removing
+// the per-thread counter update and its branch from the fast path.  Such
+// allocations produce no heap profiles, no GWP-ASan coverage, and no
+// per-thread allocated-bytes accounting.
+struct UnsampledPolicy {
+  static constexpr bool do_sampling() { return false; }
+};
+
+// Binaries built with TCMALLOC_INTERNAL_DISABLE_SAMPLING opt out of
+// allocation sampling wholesale at compile time; this is intended for
+// latency-critical binaries that never enable profiling.
+#ifdef TCMALLOC_INTERNAL_DISABLE_SAMPLING
+using DefaultSamplingPolicy = UnsampledPolicy;
+#else
+using DefaultSamplingPolicy = MaybeSampledPolicy;
+#endif
+
+#ifdef TCMALLOC_STATIC_ALLOCATION_HOOKS
+extern "C" {
+// Binaries built with TCMALLOC_STATIC_ALLOCATION_HOOKS must define these two
+// functions; they become the default static hooks policy and are invoked
+// inline from the allocation and deallocation fast paths as direct calls.
+// They run under malloc entry points: they must be fast, must not allocate,
+// and must not re-enter malloc.
+void TCMalloc_StaticAllocHook(size_t size, size_t size_class);
+void TCMalloc_StaticDeallocHook(size_t size, size_t size_class);
+}
+#endif
+
+// NoStaticHooksPolicy: no compile-time accounting callbacks; everything
+// folds away.
+struct NoStaticHooksPolicy {
+  static constexpr bool enabled() { return false; }
+  static constexpr void on_allocate(size_t, size_t) {}
+  static constexpr void on_deallocate(size_t, size_t) {}
+};
+
+#ifdef TCMALLOC_STATIC_ALLOCATION_HOOKS
+// EmbedderStaticHooksPolicy: forwards to the embedder-defined hook
+// functions declared above.
+struct EmbedderStaticHooksPolicy {
+  static constexpr bool enabled() { return true; }
+  static void on_allocate(size_t size, size_t size_class) {
+    TCMalloc_StaticAllocHook(size, size_class);
+  }
+  static void on_deallocate(size_t size, size_t size_class) {
+    TCMalloc_StaticDeallocHook(size, size_class);
+  }
+};
+using DefaultStaticHooksPolicy = EmbedderStaticHooksPolicy;
+#else
+using DefaultStaticHooksPolicy = NoStaticHooksPolicy;
+#endif
+
 // IsSizeReturningPolicy: Allocation returns size externally
 struct IsSizeReturningPolicy {
   using pointer_type = sized_ptr_t;
@@ -254,7 +338,9 @@ template <typename OomPolicy = CppOomPolicy,
           typename AccessPolicy = DefaultAllocationAccessPolicy,
           typename HooksPolicy = InvokeHooksPolicy,
           typename SizeReturningPolicy = NonSizeReturningPolicy,
-          typename NumaPolicy = LocalNumaPartitionPolicy>
+          typename NumaPolicy = LocalNumaPartitionPolicy,
+          typename SamplingPolicy = DefaultSamplingPolicy,
+          typename StaticHooksPolicy = DefaultStaticHooksPolicy>
 class TCMallocPolicy {
  public:
   // Size returning / pointer type
@@ -288,6 +374,20 @@ class TCMallocPolicy {
   // Hooks policy
   static constexpr bool invoke_hooks() { return HooksPolicy::invoke_hooks(); }
 
+  // Sampling policy
+  static constexpr bool do_sampling() { return SamplingPolicy::do_sampling(); }
+
+  // Static hooks policy
+  static constexpr bool has_static_hooks() {
+    return StaticHooksPolicy::enabled();
+  }
+  static void on_allocate(size_t size, size_t size_class) {
+    StaticHooksPolicy::on_allocate(size, size_class);
+  }
+  static void on_deallocate(size_t size, size_t size_class) {
+    StaticHooksPolicy::on_deallocate(size, size_class);
+  }
+
   // Size returning functions
   static constexpr bool size_returning() {
     return SizeReturningPolicy::size_returning();
@@ -302,60 +402,82 @@ class TCMallocPolicy {
   // Returns this policy aligned as 'align'
   template <typename align_t>
   constexpr TCMallocPolicy<OomPolicy, AlignAsPolicy, AccessPolicy, HooksPolicy,
-                           SizeReturningPolicy, NumaPolicy>
+                           SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                           StaticHooksPolicy>
   AlignAs(align_t align) const {
     return TCMallocPolicy<OomPolicy, AlignAsPolicy, AccessPolicy, HooksPolicy,
-                          SizeReturningPolicy, NumaPolicy>(AlignAsPolicy{align},
-                                                           numa_);
+                          SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                          StaticHooksPolicy>(AlignAsPolicy{align}, numa_);
   }
 
   // Returns this policy for frequent access
   constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AllocationAccessHotPolicy,
-                           HooksPolicy, SizeReturningPolicy, NumaPolicy>
+                           HooksPolicy, SizeReturningPolicy, NumaPolicy,
+                           SamplingPolicy, StaticHooksPolicy>
   AccessAsHot() const {
     return TCMallocPolicy<OomPolicy, AlignPolicy, AllocationAccessHotPolicy,
-                          HooksPolicy, SizeReturningPolicy, NumaPolicy>(align_,
-                                                                        numa_);
+                          HooksPolicy, SizeReturningPolicy, NumaPolicy,
+                          SamplingPolicy, StaticHooksPolicy>(align_, numa_);
   }
 
   // Returns this policy for infrequent access
   constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AllocationAccessColdPolicy,
-                           HooksPolicy, SizeReturningPolicy, NumaPolicy>
+                           HooksPolicy, SizeReturningPolicy, NumaPolicy,
+                           SamplingPolicy, StaticHooksPolicy>
   AccessAsCold() const {
     return TCMallocPolicy<OomPolicy, AlignPolicy, AllocationAccessColdPolicy,
-                          HooksPolicy, SizeReturningPolicy, NumaPolicy>(align_,
-                                                                        numa_);
+                          HooksPolicy, SizeReturningPolicy, NumaPolicy,
+                          SamplingPolicy, StaticHooksPolicy>(align_, numa_);
   }
 
   // Returns this policy with a nullptr OOM policy.
   constexpr TCMallocPolicy<NullOomPolicy, AlignPolicy, AccessPolicy,
-                           HooksPolicy, SizeReturningPolicy, NumaPolicy>
+                           HooksPolicy, SizeReturningPolicy, NumaPolicy,
+                           SamplingPolicy, StaticHooksPolicy>
   Nothrow() const {
     return TCMallocPolicy<NullOomPolicy, AlignPolicy, AccessPolicy, HooksPolicy,
-                          SizeReturningPolicy, NumaPolicy>(align_, numa_);
+                          SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                          StaticHooksPolicy>(align_, numa_);
   }
 
   // Returns this policy with NewAllocHook invocations disabled.
   constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, NoHooksPolicy,
-                           SizeReturningPolicy, NumaPolicy>
+                           SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                           StaticHooksPolicy>
   WithoutHooks() const {
     return TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, NoHooksPolicy,
-                          SizeReturningPolicy, NumaPolicy>(align_, numa_);
+                          SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                          StaticHooksPolicy>(align_, numa_);
   }
 
   constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, HooksPolicy,
-                           IsSizeReturningPolicy, NumaPolicy>
+                           IsSizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                           StaticHooksPolicy>
   SizeReturning() const {
     return TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, HooksPolicy,
-                          IsSizeReturningPolicy, NumaPolicy>(align_, numa_);
+                          IsSizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                          StaticHooksPolicy>(align_, numa_);
+  }
+
+  // Returns this policy with the compile-time static hooks suppressed, for
+  // internal allocations that should not be reported to the embedder.
+  constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, HooksPolicy,
+                           SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                           NoStaticHooksPolicy>
+  WithoutStaticHooks() const {
+    return TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, HooksPolicy,
+                          SizeReturningPolicy, NumaPolicy, SamplingPolicy,
+                          NoStaticHooksPolicy>(align_, numa_);
   }
 
   // Returns this policy with a fixed NUMA partition.
   constexpr TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, NoHooksPolicy,
-                           SizeReturningPolicy, FixedNumaPartitionPolicy>
+                           SizeReturningPolicy, FixedNumaPartitionPolicy,
+                           SamplingPolicy, StaticHooksPolicy>
   InNumaPartition(size_t partition) const {
     return TCMallocPolicy<OomPolicy, AlignPolicy, AccessPolicy, NoHooksPolicy,
-                          SizeReturningPolicy, FixedNumaPartitionPolicy>(
+                          SizeReturningPolicy, FixedNumaPartitionPolicy,
+                          SamplingPolicy, StaticHooksPolicy>(
         align_, FixedNumaPartitionPolicy{partition});
   }
 
@@ -33,6 +33,7 @@
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/static_vars.h"
 #include "tcmalloc/testing/testutil.h"
 
 namespace deallocationz = tcmalloc::deallocationz;
@@ -769,4 +770,62 @@ TEST(LifetimeProfiler, LifetimeBucketing) {
   EXPECT_EQ(absl::Nanoseconds(34000000), BucketizeDuration(34200040));
 }
 
+TEST(LifetimeProfiler, StreamingFlushesCompletedRecords) {
+  if (CheckerIsActive()) {
+    return;
+  }
+
+  constexpr int64_t kMallocSize = 4 * 1024 * 1024;
+  constexpr int kNumAllocations = 100;
+
+  // Avoid unsample-related behavior
+  tcmalloc::ScopedProfileSamplingRate test_sample_rate(1);
+
+  struct FlushState {
+    int64_t records = 0;
+    int64_t matching_count = 0;
+    int64_t matching_sum = 0;
+    bool saw_empty_stack = false;
+    bool saw_zero_lifetime = false;
+  } state;
+
+  // The callback runs on the deallocating thread with profiler-internal locks
+  // held and must not allocate, so only bump plain counters.
+  auto flush = +[](void *arg, const deallocationz::LifetimeBucketRecord &r) {
+    auto &s = *static_cast<FlushState *>(arg);
+    s.records++;
+    if (r.requested_size == kMallocSize) {
+      s.matching_count += r.count;
+      s.matching_sum += r.sum;
+    }
+    if (r.depth == 0) {
+      s.saw_empty_stack = true;
+    }
+    if (r.lifetime <= absl::ZeroDuration()) {
+      s.saw_zero_lifetime = true;
+    }
+  };
+
+  deallocationz::StreamingDeallocationSample sample(
+      &tcmalloc::tcmalloc_internal::tc_globals.deallocation_samples, flush,
+      &state);
+
+  for (int i = 0; i < kNumAllocations; i++) {
+    void *ptr = SingleAlloc(2, kMallocSize);
+    absl::SleepFor(absl::Microseconds(100));
+    SingleDealloc(3, ptr);
+  }
+
+  // Stop flushes all pending buckets; the allocations above share a stack and
+  // lifetime bucket, so they arrive aggregated rather than one per free.
+  sample.Stop();
+
+  EXPECT_GT(state.records, 0);
+  EXPECT_GT(state.matching_count, 0);
+  // Reported bytes are a multiple of the (rounded-up) object size.
+  EXPECT_GE(state.matching_sum, state.matching_count * kMallocSize);
+  EXPECT_FALSE(state.saw_empty_stack);
+  EXPECT_FALSE(state.saw_zero_lifetime);
+}
+
 }  // namespace
@@ -0,0 +1,131 @@
+// Copyright 2026 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Enforces a byte-size budget on the allocator's fast-path entry points.
+//
+// The fast_path.*.golden files pin the exact instruction mix of these
+// functions, but they are regenerated when the sequence changes, so nothing
+// stops the fast path from growing one accepted regression at a time.  This
+// test measures the compiled size of each entry point from the test binary's
+// own symbol table and fails when one outgrows its budget, making front-end
+// (I-cache/decode) growth an explicit decision rather than a side effect.
+//
+// The budgets are deliberately loose -- a couple of cache lines per entry --
+// so they do not flake across compiler versions; they exist to catch a
+// feature check landing on the fast path, which costs tens of bytes at once.
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/internal/config.h"
+
+namespace tcmalloc {
+namespace {
+
+struct EntryBudget {
+  const char* symbol;
+  size_t budget_bytes;
+};
+
+// Allocation entries carry the size-class lookup, the sampling counter
+// update, and the per-CPU push, plus their out-of-line slow-path trampolines;
+// free entries are shorter.  Budgets are in bytes of machine code.
+constexpr EntryBudget kEntries[] = {
+    {"TCMallocInternalMalloc", 512},
+    {"TCMallocInternalNew", 512},
+    {"TCMallocInternalNewNothrow", 512},
+    {"TCMallocInternalFree", 384},
+    {"TCMallocInternalSdallocx", 384},
+    {"TCMallocInternalDeleteSized", 384},
+    {"TCMallocInternalDeleteSizedAligned", 384},
+};
+
+// Looks up st_size for each entry in the binary's .symtab.  Returns false if
+// the binary has no symbol table (e.g. it was stripped).
+bool ReadSymbolSizes(size_t sizes[], size_t count) {
+  int fd = open("/proc/self/exe", O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  void* image = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) return false;
+
+  const char* base = static_cast<const char*>(image);
+  const ElfW(Ehdr)* ehdr = reinterpret_cast<const ElfW(Ehdr)*>(base);
+  const ElfW(Shdr)* shdrs =
+      reinterpret_cast<const ElfW(Shdr)*>(base + ehdr->e_shoff);
+
+  bool found_symtab = false;
+  for (int i = 0; i < ehdr->e_shnum; ++i) {
+    if (shdrs[i].sh_type != SHT_SYMTAB) continue;
+    found_symtab = true;
+    const ElfW(Sym)* syms =
+        reinterpret_cast<const ElfW(Sym)*>(base + shdrs[i].sh_offset);
+    const size_t num_syms = shdrs[i].sh_size / sizeof(ElfW(Sym));
+    const char* strtab = base + shdrs[shdrs[i].sh_link].sh_offset;
+    for (size_t s = 0; s < num_syms; ++s) {
+      if (ELF64_ST_TYPE(syms[s].st_info) != STT_FUNC) continue;
+      const char* name = strtab + syms[s].st_name;
+      for (size_t e = 0; e < count; ++e) {
+        if (strcmp(name, kEntries[e].symbol) == 0) {
+          sizes[e] = syms[s].st_size;
+        }
+      }
+    }
+  }
+  munmap(image, st.st_size);
+  return found_symtab;
+}
+
+TEST(FastPathBudgetTest, EntryPointsFitBudget) {
+#ifndef NDEBUG
+  GTEST_SKIP() << "assertions inflate the fast path in debug builds";
+#endif
+#if defined(ABSL_HAVE_ADDRESS_SANITIZER) || \
+    defined(ABSL_HAVE_MEMORY_SANITIZER) || defined(ABSL_HAVE_THREAD_SANITIZER)
+  GTEST_SKIP() << "sanitizers instrument the fast path";
+#endif
+
+  constexpr size_t kNumEntries = sizeof(kEntries) / sizeof(kEntries[0]);
+  size_t sizes[kNumEntries] = {};
+  if (!ReadSymbolSizes(sizes, kNumEntries)) {
+    GTEST_SKIP() << "no symbol table in test binary";
+  }
+
+  for (size_t e = 0; e < kNumEntries; ++e) {
+    // A zero size means the symbol was aliased away or renamed; surface that
+    // too, since the budget silently stops applying otherwise.
+    EXPECT_GT(sizes[e], 0) << kEntries[e].symbol << " not found";
+    EXPECT_LE(sizes[e], kEntries[e].budget_bytes)
+        << kEntries[e].symbol << " is " << sizes[e]
+        << " bytes; the fast path grew past its budget.  If the growth is "
+           "intentional, raise the budget in this test alongside the "
+           "regenerated fast_path golden files.";
+  }
+}
+
+}  // namespace
+}  // namespace tcmalloc
@@ -70,6 +70,15 @@ TEST_F(GetStatsTest, Pbtxt) {
                   R"(num_spans_requested:\s\d+\s*num_spans_returned:\s\d+\s*)",
                   R"(obj_capacity:\s\d+\s*)")));
 #endif  // defined(GTEST_USES_PCRE)
+#ifndef TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+  // Sampled requested-vs-granted columns joined into each freelist entry.
+  EXPECT_THAT(buf, ContainsRegex(R"(sampled_requested_bytes: [0-9]+)"));
+  EXPECT_THAT(buf, ContainsRegex(R"(sampled_granted_bytes: [0-9]+)"));
+#endif  // !TCMALLOC_INTERNAL_SMALL_BUT_SLOW
+
+  EXPECT_THAT(MallocExtension::GetStats(),
+              HasSubstr("Internal fragmentation by size class"));
+
   EXPECT_THAT(buf, AnyOf(HasSubstr(R"(page_heap {)"),
                          HasSubstr(R"(huge_page_aware {)")));
   EXPECT_THAT(buf, HasSubstr(R"(gwp_asan {)"));
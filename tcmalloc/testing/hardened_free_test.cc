@@ -0,0 +1,73 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for the hardened free-path validation tier
+// (Parameters::hardened_free_checks): invalid frees that the unchecked
+// release build would let corrupt the freelists must crash instead.
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "gtest/gtest.h"
+#include "tcmalloc/internal/parameter_accessors.h"
+#include "tcmalloc/testing/testutil.h"
+
+namespace tcmalloc {
+namespace {
+
+class HardenedFreeTest : public testing::Test {
+ protected:
+  void SetUp() override { TCMalloc_Internal_SetHardenedFreeChecks(true); }
+  void TearDown() override { TCMalloc_Internal_SetHardenedFreeChecks(false); }
+};
+
+TEST_F(HardenedFreeTest, MismatchedSizedDeleteCrashes) {
+  void* ptr = ::operator new(32);
+  EXPECT_DEATH(::operator delete(ptr, 4096), "");
+  ::operator delete(ptr, 32);
+}
+
+TEST_F(HardenedFreeTest, InteriorPointerFreeCrashes) {
+  // 8 bytes into a 128-byte object is 8-byte aligned, so the unchecked path
+  // would accept it; the boundary check requires 128-byte alignment.
+  void* ptr = malloc(128);
+  EXPECT_DEATH(free(static_cast<char*>(ptr) + 8), "");
+  free(ptr);
+}
+
+TEST_F(HardenedFreeTest, SampledDoubleFreeCrashes) {
+  void* ptr;
+  {
+    // Sample every allocation so ptr lands on the sampled heap, but restore
+    // the normal rate before freeing so the span's pages are unlikely to be
+    // re-used by another sampled allocation before the second free.
+    ScopedProfileSamplingRate sampling_rate(1);
+    ptr = ::operator new(1 << 20);
+  }
+  ::operator delete(ptr);
+  EXPECT_DEATH(::operator delete(ptr), "[Dd]ouble free");
+}
+
+TEST_F(HardenedFreeTest, ValidFreesPass) {
+  for (size_t size : {8u, 57u, 128u, 4096u, 1u << 20}) {
+    void* ptr = ::operator new(size);
+    ::operator delete(ptr, size);
+    ptr = malloc(size);
+    free(ptr);
+  }
+}
+
+}  // namespace
+}  // namespace tcmalloc
@@ -15,6 +15,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h>
 
 #include <functional>
@@ -209,6 +210,52 @@ TEST(HeapProfilingTest, CheckResidency) {
   }
 }
 
+TEST(HeapProfilingTest, NumaNodeLabels) {
+  ScopedProfileSamplingRate s(1);
+  constexpr size_t kSize = 256 * 1024;
+  void* ptr = ::operator new(kSize);
+  // Touch the allocation so the sampled span is resident and move_pages(2)
+  // can report a backing node for it.
+  memset(ptr, 0x21, kSize);
+
+  auto converted_or = tcmalloc_internal::MakeProfileProto(
+      MallocExtension::SnapshotCurrent(ProfileType::kHeap));
+  ASSERT_TRUE(converted_or.ok());
+  const auto& converted = **converted_or;
+
+  std::optional<int> allocating_numa_node_id;
+  std::optional<int> backing_numa_node_id;
+  for (int i = 0, n = converted.string_table().size(); i < n; ++i) {
+    if (converted.string_table(i) == "allocating_numa_node") {
+      allocating_numa_node_id = i;
+    } else if (converted.string_table(i) == "backing_numa_node") {
+      backing_numa_node_id = i;
+    }
+  }
+  ASSERT_TRUE(allocating_numa_node_id.has_value());
+  ASSERT_TRUE(backing_numa_node_id.has_value());
+
+  // Every Linux kernel reports at least node 0, so we expect samples carrying
+  // both labels with non-negative nodes.
+  bool saw_allocating_node = false;
+  bool saw_backing_node = false;
+  for (const auto& sample : converted.sample()) {
+    for (const auto& label : sample.label()) {
+      if (label.key() == allocating_numa_node_id) {
+        EXPECT_GE(label.num(), 0);
+        saw_allocating_node = true;
+      } else if (label.key() == backing_numa_node_id) {
+        EXPECT_GE(label.num(), 0);
+        saw_backing_node = true;
+      }
+    }
+  }
+  EXPECT_TRUE(saw_allocating_node);
+  EXPECT_TRUE(saw_backing_node);
+
+  ::operator delete(ptr);
+}
+
 // Make sure users can allocate when iterating over the heap samples. For now
 // `MallocExtension::SnapshotCurrent()` uses `StackTraceTable` to make a copy of
 // the sampled allocations from `tc_globals.sampled_allocation_recorder()` and
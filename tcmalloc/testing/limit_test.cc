@@ -62,6 +62,7 @@ class LimitTest : public ::testing::Test {
   void LimitChangeTriggersReleaseSmallAllocs();
   void LimitRespected();
   void ExceedingSoftLimitDoesntCrashWithHardLimit();
+  void ReservePoolCarvesHeadroom();
 
   void ReleaseMemory() {
     MallocExtension::SetMemoryLimit(0, MallocExtension::LimitKind::kSoft);
@@ -499,5 +500,65 @@ TEST_F(LimitTest, ExceedingSoftLimitDoesntCrashWithHardLimit) {
               testing::ExitedWithCode(0), "");
 }
 
+TEST_F(LimitTest, ReservePoolBookkeeping) {
+  constexpr size_t kMiB = 1 << 20;
+  int pool = MallocExtension::CreateReservePool(32 * kMiB);
+  ASSERT_GE(pool, 0);
+  // Draws are granted until the pool runs dry.
+  EXPECT_EQ(MallocExtension::AcquireFromReservePool(pool, 20 * kMiB),
+            20 * kMiB);
+  EXPECT_EQ(MallocExtension::AcquireFromReservePool(pool, 20 * kMiB),
+            12 * kMiB);
+  EXPECT_EQ(MallocExtension::AcquireFromReservePool(pool, 1), 0);
+  EXPECT_TRUE(MallocExtension::DestroyReservePool(pool));
+  // The handle is dead once destroyed.
+  EXPECT_FALSE(MallocExtension::DestroyReservePool(pool));
+  EXPECT_EQ(MallocExtension::AcquireFromReservePool(pool, 1), 0);
+}
+
+void LimitTest::ReservePoolCarvesHeadroom() {
+  // Needed to see what expectation failed (if any).
+  testing::UnitTest::GetInstance()->listeners().SuppressEventForwarding(false);
+
+  constexpr size_t kMiB = 1 << 20;
+  const size_t used = physical_memory_used();
+  // A soft limit well above current usage, with half the slack reserved.
+  MallocExtension::SetMemoryLimit(used + 256 * kMiB,
+                                  MallocExtension::LimitKind::kSoft);
+  int pool = MallocExtension::CreateReservePool(128 * kMiB);
+  ASSERT_GE(pool, 0);
+
+  // Fill most of the unreserved headroom, then cross it.  The allocator
+  // treats the soft limit as (limit - reserve), so these allocations hit the
+  // limit even though they stay below the configured value.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 192; ++i) {
+    ptrs.push_back(malloc_pages(kMiB));
+  }
+  EXPECT_THAT(
+      GetStats(),
+      ContainsRegex(R"(Number of times soft limit was hit: [1-9]\d*)"));
+
+  // Critical-path use: draw the allocation from the pool first, then
+  // allocate; the grant is the headroom that covers it.
+  EXPECT_EQ(MallocExtension::AcquireFromReservePool(pool, 64 * kMiB),
+            64 * kMiB);
+  ptrs.push_back(malloc_pages(64 * kMiB));
+
+  for (void* p : ptrs) {
+    free(p);
+  }
+  EXPECT_TRUE(MallocExtension::DestroyReservePool(pool));
+
+  // Exit status indicates whether we've failed any of the expectations above.
+  exit(testing::Test::HasFailure());
+}
+
+TEST_F(LimitTest, ReservePoolCarvesHeadroom) {
+  // Run the test in a separate subprocess, so it doesn't interfere with other
+  // tests.
+  EXPECT_EXIT(ReservePoolCarvesHeadroom(), testing::ExitedWithCode(0), "");
+}
+
 }  // namespace
 }  // namespace tcmalloc
@@ -20,6 +20,7 @@
 
 #include "gtest/gtest.h"
 #include "absl/random/random.h"
+#include "absl/types/span.h"
 #include "tcmalloc/malloc_extension.h"
 
 namespace tcmalloc {
@@ -85,5 +86,24 @@ TEST(MallocExtension, AllocationProfile) {
   }
 }
 
+TEST(MallocExtension, WarmupIsSafe) {
+  // Without TCMalloc linked in, Warmup should be a no-op.
+  constexpr MallocExtension::WarmupSpec::SizeCount kAllocations[] = {
+      {64, 16},
+  };
+  MallocExtension::WarmupSpec spec;
+  spec.allocations = absl::MakeConstSpan(kAllocations);
+  spec.backed_bytes = 1 << 20;
+  MallocExtension::Warmup(spec);
+}
+
+TEST(MallocExtension, RunSelfTestIsSafe) {
+  // Without TCMalloc linked in, RunSelfTest reports nothing ran.
+  const MallocExtension::SelfTestResult result = MallocExtension::RunSelfTest();
+  EXPECT_EQ(result.fast_path_cycles, 0);
+  EXPECT_EQ(result.cross_thread_free_cycles, 0);
+  EXPECT_EQ(result.transfer_cache_cycles, 0);
+}
+
 }  // namespace
 }  // namespace tcmalloc
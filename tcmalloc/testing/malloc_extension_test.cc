@@ -20,13 +20,17 @@
 
 #include <map>
 #include <optional>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/base/macros.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "tcmalloc/cpu_cache.h"
+#include "tcmalloc/internal/page_size.h"
 #include "tcmalloc/static_vars.h"
 #include "tcmalloc/testing/testutil.h"
 
@@ -62,6 +66,206 @@ TEST(MallocExtension, BackgroundReleaseRate) {
             0);
 }
 
+TEST(MallocExtension, TuningProfiles) {
+  // No profile applied yet.
+  EXPECT_EQ(MallocExtension::GetTuningProfile(), "");
+
+  EXPECT_FALSE(MallocExtension::SetTuningProfile("no-such-profile"));
+  EXPECT_EQ(MallocExtension::GetTuningProfile(), "");
+
+  // The footprint bundle turns on background release.
+  ASSERT_TRUE(MallocExtension::SetTuningProfile("footprint"));
+  EXPECT_EQ(MallocExtension::GetTuningProfile(), "footprint");
+  EXPECT_GT(static_cast<size_t>(MallocExtension::GetBackgroundReleaseRate()),
+            0);
+
+  // Re-applying the active profile is a no-op and stays active.
+  ASSERT_TRUE(MallocExtension::SetTuningProfile("footprint"));
+  EXPECT_EQ(MallocExtension::GetTuningProfile(), "footprint");
+
+  // Restore the compiled-in defaults for the rest of the tests.
+  ASSERT_TRUE(MallocExtension::SetTuningProfile("default"));
+  EXPECT_EQ(MallocExtension::GetTuningProfile(), "default");
+  EXPECT_EQ(static_cast<size_t>(MallocExtension::GetBackgroundReleaseRate()),
+            0);
+}
+
+TEST(MallocExtension, GetOwnershipBatch) {
+  constexpr size_t kSmallSize = 64;
+  constexpr size_t kLargeSize = 4 << 20;
+  void* small = ::operator new(kSmallSize);
+  void* large = ::operator new(kLargeSize);
+  static int global;
+  int local;
+
+  const void* ptrs[] = {
+      small,
+      // Interior pointers are acceptable, unlike GetOwnership().
+      static_cast<const char*>(small) + kSmallSize / 2,
+      large,
+      &global,
+      &local,
+      nullptr,
+  };
+  MallocExtension::PointerInfo info[ABSL_ARRAYSIZE(ptrs)];
+  MallocExtension::GetOwnershipBatch(ptrs, absl::MakeSpan(info));
+
+  EXPECT_EQ(info[0].ownership, MallocExtension::Ownership::kOwned);
+  // Small objects report a nonzero size class covering the request.
+  EXPECT_GT(info[0].size_class, 0);
+  EXPECT_EQ(info[1].ownership, MallocExtension::Ownership::kOwned);
+  EXPECT_EQ(info[1].size_class, info[0].size_class);
+  EXPECT_EQ(info[2].ownership, MallocExtension::Ownership::kOwned);
+  // Large objects are span-backed and have no size class.
+  EXPECT_EQ(info[2].size_class, 0);
+  EXPECT_EQ(info[3].ownership, MallocExtension::Ownership::kNotOwned);
+  EXPECT_EQ(info[4].ownership, MallocExtension::Ownership::kNotOwned);
+  EXPECT_EQ(info[5].ownership, MallocExtension::Ownership::kNotOwned);
+
+  // Batch results agree with the per-pointer query.
+  for (const void* p : ptrs) {
+    MallocExtension::PointerInfo one;
+    MallocExtension::GetOwnershipBatch(absl::MakeConstSpan(&p, 1),
+                                       absl::MakeSpan(&one, 1));
+    EXPECT_EQ(one.ownership, MallocExtension::GetOwnership(p));
+  }
+
+  ::operator delete(small);
+  ::operator delete(large);
+}
+
+TEST(MallocExtension, ThreadAllocatedBytes) {
+  const size_t before = MallocExtension::ThreadAllocatedBytes();
+
+  constexpr size_t kSize = 256;
+  void* ptr = ::operator new(kSize);
+  benchmark::DoNotOptimize(ptr);
+  ::operator delete(ptr);
+
+  const size_t after = MallocExtension::ThreadAllocatedBytes();
+  // The counter tracks requested bytes, so it must have grown by at least the
+  // request.  Background allocations (e.g. by the test framework) can only
+  // increase it further.
+  EXPECT_GE(after, before + kSize);
+
+  // The counter is per-thread: a fresh thread starts near zero and observes
+  // only its own allocations.
+  std::thread([] {
+    const size_t t_before = MallocExtension::ThreadAllocatedBytes();
+    void* p = ::operator new(kSize);
+    benchmark::DoNotOptimize(p);
+    ::operator delete(p);
+    EXPECT_GE(MallocExtension::ThreadAllocatedBytes(), t_before + kSize);
+  }).join();
+
+  // The other thread's allocations are not reflected here.
+  EXPECT_GE(MallocExtension::ThreadAllocatedBytes(), after);
+}
+
+TEST(MallocExtension, Warmup) {
+  // Cycle a small allocation profile through the allocator.  The visible
+  // contract is modest -- Warmup completes and the heap remains usable -- but
+  // exercising it here covers the allocate-touch-free path end to end.
+  constexpr MallocExtension::WarmupSpec::SizeCount kAllocations[] = {
+      {16, 1024},
+      {256, 256},
+      {8192, 32},
+  };
+  MallocExtension::WarmupSpec spec;
+  spec.allocations = absl::MakeConstSpan(kAllocations);
+  spec.backed_bytes = 4 << 20;
+  MallocExtension::Warmup(spec);
+
+  // An empty spec is a no-op.
+  MallocExtension::Warmup(MallocExtension::WarmupSpec{});
+
+  // The heap still works after warmup.
+  void* ptr = ::operator new(256);
+  benchmark::DoNotOptimize(ptr);
+  ::operator delete(ptr);
+}
+
+TEST(MallocExtension, Prefault) {
+  // Nothing to do is not an error.
+  EXPECT_EQ(MallocExtension::Prefault(nullptr, 0), 0);
+
+  constexpr size_t kBytes = 32 << 20;
+  char* ptr = static_cast<char*>(::operator new(kBytes));
+
+  // Leave sentinels behind: prefaulting must populate pages without
+  // altering their contents.
+  ptr[0] = 0x5a;
+  ptr[kBytes / 2] = 0x5a;
+  ptr[kBytes - 1] = 0x5a;
+
+  // The range is page-rounded internally, so the attempt count can exceed
+  // kBytes by at most a page on either end.  How much is skipped as already
+  // resident depends on what earlier tests left behind, so only bounds are
+  // checked.
+  const size_t kSlop = 2 * GetPageSize();
+  EXPECT_LE(MallocExtension::Prefault(ptr, kBytes, /*parallelism=*/4),
+            kBytes + kSlop);
+  EXPECT_LE(MallocExtension::Prefault(ptr, kBytes, /*parallelism=*/1),
+            kBytes + kSlop);
+
+  EXPECT_EQ(ptr[0], 0x5a);
+  EXPECT_EQ(ptr[kBytes / 2], 0x5a);
+  EXPECT_EQ(ptr[kBytes - 1], 0x5a);
+
+  sized_delete(ptr, kBytes);
+}
+
+TEST(MallocExtension, RunSelfTest) {
+  const MallocExtension::SelfTestResult result = MallocExtension::RunSelfTest();
+
+  // Every pattern ran and measured a positive cost.  The cycle counts
+  // themselves are hardware-dependent; comparing them across releases is the
+  // fleet canary's job, not this test's.
+  EXPECT_GT(result.fast_path_cycles, 0);
+  EXPECT_GT(result.cross_thread_free_cycles, 0);
+  EXPECT_GT(result.transfer_cache_cycles, 0);
+
+  // The heap still works after the benchmark churned the caches.
+  void* ptr = ::operator new(256);
+  benchmark::DoNotOptimize(ptr);
+  ::operator delete(ptr);
+}
+
+TEST(MallocExtension, DynamicSlabResizeTrace) {
+  // The trace only accumulates entries when the background thread resizes the
+  // slabs, so we can only check that querying it is safe and stays within the
+  // caller's buffer.
+  MallocExtension::DynamicSlabResizeTraceEntry entries[8];
+  const size_t n =
+      MallocExtension::GetDynamicSlabResizeTrace(absl::MakeSpan(entries));
+  EXPECT_LE(n, 8);
+}
+
+TEST(MallocExtension, CacheTopologyShards) {
+  const int shards = MallocExtension::GetCacheTopologyShardCount();
+  ASSERT_GE(shards, 0);
+  if (shards == 0) {
+    // Topology unknown (not TCMalloc, or no sysfs cache info).
+    return;
+  }
+
+  // Every cpu maps to a valid shard; out-of-range cpus do not.
+  for (int cpu = 0; cpu < NumCPUs(); ++cpu) {
+    const int shard = MallocExtension::GetCacheTopologyShardForCpu(cpu);
+    EXPECT_GE(shard, 0) << cpu;
+    EXPECT_LT(shard, shards) << cpu;
+  }
+  EXPECT_EQ(MallocExtension::GetCacheTopologyShardForCpu(-1), -1);
+
+  // Shard load is readable whether or not the sharded transfer cache is
+  // active; unknown shards report zero.
+  for (int shard = 0; shard < shards; ++shard) {
+    (void)MallocExtension::GetCacheTopologyShardBytes(shard);
+  }
+  EXPECT_EQ(MallocExtension::GetCacheTopologyShardBytes(-1), 0);
+  EXPECT_EQ(MallocExtension::GetCacheTopologyShardBytes(shards + 1000), 0);
+}
+
 TEST(MallocExtension, SkipSubreleaseIntervals) {
 
   // Mutate via MallocExtension.
@@ -85,6 +289,49 @@ TEST(MallocExtension, SkipSubreleaseIntervals) {
             absl::ZeroDuration());
 }
 
+TEST(MallocExtension, BinaryStats) {
+  MallocExtension::BinaryStats stats;
+
+  // The snapshot is filled under a try-lock, so a concurrent holder of the
+  // pageheap lock (e.g. the background thread) can make a single call return
+  // 0.  Callers are expected to retry on their next scrape; do the same here.
+  size_t written = 0;
+  for (int i = 0; i < 100 && written == 0; ++i) {
+    written = MallocExtension::GetBinaryStats(&stats, sizeof(stats));
+  }
+  ASSERT_EQ(written, sizeof(stats));
+
+  EXPECT_EQ(stats.version, MallocExtension::BinaryStats::kVersion);
+  EXPECT_EQ(stats.struct_size, sizeof(stats));
+  EXPECT_GT(stats.num_size_classes, 0);
+  EXPECT_LE(stats.num_size_classes,
+            MallocExtension::BinaryStats::kMaxSizeClasses);
+  EXPECT_GT(stats.virtual_memory_used_bytes, 0);
+  EXPECT_GT(stats.physical_memory_used_bytes, 0);
+
+  // An undersized buffer is rejected without writing anything.
+  EXPECT_EQ(MallocExtension::GetBinaryStats(&stats, sizeof(stats) - 1), 0);
+}
+
+TEST(MallocExtension, HugeCacheState) {
+  char buffer[4096];
+  const size_t written =
+      MallocExtension::GetHugeCacheState(absl::MakeSpan(buffer));
+  if (written == 0) {
+    GTEST_SKIP() << "Huge cache state not supported.";
+  }
+  ASSERT_LT(written, sizeof(buffer));
+  const absl::string_view state(buffer, written);
+
+  // Feeding a snapshot back into the same process is accepted; snapshots can
+  // only raise cache size targets, so the round trip is safe.
+  EXPECT_TRUE(MallocExtension::SetHugeCacheState(state));
+
+  // Incompatible or corrupt snapshots are rejected wholesale.
+  EXPECT_FALSE(MallocExtension::SetHugeCacheState("hugecache_state v0\n"));
+  EXPECT_FALSE(MallocExtension::SetHugeCacheState("not a snapshot"));
+}
+
 TEST(MallocExtension, Properties) {
   // Verify that every property under GetProperties also works with
   // GetNumericProperty.
@@ -124,7 +371,13 @@ TEST(MallocExtension, Properties) {
       "tcmalloc.pageheap_free_bytes",
       "tcmalloc.pageheap_unmapped_bytes",
       "tcmalloc.per_cpu_caches_active",
+      "tcmalloc.percpu_active",
       "tcmalloc.required_bytes",
+      "tcmalloc.residency.guarded_page_pool.resident_bytes",
+      "tcmalloc.residency.huge_cache.resident_bytes",
+      "tcmalloc.residency.huge_region.resident_bytes",
+      "tcmalloc.residency.pagemap_root.resident_bytes",
+      "tcmalloc.residency.percpu_slab.resident_bytes",
       "tcmalloc.sampled_internal_fragmentation",
       "tcmalloc.sharded_transfer_cache_free",
       "tcmalloc.slack_bytes",
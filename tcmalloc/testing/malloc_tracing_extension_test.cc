@@ -27,6 +27,13 @@
 #include "absl/status/statusor.h"
 
 #ifndef MALLOC_TRACING_EXTENSION_NOT_SUPPORTED
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include <new>
+#include <string>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "absl/cleanup/cleanup.h"
 #endif
@@ -107,6 +114,251 @@ TEST(MallocTracingExtension, GetAllocatedAddressRanges) {
     }
   }
 }
+
+TEST(MallocTracingExtension, ClassifyAddresses) {
+  using ::tcmalloc::malloc_tracing_extension::AddressOwnership;
+  using ::tcmalloc::malloc_tracing_extension::ClassifyAddresses;
+
+  constexpr size_t kSmallSize = 64;
+  constexpr size_t kLargeSize = 4 << 20;
+  void* small = ::operator new(kSmallSize);
+  void* small2 = ::operator new(kSmallSize);
+  void* large = ::operator new(kLargeSize);
+  absl::Cleanup cleanup = [&] {
+    ::operator delete(small);
+    ::operator delete(small2);
+    ::operator delete(large);
+  };
+
+  uintptr_t addresses[] = {
+      reinterpret_cast<uintptr_t>(small),
+      reinterpret_cast<uintptr_t>(small),
+      reinterpret_cast<uintptr_t>(small2),
+      reinterpret_cast<uintptr_t>(large),
+      // A wild address tcmalloc has never managed.
+      1,
+  };
+  AddressOwnership results[5] = {};
+  ASSERT_TRUE(ClassifyAddresses(addresses, 5, results).ok());
+
+  // Small objects live on size-class pages with a Span.
+  EXPECT_NE(results[0].span_id, 0);
+  EXPECT_GE(results[0].object_size, kSmallSize);
+  // Classification is deterministic for an unchanged heap.
+  EXPECT_EQ(results[0].span_id, results[1].span_id);
+  EXPECT_EQ(results[0].object_size, results[1].object_size);
+
+  // Large objects have a Span but no size class.
+  EXPECT_NE(results[3].span_id, 0);
+  EXPECT_EQ(results[3].object_size, 0);
+
+  // The wild address maps to nothing.
+  EXPECT_EQ(results[4].tracker_id, 0);
+  EXPECT_EQ(results[4].span_id, 0);
+  EXPECT_EQ(results[4].object_size, 0);
+}
+
+TEST(MallocTracingExtension, GetAllocationSiteStats) {
+  using ::tcmalloc::malloc_tracing_extension::AllocationSiteTable;
+  using ::tcmalloc::malloc_tracing_extension::GetAllocationSiteStats;
+
+  // Allocate enough from one site that it is sampled with near certainty
+  // (default sampling interval is 2MB).
+  constexpr size_t kChunkSize = 1 << 20;
+  constexpr int kChunks = 64;
+  std::vector<void*> chunks;
+  for (int i = 0; i < kChunks; ++i) {
+    chunks.push_back(::operator new(kChunkSize));
+  }
+  absl::Cleanup cleanup = [&] {
+    for (void* p : chunks) ::operator delete(p);
+  };
+
+  absl::StatusOr<AllocationSiteTable> table = GetAllocationSiteStats();
+  ASSERT_TRUE(table.ok());
+  ASSERT_FALSE(table->sites.empty());
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < table->sites.size(); ++i) {
+    EXPECT_GT(table->sites[i].live_bytes, 0);
+    EXPECT_GT(table->sites[i].live_objects, 0);
+    if (i > 0) {
+      // Entries are aggregated and sorted by id.
+      EXPECT_LT(table->sites[i - 1].site_id, table->sites[i].site_id);
+    }
+    total_bytes += table->sites[i].live_bytes;
+  }
+  EXPECT_GE(total_bytes, kChunks * kChunkSize / 2);
+
+  // Site ids are stable: a second snapshot with the heap unchanged reports
+  // the sites of the first (modulo allocations made by the test itself).
+  absl::StatusOr<AllocationSiteTable> again = GetAllocationSiteStats();
+  ASSERT_TRUE(again.ok());
+  size_t found = 0;
+  for (const auto& site : table->sites) {
+    for (const auto& site2 : again->sites) {
+      if (site2.site_id == site.site_id) {
+        ++found;
+        break;
+      }
+    }
+  }
+  EXPECT_EQ(found, table->sites.size());
+}
+
+TEST(MallocTracingExtension, GetGrowthLedger) {
+  using ::tcmalloc::malloc_tracing_extension::GetGrowthLedger;
+  using ::tcmalloc::malloc_tracing_extension::GrowthLedger;
+
+  // Force some heap growth so the ledger is non-empty even if this test
+  // runs alone.  (A request this size may still be served from spans the
+  // page heap already holds, so we do not assert on a matching event.)
+  void* big = ::operator new(64 << 20);
+  absl::Cleanup cleanup = [&] { ::operator delete(big); };
+
+  absl::StatusOr<GrowthLedger> ledger = GetGrowthLedger();
+  ASSERT_TRUE(ledger.ok());
+  ASSERT_FALSE(ledger->events.empty());
+  EXPECT_GE(ledger->total_events, ledger->events.size());
+
+  int64_t prev_timestamp = 0;
+  for (const auto& event : ledger->events) {
+    EXPECT_GT(event.timestamp_ns, 0);
+    // Events are reported oldest first.
+    EXPECT_GE(event.timestamp_ns, prev_timestamp);
+    prev_timestamp = event.timestamp_ns;
+    EXPECT_GT(event.start_addr, 0);
+    EXPECT_GT(event.bytes, 0);
+    EXPECT_FALSE(event.tag.empty());
+  }
+
+  // Growth never unhappens: a second snapshot extends the first.
+  absl::StatusOr<GrowthLedger> again = GetGrowthLedger();
+  ASSERT_TRUE(again.ok());
+  EXPECT_GE(again->total_events, ledger->total_events);
+}
+
+TEST(MallocTracingExtension, AllocationTraceCapture) {
+  const std::string path = ::testing::TempDir() + "/allocation_trace.bin";
+  ASSERT_TRUE(tcmalloc::malloc_tracing_extension::StartAllocationTrace(
+                  path.c_str(), /*sample_interval=*/1)
+                  .ok());
+  // Only one session may be active at a time.
+  EXPECT_EQ(tcmalloc::malloc_tracing_extension::StartAllocationTrace(
+                path.c_str(), /*sample_interval=*/1)
+                .code(),
+            absl::StatusCode::kFailedPrecondition);
+
+  constexpr int kAllocations = 10000;
+  for (int i = 0; i < kAllocations; i++) {
+    ::operator delete(::operator new(64 + (i % 1024)));
+  }
+  ASSERT_TRUE(
+      tcmalloc::malloc_tracing_extension::DrainAllocationTrace().ok());
+  ASSERT_TRUE(tcmalloc::malloc_tracing_extension::StopAllocationTrace().ok());
+
+  absl::StatusOr<tcmalloc::malloc_tracing_extension::AllocationTraceStats>
+      stats = tcmalloc::malloc_tracing_extension::GetAllocationTraceStats();
+  ASSERT_TRUE(stats.ok());
+  EXPECT_GT(stats->events_recorded, 0);
+
+  struct stat file_info;
+  ASSERT_EQ(stat(path.c_str(), &file_info), 0);
+  EXPECT_EQ(static_cast<uint64_t>(file_info.st_size), stats->bytes_written);
+  // The header plus at least some packed events.
+  EXPECT_GT(file_info.st_size, 16);
+
+  // Stopping again fails; the session is over.
+  EXPECT_FALSE(tcmalloc::malloc_tracing_extension::StopAllocationTrace().ok());
+}
+
+TEST(MallocTracingExtension, GetHeapLayoutSnapshot) {
+  // Make sure the filler tracks at least one hugepage's worth of small
+  // objects.
+  constexpr int kAllocations = 10000;
+  std::vector<void*> objects;
+  objects.reserve(kAllocations);
+  for (int i = 0; i < kAllocations; i++) {
+    objects.push_back(::operator new(512));
+  }
+  absl::Cleanup cleanup = [&] {
+    for (void* object : objects) ::operator delete(object);
+  };
+
+  absl::StatusOr<std::string> snapshot =
+      tcmalloc::malloc_tracing_extension::GetHeapLayoutSnapshot();
+  ASSERT_TRUE(snapshot.ok());
+  const std::string& blob = *snapshot;
+  ASSERT_GE(blob.size(), 16);
+  EXPECT_EQ(blob.substr(0, 4), "TCHL");
+
+  auto read_le = [&](size_t pos, size_t bytes) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < bytes; i++) {
+      v |= static_cast<uint64_t>(static_cast<uint8_t>(blob[pos + i]))
+           << (8 * i);
+    }
+    return v;
+  };
+  EXPECT_EQ(read_le(4, 2), 1);  // version
+  const uint64_t page_size = read_le(8, 4);
+  const uint64_t pages_per_hugepage = read_le(12, 4);
+  EXPECT_GT(page_size, 0);
+  EXPECT_GT(pages_per_hugepage, 0);
+
+  // Walk every record; the runs of each hugepage record must tile the
+  // hugepage exactly.
+  size_t hugepage_records = 0;
+  size_t pos = 16;
+  while (pos < blob.size()) {
+    const uint8_t record_type = blob[pos++];
+    switch (record_type) {
+      case 1: {
+        ASSERT_LE(pos + 15, blob.size());
+        EXPECT_NE(read_le(pos, 8), 0);     // start address
+        EXPECT_LE(read_le(pos + 8, 1), 3);  // heap
+        const uint64_t num_runs = read_le(pos + 13, 2);
+        pos += 15;
+        ASSERT_LE(pos + 5 * num_runs, blob.size());
+        uint64_t covered = 0;
+        for (uint64_t i = 0; i < num_runs; i++) {
+          EXPECT_EQ(read_le(pos, 2), covered);      // first page
+          covered += read_le(pos + 2, 2);           // pages
+          EXPECT_LE(read_le(pos + 4, 1), 2);        // state
+          pos += 5;
+        }
+        EXPECT_EQ(covered, pages_per_hugepage);
+        ++hugepage_records;
+        break;
+      }
+      case 2:
+        ASSERT_LE(pos + 40, blob.size());
+        EXPECT_GT(read_le(pos + 8, 8), 0);  // bytes
+        pos += 40;
+        break;
+      case 3:
+        ASSERT_LE(pos + 16, blob.size());
+        EXPECT_GT(read_le(pos + 8, 8), 0);  // bytes
+        pos += 16;
+        break;
+      default:
+        FAIL() << "unknown record type " << static_cast<int>(record_type)
+               << " at offset " << pos - 1;
+    }
+  }
+  EXPECT_EQ(pos, blob.size());
+  EXPECT_GT(hugepage_records, 0);
+}
+
+TEST(MallocTracingExtension, AllocationTraceRejectsBadArguments) {
+  EXPECT_EQ(tcmalloc::malloc_tracing_extension::StartAllocationTrace(
+                nullptr, /*sample_interval=*/1)
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(tcmalloc::malloc_tracing_extension::StartAllocationTrace(
+                "/tmp/trace.bin", /*sample_interval=*/0)
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
 #endif
 
 }  // namespace
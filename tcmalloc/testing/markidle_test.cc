@@ -91,5 +91,24 @@ TEST(MarkIdleTest, TestIdleUsage) {
   t.join();
 }
 
+// Check that MarkProcessIdle() drains the caches between the application and
+// the page heap: after it runs, little should remain in the per-CPU, transfer,
+// and thread caches.
+TEST(MarkIdleTest, ProcessIdleShrinksCaches) {
+  TestAllocation();
+
+  MallocExtension::MarkProcessIdle();
+
+  std::optional<size_t> cpu_cache_bytes = MallocExtension::GetNumericProperty(
+      "tcmalloc.cpu_free");
+  ASSERT_TRUE(cpu_cache_bytes.has_value());
+  // Allocations made by the test harness itself since the drain can trickle
+  // back in, so accept a small residue rather than exactly zero.
+  EXPECT_LE(*cpu_cache_bytes, 1 << 20);
+
+  // Repeated calls are safe.
+  MallocExtension::MarkProcessIdle();
+}
+
 }  // namespace
 }  // namespace tcmalloc
@@ -16,6 +16,7 @@
 #include <stdint.h>
 
 #include <optional>
+#include <vector>
 
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
@@ -143,5 +144,31 @@ TEST(PeakHeapProfilingTest, PeakHeapTracking) {
   }
 }
 
+TEST(PeakHeapProfilingTest, WindowedVariantsCoverRecentPeak) {
+  ScopedPeakGrowthFraction s(1.25);
+
+  // Allocate until a fresh snapshot is recorded, surpassing whatever peak
+  // earlier tests in this binary left behind.
+  const int64_t start_peak_sz = ProfileSize(ProfileType::kPeakHeap);
+  std::vector<void*> chunks;
+  do {
+    chunks.push_back(::operator new(50 << 20));
+    benchmark::DoNotOptimize(chunks.back());
+  } while (ProfileSize(ProfileType::kPeakHeap) == start_peak_sz &&
+           chunks.size() < 64);
+
+  const int64_t all_time = ProfileSize(ProfileType::kPeakHeap);
+  ASSERT_GT(all_time, start_peak_sz);
+
+  // The snapshot just taken is the largest retained peak and falls within
+  // both trailing windows, so the windowed variants must report it too.
+  EXPECT_EQ(ProfileSize(ProfileType::kPeakHeapLastHour), all_time);
+  EXPECT_EQ(ProfileSize(ProfileType::kPeakHeapLastDay), all_time);
+
+  for (void* chunk : chunks) {
+    ::operator delete(chunk);
+  }
+}
+
 }  // namespace
 }  // namespace tcmalloc
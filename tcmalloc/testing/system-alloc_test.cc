@@ -77,7 +77,7 @@ class MmapAlignedTest : public testing::TestWithParam<size_t> {
          {MemoryTag::kNormal, MemoryTag::kSampled, MemoryTag::kCold}) {
       SCOPED_TRACE(static_cast<unsigned int>(tag));
 
-      void* p = MmapAligned(size, alignment, tag);
+      void* p = MmapAligned(size, alignment, tag, "test");
       EXPECT_NE(p, nullptr);
       EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
       EXPECT_EQ(IsNormalMemory(p), tag == MemoryTag::kNormal);
@@ -85,7 +85,7 @@ class MmapAlignedTest : public testing::TestWithParam<size_t> {
       EXPECT_EQ(GetMemoryTag(static_cast<char*>(p) + size - 1), tag);
       if (PrSetVmaIsSupported()) {
         EXPECT_THAT(MappingName(p, size),
-                    HasSubstr(absl::StrFormat("tcmalloc_region_%s",
+                    HasSubstr(absl::StrFormat("tcmalloc_region_%s_test",
                                               MemoryTagToLabel(tag))));
       }
       EXPECT_EQ(munmap(p, size), 0);
@@ -148,6 +148,9 @@ class SimpleRegion : public AddressRegion {
   size_t free_size_;
 };
 
+// Was SimpleRegionFactory::Release invoked at least once?
+static bool simple_region_release_invoked = false;
+
 class SimpleRegionFactory : public AddressRegionFactory {
  public:
   AddressRegion* Create(void* start, size_t size, UsageHint hint) override {
@@ -156,6 +159,12 @@ class SimpleRegionFactory : public AddressRegionFactory {
     return new (region_space)
         SimpleRegion(reinterpret_cast<uintptr_t>(start), size);
   }
+
+  bool Release(void* start, size_t size) override {
+    simple_region_release_invoked = true;
+    // Decline, so tcmalloc falls back to its madvise-based release.
+    return false;
+  }
 };
 SimpleRegionFactory f;
 
@@ -173,6 +182,74 @@ TEST(Basic, InvokedTest) {
   ASSERT_TRUE(simple_region_alloc_invoked);
 }
 
+TEST(Basic, ReleaseHookInvoked) {
+  MallocExtension::SetRegionFactory(&f);
+
+  AddressRange range =
+      SystemAlloc(kMinSystemAlloc, kPageSize, MemoryTag::kNormal, "test");
+  ASSERT_NE(range.ptr, nullptr);
+
+  // The installed factory is offered the range first; since it declines,
+  // the madvise-based release still happens and reports success.
+  EXPECT_TRUE(SystemRelease(range.ptr, range.bytes));
+  EXPECT_TRUE(simple_region_release_invoked);
+}
+
+TEST(Basic, ReleaseRanges) {
+  AddressRange a =
+      SystemAlloc(kMinSystemAlloc, kPageSize, MemoryTag::kNormal, "test");
+  AddressRange b =
+      SystemAlloc(kMinSystemAlloc, kPageSize, MemoryTag::kNormal, "test");
+  ASSERT_NE(a.ptr, nullptr);
+  ASSERT_NE(b.ptr, nullptr);
+
+  const AddressRange ranges[] = {a, b};
+  bool ok[2] = {false, false};
+  EXPECT_EQ(SystemReleaseRanges(ranges, ok), 2);
+  EXPECT_TRUE(ok[0]);
+  EXPECT_TRUE(ok[1]);
+}
+
+TEST(ColdRegions, AdviseCoversColdMappings) {
+  // Force at least one cold reservation to exist.
+  AddressRange range =
+      SystemAlloc(kMinSystemAlloc, kPageSize, MemoryTag::kCold, "test");
+  ASSERT_NE(range.ptr, nullptr);
+
+  const size_t advised = SystemAdviseColdRegions();
+#ifdef MADV_COLD
+  // The whole reservation backing the allocation is advised, not just the
+  // allocation itself.
+  EXPECT_GE(advised, range.bytes);
+#else
+  EXPECT_EQ(advised, 0);
+#endif
+}
+
+TEST(TagVaStats, AccountsReservations) {
+  const TagVaStats before = SystemTagVaStats(MemoryTag::kCold);
+  void* p =
+      MmapAligned(kMinSystemAlloc, kMinSystemAlloc, MemoryTag::kCold, "test");
+  ASSERT_NE(p, nullptr);
+
+  const TagVaStats after = SystemTagVaStats(MemoryTag::kCold);
+  EXPECT_GE(after.current_bytes, before.current_bytes + kMinSystemAlloc);
+  EXPECT_GE(after.peak_bytes, after.current_bytes);
+  // No budget is configured in this test, so nothing may be denied.
+  EXPECT_EQ(after.budget_bytes, 0);
+  EXPECT_EQ(after.denials, 0);
+  // Likewise no pre-reserved VA window, so no carves and no fallbacks.
+  EXPECT_EQ(after.reserve_bytes, 0);
+  EXPECT_EQ(after.reserve_headroom_bytes, 0);
+  EXPECT_EQ(after.reserve_fallbacks, 0);
+
+  // The counters track reservations, not mappings: unmapping does not (and
+  // in normal operation nothing ever does) give the accounting back.
+  EXPECT_EQ(munmap(p, kMinSystemAlloc), 0);
+  EXPECT_GE(SystemTagVaStats(MemoryTag::kCold).current_bytes,
+            after.current_bytes);
+}
+
 TEST(Basic, RetryFailTest) {
   // Check with the allocator still works after a failed allocation.
   //
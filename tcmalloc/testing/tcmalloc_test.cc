@@ -38,14 +38,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <functional>
 #include <limits>
 #include <new>
 #include <optional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -485,6 +489,38 @@ TEST(TCMallocTest, ReleaseMemoryToSystem) {
   EXPECT_EQ(starting_bytes + 2 * MB, GetUnmappedBytes());
 }
 
+TEST(TCMallocTest, ReleaseMemoryToSystemWithDeadline) {
+  static const size_t MB = 1048576;
+  void* a = ::operator new(4 * MB);
+  ::operator delete(a);
+
+  // A generous deadline completes without tripping it, and reports whatever
+  // was released broken down by tier.  How much is releasable depends on the
+  // page heap implementation, so only the accounting is checked.
+  MallocExtension::DeadlineReleaseStats stats =
+      MallocExtension::ReleaseMemoryToSystemWithDeadline(
+          MB, absl::Seconds(10), /*break_hugepages=*/false);
+  EXPECT_FALSE(stats.deadline_exceeded);
+
+  // An already-expired deadline does no work.
+  stats = MallocExtension::ReleaseMemoryToSystemWithDeadline(
+      MB, -absl::Seconds(1), /*break_hugepages=*/false);
+  EXPECT_TRUE(stats.deadline_exceeded);
+  EXPECT_EQ(stats.cold_bytes + stats.normal_bytes + stats.sampled_bytes +
+                stats.broken_hugepage_bytes,
+            0);
+}
+
+TEST(TCMallocTest, ReserveHeapMetadata) {
+  // Reserving metadata for a modest heap succeeds, and allocation continues
+  // to work from the pre-backed arena regions.
+  EXPECT_TRUE(MallocExtension::ReserveHeapMetadata(size_t{1} << 30));
+  void* a = ::operator new(1 << 20);
+  ::operator delete(a);
+  // A second reservation at or below the first is already satisfied.
+  EXPECT_TRUE(MallocExtension::ReserveHeapMetadata(size_t{1} << 20));
+}
+
 TEST(TCMallocTest, MallocTrim) { malloc_trim(0); }
 
 TEST(TCMallocTest, NothrowSizedDelete) {
@@ -935,6 +971,45 @@ TEST(TCMallocTest, GetStatsReportsLowLevel) {
   EXPECT_GE(*low_level_bytes, heap_size);
 }
 
+TEST(TCMallocTest, ForkSupport) {
+  MallocExtension::EnableForkSupport();
+
+  // Churn the allocator from another thread so fork() regularly lands while
+  // internal locks are held or contended.
+  std::atomic<bool> done(false);
+  std::thread churn([&] {
+    absl::BitGen rand;
+    while (!done.load(std::memory_order_relaxed)) {
+      void* ptr = ::operator new(absl::Uniform<size_t>(rand, 1, 4096));
+      benchmark::DoNotOptimize(ptr);
+      ::operator delete(ptr);
+    }
+  });
+
+  for (int i = 0; i < 10; ++i) {
+    const pid_t pid = fork();
+    ASSERT_GE(pid, 0) << errno;
+    if (pid == 0) {
+      // In the child: the heap must be immediately usable.  Exit directly;
+      // the test framework's atexit machinery is not fork-safe.
+      void* small = malloc(1024);
+      if (small == nullptr) _exit(1);
+      free(small);
+      void* large = ::operator new(1 << 20);
+      if (large == nullptr) _exit(2);
+      ::operator delete(large);
+      _exit(0);
+    }
+    int status;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+  }
+
+  done.store(true, std::memory_order_relaxed);
+  churn.join();
+}
+
 namespace {
 template <typename T1, typename T2>
 void ExpectSameAddresses(T1 v1, T2 v2) {
@@ -1167,6 +1242,70 @@ TEST(SizedDeleteTest, SizedOperatorDelete) {
   }
 }
 
+TEST(SizeReturningTest, AllocAtLeast) {
+  for (size_t min_size : {size_t{1}, size_t{10}, size_t{100}, size_t{1025},
+                          size_t{8192}, tcmalloc_internal::kMaxSize + 1}) {
+    tcmalloc::sized_class_ptr_t res =
+        tcmalloc_size_returning_alloc_at_least(min_size);
+    ASSERT_NE(res.p, nullptr);
+    EXPECT_GE(res.n, min_size);
+    if (res.size_class != 0) {
+      // Small allocations report the chosen class and its exact capacity.
+      EXPECT_EQ(res.n, MallocExtension::GetAllocatedSize(res.p));
+      EXPECT_LE(min_size, tcmalloc_internal::kMaxSize);
+    }
+    memset(res.p, 0xcd, res.n);
+    // The result is an ordinary allocation; sized delete with the returned
+    // capacity and plain free both work.
+    ::operator delete(res.p, res.n);
+  }
+
+  // Growing a capacity from the returned size must make progress: requesting
+  // one byte more than the returned capacity yields a strictly larger one.
+  tcmalloc::sized_class_ptr_t res = tcmalloc_size_returning_alloc_at_least(64);
+  tcmalloc::sized_class_ptr_t next =
+      tcmalloc_size_returning_alloc_at_least(res.n + 1);
+  EXPECT_GT(next.n, res.n);
+  free(res.p);
+  free(next.p);
+}
+
+TEST(BulkAllocTest, BulkAlloc) {
+  constexpr int kBatch = 64;
+  void* batch[kBatch];
+  for (size_t size : {size_t{8}, size_t{64}, size_t{1024},
+                      tcmalloc_internal::kMaxSize + 1}) {
+    for (int n : {1, 7, kBatch}) {
+      int got = tcmalloc_bulk_alloc(size, batch, n);
+      ASSERT_EQ(got, n);
+      for (int i = 0; i < got; ++i) {
+        ASSERT_NE(batch[i], nullptr);
+        // Objects must be distinct and usable.
+        memset(batch[i], 0xab, size);
+      }
+      for (int i = 0; i < got; ++i) {
+        free(batch[i]);
+      }
+    }
+  }
+  EXPECT_EQ(tcmalloc_bulk_alloc(8, batch, 0), 0);
+}
+
+TEST(BulkAllocTest, BulkFree) {
+  // Mix size classes, large allocations, and null entries so that bulk free
+  // exercises both the batched run path and the per-pointer fallback.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) {
+    ptrs.push_back(malloc(64));
+  }
+  for (int i = 0; i < 10; ++i) {
+    ptrs.push_back(nullptr);
+    ptrs.push_back(malloc(32));
+    ptrs.push_back(malloc(tcmalloc_internal::kMaxSize + 1));
+  }
+  tcmalloc_bulk_free(ptrs.data(), ptrs.size());
+}
+
 TEST(HotColdTest, HotColdNew) {
   const bool expectColdTags = tcmalloc_internal::ColdFeatureActive();
 
@@ -0,0 +1,294 @@
+// Copyright 2024 The TCMalloc Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Replays a binary allocation trace (recorded via
+// MallocTracingExtension::StartAllocationTrace) against the linked-in
+// allocator.  Each per-CPU ring in the trace becomes a replay thread, so
+// cross-thread patterns -- allocate on one thread, free on another -- hit the
+// transfer caches the same way they did in production.  After the replay the
+// tool prints throughput, replay fidelity counters, and the allocator's
+// GetStats() so a change can be validated against recorded behavior before
+// rollout.
+//
+// Usage: trace_replay <trace-file> [speedup]
+//   speedup == 0 (default) replays as fast as possible; N > 0 replays the
+//   recorded inter-event gaps compressed by a factor of N.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/internal/cycleclock.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "tcmalloc/malloc_extension.h"
+
+namespace {
+
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t sample_interval;
+};
+
+constexpr char kFrameMarker = 2;
+
+struct Event {
+  bool is_free;
+  // The address the event had when recorded; only its identity matters, to
+  // pair frees with their allocations.
+  uintptr_t trace_addr;
+  size_t size;  // Allocations only.
+  // Cycles since the ring's first event, for paced replay.
+  uint64_t cycles;
+};
+
+// One decoded per-ring event stream, replayed by one thread.
+struct RingStream {
+  std::vector<Event> events;
+};
+
+bool DecodeVarint(const char*& p, const char* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p == end) return false;
+    const uint8_t byte = static_cast<uint8_t>(*p++);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// Demuxes the framed trace body into per-ring byte streams.  Version 1 files
+// have no frames; their single interleaved stream decodes as one ring, losing
+// thread attribution but remaining replayable.
+bool Demux(const char* p, const char* end, uint32_t version,
+           std::vector<std::string>& ring_bytes) {
+  if (version < 2) {
+    ring_bytes.resize(1);
+    ring_bytes[0].assign(p, end - p);
+    return true;
+  }
+  while (p != end) {
+    if (*p != kFrameMarker) {
+      fprintf(stderr, "trace_replay: bad frame marker at offset %zd\n",
+              static_cast<ssize_t>(end - p));
+      return false;
+    }
+    ++p;
+    uint64_t ring, len;
+    if (!DecodeVarint(p, end, ring) || !DecodeVarint(p, end, len) ||
+        static_cast<uint64_t>(end - p) < len) {
+      // A truncated final frame (e.g. the recorder died mid-drain) is not
+      // worth failing the whole replay over.
+      fprintf(stderr, "trace_replay: truncated frame; stopping demux\n");
+      return true;
+    }
+    if (ring >= ring_bytes.size()) {
+      ring_bytes.resize(ring + 1);
+    }
+    ring_bytes[ring].append(p, len);
+    p += len;
+  }
+  return true;
+}
+
+// Decodes one ring's concatenated chunks into events, applying the ring's
+// address/timestamp delta chains.
+void DecodeRing(const std::string& bytes, RingStream& stream) {
+  const char* p = bytes.data();
+  const char* end = p + bytes.size();
+  uintptr_t last_addr = 0;
+  int64_t last_cycles = 0;
+  int64_t first_cycles = -1;
+  while (p != end) {
+    Event ev = {};
+    const uint8_t op = static_cast<uint8_t>(*p++);
+    ev.is_free = op != 0;
+    uint64_t size_class, addr_delta, cycle_delta;
+    if (!DecodeVarint(p, end, size_class) ||
+        !DecodeVarint(p, end, addr_delta)) {
+      break;
+    }
+    last_addr += static_cast<uintptr_t>(UnZigZag(addr_delta));
+    ev.trace_addr = last_addr;
+    if (!ev.is_free) {
+      uint64_t size;
+      if (!DecodeVarint(p, end, size)) break;
+      ev.size = size;
+    }
+    if (!DecodeVarint(p, end, cycle_delta)) break;
+    last_cycles += static_cast<int64_t>(cycle_delta);
+    if (first_cycles < 0) first_cycles = last_cycles;
+    ev.cycles = static_cast<uint64_t>(last_cycles - first_cycles);
+    stream.events.push_back(ev);
+  }
+}
+
+// Live objects, keyed by the address they had in the trace.  Sharded so
+// replay threads contend on the allocator under test, not on the bookkeeping.
+constexpr size_t kLiveShards = 64;
+struct LiveShard {
+  absl::Mutex mu;
+  absl::flat_hash_map<uintptr_t, void*> objects;
+};
+LiveShard live[kLiveShards];
+
+LiveShard& ShardFor(uintptr_t trace_addr) {
+  return live[(trace_addr >> 4) % kLiveShards];
+}
+
+std::atomic<uint64_t> allocs_replayed{0};
+std::atomic<uint64_t> frees_replayed{0};
+// Frees whose allocation predates the trace (or was dropped); skipped.
+std::atomic<uint64_t> frees_unmatched{0};
+
+void ReplayRing(const RingStream& stream, uint64_t speedup) {
+  const int64_t start = absl::base_internal::CycleClock::Now();
+  uint64_t allocs = 0, frees = 0, unmatched = 0;
+  for (const Event& ev : stream.events) {
+    if (speedup > 0) {
+      const int64_t due = start + static_cast<int64_t>(ev.cycles / speedup);
+      while (absl::base_internal::CycleClock::Now() < due) {
+      }
+    }
+    LiveShard& shard = ShardFor(ev.trace_addr);
+    if (ev.is_free) {
+      void* ptr = nullptr;
+      {
+        absl::MutexLock l(&shard.mu);
+        auto it = shard.objects.find(ev.trace_addr);
+        if (it != shard.objects.end()) {
+          ptr = it->second;
+          shard.objects.erase(it);
+        }
+      }
+      if (ptr == nullptr) {
+        ++unmatched;
+        continue;
+      }
+      free(ptr);
+      ++frees;
+    } else {
+      void* ptr = malloc(ev.size);
+      if (ptr == nullptr) abort();
+      ++allocs;
+      absl::MutexLock l(&shard.mu);
+      // The recorded address may repeat if its earlier free was dropped from
+      // the trace; keep the newest object and free the stale one lazily at
+      // exit with the other leaks.
+      shard.objects[ev.trace_addr] = ptr;
+    }
+  }
+  allocs_replayed.fetch_add(allocs, std::memory_order_relaxed);
+  frees_replayed.fetch_add(frees, std::memory_order_relaxed);
+  frees_unmatched.fetch_add(unmatched, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <trace-file> [speedup]\n", argv[0]);
+    return 1;
+  }
+  const uint64_t speedup = argc == 3 ? strtoull(argv[2], nullptr, 10) : 0;
+
+  FILE* f = fopen(argv[1], "rb");
+  if (f == nullptr) {
+    perror("trace_replay: fopen");
+    return 1;
+  }
+  std::string contents;
+  char buf[1 << 16];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    contents.append(buf, n);
+  }
+  fclose(f);
+
+  TraceFileHeader header;
+  if (contents.size() < sizeof(header)) {
+    fprintf(stderr, "trace_replay: %s: too short for a trace\n", argv[1]);
+    return 1;
+  }
+  memcpy(&header, contents.data(), sizeof(header));
+  if (memcmp(header.magic, "TCMTRACE", sizeof(header.magic)) != 0) {
+    fprintf(stderr, "trace_replay: %s: bad magic\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<std::string> ring_bytes;
+  if (!Demux(contents.data() + sizeof(header),
+             contents.data() + contents.size(), header.version, ring_bytes)) {
+    return 1;
+  }
+  std::vector<RingStream> streams(ring_bytes.size());
+  size_t total_events = 0;
+  for (size_t i = 0; i < ring_bytes.size(); ++i) {
+    DecodeRing(ring_bytes[i], streams[i]);
+    total_events += streams[i].events.size();
+  }
+  printf("trace_replay: %zu events across %zu rings (version %u, 1/%u "
+         "sampled)\n",
+         total_events, streams.size(), header.version, header.sample_interval);
+  if (header.version < 2) {
+    printf("trace_replay: version 1 trace has no ring framing; replaying on "
+           "one thread\n");
+  }
+
+  const int64_t start = absl::base_internal::CycleClock::Now();
+  std::vector<std::thread> threads;
+  threads.reserve(streams.size());
+  for (const RingStream& stream : streams) {
+    threads.emplace_back(ReplayRing, std::cref(stream), speedup);
+  }
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  const double seconds = (absl::base_internal::CycleClock::Now() - start) /
+                         absl::base_internal::CycleClock::Frequency();
+
+  // Free whatever the trace never freed so the leak does not color the stats.
+  uint64_t leaked = 0;
+  for (LiveShard& shard : live) {
+    for (auto& [trace_addr, ptr] : shard.objects) {
+      free(ptr);
+      ++leaked;
+    }
+    shard.objects.clear();
+  }
+
+  printf("trace_replay: %llu allocs, %llu frees in %.3fs (%.0f ops/s)\n",
+         static_cast<unsigned long long>(allocs_replayed.load()),
+         static_cast<unsigned long long>(frees_replayed.load()), seconds,
+         (allocs_replayed.load() + frees_replayed.load()) / seconds);
+  printf("trace_replay: %llu unmatched frees skipped, %llu trace leaks freed "
+         "at exit\n",
+         static_cast<unsigned long long>(frees_unmatched.load()),
+         static_cast<unsigned long long>(leaked));
+
+  printf("%s\n", tcmalloc::MallocExtension::GetStats().c_str());
+  return 0;
+}
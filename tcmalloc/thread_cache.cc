@@ -26,6 +26,7 @@
 #include "tcmalloc/internal/config.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/page_heap_allocator.h"
+#include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
 #include "tcmalloc/transfer_cache.h"
 
@@ -36,6 +37,8 @@ namespace tcmalloc_internal {
 size_t ThreadCache::per_thread_cache_size_ = kMaxThreadCacheSize;
 size_t ThreadCache::overall_thread_cache_size_ = kDefaultOverallThreadCacheSize;
 int64_t ThreadCache::unclaimed_cache_space_ = kDefaultOverallThreadCacheSize;
+uint64_t ThreadCache::exit_recycled_object_bytes_ = 0;
+uint64_t ThreadCache::exit_recycled_capacity_bytes_ = 0;
 ThreadCache* ThreadCache::thread_heaps_ = nullptr;
 int ThreadCache::thread_heap_count_ = 0;
 ThreadCache* ThreadCache::next_memory_steal_ = nullptr;
@@ -59,12 +62,33 @@ ThreadCache::ThreadCache(pthread_t tid) {
     TC_ASSERT_LT(unclaimed_cache_space_, 0);
   }
 
+  // Until the per-cpu caches activate, this cache is the only fast path for
+  // its thread, and the primordial thread does the bulk of process startup
+  // through it.  Claim a full-size budget up front and start every list at a
+  // whole batch, so startup allocation fetches full batches from the transfer
+  // cache immediately instead of paying a lock trip per slow-start step and a
+  // Scavenge every kStealAmount of growth.  Activation deletes the cache
+  // through BecomeIdle, draining the cached objects to the transfer caches
+  // and returning the budget; slow-start only protects long-lived mostly-idle
+  // caches, which these are not.
+  const bool bootstrap =
+      Parameters::per_cpu_caches() && !tc_globals.CpuCacheActive();
+  if (bootstrap && max_size_ < kMaxThreadCacheSize) {
+    // Possibly take unclaimed_cache_space_ negative, as above.
+    unclaimed_cache_space_ -= kMaxThreadCacheSize - max_size_;
+    max_size_ = kMaxThreadCacheSize;
+  }
+
   next_ = nullptr;
   prev_ = nullptr;
   tid_ = tid;
   in_setspecific_ = false;
   for (size_t size_class = 0; size_class < kNumClasses; ++size_class) {
     list_[size_class].Init();
+    if (bootstrap) {
+      list_[size_class].set_max_length(
+          tc_globals.sizemap().num_objects_to_move(size_class));
+    }
   }
 
   (void)padding_;  // to suppress "private field is not used" warning
@@ -101,12 +125,17 @@ void* ThreadCache::FetchFromTransferCache(size_t size_class, size_t byte_size) {
     list->PushBatch(fetch_count, batch + 1);
   }
 
-  // Increase max length slowly up to batch_size.  After that,
-  // increase by batch_size in one shot so that the length is a
-  // multiple of batch_size.
+  // Increase max length slowly up to batch_size.  After that, grow by
+  // batch_size in one shot -- so that the length stays a multiple of
+  // batch_size -- but only once misses arrive in an uninterrupted run, as
+  // CpuCache::PerClassResizeInfo does for the per-cpu caches.  A hot list
+  // misses on every fetch and still grows by a batch each time, while a
+  // list that bounces between overflow and underflow no longer ratchets its
+  // max_length up on every miss.
+  const uint32_t successive = list->RecordUnderflow();
   if (list->max_length() < batch_size) {
     list->set_max_length(list->max_length() + 1);
-  } else {
+  } else if (successive >= kMaxOverages) {
     // Don't let the list get too long.
     size_t new_length =
         std::min(list->max_length() + batch_size, kMaxDynamicFreeListLength);
@@ -129,17 +158,19 @@ void ThreadCache::ListTooLong(FreeList* list, size_t size_class) {
   // num_objects_to_move, so the code below tries to make max_length
   // converge on num_objects_to_move.
 
+  const uint32_t successive = list->RecordOverflow();
   if (list->max_length() < batch_size) {
     // Slow start the max_length so we don't overreserve.
     list->set_max_length(list->max_length() + 1);
   } else if (list->max_length() > batch_size) {
     // If we consistently go over max_length, shrink max_length.  If we don't
-    // shrink it, some amount of memory will always stay in this freelist.
-    list->set_length_overages(list->length_overages() + 1);
-    if (list->length_overages() > kMaxOverages) {
+    // shrink it, some amount of memory will always stay in this freelist.  An
+    // intervening fetch from the transfer cache resets the run, so a list
+    // that is both filling and draining keeps its capacity.
+    if (successive > kMaxOverages) {
       ASSERT(list->max_length() > batch_size);
       list->set_max_length(list->max_length() - batch_size);
-      list->set_length_overages(0);
+      list->ResetSuccessive();
     }
   }
 }
@@ -181,6 +212,9 @@ void ThreadCache::Scavenge() {
   // pretty soon and the low-water marks will be high on that call.
   for (int size_class = 0; size_class < kNumClasses; size_class++) {
     FreeList* list = &list_[size_class];
+    // Scavenge runs are the natural interval boundary for the per-class miss
+    // estimate: fold in the misses observed since the previous run.
+    list->UpdateDemandEstimate();
     const int lowmark = list->lowwatermark();
     if (lowmark > 0) {
       const int drop = (lowmark > 1) ? lowmark / 2 : 1;
@@ -192,10 +226,14 @@ void ThreadCache::Scavenge() {
       // max_length shinks below batch_size, the thread will have to
       // go through the slow-start behavior again.  The slow-start is useful
       // mainly for threads that stay relatively idle for their entire
-      // lifetime.
+      // lifetime.  The decayed miss estimate keeps capacity on lists that
+      // still fetch from the transfer cache every interval, even when their
+      // low-water mark briefly rises.
       const int batch_size =
           tc_globals.sizemap().num_objects_to_move(size_class);
-      if (list->max_length() > batch_size) {
+      const size_t demand_objects = list->demand_estimate() * batch_size;
+      if (list->max_length() > batch_size &&
+          list->max_length() > demand_objects) {
         list->set_max_length(
             std::max<int>(list->max_length() - batch_size, batch_size));
       }
@@ -222,9 +260,20 @@ void ThreadCache::IncreaseCacheLimit() {
 
 void ThreadCache::IncreaseCacheLimitLocked() {
   if (unclaimed_cache_space_ > 0) {
+    // Claim more than kStealAmount when the pool is flush, as it is after a
+    // burst of thread exits returns their capacity grants: survivors regain
+    // the dead threads' capacity in a few gulps instead of drifting back one
+    // kStealAmount per scavenge interval.
+    size_t claim = kStealAmount;
+    if (max_size_ + kStealAmount < per_thread_cache_size_) {
+      claim = std::min(
+          std::max(static_cast<size_t>(unclaimed_cache_space_) / 2,
+                   kStealAmount),
+          per_thread_cache_size_ - max_size_);
+    }
     // Possibly make unclaimed_cache_space_ negative.
-    unclaimed_cache_space_ -= kStealAmount;
-    max_size_ += kStealAmount;
+    unclaimed_cache_space_ -= claim;
+    max_size_ += claim;
     return;
   }
   // Don't hold pageheap_lock too long.  Try to steal from 10 other
@@ -353,11 +402,17 @@ void ThreadCache::DestroyThreadCache(void* ptr) {
 }
 
 void ThreadCache::DeleteCache(ThreadCache* heap) {
+  // Cleanup zeroes size_ as it merges the lists into the transfer caches, so
+  // note the cached bytes the dying thread is handing back first.
+  const uint64_t object_bytes = heap->size_;
+
   // Remove all memory from heap
   heap->Cleanup();
 
   // Remove from linked list
   PageHeapSpinLockHolder l;
+  exit_recycled_object_bytes_ += object_bytes;
+  exit_recycled_capacity_bytes_ += heap->max_size_;
   if (heap->next_ != nullptr) heap->next_->prev_ = heap->prev_;
   if (heap->prev_ != nullptr) heap->prev_->next_ = heap->next_;
   if (thread_heaps_ == heap) thread_heaps_ = heap->next_;
@@ -393,6 +448,20 @@ void ThreadCache::RecomputePerThreadCacheSize() {
   per_thread_cache_size_ = space;
 }
 
+void ThreadCache::GetOccupancyHistogram(uint64_t* buckets) {
+  for (size_t i = 0; i < kOccupancyBuckets; ++i) {
+    buckets[i] = 0;
+  }
+  for (ThreadCache* h = thread_heaps_; h != nullptr; h = h->next_) {
+    // max_size_ is at least kMinThreadCacheSize, so the division is safe.
+    size_t bucket = kOccupancyBuckets - 1;
+    if (h->size_ < h->max_size_) {
+      bucket = h->size_ * (kOccupancyBuckets - 1) / h->max_size_;
+    }
+    ++buckets[bucket];
+  }
+}
+
 AllocatorStats ThreadCache::GetStats(uint64_t* total_bytes,
                                      uint64_t* class_count) {
   for (ThreadCache* h = thread_heaps_; h != nullptr; h = h->next_) {
@@ -61,6 +61,29 @@ class ThreadCache {
   static AllocatorStats GetStats(uint64_t* total_bytes, uint64_t* class_count)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 
+  // Number of buckets in the occupancy histogram: one per decile of
+  // size_/max_size_, plus a final bucket for caches at or over their limit.
+  static constexpr size_t kOccupancyBuckets = 11;
+
+  // Fills buckets (an array of kOccupancyBuckets elements) with a histogram
+  // of live thread caches by occupancy, the ratio of cached bytes to the
+  // cache's capacity grant.  Bucket i counts caches with occupancy in
+  // [i * 10%, (i + 1) * 10%); the last bucket counts caches at or over their
+  // limit.
+  static void GetOccupancyHistogram(uint64_t* buckets)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
+
+  // Cumulative bytes handed back by dying threads: object bytes merged into
+  // the transfer caches and capacity grants returned to the unclaimed pool.
+  static uint64_t exit_recycled_object_bytes()
+      ABSL_SHARED_LOCKS_REQUIRED(pageheap_lock) {
+    return exit_recycled_object_bytes_;
+  }
+  static uint64_t exit_recycled_capacity_bytes()
+      ABSL_SHARED_LOCKS_REQUIRED(pageheap_lock) {
+    return exit_recycled_capacity_bytes_;
+  }
+
   // Sets the total thread cache size to new_size, recomputing the
   // individual thread cache sizes as necessary.
   static void set_overall_thread_cache_size(size_t new_size)
@@ -80,16 +103,39 @@ class ThreadCache {
    private:
     uint32_t lowater_;     // Low water mark for list length.
     uint32_t max_length_;  // Dynamic max list length based on usage.
-    // Tracks the number of times a deallocation has caused
-    // length_ > max_length_.  After the kMaxOverages'th time, max_length_
-    // shrinks and length_overages_ is reset to zero.
-    uint32_t length_overages_;
+    // Miss-adaptive sizing state, modeled on CpuCache::PerClassResizeInfo.
+    // The thread cache is single-threaded, so plain integers replace the
+    // packed atomic state used there.
+    uint32_t total_misses_;     // Fetches from the transfer cache.
+    uint32_t interval_misses_;  // total_misses_ at the last Scavenge.
+    // Decayed estimate of misses per scavenge interval, scaled by
+    // kDemandFractionBits.
+    uint32_t demand_estimate_;
+    uint16_t successive_;  // Successive same-direction updates.
+    bool overflow_;        // Direction of the last update.
+
+    // Updates the overflow/underflow direction tracking.  Returns the number
+    // of successive updates in the same direction, not counting this one if
+    // the direction changed.
+    uint32_t Update(bool overflow) {
+      successive_ = (overflow == overflow_) ? successive_ + 1 : 0;
+      overflow_ = overflow;
+      return successive_;
+    }
 
    public:
+    // Fractional bits of demand_estimate_, so the slow decay makes progress
+    // on small estimates.
+    static constexpr int kDemandFractionBits = 6;
+
     void Init() {
       lowater_ = 0;
       max_length_ = 1;
-      length_overages_ = 0;
+      total_misses_ = 0;
+      interval_misses_ = 0;
+      demand_estimate_ = 0;
+      successive_ = 0;
+      overflow_ = false;
     }
 
     // Return the maximum length of the list.
@@ -99,10 +145,47 @@ class ThreadCache {
     // client is responsible for removing objects from the list.
     void set_max_length(size_t new_max) { max_length_ = new_max; }
 
-    // Return the number of times that length() has gone over max_length().
-    size_t length_overages() const { return length_overages_; }
+    // Records a fetch from the transfer cache.  Returns the number of
+    // successive fetches with no intervening overflow, counting this one.
+    uint32_t RecordUnderflow() {
+      ++total_misses_;
+      return Update(false) + 1;
+    }
 
-    void set_length_overages(size_t new_count) { length_overages_ = new_count; }
+    // Records a deallocation that pushed the list over max_length().  Returns
+    // the number of successive overages with no intervening fetch, counting
+    // this one.
+    uint32_t RecordOverflow() { return Update(true) + 1; }
+
+    // Forgets the current run of same-direction updates, e.g. after acting
+    // on it by resizing the list.
+    void ResetSuccessive() { successive_ = 0; }
+
+    // Folds the misses observed since the last call into the demand
+    // estimate.  As in CpuCache::PerClassResizeInfo::UpdateDemandEstimate,
+    // the estimate has a fast attack and a slow decay: it jumps most of the
+    // way up when demand rises and loses only 1/64th per interval when
+    // demand falls, so a quiet spell does not erase what the next burst will
+    // need.
+    void UpdateDemandEstimate() {
+      const uint32_t scaled = (total_misses_ - interval_misses_)
+                              << kDemandFractionBits;
+      interval_misses_ = total_misses_;
+      if (scaled > demand_estimate_) {
+        // Fast attack: close 3/4 of the gap to the new demand.
+        demand_estimate_ +=
+            (scaled - demand_estimate_) - ((scaled - demand_estimate_) >> 2);
+      } else {
+        // Slow decay: lose 1/64th per interval.
+        demand_estimate_ -= demand_estimate_ >> 6;
+      }
+    }
+
+    // Decayed estimate of fetches from the transfer cache per scavenge
+    // interval.
+    size_t demand_estimate() const {
+      return demand_estimate_ >> kDemandFractionBits;
+    }
 
     // Low-water mark management
     int lowwatermark() const { return lowater_; }
@@ -190,6 +273,11 @@ class ThreadCache {
   // across all ThreadCaches.
   static int64_t unclaimed_cache_space_ ABSL_GUARDED_BY(pageheap_lock);
 
+  // Cumulative object bytes merged into the transfer caches and capacity
+  // bytes returned to unclaimed_cache_space_ by DeleteCache.
+  static uint64_t exit_recycled_object_bytes_ ABSL_GUARDED_BY(pageheap_lock);
+  static uint64_t exit_recycled_capacity_bytes_ ABSL_GUARDED_BY(pageheap_lock);
+
   // This class is laid out with the most frequently used fields
   // first so that hot elements are placed on the same cache line.
 
@@ -20,6 +20,7 @@
 #include <unistd.h>
 
 #include <limits>
+#include <optional>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 
@@ -27,6 +28,8 @@
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tcmalloc/common.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/memory_stats.h"
 #include "tcmalloc/internal/parameter_accessors.h"
@@ -132,5 +135,52 @@ TEST_F(ThreadCacheTest, NoLeakOnThreadDestruction) {
       << "Before: " << start_size << " After: " << end_size;
 }
 
+// Dying threads should hand back their cached objects and their capacity
+// grant the moment they exit, and the occupancy surface should see the live
+// caches.
+TEST_F(ThreadCacheTest, ExitRecyclesCacheImmediately) {
+  // Test only valid in per-thread mode
+  ASSERT_FALSE(MallocExtension::PerCpuCachesActive());
+
+  const auto property = [](const char* name) {
+    std::optional<size_t> value = MallocExtension::GetNumericProperty(name);
+    TC_CHECK(value.has_value());
+    return *value;
+  };
+  const size_t before_bytes =
+      property("tcmalloc.thread_cache_exit_recycled_bytes");
+  const size_t before_capacity =
+      property("tcmalloc.thread_cache_exit_recycled_capacity");
+
+  static constexpr size_t kThreads = 32;
+  for (int i = 0; i < kThreads; ++i) {
+    std::thread t([]() {
+      void* p = ::operator new(1024);
+      benchmark::DoNotOptimize(p);
+      ::operator delete(p);
+    });
+    t.join();
+  }
+
+  // Each dead thread returned at least a minimum-size capacity grant, and the
+  // freed objects it still cached went back to the transfer caches.
+  EXPECT_GE(property("tcmalloc.thread_cache_exit_recycled_capacity"),
+            before_capacity +
+                kThreads * tcmalloc_internal::kMinThreadCacheSize);
+  EXPECT_GT(property("tcmalloc.thread_cache_exit_recycled_bytes"),
+            before_bytes);
+
+  // The occupancy histogram reports every bucket and sees at least this
+  // thread's cache.
+  uint64_t occupancy[MallocExtension::kThreadCacheOccupancyBuckets];
+  ASSERT_EQ(MallocExtension::GetThreadCacheOccupancy(absl::MakeSpan(occupancy)),
+            MallocExtension::kThreadCacheOccupancyBuckets);
+  uint64_t caches = 0;
+  for (uint64_t bucket : occupancy) {
+    caches += bucket;
+  }
+  EXPECT_GE(caches, 1);
+}
+
 }  // namespace
 }  // namespace tcmalloc
@@ -21,7 +21,10 @@
 
 #include "absl/base/attributes.h"
 #include "absl/types/span.h"
+#include "tcmalloc/internal/cache_topology.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/sysinfo.h"
+#include "tcmalloc/parameters.h"
 #include "tcmalloc/static_vars.h"
 
 GOOGLE_MALLOC_SECTION_BEGIN
@@ -36,6 +39,12 @@ size_t StaticForwarder::class_to_size(int size_class) {
 size_t StaticForwarder::num_objects_to_move(int size_class) {
   return tc_globals.sizemap().num_objects_to_move(size_class);
 }
+bool StaticForwarder::sort_inserted_batches() {
+  return Parameters::sort_transfer_cache_batches();
+}
+int32_t StaticForwarder::max_capacity_scale() {
+  return Parameters::transfer_cache_capacity_scale();
+}
 void *StaticForwarder::Alloc(size_t size, std::align_val_t alignment) {
   return tc_globals.arena().Alloc(size, alignment);
 }
@@ -44,6 +53,30 @@ ABSL_CONST_INIT bool ShardedStaticForwarder::use_generic_cache_(false);
 ABSL_CONST_INIT bool
     ShardedStaticForwarder::enable_cache_for_large_classes_only_(false);
 
+ABSL_CONST_INIT unsigned ProdCpuLayout::numa_partitions_(1);
+
+unsigned ProdCpuLayout::NumShards() {
+  // Latch the partition count here: NumShards() is called exactly once, when
+  // the sharded transfer cache initializes, before any CpuShard() lookup.
+  // The NUMA topology is initialized earlier in Static::SlowInitIfNecessary.
+  numa_partitions_ = Parameters::sharded_transfer_cache_numa_aware()
+                         ? tc_globals.numa_topology().active_partitions()
+                         : 1;
+  return numa_partitions_ * CacheTopology::Instance().l3_count();
+}
+
+int ProdCpuLayout::NumCpus() { return NumCPUs(); }
+
+unsigned ProdCpuLayout::CpuShard(int cpu) {
+  const CacheTopology& topology = CacheTopology::Instance();
+  unsigned shard = topology.GetL3FromCpuId(cpu);
+  if (numa_partitions_ > 1) {
+    shard += tc_globals.numa_topology().GetCpuPartition(cpu) *
+             topology.l3_count();
+  }
+  return shard;
+}
+
 void BackingTransferCache::InsertRange(absl::Span<void *> batch) const {
   tc_globals.transfer_cache().InsertRange(size_class_, batch);
 }
@@ -21,13 +21,18 @@
 #include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <limits>
 #include <new>
 
 #include "absl/base/attributes.h"
 #include "absl/base/call_once.h"
+#include "absl/base/const_init.h"
+#include "absl/base/internal/cycleclock.h"
+#include "absl/base/internal/spinlock.h"
 #include "absl/base/optimization.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "tcmalloc/central_freelist.h"
 #include "tcmalloc/common.h"
@@ -35,9 +40,12 @@
 #include "tcmalloc/experiment_config.h"
 #include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/cache_topology.h"
+#include "tcmalloc/internal/clock.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/explicitly_constructed.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/internal/percpu.h"
+#include "tcmalloc/internal/timeseries_tracker.h"
 #include "tcmalloc/parameters.h"
 #include "tcmalloc/transfer_cache_stats.h"
 
@@ -66,6 +74,8 @@ class StaticForwarder {
 
   static size_t class_to_size(int size_class);
   static size_t num_objects_to_move(int size_class);
+  static bool sort_inserted_batches();
+  static int32_t max_capacity_scale();
   static void *Alloc(size_t size, std::align_val_t alignment = kAlignment)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock);
 };
@@ -98,13 +108,22 @@ class ShardedStaticForwarder : public StaticForwarder {
   static bool enable_cache_for_large_classes_only_;
 };
 
+// Maps CPUs to sharded transfer cache shards.  By default a shard covers one
+// L3 cache domain.  When Parameters::sharded_transfer_cache_numa_aware() is
+// set before initialization, CPUs are partitioned by NUMA domain first and L3
+// domain second, so that threads running on one node never touch the shard
+// metadata (or cached objects) of another node.
 class ProdCpuLayout {
  public:
-  static unsigned NumShards() { return CacheTopology::Instance().l3_count(); }
+  static unsigned NumShards();
+  static int NumCpus();
   static int CurrentCpu() { return subtle::percpu::RseqCpuId(); }
-  static unsigned CpuShard(int cpu) {
-    return CacheTopology::Instance().GetL3FromCpuId(cpu);
-  }
+  static unsigned CpuShard(int cpu);
+
+ private:
+  // Number of NUMA partitions to shard by, latched by NumShards() when the
+  // sharded transfer cache initializes.  1 when NUMA sharding is disabled.
+  static unsigned numa_partitions_;
 };
 
 // Forwards calls to the unsharded TransferCache.
@@ -117,6 +136,11 @@ class BackingTransferCache {
   ABSL_MUST_USE_RESULT int RemoveRange(void **batch, int n) const;
   int size_class() const { return size_class_; }
 
+  // No locks of its own: inserts and removes forward to the non-sharded
+  // transfer cache, whose locks the fork handlers acquire separately.
+  void AcquireInternalLocks() const {}
+  void ReleaseInternalLocks() const {}
+
  private:
   int size_class_ = -1;
 };
@@ -148,6 +172,14 @@ class ShardedTransferCacheManagerBase {
     for (int shard = 0; shard < num_shards_; ++shard) {
       new (&shards_[shard]) Shard;
     }
+    num_outboxes_ = cpu_layout_->NumCpus();
+    outboxes_ = reinterpret_cast<Outbox *>(
+        owner_->Alloc(sizeof(Outbox) * num_outboxes_,
+                      std::align_val_t{ABSL_CACHELINE_SIZE}));
+    TC_ASSERT_NE(outboxes_, nullptr);
+    for (int cpu = 0; cpu < num_outboxes_; ++cpu) {
+      new (&outboxes_[cpu]) Outbox;
+    }
     for (int size_class = 0; size_class < kNumClasses; ++size_class) {
       const int size_per_object = Manager::class_to_size(size_class);
       // We enable sharded transfer cache for all the size classes when a
@@ -171,17 +203,26 @@ class ShardedTransferCacheManagerBase {
     return active_for_class_[size_class];
   }
 
+  size_t ShardTotalBytes(int shard) const {
+    if (shards_ == nullptr || shard < 0 || shard >= num_shards_ ||
+        !shard_initialized(shard)) {
+      return 0;
+    }
+    size_t out = 0;
+    for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+      const int bytes_per_entry = Manager::class_to_size(size_class);
+      if (bytes_per_entry <= 0) continue;
+      out += shards_[shard].transfer_caches[size_class].tc_length() *
+             bytes_per_entry;
+    }
+    return out;
+  }
+
   size_t TotalBytes() const {
     if (shards_ == nullptr) return 0;
     size_t out = 0;
     for (int shard = 0; shard < num_shards_; ++shard) {
-      if (!shard_initialized(shard)) continue;
-      for (int size_class = 0; size_class < kNumClasses; ++size_class) {
-        const int bytes_per_entry = Manager::class_to_size(size_class);
-        if (bytes_per_entry <= 0) continue;
-        out += shards_[shard].transfer_caches[size_class].tc_length() *
-               bytes_per_entry;
-      }
+      out += ShardTotalBytes(shard);
     }
     return out;
   }
@@ -208,6 +249,88 @@ class ShardedTransferCacheManagerBase {
     get_cache(size_class).InsertRange(size_class, {&ptr, 1});
   }
 
+  // Remote frees arrive through the cpu-cache bypass one object at a time,
+  // and each Push above takes the destination shard's lock.  The outbox
+  // parks up to kOutboxObjects frees per cpu and moves them into the shard
+  // as one grouped burst, so a producer-consumer pair crossing cpus pays
+  // the shard lock once per burst instead of once per object.
+  static constexpr int kOutboxObjects = 32;
+
+  // Buffers ptr in the current cpu's outbox; when the outbox is full, the
+  // whole burst moves to this cpu's shard, grouped by size class.
+  void PushOutbox(int size_class, void *ptr) {
+    ASSERT(subtle::percpu::IsFastNoInit());
+    if (ABSL_PREDICT_FALSE(outboxes_ == nullptr)) {
+      Push(size_class, ptr);
+      return;
+    }
+    const int cpu = cpu_layout_->CurrentCpu();
+    Outbox &box = outboxes_[cpu];
+    void *objects[kOutboxObjects + 1];
+    uint16_t classes[kOutboxObjects + 1];
+    int count;
+    {
+      AllocationGuardSpinLockHolder h(&box.lock);
+      if (ABSL_PREDICT_TRUE(box.count < kOutboxObjects)) {
+        box.object[box.count] = ptr;
+        box.size_class[box.count] = size_class;
+        ++box.count;
+        return;
+      }
+      count = box.count;
+      std::copy_n(box.object, count, objects);
+      std::copy_n(box.size_class, count, classes);
+      box.count = 0;
+    }
+    objects[count] = ptr;
+    classes[count] = static_cast<uint16_t>(size_class);
+    FlushSpill(cpu, objects, classes, count + 1);
+  }
+
+  // Returns an object of size_class buffered in the current cpu's outbox if
+  // there is one -- the hottest free memory we have -- and otherwise falls
+  // back to the shard.
+  void *PopOutbox(int size_class) {
+    ASSERT(subtle::percpu::IsFastNoInit());
+    if (ABSL_PREDICT_TRUE(outboxes_ != nullptr)) {
+      Outbox &box = outboxes_[cpu_layout_->CurrentCpu()];
+      AllocationGuardSpinLockHolder h(&box.lock);
+      for (int i = box.count; i-- > 0;) {
+        if (box.size_class[i] == size_class) {
+          void *got = box.object[i];
+          --box.count;
+          box.object[i] = box.object[box.count];
+          box.size_class[i] = box.size_class[box.count];
+          return got;
+        }
+      }
+    }
+    return Pop(size_class);
+  }
+
+  // Moves every buffered outbox object into its owning cpu's shard.  Called
+  // alongside Plunder from the background thread, so frees made by a cpu
+  // that has since gone idle do not linger in its outbox.
+  void FlushOutboxes() {
+    if (outboxes_ == nullptr) return;
+    for (int cpu = 0; cpu < num_outboxes_; ++cpu) {
+      Outbox &box = outboxes_[cpu];
+      void *objects[kOutboxObjects];
+      uint16_t classes[kOutboxObjects];
+      int count;
+      {
+        AllocationGuardSpinLockHolder h(&box.lock);
+        count = box.count;
+        std::copy_n(box.object, count, objects);
+        std::copy_n(box.size_class, count, classes);
+        box.count = 0;
+      }
+      if (count > 0) {
+        FlushSpill(cpu, objects, classes, count);
+      }
+    }
+  }
+
   void Print(Printer *out) const {
     out->printf("------------------------------------------------\n");
     out->printf("Cumulative sharded transfer cache stats.\n");
@@ -289,6 +412,7 @@ class ShardedTransferCacheManagerBase {
   // to the non-sharded TransferCache.
   void Plunder() {
     if (shards_ == nullptr || num_shards_ == 0) return;
+    FlushOutboxes();
     for (int shard = 0; shard < num_shards_; ++shard) {
       if (!shard_initialized(shard)) continue;
       for (int size_class = 0; size_class < kNumClasses; ++size_class) {
@@ -310,6 +434,36 @@ class ShardedTransferCacheManagerBase {
     return shards_[shard].initialized.load(std::memory_order_acquire);
   }
 
+  // Used by the fork handlers to quiesce all initialized shards across
+  // fork(), so the child does not inherit a held lock.
+  void AcquireInternalLocks() {
+    if (outboxes_ != nullptr) {
+      for (int cpu = 0; cpu < num_outboxes_; ++cpu) {
+        outboxes_[cpu].lock.Lock();
+      }
+    }
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      if (!shard_initialized(shard)) continue;
+      for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+        shards_[shard].transfer_caches[size_class].AcquireInternalLocks();
+      }
+    }
+  }
+
+  void ReleaseInternalLocks() {
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      if (!shard_initialized(shard)) continue;
+      for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+        shards_[shard].transfer_caches[size_class].ReleaseInternalLocks();
+      }
+    }
+    if (outboxes_ != nullptr) {
+      for (int cpu = 0; cpu < num_outboxes_; ++cpu) {
+        outboxes_[cpu].lock.Unlock();
+      }
+    }
+  }
+
   bool UseCacheForLargeClassesOnly() const {
     return Manager::EnableCacheForLargeClassesOnly();
   }
@@ -339,6 +493,38 @@ class ShardedTransferCacheManagerBase {
     std::atomic<bool> initialized;
   };
 
+  // Per-cpu buffer of frees awaiting a grouped flush to the cpu's shard.
+  // Only the resident cpu normally touches its outbox, so the lock is all
+  // but uncontended; it exists for preemption, migration, and the
+  // background flush.
+  struct alignas(ABSL_CACHELINE_SIZE) Outbox {
+    absl::base_internal::SpinLock lock{
+        absl::kConstInit, absl::base_internal::SCHEDULE_KERNEL_ONLY};
+    int count ABSL_GUARDED_BY(lock) = 0;
+    uint16_t size_class[kOutboxObjects] ABSL_GUARDED_BY(lock);
+    void *object[kOutboxObjects] ABSL_GUARDED_BY(lock);
+  };
+
+  // Inserts the n objects, grouped by size class, into the shard serving
+  // cpu.  Entries are consumed (nulled) as their class's batch is built, so
+  // a mixed burst performs one InsertRange per distinct class.
+  void FlushSpill(int cpu, void **objects, uint16_t *classes, int n) {
+    for (int i = 0; i < n; ++i) {
+      if (objects[i] == nullptr) continue;
+      const int size_class = classes[i];
+      void *batch[kOutboxObjects + 1];
+      int count = 0;
+      for (int j = i; j < n; ++j) {
+        if (objects[j] != nullptr && classes[j] == size_class) {
+          batch[count++] = objects[j];
+          objects[j] = nullptr;
+        }
+      }
+      get_cache_on_cpu(size_class, cpu).InsertRange(
+          size_class, absl::Span<void *>(batch, count));
+    }
+  }
+
   struct Capacity {
     int capacity;
     int max_capacity;
@@ -381,10 +567,9 @@ class ShardedTransferCacheManagerBase {
   }
 
   // Returns the cache shard corresponding to the given size class and the
-  // current cpu's L3 node. The cache will be initialized if required.
-  TransferCache &get_cache(int size_class) {
-    const uint8_t shard_index =
-        cpu_layout_->CpuShard(cpu_layout_->CurrentCpu());
+  // L3 node of the given cpu. The cache will be initialized if required.
+  TransferCache &get_cache_on_cpu(int size_class, int cpu) {
+    const uint8_t shard_index = cpu_layout_->CpuShard(cpu);
     TC_ASSERT_LT(shard_index, num_shards_);
     Shard &shard = shards_[shard_index];
     absl::base_internal::LowLevelCallOnce(
@@ -392,7 +577,15 @@ class ShardedTransferCacheManagerBase {
     return shard.transfer_caches[size_class];
   }
 
+  // Returns the cache shard corresponding to the given size class and the
+  // current cpu's L3 node. The cache will be initialized if required.
+  TransferCache &get_cache(int size_class) {
+    return get_cache_on_cpu(size_class, cpu_layout_->CurrentCpu());
+  }
+
   Shard *shards_ = nullptr;
+  Outbox *outboxes_ = nullptr;
+  int num_outboxes_ = 0;
   int num_shards_ = 0;
   std::atomic<int> active_shards_ = 0;
   bool active_for_class_[kNumClasses] = {false};
@@ -404,6 +597,74 @@ using ShardedTransferCacheManager =
     ShardedTransferCacheManagerBase<ShardedStaticForwarder, ProdCpuLayout,
                                     BackingTransferCache>;
 
+// Tracks per-size-class transfer cache miss volume over a sliding time
+// window, so that capacity decisions can follow sustained demand rather than
+// the misses of a single resize interval.  Reports and queries are expected
+// to come from the background thread only.
+class TransferCacheMissTracker {
+ public:
+  constexpr TransferCacheMissTracker() = default;
+
+  void Init() {
+    tracker_.Construct(
+        Clock{.now = absl::base_internal::CycleClock::Now,
+              .freq = absl::base_internal::CycleClock::Frequency},
+        kWindow);
+  }
+
+  // Records the misses a size class incurred during the resize interval that
+  // just ended.
+  void Report(int size_class, size_t misses) {
+    tracker_.get_mutable().Report(
+        {size_class,
+         static_cast<uint32_t>(std::min<size_t>(
+             misses, std::numeric_limits<uint32_t>::max()))});
+  }
+
+  // Returns the largest miss volume the size class accumulated in any single
+  // epoch within the window.
+  size_t MaxMisses(int size_class) {
+    size_t max_misses = 0;
+    tracker_.get_mutable().Iter(
+        [&](size_t, int64_t, const MissEntry& e) {
+          max_misses = std::max<size_t>(max_misses, e.misses[size_class]);
+        },
+        MissTracker::kSkipEmptyEntries);
+    return max_misses;
+  }
+
+ private:
+  struct MissUpdate {
+    int size_class;
+    uint32_t misses;
+  };
+
+  struct MissEntry {
+    static MissEntry Nil() { return MissEntry(); }
+
+    void Report(MissUpdate u) {
+      misses[u.size_class] = static_cast<uint32_t>(
+          std::min<uint64_t>(uint64_t{misses[u.size_class]} + u.misses,
+                             std::numeric_limits<uint32_t>::max()));
+      reported = true;
+    }
+
+    bool empty() const { return !reported; }
+
+    uint32_t misses[kNumClasses] = {0};
+    bool reported = false;
+  };
+
+  static constexpr size_t kEpochs = 16;
+  static constexpr absl::Duration kWindow = absl::Minutes(10);
+
+  using MissTracker = TimeSeriesTracker<MissEntry, MissUpdate, kEpochs>;
+
+  // Constructed in Init(); the clock-dependent constructor cannot run at
+  // static initialization time.
+  ExplicitlyConstructed<MissTracker> tracker_;
+};
+
 class TransferCacheManager : public StaticForwarder {
   template <typename CentralFreeList, typename Manager>
   friend class internal_transfer_cache::TransferCache;
@@ -421,6 +682,7 @@ class TransferCacheManager : public StaticForwarder {
 
   void Init() ABSL_EXCLUSIVE_LOCKS_REQUIRED(pageheap_lock) {
     InitCaches();
+    miss_tracker_.Init();
   }
 
   void InsertRange(int size_class, absl::Span<void *> batch) {
@@ -445,6 +707,20 @@ class TransferCacheManager : public StaticForwarder {
     return cache_[size_class].tc.freelist();
   }
 
+  // Used by the fork handlers to quiesce every transfer cache and central
+  // freelist across fork(), so the child does not inherit a held lock.
+  void AcquireInternalLocks() {
+    for (int i = 0; i < kNumClasses; ++i) {
+      cache_[i].tc.AcquireInternalLocks();
+    }
+  }
+
+  void ReleaseInternalLocks() {
+    for (int i = 0; i < kNumClasses; ++i) {
+      cache_[i].tc.ReleaseInternalLocks();
+    }
+  }
+
   bool CanIncreaseCapacity(int size_class) const {
     return cache_[size_class].tc.CanIncreaseCapacity(size_class);
   }
@@ -458,6 +734,13 @@ class TransferCacheManager : public StaticForwarder {
   // Tries to resize transfer caches based on the number of misses that they
   // incurred during the previous resize interval.
   void TryResizingCaches() {
+    // Apply the deployment tier's capacity ceiling first, so that a raised
+    // ceiling is already visible to this pass's grow decisions.  This is a
+    // no-op unless Parameters::transfer_cache_capacity_scale() changed.
+    const int32_t scale = max_capacity_scale();
+    for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+      cache_[size_class].tc.SetMaxCapacityScale(scale, size_class);
+    }
     internal_transfer_cache::TryResizingCaches(*this);
   }
 
@@ -467,6 +750,49 @@ class TransferCacheManager : public StaticForwarder {
   void TryPlunder() {
     for (int size_class = 0; size_class < kNumClasses; ++size_class) {
       cache_[size_class].tc.TryPlunder(size_class);
+      // Plundered batches may have been parked on the freelist's lock-free
+      // batch stack; drain it so the underlying spans become reclaimable.
+      central_freelist(size_class).DrainBatchStack();
+      // Likewise, completely-free spans parked for same-class reuse go back
+      // to the page heap if a plunder interval passed without reuse.
+      central_freelist(size_class).DrainSpanCache();
+    }
+  }
+
+  // Maximum number of size classes whose central freelists may use the
+  // lock-free batch stack.
+  static constexpr int kMaxLockFreeFreelists = 8;
+
+  // Enables the lock-free batch stack in the central freelists of the size
+  // classes with the highest freelist traffic (cumulative object misses in
+  // the transfer cache).  Invoked periodically from the background thread
+  // while Parameters::lock_free_central_freelist() is set; enabling is
+  // one-way, so repeated invocations only top up the set as traffic shifts.
+  void MaybeEnableLockFreeFreelists() {
+    int remaining = kMaxLockFreeFreelists;
+    uint64_t misses[kNumClasses] = {0};
+    int candidates[kNumClasses];
+    int num_candidates = 0;
+    for (int size_class = 1; size_class < kNumClasses; ++size_class) {
+      if (central_freelist(size_class).batch_stack_enabled()) {
+        --remaining;
+        continue;
+      }
+      const TransferCacheStats stats = GetStats(size_class);
+      misses[size_class] =
+          stats.insert_object_misses + stats.remove_object_misses;
+      if (misses[size_class] > 0) {
+        candidates[num_candidates++] = size_class;
+      }
+    }
+    std::sort(candidates, candidates + num_candidates,
+              [&misses](int a, int b) { return misses[a] > misses[b]; });
+    for (int i = 0; i < num_candidates && remaining > 0; ++i) {
+      // EnableBatchStack declines classes that cannot host the stack (e.g.
+      // objects too small to chain); skip those and keep looking.
+      if (central_freelist(candidates[i]).EnableBatchStack()) {
+        --remaining;
+      }
     }
   }
 
@@ -486,7 +812,16 @@ class TransferCacheManager : public StaticForwarder {
   }
 
   size_t FetchCommitIntervalMisses(int size_class) {
-    return cache_[size_class].tc.FetchCommitIntervalMisses();
+    const size_t misses = cache_[size_class].tc.FetchCommitIntervalMisses();
+    if (!Parameters::transfer_cache_miss_history()) {
+      return misses;
+    }
+    // Rank the class by its peak demand over the recent window rather than
+    // the last interval alone, so that a class whose hot phase briefly
+    // pauses does not immediately surrender its capacity to the classes that
+    // happen to be hot right now.
+    miss_tracker_.Report(size_class, misses);
+    return miss_tracker_.MaxMisses(size_class);
   }
 
   void Print(Printer *out) const {
@@ -541,6 +876,7 @@ class TransferCacheManager : public StaticForwarder {
     bool dummy;
   };
   Cache cache_[kNumClasses];
+  TransferCacheMissTracker miss_tracker_;
 } ABSL_CACHELINE_ALIGNED;
 
 #else
@@ -578,6 +914,18 @@ class TransferCacheManager {
     return freelist_[size_class];
   }
 
+  void AcquireInternalLocks() {
+    for (int i = 0; i < kNumClasses; ++i) {
+      freelist_[i].AcquireInternalLocks();
+    }
+  }
+
+  void ReleaseInternalLocks() {
+    for (int i = 0; i < kNumClasses; ++i) {
+      freelist_[i].ReleaseInternalLocks();
+    }
+  }
+
   void Print(Printer* out) const {}
   void PrintInPbtxt(PbtxtRegion* region) const {}
 
@@ -596,8 +944,11 @@ struct ShardedTransferCacheManager {
     return 0;
   }
   static constexpr void InsertRange(int size_class, absl::Span<void*> batch) {}
+  static constexpr size_t ShardTotalBytes(int shard) { return 0; }
   static constexpr size_t TotalBytes() { return 0; }
   static constexpr void Plunder() {}
+  static constexpr void AcquireInternalLocks() {}
+  static constexpr void ReleaseInternalLocks() {}
   static int tc_length(int cpu, int size_class) { return 0; }
   static int TotalObjectsOfClass(int size_class) { return 0; }
   static constexpr TransferCacheStats GetStats(int size_class) { return {}; }
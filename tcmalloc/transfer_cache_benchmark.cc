@@ -140,6 +140,27 @@ void BM_RemoveRange(benchmark::State& state) {
   }
 }
 
+// Variants with address-sorted batches (Parameters::
+// sort_transfer_cache_batches in production), to measure the producer-side
+// sort cost against the plain insert/remove paths above.
+template <typename Env>
+void BM_CrossThreadSorted(benchmark::State& state) {
+  FakeTransferCacheManager::SetSortInsertedBatches(true);
+  BM_CrossThread<Env>(state);
+  // The shared state is torn down by thread 0 after all threads have left the
+  // timing loop; reset the knob at the same point.
+  if (state.thread_index() == 0) {
+    FakeTransferCacheManager::SetSortInsertedBatches(false);
+  }
+}
+
+template <typename Env>
+void BM_InsertRangeSorted(benchmark::State& state) {
+  FakeTransferCacheManager::SetSortInsertedBatches(true);
+  BM_InsertRange<Env>(state);
+  FakeTransferCacheManager::SetSortInsertedBatches(false);
+}
+
 template <typename Env>
 void BM_RealisticBatchNonBatchMutations(benchmark::State& state) {
   const int kBatchSize = Env::kBatchSize;
@@ -228,7 +249,9 @@ void BM_RealisticHitRate(benchmark::State& state) {
 }
 
 BENCHMARK_TEMPLATE(BM_CrossThread, TransferCacheEnv)->ThreadRange(2, 64);
+BENCHMARK_TEMPLATE(BM_CrossThreadSorted, TransferCacheEnv)->ThreadRange(2, 64);
 BENCHMARK_TEMPLATE(BM_InsertRange, TransferCacheEnv);
+BENCHMARK_TEMPLATE(BM_InsertRangeSorted, TransferCacheEnv);
 BENCHMARK_TEMPLATE(BM_RemoveRange, TransferCacheEnv);
 BENCHMARK_TEMPLATE(BM_RealisticBatchNonBatchMutations, TransferCacheEnv);
 BENCHMARK_TEMPLATE(BM_RealisticHitRate, TransferCacheEnv);
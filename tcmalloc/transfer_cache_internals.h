@@ -24,6 +24,7 @@
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <limits>
 
 #include "absl/base/attributes.h"
 #include "absl/base/const_init.h"
@@ -32,9 +33,9 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/types/span.h"
 #include "tcmalloc/common.h"
-#include "tcmalloc/internal/allocation_guard.h"
 #include "tcmalloc/internal/atomic_stats_counter.h"
 #include "tcmalloc/internal/config.h"
+#include "tcmalloc/internal/lock_telemetry.h"
 #include "tcmalloc/internal/logging.h"
 #include "tcmalloc/transfer_cache_stats.h"
 
@@ -99,13 +100,16 @@ class TransferCache {
         low_water_mark_(0),
         slot_info_(SizeInfo({0, capacity.capacity})),
         slots_(nullptr),
+        slots_size_(capacity.max_capacity),
         freelist_do_not_access_directly_(),
         owner_(owner),
-        max_capacity_(capacity.max_capacity) {
+        max_capacity_(capacity.max_capacity),
+        baseline_max_capacity_(capacity.max_capacity) {
     freelist().Init(size_class, use_all_buckets_for_few_object_spans);
-    slots_ = max_capacity_ != 0 ? reinterpret_cast<void **>(owner_->Alloc(
-                                      max_capacity_ * sizeof(void *)))
-                                : nullptr;
+    slots_ = capacity.max_capacity != 0
+                 ? reinterpret_cast<void **>(owner_->Alloc(
+                       capacity.max_capacity * sizeof(void *)))
+                 : nullptr;
   }
 
   TransferCache(const TransferCache &) = delete;
@@ -154,9 +158,18 @@ class TransferCache {
       ABSL_LOCKS_EXCLUDED(lock_) {
     const int N = batch.size();
     ASSERT(0 < N && N <= kMaxObjectsToMove);
+    // Optionally sort the donated batch by address.  Inserts and removes both
+    // preserve batch order, so a batch sorted here later leaves RemoveRange as
+    // an ascending run: objects from the same span sit next to each other and
+    // the consumer's subsequent writes (freelist pointers, then the
+    // application's) walk memory sequentially instead of in free order.  The
+    // cost lands on the producer side, outside the lock.
+    if (ABSL_PREDICT_FALSE(Manager::sort_inserted_batches())) {
+      std::sort(batch.begin(), batch.end());
+    }
     auto info = slot_info_.load(std::memory_order_relaxed);
     if (info.capacity > info.used) {
-      AllocationGuardSpinLockHolder h(&lock_);
+      TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
       // As caches are resized in the background, we do not attempt to grow
       // them here. Instead, we just check if they have spare free capacity.
       info = slot_info_.load(std::memory_order_relaxed);
@@ -187,7 +200,7 @@ class TransferCache {
     ASSERT(0 < N && N <= kMaxObjectsToMove);
     auto info = slot_info_.load(std::memory_order_relaxed);
     if (info.used) {
-      AllocationGuardSpinLockHolder h(&lock_);
+      TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
       // Refetch with the lock
       info = slot_info_.load(std::memory_order_relaxed);
       int got = std::min(N, info.used);
@@ -211,7 +224,7 @@ class TransferCache {
   // call to TryPlunder. We plunder all those objects to the freelist, as the
   // objects not used within a full cycle are unlikely to be used again.
   void TryPlunder(int size_class) ABSL_LOCKS_EXCLUDED(lock_) {
-    if (max_capacity_ == 0) return;
+    if (max_capacity_.load(std::memory_order_relaxed) == 0) return;
     if (!lock_.TryLock()) return;
 
     int to_return = low_water_mark_;
@@ -265,7 +278,7 @@ class TransferCache {
     auto info = slot_info_.load(std::memory_order_relaxed);
     stats.used = info.used;
     stats.capacity = info.capacity;
-    stats.max_capacity = max_capacity_;
+    stats.max_capacity = max_capacity_.load(std::memory_order_relaxed);
 
     return stats;
   }
@@ -279,10 +292,12 @@ class TransferCache {
   bool IncreaseCacheCapacity(int size_class) ABSL_LOCKS_EXCLUDED(lock_) {
     int n = Manager::num_objects_to_move(size_class);
 
-    AllocationGuardSpinLockHolder h(&lock_);
+    TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
     auto info = slot_info_.load(std::memory_order_relaxed);
     // Check if we can expand this cache?
-    if (info.capacity + n > max_capacity_) return false;
+    if (info.capacity + n > max_capacity_.load(std::memory_order_relaxed)) {
+      return false;
+    }
     // Increase capacity of the cache.
     info.capacity += n;
     SetSlotInfo(info);
@@ -293,7 +308,7 @@ class TransferCache {
   bool CanIncreaseCapacity(int size_class) const ABSL_LOCKS_EXCLUDED(lock_) {
     int n = Manager::num_objects_to_move(size_class);
     auto info = GetSlotInfo();
-    return max_capacity_ - info.capacity >= n;
+    return max_capacity_.load(std::memory_order_relaxed) - info.capacity >= n;
   }
 
   // Checks if the cache has at least batch size number of free slots. Returns
@@ -313,7 +328,7 @@ class TransferCache {
     void *to_free[kMaxObjectsToMove];
     int num_to_free;
     {
-      AllocationGuardSpinLockHolder h(&lock_);
+      TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
       auto info = slot_info_.load(std::memory_order_relaxed);
       if (info.capacity == 0) return false;
       if (info.capacity <= N) return false;
@@ -342,13 +357,100 @@ class TransferCache {
     return true;
   }
 
+  // Rescales the capacity ceiling to scale times the compiled-in baseline
+  // from CapacityNeeded().  Raising the ceiling may require a larger slot
+  // array: the replacement is allocated from the arena outside lock_, filled
+  // and published under it, and the old array is retired in place since
+  // arena memory is never reclaimed.  Lowering the ceiling trims capacity
+  // back down a batch at a time, returning cached objects that no longer fit
+  // to the freelist.  Invoked from the background resize pass, so this is a
+  // no-op unless the scale changed since the last call.
+  void SetMaxCapacityScale(int scale, int size_class)
+      ABSL_LOCKS_EXCLUDED(lock_) {
+    if (baseline_max_capacity_ == 0) return;
+    scale = std::max(scale, 1);
+    const int32_t want = static_cast<int32_t>(std::min<int64_t>(
+        static_cast<int64_t>(baseline_max_capacity_) * scale,
+        std::numeric_limits<int32_t>::max()));
+    const int32_t current = max_capacity_.load(std::memory_order_relaxed);
+    if (want == current) return;
+
+    if (want > current) {
+      {
+        TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
+        if (want <= slots_size_) {
+          max_capacity_.store(want, std::memory_order_relaxed);
+          return;
+        }
+      }
+      void **new_slots;
+      {
+        PageHeapSpinLockHolder l;
+        new_slots =
+            reinterpret_cast<void **>(owner_->Alloc(want * sizeof(void *)));
+      }
+      if (new_slots == nullptr) return;
+      TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
+      const auto info = slot_info_.load(std::memory_order_relaxed);
+      memcpy(new_slots, slots_, sizeof(void *) * info.used);
+      slots_ = new_slots;
+      slots_size_ = want;
+      max_capacity_.store(want, std::memory_order_relaxed);
+      return;
+    }
+
+    // Lowering the ceiling.  Trim a batch at a time so each return to the
+    // freelist fits an on-stack buffer, as in ShrinkCache().
+    while (true) {
+      void *to_free[kMaxObjectsToMove];
+      int num_to_free = 0;
+      {
+        TelemetrySpinLockHolder h(&lock_, LockId::kTransferCache);
+        auto info = slot_info_.load(std::memory_order_relaxed);
+        if (info.capacity <= want) {
+          max_capacity_.store(want, std::memory_order_relaxed);
+          return;
+        }
+        const int drop = std::min<int>(
+            info.capacity - want, Manager::num_objects_to_move(size_class));
+        const int unused = info.capacity - info.used;
+        info.capacity -= drop;
+        if (drop > unused) {
+          num_to_free = drop - unused;
+          info.used -= num_to_free;
+          low_water_mark_ = std::min(low_water_mark_, info.used);
+          memcpy(to_free, GetSlot(info.used), sizeof(void *) * num_to_free);
+        }
+        SetSlotInfo(info);
+      }
+      if (num_to_free > 0) {
+        freelist().InsertRange({to_free, static_cast<size_t>(num_to_free)});
+      }
+    }
+  }
+
   // This is a thin wrapper for the CentralFreeList.  It is intended to ensure
   // that we are not holding lock_ when we access it.
   ABSL_ATTRIBUTE_ALWAYS_INLINE FreeList &freelist() ABSL_LOCKS_EXCLUDED(lock_) {
     return freelist_do_not_access_directly_;
   }
 
-  int32_t max_capacity() const { return max_capacity_; }
+  int32_t max_capacity() const {
+    return max_capacity_.load(std::memory_order_relaxed);
+  }
+
+  // Used by the fork handlers to quiesce this cache and its freelist across
+  // fork(), so the child does not inherit a held lock.  There is no lock
+  // ordering between lock_ and the freelist's lock at runtime (we never hold
+  // both); the handlers take the freelist's lock first, consistently.
+  void AcquireInternalLocks() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    freelist().AcquireInternalLocks();
+    lock_.Lock();
+  }
+  void ReleaseInternalLocks() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    lock_.Unlock();
+    freelist().ReleaseInternalLocks();
+  }
 
  private:
   // Returns first object of the i-th slot.
@@ -359,7 +461,7 @@ class TransferCache {
   void SetSlotInfo(SizeInfo info) {
     TC_ASSERT_LE(0, info.used);
     TC_ASSERT_LE(info.used, info.capacity);
-    TC_ASSERT_LE(info.capacity, max_capacity_);
+    TC_ASSERT_LE(info.capacity, max_capacity_.load(std::memory_order_relaxed));
     slot_info_.store(info, std::memory_order_relaxed);
   }
 
@@ -393,20 +495,32 @@ class TransferCache {
   // entries.
   void **slots_ ABSL_GUARDED_BY(lock_);
 
+  // Number of slots in slots_, always at least max_capacity_.  Grows when a
+  // raised capacity ceiling outgrows the array (see SetMaxCapacityScale).
+  int32_t slots_size_ ABSL_GUARDED_BY(lock_);
+
   FreeList freelist_do_not_access_directly_;
 
   Manager *const owner_;
 
-  // Maximum size of the cache.
-  const int32_t max_capacity_;
+  // Maximum size of the cache.  Readers on the fast path load it without
+  // lock_, so it is atomic; it only changes via SetMaxCapacityScale.
+  std::atomic<int32_t> max_capacity_;
+
+  // The compiled-in ceiling from CapacityNeeded(); runtime rescaling is
+  // always expressed as a multiple of this value.
+  const int32_t baseline_max_capacity_;
 
   // The following 4 *_misses_ counters
   // are frequently updated, so they should reside in a separate cacheline from
   // lock_.
 
-  // For these we are deliberately fast-and-loose. Some increments may be lost.
-  StatsCounter insert_misses_;
-  StatsCounter remove_misses_;
+  // For these we are deliberately fast-and-loose. Some increments may be
+  // lost.  Unlike the hit counters, these are bumped outside lock_, from
+  // whichever CPU missed, so they are sharded to avoid true sharing on the
+  // miss path.
+  ShardedStatsCounter insert_misses_;
+  ShardedStatsCounter remove_misses_;
 
   MissCounts insert_object_misses_;
   MissCounts remove_object_misses_;
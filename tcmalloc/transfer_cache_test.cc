@@ -662,6 +662,53 @@ TEST(ShardedTransferCacheManagerTest, ShardsOnDemand) {
   }
 }
 
+TEST(ShardedTransferCacheManagerTest, RemoteFreeOutbox) {
+  if (!subtle::percpu::IsFast()) {
+    return;
+  }
+
+  using ShardedManager = FakeShardedTransferCacheEnvironment::ShardedManager;
+  constexpr int kNumShards = ShardedManager::kMinShardsAllowed;
+  FakeShardedTransferCacheEnvironment env(kNumShards,
+                                          /*use_generic_cache=*/true);
+  ShardedManager& manager = env.sharded_manager();
+  env.transfer_cache_manager().SetPartialLegacyTransferCache(true);
+  env.SetCurrentCpu(0);
+
+  // Buffered frees park in the cpu's outbox without touching the shard.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < ShardedManager::kOutboxObjects; ++i) {
+    void* ptr;
+    env.central_freelist().AllocateBatch(&ptr, 1);
+    manager.PushOutbox(kSizeClass, ptr);
+    ptrs.push_back(ptr);
+  }
+  EXPECT_EQ(manager.tc_length(0, kSizeClass), 0);
+
+  // A buffered object is reused straight from the outbox, most recent first.
+  void* hot = manager.PopOutbox(kSizeClass);
+  EXPECT_EQ(hot, ptrs.back());
+  EXPECT_EQ(manager.tc_length(0, kSizeClass), 0);
+  manager.PushOutbox(kSizeClass, hot);
+
+  // The push that overflows the outbox moves the whole burst to the shard.
+  void* extra;
+  env.central_freelist().AllocateBatch(&extra, 1);
+  manager.PushOutbox(kSizeClass, extra);
+  EXPECT_EQ(manager.tc_length(0, kSizeClass),
+            ShardedManager::kOutboxObjects + 1);
+
+  // FlushOutboxes drains a partially-filled outbox too.
+  void* again = manager.PopOutbox(kSizeClass);
+  ASSERT_NE(again, nullptr);
+  EXPECT_EQ(manager.tc_length(0, kSizeClass), ShardedManager::kOutboxObjects);
+  manager.PushOutbox(kSizeClass, again);
+  EXPECT_EQ(manager.tc_length(0, kSizeClass), ShardedManager::kOutboxObjects);
+  manager.FlushOutboxes();
+  EXPECT_EQ(manager.tc_length(0, kSizeClass),
+            ShardedManager::kOutboxObjects + 1);
+}
+
 namespace unit_tests {
 using Env = FakeTransferCacheEnvironment<internal_transfer_cache::TransferCache<
     MockCentralFreeList, FakeTransferCacheManager>>;
@@ -670,6 +717,71 @@ INSTANTIATE_TYPED_TEST_SUITE_P(TransferCache, TransferCacheTest,
 
 }  // namespace unit_tests
 
+namespace sort_tests {
+using Env = FakeTransferCacheEnvironment<internal_transfer_cache::TransferCache<
+    FakeCentralFreeList, FakeTransferCacheManager>>;
+
+TEST(TransferCacheSortTest, SortedBatchesComeBackAscending) {
+  const int batch_size = Env::kBatchSize;
+  FakeTransferCacheManager::SetSortInsertedBatches(true);
+  Env e;
+  void* batch[kMaxObjectsToMove];
+  e.central_freelist().AllocateBatch(batch, batch_size);
+  // Scramble the batch so the insert path has something to sort.
+  std::reverse(batch, batch + batch_size);
+  e.transfer_cache().InsertRange(kSizeClass, {batch, batch_size});
+
+  // Inserts and removes preserve batch order, so the sorted batch must come
+  // back as an ascending run.
+  ASSERT_EQ(e.transfer_cache().RemoveRange(kSizeClass, batch, batch_size),
+            batch_size);
+  EXPECT_TRUE(std::is_sorted(batch, batch + batch_size));
+
+  // Park the objects in the cache again so the environment's teardown drain
+  // returns them to the freelist.
+  e.transfer_cache().InsertRange(kSizeClass, {batch, batch_size});
+  FakeTransferCacheManager::SetSortInsertedBatches(false);
+}
+
+}  // namespace sort_tests
+
+namespace capacity_scale_tests {
+using Env = FakeTransferCacheEnvironment<internal_transfer_cache::TransferCache<
+    FakeCentralFreeList, FakeTransferCacheManager>>;
+
+TEST(TransferCacheCapacityScaleTest, ScaleMovesCeilingAndKeepsObjects) {
+  const int batch_size = Env::kBatchSize;
+  Env e;
+  const int32_t baseline = e.transfer_cache().max_capacity();
+
+  // Raising the scale swaps in a larger slot array and lifts the ceiling;
+  // objects cached across the swap survive it.
+  e.Insert(batch_size);
+  e.Insert(batch_size);
+  e.transfer_cache().SetMaxCapacityScale(4, kSizeClass);
+  EXPECT_EQ(e.transfer_cache().max_capacity(), 4 * baseline);
+  EXPECT_EQ(e.transfer_cache().tc_length(), 2 * batch_size);
+
+  // The cache can now grow and fill past the compiled-in ceiling.
+  while (e.transfer_cache().CanIncreaseCapacity(kSizeClass)) {
+    ASSERT_TRUE(e.transfer_cache().IncreaseCacheCapacity(kSizeClass));
+  }
+  EXPECT_GT(e.transfer_cache().GetStats().capacity, baseline);
+  while (e.transfer_cache().HasSpareCapacity(kSizeClass)) {
+    e.Insert(batch_size);
+  }
+  EXPECT_GT(e.transfer_cache().tc_length(), baseline);
+
+  // Dropping back to scale 1 trims capacity to the baseline ceiling and
+  // returns the objects that no longer fit to the freelist, not the floor.
+  e.transfer_cache().SetMaxCapacityScale(1, kSizeClass);
+  EXPECT_EQ(e.transfer_cache().max_capacity(), baseline);
+  EXPECT_LE(e.transfer_cache().GetStats().capacity, baseline);
+  EXPECT_LE(e.transfer_cache().tc_length(), baseline);
+}
+
+}  // namespace capacity_scale_tests
+
 namespace fuzz_tests {
 // Use the FakeCentralFreeList instead of the MockCentralFreeList for fuzz tests
 // as it avoids the overheads of mocks and allows more iterations of the fuzzing
@@ -696,6 +808,27 @@ struct MockTransferCacheManager {
   MOCK_METHOD(size_t, FetchCommitIntervalMisses, (int size_class));
 };
 
+TEST(TransferCacheMissTrackerTest, RemembersPeakOverWindow) {
+  TransferCacheMissTracker tracker;
+  tracker.Init();
+
+  EXPECT_EQ(tracker.MaxMisses(1), 0);
+
+  tracker.Report(1, 100);
+  EXPECT_EQ(tracker.MaxMisses(1), 100);
+  // Other classes are unaffected.
+  EXPECT_EQ(tracker.MaxMisses(2), 0);
+
+  // An interval without misses does not erase the demand the class showed
+  // earlier in the window.
+  tracker.Report(1, 0);
+  EXPECT_EQ(tracker.MaxMisses(1), 100);
+
+  // Additional misses within the same epoch accumulate.
+  tracker.Report(1, 50);
+  EXPECT_EQ(tracker.MaxMisses(1), 150);
+}
+
 TEST(RealTransferCacheTest, ResizeOccurs) {
   testing::StrictMock<MockTransferCacheManager> m;
   {
@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+# Copyright 2024 The TCMalloc Authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     https://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Renders heap layout snapshots as treemap/heatmap visualizations.
+
+Reads the versioned binary blob produced by
+tcmalloc::malloc_tracing_extension::GetHeapLayoutSnapshot() and emits either
+a plain-text summary or a self-contained SVG: one tile per filler-managed
+hugepage whose fill color encodes utilization and whose interior strips show
+the allocated/free/released page runs, plus bands for huge regions and huge
+cache ranges.  Needs only the Python standard library.
+
+Usage:
+  heap_layout_viz.py snapshot.bin               # text summary to stdout
+  heap_layout_viz.py snapshot.bin -o layout.svg # SVG heatmap
+
+Format, version 1 (all integers little-endian):
+  Header: the bytes 'TCHL', uint16 version, uint16 reserved, uint32 page
+  size in bytes, uint32 pages per hugepage.
+  Records, each introduced by a uint8 type, until end of blob:
+    1 (filler hugepage): uint64 start address, uint8 heap (0 = normal
+      partition 0, 1 = normal partition 1, 2 = sampled, 3 = cold), uint8
+      flags (bit 0 donated, bit 1 broken, bit 2 dense, bit 3 short-lived),
+      uint8 idle score, uint16 allocation count, uint16 run count, then per
+      run uint16 first page, uint16 pages, uint8 state (0 = allocated,
+      1 = free, 2 = released).
+    2 (huge region): uint64 start address, uint64 bytes, uint64 used pages,
+      uint64 free pages, uint64 unmapped pages.
+    3 (huge cache range): uint64 start address, uint64 bytes.
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+MAGIC = b'TCHL'
+VERSION = 1
+
+HEAP_NAMES = {0: 'normal_p0', 1: 'normal_p1', 2: 'sampled', 3: 'cold'}
+STATE_NAMES = {0: 'allocated', 1: 'free', 2: 'released'}
+STATE_COLORS = {0: '#c0392b', 1: '#f1c40f', 2: '#2980b9'}
+
+HugePageRecord = collections.namedtuple(
+    'HugePageRecord',
+    'start_addr heap donated broken dense short_lived idle_score nallocs runs')
+RegionRecord = collections.namedtuple(
+    'RegionRecord', 'start_addr bytes used_pages free_pages unmapped_pages')
+CacheRecord = collections.namedtuple('CacheRecord', 'start_addr bytes')
+Snapshot = collections.namedtuple(
+    'Snapshot', 'page_size pages_per_hugepage hugepages regions cache_ranges')
+
+
+def parse(blob):
+  """Parses a snapshot blob into a Snapshot."""
+  if blob[:4] != MAGIC:
+    raise ValueError('not a heap layout snapshot (bad magic)')
+  version, _, page_size, pages_per_hugepage = struct.unpack_from(
+      '<HHII', blob, 4)
+  if version != VERSION:
+    raise ValueError('unsupported snapshot version %d' % version)
+  pos = 16
+  hugepages, regions, cache_ranges = [], [], []
+  while pos < len(blob):
+    record_type = blob[pos]
+    pos += 1
+    if record_type == 1:
+      start_addr, heap, flags, idle_score, nallocs, num_runs = (
+          struct.unpack_from('<QBBBHH', blob, pos))
+      pos += 15
+      runs = []
+      for _ in range(num_runs):
+        start_page, num_pages, state = struct.unpack_from('<HHB', blob, pos)
+        pos += 5
+        runs.append((start_page, num_pages, state))
+      hugepages.append(
+          HugePageRecord(start_addr, heap, bool(flags & 1), bool(flags & 2),
+                         bool(flags & 4), bool(flags & 8), idle_score,
+                         nallocs, runs))
+    elif record_type == 2:
+      regions.append(RegionRecord(*struct.unpack_from('<QQQQQ', blob, pos)))
+      pos += 40
+    elif record_type == 3:
+      cache_ranges.append(CacheRecord(*struct.unpack_from('<QQ', blob, pos)))
+      pos += 16
+    else:
+      raise ValueError('unknown record type %d at offset %d' %
+                       (record_type, pos - 1))
+  return Snapshot(page_size, pages_per_hugepage, hugepages, regions,
+                  cache_ranges)
+
+
+def pages_by_state(record):
+  counts = collections.Counter()
+  for _, num_pages, state in record.runs:
+    counts[state] += num_pages
+  return counts
+
+
+def print_summary(snapshot, out):
+  """Prints a per-heap utilization table and the region/cache inventory."""
+  per_heap = collections.defaultdict(collections.Counter)
+  for record in snapshot.hugepages:
+    counts = pages_by_state(record)
+    heap = per_heap[record.heap]
+    heap['hugepages'] += 1
+    for state, pages in counts.items():
+      heap[STATE_NAMES[state]] += pages
+  out.write('filler hugepages (%d pages each):\n' %
+            snapshot.pages_per_hugepage)
+  for heap in sorted(per_heap):
+    counts = per_heap[heap]
+    total = counts['hugepages'] * snapshot.pages_per_hugepage
+    out.write('  %-10s %6d hugepages  %8d allocated  %8d free  '
+              '%8d released  (%.1f%% used)\n' %
+              (HEAP_NAMES.get(heap, str(heap)), counts['hugepages'],
+               counts['allocated'], counts['free'], counts['released'],
+               100.0 * counts['allocated'] / total if total else 0.0))
+  out.write('huge regions: %d\n' % len(snapshot.regions))
+  for region in snapshot.regions:
+    out.write('  0x%016x %6.1f MiB  used %d  free %d  unmapped %d pages\n' %
+              (region.start_addr, region.bytes / 2**20, region.used_pages,
+               region.free_pages, region.unmapped_pages))
+  out.write('huge cache ranges: %d\n' % len(snapshot.cache_ranges))
+  for entry in snapshot.cache_ranges:
+    out.write('  0x%016x %6.1f MiB\n' % (entry.start_addr,
+                                         entry.bytes / 2**20))
+
+
+def utilization_color(fraction):
+  """Green (empty) through yellow to red (full)."""
+  red = int(255 * min(1.0, 2 * fraction))
+  green = int(255 * min(1.0, 2 * (1 - fraction)))
+  return '#%02x%02x40' % (red, green)
+
+
+def write_svg(snapshot, out, columns=64, tile=12):
+  """Writes a treemap: one tile per hugepage, bands for regions and cache."""
+  parts = []
+
+  def tile_block(records, row, title):
+    parts.append('<text x="2" y="%d" class="label">%s</text>' %
+                 (row * tile + 10, title))
+    row += 1
+    for i, record in enumerate(records):
+      x = (i % columns) * tile
+      y = (row + i // columns) * tile
+      counts = pages_by_state(record)
+      used = counts[0] / snapshot.pages_per_hugepage
+      tooltip = ('0x%x used=%.0f%% free=%d released=%d nallocs=%d idle=%d%s' %
+                 (record.start_addr, 100 * used, counts[1], counts[2],
+                  record.nallocs, record.idle_score,
+                  ''.join(' ' + name
+                          for name, flag in (('donated', record.donated),
+                                             ('broken', record.broken),
+                                             ('dense', record.dense),
+                                             ('short-lived',
+                                              record.short_lived)) if flag)))
+      parts.append(
+          '<rect x="%d" y="%d" width="%d" height="%d" fill="%s">'
+          '<title>%s</title></rect>' %
+          (x, y, tile - 1, tile - 1, utilization_color(used), tooltip))
+      # Page-state strips inside the tile make release-blocking allocations
+      # visible at a glance.
+      for start_page, num_pages, state in record.runs:
+        if state == 0:
+          continue
+        sx = x + (tile - 1) * start_page / snapshot.pages_per_hugepage
+        sw = (tile - 1) * num_pages / snapshot.pages_per_hugepage
+        parts.append('<rect x="%.2f" y="%d" width="%.2f" height="3" '
+                     'fill="%s"/>' % (sx, y + tile - 4, sw,
+                                      STATE_COLORS[state]))
+    return row + (len(records) + columns - 1) // columns + 1
+
+  row = 0
+  per_heap = collections.defaultdict(list)
+  for record in snapshot.hugepages:
+    per_heap[record.heap].append(record)
+  for heap in sorted(per_heap):
+    row = tile_block(sorted(per_heap[heap], key=lambda r: r.start_addr), row,
+                     'filler hugepages: %s' % HEAP_NAMES.get(heap, str(heap)))
+
+  def band_block(entries, row, title, color_of):
+    parts.append('<text x="2" y="%d" class="label">%s</text>' %
+                 (row * tile + 10, title))
+    row += 1
+    x = 0
+    hugepage_bytes = snapshot.page_size * snapshot.pages_per_hugepage
+    for entry in entries:
+      width = max(tile, tile * entry.bytes // hugepage_bytes)
+      if x + width > columns * tile:
+        x, row = 0, row + 1
+      parts.append('<rect x="%d" y="%d" width="%d" height="%d" fill="%s">'
+                   '<title>0x%x %.1f MiB</title></rect>' %
+                   (x, row * tile, width - 1, tile - 1, color_of(entry),
+                    entry.start_addr, entry.bytes / 2**20))
+      x += width
+    return row + 2
+
+  if snapshot.regions:
+    row = band_block(
+        snapshot.regions, row, 'huge regions', lambda region:
+        utilization_color(region.used_pages * snapshot.page_size /
+                          max(1, region.bytes)))
+  if snapshot.cache_ranges:
+    row = band_block(snapshot.cache_ranges, row, 'huge cache',
+                     lambda entry: STATE_COLORS[1])
+
+  out.write('<svg xmlns="http://www.w3.org/2000/svg" width="%d" '
+            'height="%d">\n' % (columns * tile, row * tile))
+  out.write('<style>.label { font: 10px monospace; }</style>\n')
+  out.write('<rect width="100%" height="100%" fill="#202020"/>\n')
+  out.write('\n'.join(parts))
+  out.write('\n</svg>\n')
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument('snapshot', help='snapshot file from '
+                      'GetHeapLayoutSnapshot()')
+  parser.add_argument('-o', '--output', help='write an SVG heatmap here '
+                      'instead of a text summary to stdout')
+  args = parser.parse_args()
+  with open(args.snapshot, 'rb') as f:
+    snapshot = parse(f.read())
+  if args.output:
+    with open(args.output, 'w') as f:
+      write_svg(snapshot, f)
+  else:
+    print_summary(snapshot, sys.stdout)
+
+
+if __name__ == '__main__':
+  main()